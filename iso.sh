@@ -7,9 +7,29 @@ mkdir -p isodir/boot
 mkdir -p isodir/boot/grub
 
 cp sysroot/boot/olympos.kernel isodir/boot/olympos.kernel
+
+# A sysroot/initrd tree is packed into the root filesystem image (initrd_init() mounts modules named initrd*)
+if [ -d sysroot/initrd ]; then
+	mkdir -p sysroot/boot/modules
+	tar --format=ustar -cf sysroot/boot/modules/initrd.tar -C sysroot/initrd .
+fi
+
+# Files in sysroot/boot/modules (e.g. user programs for process_exec()) are loaded as multiboot modules
+MODULES=""
+if [ -d sysroot/boot/modules ]; then
+	mkdir -p isodir/boot/modules
+	for MODULE in sysroot/boot/modules/*; do
+		[ -f "$MODULE" ] || continue
+		cp "$MODULE" isodir/boot/modules/
+		MODULES="$MODULES	module /boot/modules/$(basename "$MODULE")
+"
+	done
+fi
+
 cat > isodir/boot/grub/grub.cfg << EOF
+insmod all_video
 menuentry "olympos" {
 	multiboot /boot/olympos.kernel
-}
+$MODULES}
 EOF
 grub-mkrescue -o olympos.iso isodir
@@ -0,0 +1,218 @@
+/**
+ * ACPI Static Tables
+ *
+ *   RSDP ("RSD PTR ", 16-byte aligned in the first KiB of the EBDA or in
+ *   0xE0000 - 0xFFFFF) → RSDT → { "APIC" (MADT), "FACP", ... }
+ *
+ * Only the 32-bit RSDT is used; the XSDT adds nothing below 4 GiB. Every
+ * table is checked against its checksum before it is trusted. Tables above
+ * the kernel identity map are mapped with paging_map_physical().
+ *
+ * Reference: https://wiki.osdev.org/RSDP, https://wiki.osdev.org/MADT
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <kernel/paging.h>
+#include <kernel/klog.h>
+
+#include "include/acpi.h"
+
+#define ACPI_EBDA_SEGMENT_PTR   0x40E       /* BIOS data area: EBDA segment */
+#define ACPI_BIOS_START         0xE0000
+#define ACPI_BIOS_END           0x100000
+
+/* MADT entry types */
+#define MADT_LAPIC              0
+#define MADT_IOAPIC             1
+#define MADT_ISO                2
+#define MADT_LAPIC_OVERRIDE     5
+
+#define MADT_LAPIC_ENABLED      0x1
+#define MADT_PCAT_COMPAT        0x1
+
+typedef struct {
+    char signature[8];                  /* "RSD PTR " */
+    uint8_t checksum;                   /* First 20 bytes sum to 0 */
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_address;
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char signature[4];
+    uint32_t length;                    /* Header included; the whole table sums to 0 */
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_header_t;
+
+typedef struct {
+    acpi_header_t header;
+    uint32_t lapic_address;
+    uint32_t flags;                     /* MADT_PCAT_COMPAT */
+} __attribute__((packed)) acpi_madt_header_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) madt_entry_t;
+
+static acpi_madt_t madt;
+static bool madt_valid = false;
+
+/**
+ * Check that len bytes sum to 0 (mod 256)
+ */
+static bool acpi_checksum(const void* data, uint32_t len) {
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+/**
+ * Look for the RSDP in [start, end), which is inside the identity map
+ */
+static const acpi_rsdp_t* acpi_scan_rsdp(uint32_t start, uint32_t end) {
+    for (uint32_t addr = start & ~0xF; addr + sizeof(acpi_rsdp_t) <= end; addr += 16) {
+        const acpi_rsdp_t* rsdp = (const acpi_rsdp_t*) addr;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && acpi_checksum(rsdp, sizeof(acpi_rsdp_t))) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Map a whole table and verify it
+ *
+ * @return Table, or NULL if it can't be mapped or its checksum is wrong
+ */
+static const acpi_header_t* acpi_map_table(uint32_t phys) {
+    const acpi_header_t* header = (const acpi_header_t*) paging_map_physical(phys, sizeof(acpi_header_t), 0);
+    if (header == NULL || header->length < sizeof(acpi_header_t)) {
+        return NULL;
+    }
+    uint32_t length = header->length;
+    const acpi_header_t* table = (const acpi_header_t*) paging_map_physical(phys, length, 0);
+    if (table == NULL || !acpi_checksum(table, length)) {
+        return NULL;
+    }
+    return table;
+}
+
+/**
+ * Read the MADT's entries into madt
+ */
+static void acpi_parse_madt(const acpi_madt_header_t* table) {
+    memset(&madt, 0, sizeof(madt));
+    madt.lapic_phys = table->lapic_address;
+    madt.pcat_compat = (table->flags & MADT_PCAT_COMPAT) != 0;
+    for (uint32_t irq = 0; irq < 16; irq++) {
+        madt.isa_gsi[irq] = irq;        /* Identity unless overridden */
+    }
+    const uint8_t* entry = (const uint8_t*) (table + 1);
+    const uint8_t* end = (const uint8_t*) table + table->header.length;
+    while (entry + sizeof(madt_entry_t) <= end) {
+        const madt_entry_t* header = (const madt_entry_t*) entry;
+        if (header->length < sizeof(madt_entry_t) || entry + header->length > end) {
+            break;
+        }
+        switch (header->type) {
+            case MADT_LAPIC:
+                /* processor id, APIC id, flags */
+                if ((*(const uint32_t*) (entry + 4) & MADT_LAPIC_ENABLED) && madt.cpu_count < ACPI_MAX_CPUS) {
+                    madt.cpu_apic_ids[madt.cpu_count++] = entry[3];
+                }
+                break;
+            case MADT_IOAPIC:
+                /* id, reserved, address, GSI base; the first one serves the ISA IRQs */
+                if (madt.ioapic_phys == 0) {
+                    madt.ioapic_id = entry[2];
+                    madt.ioapic_phys = *(const uint32_t*) (entry + 4);
+                    madt.ioapic_gsi_base = *(const uint32_t*) (entry + 8);
+                }
+                break;
+            case MADT_ISO:
+                /* bus (0 = ISA), source IRQ, GSI, flags */
+                if (entry[2] == 0 && entry[3] < 16) {
+                    madt.isa_gsi[entry[3]] = *(const uint32_t*) (entry + 4);
+                    madt.isa_flags[entry[3]] = *(const uint16_t*) (entry + 8);
+                }
+                break;
+            case MADT_LAPIC_OVERRIDE: {
+                /* reserved, 64-bit address: usable only below 4 GiB */
+                uint64_t address = *(const uint64_t*) (entry + 4);
+                if (address < 0x100000000ULL) {
+                    madt.lapic_phys = (uint32_t) address;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        entry += header->length;
+    }
+}
+
+/**
+ * Find and parse the MADT
+ */
+int acpi_init(void) {
+    const uint16_t* ebda_segment = (const uint16_t*) ACPI_EBDA_SEGMENT_PTR;
+    asm("" : "+r"(ebda_segment));      /* GCC takes constant addresses in the first page for NULL + offset */
+    uint32_t ebda = (uint32_t) *ebda_segment << 4;
+    const acpi_rsdp_t* rsdp = NULL;
+    if (ebda >= 0x80000 && ebda < 0xA0000) {
+        rsdp = acpi_scan_rsdp(ebda, ebda + 1024);
+    }
+    if (rsdp == NULL) {
+        rsdp = acpi_scan_rsdp(ACPI_BIOS_START, ACPI_BIOS_END);
+    }
+    if (rsdp == NULL) {
+        klog(KLOG_ERR, "[FAILED] acpi_init: No RSDP\n");
+        return -1;
+    }
+    const acpi_header_t* rsdt = acpi_map_table(rsdp->rsdt_address);
+    if (rsdt == NULL || memcmp(rsdt->signature, "RSDT", 4) != 0) {
+        klog(KLOG_ERR, "[FAILED] acpi_init: Invalid RSDT at %p\n", rsdp->rsdt_address);
+        return -1;
+    }
+    const uint32_t* entries = (const uint32_t*) (rsdt + 1);
+    uint32_t count = (rsdt->length - sizeof(acpi_header_t)) / sizeof(uint32_t);
+    for (uint32_t i = 0; i < count; i++) {
+        /* Peek at the signature before mapping the whole table */
+        const acpi_header_t* header = (const acpi_header_t*) paging_map_physical(entries[i], sizeof(acpi_header_t), 0);
+        if (header == NULL || memcmp(header->signature, "APIC", 4) != 0) {
+            continue;
+        }
+        const acpi_header_t* table = acpi_map_table(entries[i]);
+        if (table == NULL || table->length < sizeof(acpi_madt_header_t)) {
+            klog(KLOG_ERR, "[FAILED] acpi_init: Invalid MADT at %p\n", entries[i]);
+            return -1;
+        }
+        acpi_parse_madt((const acpi_madt_header_t*) table);
+        madt_valid = true;
+        return 0;
+    }
+    klog(KLOG_ERR, "[FAILED] acpi_init: No MADT\n");
+    return -1;
+}
+
+/**
+ * Parsed MADT
+ */
+const acpi_madt_t* acpi_madt(void) {
+    return madt_valid ? &madt : NULL;
+}
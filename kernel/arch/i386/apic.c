@@ -0,0 +1,315 @@
+/**
+ * Local APIC and IOAPIC
+ *
+ * Both are programmed through uncached MMIO registers:
+ *   LAPIC   32-bit registers at 16-byte intervals (EOI, spurious vector, timer, LVTs)
+ *   IOAPIC  an index/data pair (IOREGSEL, IOWIN) in front of the redirection table,
+ *           one 64-bit entry per input pin: vector, polarity, trigger, mask, destination
+ *
+ * apic_init():
+ *   MADT → map LAPIC + IOAPIC → software-enable the LAPIC (spurious vector 0xFF)
+ *        → mask LINT0 (the 8259's virtual-wire input), keep LINT1 as NMI
+ *        → every redirection entry masked → irq.c masks the PICs and reroutes
+ *
+ * The other CPUs only program their own LAPIC (lapic_init_cpu()); the boot
+ * CPU starts them with INIT and STARTUP IPIs (lapic_send_ipi(), smp.c).
+ *
+ * ISA IRQ n goes to the pin of its GSI (IRQ 0 usually sits on pin 2) with the
+ * override's polarity and trigger, delivered to vector 32 + n on the boot CPU.
+ *
+ * Reference: Intel SDM Vol. 3A, chapter 11; 82093AA IOAPIC datasheet
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <kernel/paging.h>
+#include <kernel/klog.h>
+#include <kernel/spinlock.h>
+
+#include "include/apic.h"
+#include "include/acpi.h"
+#include "include/irq.h"
+#include "include/msr.h"
+#include "include/cpuid.h"
+#include "include/irqflags.h"
+#include "include/gdt.h"
+
+/* Local APIC registers (offsets) */
+#define LAPIC_ID                0x020
+#define LAPIC_VERSION           0x030
+#define LAPIC_TPR               0x080       /* Task priority: 0 accepts every vector */
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0       /* Spurious vector + software enable */
+#define LAPIC_ESR               0x280       /* Error status */
+#define LAPIC_ICR_LOW           0x300       /* Interrupt command: writing it sends the IPI */
+#define LAPIC_ICR_HIGH          0x310       /* Bits 24-31: destination APIC ID */
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_LVT_LINT0         0x350
+#define LAPIC_LVT_LINT1         0x360
+#define LAPIC_LVT_ERROR         0x370
+#define LAPIC_TIMER_INITIAL     0x380
+#define LAPIC_TIMER_CURRENT     0x390
+#define LAPIC_TIMER_DIVIDE      0x3E0
+
+#define LAPIC_SVR_ENABLE        0x100
+#define LAPIC_LVT_MASKED        0x10000
+#define LAPIC_LVT_NMI           0x400       /* Delivery mode NMI */
+#define LAPIC_TIMER_PERIODIC    0x20000
+#define LAPIC_TIMER_TSC_DEADLINE 0x40000    /* Fires when the TSC reaches IA32_TSC_DEADLINE */
+#define LAPIC_TIMER_DIVIDE_16   0x3
+#define LAPIC_ICR_PENDING       0x1000      /* Delivery status: IPI not yet accepted */
+
+#define MSR_IA32_APIC_BASE      0x1B
+#define APIC_BASE_ENABLE        0x800       /* Global enable */
+#define MSR_IA32_TSC_DEADLINE   0x6E0
+
+/* IOAPIC registers */
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WINDOW           0x10
+#define IOAPIC_REG_VERSION      0x01        /* Bits 16-23: index of the last redirection entry */
+#define IOAPIC_REG_REDIRECT     0x10        /* Entry n: low word 0x10 + 2n, high word 0x11 + 2n */
+
+#define IOAPIC_REDIRECT_MASKED  0x10000
+#define IOAPIC_REDIRECT_LEVEL   0x8000
+#define IOAPIC_REDIRECT_LOW     0x2000      /* Active low */
+
+#define IRQ_VECTOR_BASE         32
+
+/* Incremented by apic_spurious_stub */
+volatile uint32_t apic_spurious_interrupts = 0;
+
+extern void apic_spurious_stub(void);
+extern void ipi_tick_stub(void);
+extern void ipi_resched_stub(void);
+extern void ipi_tlb_stub(void);
+extern void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
+
+static volatile uint32_t* lapic = NULL;
+static volatile uint32_t* ioapic = NULL;
+static uint32_t ioapic_pins = 0;
+static const acpi_madt_t* madt = NULL;
+static bool apic_active = false;
+/* IOREGSEL and IOWIN are one access; CPUs routing IRQs take turns */
+static spinlock_t ioapic_lock = SPINLOCK_INIT;
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic[reg / 4] = value;
+}
+
+static uint32_t ioapic_read(uint32_t reg) {
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    return ioapic[IOAPIC_WINDOW / 4];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value) {
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    ioapic[IOAPIC_WINDOW / 4] = value;
+}
+
+/**
+ * Signal end of interrupt to the local APIC
+ */
+void lapic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/**
+ * Local APIC ID of the running CPU
+ */
+uint8_t lapic_id(void) {
+    return (uint8_t) (lapic_read(LAPIC_ID) >> 24);
+}
+
+/**
+ * Send an inter-processor interrupt and wait until the LAPIC has accepted it
+ */
+void lapic_send_ipi(uint8_t apic_id, uint32_t command) {
+    uint32_t flags = irq_save();
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t) apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile("pause");
+    }
+    irq_restore(flags);
+}
+
+/**
+ * IOAPIC pin of an ISA IRQ, or -1 if this IOAPIC doesn't have it
+ */
+static int ioapic_pin(uint8_t irq) {
+    uint32_t gsi = madt->isa_gsi[irq];
+    if (gsi < madt->ioapic_gsi_base || gsi - madt->ioapic_gsi_base >= ioapic_pins) {
+        return -1;
+    }
+    return (int) (gsi - madt->ioapic_gsi_base);
+}
+
+/**
+ * Write a redirection entry (high word first, so it's never live half-written)
+ */
+static void ioapic_set_entry(uint32_t pin, uint32_t low, uint8_t destination) {
+    uint32_t flags = spin_lock_irqsave(&ioapic_lock);
+    ioapic_write(IOAPIC_REG_REDIRECT + 2 * pin + 1, (uint32_t) destination << 24);
+    ioapic_write(IOAPIC_REG_REDIRECT + 2 * pin, low);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+}
+
+/**
+ * Route an ISA IRQ to vector 32 + irq and unmask it at the IOAPIC
+ */
+void ioapic_unmask_irq(uint8_t irq) {
+    int pin = irq < 16 ? ioapic_pin(irq) : -1;
+    if (pin < 0) {
+        return;
+    }
+    uint32_t low = IRQ_VECTOR_BASE + irq;   /* Fixed delivery, physical destination */
+    uint16_t inti = madt->isa_flags[irq];
+    /* ISA defaults (flags 0, "conforms to the bus") are edge-triggered, active high */
+    if ((inti & ACPI_INTI_POLARITY_MASK) == ACPI_INTI_ACTIVE_LOW) {
+        low |= IOAPIC_REDIRECT_LOW;
+    }
+    if ((inti & ACPI_INTI_TRIGGER_MASK) == ACPI_INTI_LEVEL) {
+        low |= IOAPIC_REDIRECT_LEVEL;
+    }
+    ioapic_set_entry((uint32_t) pin, low, lapic_id());
+}
+
+/**
+ * Mask an ISA IRQ at the IOAPIC
+ */
+void ioapic_mask_irq(uint8_t irq) {
+    int pin = irq < 16 ? ioapic_pin(irq) : -1;
+    if (pin >= 0) {
+        ioapic_set_entry((uint32_t) pin, IOAPIC_REDIRECT_MASKED, 0);
+    }
+}
+
+/**
+ * Start the LAPIC timer counting down from its maximum, without interrupts
+ */
+void lapic_timer_count_start(void) {
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_TIMER_INITIAL, UINT32_MAX);
+}
+
+/**
+ * LAPIC timer counts since lapic_timer_count_start()
+ */
+uint32_t lapic_timer_elapsed(void) {
+    return UINT32_MAX - lapic_read(LAPIC_TIMER_CURRENT);
+}
+
+/**
+ * Fire the LAPIC timer periodically on a vector
+ */
+void lapic_timer_periodic(uint32_t count, uint8_t vector) {
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | vector);
+    lapic_write(LAPIC_TIMER_INITIAL, count ? count : 1);
+}
+
+/**
+ * Fire the LAPIC timer once on a vector
+ */
+void lapic_timer_oneshot(uint32_t count, uint8_t vector) {
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, vector);
+    lapic_write(LAPIC_TIMER_INITIAL, count ? count : 1);
+}
+
+/**
+ * Fire the LAPIC timer once when the TSC reaches a value
+ */
+void lapic_timer_deadline(uint64_t tsc, uint8_t vector) {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_TSC_DEADLINE | vector);
+    /* The MMIO store must reach the LAPIC before the MSR write arms it (SDM 10.5.4.1) */
+    asm volatile("mfence" ::: "memory");
+    wrmsr(MSR_IA32_TSC_DEADLINE, tsc ? tsc : 1);
+}
+
+/**
+ * Spurious interrupts the LAPIC raised
+ */
+uint32_t apic_spurious_count(void) {
+    return apic_spurious_interrupts;
+}
+
+/**
+ * Enable the running CPU's LAPIC: no timer, no LINT0, LINT1 as NMI
+ */
+static void lapic_setup(void) {
+    /* The MSR might have been left disabled by firmware; the base stays where the MADT says */
+    wrmsr(MSR_IA32_APIC_BASE, rdmsr(MSR_IA32_APIC_BASE) | APIC_BASE_ENABLE);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+    lapic_eoi();                        /* Nothing may be left in service from the firmware */
+}
+
+/**
+ * Enable the local APIC of an application processor
+ */
+void lapic_init_cpu(void) {
+    if (apic_active) {
+        lapic_setup();
+    }
+}
+
+/**
+ * Switch interrupt delivery to the local APIC and IOAPIC
+ */
+int apic_init(void) {
+    if (apic_active) {
+        return 0;
+    }
+    if (!cpuid_has_edx(CPUID_EDX_APIC)) {
+        klog(KLOG_ERR, "[FAILED] apic_init: CPU has no local APIC\n");
+        return -1;
+    }
+    if (acpi_init() != 0 || (madt = acpi_madt()) == NULL || madt->ioapic_phys == 0) {
+        klog(KLOG_ERR, "[FAILED] apic_init: No IOAPIC in the ACPI tables, keeping the 8259 PICs\n");
+        return -1;
+    }
+    lapic = (volatile uint32_t*) paging_map_physical(madt->lapic_phys, PAGE_SIZE, PTE_WRITABLE | PTE_CACHE_DISABLE);
+    ioapic = (volatile uint32_t*) paging_map_physical(madt->ioapic_phys, IOAPIC_WINDOW + 4,
+                                                      PTE_WRITABLE | PTE_CACHE_DISABLE);
+    if (lapic == NULL || ioapic == NULL) {
+        return -1;
+    }
+
+    uint32_t flags = irq_save();
+    idt_set_gate(APIC_SPURIOUS_VECTOR, (uint32_t) apic_spurious_stub, KERNEL_CS, 0x8E);
+    idt_set_gate(LAPIC_TICK_VECTOR, (uint32_t) ipi_tick_stub, KERNEL_CS, 0x8E);
+    idt_set_gate(IPI_RESCHED_VECTOR, (uint32_t) ipi_resched_stub, KERNEL_CS, 0x8E);
+    idt_set_gate(IPI_TLB_VECTOR, (uint32_t) ipi_tlb_stub, KERNEL_CS, 0x8E);
+    lapic_setup();
+
+    ioapic_pins = ((ioapic_read(IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+    for (uint32_t pin = 0; pin < ioapic_pins; pin++) {
+        ioapic_set_entry(pin, IOAPIC_REDIRECT_MASKED, 0);
+    }
+    apic_active = true;
+    irq_use_apic();
+    irq_restore(flags);
+    klog(KLOG_INFO, "[  OK  ] APIC initialized (LAPIC %u, IOAPIC %u with %u pins, %u CPUs).\n", lapic_id(),
+         madt->ioapic_id, ioapic_pins, madt->cpu_count);
+    return 0;
+}
+
+/**
+ * Check whether interrupts are delivered through the APIC
+ */
+bool apic_enabled(void) {
+    return apic_active;
+}
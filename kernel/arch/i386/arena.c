@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <kernel/arena.h>
+#include <kernel/kheap.h>
+#include <kernel/paging.h>
+#include <kernel/klog.h>
+
+/**
+ * Arena Allocator
+ *
+ * Each chunk is a headerless block run from kmalloc_aligned(), so a one-block
+ * chunk costs exactly one heap block:
+ *
+ *   chunk
+ *   ┌──────┬───────┬───────┬─────┬──────────────────┐
+ *   │ next │ obj 1 │ obj 2 │ ... │       free       │
+ *   └──────┴───────┴───────┴─────┴──────────────────┘
+ *                                ↑                  ↑
+ *                                ptr                end
+ */
+
+#define ARENA_ROUND(n, a)   (((n) + (a) - 1) & ~((size_t) (a) - 1))
+
+/**
+ * Allocate a chunk with room for at least 'size' bytes after its header
+ *
+ * @return Chunk, or NULL if out of memory
+ */
+static arena_chunk_t* arena_chunk_alloc(size_t size, size_t* chunk_bytes) {
+    size_t header = ARENA_ROUND(sizeof(arena_chunk_t), ARENA_ALIGN);
+    if (size > SIZE_MAX - header - PAGE_SIZE) {
+        return NULL;
+    }
+    *chunk_bytes = ARENA_ROUND(size + header, PAGE_SIZE);
+    arena_chunk_t* chunk = (arena_chunk_t*) kmalloc_aligned(*chunk_bytes, PAGE_SIZE);
+    if (chunk != NULL) {
+        chunk->next = NULL;
+    }
+    return chunk;
+}
+
+/**
+ * Point the bump region at the free space of a chunk
+ */
+static void arena_use_chunk(arena_t* arena, arena_chunk_t* chunk, size_t chunk_bytes) {
+    arena->ptr = (uint8_t*) chunk + ARENA_ROUND(sizeof(arena_chunk_t), ARENA_ALIGN);
+    arena->end = (uint8_t*) chunk + chunk_bytes;
+}
+
+/**
+ * Initialize an arena with a base chunk
+ */
+int arena_init(arena_t* arena, size_t chunk_size) {
+    size_t chunk_bytes;
+    arena->extra = NULL;
+    arena->last = NULL;
+    arena->base = arena_chunk_alloc(chunk_size, &chunk_bytes);
+    if (arena->base == NULL) {
+        klog(KLOG_ERR, "[FAILED] arena_init: Could not allocate a %zu-byte chunk\n", chunk_size);
+        arena->ptr = arena->end = NULL;
+        return -1;
+    }
+    arena->chunk_size = chunk_bytes;
+    arena_use_chunk(arena, arena->base, chunk_bytes);
+    return 0;
+}
+
+/**
+ * Bump-allocate, adding a chunk when the current one is full
+ */
+void* arena_alloc(arena_t* arena, size_t size) {
+    size = ARENA_ROUND(size, ARENA_ALIGN);
+    if (size == 0 || arena->ptr == NULL) {
+        return NULL;
+    }
+    if (size > (size_t) (arena->end - arena->ptr)) {
+        /* Full: start a new chunk (big requests get a chunk sized to fit) */
+        size_t chunk_bytes;
+        arena_chunk_t* chunk = arena_chunk_alloc(size > arena->chunk_size ? size : arena->chunk_size, &chunk_bytes);
+        if (chunk == NULL) {
+            klog(KLOG_ERR, "[FAILED] arena_alloc: Out of memory! (need %zu bytes)\n", size);
+            return NULL;
+        }
+        chunk->next = arena->extra;
+        arena->extra = chunk;
+        arena_use_chunk(arena, chunk, chunk_bytes);
+    }
+    void* obj = arena->ptr;
+    arena->ptr += size;
+    arena->last = obj;
+    return obj;
+}
+
+/**
+ * Resize in place if ptr is the most recent allocation, else copy
+ */
+void* arena_realloc(arena_t* arena, void* ptr, size_t old_size, size_t size) {
+    if (ptr == NULL) {
+        return arena_alloc(arena, size);
+    }
+    if (ptr == arena->last && size != 0) {
+        size_t rounded = ARENA_ROUND(size, ARENA_ALIGN);
+        if (rounded <= (size_t) (arena->end - (uint8_t*) ptr)) {
+            arena->ptr = (uint8_t*) ptr + rounded;
+            return ptr;
+        }
+    }
+    void* new_ptr = arena_alloc(arena, size);
+    if (new_ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    }
+    return new_ptr;
+}
+
+/**
+ * Drop all allocations, keeping only the base chunk
+ */
+void arena_reset(arena_t* arena) {
+    while (arena->extra != NULL) {
+        arena_chunk_t* next = arena->extra->next;
+        kfree(arena->extra);
+        arena->extra = next;
+    }
+    arena->last = NULL;
+    if (arena->base != NULL) {
+        arena_use_chunk(arena, arena->base, arena->chunk_size);
+    }
+}
+
+/**
+ * Free every chunk of an arena
+ */
+void arena_destroy(arena_t* arena) {
+    arena_reset(arena);
+    kfree(arena->base);
+    arena->base = NULL;
+    arena->ptr = arena->end = NULL;
+}
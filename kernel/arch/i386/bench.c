@@ -0,0 +1,219 @@
+/**
+ * Microbenchmark Harness
+ *
+ * One iteration is measured from the end of one bench_next() call to the
+ * start of the next:
+ *
+ *   bench_next(): stamp → record(stamp - start) → start = stamp → return
+ *   body
+ *   bench_next(): stamp → ...
+ *
+ * so the loop bookkeeping, the call and the stamps fall into every sample.
+ * bench_calibrate() measures exactly that with an empty body (minimum of
+ * BENCH_CALIBRATE_RUNS) and later samples have it subtracted.
+ *
+ * Both stamps use cpuid before rdtsc: cpuid is serializing, so everything
+ * before it has finished and nothing after it has started when the TSC is
+ * read.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <kernel/bench.h>
+#include <kernel/kheap.h>
+#include <kernel/serial.h>
+#include <kernel/klog.h>
+#include <kernel/timer.h>
+#include <kernel/spinlock.h>
+#include <kernel/shell.h>
+
+#include "include/cpuid.h"
+
+#define BENCH_CALIBRATE_RUNS    256
+#define BENCH_SHELL_ITERATIONS  1000    /* Iterations of each "bench" run by default */
+
+static uint32_t bench_overhead = 0;
+static bool bench_calibrated = false;
+static bench_result_t last_result;
+
+/**
+ * Serialized TSC read
+ */
+static inline uint64_t bench_stamp(void) {
+    uint32_t lo, hi;
+    asm volatile("xor %%eax, %%eax\n\t"
+                 "cpuid\n\t"
+                 "rdtsc"
+                 : "=a"(lo), "=d"(hi)
+                 :
+                 : "ebx", "ecx", "memory");
+    return ((uint64_t) hi << 32) | lo;
+}
+
+/**
+ * Sort samples in place (Shell sort, gaps 3k+1: no recursion, no allocation)
+ */
+static void bench_sort(uint32_t* values, uint32_t count) {
+    uint32_t gap = 1;
+    while (gap < count / 3) {
+        gap = gap * 3 + 1;
+    }
+    for (; gap > 0; gap /= 3) {
+        for (uint32_t i = gap; i < count; i++) {
+            uint32_t value = values[i];
+            uint32_t j = i;
+            while (j >= gap && values[j - gap] > value) {
+                values[j] = values[j - gap];
+                j -= gap;
+            }
+            values[j] = value;
+        }
+    }
+}
+
+/**
+ * Measure the harness's own cost per iteration
+ */
+static void bench_calibrate(void) {
+    bench_calibrated = true;  /* Before the run: its samples aren't corrected */
+    bench_t bench = bench_begin(NULL, BENCH_CALIBRATE_RUNS);
+    while (bench_next(&bench)) {
+    }
+    bench_overhead = last_result.min;
+}
+
+/**
+ * Prepare a benchmark
+ */
+bench_t bench_begin(const char* name, uint32_t iterations) {
+    bench_t bench = { .name = name, .iterations = 0, .done = 0, .cycles = NULL, .start = 0, .timing = false };
+    if (!cpuid_has_edx(CPUID_EDX_TSC)) {
+        klog(KLOG_ERR, "[FAILED] bench: %s needs a TSC\n", name ? name : "calibration");
+        return bench;
+    }
+    if (!bench_calibrated) {
+        bench_calibrate();
+    }
+    if (iterations == 0 || iterations > BENCH_MAX_ITERATIONS) {
+        klog(KLOG_ERR, "[FAILED] bench: %s: %u iterations (max %u)\n", name ? name : "calibration", iterations,
+                       BENCH_MAX_ITERATIONS);
+        return bench;
+    }
+    bench.cycles = (uint32_t*) kmalloc(iterations * sizeof(uint32_t));
+    if (bench.cycles == NULL) {
+        klog(KLOG_ERR, "[FAILED] bench: Out of memory for %u samples\n", iterations);
+        return bench;
+    }
+    bench.iterations = iterations;
+    return bench;
+}
+
+/**
+ * Sort the samples, keep the summary and report it
+ */
+static void bench_finish(bench_t* bench) {
+    uint32_t n = bench->iterations;
+    bench_sort(bench->cycles, n);
+    last_result.iterations = n;
+    last_result.min = bench->cycles[0];
+    last_result.median = bench->cycles[(n - 1) / 2];
+    last_result.p99 = bench->cycles[(n - 1) * 99 / 100];
+    last_result.max = bench->cycles[n - 1];
+    kfree(bench->cycles);
+    bench->cycles = NULL;
+    if (bench->name != NULL) {
+        char line[128];
+        snprintf(line, sizeof(line), "BENCH %s iterations=%u min=%u median=%u p99=%u max=%u\n", bench->name, n,
+                 last_result.min, last_result.median, last_result.p99, last_result.max);
+        serial_write_string(SERIAL_COM1_BASE, line);
+    }
+}
+
+/**
+ * End the current iteration and start the next
+ */
+bool bench_next(bench_t* bench) {
+    uint64_t now = bench_stamp();
+    if (bench->timing) {
+        uint64_t cycles = now - bench->start;
+        uint32_t corrected = cycles > bench_overhead ? (uint32_t) (cycles - bench_overhead) : 0;
+        bench->cycles[bench->done++] = corrected;
+    }
+    if (bench->done >= bench->iterations) {
+        if (bench->iterations > 0) {
+            bench_finish(bench);
+        }
+        return false;
+    }
+    bench->timing = true;
+    bench->start = bench_stamp();
+    return true;
+}
+
+/**
+ * Result of the last benchmark that finished
+ */
+bench_result_t bench_last_result(void) {
+    return last_result;
+}
+
+static spinlock_t bench_lock = SPINLOCK_INIT;
+
+static void bench_kmalloc_64(void) {
+    kfree(kmalloc(64));
+}
+
+static void bench_ktime(void) {
+    (void) ktime_ns();
+}
+
+static void bench_spinlock(void) {
+    spin_lock(&bench_lock);
+    spin_unlock(&bench_lock);
+}
+
+/* What the "bench" command times */
+static const struct {
+    const char* name;
+    void (*body)(void);
+} bench_shell_set[] = {
+    { "kmalloc_64", bench_kmalloc_64 },
+    { "ktime_ns", bench_ktime },
+    { "spinlock", bench_spinlock },
+};
+
+/**
+ * Shell command: bench
+ *
+ * Times a few kernel primitives and prints cycles per call (the BENCH
+ * lines go to COM1 as well):
+ *   bench [iterations]   each one 'iterations' times (default BENCH_SHELL_ITERATIONS)
+ *
+ * @param args Command arguments
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(bench, "time kernel primitives in cycles [iterations]") {
+    uint32_t iterations = BENCH_SHELL_ITERATIONS;
+    if (args[1] != NULL && (!shell_parse_uint(args[1], &iterations) || iterations == 0 ||
+                            iterations > BENCH_MAX_ITERATIONS)) {
+        printf("usage: bench [1 - %u]\n", BENCH_MAX_ITERATIONS);
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(bench_shell_set) / sizeof(bench_shell_set[0]); i++) {
+        bench_t bench = bench_begin(bench_shell_set[i].name, iterations);
+        if (bench.iterations == 0) {
+            printf("%s: can't run\n", bench_shell_set[i].name);
+            continue;
+        }
+        while (bench_next(&bench)) {
+            bench_shell_set[i].body();
+        }
+        bench_result_t result = bench_last_result();
+        printf("%s: min %u median %u p99 %u max %u cycles\n", bench_shell_set[i].name, result.min, result.median,
+               result.p99, result.max);
+    }
+    return 1;
+}
@@ -0,0 +1,310 @@
+/**
+ * Block Device Request Queue
+ *
+ * Each device keeps its waiting requests in one list sorted by LBA. With
+ * BLOCK_QUEUE_DEPTH requests at most, a linear walk for merging, insertion
+ * and the elevator's pick is cheaper than any tree.
+ *
+ *   queue:  [lba 8, 8 sectors] → [lba 40, 2] → [lba 100, 16]      head = 60
+ *   submit lba 16, 4 sectors   → back merge:  [lba 8, 12 sectors]
+ *   submit lba 20, 20 sectors  → back merge, then the request reaches 40:
+ *                                the two requests become [lba 8, 34]
+ *   dispatch                   → [lba 100, 16] (first at or after head)
+ *
+ * Merged I/Os stay separate buffers: the driver walks req->first..last,
+ * which maps directly onto a DMA scatter/gather table.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/block.h>
+
+static block_device_t* block_devices = NULL;
+static spinlock_t block_devices_lock = SPINLOCK_INIT;
+
+/**
+ * Register a device
+ */
+int block_register(block_device_t* dev) {
+    if (dev->ops == NULL || dev->ops->start == NULL || dev->max_sectors == 0) {
+        return -1;
+    }
+    spin_lock_init(&dev->lock);
+    dev->queue = NULL;
+    dev->active = NULL;
+    dev->pool = NULL;
+    for (uint32_t i = 0; i < BLOCK_QUEUE_DEPTH; i++) {
+        dev->requests[i].next = dev->pool;
+        dev->pool = &dev->requests[i];
+    }
+    wait_queue_init(&dev->pool_wait);
+    dev->head = 0;
+    memset(&dev->stats, 0, sizeof(dev->stats));
+
+    uint32_t flags = spin_lock_irqsave(&block_devices_lock);
+    for (block_device_t* d = block_devices; d != NULL; d = d->next) {
+        if (strcmp(d->name, dev->name) == 0) {
+            spin_unlock_irqrestore(&block_devices_lock, flags);
+            return -1;
+        }
+    }
+    dev->next = block_devices;
+    block_devices = dev;
+    spin_unlock_irqrestore(&block_devices_lock, flags);
+    return 0;
+}
+
+/**
+ * Find a device by name
+ */
+block_device_t* block_find(const char* name) {
+    uint32_t flags = spin_lock_irqsave(&block_devices_lock);
+    block_device_t* d = block_devices;
+    while (d != NULL && strcmp(d->name, name) != 0) {
+        d = d->next;
+    }
+    spin_unlock_irqrestore(&block_devices_lock, flags);
+    return d;
+}
+
+/**
+ * Device by position
+ */
+block_device_t* block_get(uint32_t index) {
+    uint32_t flags = spin_lock_irqsave(&block_devices_lock);
+    block_device_t* d = block_devices;
+    while (d != NULL && index-- > 0) {
+        d = d->next;
+    }
+    spin_unlock_irqrestore(&block_devices_lock, flags);
+    return d;
+}
+
+/**
+ * Give a request back to the pool (queue lock held)
+ */
+static void request_free(block_device_t* dev, block_request_t* req) {
+    req->next = dev->pool;
+    dev->pool = req;
+    wake_up(&dev->pool_wait);
+}
+
+/**
+ * Let a request absorb the one after it if they now touch (queue lock held)
+ */
+static void request_merge_next(block_device_t* dev, block_request_t* req) {
+    block_request_t* next = req->next;
+    if (next == NULL || next->write != req->write || req->lba + req->count != next->lba ||
+        req->count + next->count > dev->max_sectors) {
+        return;
+    }
+    req->last->next = next->first;
+    req->last = next->last;
+    req->count += next->count;
+    req->next = next->next;
+    request_free(dev, next);
+}
+
+/**
+ * Add an I/O to a queued request it is contiguous with (queue lock held)
+ *
+ * @return true if it was merged
+ */
+static bool queue_merge(block_device_t* dev, block_io_t* io) {
+    for (block_request_t* req = dev->queue; req != NULL; req = req->next) {
+        if (req->write != io->write || req->count + io->count > dev->max_sectors) {
+            continue;
+        }
+        if (req->lba + req->count == io->lba) {
+            req->last->next = io;
+            req->last = io;
+            req->count += io->count;
+            request_merge_next(dev, req);
+            dev->stats.merged++;
+            return true;
+        }
+        if (io->lba + io->count == req->lba) {
+            io->next = req->first;
+            req->first = io;
+            req->lba = io->lba;
+            req->count += io->count;
+            dev->stats.merged++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Insert a request in LBA order (queue lock held)
+ */
+static void queue_insert(block_device_t* dev, block_request_t* req) {
+    block_request_t** link = &dev->queue;
+    while (*link != NULL && (*link)->lba <= req->lba) {
+        link = &(*link)->next;
+    }
+    req->next = *link;
+    *link = req;
+}
+
+/**
+ * Complete every I/O of the request in flight (queue lock held)
+ */
+static void request_finish(block_device_t* dev, int status) {
+    block_request_t* req = dev->active;
+    dev->active = NULL;
+    if (status == 0) {
+        if (req->write) {
+            dev->stats.sectors_written += req->count;
+        }
+        else {
+            dev->stats.sectors_read += req->count;
+        }
+    }
+    block_io_t* io = req->first;
+    while (io != NULL) {
+        block_io_t* next = io->next;    /* done() may free the I/O */
+        if (status != 0) {
+            dev->stats.errors++;
+        }
+        io->status = status;
+        if (io->done != NULL) {
+            io->done(io);
+        }
+        else {
+            wake_up(&io->wait);
+        }
+        io = next;
+    }
+    request_free(dev, req);
+}
+
+/**
+ * Start the elevator's next request if the device is idle (queue lock held)
+ */
+static void queue_dispatch(block_device_t* dev) {
+    while (dev->active == NULL && dev->queue != NULL) {
+        /* C-LOOK: keep sweeping towards higher LBAs, then jump back to the lowest */
+        block_request_t** link = &dev->queue;
+        while (*link != NULL && (*link)->lba < dev->head) {
+            link = &(*link)->next;
+        }
+        if (*link == NULL) {
+            link = &dev->queue;
+        }
+        block_request_t* req = *link;
+        *link = req->next;
+        req->next = NULL;
+        dev->active = req;
+        dev->head = req->lba + req->count;
+        dev->stats.requests++;
+        if (dev->ops->start(dev, req) != 0) {
+            request_finish(dev, -1);
+        }
+    }
+}
+
+/**
+ * Queue an I/O
+ */
+int block_submit(block_device_t* dev, block_io_t* io) {
+    if (io->count == 0 || io->count > dev->max_sectors || io->lba >= dev->sectors ||
+        io->count > dev->sectors - io->lba) {
+        return -1;
+    }
+    io->status = BLOCK_PENDING;
+    io->next = NULL;
+    wait_queue_init(&io->wait);
+
+    uint32_t flags;
+    for (;;) {
+        flags = spin_lock_irqsave(&dev->lock);
+        if (queue_merge(dev, io)) {
+            break;
+        }
+        if (dev->pool != NULL) {
+            block_request_t* req = dev->pool;
+            dev->pool = req->next;
+            req->lba = io->lba;
+            req->count = io->count;
+            req->write = io->write;
+            req->first = io;
+            req->last = io;
+            queue_insert(dev, req);
+            break;
+        }
+        spin_unlock_irqrestore(&dev->lock, flags);
+        wait_event(&dev->pool_wait, __atomic_load_n(&dev->pool, __ATOMIC_ACQUIRE) != NULL);
+    }
+    dev->stats.ios++;
+    queue_dispatch(dev);
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+/**
+ * Sleep until an I/O has completed
+ */
+int block_wait(block_io_t* io) {
+    wait_event(&io->wait, io->status != BLOCK_PENDING);
+    return io->status;
+}
+
+/**
+ * Synchronous transfer, split into requests the driver takes
+ */
+static int block_transfer(block_device_t* dev, uint32_t lba, uint32_t count, void* buffer, bool write) {
+    if (count == 0) {
+        return 0;
+    }
+    uint8_t* pos = (uint8_t*) buffer;
+    while (count > 0) {
+        uint32_t chunk = count < dev->max_sectors ? count : dev->max_sectors;
+        block_io_t io = { .lba = lba, .count = chunk, .buffer = pos, .write = write };
+        if (block_submit(dev, &io) != 0 || block_wait(&io) != 0) {
+            return -1;
+        }
+        lba += chunk;
+        count -= chunk;
+        pos += chunk * BLOCK_SECTOR_SIZE;
+    }
+    return 0;
+}
+
+/**
+ * Read sectors
+ */
+int block_read(block_device_t* dev, uint32_t lba, uint32_t count, void* buffer) {
+    return block_transfer(dev, lba, count, buffer, false);
+}
+
+/**
+ * Write sectors
+ */
+int block_write(block_device_t* dev, uint32_t lba, uint32_t count, const void* buffer) {
+    return block_transfer(dev, lba, count, (void*) buffer, true);
+}
+
+/**
+ * Finish the request in flight and dispatch the next
+ */
+void block_complete(block_device_t* dev, int status) {
+    uint32_t flags = spin_lock_irqsave(&dev->lock);
+    if (dev->active != NULL) {
+        request_finish(dev, status);
+    }
+    queue_dispatch(dev);
+    spin_unlock_irqrestore(&dev->lock, flags);
+}
+
+/**
+ * Get queue statistics
+ */
+void block_get_stats(block_device_t* dev, block_stats_t* stats) {
+    uint32_t flags = spin_lock_irqsave(&dev->lock);
+    *stats = dev->stats;
+    spin_unlock_irqrestore(&dev->lock, flags);
+}
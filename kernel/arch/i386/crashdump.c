@@ -0,0 +1,314 @@
+/**
+ * Binary Crash Dump
+ *
+ * The dump goes out as it is built: each section is written once its
+ * contents are known, and the CRC is updated on the way. For the serial port
+ * the bytes first collect in a staging buffer. It is sent when full, and
+ * with interrupts off serial_write() polls it out a FIFO burst at a time:
+ *
+ *   section → crashdump_put() → CRC-32 → stage (CRASHDUMP_STAGE_SIZE) → serial_write()
+ *                                      → or the caller's buffer (crashdump_capture())
+ *
+ * Only fixed-size data and the kernel's own structures are read, with no
+ * locks taken and no memory allocated, so this works with the heap lock held
+ * or the scheduler broken.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/crashdump.h>
+#include <kernel/debug.h>
+#include <kernel/kheap.h>
+#include <kernel/paging.h>
+#include <kernel/klog.h>
+#include <kernel/serial.h>
+#include <kernel/thread.h>
+#include <kernel/trace.h>
+
+#include "include/interrupts.h"
+#include "include/irqflags.h"
+
+#define CRASHDUMP_STAGE_SIZE    256     /* Bytes collected per serial_write() (16 FIFO bursts) */
+
+/* Where the dump is going */
+typedef struct {
+    uint16_t port;                      /* Serial port, 0 for buf */
+    uint8_t* buf;
+    size_t size;
+    size_t len;                         /* Bytes of the dump so far */
+    size_t staged;                      /* Bytes in crashdump_stage not sent yet */
+    uint32_t crc;
+    bool overflow;                      /* buf was too small */
+} crashdump_out_t;
+
+/* Trace section in progress */
+typedef struct {
+    crashdump_out_t* out;
+    uint32_t skip;                      /* Older records left out */
+    uint32_t left;                      /* Records still to write */
+} crashdump_trace_t;
+
+static uint16_t crashdump_port = 0;
+static bool crashdump_sent = false;
+/* Only the one serial dump ever uses it */
+static uint8_t crashdump_stage[CRASHDUMP_STAGE_SIZE];
+
+/**
+ * Update a CRC-32 (IEEE 802.3, reflected; ~0 before the first byte and after the last)
+ */
+static uint32_t crashdump_crc(uint32_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+/**
+ * Send what is staged
+ */
+static void crashdump_flush(crashdump_out_t* out) {
+    if (out->port != 0 && out->staged > 0) {
+        serial_write(out->port, (const char*) crashdump_stage, out->staged);
+        out->staged = 0;
+    }
+}
+
+/**
+ * Append bytes to the dump
+ */
+static void crashdump_put(crashdump_out_t* out, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*) data;
+    out->crc = crashdump_crc(out->crc, bytes, len);
+    out->len += len;
+    if (out->port == 0) {
+        if (out->overflow || out->len > out->size) {
+            out->overflow = true;
+            return;
+        }
+        memcpy(out->buf + out->len - len, bytes, len);
+        return;
+    }
+    while (len > 0) {
+        size_t n = CRASHDUMP_STAGE_SIZE - out->staged;
+        n = n < len ? n : len;
+        memcpy(crashdump_stage + out->staged, bytes, n);
+        out->staged += n;
+        bytes += n;
+        len -= n;
+        if (out->staged == CRASHDUMP_STAGE_SIZE) {
+            crashdump_flush(out);
+        }
+    }
+}
+
+/**
+ * Start a section
+ */
+static void crashdump_section(crashdump_out_t* out, uint16_t type, uint32_t length) {
+    crashdump_section_t section = { .type = type, .reserved = 0, .length = length };
+    crashdump_put(out, &section, sizeof(section));
+}
+
+/**
+ * Pad a section's payload to a multiple of 4 bytes
+ */
+static void crashdump_pad(crashdump_out_t* out, uint32_t length) {
+    static const uint8_t zero[4] = { 0 };
+    if (length % 4 != 0) {
+        crashdump_put(out, zero, 4 - length % 4);
+    }
+}
+
+/**
+ * Fill in the registers, from a trap frame or from the caller of the public function
+ *
+ * @param frame Caller's frame pointer (its saved EBP and return address)
+ */
+static void crashdump_regs(crashdump_regs_t* out, const regs_t* r, const uint32_t* frame) {
+    memset(out, 0, sizeof(*out));
+    if (r != NULL) {
+        out->ds = r->ds;
+        out->edi = r->edi;
+        out->esi = r->esi;
+        out->ebp = r->ebp;
+        out->esp_dummy = r->esp_dummy;
+        out->ebx = r->ebx;
+        out->edx = r->edx;
+        out->ecx = r->ecx;
+        out->eax = r->eax;
+        out->int_no = r->int_no;
+        out->err_code = r->err_code;
+        out->eip = r->eip;
+        out->cs = r->cs;
+        out->eflags = r->eflags;
+        out->useresp = r->useresp;
+        out->ss = r->ss;
+        /* A ring 0 trap pushes no ESP and SS: the interrupted stack continues where they would be */
+        out->esp = (r->cs & 0x3) == 3 ? r->useresp : (uint32_t) &r->useresp;
+        out->flags = CRASHDUMP_REGS_TRAP;
+    }
+    else {
+        /* As if stopped at the call: the caller's EBP, the return address, ESP above it */
+        out->ebp = frame[0];
+        out->eip = frame[1];
+        out->esp = (uint32_t) (frame + 2);
+        asm volatile("mov %%cs, %0" : "=r"(out->cs));
+        asm volatile("mov %%ds, %0" : "=r"(out->ds));
+        asm volatile("mov %%ss, %0" : "=r"(out->ss));
+        asm volatile("pushf; pop %0" : "=r"(out->eflags));
+    }
+    asm volatile("mov %%cr0, %0" : "=r"(out->cr0));
+    asm volatile("mov %%cr2, %0" : "=r"(out->cr2));
+    asm volatile("mov %%cr3, %0" : "=r"(out->cr3));
+    asm volatile("mov %%cr4, %0" : "=r"(out->cr4));
+    thread_t* self = thread_current();
+    out->thread = self != NULL ? self->id : 0;
+}
+
+static void crashdump_count_record(const trace_record_t* rec, void* ctx) {
+    (void) rec;
+    (void) ctx;
+}
+
+static void crashdump_put_record(const trace_record_t* rec, void* ctx) {
+    crashdump_trace_t* trace = (crashdump_trace_t*) ctx;
+    if (trace->skip > 0) {
+        trace->skip--;
+    }
+    else if (trace->left > 0) {
+        crashdump_put(trace->out, rec, sizeof(*rec));
+        trace->left--;
+    }
+}
+
+/**
+ * Write the whole dump
+ */
+static void crashdump_emit(crashdump_out_t* out, const crashdump_regs_t* regs, const char* reason) {
+    crashdump_header_t header = { .magic = { 0 }, .version = CRASHDUMP_VERSION };
+    memcpy(header.magic, CRASHDUMP_MAGIC, sizeof(header.magic));
+    crashdump_put(out, &header, sizeof(header));
+
+    uint32_t length = (uint32_t) strlen(reason);
+    crashdump_section(out, CRASHDUMP_SECTION_REASON, length);
+    crashdump_put(out, reason, length);
+    crashdump_pad(out, length);
+
+    crashdump_section(out, CRASHDUMP_SECTION_REGS, sizeof(*regs));
+    crashdump_put(out, regs, sizeof(*regs));
+
+    uint32_t pcs[DEBUG_BACKTRACE_MAX];
+    length = (uint32_t) (debug_unwind(regs->ebp, pcs, DEBUG_BACKTRACE_MAX) * sizeof(uint32_t));
+    crashdump_section(out, CRASHDUMP_SECTION_BACKTRACE, length);
+    crashdump_put(out, pcs, length);
+
+    /* Only the running thread's kernel stack: a user ESP or a wild one may point anywhere */
+    uint32_t lo, hi;
+    debug_stack_bounds(&lo, &hi);
+    uint32_t base = regs->esp;
+    uint32_t bytes = base >= lo && base < hi ? hi - base : 0;
+    bytes = bytes < CRASHDUMP_STACK_MAX ? bytes : CRASHDUMP_STACK_MAX;
+    crashdump_section(out, CRASHDUMP_SECTION_STACK, sizeof(base) + bytes);
+    crashdump_put(out, &base, sizeof(base));
+    crashdump_put(out, (const void*) base, bytes);
+    crashdump_pad(out, bytes);
+
+    /* Tracing is off, so both walks see the same records */
+    uint32_t total = (uint32_t) trace_walk(crashdump_count_record, NULL, TRACE_RING_SIZE);
+    uint32_t count = total < CRASHDUMP_TRACE_MAX ? total : CRASHDUMP_TRACE_MAX;
+    crashdump_trace_t trace = { .out = out, .skip = total - count, .left = count };
+    crashdump_section(out, CRASHDUMP_SECTION_TRACE, sizeof(count) + count * sizeof(trace_record_t));
+    crashdump_put(out, &count, sizeof(count));
+    trace_walk(crashdump_put_record, &trace, TRACE_RING_SIZE);
+    static const trace_record_t missing = { 0 };
+    for (; trace.left > 0; trace.left--) {
+        crashdump_put(out, &missing, sizeof(missing));      /* Keeps the length right if records vanished */
+    }
+
+    kheap_info_t heap;
+    kheap_get_info(&heap);
+    crashdump_section(out, CRASHDUMP_SECTION_HEAP, sizeof(heap));
+    crashdump_put(out, &heap, sizeof(heap));
+
+    uint32_t crc = ~out->crc;
+    crashdump_section(out, CRASHDUMP_SECTION_END, sizeof(crc));
+    crashdump_put(out, &crc, sizeof(crc));
+    crashdump_flush(out);
+}
+
+/**
+ * Enable the dump if the command line has the word "crashdump"
+ */
+int crashdump_init(multiboot_info_t* mbi) {
+    if (!(mbi->flags & MULTIBOOT_INFO_CMDLINE) || mbi->cmdline == 0 || mbi->cmdline >= KMEM_MAX) {
+        return 0;
+    }
+    const char* word = (const char*) mbi->cmdline;
+    while (*word != '\0') {
+        while (*word == ' ') {
+            word++;
+        }
+        size_t len = 0;
+        while (word[len] != '\0' && word[len] != ' ') {
+            len++;
+        }
+        if (len == strlen("crashdump") && memcmp(word, "crashdump", len) == 0) {
+            crashdump_enable(SERIAL_COM1_BASE);
+            break;
+        }
+        word += len;
+    }
+    return 0;
+}
+
+/**
+ * Select the dump's serial port
+ */
+void crashdump_enable(uint16_t port) {
+    crashdump_port = port;
+    if (port != 0) {
+        klog(KLOG_INFO, "[  OK  ] crashdump: Crashes are dumped to serial port 0x%x\n", port);
+    }
+}
+
+/**
+ * Send the crash dump once
+ */
+__attribute__((noinline))
+int crashdump_write(const struct regs* regs, const char* reason) {
+    uint32_t flags = irq_save();
+    if (crashdump_port == 0 || __atomic_exchange_n(&crashdump_sent, true, __ATOMIC_ACQ_REL)) {
+        irq_restore(flags);
+        return -1;
+    }
+    trace_stop();
+    crashdump_regs_t frame;
+    crashdump_regs(&frame, regs, (const uint32_t*) __builtin_frame_address(0));
+    crashdump_out_t out = { .port = crashdump_port, .crc = ~0u };
+    crashdump_emit(&out, &frame, reason);
+    irq_restore(flags);
+    return 0;
+}
+
+/**
+ * Build the crash dump in a buffer
+ */
+__attribute__((noinline))
+size_t crashdump_capture(void* buf, size_t size, const struct regs* regs, const char* reason) {
+    uint32_t flags = irq_save();
+    bool was_tracing = trace_enabled;
+    trace_enabled = false;
+    crashdump_regs_t frame;
+    crashdump_regs(&frame, regs, (const uint32_t*) __builtin_frame_address(0));
+    crashdump_out_t out = { .port = 0, .buf = (uint8_t*) buf, .size = size, .crc = ~0u };
+    crashdump_emit(&out, &frame, reason);
+    trace_enabled = was_tracing;
+    irq_restore(flags);
+    return out.overflow ? 0 : out.len;
+}
@@ -6,22 +6,141 @@
 
 #include <kernel/multiboot.h>
 #include <kernel/debug.h>
+#include <kernel/thread.h>
+#include <kernel/spinlock.h>
+#include <kernel/klog.h>
 
 #include "include/elf32.h"
 
-/* Global symbol information */
-static Elf32_Sym_t* symbol_table = NULL;
+/**
+ * Symbol index: the FUNC symbols of .symtab, sorted by address
+ *
+ *   debug_initialize()  compact FUNC symbols into entries, heapsort by start
+ *   debug_find_symbol() binary search for the last start <= addr, then check
+ *                       the address is inside that function
+ *
+ * The entries (12 bytes) are written over the .symtab they are built from
+ * (16-byte symbols), front to back, so the index needs no memory of its own
+ * and is ready before the heap exists. Nothing else reads .symtab.
+ *
+ * Lookups (backtraces on any CPU, from fault handlers too) hold symbol_lock
+ * for reading with interrupts off; building the index holds it for writing.
+ */
+typedef struct {
+    uint32_t start;     /* First byte of the function */
+    uint32_t size;      /* Length in bytes */
+    uint32_t name;      /* Offset of the name in .strtab */
+} symbol_entry_t;
+
+static symbol_entry_t* symbol_index = NULL;
 static size_t symbol_count = 0;
 static const char* string_table = NULL;
 static size_t string_table_size = 0;
 static int debug_initialized = 0;
+static rwlock_t symbol_lock = RWLOCK_INIT;
 
 /* Extern symbol from linker script marking end of kernel sections */
 extern uint32_t _kernel_sections_end;
 
+/* Boot stack (boot.nasm); the boot thread keeps running on it */
+extern uint32_t stack_top;
+#define BOOT_STACK_SIZE     16384
+
 /* For marking the end of all sections. Kernel heap begins above this. */
 uint32_t elf_sections_end = 0;
 
+/**
+ * Restore the heap property below index 'root' (max-heap on start)
+ */
+static void symbol_sift_down(symbol_entry_t* entries, size_t root, size_t count) {
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= count) {
+            return;
+        }
+        if (child + 1 < count && entries[child + 1].start > entries[child].start) {
+            child++;
+        }
+        if (entries[root].start >= entries[child].start) {
+            return;
+        }
+        symbol_entry_t tmp = entries[root];
+        entries[root] = entries[child];
+        entries[child] = tmp;
+        root = child;
+    }
+}
+
+/**
+ * Build the sorted index over the symbol table
+ *
+ * Keeps FUNC symbols with a size and a name inside .strtab; zero-sized ones
+ * (labels) can't contain an address.
+ *
+ * @return Number of entries
+ */
+static size_t symbol_index_build(void* table, size_t count) {
+    const Elf32_Sym_t* symbols = (const Elf32_Sym_t*) table;
+    symbol_entry_t* entries = (symbol_entry_t*) table;
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        /* Copy out first: entry n overlaps symbol i while n == i */
+        Elf32_Sym_t sym = symbols[i];
+        if (ELF32_ST_TYPE(sym.st_info) != ELF_SYM_TYPE_FUNC || sym.st_size == 0 ||
+            sym.st_name >= string_table_size) {
+            continue;
+        }
+        entries[n].start = sym.st_value;
+        entries[n].size = sym.st_size;
+        entries[n].name = sym.st_name;
+        n++;
+    }
+    /* Heapsort: in place, O(n log n), no recursion */
+    for (size_t i = n / 2; i-- > 0;) {
+        symbol_sift_down(entries, i, n);
+    }
+    for (size_t end = n; end > 1; end--) {
+        symbol_entry_t tmp = entries[0];
+        entries[0] = entries[end - 1];
+        entries[end - 1] = tmp;
+        symbol_sift_down(entries, 0, end - 1);
+    }
+    return n;
+}
+
+/**
+ * Find the function containing an address
+ */
+const char* debug_find_symbol(uint32_t addr, uint32_t* base) {
+    uint32_t flags = read_lock_irqsave(&symbol_lock);
+    if (!debug_initialized || symbol_count == 0 || addr < symbol_index[0].start) {
+        read_unlock_irqrestore(&symbol_lock, flags);
+        return NULL;
+    }
+    /* Last entry with start <= addr */
+    size_t lo = 0, hi = symbol_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (symbol_index[mid].start <= addr) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    const symbol_entry_t* entry = &symbol_index[lo];
+    const char* name = NULL;
+    /* Past the end: padding or code without a symbol */
+    if (addr - entry->start < entry->size) {
+        if (base != NULL) {
+            *base = entry->start;
+        }
+        name = string_table + entry->name;
+    }
+    read_unlock_irqrestore(&symbol_lock, flags);
+    return name;
+}
+
 /**
  * Find and return the symbol name for a given memory address
  *
@@ -29,54 +148,51 @@ uint32_t elf_sections_end = 0;
  * @return The symbol name, or "unknown" if not found
  */
 const char* find_symbol_for_address(uint32_t addr) {
-    if (!debug_initialized || !symbol_table || !string_table) {
+    if (!debug_initialized) {
         return "unknown (no symbols)";
     }
+    const char* name = debug_find_symbol(addr, NULL);
+    return name ? name : "unknown";
+}
 
-    /* Search through all symbols for a matching function */
-    for (size_t i = 0; i < symbol_count; ++i) {
-        unsigned char type = ELF32_ST_TYPE(symbol_table[i].st_info);
-        if (type == ELF_SYM_TYPE_FUNC) {
-            /* Calculate the function's address range */
-            uint32_t sym_start = symbol_table[i].st_value;
-            uint32_t sym_size = symbol_table[i].st_size;
-            /* Check if our address is within this function's range */
-            if (addr >= sym_start && addr <= sym_start + sym_size) {
-                return string_table + symbol_table[i].st_name;
-            }
-        }
+/**
+ * Bounds of the stack the CPU is running on
+ */
+void debug_stack_bounds(uint32_t* lo, uint32_t* hi) {
+    thread_t* thread = thread_current();
+    if (thread != NULL && thread->stack != NULL) {
+        *lo = (uint32_t) thread->stack;
+        *hi = *lo + THREAD_STACK_SIZE;
+    }
+    else {
+        *hi = (uint32_t) &stack_top;
+        *lo = *hi - BOOT_STACK_SIZE;
     }
-
-    return "unknown";
 }
 
 /**
- * Get the base address of the function containing the given address
+ * Walk the frame pointer chain
  *
- * @param addr The address to find the function for
- * @return The function's base address, or 0 if not found
+ *   [ebp]     caller's ebp  ─┐
+ *   [ebp + 4] return address │ one entry per frame
+ *                            ▼
+ * Every frame must lie on the current stack and above the previous one, so a
+ * corrupt chain ends the walk instead of faulting (it runs in IRQ context for
+ * the profiler) and cycles are impossible.
  */
-static uint32_t get_function_base_address(uint32_t addr) {
-    if (!debug_initialized || !symbol_table || !string_table) {
-        return 0;
-    }
-
-    /* Search through all symbols for a matching function */
-    for (size_t i = 0; i < symbol_count; ++i) {
-        /* Only consider symbols that are functions */
-        unsigned char type = ELF32_ST_TYPE(symbol_table[i].st_info);
-        if (type == ELF_SYM_TYPE_FUNC) {
-            /* Calculate the function's address range */
-            uint32_t sym_start = symbol_table[i].st_value;
-            uint32_t sym_size = symbol_table[i].st_size;
-            /* Check if our address is within this function's range */
-            if (addr >= sym_start && addr <= sym_start + sym_size) {
-                return sym_start;
-            }
+size_t debug_unwind(uint32_t ebp, uint32_t* pcs, size_t max) {
+    uint32_t lo, hi;
+    debug_stack_bounds(&lo, &hi);
+    size_t count = 0;
+    while (count < max && ebp >= lo && ebp <= hi - 2 * sizeof(uint32_t) && (ebp & 3) == 0) {
+        const uint32_t* frame = (const uint32_t*) ebp;
+        pcs[count++] = frame[1];
+        if (frame[0] <= ebp) {
+            break;  /* Outermost frame (ebp 0) or a broken chain */
         }
+        ebp = frame[0];
     }
-
-    return 0;
+    return count;
 }
 
 /**
@@ -84,50 +200,36 @@ static uint32_t get_function_base_address(uint32_t addr) {
  */
 void print_backtrace(void) {
     /* Get the current frame pointer */
-    uint32_t* frame_ptr;
-    asm volatile ("movl %%ebp, %0" : "=r" (frame_ptr));
+    uint32_t ebp;
+    asm volatile ("movl %%ebp, %0" : "=r" (ebp));
 
     printf("Stack backtrace:\n");
-    uint32_t frame_count = 0;
+    uint32_t pcs[DEBUG_BACKTRACE_MAX];
+    size_t frame_count = debug_unwind(ebp, pcs, DEBUG_BACKTRACE_MAX);
 
-    /* Track addresses to detect cycles */
-    uint32_t prev_return_addr = 0;
-    /* Reasonable limit to prevent infinite loops */
-    uint32_t max_frames = 32;
-
-    while (frame_ptr != NULL && frame_count < max_frames) {
-        /* Get return address from stack frame */
-        uint32_t return_addr = *(frame_ptr + 1);
-
-        /* Check for repeated addresses indicating a cycle */
-        if (return_addr == prev_return_addr) {
-            printf("  [!] Cyclic backtrace detected\n");
-            break;
-        }
-        prev_return_addr = return_addr;
-
-        /* Look up function information */
-        const char* func_name = find_symbol_for_address(return_addr);
-        uint32_t func_base = get_function_base_address(return_addr);
+    for (size_t i = 0; i < frame_count; i++) {
+        uint32_t return_addr = pcs[i];
+        /*
+         * Look up the call instruction (one byte back): after a call to a
+         * noreturn function the return address is already past the caller's end
+         */
+        uint32_t func_base = 0;
+        const char* func_name = debug_find_symbol(return_addr - 1, &func_base);
 
         /* Format the output differently based on whether we found a symbol */
-        if (func_base != 0) {
+        if (func_name != NULL) {
             uint32_t offset = return_addr - func_base;
-            printf("  [%d] %s+0x%x (%p)\n", frame_count, func_name, offset, return_addr);
+            printf("  [%d] %s+0x%x (%p)\n", i, func_name, offset, return_addr);
         }
         else {
-            printf("  [%d] %s (%p)\n", frame_count, func_name, return_addr);
+            printf("  [%d] %s (%p)\n", i, debug_initialized ? "unknown" : "unknown (no symbols)", return_addr);
         }
-
-        /* Move to previous frame */
-        frame_ptr = (uint32_t*) *frame_ptr;
-        frame_count++;
     }
 
     if (frame_count == 0) {
         printf("[FAILED] print_backtrace: No stack frames found\n");
     }
-    else if (frame_count >= max_frames) {
+    else if (frame_count >= DEBUG_BACKTRACE_MAX) {
         printf("[FAILED] print_backtrace: Maximum backtrace depth reached\n");
     }
 }
@@ -159,7 +261,7 @@ static Elf32_Shdr_t* find_section(Elf32_Shdr_t *sht, size_t sht_len, const char
 void debug_initialize(multiboot_info_t *mbi) {
     /* Check if multiboot has ELF section information */
     if (!(mbi->flags & MULTIBOOT_INFO_ELF_SHDR)) {
-        printf("[FAILED] No ELF section information available\n");
+        klog(KLOG_ERR, "[FAILED] No ELF section information available\n");
         return;
     }
 
@@ -169,31 +271,33 @@ void debug_initialize(multiboot_info_t *mbi) {
 
     /* Make sure the section header string index is valid */
     if (mbi->u.elf_sec.shndx >= sht_len) {
-        printf("[FAILED] debug_initialize: Invalid section header string index\n");
+        klog(KLOG_ERR, "[FAILED] debug_initialize: Invalid section header string index\n");
         return;
     }
 
     /* Get the section header string table */
     const char* sh_names = (const char*) sht[mbi->u.elf_sec.shndx].sh_addr;
 
-    /* Find the symbol table */
-    Elf32_Shdr_t* symtab_hdr = find_section(sht, sht_len, sh_names, ".symtab");
-    if (symtab_hdr) {
-        symbol_table = (Elf32_Sym_t*) symtab_hdr->sh_addr;
-        symbol_count = symtab_hdr->sh_size / sizeof(Elf32_Sym_t);
-    }
-    else {
-        printf("[FAILED] debug_initialize: Symbol table not found\n");
-    }
-
-    /* Find the string table */
+    /* Find the string table (first: the index checks names against its size) */
     Elf32_Shdr_t* strtab_hdr = find_section(sht, sht_len, sh_names, ".strtab");
     if (strtab_hdr) {
         string_table = (const char*) strtab_hdr->sh_addr;
         string_table_size = strtab_hdr->sh_size;
     }
     else {
-        printf("[FAILED] debug_initialize: String table not found\n");
+        klog(KLOG_ERR, "[FAILED] debug_initialize: String table not found\n");
+    }
+
+    /* Find the symbol table and turn it into the sorted index */
+    Elf32_Shdr_t* symtab_hdr = find_section(sht, sht_len, sh_names, ".symtab");
+    if (symtab_hdr && string_table) {
+        uint32_t flags = write_lock_irqsave(&symbol_lock);
+        symbol_index = (symbol_entry_t*) symtab_hdr->sh_addr;
+        symbol_count = symbol_index_build((void*) symtab_hdr->sh_addr, symtab_hdr->sh_size / sizeof(Elf32_Sym_t));
+        write_unlock_irqrestore(&symbol_lock, flags);
+    }
+    else if (!symtab_hdr) {
+        klog(KLOG_ERR, "[FAILED] debug_initialize: Symbol table not found\n");
     }
 
     /* Calculate the end of all ELF sections (for kernel heap) */
@@ -208,13 +312,13 @@ void debug_initialize(multiboot_info_t *mbi) {
     elf_sections_end = (max_addr + 0xFFF) & ~0xFFF;
 
     /* Set initialization flag if we found both tables */
-    if (symbol_table && string_table) {
+    if (symbol_index && string_table) {
         debug_initialized = 1;
-        printf("[INFO] Symbol tables initialized (%zu symbols available)\n", symbol_count);
-        printf("[INFO] Kernel sections end at %p\n", elf_sections_end);
+        klog(KLOG_INFO, "[INFO] Symbol tables initialized (%zu functions indexed)\n", symbol_count);
+        klog(KLOG_INFO, "[INFO] Kernel sections end at %p\n", elf_sections_end);
     }
     else {
-        printf("[FAILED] debug_initialize: Symbol information incomplete (symtab: %p, strtab: %p)\n",
-				symbol_table, string_table);
+        klog(KLOG_ERR, "[FAILED] debug_initialize: Symbol information incomplete (symtab: %p, strtab: %p)\n",
+				symbol_index, string_table);
     }
 }
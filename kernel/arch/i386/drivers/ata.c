@@ -0,0 +1,549 @@
+// Reference: https://wiki.osdev.org/ATA_PIO_Mode, https://wiki.osdev.org/ATA/ATAPI_using_DMA
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/ata.h>
+#include <kernel/block.h>
+#include <kernel/pci.h>
+#include <kernel/paging.h>
+#include <kernel/spinlock.h>
+#include <kernel/klog.h>
+
+#include "../include/io.h"
+#include "../include/irq.h"
+#include "../include/interrupts.h"
+
+/* Legacy (compatibility mode) channel resources */
+#define ATA_PRIMARY_IO          0x1F0
+#define ATA_PRIMARY_CTRL        0x3F6
+#define ATA_PRIMARY_IRQ         14
+#define ATA_SECONDARY_IO        0x170
+#define ATA_SECONDARY_CTRL      0x376
+#define ATA_SECONDARY_IRQ       15
+
+/* Task file registers, offsets from the I/O base */
+#define ATA_REG_DATA            0
+#define ATA_REG_ERROR           1
+#define ATA_REG_SECCOUNT        2
+#define ATA_REG_LBA_LO          3
+#define ATA_REG_LBA_MID         4
+#define ATA_REG_LBA_HI          5
+#define ATA_REG_DRIVE           6
+#define ATA_REG_STATUS          7       /* Read: status, clears a pending IRQ */
+#define ATA_REG_COMMAND         7       /* Write */
+
+/* Control block: alternate status on read (no IRQ side effect), device control on write */
+#define ATA_CTRL_NIEN           0x02    /* Drive doesn't raise INTRQ */
+
+#define ATA_SR_ERR              0x01
+#define ATA_SR_DRQ              0x08
+#define ATA_SR_DF               0x20
+#define ATA_SR_BSY              0x80
+
+#define ATA_CMD_READ_SECTORS    0x20
+#define ATA_CMD_WRITE_SECTORS   0x30
+#define ATA_CMD_READ_DMA        0xC8
+#define ATA_CMD_WRITE_DMA       0xCA
+#define ATA_CMD_IDENTIFY        0xEC
+
+#define ATA_DRIVE_LBA           0xE0    /* LBA addressing, bits 5 and 7 set for old drives */
+#define ATA_ID_DMA              0x0100  /* IDENTIFY word 49: DMA supported */
+
+/* Bus master IDE registers (PCI BAR4; the secondary channel's are 8 ports up) */
+#define BM_REG_COMMAND          0
+#define BM_REG_STATUS           2
+#define BM_REG_PRDT             4
+#define BM_CMD_START            0x01
+#define BM_CMD_READ             0x08    /* Device to memory */
+#define BM_SR_ERR               0x02
+#define BM_SR_IRQ               0x04
+
+#define PCI_CLASS_STORAGE       0x01
+#define PCI_SUBCLASS_IDE        0x01
+#define PCI_IDE_NATIVE_PRIMARY  0x01    /* prog_if: primary channel uses BAR0/BAR1 */
+#define PCI_IDE_NATIVE_SECOND   0x04    /* prog_if: secondary channel uses BAR2/BAR3 */
+
+#define ATA_TIMEOUT             100000  /* Status polls before giving up (~100 ms) */
+#define ATA_PRD_EOT             0x8000  /* Last entry of the table */
+
+typedef struct {
+    uint32_t phys;
+    uint16_t bytes;                     /* 0 means 64 KiB */
+    uint16_t flags;
+} __attribute__((packed)) ata_prd_t;
+
+typedef struct ata_channel ata_channel_t;
+
+typedef struct {
+    block_device_t dev;
+    ata_channel_t* chan;
+    uint8_t slave;
+    bool dma;                           /* Drive does DMA and the channel has a bus master */
+    bool present;
+    char model[41];
+
+    /* Transfer in progress (channel lock) */
+    block_request_t* req;
+    bool using_dma;
+    block_io_t* io;                     /* PIO: I/O the next sector belongs to */
+    uint32_t io_sector;                 /* ... and its index in it */
+    uint32_t left;                      /* PIO sectors still to move */
+
+    ata_stats_t stats;
+} ata_drive_t;
+
+struct ata_channel {
+    uint16_t io;
+    uint16_t ctrl;
+    uint16_t bmide;                     /* Bus master base, 0 without one */
+    uint8_t irq;
+    spinlock_t lock;
+    ata_drive_t* current;               /* Drive whose command is in flight */
+    ata_drive_t* deferred;              /* Drive waiting for the channel */
+    ata_prd_t* prdt;
+    uint32_t prdt_phys;
+    ata_drive_t drives[2];
+};
+
+static ata_channel_t ata_channels[2];
+
+static int ata_start(block_device_t* dev, block_request_t* req);
+
+static const block_ops_t ata_block_ops = {
+    .start = ata_start,
+};
+
+static inline uint8_t ata_status(ata_channel_t* chan) {
+    return inb(chan->io + ATA_REG_STATUS);
+}
+
+/**
+ * Wait about 400 ns (four alternate status reads) after selecting a drive
+ */
+static inline void ata_delay(ata_channel_t* chan) {
+    for (int i = 0; i < 4; i++) {
+        inb(chan->ctrl);
+    }
+}
+
+/**
+ * Wait until the drive is no longer busy
+ *
+ * @return Last status, or -1 on timeout
+ */
+static int ata_wait_ready(ata_channel_t* chan) {
+    for (uint32_t i = 0; i < ATA_TIMEOUT; i++) {
+        uint8_t status = inb(chan->ctrl);
+        if (!(status & ATA_SR_BSY)) {
+            return status;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Wait until the drive wants data moved (DRQ) or reports an error
+ *
+ * @return 0 when DRQ is set, -1 on error or timeout
+ */
+static int ata_wait_drq(ata_channel_t* chan) {
+    for (uint32_t i = 0; i < ATA_TIMEOUT; i++) {
+        uint8_t status = inb(chan->ctrl);
+        if (status & ATA_SR_BSY) {
+            continue;
+        }
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+            return -1;
+        }
+        if (status & ATA_SR_DRQ) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Describe a request's buffers in the channel's PRD table
+ *
+ * Pages are translated one at a time; neighbours that are physically
+ * contiguous share an entry as long as it stays inside one 64 KiB region.
+ *
+ * @return 0 on success, -1 if a buffer can't be used for DMA (odd address, unmapped, too many pieces)
+ */
+static int ata_build_prdt(ata_channel_t* chan, block_request_t* req) {
+    uint32_t entries = 0;
+    uint32_t start = 0;                 /* Physical start and length of the entry being built */
+    uint32_t len = 0;
+    for (block_io_t* io = req->first; io != NULL; io = io->next) {
+        uint32_t virt = (uint32_t) io->buffer;
+        uint32_t left = io->count * BLOCK_SECTOR_SIZE;
+        if (virt & 1) {
+            return -1;
+        }
+        while (left > 0) {
+            uint32_t in_page = PAGE_SIZE - (virt & (PAGE_SIZE - 1));
+            uint32_t chunk = left < in_page ? left : in_page;
+            uint32_t phys = paging_virt_to_phys(virt);
+            if (phys == 0) {
+                return -1;
+            }
+            if (len > 0 && start + len == phys && (start >> 16) == ((phys + chunk - 1) >> 16)) {
+                len += chunk;
+            }
+            else {
+                if (len > 0) {
+                    chan->prdt[entries - 1].bytes = (uint16_t) len;
+                }
+                if (entries == ATA_PRD_MAX) {
+                    return -1;
+                }
+                chan->prdt[entries].phys = phys;
+                chan->prdt[entries].flags = 0;
+                entries++;
+                start = phys;
+                len = chunk;
+            }
+            virt += chunk;
+            left -= chunk;
+        }
+    }
+    chan->prdt[entries - 1].bytes = (uint16_t) len;     /* 64 KiB wraps to 0, as the format wants */
+    chan->prdt[entries - 1].flags = ATA_PRD_EOT;
+    return 0;
+}
+
+/**
+ * Load the task file and send a read or write command (channel lock held)
+ */
+static int ata_command(ata_drive_t* drive, block_request_t* req, uint8_t command) {
+    ata_channel_t* chan = drive->chan;
+    outb(chan->io + ATA_REG_DRIVE, (uint8_t) (ATA_DRIVE_LBA | (drive->slave << 4) | ((req->lba >> 24) & 0x0F)));
+    ata_delay(chan);
+    if (ata_wait_ready(chan) < 0) {
+        return -1;
+    }
+    outb(chan->io + ATA_REG_SECCOUNT, (uint8_t) req->count);    /* 256 → 0 */
+    outb(chan->io + ATA_REG_LBA_LO, (uint8_t) req->lba);
+    outb(chan->io + ATA_REG_LBA_MID, (uint8_t) (req->lba >> 8));
+    outb(chan->io + ATA_REG_LBA_HI, (uint8_t) (req->lba >> 16));
+    outb(chan->io + ATA_REG_COMMAND, command);
+    return 0;
+}
+
+/**
+ * Start a drive's request on its (idle) channel (channel lock held)
+ */
+static int ata_issue(ata_drive_t* drive) {
+    ata_channel_t* chan = drive->chan;
+    block_request_t* req = drive->req;
+    chan->current = drive;
+    drive->using_dma = drive->dma && ata_build_prdt(chan, req) == 0;
+    if (drive->using_dma) {
+        uint16_t bm = chan->bmide;
+        outb(bm + BM_REG_COMMAND, 0);
+        outl(bm + BM_REG_PRDT, chan->prdt_phys);
+        outb(bm + BM_REG_STATUS, BM_SR_IRQ | BM_SR_ERR);       /* Write 1 to clear */
+        outb(bm + BM_REG_COMMAND, req->write ? 0 : BM_CMD_READ);
+        if (ata_command(drive, req, req->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA) != 0) {
+            chan->current = NULL;
+            return -1;
+        }
+        outb(bm + BM_REG_COMMAND, (uint8_t) ((req->write ? 0 : BM_CMD_READ) | BM_CMD_START));
+        drive->stats.dma_requests++;
+        return 0;
+    }
+
+    drive->io = req->first;
+    drive->io_sector = 0;
+    drive->left = req->count;
+    if (ata_command(drive, req, req->write ? ATA_CMD_WRITE_SECTORS : ATA_CMD_READ_SECTORS) != 0) {
+        chan->current = NULL;
+        return -1;
+    }
+    drive->stats.pio_requests++;
+    if (req->write) {
+        /* The drive asks for the first sector without an interrupt */
+        if (ata_wait_drq(chan) != 0) {
+            chan->current = NULL;
+            return -1;
+        }
+        outsw(chan->io + ATA_REG_DATA, drive->io->buffer, BLOCK_SECTOR_SIZE / 2);
+        drive->io_sector++;
+        drive->left--;
+    }
+    return 0;
+}
+
+/**
+ * Block layer entry: run the request now, or after the other drive's one
+ */
+static int ata_start(block_device_t* dev, block_request_t* req) {
+    ata_drive_t* drive = (ata_drive_t*) dev->priv;
+    ata_channel_t* chan = drive->chan;
+    spin_lock(&chan->lock);
+    drive->req = req;
+    int result = 0;
+    if (chan->current != NULL) {
+        chan->deferred = drive;
+    }
+    else {
+        result = ata_issue(drive);
+    }
+    spin_unlock(&chan->lock);
+    return result;
+}
+
+/**
+ * Buffer of the next PIO sector; steps to the next I/O when one is full
+ */
+static void* ata_pio_next(ata_drive_t* drive) {
+    if (drive->io_sector == drive->io->count) {
+        drive->io = drive->io->next;
+        drive->io_sector = 0;
+    }
+    return (uint8_t*) drive->io->buffer + drive->io_sector++ * BLOCK_SECTOR_SIZE;
+}
+
+/**
+ * Advance a PIO transfer by one interrupt
+ *
+ * @return 1 when finished, -1 on a drive error, 0 while sectors are left
+ */
+static int ata_pio_irq(ata_drive_t* drive, uint8_t status) {
+    ata_channel_t* chan = drive->chan;
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+        return -1;
+    }
+    if (!drive->req->write) {
+        if (!(status & ATA_SR_DRQ)) {
+            return -1;
+        }
+        insw(chan->io + ATA_REG_DATA, ata_pio_next(drive), BLOCK_SECTOR_SIZE / 2);
+        return --drive->left == 0 ? 1 : 0;
+    }
+    /* This interrupt acknowledges the sector written last */
+    if (drive->left == 0) {
+        return 1;
+    }
+    if (!(status & ATA_SR_DRQ)) {
+        return -1;
+    }
+    outsw(chan->io + ATA_REG_DATA, ata_pio_next(drive), BLOCK_SECTOR_SIZE / 2);
+    drive->left--;
+    return 0;
+}
+
+/**
+ * Channel interrupt: move PIO data or finish a DMA, then complete the request
+ */
+static void ata_channel_irq(ata_channel_t* chan) {
+    spin_lock(&chan->lock);
+    ata_drive_t* drive = chan->current;
+    if (drive == NULL) {
+        ata_status(chan);               /* Not expected: acknowledge and drop it */
+        spin_unlock(&chan->lock);
+        return;
+    }
+    int result;
+    if (drive->using_dma) {
+        uint8_t bm = inb(chan->bmide + BM_REG_STATUS);
+        if (!(bm & BM_SR_IRQ)) {
+            spin_unlock(&chan->lock);   /* Raised by something else on a shared line */
+            return;
+        }
+        outb(chan->bmide + BM_REG_COMMAND, 0);
+        uint8_t status = ata_status(chan);
+        outb(chan->bmide + BM_REG_STATUS, BM_SR_IRQ | BM_SR_ERR);
+        result = (bm & BM_SR_ERR) || (status & (ATA_SR_ERR | ATA_SR_DF)) ? -1 : 1;
+    }
+    else {
+        uint8_t status = ata_status(chan);
+        if (status & ATA_SR_BSY) {
+            spin_unlock(&chan->lock);
+            return;
+        }
+        result = ata_pio_irq(drive, status);
+    }
+    drive->stats.interrupts++;
+    if (result == 0) {
+        spin_unlock(&chan->lock);
+        return;
+    }
+
+    /* The channel is free: let the other drive have it before this one queues more */
+    chan->current = NULL;
+    ata_drive_t* next = chan->deferred;
+    chan->deferred = NULL;
+    int next_result = next != NULL ? ata_issue(next) : 0;
+    spin_unlock(&chan->lock);
+
+    block_complete(&drive->dev, result > 0 ? 0 : -1);
+    if (next_result != 0) {
+        block_complete(&next->dev, -1);
+    }
+}
+
+static void ata_primary_irq(regs_t* r) {
+    (void) r;
+    ata_channel_irq(&ata_channels[0]);
+}
+
+static void ata_secondary_irq(regs_t* r) {
+    (void) r;
+    ata_channel_irq(&ata_channels[1]);
+}
+
+/**
+ * Copy an IDENTIFY string (byte-swapped words, space padded)
+ */
+static void ata_id_string(char* out, const uint16_t* words, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i * 2] = (char) (words[i] >> 8);
+        out[i * 2 + 1] = (char) words[i];
+    }
+    size_t len = count * 2;
+    while (len > 0 && out[len - 1] == ' ') {
+        len--;
+    }
+    out[len] = '\0';
+}
+
+/**
+ * Send IDENTIFY to a drive (interrupts off at the drive)
+ *
+ * @return 0 with the 256 words in id, -1 if there is no ATA drive there
+ */
+static int ata_identify(ata_channel_t* chan, uint8_t slave, uint16_t* id) {
+    outb(chan->io + ATA_REG_DRIVE, (uint8_t) (0xA0 | (slave << 4)));
+    ata_delay(chan);
+    outb(chan->io + ATA_REG_SECCOUNT, 0);
+    outb(chan->io + ATA_REG_LBA_LO, 0);
+    outb(chan->io + ATA_REG_LBA_MID, 0);
+    outb(chan->io + ATA_REG_LBA_HI, 0);
+    outb(chan->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    if (ata_status(chan) == 0 || ata_wait_ready(chan) < 0) {
+        return -1;
+    }
+    /* ATAPI and SATA devices put their signature here and abort the command */
+    if (inb(chan->io + ATA_REG_LBA_MID) != 0 || inb(chan->io + ATA_REG_LBA_HI) != 0) {
+        return -1;
+    }
+    if (ata_wait_drq(chan) != 0) {
+        return -1;
+    }
+    insw(chan->io + ATA_REG_DATA, id, 256);
+    return 0;
+}
+
+/**
+ * Probe a channel's drives and register those that answer
+ */
+static void ata_probe_channel(uint32_t index) {
+    static uint16_t id[256];
+    ata_channel_t* chan = &ata_channels[index];
+    spin_lock_init(&chan->lock);
+    if (inb(chan->io + ATA_REG_STATUS) == 0xFF) {
+        return;     /* Floating bus: nothing attached */
+    }
+    outb(chan->ctrl, ATA_CTRL_NIEN);
+    bool found = false;
+    for (uint8_t slave = 0; slave < 2; slave++) {
+        ata_drive_t* drive = &chan->drives[slave];
+        if (ata_identify(chan, slave, id) != 0) {
+            continue;
+        }
+        drive->chan = chan;
+        drive->slave = slave;
+        drive->dma = chan->bmide != 0 && chan->prdt != NULL && (id[49] & ATA_ID_DMA);
+        ata_id_string(drive->model, &id[27], 20);
+        drive->dev.name[0] = 'h';
+        drive->dev.name[1] = 'd';
+        drive->dev.name[2] = (char) ('a' + index * 2 + slave);
+        drive->dev.name[3] = '\0';
+        drive->dev.sectors = (uint32_t) id[60] | ((uint32_t) id[61] << 16);
+        drive->dev.max_sectors = ATA_MAX_SECTORS;
+        drive->dev.ops = &ata_block_ops;
+        drive->dev.priv = drive;
+        if (drive->dev.sectors == 0 || block_register(&drive->dev) != 0) {
+            continue;
+        }
+        drive->present = true;
+        found = true;
+        klog(KLOG_INFO, "[  OK  ] ata: %s is '%s', %u MiB (%s)\n", drive->dev.name, drive->model,
+             drive->dev.sectors / (1024 * 1024 / BLOCK_SECTOR_SIZE), drive->dma ? "DMA" : "PIO");
+    }
+    if (found) {
+        reqister_irq(chan->irq, index == 0 ? ata_primary_irq : ata_secondary_irq);
+    }
+    /* Leave a pending INTRQ from probing behind before letting the drives interrupt */
+    ata_status(chan);
+    outb(chan->ctrl, 0);
+}
+
+/**
+ * Probe the IDE controller and its drives
+ */
+int ata_init(void) {
+    ata_channels[0].io = ATA_PRIMARY_IO;
+    ata_channels[0].ctrl = ATA_PRIMARY_CTRL;
+    ata_channels[0].irq = ATA_PRIMARY_IRQ;
+    ata_channels[1].io = ATA_SECONDARY_IO;
+    ata_channels[1].ctrl = ATA_SECONDARY_CTRL;
+    ata_channels[1].irq = ATA_SECONDARY_IRQ;
+
+    pci_device_t pci;
+    if (pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, 0, &pci) == 0) {
+        /* A channel in native mode has its own ports and the controller's PCI IRQ */
+        if (pci.prog_if & PCI_IDE_NATIVE_PRIMARY) {
+            ata_channels[0].io = (uint16_t) pci_bar_address(&pci, 0);
+            ata_channels[0].ctrl = (uint16_t) (pci_bar_address(&pci, 1) + 2);
+            ata_channels[0].irq = pci.irq_line;
+        }
+        if (pci.prog_if & PCI_IDE_NATIVE_SECOND) {
+            ata_channels[1].io = (uint16_t) pci_bar_address(&pci, 2);
+            ata_channels[1].ctrl = (uint16_t) (pci_bar_address(&pci, 3) + 2);
+            ata_channels[1].irq = pci.irq_line;
+        }
+        uint32_t bmide = (pci.bar[4] & PCI_BAR_IO) ? pci_bar_address(&pci, 4) : 0;
+        if (bmide != 0) {
+            pci_enable_bus_master(&pci);
+            for (uint32_t i = 0; i < 2; i++) {
+                uint32_t frame = frame_alloc();
+                void* prdt = frame != 0 ? paging_map_physical(frame, PAGE_SIZE, PTE_WRITABLE) : NULL;
+                if (prdt == NULL) {
+                    klog(KLOG_WARN, "ata: No memory for a PRD table, channel %u uses PIO\n", i);
+                    continue;
+                }
+                ata_channels[i].bmide = (uint16_t) (bmide + i * 8);
+                ata_channels[i].prdt = (ata_prd_t*) prdt;
+                ata_channels[i].prdt_phys = frame;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 2; i++) {
+        ata_probe_channel(i);
+    }
+    return 0;
+}
+
+/**
+ * Get a drive's transfer statistics
+ */
+int ata_get_stats(block_device_t* dev, ata_stats_t* stats) {
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t slave = 0; slave < 2; slave++) {
+            ata_drive_t* drive = &ata_channels[i].drives[slave];
+            if (drive->present && &drive->dev == dev) {
+                ata_channel_t* chan = drive->chan;
+                uint32_t flags = spin_lock_irqsave(&chan->lock);
+                *stats = drive->stats;
+                spin_unlock_irqrestore(&chan->lock, flags);
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
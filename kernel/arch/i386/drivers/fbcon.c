@@ -0,0 +1,251 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/fbcon.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/klog.h>
+
+#include "../include/vga.h"
+#include "../include/irqflags.h"
+
+/* The 16 text mode colors as 0xRRGGBB */
+static const uint32_t vga_palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+/* Glyphs of one color attribute, expanded to framebuffer pixels on first use */
+typedef struct {
+    uint32_t* pixels;                   /* 256 glyphs of fbcon_glyph_words words */
+    uint32_t valid[256 / 32];           /* Bit per character: pixels are rendered */
+    uint32_t last_use;                  /* fbcon_tick of the last span that used it */
+    uint8_t attr;
+    bool used;
+} glyph_cache_t;
+
+static bool fbcon_enabled = false;
+static uint8_t* fbcon_base;
+static uint32_t fbcon_pitch;
+static uint32_t fbcon_bytes_pp;
+/* One pixel row of a glyph in 32-bit words: 8 px * 2, 3 or 4 bytes is 4, 6 or 8 words */
+static uint32_t fbcon_row_words;
+static uint32_t fbcon_glyph_words;
+/* Palette in the framebuffer's pixel format */
+static uint32_t fbcon_colors[16];
+
+static glyph_cache_t fbcon_caches[FBCON_GLYPH_CACHES];
+/* Slot of each attribute, -1 if it has none */
+static int8_t fbcon_cache_of[256];
+static uint32_t fbcon_tick;
+/* Glyphs of the span being drawn (callers are serialized) */
+static const uint32_t* fbcon_span[CONSOLE_MAX_COLS];
+
+static fbcon_stats_t fbcon_stats;
+
+/**
+ * Convert 0xRRGGBB to the framebuffer's pixel format
+ */
+static uint32_t fbcon_pixel(const multiboot_info_t* mbi, uint32_t rgb) {
+    uint8_t r = (uint8_t) (rgb >> 16), g = (uint8_t) (rgb >> 8), b = (uint8_t) rgb;
+    return (uint32_t) (r >> (8 - mbi->framebuffer_red_mask_size)) << mbi->framebuffer_red_field_position |
+           (uint32_t) (g >> (8 - mbi->framebuffer_green_mask_size)) << mbi->framebuffer_green_field_position |
+           (uint32_t) (b >> (8 - mbi->framebuffer_blue_mask_size)) << mbi->framebuffer_blue_field_position;
+}
+
+/**
+ * Store one pixel (little-endian, fbcon_bytes_pp bytes)
+ */
+static inline void fbcon_put_pixel(uint8_t* p, uint32_t value) {
+    for (uint32_t i = 0; i < fbcon_bytes_pp; i++) {
+        p[i] = (uint8_t) (value >> (i * 8));
+    }
+}
+
+/**
+ * Expand a glyph bitmap into a cache
+ */
+static void fbcon_render(glyph_cache_t* cache, uint8_t c) {
+    uint32_t fg = fbcon_colors[cache->attr & 0xF];
+    uint32_t bg = fbcon_colors[cache->attr >> 4];
+    uint8_t* out = (uint8_t*) (cache->pixels + c * fbcon_glyph_words);
+    for (uint32_t y = 0; y < FBCON_GLYPH_HEIGHT; y++) {
+        uint8_t bits = fbcon_font[c][y];
+        for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++) {
+            fbcon_put_pixel(out, (bits & (0x80 >> x)) ? fg : bg);
+            out += fbcon_bytes_pp;
+        }
+    }
+    cache->valid[c / 32] |= 1u << (c % 32);
+    fbcon_stats.glyphs_rendered++;
+}
+
+/**
+ * Find the cache of an attribute, taking the least recently used slot if it has none
+ *
+ * @return The cache, or NULL if every slot is used by the span being drawn
+ */
+static glyph_cache_t* fbcon_cache_for(uint8_t attr) {
+    glyph_cache_t* cache;
+    if (fbcon_cache_of[attr] >= 0) {
+        cache = &fbcon_caches[fbcon_cache_of[attr]];
+        cache->last_use = fbcon_tick;
+        return cache;
+    }
+    cache = &fbcon_caches[0];
+    for (uint32_t i = 0; i < FBCON_GLYPH_CACHES && cache->used; i++) {
+        glyph_cache_t* slot = &fbcon_caches[i];
+        if (!slot->used || slot->last_use < cache->last_use) {
+            cache = slot;
+        }
+    }
+    if (cache->used) {
+        if (cache->last_use == fbcon_tick) {
+            return NULL;
+        }
+        fbcon_cache_of[cache->attr] = -1;
+        fbcon_stats.cache_evictions++;
+    }
+    memset(cache->valid, 0, sizeof(cache->valid));
+    cache->attr = attr;
+    cache->used = true;
+    cache->last_use = fbcon_tick;
+    fbcon_cache_of[attr] = (int8_t) (cache - fbcon_caches);
+    return cache;
+}
+
+/**
+ * Copy the glyphs in fbcon_span[0, count) to cells starting at (x, y), one scanline at a time
+ */
+static void fbcon_blit(size_t x, size_t y, size_t count) {
+    uint8_t* row = fbcon_base + y * FBCON_GLYPH_HEIGHT * fbcon_pitch + x * FBCON_GLYPH_WIDTH * fbcon_bytes_pp;
+    for (uint32_t line = 0; line < FBCON_GLYPH_HEIGHT; line++) {
+        uint32_t* dst = (uint32_t*) row;
+        uint32_t offset = line * fbcon_row_words;
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t* src = fbcon_span[i] + offset;
+            for (uint32_t w = 0; w < fbcon_row_words; w++) {
+                *dst++ = src[w];
+            }
+        }
+        row += fbcon_pitch;
+    }
+    fbcon_stats.cells_drawn += count;
+}
+
+/**
+ * Draw a span of cells
+ *
+ * More attributes than cache slots in one span: the glyphs gathered so far
+ * are drawn before their slots are reused.
+ */
+void fbcon_draw_cells(size_t x, size_t y, const uint16_t* cells, size_t count) {
+    fbcon_tick++;
+    fbcon_stats.spans_drawn++;
+    size_t pending = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t c = (uint8_t) cells[i];
+        glyph_cache_t* cache = fbcon_cache_for((uint8_t) (cells[i] >> 8));
+        if (cache == NULL) {
+            fbcon_blit(x + i - pending, y, pending);
+            pending = 0;
+            fbcon_tick++;
+            cache = fbcon_cache_for((uint8_t) (cells[i] >> 8));
+        }
+        if (!(cache->valid[c / 32] & (1u << (c % 32)))) {
+            fbcon_render(cache, c);
+        }
+        fbcon_span[pending++] = cache->pixels + c * fbcon_glyph_words;
+    }
+    fbcon_blit(x + count - pending, y, pending);
+}
+
+/**
+ * Underline the bottom two pixel rows of a cell
+ */
+void fbcon_draw_cursor(size_t x, size_t y, uint16_t cell) {
+    uint32_t color = fbcon_colors[(cell >> 8) & 0xF];
+    uint8_t* row = fbcon_base + ((y + 1) * FBCON_GLYPH_HEIGHT - 2) * fbcon_pitch +
+                   x * FBCON_GLYPH_WIDTH * fbcon_bytes_pp;
+    for (uint32_t line = 0; line < 2; line++) {
+        for (uint32_t i = 0; i < FBCON_GLYPH_WIDTH; i++) {
+            fbcon_put_pixel(row + i * fbcon_bytes_pp, color);
+        }
+        row += fbcon_pitch;
+    }
+}
+
+/**
+ * Check whether the framebuffer console is in use
+ */
+bool fbcon_active(void) {
+    return fbcon_enabled;
+}
+
+/**
+ * Set up the framebuffer from the multiboot information and take over the console
+ */
+int fbcon_init(multiboot_info_t* mbi) {
+    if (!(mbi->flags & MULTIBOOT_INFO_FRAMEBUFFER_INFO) || mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_TYPE_RGB) {
+        return -1;      /* Text mode (or a palette mode): stay on VGA */
+    }
+    uint32_t bpp = mbi->framebuffer_bpp;
+    size_t cols = mbi->framebuffer_width / FBCON_GLYPH_WIDTH;
+    size_t rows = mbi->framebuffer_height / FBCON_GLYPH_HEIGHT;
+    if ((bpp != 16 && bpp != 24 && bpp != 32) || (mbi->framebuffer_addr >> 32) != 0 ||
+        mbi->framebuffer_red_mask_size > 8 || mbi->framebuffer_green_mask_size > 8 ||
+        mbi->framebuffer_blue_mask_size > 8 || cols < VGA_WIDTH || rows < VGA_HEIGHT) {
+        klog(KLOG_WARN, "fbcon: Can't use a %ux%ux%u framebuffer\n", mbi->framebuffer_width,
+             mbi->framebuffer_height, bpp);
+        return -1;
+    }
+    cols = cols < CONSOLE_MAX_COLS ? cols : CONSOLE_MAX_COLS;
+    rows = rows < CONSOLE_MAX_ROWS ? rows : CONSOLE_MAX_ROWS;
+
+    size_t size = (size_t) mbi->framebuffer_pitch * mbi->framebuffer_height;
+    uint8_t* base = paging_map_physical((uint32_t) mbi->framebuffer_addr, size, PTE_WRITABLE);
+    if (base == NULL) {
+        return -1;
+    }
+    fbcon_bytes_pp = bpp / 8;
+    fbcon_row_words = FBCON_GLYPH_WIDTH * fbcon_bytes_pp / sizeof(uint32_t);
+    fbcon_glyph_words = fbcon_row_words * FBCON_GLYPH_HEIGHT;
+    for (uint32_t i = 0; i < FBCON_GLYPH_CACHES; i++) {
+        glyph_cache_t* cache = &fbcon_caches[i];
+        cache->pixels = kmalloc(256 * fbcon_glyph_words * sizeof(uint32_t));
+        if (cache->pixels == NULL) {
+            while (i-- > 0) {
+                kfree(fbcon_caches[i].pixels);
+            }
+            klog(KLOG_ERR, "[FAILED] fbcon: No memory for the glyph caches\n");
+            return -1;
+        }
+        cache->used = false;
+    }
+    memset(fbcon_cache_of, -1, sizeof(fbcon_cache_of));
+    for (uint32_t i = 0; i < 16; i++) {
+        fbcon_colors[i] = fbcon_pixel(mbi, vga_palette[i]);
+    }
+    fbcon_base = base;
+    fbcon_pitch = mbi->framebuffer_pitch;
+    // The margins right of and below the grid are never drawn
+    memset(base, 0, size);
+
+    fbcon_enabled = true;
+    vga_attach_framebuffer(cols, rows);
+    klog(KLOG_INFO, "[  OK  ] fbcon: %ux%ux%u framebuffer, %zux%zu text console\n", mbi->framebuffer_width,
+         mbi->framebuffer_height, bpp, cols, rows);
+    return 0;
+}
+
+/**
+ * Get the drawing counters
+ */
+void fbcon_get_stats(fbcon_stats_t* stats) {
+    uint32_t flags = irq_save();
+    *stats = fbcon_stats;
+    irq_restore(flags);
+}
@@ -0,0 +1,111 @@
+#include <stdint.h>
+
+#include <kernel/fbcon.h>
+
+/**
+ * olympos 8x16 Console Font
+ *
+ * Printable ASCII (0x20-0x7E) rendered at 14 px, baseline at row 12, and
+ * thresholded to one bit per pixel; bit 7 is the leftmost column. Other
+ * characters are blank.
+ *
+ * Derived from Source Code Pro, Copyright 2010, 2012 Adobe Systems Incorporated,
+ * with Reserved Font Name 'Source'. Licensed under the SIL Open Font License 1.1.
+ */
+
+const uint8_t fbcon_font[256][FBCON_GLYPH_HEIGHT] = {
+    [0x21] = {0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* ! */
+    [0x22] = {0x00, 0x00, 0x26, 0x26, 0x24, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* " */
+    [0x23] = {0x00, 0x00, 0x00, 0x14, 0x14, 0x7E, 0x24, 0x24, 0x7E, 0x24, 0x24, 0x28, 0x00, 0x00, 0x00, 0x00}, /* # */
+    [0x24] = {0x00, 0x00, 0x08, 0x08, 0x3C, 0x22, 0x20, 0x38, 0x06, 0x02, 0x42, 0x3C, 0x08, 0x08, 0x00, 0x00}, /* $ */
+    [0x25] = {0x00, 0x00, 0x70, 0x91, 0x92, 0x94, 0x70, 0x06, 0x29, 0x49, 0x89, 0x06, 0x00, 0x00, 0x00, 0x00}, /* % */
+    [0x26] = {0x00, 0x00, 0x00, 0x38, 0x28, 0x28, 0x38, 0x31, 0x52, 0x4E, 0x46, 0x39, 0x00, 0x00, 0x00, 0x00}, /* & */
+    [0x27] = {0x00, 0x00, 0x18, 0x18, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ' */
+    [0x28] = {0x00, 0x00, 0x06, 0x04, 0x08, 0x18, 0x10, 0x10, 0x10, 0x10, 0x10, 0x18, 0x08, 0x04, 0x06, 0x00}, /* ( */
+    [0x29] = {0x00, 0x00, 0x20, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x20, 0x00}, /* ) */
+    [0x2A] = {0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x7E, 0x18, 0x14, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* * */
+    [0x2B] = {0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x7E, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00}, /* + */
+    [0x2C] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x1C, 0x08, 0x08, 0x10, 0x00}, /* , */
+    [0x2D] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* - */
+    [0x2E] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* . */
+    [0x2F] = {0x00, 0x00, 0x02, 0x04, 0x04, 0x04, 0x08, 0x08, 0x18, 0x10, 0x10, 0x20, 0x20, 0x60, 0x00, 0x00}, /* / */
+    [0x30] = {0x00, 0x00, 0x00, 0x1C, 0x26, 0x42, 0x5A, 0x5A, 0x42, 0x42, 0x26, 0x1C, 0x00, 0x00, 0x00, 0x00}, /* 0 */
+    [0x31] = {0x00, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x7E, 0x00, 0x00, 0x00, 0x00}, /* 1 */
+    [0x32] = {0x00, 0x00, 0x00, 0x3C, 0x46, 0x02, 0x02, 0x04, 0x08, 0x10, 0x20, 0x7E, 0x00, 0x00, 0x00, 0x00}, /* 2 */
+    [0x33] = {0x00, 0x00, 0x00, 0x3C, 0x46, 0x02, 0x06, 0x18, 0x06, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* 3 */
+    [0x34] = {0x00, 0x00, 0x00, 0x04, 0x0C, 0x14, 0x34, 0x24, 0x44, 0x7F, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00}, /* 4 */
+    [0x35] = {0x00, 0x00, 0x00, 0x3E, 0x20, 0x20, 0x3C, 0x42, 0x02, 0x02, 0x46, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* 5 */
+    [0x36] = {0x00, 0x00, 0x00, 0x1E, 0x22, 0x60, 0x5C, 0x62, 0x42, 0x42, 0x22, 0x1C, 0x00, 0x00, 0x00, 0x00}, /* 6 */
+    [0x37] = {0x00, 0x00, 0x00, 0x7E, 0x02, 0x04, 0x0C, 0x08, 0x08, 0x18, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, /* 7 */
+    [0x38] = {0x00, 0x00, 0x00, 0x3C, 0x22, 0x22, 0x32, 0x3C, 0x66, 0x42, 0x42, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* 8 */
+    [0x39] = {0x00, 0x00, 0x00, 0x3C, 0x66, 0x42, 0x42, 0x66, 0x3A, 0x02, 0x44, 0x38, 0x00, 0x00, 0x00, 0x00}, /* 9 */
+    [0x3A] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* : */
+    [0x3B] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x1C, 0x08, 0x08, 0x10, 0x00}, /* ; */
+    [0x3C] = {0x00, 0x00, 0x00, 0x00, 0x02, 0x0C, 0x10, 0x20, 0x10, 0x0C, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00}, /* < */
+    [0x3D] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x00, 0x00, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* = */
+    [0x3E] = {0x00, 0x00, 0x00, 0x00, 0x40, 0x30, 0x0C, 0x02, 0x0C, 0x30, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00}, /* > */
+    [0x3F] = {0x00, 0x00, 0x3C, 0x26, 0x02, 0x04, 0x0C, 0x08, 0x10, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* ? */
+    [0x40] = {0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x47, 0x49, 0x51, 0x53, 0x4D, 0x40, 0x22, 0x1E, 0x00, 0x00}, /* @ */
+    [0x41] = {0x00, 0x00, 0x00, 0x18, 0x18, 0x14, 0x24, 0x24, 0x3E, 0x42, 0x42, 0xC1, 0x00, 0x00, 0x00, 0x00}, /* A */
+    [0x42] = {0x00, 0x00, 0x00, 0x7C, 0x62, 0x62, 0x62, 0x7C, 0x62, 0x63, 0x62, 0x7C, 0x00, 0x00, 0x00, 0x00}, /* B */
+    [0x43] = {0x00, 0x00, 0x00, 0x1E, 0x23, 0x60, 0x40, 0x40, 0x40, 0x60, 0x21, 0x1E, 0x00, 0x00, 0x00, 0x00}, /* C */
+    [0x44] = {0x00, 0x00, 0x00, 0x7C, 0x46, 0x42, 0x43, 0x43, 0x43, 0x42, 0x46, 0x7C, 0x00, 0x00, 0x00, 0x00}, /* D */
+    [0x45] = {0x00, 0x00, 0x00, 0x3E, 0x20, 0x20, 0x20, 0x3E, 0x20, 0x20, 0x20, 0x3E, 0x00, 0x00, 0x00, 0x00}, /* E */
+    [0x46] = {0x00, 0x00, 0x00, 0x3F, 0x20, 0x20, 0x20, 0x3E, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00}, /* F */
+    [0x47] = {0x00, 0x00, 0x00, 0x1E, 0x22, 0x40, 0x40, 0x46, 0x42, 0x42, 0x22, 0x1E, 0x00, 0x00, 0x00, 0x00}, /* G */
+    [0x48] = {0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, /* H */
+    [0x49] = {0x00, 0x00, 0x00, 0x7E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x7E, 0x00, 0x00, 0x00, 0x00}, /* I */
+    [0x4A] = {0x00, 0x00, 0x00, 0x3E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x46, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* J */
+    [0x4B] = {0x00, 0x00, 0x00, 0x63, 0x64, 0x6C, 0x78, 0x7C, 0x64, 0x66, 0x62, 0x61, 0x00, 0x00, 0x00, 0x00}, /* K */
+    [0x4C] = {0x00, 0x00, 0x00, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3F, 0x00, 0x00, 0x00, 0x00}, /* L */
+    [0x4D] = {0x00, 0x00, 0x00, 0x62, 0x66, 0x66, 0x5A, 0x5A, 0x4A, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, /* M */
+    [0x4E] = {0x00, 0x00, 0x00, 0x62, 0x62, 0x52, 0x52, 0x4A, 0x4A, 0x46, 0x46, 0x42, 0x00, 0x00, 0x00, 0x00}, /* N */
+    [0x4F] = {0x00, 0x00, 0x00, 0x3C, 0x62, 0x42, 0x43, 0x41, 0x43, 0x42, 0x62, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* O */
+    [0x50] = {0x00, 0x00, 0x00, 0x7E, 0x62, 0x63, 0x62, 0x7C, 0x60, 0x60, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00}, /* P */
+    [0x51] = {0x00, 0x00, 0x00, 0x3C, 0x66, 0x42, 0x43, 0x43, 0x43, 0x42, 0x66, 0x3C, 0x08, 0x07, 0x00, 0x00}, /* Q */
+    [0x52] = {0x00, 0x00, 0x00, 0x7C, 0x62, 0x62, 0x62, 0x7C, 0x6C, 0x64, 0x62, 0x63, 0x00, 0x00, 0x00, 0x00}, /* R */
+    [0x53] = {0x00, 0x00, 0x00, 0x3C, 0x22, 0x60, 0x30, 0x1C, 0x02, 0x03, 0x42, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* S */
+    [0x54] = {0x00, 0x00, 0x00, 0x7F, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00}, /* T */
+    [0x55] = {0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x62, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* U */
+    [0x56] = {0x00, 0x00, 0x00, 0x43, 0x42, 0x62, 0x22, 0x24, 0x24, 0x14, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* V */
+    [0x57] = {0x00, 0x00, 0x00, 0x81, 0x81, 0x49, 0x59, 0x59, 0x56, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00}, /* W */
+    [0x58] = {0x00, 0x00, 0x00, 0x42, 0x26, 0x34, 0x18, 0x18, 0x1C, 0x24, 0x22, 0x43, 0x00, 0x00, 0x00, 0x00}, /* X */
+    [0x59] = {0x00, 0x00, 0x00, 0x43, 0x62, 0x26, 0x34, 0x18, 0x18, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00}, /* Y */
+    [0x5A] = {0x00, 0x00, 0x00, 0x7E, 0x02, 0x04, 0x0C, 0x08, 0x10, 0x20, 0x60, 0x7F, 0x00, 0x00, 0x00, 0x00}, /* Z */
+    [0x5B] = {0x00, 0x00, 0x1E, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1E, 0x00, 0x00}, /* [ */
+    [0x5C] = {0x00, 0x00, 0x60, 0x20, 0x20, 0x10, 0x10, 0x18, 0x08, 0x08, 0x04, 0x04, 0x04, 0x02, 0x00, 0x00}, /* \ */
+    [0x5D] = {0x00, 0x00, 0x78, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x78, 0x00, 0x00}, /* ] */
+    [0x5E] = {0x00, 0x00, 0x00, 0x18, 0x18, 0x14, 0x24, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ^ */
+    [0x5F] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x00, 0x00}, /* _ */
+    [0x60] = {0x00, 0x00, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ` */
+    [0x61] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x42, 0x02, 0x1E, 0x62, 0x46, 0x3A, 0x00, 0x00, 0x00, 0x00}, /* a */
+    [0x62] = {0x00, 0x00, 0x40, 0x40, 0x40, 0x5C, 0x62, 0x42, 0x43, 0x42, 0x62, 0x5C, 0x00, 0x00, 0x00, 0x00}, /* b */
+    [0x63] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x1E, 0x22, 0x60, 0x40, 0x40, 0x22, 0x1F, 0x00, 0x00, 0x00, 0x00}, /* c */
+    [0x64] = {0x00, 0x00, 0x02, 0x02, 0x02, 0x3E, 0x62, 0x42, 0x42, 0x42, 0x66, 0x3A, 0x00, 0x00, 0x00, 0x00}, /* d */
+    [0x65] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x42, 0x7F, 0x40, 0x22, 0x1E, 0x00, 0x00, 0x00, 0x00}, /* e */
+    [0x66] = {0x00, 0x00, 0x0F, 0x08, 0x18, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* f */
+    [0x67] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x24, 0x62, 0x26, 0x3C, 0x40, 0x3E, 0x41, 0x43, 0x3E, 0x00}, /* g */
+    [0x68] = {0x00, 0x00, 0x40, 0x40, 0x40, 0x5E, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, /* h */
+    [0x69] = {0x00, 0x00, 0x0C, 0x0C, 0x00, 0x7C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00}, /* i */
+    [0x6A] = {0x00, 0x00, 0x0C, 0x0C, 0x00, 0x7C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x08, 0x78, 0x00}, /* j */
+    [0x6B] = {0x00, 0x00, 0x60, 0x60, 0x60, 0x63, 0x64, 0x68, 0x78, 0x64, 0x62, 0x63, 0x00, 0x00, 0x00, 0x00}, /* k */
+    [0x6C] = {0x00, 0x00, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x08, 0x0F, 0x00, 0x00, 0x00, 0x00}, /* l */
+    [0x6D] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x76, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, 0x00, 0x00, 0x00}, /* m */
+    [0x6E] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x5E, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, /* n */
+    [0x6F] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x62, 0x42, 0x43, 0x42, 0x62, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* o */
+    [0x70] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x5C, 0x62, 0x42, 0x43, 0x42, 0x62, 0x5C, 0x40, 0x40, 0x40, 0x00}, /* p */
+    [0x71] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x62, 0x42, 0x42, 0x42, 0x66, 0x3A, 0x02, 0x02, 0x02, 0x00}, /* q */
+    [0x72] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x2F, 0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00}, /* r */
+    [0x73] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x62, 0x20, 0x1C, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00, 0x00}, /* s */
+    [0x74] = {0x00, 0x00, 0x00, 0x10, 0x10, 0x7E, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0F, 0x00, 0x00, 0x00, 0x00}, /* t */
+    [0x75] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3A, 0x00, 0x00, 0x00, 0x00}, /* u */
+    [0x76] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x43, 0x42, 0x22, 0x24, 0x14, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* v */
+    [0x77] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x89, 0xD9, 0x59, 0x5B, 0x56, 0x66, 0x26, 0x00, 0x00, 0x00, 0x00}, /* w */
+    [0x78] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x62, 0x24, 0x1C, 0x18, 0x1C, 0x24, 0x42, 0x00, 0x00, 0x00, 0x00}, /* x */
+    [0x79] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x43, 0x42, 0x22, 0x24, 0x14, 0x14, 0x08, 0x08, 0x10, 0x60, 0x00}, /* y */
+    [0x7A] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x06, 0x0C, 0x18, 0x10, 0x20, 0x7E, 0x00, 0x00, 0x00, 0x00}, /* z */
+    [0x7B] = {0x00, 0x00, 0x0E, 0x08, 0x08, 0x08, 0x08, 0x18, 0x20, 0x18, 0x08, 0x08, 0x08, 0x0E, 0x00, 0x00}, /* { */
+    [0x7C] = {0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08}, /* | */
+    [0x7D] = {0x00, 0x00, 0x70, 0x08, 0x08, 0x08, 0x08, 0x08, 0x06, 0x08, 0x08, 0x08, 0x08, 0x70, 0x00, 0x00}, /* } */
+    [0x7E] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x32, 0x4E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ~ */
+};
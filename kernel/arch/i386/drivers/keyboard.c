@@ -11,11 +11,16 @@
  * - Modern systems: keyboards use Set 2 internally, but the 8042 translates to Set 1
  *   for BIOS compatibility, which is why this driver uses Set 1
  *
- * This is a minimal implementation that:
- * - Handles basic printable characters (no shift/caps lock)
- * - Ignores break codes (key releases)
- * - Ignores extended keys (arrow keys, function keys beyond F10)
- * - Simply echoes characters to the terminal
+ * Every byte from the controller goes through a small decoder:
+ *
+ *   0xE0 → E0 state: the next byte is an extended key (arrows, right Ctrl/Alt, keypad Enter and /)
+ *   0xE1 → E1 state: skip the rest of the pause sequence, report KEY_PAUSE
+ *   other → key code = make code (| KEY_EXTENDED after E0), bit 7 = release
+ *         → modifiers: held Shift/Ctrl/Alt bits, Caps/Num Lock toggled on the first press
+ *         → character = keymap[layer of the modifiers][key code]
+ *         → key event (press or release, modifiers, character) on the input ring
+ *
+ * Readers take events (keyboard_read_event) or just the characters they type (getchar, read).
  *
  * Reference: https://wiki.osdev.org/PS/2_Keyboard
  */
@@ -24,6 +29,12 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <kernel/keyboard.h>
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/klog.h>
+#include <kernel/spinlock.h>
+
 #include "../include/irq.h"
 #include "../include/io.h"
 #include "../include/interrupts.h"
@@ -33,10 +44,26 @@
 #define KBD_STATUS_PORT 0x64  /* Status register - check for data availability */
 #define KBD_STATUS_OBF  0x01  /* Output Buffer Full - bit 0: data ready to read */
 
-/* Character buffer for keyboard input. Used to pass characters from IRQ handler to getchar() implementation */
-static char keyboard_char = 0;
-/* Flag: true if keyboard_char contains unread data */
-static bool has_char = false;
+/**
+ * Keyboard input ring
+ *
+ * Single producer (the decoder, run by keyboard_on_irq) and single consumer (keyboard_callback_getchar and the
+ * other readers), so no lock is needed: the IRQ handler only writes kbd_head, the reader only writes kbd_tail. Both
+ * indices grow freely and are masked on access; head - tail is the number of queued events. A release store
+ * publishes each slot before the index that exposes it, and an acquire load on the other side pairs with it.
+ */
+static key_event_t kbd_ring[KEYBOARD_BUFFER_SIZE];
+static uint32_t kbd_head = 0;       /* Next slot the IRQ handler fills */
+static uint32_t kbd_tail = 0;       /* Next slot the reader consumes */
+static uint32_t kbd_overflows = 0;  /* Events dropped because the ring was full */
+/* Canonical mode (only character presses are queued): end of the last complete line (one past its '\n');
+ * the IRQ handler writes it, and keyboard_set_mode() under kbd_mode_lock */
+static uint32_t kbd_line_end = 0;
+static int kbd_mode = KEYBOARD_MODE_RAW;
+/* Keeps a mode switch on another CPU from landing in the middle of keyboard_queue() */
+static spinlock_t kbd_mode_lock = SPINLOCK_INIT;
+/* Readers sleeping in keyboard_wait(), woken by the IRQ handler */
+static wait_queue_t kbd_wait = WAIT_QUEUE_INIT;
 
 /* Forward declarations */
 static void keyboard_on_irq(void);
@@ -52,72 +79,118 @@ static void keyboard_on_irq(void);
  */
 static void kb_irq_trampoline(regs_t* r) {
 	(void) r;  // Unused parameter
-	// Clear previous character and flag before processing new interrupt
-	keyboard_char = 0;
-	has_char = false;
 	keyboard_on_irq();
 }
 
 /**
- * IBM PC/XT Scancode Set 1 to ASCII translation table.
+ * Scancode Set 1 keymap, one table per modifier layer
  *
- * This table maps hardware scancodes (make codes) from the keyboard to ASCII characters.
- * Scancode Set 1 was defined by the original IBM PC/XT (1981) and is still used today
- * because the 8042 controller translates modern keyboards to this format for compatibility.
+ * Scancode Set 1 was defined by the original IBM PC/XT (1981) and is still used today because the 8042 controller
+ * translates modern keyboards to this format for compatibility. A key is its make code (0x00-0x7F; the break code
+ * is make | 0x80), or KEY_EXTENDED | make for keys sent behind 0xE0, so every layer is indexed by the 8-bit key
+ * code directly. The X-macro lists each key once; the layers are expanded from it at compile time:
  *
- * Layout:
- * - Index: Scancode value (0x00-0x7F are make codes)
- * - Value: ASCII character, or 0 for non-printable/modifier keys
+ *   KEYMAP_KEY(code, plain, shift, ctrl)   Shift picks a second symbol, Caps Lock doesn't apply
+ *   KEYMAP_LETTER(code, c)                 Shift and Caps Lock pick upper case (and cancel out), Ctrl gives c & 0x1F
  *
- * Make codes (key press): 0x00-0x7F
- * Break codes (key release): 0x80-0xFF (make code | 0x80)
- *
- * Limitations of this minimal table:
- * - No shift support (lowercase only)
- * - No caps lock handling
- * - Function keys F1-F10 mapped but unused (return 0)
- * - Extended keys (arrows, F11-F12) not included (require 0xE0 prefix)
- * - Control/Alt combinations not handled
+ * Keypad digits are listed with their Num Lock meaning; with Num Lock off the decoder turns them into the
+ * navigation keys that have the same code behind 0xE0.
  *
  * Complete scancode reference: https://wiki.osdev.org/PS/2_Keyboard#Scan_Code_Set_1
  */
-static char scancode_to_ascii[128] = {
-	/* 0x00-0x0F */
-	0,      /* 0x00: (error) */
-	27,     /* 0x01: ESC */
-	'1','2','3','4','5','6','7','8','9','0','-','=',
-	'\b',   /* 0x0E: Backspace */
-	'\t',   /* 0x0F: Tab */
-
-	/* 0x10-0x1F: QWERTY row + Enter + Ctrl */
-	'q','w','e','r','t','y','u','i','o','p','[',']',
-	'\n',   /* 0x1C: Enter */
-	0,      /* 0x1D: Left Ctrl */
-	'a','s',
-
-	/* 0x20-0x2F: ASDF row + Shift */
-	'd','f','g','h','j','k','l',';','\'','`',
-	0,      /* 0x2A: Left Shift */
-	'\\',
-
-	/* 0x30-0x3F: ZXCV row + keypad */
-	'z','x','c','v','b','n','m',',','.','/',
-	0,      /* 0x36: Right Shift */
-	'*',    /* 0x37: Keypad * */
-	0,      /* 0x38: Left Alt */
-	' ',    /* 0x39: Space */
-	0,      /* 0x3A: Caps Lock */
-
-	/* 0x3B-0x44: Function keys F1-F10 */
-	0,0,0,0,0,0,0,0,0,0,
-
-	/* 0x45-0x49: Num Lock, Scroll Lock, Keypad 7-9 */
-	0,0,0,0,0,
-
-	/* 0x4A-0x53: Keypad - , 4-6, +, 1-3, 0, Del */
-	0,0,0,0,0,0,0,0
+#define KEYMAP_KEYS(KEYMAP_KEY, KEYMAP_LETTER) \
+    KEYMAP_KEY(0x01, 27, 27, 27) \
+    KEYMAP_KEY(0x02, '1', '!', '1') KEYMAP_KEY(0x03, '2', '@', '2') KEYMAP_KEY(0x04, '3', '#', '3') \
+    KEYMAP_KEY(0x05, '4', '$', '4') KEYMAP_KEY(0x06, '5', '%', '5') KEYMAP_KEY(0x07, '6', '^', '6') \
+    KEYMAP_KEY(0x08, '7', '&', '7') KEYMAP_KEY(0x09, '8', '*', '8') KEYMAP_KEY(0x0A, '9', '(', '9') \
+    KEYMAP_KEY(0x0B, '0', ')', '0') KEYMAP_KEY(0x0C, '-', '_', '-') KEYMAP_KEY(0x0D, '=', '+', '=') \
+    KEYMAP_KEY(0x0E, '\b', '\b', '\b') KEYMAP_KEY(0x0F, '\t', '\t', '\t') \
+    KEYMAP_LETTER(0x10, 'q') KEYMAP_LETTER(0x11, 'w') KEYMAP_LETTER(0x12, 'e') KEYMAP_LETTER(0x13, 'r') \
+    KEYMAP_LETTER(0x14, 't') KEYMAP_LETTER(0x15, 'y') KEYMAP_LETTER(0x16, 'u') KEYMAP_LETTER(0x17, 'i') \
+    KEYMAP_LETTER(0x18, 'o') KEYMAP_LETTER(0x19, 'p') \
+    KEYMAP_KEY(0x1A, '[', '{', 0x1B) KEYMAP_KEY(0x1B, ']', '}', 0x1D) KEYMAP_KEY(0x1C, '\n', '\n', '\n') \
+    KEYMAP_LETTER(0x1E, 'a') KEYMAP_LETTER(0x1F, 's') KEYMAP_LETTER(0x20, 'd') KEYMAP_LETTER(0x21, 'f') \
+    KEYMAP_LETTER(0x22, 'g') KEYMAP_LETTER(0x23, 'h') KEYMAP_LETTER(0x24, 'j') KEYMAP_LETTER(0x25, 'k') \
+    KEYMAP_LETTER(0x26, 'l') \
+    KEYMAP_KEY(0x27, ';', ':', ';') KEYMAP_KEY(0x28, '\'', '"', '\'') KEYMAP_KEY(0x29, '`', '~', '`') \
+    KEYMAP_KEY(0x2B, '\\', '|', 0x1C) \
+    KEYMAP_LETTER(0x2C, 'z') KEYMAP_LETTER(0x2D, 'x') KEYMAP_LETTER(0x2E, 'c') KEYMAP_LETTER(0x2F, 'v') \
+    KEYMAP_LETTER(0x30, 'b') KEYMAP_LETTER(0x31, 'n') KEYMAP_LETTER(0x32, 'm') \
+    KEYMAP_KEY(0x33, ',', '<', ',') KEYMAP_KEY(0x34, '.', '>', '.') KEYMAP_KEY(0x35, '/', '?', '/') \
+    KEYMAP_KEY(0x37, '*', '*', '*') KEYMAP_KEY(0x39, ' ', ' ', ' ') \
+    KEYMAP_KEY(0x47, '7', '7', '7') KEYMAP_KEY(0x48, '8', '8', '8') KEYMAP_KEY(0x49, '9', '9', '9') \
+    KEYMAP_KEY(0x4A, '-', '-', '-') KEYMAP_KEY(0x4B, '4', '4', '4') KEYMAP_KEY(0x4C, '5', '5', '5') \
+    KEYMAP_KEY(0x4D, '6', '6', '6') KEYMAP_KEY(0x4E, '+', '+', '+') KEYMAP_KEY(0x4F, '1', '1', '1') \
+    KEYMAP_KEY(0x50, '2', '2', '2') KEYMAP_KEY(0x51, '3', '3', '3') KEYMAP_KEY(0x52, '0', '0', '0') \
+    KEYMAP_KEY(0x53, '.', '.', '.') \
+    KEYMAP_KEY(KEY_KP_ENTER, '\n', '\n', '\n') KEYMAP_KEY(KEY_KP_SLASH, '/', '/', '/')
+
+enum {
+    KEYMAP_PLAIN,
+    KEYMAP_SHIFT,
+    KEYMAP_CAPS,
+    KEYMAP_CAPS_SHIFT,
+    KEYMAP_CTRL,
+    KEYMAP_LAYERS
+};
+
+#define PLAIN_KEY(code, plain, shift, ctrl)         [code] = plain,
+#define PLAIN_LETTER(code, c)                       [code] = c,
+#define SHIFT_KEY(code, plain, shift, ctrl)         [code] = shift,
+#define SHIFT_LETTER(code, c)                       [code] = c - 'a' + 'A',
+#define CAPS_LETTER(code, c)                        [code] = c - 'a' + 'A',
+#define CTRL_KEY(code, plain, shift, ctrl)          [code] = ctrl,
+#define CTRL_LETTER(code, c)                        [code] = c & 0x1F,
+
+static const char keymap[KEYMAP_LAYERS][256] = {
+    [KEYMAP_PLAIN] = { KEYMAP_KEYS(PLAIN_KEY, PLAIN_LETTER) },
+    [KEYMAP_SHIFT] = { KEYMAP_KEYS(SHIFT_KEY, SHIFT_LETTER) },
+    [KEYMAP_CAPS] = { KEYMAP_KEYS(PLAIN_KEY, CAPS_LETTER) },
+    [KEYMAP_CAPS_SHIFT] = { KEYMAP_KEYS(SHIFT_KEY, PLAIN_LETTER) },
+    [KEYMAP_CTRL] = { KEYMAP_KEYS(CTRL_KEY, CTRL_LETTER) },
+};
+
+/* Layer for each combination of KEY_MOD_SHIFT | KEY_MOD_CTRL | KEY_MOD_ALT | KEY_MOD_CAPS (Ctrl wins, Alt adds none) */
+static const uint8_t keymap_layer[16] = {
+    KEYMAP_PLAIN, KEYMAP_SHIFT, KEYMAP_CTRL, KEYMAP_CTRL, KEYMAP_PLAIN, KEYMAP_SHIFT, KEYMAP_CTRL, KEYMAP_CTRL,
+    KEYMAP_CAPS, KEYMAP_CAPS_SHIFT, KEYMAP_CTRL, KEYMAP_CTRL, KEYMAP_CAPS, KEYMAP_CAPS_SHIFT, KEYMAP_CTRL, KEYMAP_CTRL,
+};
+
+/* Modifier keys held down, one bit per physical key */
+#define KBD_HELD_LSHIFT     0x01
+#define KBD_HELD_RSHIFT     0x02
+#define KBD_HELD_LCTRL      0x04
+#define KBD_HELD_RCTRL      0x08
+#define KBD_HELD_LALT       0x10
+#define KBD_HELD_RALT       0x20
+
+/* What each key does to the modifier state: a KBD_HELD_* bit while down, or a lock it toggles when pressed */
+static const uint8_t key_held_bit[256] = {
+    [KEY_LSHIFT] = KBD_HELD_LSHIFT, [KEY_RSHIFT] = KBD_HELD_RSHIFT,
+    [KEY_LCTRL] = KBD_HELD_LCTRL, [KEY_RCTRL] = KBD_HELD_RCTRL,
+    [KEY_LALT] = KBD_HELD_LALT, [KEY_RALT] = KBD_HELD_RALT,
+};
+static const uint8_t key_lock_bit[256] = {
+    [KEY_CAPSLOCK] = KEY_MOD_CAPS, [KEY_NUMLOCK] = KEY_MOD_NUM,
+};
+
+/* Decoder state between scancode bytes */
+enum {
+    KBD_STATE_NORMAL,
+    KBD_STATE_E0,           /* Prefix seen: the next byte is an extended key */
+    KBD_STATE_E1,           /* Pause sequence: skipping the rest of it */
 };
 
+/* Bytes of the pause sequence after its E1 */
+#define KBD_PAUSE_TAIL      5
+
+/* Owned by the decoder (keyboard_process_scancode) */
+static uint8_t kbd_state = KBD_STATE_NORMAL;
+static uint8_t kbd_skip = 0;                /* Bytes of the pause sequence still to come */
+static uint8_t kbd_held = 0;                /* KBD_HELD_* */
+static uint8_t kbd_locks = 0;               /* KEY_MOD_CAPS | KEY_MOD_NUM */
+static uint32_t kbd_down[256 / 32];         /* Keys pressed and not released, to tell repeats apart */
+
 /**
  * Initialize the keyboard driver and register its IRQ handler.
  *
@@ -130,35 +203,252 @@ static char scancode_to_ascii[128] = {
  */
 void keyboard_initialize(void) {
 	reqister_irq(1, kb_irq_trampoline);
-	printf("[  OK  ] Keyboard driver initialized (IRQ 1).\n");
+	klog(KLOG_INFO, "[  OK  ] Keyboard driver initialized (IRQ 1).\n");
+}
+
+/**
+ * Check whether a reader at tail has something to consume
+ *
+ * @param canonical Require a complete line instead of any event
+ */
+static bool keyboard_readable(uint32_t tail, bool canonical) {
+    uint32_t end = __atomic_load_n(canonical ? &kbd_line_end : &kbd_head, __ATOMIC_ACQUIRE);
+    return end != tail;
+}
+
+/**
+ * Block until a reader at tail has something to consume
+ *
+ * @param canonical Wait for a complete line instead of any event
+ */
+static void keyboard_wait(uint32_t tail, bool canonical) {
+    /* The CPU runs other threads meanwhile (or halts in HLT before the scheduler starts) */
+    wait_event(&kbd_wait, keyboard_readable(tail, canonical));
+}
+
+/**
+ * Check whether an event types a character
+ */
+static inline bool key_event_types(const key_event_t* event) {
+    return !(event->flags & KEY_EVENT_RELEASED) && event->ascii != 0;
+}
+
+/**
+ * Blocking key event input
+ */
+void keyboard_read_event(key_event_t* event) {
+    uint32_t tail = kbd_tail;
+    keyboard_wait(tail, false);
+    *event = kbd_ring[tail & (KEYBOARD_BUFFER_SIZE - 1)];
+    __atomic_store_n(&kbd_tail, tail + 1, __ATOMIC_RELEASE);
 }
 
 /**
  * Blocking character input for shell/interactive applications
  *
- * This function provides getchar()-style blocking input by waiting for keyboard IRQs to populate the character buffer.
+ * This function provides getchar()-style blocking input by waiting for keyboard IRQs to fill the input ring.
  * It's the bridge between interrupt-driven keyboard input and the blocking I/O model expected by standard C library
  * functions.
  *
  * Implementation:
- * 1. Waits (using HLT to save power) until has_char flag is set by IRQ handler
- * 2. Retrieves the character from keyboard_char buffer
- * 3. Clears the has_char flag to indicate buffer is empty
- * 4. Returns the character to the caller
+ * 1. Blocks (other threads run, or HLT before the scheduler starts) until the ring holds an event
+ * 2. Takes the oldest event and publishes the new tail so the IRQ handler can reuse the slot
+ * 3. Repeats until the event was a press that types a character
+ *
+ * Always raw: the character is returned as soon as it is typed, whatever the keyboard_read() mode.
  *
  * This is called by getchar() in libc to implement standard input for the shell.
  *
  * @return ASCII character code of the key that was pressed
  */
 int keyboard_callback_getchar(void) {
-    // Wait until we have a character (HLT saves power while waiting)
-    while (!has_char) {
-        __asm__ volatile("hlt");
+    key_event_t event;
+    do {
+        keyboard_read_event(&event);
+    } while (!key_event_types(&event));
+    return (unsigned char) event.ascii;
+}
+
+/**
+ * Read queued input in one pass
+ *
+ * Raw mode returns as soon as any characters are queued, copying all of them (up to count); events that type
+ * nothing are consumed on the way. Canonical mode waits for a complete line and returns it including the '\n', or
+ * the first count bytes of it; the rest of the line is returned by the next read.
+ *
+ * @param buf Destination buffer
+ * @param count Buffer size in bytes
+ * @return Number of bytes copied
+ */
+size_t keyboard_read(char* buf, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    bool canonical = kbd_mode == KEYBOARD_MODE_CANONICAL;
+    uint32_t tail = kbd_tail;
+    size_t n = 0;
+    while (n == 0) {
+        keyboard_wait(tail, canonical);
+        uint32_t end = __atomic_load_n(canonical ? &kbd_line_end : &kbd_head, __ATOMIC_ACQUIRE);
+        while (n < count && tail != end) {
+            const key_event_t* event = &kbd_ring[tail & (KEYBOARD_BUFFER_SIZE - 1)];
+            tail++;
+            if (!key_event_types(event)) {
+                continue;
+            }
+            buf[n++] = event->ascii;
+            if (canonical && event->ascii == '\n') {
+                break;
+            }
+        }
+        __atomic_store_n(&kbd_tail, tail, __ATOMIC_RELEASE);
+    }
+    return n;
+}
+
+/**
+ * Select raw or canonical input for keyboard_read()
+ *
+ * Characters already queued count as one complete line when switching to canonical mode.
+ *
+ * @param mode KEYBOARD_MODE_RAW or KEYBOARD_MODE_CANONICAL
+ */
+void keyboard_set_mode(int mode) {
+    uint32_t flags = spin_lock_irqsave(&kbd_mode_lock);
+    kbd_line_end = kbd_head;
+    kbd_mode = mode;
+    spin_unlock_irqrestore(&kbd_mode_lock, flags);
+}
+
+/**
+ * Number of key events waiting in the input ring
+ */
+uint32_t keyboard_pending(void) {
+    return __atomic_load_n(&kbd_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&kbd_tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Number of key events dropped because the input ring was full
+ */
+uint32_t keyboard_overflows(void) {
+    return __atomic_load_n(&kbd_overflows, __ATOMIC_RELAXED);
+}
+
+/**
+ * Put a decoded event on the input ring (kbd_mode_lock held)
+ *
+ * @return true if the ring gained an event
+ */
+static bool keyboard_queue_locked(const key_event_t* event) {
+    uint32_t head = kbd_head;
+    bool canonical = kbd_mode == KEYBOARD_MODE_CANONICAL;
+    if (canonical) {
+        /* A cooked line holds characters only */
+        if (!key_event_types(event)) {
+            return false;
+        }
+        /* Canonical mode edits the unfinished line here; readers never see it before '\n' */
+        if (event->ascii == '\b') {
+            if (head != kbd_line_end) {
+                __atomic_store_n(&kbd_head, head - 1, __ATOMIC_RELEASE);
+            }
+            return false;
+        }
+    }
+    if (head - __atomic_load_n(&kbd_tail, __ATOMIC_ACQUIRE) == KEYBOARD_BUFFER_SIZE) {
+        kbd_overflows++;
+        return false;
+    }
+    kbd_ring[head & (KEYBOARD_BUFFER_SIZE - 1)] = *event;
+    __atomic_store_n(&kbd_head, head + 1, __ATOMIC_RELEASE);
+    /* A line ends at '\n', or when it fills the ring and could never be completed */
+    if (canonical && (event->ascii == '\n' ||
+                      head + 1 - __atomic_load_n(&kbd_tail, __ATOMIC_ACQUIRE) == KEYBOARD_BUFFER_SIZE)) {
+        __atomic_store_n(&kbd_line_end, head + 1, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+/**
+ * Put a decoded event on the input ring and wake the reader
+ */
+static void keyboard_queue(const key_event_t* event) {
+    spin_lock(&kbd_mode_lock);
+    bool queued = keyboard_queue_locked(event);
+    spin_unlock(&kbd_mode_lock);
+    /* The reader re-checks its condition, so waking it for a partial line is harmless */
+    if (queued) {
+        wake_up_boost(&kbd_wait, SCHED_BOOST_INPUT);
+    }
+}
+
+/**
+ * Modifiers in effect: held keys folded into KEY_MOD_*, plus the locks
+ */
+static inline uint8_t keyboard_modifiers(void) {
+    return (uint8_t) (((kbd_held & (KBD_HELD_LSHIFT | KBD_HELD_RSHIFT)) != 0) * KEY_MOD_SHIFT |
+                      ((kbd_held & (KBD_HELD_LCTRL | KBD_HELD_RCTRL)) != 0) * KEY_MOD_CTRL |
+                      ((kbd_held & (KBD_HELD_LALT | KBD_HELD_RALT)) != 0) * KEY_MOD_ALT | kbd_locks);
+}
+
+/**
+ * Turn a complete key (code and direction) into an event
+ */
+static void keyboard_key(uint8_t keycode, bool released) {
+    /* Num Lock off: keypad digits are the navigation keys with the same code */
+    if (!(kbd_locks & KEY_MOD_NUM) && keycode >= 0x47 && keycode <= 0x53 && keycode != 0x4A && keycode != 0x4E) {
+        keycode |= KEY_EXTENDED;
+    }
+    uint32_t word = keycode / 32, bit = 1u << (keycode % 32);
+    bool repeat = !released && (kbd_down[word] & bit);
+    kbd_down[word] = released ? kbd_down[word] & ~bit : kbd_down[word] | bit;
+    kbd_held = released ? kbd_held & ~key_held_bit[keycode] : kbd_held | key_held_bit[keycode];
+    if (!released && !repeat) {
+        kbd_locks ^= key_lock_bit[keycode];
+    }
+    key_event_t event;
+    event.keycode = keycode;
+    event.modifiers = keyboard_modifiers();
+    event.ascii = (uint8_t) keymap[keymap_layer[event.modifiers & 0xF]][keycode];
+    event.flags = (released ? KEY_EVENT_RELEASED : 0) | (repeat ? KEY_EVENT_REPEAT : 0);
+    keyboard_queue(&event);
+}
+
+/**
+ * Scancode decoder state machine
+ */
+void keyboard_process_scancode(uint8_t sc) {
+    switch (kbd_state) {
+    case KBD_STATE_E1:
+        /* E1 1D 45 E1 9D C5: both halves at once, and no break code of its own */
+        if (--kbd_skip == 0) {
+            kbd_state = KBD_STATE_NORMAL;
+            keyboard_key(KEY_PAUSE, false);
+            keyboard_key(KEY_PAUSE, true);
+        }
+        return;
+    case KBD_STATE_E0:
+        kbd_state = KBD_STATE_NORMAL;
+        /* E0 2A / E0 36 (and their breaks) are fake shifts wrapped around Print Screen and others: not keys */
+        if ((sc & 0x7F) == KEY_LSHIFT || (sc & 0x7F) == KEY_RSHIFT) {
+            return;
+        }
+        keyboard_key(KEY_EXTENDED | (sc & 0x7F), (sc & 0x80) != 0);
+        return;
+    default:
+        break;
+    }
+    if (sc == 0xE0) {
+        kbd_state = KBD_STATE_E0;
+    }
+    else if (sc == 0xE1) {
+        kbd_state = KBD_STATE_E1;
+        kbd_skip = KBD_PAUSE_TAIL;
+    }
+    else if (sc != 0x00 && sc != 0xFF && sc != 0xFA && sc != 0xFE) {
+        /* (Not a controller error, ACK or resend byte) */
+        keyboard_key(sc & 0x7F, (sc & 0x80) != 0);
     }
-    // Get the character and clear the buffer
-    char c = keyboard_char;
-    has_char = false;
-    return c;
 }
 
 /**
@@ -166,17 +456,13 @@ int keyboard_callback_getchar(void) {
  *
  * This handler is called whenever IRQ 1 fires (keyboard data available). It:
  * 1. Checks if data is available in the output buffer
- * 2. Reads the scancode from the data port (0x60)
- * 3. Filters out break codes (bit 7 set = key release)
- * 4. Translates make codes to ASCII using the scancode table
- * 5. Echoes printable characters to the terminal
+ * 2. Reads the scancode byte from the data port (0x60)
+ * 3. Feeds it to the decoder, which queues an event once a key is complete
  *
  * Scancode format:
  * - Make code (key press):   0x00-0x7F (bit 7 = 0)
  * - Break code (key release): 0x80-0xFF (bit 7 = 1, i.e., make code | 0x80)
- *
- * Extended keys (arrows, F11, etc.) send 0xE0 prefix followed by the scancode.
- * This minimal driver ignores extended keys.
+ * - Extended keys (arrows, right Ctrl, ...) send an 0xE0 prefix before either
  */
 static void keyboard_on_irq(void) {
 	/* Check if data is available in the output buffer.
@@ -184,19 +470,5 @@ static void keyboard_on_irq(void) {
 	if ((inb(KBD_STATUS_PORT) & KBD_STATUS_OBF) == 0) {
 		return;  /* No data available */
 	}
-	/* Read the scancode from the data port */
-	uint8_t sc = inb(KBD_DATA_PORT);
-	/* Filter out break codes (key releases). Break codes have bit 7 set (scancode | 0x80).
-	 * Example: 'A' pressed = 0x1E, 'A' released = 0x9E */
-	if (sc & 0x80) {
-		return;  /* Ignore key releases */
-	}
-	/* Translate scancode to ASCII using the lookup table.
-	 * If the scancode maps to 0, it's a non-printable key (Ctrl, Shift, etc.) */
-	char c = (sc < 128) ? scancode_to_ascii[sc] : 0;
-	/* Store character in buffer for getchar() to retrieve */
-	if (c) {
-		keyboard_char = c;
-		has_char = true;
-	}
+	keyboard_process_scancode(inb(KBD_DATA_PORT));
 }
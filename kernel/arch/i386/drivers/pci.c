@@ -0,0 +1,126 @@
+// Reference: https://wiki.osdev.org/PCI
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/pci.h>
+#include <kernel/spinlock.h>
+
+#include "../include/io.h"
+
+#define PCI_BUSES               256
+#define PCI_SLOTS               32
+#define PCI_FUNCS               8
+#define PCI_HEADER_MULTIFUNC    0x80    /* Header type bit 7: functions 1-7 may exist */
+
+/* Matches pci_find_class() and pci_find_device() look for */
+typedef bool (*pci_match_fn)(const pci_device_t* dev, uint32_t a, uint32_t b);
+
+/* Owns the CF8/CFC address-data pair */
+static spinlock_t pci_config_lock = SPINLOCK_INIT;
+
+static inline uint32_t pci_address(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    return 0x80000000u | ((uint32_t) bus << 16) | ((uint32_t) (slot & 0x1F) << 11) |
+           ((uint32_t) (func & 0x7) << 8) | (offset & 0xFC);
+}
+
+/**
+ * Read a configuration space double word
+ *
+ * The address and data ports are one transaction, so nothing may touch
+ * them in between: not an IRQ handler, not another CPU.
+ */
+uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    uint32_t flags = spin_lock_irqsave(&pci_config_lock);
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, func, offset));
+    uint32_t value = inl(PCI_CONFIG_DATA);
+    spin_unlock_irqrestore(&pci_config_lock, flags);
+    return value;
+}
+
+/**
+ * Write a configuration space double word
+ */
+void pci_config_write(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint32_t value) {
+    uint32_t flags = spin_lock_irqsave(&pci_config_lock);
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, func, offset));
+    outl(PCI_CONFIG_DATA, value);
+    spin_unlock_irqrestore(&pci_config_lock, flags);
+}
+
+/**
+ * Fill in a device from its configuration space
+ */
+static void pci_read_device(uint8_t bus, uint8_t slot, uint8_t func, uint32_t id, pci_device_t* dev) {
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->func = func;
+    dev->vendor_id = (uint16_t) id;
+    dev->device_id = (uint16_t) (id >> 16);
+    uint32_t class_reg = pci_config_read(bus, slot, func, 0x08);
+    dev->prog_if = (uint8_t) (class_reg >> 8);
+    dev->subclass = (uint8_t) (class_reg >> 16);
+    dev->class_code = (uint8_t) (class_reg >> 24);
+    dev->irq_line = (uint8_t) pci_config_read(bus, slot, func, PCI_INTERRUPT_LINE);
+    for (int i = 0; i < PCI_BARS; i++) {
+        dev->bar[i] = pci_config_read(bus, slot, func, (uint8_t) (PCI_BAR0 + i * 4));
+    }
+}
+
+/**
+ * Walk every function and return the index-th that matches
+ */
+static int pci_scan(pci_match_fn match, uint32_t a, uint32_t b, uint32_t index, pci_device_t* dev) {
+    for (uint32_t bus = 0; bus < PCI_BUSES; bus++) {
+        for (uint8_t slot = 0; slot < PCI_SLOTS; slot++) {
+            uint32_t funcs = 1;
+            for (uint8_t func = 0; func < funcs; func++) {
+                uint32_t id = pci_config_read((uint8_t) bus, slot, func, PCI_VENDOR_ID);
+                if ((id & 0xFFFF) == 0xFFFF) {
+                    continue;
+                }
+                if (func == 0) {
+                    uint32_t header = pci_config_read((uint8_t) bus, slot, 0, 0x0C) >> 16;
+                    funcs = (header & PCI_HEADER_MULTIFUNC) ? PCI_FUNCS : 1;
+                }
+                pci_read_device((uint8_t) bus, slot, func, id, dev);
+                if (match(dev, a, b) && index-- == 0) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+static bool match_class(const pci_device_t* dev, uint32_t class_code, uint32_t subclass) {
+    return dev->class_code == class_code && (subclass == 0xFF || dev->subclass == subclass);
+}
+
+static bool match_id(const pci_device_t* dev, uint32_t vendor_id, uint32_t device_id) {
+    return dev->vendor_id == vendor_id && (device_id == 0xFFFF || dev->device_id == device_id);
+}
+
+/**
+ * Find the index-th function of a class
+ */
+int pci_find_class(uint8_t class_code, uint8_t subclass, uint32_t index, pci_device_t* dev) {
+    return pci_scan(match_class, class_code, subclass, index, dev);
+}
+
+/**
+ * Find the index-th function with a vendor and device ID
+ */
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, uint32_t index, pci_device_t* dev) {
+    return pci_scan(match_id, vendor_id, device_id, index, dev);
+}
+
+/**
+ * Set the bus master bit of a function's command register
+ */
+void pci_enable_bus_master(const pci_device_t* dev) {
+    uint32_t reg = pci_config_read(dev->bus, dev->slot, dev->func, PCI_COMMAND);
+    /* The upper half is the status register: writing its bits back would clear them */
+    uint32_t command = (reg & 0xFFFF) | PCI_COMMAND_MASTER;
+    pci_config_write(dev->bus, dev->slot, dev->func, PCI_COMMAND, command);
+}
@@ -7,8 +7,187 @@
 #include <stdio.h>
 
 #include <kernel/serial.h>
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/spinlock.h>
 
 #include "../include/io.h"
+#include "../include/irq.h"
+#include "../include/interrupts.h"
+#include "../include/irqflags.h"
+
+/**
+ * Interrupt-Driven Serial I/O
+ *
+ * Polled output waits for THRE before every byte, so at 115200 baud the CPU
+ * spends ~87 us per character doing nothing. With interrupts enabled on a port:
+ *
+ *   serial_write() → copy into tx ring → return
+ *   IRQ (THRE)     → move up to 16 bytes from the ring into the FIFO
+ *   IRQ (RDA)      → move received bytes from the FIFO into the rx ring
+ *
+ * head and tail only grow and are masked on access. The queue's lock covers
+ * both rings and the UART registers, so writers on different CPUs and the
+ * IRQ handler take turns; readers additionally hold rx_wait's lock, which
+ * serializes them and lets them sleep until the RDA interrupt.
+ */
+
+typedef struct {
+    spinlock_t lock;                        /* Rings and UART registers */
+    uint16_t port;                          /* Base port address */
+    uint8_t irq;                            /* Legacy PIC line */
+    bool enabled;                           /* Rings in use */
+    bool tx_active;                         /* THRE interrupt armed */
+    volatile uint32_t tx_head;              /* Next slot to fill */
+    volatile uint32_t tx_tail;              /* Next byte to send */
+    volatile uint32_t rx_head;              /* Next slot to fill */
+    volatile uint32_t rx_tail;              /* Next byte to read */
+    uint32_t rx_dropped;                    /* Bytes lost to a full rx ring */
+    wait_queue_t rx_wait;                   /* Readers sleeping in serial_read_char() */
+    char tx[SERIAL_TX_RING_SIZE];
+    char rx[SERIAL_RX_RING_SIZE];
+} serial_queue_t;
+
+static serial_queue_t queues[] = {
+    { .port = SERIAL_COM1_BASE, .irq = 4 },
+    { .port = SERIAL_COM2_BASE, .irq = 3 },
+};
+
+/**
+ * Find the slot of a port that has ring-buffered I/O enabled
+ *
+ * @return Queue, or NULL if the port is polled
+ */
+static serial_queue_t* serial_queue(uint16_t port) {
+    for (size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++) {
+        if (queues[i].port == port) {
+            return queues[i].enabled ? &queues[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Arm or disarm the THRE interrupt (RDA stays on)
+ */
+static void serial_set_tx_interrupt(serial_queue_t* q, bool on) {
+    q->tx_active = on;
+    outb(q->port + SERIAL_INTERRUPT_ENABLE_REG, SERIAL_INT_ENABLE_RDA | (on ? SERIAL_INT_ENABLE_THRE : 0));
+}
+
+/**
+ * Refill the transmit FIFO from the tx ring if the FIFO is empty
+ */
+static void serial_tx_fill(serial_queue_t* q) {
+    if (!(inb(q->port + SERIAL_LINE_STATUS_REG) & SERIAL_LINE_STATUS_THRE)) {
+        return;
+    }
+    /* THRE means the whole FIFO is empty, so a full burst fits */
+    for (int n = 0; n < SERIAL_FIFO_DEPTH && q->tx_tail != q->tx_head; n++) {
+        outb(q->port + SERIAL_DATA_REG, q->tx[q->tx_tail & (SERIAL_TX_RING_SIZE - 1)]);
+        q->tx_tail++;
+    }
+}
+
+/**
+ * Send everything in the tx ring by polling (queue locked)
+ */
+static void serial_tx_drain(serial_queue_t* q) {
+    while (q->tx_tail != q->tx_head) {
+        serial_tx_fill(q);
+    }
+    if (q->tx_active) {
+        serial_set_tx_interrupt(q, false);
+    }
+}
+
+/**
+ * Move received bytes from the FIFO into the rx ring (queue locked)
+ */
+static void serial_rx_drain(serial_queue_t* q) {
+    while (inb(q->port + SERIAL_LINE_STATUS_REG) & SERIAL_LINE_STATUS_DR) {
+        char c = inb(q->port + SERIAL_DATA_REG);
+        if (q->rx_head - q->rx_tail == SERIAL_RX_RING_SIZE) {
+            q->rx_dropped++;
+            continue;
+        }
+        q->rx[q->rx_head & (SERIAL_RX_RING_SIZE - 1)] = c;
+        q->rx_head++;
+    }
+}
+
+/**
+ * Service every pending UART interrupt of a port
+ */
+static void serial_on_irq(serial_queue_t* q) {
+    if (!q->enabled) {
+        return;
+    }
+    bool received = false;
+    spin_lock(&q->lock);
+    uint8_t iir;
+    while (!((iir = inb(q->port + SERIAL_INTERRUPT_ID_REG)) & SERIAL_IIR_NO_INTERRUPT)) {
+        switch (iir & SERIAL_IIR_ID_MASK) {
+            case SERIAL_IIR_RDA:
+            case SERIAL_IIR_RX_TIMEOUT:
+                serial_rx_drain(q);
+                received = true;
+                break;
+            case SERIAL_IIR_THRE:
+                serial_tx_fill(q);
+                if (q->tx_tail == q->tx_head) {
+                    serial_set_tx_interrupt(q, false);
+                }
+                break;
+            case SERIAL_IIR_LINE_STATUS:
+                inb(q->port + SERIAL_LINE_STATUS_REG);
+                break;
+            default:
+                inb(q->port + SERIAL_MODEM_STATUS_REG);
+                break;
+        }
+    }
+    spin_unlock(&q->lock);
+    if (received) {
+        wake_up_boost(&q->rx_wait, SCHED_BOOST_INPUT);
+    }
+}
+
+/**
+ * IRQ 4 trampoline (COM1)
+ */
+static void serial_com1_irq(regs_t* r) {
+    (void) r;
+    serial_on_irq(&queues[0]);
+}
+
+/**
+ * IRQ 3 trampoline (COM2)
+ */
+static void serial_com2_irq(regs_t* r) {
+    (void) r;
+    serial_on_irq(&queues[1]);
+}
+
+/**
+ * Send a buffer by polling, a FIFO's worth per wait
+ *
+ * THRE is set only once the whole FIFO has drained, so after each wait up
+ * to SERIAL_FIFO_DEPTH bytes go out back to back instead of one.
+ */
+static void serial_poll_burst(uint16_t port, const char* data, size_t len) {
+    while (len > 0) {
+        while (!serial_is_transmit_empty(port)) {
+            // Busy wait
+        }
+        size_t n = len < SERIAL_FIFO_DEPTH ? len : SERIAL_FIFO_DEPTH;
+        for (size_t i = 0; i < n; i++) {
+            outb(port + SERIAL_DATA_REG, data[i]);
+        }
+        data += n;
+        len -= n;
+    }
+}
 
 /**
  * Initialize a serial port with specified baud rate
@@ -57,6 +236,50 @@ bool serial_is_transmit_empty(uint16_t port) {
     return inb(port + SERIAL_LINE_STATUS_REG) & SERIAL_LINE_STATUS_THRE;
 }
 
+/**
+ * Send a buffer over the serial port
+ *
+ * On a ring-buffered port this only copies into the tx ring; it waits only
+ * when the ring is full. With interrupts disabled (e.g. in a panic) nothing
+ * would drain the ring, so the ring is flushed and the data is polled out
+ * in FIFO-sized bursts.
+ *
+ * @param port Base port address
+ * @param data Bytes to send
+ * @param len Number of bytes
+ */
+void serial_write(uint16_t port, const char* data, size_t len) {
+    serial_queue_t* q = serial_queue(port);
+    if (q == NULL) {
+        serial_poll_burst(port, data, len);
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&q->lock);
+    if (!(flags & EFLAGS_IF)) {
+        /* Keep the byte order: queued output goes first */
+        serial_tx_drain(q);
+        serial_poll_burst(port, data, len);
+        spin_unlock_irqrestore(&q->lock, flags);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        while (q->tx_head - q->tx_tail == SERIAL_TX_RING_SIZE) {
+            /* Ring full: push the FIFO ourselves while interrupts are off */
+            serial_tx_fill(q);
+        }
+        q->tx[q->tx_head & (SERIAL_TX_RING_SIZE - 1)] = data[i];
+        q->tx_head++;
+    }
+    if (!q->tx_active) {
+        /* Start the first burst; THRE interrupts keep it going */
+        serial_tx_fill(q);
+        if (q->tx_tail != q->tx_head) {
+            serial_set_tx_interrupt(q, true);
+        }
+    }
+    spin_unlock_irqrestore(&q->lock, flags);
+}
+
 /**
  * Send a single character over the serial port
  *
@@ -64,11 +287,7 @@ bool serial_is_transmit_empty(uint16_t port) {
  * @param c Character to send
  */
 void serial_write_char(uint16_t port, char c) {
-    // Wait for the transmit buffer to be empty
-    while (!serial_is_transmit_empty(port)) {
-        // Busy wait
-    }
-    outb(port + SERIAL_DATA_REG, c);
+    serial_write(port, &c, 1);
 }
 
 /**
@@ -78,10 +297,69 @@ void serial_write_char(uint16_t port, char c) {
  * @param str Null-terminated string to send
  */
 void serial_write_string(uint16_t port, const char* str) {
-    while (*str) {
-        serial_write_char(port, *str);
-        str++;
+    serial_write(port, str, strlen(str));
+}
+
+/**
+ * vformat() sink sending a chunk over the port in ctx
+ */
+static int serial_printf_sink(void* ctx, const char* data, size_t len) {
+    serial_write((uint16_t) (uint32_t) ctx, data, len);
+    return 0;
+}
+
+/**
+ * Send formatted output to the serial port
+ *
+ * @param port Base port address
+ * @param format Format string (see vformat())
+ * @return Number of characters written
+ */
+int serial_printf(uint16_t port, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = vformat(serial_printf_sink, (void*) (uint32_t) port, format, args);
+    va_end(args);
+    return written;
+}
+
+/**
+ * Wait until every queued byte has left the transmitter
+ *
+ * @param port Base port address
+ */
+void serial_flush(uint16_t port) {
+    serial_queue_t* q = serial_queue(port);
+    if (q != NULL) {
+        uint32_t flags = spin_lock_irqsave(&q->lock);
+        serial_tx_drain(q);
+        spin_unlock_irqrestore(&q->lock, flags);
     }
+    while (!(inb(port + SERIAL_LINE_STATUS_REG) & SERIAL_LINE_STATUS_TEMT)) {
+        // Busy wait
+    }
+}
+
+/**
+ * Number of bytes waiting in the TX ring
+ *
+ * @param port Base port address
+ * @return Queued bytes, 0 for polled ports
+ */
+size_t serial_tx_pending(uint16_t port) {
+    serial_queue_t* q = serial_queue(port);
+    return q != NULL ? q->tx_head - q->tx_tail : 0;
+}
+
+/**
+ * Number of received bytes dropped because the RX ring was full
+ *
+ * @param port Base port address
+ * @return Dropped bytes, 0 for polled ports
+ */
+uint32_t serial_rx_dropped(uint16_t port) {
+    serial_queue_t* q = serial_queue(port);
+    return q != NULL ? q->rx_dropped : 0;
 }
 
 /**
@@ -91,21 +369,49 @@ void serial_write_string(uint16_t port, const char* str) {
  * @return true if data is available, false otherwise
  */
 bool serial_has_received(uint16_t port) {
+    serial_queue_t* q = serial_queue(port);
+    if (q != NULL && q->rx_tail != q->rx_head) {
+        return true;
+    }
     return inb(port + SERIAL_LINE_STATUS_REG) & SERIAL_LINE_STATUS_DR;
 }
 
 /**
  * Read a single character from the serial port
  *
+ * A ring-buffered port blocks the calling thread until the RDA interrupt delivers data.
+ *
  * @param port Base port address
  * @return Character read from the port
  */
 char serial_read_char(uint16_t port) {
-    // Wait for data to be available
-    while (!serial_has_received(port)) {
-        // Busy wait
+    serial_queue_t* q = serial_queue(port);
+    if (q == NULL) {
+        // Wait for data to be available
+        while (!serial_has_received(port)) {
+            // Busy wait
+        }
+        return inb(port + SERIAL_DATA_REG);
     }
-    return inb(port + SERIAL_DATA_REG);
+    bool can_sleep = irqs_enabled();
+    uint32_t flags = wait_begin(&q->rx_wait);
+    while (q->rx_tail == q->rx_head) {
+        if (can_sleep) {
+            /* Other threads run meanwhile; the RDA interrupt wakes us */
+            wait_sleep(&q->rx_wait);
+        }
+        else {
+            spin_lock(&q->lock);
+            serial_rx_drain(q);
+            spin_unlock(&q->lock);
+        }
+    }
+    spin_lock(&q->lock);
+    char c = q->rx[q->rx_tail & (SERIAL_RX_RING_SIZE - 1)];
+    q->rx_tail++;
+    spin_unlock(&q->lock);
+    wait_end(&q->rx_wait, flags);
+    return c;
 }
 
 /**
@@ -114,6 +420,17 @@ char serial_read_char(uint16_t port) {
  * @param port Base port address
  */
 void serial_enable_interrupts(uint16_t port) {
+    for (size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++) {
+        serial_queue_t* q = &queues[i];
+        if (q->port == port && !q->enabled) {
+            q->tx_head = q->tx_tail = 0;
+            q->rx_head = q->rx_tail = 0;
+            q->rx_dropped = 0;
+            q->tx_active = false;
+            q->enabled = true;
+            reqister_irq(q->irq, q->irq == 4 ? serial_com1_irq : serial_com2_irq);
+        }
+    }
     // Enable received data available interrupt
     outb(port + SERIAL_INTERRUPT_ENABLE_REG, SERIAL_INT_ENABLE_RDA);
 }
@@ -124,17 +441,24 @@ void serial_enable_interrupts(uint16_t port) {
  * @param port Base port address
  */
 void serial_disable_interrupts(uint16_t port) {
+    serial_queue_t* q = serial_queue(port);
+    if (q != NULL) {
+        serial_flush(port);
+        q->enabled = false;
+        unregister_irq(q->irq);
+    }
     outb(port + SERIAL_INTERRUPT_ENABLE_REG, SERIAL_INT_DISABLE_ALL);
 }
 
 /**
- * Initialize serial port and print status messages
+ * Initialize serial port, enable its interrupts and print status messages
  *
  * @param port 			Base port address
  * @param baud_divisor	Baud rate divisor
  */
 void serial_initialize(uint16_t port, uint16_t baud_divisor) {
-    if (serial_setup(port, baud_divisor)) {
+    if (serial_setup(port, baud_divisor) == 0) {
+        serial_enable_interrupts(port);
         printf("Serial port initialization successful!\n");
         printf("Serial port: 0x%x, Serial Baud Rate: %d\n", port, 115200 / baud_divisor);
         serial_write_string(port, "=======================================\n");
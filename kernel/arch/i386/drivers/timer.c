@@ -0,0 +1,646 @@
+/**
+ * Programmable Interval Timer (Intel 8253/8254) Driver
+ *
+ * Channel 0 is wired to IRQ 0. Loaded with a divisor N in rate generator
+ * mode, it fires PIT_BASE_HZ / N times per second.
+ *
+ * Clock:
+ *
+ *   IRQ 0  → ticks++, remember (tsc, ns) of this tick
+ *   ktime_ns() = ns of last tick + TSC cycles since then, converted to ns
+ *
+ * The interpolated part is capped at one tick period, so the clock never
+ * runs past the next tick and stays monotonic even if the TSC calibration
+ * is slightly off.
+ *
+ * The clock state lives in its own page (kernel/vclock.h), which processes
+ * map read-only to read the time without a system call.
+ *
+ * With the APIC in charge (kernel/apic.h), the LAPIC timer takes over as
+ * the tick source: its rate is measured against the same PIT ticks as the
+ * TSC, it is loaded with the counts of one PIT period and fires vector 32,
+ * so ticks keep arriving as IRQ 0 and keep their length. The PIT's IOAPIC
+ * pin is masked. A tick is then acknowledged with one MMIO store.
+ *
+ * Timer wheel (4 levels of 64 slots, each level 64 times as coarse as the one below):
+ *
+ *   level 0  slot = expires & 63          due within 64 ticks
+ *   level 1  slot = (expires >> 6) & 63   within 4096 ticks
+ *   level 2  slot = (expires >> 12) & 63  within 262144 ticks
+ *   level 3  slot = (expires >> 18) & 63  later; beyond its range a timer waits in
+ *                                         the last slot and is inserted again
+ *
+ *   timer_add(): level from expires - wheel_next → push onto the slot   O(1)
+ *   tick T:      T a multiple of 64^L → redistribute level L's current slot
+ *                one level down (cascade) → run level 0's slot T & 63
+ *
+ * Tickless idle (LAPIC timer with a calibrated TSC, boot CPU only):
+ *
+ *   idle thread: timer_idle_enter() → next expiry more than a tick away?
+ *     → one interrupt at the TSC value of that tick (TSC-deadline mode, else
+ *       a one-shot count) → hlt
+ *   IRQ 0:       ticks += whole tick periods passed on the TSC → periodic again
+ *   other IRQ:   timer_irq_enter() catches the clock up the same way and arms
+ *                the next tick boundary, where the periodic tick resumes
+ *
+ * Stopped ticks stay on the grid of tick_cycles TSC cycles, so the clock
+ * neither gains nor loses time across an idle period.
+ *
+ * Reference: https://wiki.osdev.org/Programmable_Interval_Timer
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/spinlock.h>
+#include <kernel/smp.h>
+#include <kernel/vclock.h>
+#include <kernel/paging.h>
+#include <kernel/process.h>
+#include <kernel/klog.h>
+
+#include "../include/irq.h"
+#include "../include/io.h"
+#include "../include/interrupts.h"
+#include "../include/cpuid.h"
+#include "../include/tsc.h"
+#include "../include/irqflags.h"
+#include "../include/apic.h"
+
+/* PIT I/O ports */
+#define PIT_CHANNEL0_PORT       0x40    /* Channel 0 data (IRQ 0) */
+#define PIT_COMMAND_PORT        0x43    /* Mode/command register */
+
+/* Command: channel 0, lobyte/hibyte access, mode 2 (rate generator), binary */
+#define PIT_CMD_CHANNEL0_RATE   0x34
+
+/* Calibrate the TSC over this long (in ticks, at least 1) */
+#define TIMER_CALIBRATE_MS      20
+
+/* Fixed-point shift for the cycles → ns multiplier */
+#define TSC_NS_SHIFT            24
+
+#define NS_PER_SEC              1000000000ULL
+
+/* Timer wheel geometry */
+#define WHEEL_BITS              6
+#define WHEEL_SIZE              (1u << WHEEL_BITS)
+#define WHEEL_MASK              (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS            4
+#define WHEEL_RANGE             (1ull << (WHEEL_BITS * WHEEL_LEVELS))   /* Ticks the wheel reaches ahead */
+
+/* Longest stopped tick, so late timers cost no more than this much catching up */
+#define TIMER_IDLE_MAX_MS       1000
+
+#define TIMER_VECTOR            32      /* IRQ 0 */
+
+/* How ticks arrive (tickless idle only ever leaves TICK_PERIODIC on the LAPIC timer) */
+typedef enum {
+    TICK_PERIODIC,              /* One interrupt per tick */
+    TICK_STOPPED,               /* Idle: one interrupt armed for the next timer expiry */
+    TICK_RESYNC,                /* Woken early: one interrupt armed for the next tick boundary */
+} tick_mode_t;
+
+static uint32_t pit_divisor = 0;        /* Loaded into channel 0 */
+static bool has_tsc = false;            /* CPU has rdtsc */
+static uint32_t lapic_counts = 0;       /* LAPIC timer counts per PIT period, 0 if not measured */
+
+/*
+ * Clock state, alone in its page because processes map it. seq, ticks,
+ * tick_tsc and tick_time are written only by the IRQ handler; readers retry
+ * while seq is odd or changed.
+ */
+static union {
+    vclock_t clock;
+    uint8_t bytes[PAGE_SIZE];
+} clock_page __attribute__((aligned(PAGE_SIZE)));
+static vclock_t* const clock = &clock_page.clock;
+static bool clock_page_pinned = false;  /* The kernel holds a reference, see vclock_map() */
+
+/* Pending timers; wheel_next is the next tick whose slot hasn't run */
+static ktimer_t* wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static uint64_t wheel_next = 1;
+static uint32_t wheel_count = 0;
+static spinlock_t wheel_lock = SPINLOCK_INIT;
+
+/* Tickless idle; tick_mode is only touched by the boot CPU with interrupts disabled */
+static bool tickless = false;
+static bool tsc_deadline = false;       /* Arm with an absolute TSC value instead of LAPIC counts */
+static uint64_t tick_cycles = 0;        /* TSC cycles per tick */
+static uint32_t idle_max_ticks = 0;     /* Longest stopped tick */
+static tick_mode_t tick_mode = TICK_PERIODIC;
+static uint64_t tick_irqs = 0;
+static uint64_t idle_stops = 0;
+
+static uint64_t min_gap_cycles = 0;
+static uint64_t max_gap_cycles = 0;
+
+/**
+ * Time of a tick count in ns, exact in PIT input cycles
+ */
+static uint64_t ticks_to_ns(uint64_t count) {
+    uint64_t cycles = count * pit_divisor;
+    return cycles / PIT_BASE_HZ * NS_PER_SEC + cycles % PIT_BASE_HZ * NS_PER_SEC / PIT_BASE_HZ;
+}
+
+/**
+ * Convert TSC cycles to ns (0 before calibration)
+ */
+static uint64_t tsc_to_ns(uint64_t cycles) {
+    return (cycles * clock->tsc_ns_mult) >> TSC_NS_SHIFT;
+}
+
+/**
+ * First tick whose time is at or past ns
+ */
+static uint64_t ns_to_tick(uint64_t ns) {
+    if (clock->tick_ns == 0) {
+        return 0;   /* timer_initialize() hasn't run: due at the first tick */
+    }
+    /* tick_ns is rounded, so the estimate can be off by a few ticks after a long uptime */
+    uint64_t tick = ns / clock->tick_ns;
+    while (ticks_to_ns(tick) < ns) {
+        tick++;
+    }
+    while (tick > 0 && ticks_to_ns(tick - 1) >= ns) {
+        tick--;
+    }
+    return tick;
+}
+
+/**
+ * Advance the clock by count ticks, the last of which happened at TSC value tsc
+ */
+static void clock_advance(uint64_t count, uint64_t tsc) {
+    clock->seq++;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    clock->ticks += count;
+    clock->tick_tsc = tsc;
+    clock->tick_time = ticks_to_ns(clock->ticks);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    clock->seq++;
+}
+
+/**
+ * Push a timer onto the wheel slot of its expiry (wheel_lock held)
+ */
+static void wheel_insert(ktimer_t* timer) {
+    uint64_t expires = timer->expires < wheel_next ? wheel_next : timer->expires;
+    uint64_t delta = expires - wheel_next;
+    if (delta >= WHEEL_RANGE) {
+        /* Parked in the farthest slot; the run loop inserts it again when it comes up */
+        expires = wheel_next + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+    uint32_t level = 0;
+    while (delta >= (1ull << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    ktimer_t** slot = &wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    timer->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->pprev = &timer->next;
+    }
+    *slot = timer;
+    __atomic_store_n(&timer->pprev, slot, __ATOMIC_RELEASE);
+    wheel_count++;
+}
+
+/**
+ * Take a pending timer off its slot (wheel_lock held)
+ */
+static void wheel_remove(ktimer_t* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    __atomic_store_n(&timer->pprev, NULL, __ATOMIC_RELEASE);
+    wheel_count--;
+}
+
+/**
+ * Run every timer due up to tick now, cascading the upper levels on the way (timer IRQ)
+ */
+static void wheel_run(uint64_t now) {
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    while (wheel_next <= now) {
+        uint64_t tick = wheel_next;
+        for (uint32_t level = 1; level < WHEEL_LEVELS; level++) {
+            if (tick & ((1ull << (WHEEL_BITS * level)) - 1)) {
+                break;
+            }
+            ktimer_t** slot = &wheel[level][(tick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+            ktimer_t* timer;
+            while ((timer = *slot) != NULL) {
+                /* Due within this level's span, so it lands lower (parked ones park again) */
+                wheel_remove(timer);
+                wheel_insert(timer);
+            }
+        }
+        /* From here on timer_add() places timers relative to the next tick, never into this slot */
+        wheel_next = tick + 1;
+        ktimer_t** slot = &wheel[0][tick & WHEEL_MASK];
+        ktimer_t* timer;
+        while ((timer = *slot) != NULL) {
+            wheel_remove(timer);
+            void (*func)(void*) = timer->func;
+            void* data = timer->data;
+            /* func may add or delete timers, this one included */
+            spin_unlock_irqrestore(&wheel_lock, flags);
+            func(data);
+            flags = spin_lock_irqsave(&wheel_lock);
+        }
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+}
+
+/**
+ * Earliest tick a pending timer is due at, UINT64_MAX if there is none
+ */
+static uint64_t wheel_next_expiry(void) {
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    uint64_t next = UINT64_MAX;
+    /* Level 0 holds ticks wheel_next .. wheel_next + 63, one per slot */
+    for (uint32_t i = 0; i < WHEEL_SIZE; i++) {
+        if (wheel[0][(wheel_next + i) & WHEEL_MASK] != NULL) {
+            next = wheel_next + i;
+            break;
+        }
+    }
+    /* Upper-level timers that haven't cascaded yet may still be due sooner */
+    for (uint32_t level = 1; level < WHEEL_LEVELS; level++) {
+        for (uint32_t i = 0; i < WHEEL_SIZE; i++) {
+            for (ktimer_t* timer = wheel[level][i]; timer != NULL; timer = timer->next) {
+                if (timer->expires < next) {
+                    next = timer->expires;
+                }
+            }
+        }
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+    return next < wheel_next ? wheel_next : next;
+}
+
+/**
+ * Arm the LAPIC timer to fire once at a TSC value
+ */
+static void tick_arm(uint64_t target) {
+    if (tsc_deadline) {
+        lapic_timer_deadline(target, TIMER_VECTOR);
+        return;
+    }
+    uint64_t now = rdtsc();
+    uint64_t cycles = target > now ? target - now : 0;
+    /* Round up: firing a little late lands in the right tick, early would not */
+    uint64_t counts = (cycles * lapic_counts + tick_cycles - 1) / tick_cycles;
+    lapic_timer_oneshot(counts > UINT32_MAX ? UINT32_MAX : (uint32_t) counts, TIMER_VECTOR);
+}
+
+/**
+ * Count the ticks that passed on the TSC since the last one the clock knows of
+ *
+ * @return Ticks added
+ */
+static uint64_t tick_catch_up(uint64_t now) {
+    uint64_t passed = (now - clock->tick_tsc) / tick_cycles;
+    if (passed > 0) {
+        clock_advance(passed, clock->tick_tsc + passed * tick_cycles);
+    }
+    return passed;
+}
+
+/**
+ * IRQ 0 handler: advance the tick count, record tick statistics and run due timers
+ *
+ * @param r Saved CPU register state (unused)
+ */
+static void timer_on_irq(regs_t* r) {
+    (void) r;
+    uint64_t now = has_tsc ? rdtsc() : 0;
+    tick_irqs++;
+    if (tick_mode != TICK_PERIODIC) {
+        if (tick_catch_up(now) == 0) {
+            /* Rounding made the one-shot fire just before the boundary */
+            tick_arm(clock->tick_tsc + tick_cycles);
+            tick_mode = TICK_RESYNC;
+            return;
+        }
+        lapic_timer_periodic(lapic_counts, TIMER_VECTOR);
+        tick_mode = TICK_PERIODIC;
+    }
+    else {
+        if (clock->tsc_hz && clock->ticks > 1) {
+            uint64_t gap = now - clock->tick_tsc;
+            if (min_gap_cycles == 0 || gap < min_gap_cycles) {
+                min_gap_cycles = gap;
+            }
+            if (gap > max_gap_cycles) {
+                max_gap_cycles = gap;
+            }
+        }
+        clock_advance(1, now);
+    }
+    wheel_run(clock->ticks);
+}
+
+/**
+ * Stop the tick until the next timer expiry
+ */
+void timer_idle_enter(void) {
+    if (!tickless || tick_mode == TICK_STOPPED || smp_processor_id() != 0) {
+        return;
+    }
+    uint64_t ticks = clock->ticks;
+    uint64_t next = wheel_next_expiry();
+    if (next <= ticks + 1) {
+        return;     /* Due at the next tick anyway (or a resync is on its way) */
+    }
+    uint64_t span = next - ticks;
+    if (span > idle_max_ticks) {
+        span = idle_max_ticks;
+    }
+    tick_arm(clock->tick_tsc + span * tick_cycles);
+    tick_mode = TICK_STOPPED;
+    idle_stops++;
+}
+
+/**
+ * Bring the clock up to date after waking from a stopped tick
+ */
+void timer_irq_enter(void) {
+    if (tick_mode != TICK_STOPPED || smp_processor_id() != 0) {
+        return;
+    }
+    tick_catch_up(rdtsc());
+    /* Due timers can't have been skipped: the one-shot was armed for the first of them */
+    tick_arm(clock->tick_tsc + tick_cycles);
+    tick_mode = TICK_RESYNC;
+}
+
+/**
+ * Measure the TSC frequency, and the LAPIC timer's rate if the APIC is in use, against PIT ticks
+ *
+ * @param hz Tick rate the PIT was programmed with
+ */
+static void timer_calibrate(uint32_t hz) {
+    bool lapic = apic_enabled();
+    if ((!has_tsc && !lapic) || !irqs_enabled()) {
+        return;
+    }
+    uint32_t span = hz * TIMER_CALIBRATE_MS / 1000;
+    if (span == 0) {
+        span = 1;
+    }
+    /* Start on a tick edge so the window is a whole number of ticks */
+    uint64_t start_tick = timer_ticks();
+    while (timer_ticks() == start_tick) {
+        asm volatile("hlt");
+    }
+    uint64_t tsc_start = has_tsc ? rdtsc() : 0;
+    if (lapic) {
+        lapic_timer_count_start();
+    }
+    start_tick = timer_ticks();
+    while (timer_ticks() - start_tick < span) {
+        asm volatile("hlt");
+    }
+    uint64_t cycles = has_tsc ? rdtsc() - tsc_start : 0;
+    if (lapic) {
+        lapic_counts = (lapic_timer_elapsed() + span / 2) / span;
+    }
+    uint64_t pit_cycles = (uint64_t) span * pit_divisor;
+    uint64_t hz_measured = cycles * PIT_BASE_HZ / pit_cycles;
+    if (hz_measured == 0) {
+        return;
+    }
+    clock->tsc_ns_mult = (NS_PER_SEC << TSC_NS_SHIFT) / hz_measured;
+    clock->tsc_hz = hz_measured;
+    /* Readers only interpolate once the multiplier is in place */
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    clock->flags |= VCLOCK_TSC;
+}
+
+/**
+ * Hand the tick over from the PIT to the LAPIC timer
+ *
+ * @return true if the LAPIC timer now drives IRQ 0
+ */
+static bool timer_switch_to_lapic(void) {
+    if (!apic_enabled() || lapic_counts == 0) {
+        return false;
+    }
+    uint32_t flags = irq_save();
+    ioapic_mask_irq(0);
+    lapic_timer_periodic(lapic_counts, TIMER_VECTOR);
+    irq_restore(flags);
+    return true;
+}
+
+/**
+ * Program the PIT, register the IRQ 0 handler and calibrate the TSC
+ *
+ * @param hz Tick rate (19 Hz - 1193182 Hz)
+ */
+void timer_initialize(uint32_t hz) {
+    if (hz == 0) {
+        hz = TIMER_DEFAULT_HZ;
+    }
+    uint32_t divisor = (PIT_BASE_HZ + hz / 2) / hz;
+    if (divisor == 0) {
+        divisor = 1;
+    }
+    if (divisor > 0xFFFF) {
+        divisor = 0xFFFF;
+    }
+    pit_divisor = divisor;
+    clock->version = VCLOCK_VERSION;
+    clock->tsc_ns_shift = TSC_NS_SHIFT;
+    clock->tick_ns = (uint32_t) ticks_to_ns(1);
+    clock->hz = PIT_BASE_HZ / divisor;
+    has_tsc = cpuid_has_edx(CPUID_EDX_TSC);
+
+    outb(PIT_COMMAND_PORT, PIT_CMD_CHANNEL0_RATE);
+    outb(PIT_CHANNEL0_PORT, divisor & 0xFF);
+    outb(PIT_CHANNEL0_PORT, (divisor >> 8) & 0xFF);
+    reqister_irq(0, timer_on_irq);
+
+    timer_calibrate(PIT_BASE_HZ / divisor);
+    bool lapic = timer_switch_to_lapic();
+    const char* source = lapic ? "LAPIC timer" : "IRQ 0";
+    tick_cycles = clock->tsc_hz * divisor / PIT_BASE_HZ;
+    if (lapic && tick_cycles != 0) {
+        /* The one-shot count must fit the 32-bit initial count register */
+        idle_max_ticks = clock->hz * TIMER_IDLE_MAX_MS / 1000;
+        if (idle_max_ticks > UINT32_MAX / lapic_counts) {
+            idle_max_ticks = UINT32_MAX / lapic_counts;
+        }
+        tsc_deadline = cpuid_has_ecx(CPUID_ECX_TSC_DEADLINE);
+        tickless = idle_max_ticks > 1;
+    }
+    if (clock->tsc_hz) {
+        klog(KLOG_INFO, "[  OK  ] Timer initialized (%s, %u Hz, TSC %u MHz%s).\n", source, PIT_BASE_HZ / divisor,
+                        (uint32_t) (clock->tsc_hz / 1000000),
+                        !tickless ? "" : tsc_deadline ? ", tickless idle via TSC deadline" : ", tickless idle");
+    }
+    else {
+        klog(KLOG_INFO, "[  OK  ] Timer initialized (%s, %u Hz, no TSC).\n", source, PIT_BASE_HZ / divisor);
+    }
+}
+
+/**
+ * Start the scheduler tick on an application processor
+ */
+void timer_init_cpu(void) {
+    if (apic_enabled() && lapic_counts != 0) {
+        lapic_timer_periodic(lapic_counts, LAPIC_TICK_VECTOR);
+    }
+}
+
+/**
+ * Number of timer ticks since timer_initialize()
+ */
+uint64_t timer_ticks(void) {
+    uint32_t seq;
+    uint64_t count;
+    do {
+        seq = clock->seq;
+        count = clock->ticks;
+    } while ((seq & 1) || seq != clock->seq);
+    return count;
+}
+
+/**
+ * Monotonic clock in ns since timer_initialize()
+ */
+uint64_t ktime_ns(void) {
+    uint32_t seq;
+    uint64_t base, at;
+    do {
+        seq = clock->seq;
+        base = clock->tick_time;
+        at = clock->tick_tsc;
+    } while ((seq & 1) || seq != clock->seq);
+    if (clock->tsc_hz == 0) {
+        return base;
+    }
+    uint64_t offset = tsc_to_ns(rdtsc() - at);
+    return base + (offset < clock->tick_ns ? offset : clock->tick_ns);
+}
+
+/**
+ * Prepare a timer
+ */
+void timer_setup(ktimer_t* timer, void (*func)(void* data), void* data) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->func = func;
+    timer->data = data;
+}
+
+/**
+ * Start or move a timer
+ */
+void timer_add(ktimer_t* timer, uint64_t deadline_ns) {
+    uint64_t expires = ns_to_tick(deadline_ns);
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    if (timer->pprev != NULL) {
+        wheel_remove(timer);
+    }
+    timer->expires = expires;
+    wheel_insert(timer);
+    spin_unlock_irqrestore(&wheel_lock, flags);
+}
+
+/**
+ * Stop a timer
+ */
+bool timer_del(ktimer_t* timer) {
+    uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    bool pending = timer->pprev != NULL;
+    if (pending) {
+        wheel_remove(timer);
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+    return pending;
+}
+
+/* A ksleep() in progress; lives on the sleeper's stack */
+typedef struct {
+    wait_queue_t wait;
+    bool done;                          /* Set by the timer, under wait's lock */
+} ksleep_t;
+
+/**
+ * Timer callback of ksleep(): wake the sleeper
+ *
+ * done is set under the queue's lock and the sleeper only checks it under the
+ * same lock, so the sleeper can't return (and its stack frame disappear)
+ * while the callback on another CPU still holds the lock.
+ */
+static void ksleep_wake(void* data) {
+    ksleep_t* sleep = (ksleep_t*) data;
+    uint32_t flags = wait_begin(&sleep->wait);
+    sleep->done = true;
+    wake_up_locked(&sleep->wait);
+    wait_end(&sleep->wait, flags);
+}
+
+/**
+ * Sleep for at least ms milliseconds
+ */
+void ksleep(uint32_t ms) {
+    uint64_t deadline = ktime_ns() + (uint64_t) ms * 1000000;
+    ksleep_t sleep = { WAIT_QUEUE_INIT, false };
+    ktimer_t timer;
+    timer_setup(&timer, ksleep_wake, &sleep);
+    timer_add(&timer, deadline);
+    uint32_t flags = wait_begin(&sleep.wait);
+    while (!sleep.done) {
+        wait_sleep(&sleep.wait);
+    }
+    wait_end(&sleep.wait, flags);
+}
+
+/**
+ * Get tick statistics
+ */
+void timer_get_stats(timer_stats_t* stats) {
+    stats->ticks = timer_ticks();
+    stats->hz = pit_divisor ? PIT_BASE_HZ / pit_divisor : 0;
+    stats->tsc_hz = clock->tsc_hz;
+    stats->min_gap_ns = tsc_to_ns(min_gap_cycles);
+    stats->max_gap_ns = tsc_to_ns(max_gap_cycles);
+    stats->tick_irqs = tick_irqs;
+    stats->idle_stops = idle_stops;
+    stats->timers_pending = wheel_count;
+    stats->tickless = tickless;
+    stats->tsc_deadline = tsc_deadline;
+}
+
+/**
+ * Map the clock page read-only into the current address space
+ */
+int vclock_map(void) {
+    uint32_t frame = (uint32_t) &clock_page;    /* Kernel image is identity-mapped */
+    if (!clock_page_pinned) {
+        /* Our own reference: the page is part of the kernel image and must never reach the allocator */
+        if (frame_ref(frame) != 0) {
+            return -1;
+        }
+        clock_page_pinned = true;
+    }
+    if (frame_ref(frame) != 0) {
+        return -1;
+    }
+    if (paging_map(USER_VCLOCK_BASE, frame, PTE_USER) != 0) {
+        frame_release(frame);
+        return -1;
+    }
+    return 0;
+}
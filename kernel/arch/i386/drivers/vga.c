@@ -1,13 +1,122 @@
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/fbcon.h>
 
 #include "../include/vga.h"
+#include "../include/irqflags.h"
+
+/**
+ * Shadow Text Buffer with Scrollback
+ *
+ * All writes go to a RAM copy of the screen kept as a ring of lines; VGA
+ * memory is only written by vga_flush(), and only for the span of columns
+ * marked dirty on each row. Scrolling moves the ring's top index instead of
+ * copying the rows through MMIO, and the lines that scroll off stay in the
+ * ring as history:
+ *
+ *   shadow ring (VGA_RING_LINES)
+ *   ┌──────────────┐
+ *   │ history      │  ← oldest line
+ *   │ ...          │
+ *   ├──────────────┤ ← ring_top (screen row 0)
+ *   │ screen rows  │
+ *   │ 0 .. rows-1  │
+ *   └──────────────┘    (indices wrap around)
+ *
+ * The grid is 80x25 for VGA text mode. The framebuffer console (fbcon.c)
+ * makes it larger and takes the dirty spans instead of VGA memory; it draws
+ * the cursor too, since there is no hardware one.
+ */
 
 /* Pointer to the VGA text buffer */
 static uint16_t* terminal_buffer;
 /* Extern from tty.c */
 extern uint8_t terminal_color;
 
+/* Text grid (VGA_WIDTH x VGA_HEIGHT in text mode) */
+size_t console_cols = 80;
+size_t console_rows = 25;
+
+/* Shadow lines: the visible screen plus scrollback history */
+static uint16_t shadow[VGA_RING_LINES][CONSOLE_MAX_COLS];
+/* Ring index of screen row 0 */
+static size_t ring_top;
+/* Lines of history above the screen */
+static size_t history_lines;
+/* Lines the view is scrolled back (0 = showing the live screen) */
+static size_t view_offset;
+/* One bit per screen row whose shadow differs from the screen ... */
+static uint32_t dirty_rows[CONSOLE_MAX_ROWS / 32];
+/* ... in columns [dirty_start, dirty_end) of that row */
+static uint16_t dirty_start[CONSOLE_MAX_ROWS];
+static uint16_t dirty_end[CONSOLE_MAX_ROWS];
+/* Cursor cell (row * console_cols + column), drawn by fbcon */
+static size_t cursor_pos;
+
+/**
+ * Get the shadow line shown at a screen row, 'back' lines into history
+ */
+static inline uint16_t* shadow_line(size_t row, size_t back) {
+    return shadow[(ring_top + VGA_RING_LINES + row - back) % VGA_RING_LINES];
+}
+
+/**
+ * Fill columns [from, console_cols) of a shadow line with blanks in the current color
+ */
+static void shadow_clear_line(uint16_t* line, size_t from) {
+    const uint16_t blank = vga_entry(' ', terminal_color);
+    for (size_t x = from; x < console_cols; x++) {
+        line[x] = blank;
+    }
+}
+
+/**
+ * Add columns [x0, x1) of a screen row to what the next flush draws
+ */
+static inline void mark_dirty(size_t y, size_t x0, size_t x1) {
+    uint32_t bit = 1u << (y % 32);
+    if (!(dirty_rows[y / 32] & bit)) {
+        dirty_rows[y / 32] |= bit;
+        dirty_start[y] = (uint16_t) x0;
+        dirty_end[y] = (uint16_t) x1;
+        return;
+    }
+    if (x0 < dirty_start[y]) {
+        dirty_start[y] = (uint16_t) x0;
+    }
+    if (x1 > dirty_end[y]) {
+        dirty_end[y] = (uint16_t) x1;
+    }
+}
+
+/**
+ * Mark the whole screen dirty
+ */
+static void mark_all_dirty(void) {
+    for (size_t y = 0; y < console_rows; y++) {
+        dirty_start[y] = 0;
+        dirty_end[y] = (uint16_t) console_cols;
+    }
+    for (size_t i = 0; i < CONSOLE_MAX_ROWS / 32; i++) {
+        size_t first = i * 32;
+        size_t count = console_rows > first ? console_rows - first : 0;
+        dirty_rows[i] = count >= 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+    }
+}
+
+/**
+ * Return to the live screen before it is modified
+ */
+static inline void vga_follow_output(void) {
+    if (view_offset != 0) {
+        view_offset = 0;
+        mark_all_dirty();
+    }
+}
+
 /**
  * Initialize VGA hardware
  *
@@ -17,11 +126,19 @@ extern uint8_t terminal_color;
  */
 void vga_initialize(void) {
     terminal_buffer = VGA_MEMORY;
+    ring_top = 0;
+    history_lines = 0;
+    view_offset = 0;
+    cursor_pos = 0;
     // Clear the screen
-    for (size_t i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        terminal_buffer[i] = vga_entry(' ', terminal_color);
+    for (size_t y = 0; y < console_rows; y++) {
+        shadow_clear_line(shadow_line(y, 0), 0);
+    }
+    mark_all_dirty();
+    vga_flush();
+    if (!fbcon_active()) {
+        vga_update_cursor(0);
     }
-    vga_update_cursor(0);
 }
 
 /**
@@ -29,41 +146,151 @@ void vga_initialize(void) {
  *
  * @param c     Character to write
  * @param color Combined foreground/background color attribute
- * @param x     Column position (0 to VGA_WIDTH - 1)
- * @param y     Row position (0 to VGA_HEIGHT - 1)
+ * @param x     Column position (0 to console_cols - 1)
+ * @param y     Row position (0 to console_rows - 1)
  */
 void vga_write_char_at(unsigned char c, uint8_t color, size_t x, size_t y) {
-    const size_t index = y * VGA_WIDTH + x;
-    terminal_buffer[index] = vga_entry(c, color);
+    vga_follow_output();
+    shadow_line(y, 0)[x] = vga_entry(c, color);
+    mark_dirty(y, x, x + 1);
+}
+
+/**
+ * Write a run of characters on one row, starting at a position
+ *
+ * @param data  Characters to write (no control characters)
+ * @param size  Number of characters (must fit before the end of the row)
+ * @param color Combined foreground/background color attribute
+ * @param x     Column of the first character
+ * @param y     Row position (0 to console_rows - 1)
+ */
+void vga_write_run_at(const char* data, size_t size, uint8_t color, size_t x, size_t y) {
+    vga_follow_output();
+    uint16_t* cell = shadow_line(y, 0) + x;
+    for (size_t i = 0; i < size; i++) {
+        cell[i] = vga_entry((unsigned char) data[i], color);
+    }
+    mark_dirty(y, x, x + size);
 }
 
 /**
  * Update the cursor to a specific position
  *
- * @param pos New cursor position (row * VGA_WIDTH + column)
+ * In framebuffer mode the old cell is redrawn (erasing the underline) and
+ * the flush draws the cursor at the new one.
+ *
+ * @param pos New cursor position (row * console_cols + column)
  */
 void vga_update_cursor_position(uint16_t pos) {
-    vga_update_cursor(pos);
+    if (!fbcon_active()) {
+        cursor_pos = pos;
+        vga_update_cursor(pos);
+        return;
+    }
+    if (pos != cursor_pos) {
+        size_t x = cursor_pos % console_cols;
+        mark_dirty(cursor_pos / console_cols, x, x + 1);
+        cursor_pos = pos;
+        x = cursor_pos % console_cols;
+        mark_dirty(cursor_pos / console_cols, x, x + 1);
+    }
+    vga_flush();
 }
 
 /**
  * Scroll the screen content up by one line
  *
- * Moves all lines up one position and clears the bottom line.
- * Used when terminal output reaches the bottom of the screen.
+ * The old top line becomes history and a blank line is added at the bottom;
+ * every visible row changes, so all are marked dirty.
  */
 void vga_scroll(void) {
-    // Move all lines up one position
-    for (size_t y = 1; y < VGA_HEIGHT; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            const size_t src_index = y * VGA_WIDTH + x;
-            const size_t dst_index = (y - 1) * VGA_WIDTH + x;
-            terminal_buffer[dst_index] = terminal_buffer[src_index];
-        }
+    vga_follow_output();
+    ring_top = (ring_top + 1) % VGA_RING_LINES;
+    if (history_lines < VGA_RING_LINES - console_rows) {
+        history_lines++;
     }
     // Clear the last line
-    for (size_t x = 0; x < VGA_WIDTH; x++) {
-        const size_t index = (VGA_HEIGHT - 1) * VGA_WIDTH + x;
-        terminal_buffer[index] = vga_entry(' ', terminal_color);
+    shadow_clear_line(shadow_line(console_rows - 1, 0), 0);
+    mark_all_dirty();
+}
+
+/**
+ * Copy the dirty spans of the shadow buffer to VGA memory, or have fbcon draw them
+ */
+void vga_flush(void) {
+    bool fb = fbcon_active();
+    bool drawn = false;
+    for (size_t i = 0; i < CONSOLE_MAX_ROWS / 32; i++) {
+        while (dirty_rows[i] != 0) {
+            size_t y = i * 32 + __builtin_ctz(dirty_rows[i]);
+            dirty_rows[i] &= dirty_rows[i] - 1;
+            size_t x0 = dirty_start[y];
+            const uint16_t* line = shadow_line(y, view_offset);
+            if (fb) {
+                fbcon_draw_cells(x0, y, line + x0, dirty_end[y] - x0);
+            }
+            else {
+                memcpy(terminal_buffer + y * VGA_WIDTH + x0, line + x0, (dirty_end[y] - x0) * sizeof(uint16_t));
+            }
+            drawn = true;
+        }
+    }
+    // Anything drawn may have covered the cursor; it isn't shown over history
+    if (fb && drawn && view_offset == 0) {
+        size_t x = cursor_pos % console_cols;
+        size_t y = cursor_pos / console_cols;
+        fbcon_draw_cursor(x, y, shadow_line(y, 0)[x]);
+    }
+}
+
+/**
+ * Switch to the framebuffer console's grid
+ */
+void vga_attach_framebuffer(size_t cols, size_t rows) {
+    uint32_t flags = irq_save();
+    size_t old_cols = console_cols;
+    size_t old_rows = console_rows;
+    console_cols = cols;
+    console_rows = rows;
+    // Every line gets blanks to the right of its old end
+    for (size_t i = 0; i < VGA_RING_LINES; i++) {
+        shadow_clear_line(shadow[i], old_cols);
+    }
+    // The new rows below the screen come out of the oldest history
+    if (history_lines > VGA_RING_LINES - rows) {
+        history_lines = VGA_RING_LINES - rows;
+    }
+    if (view_offset > history_lines) {
+        view_offset = history_lines;
+    }
+    for (size_t y = old_rows; y < rows; y++) {
+        shadow_clear_line(shadow_line(y, 0), 0);
+    }
+    cursor_pos = cursor_pos / old_cols * cols + cursor_pos % old_cols;
+    mark_all_dirty();
+    vga_flush();
+    irq_restore(flags);
+}
+
+/**
+ * Move the view into the scrollback history
+ *
+ * @param lines Lines to move (positive = back in history, negative = towards the live screen)
+ */
+void vga_scroll_view(int lines) {
+    size_t target = view_offset;
+    if (lines > 0) {
+        target += (size_t) lines;
+        if (target > history_lines) {
+            target = history_lines;
+        }
+    }
+    else {
+        target = (size_t) -lines > target ? 0 : target - (size_t) -lines;
+    }
+    if (target != view_offset) {
+        view_offset = target;
+        mark_all_dirty();
     }
+    vga_flush();
 }
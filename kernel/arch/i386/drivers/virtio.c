@@ -0,0 +1,184 @@
+// Reference: Virtual I/O Device (VIRTIO) Version 1.1, 2.6 and 4.1.4.8
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/virtio.h>
+#include <kernel/pci.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/klog.h>
+
+#include "../include/io.h"
+
+/* x86 keeps stores in order and loads in order: only the compiler may reorder those */
+#define virtio_barrier()        asm volatile("" ::: "memory")
+/* ... but a later load may pass an earlier store */
+#define virtio_mb()             asm volatile("mfence" ::: "memory")
+
+/**
+ * Reset the function and announce the driver
+ */
+int virtio_pci_init(const pci_device_t* pci, virtio_device_t* vdev) {
+    if (!(pci->bar[0] & PCI_BAR_IO)) {
+        return -1;
+    }
+    vdev->io = (uint16_t) pci_bar_address(pci, 0);
+    vdev->irq = pci->irq_line;
+    vdev->features = 0;
+    pci_enable_bus_master(pci);
+    outb(vdev->io + VIRTIO_PCI_STATUS, 0);
+    outb(vdev->io + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(vdev->io + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    return 0;
+}
+
+/**
+ * Accept the common features
+ */
+uint32_t virtio_negotiate(virtio_device_t* vdev, uint32_t wanted) {
+    vdev->features = inl(vdev->io + VIRTIO_PCI_HOST_FEATURES) & wanted;
+    outl(vdev->io + VIRTIO_PCI_GUEST_FEATURES, vdev->features);
+    return vdev->features;
+}
+
+/**
+ * Allocate and register a queue's rings
+ *
+ *   desc   16 * size bytes
+ *   avail  right behind: flags, idx, ring[size], used_event
+ *   used   next VIRTQUEUE_ALIGN boundary: flags, idx, ring[size] of 8 bytes, avail_event
+ */
+int virtqueue_init(virtio_device_t* vdev, virtqueue_t* vq, uint16_t index) {
+    outw(vdev->io + VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t size = inw(vdev->io + VIRTIO_PCI_QUEUE_SIZE);
+    if (size == 0 || inl(vdev->io + VIRTIO_PCI_QUEUE_PFN) != 0) {
+        return -1;      /* No such queue, or already in use */
+    }
+    uint32_t avail_end = (uint32_t) size * sizeof(vring_desc_t) + 6 + 2u * size;
+    uint32_t used_offset = (avail_end + VIRTQUEUE_ALIGN - 1) & ~(VIRTQUEUE_ALIGN - 1);
+    uint32_t bytes = used_offset + 6 + (uint32_t) size * sizeof(vring_used_elem_t);
+    uint32_t pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t order = 0;
+    while ((1u << order) < pages) {
+        order++;
+    }
+    uint32_t phys = frame_alloc_order(order);
+    uint8_t* rings = phys != 0 ? paging_map_physical(phys, pages * PAGE_SIZE, PTE_WRITABLE) : NULL;
+    vq->cookies = rings != NULL ? kcalloc(size, sizeof(void*)) : NULL;
+    if (vq->cookies == NULL) {
+        if (phys != 0) {
+            frame_free_order(phys, order);
+        }
+        klog(KLOG_ERR, "[FAILED] virtio: No memory for queue %u (%u entries)\n", index, size);
+        return -1;
+    }
+    memset(rings, 0, pages * PAGE_SIZE);
+    vq->vdev = vdev;
+    vq->index = index;
+    vq->size = size;
+    vq->desc = (vring_desc_t*) rings;
+    vq->avail = (volatile vring_avail_t*) (rings + (uint32_t) size * sizeof(vring_desc_t));
+    vq->used = (volatile vring_used_t*) (rings + used_offset);
+    for (uint16_t i = 0; i < size; i++) {
+        vq->desc[i].next = (uint16_t) (i + 1);
+    }
+    vq->free_head = 0;
+    vq->num_free = size;
+    vq->last_used = 0;
+    outl(vdev->io + VIRTIO_PCI_QUEUE_PFN, phys / VIRTQUEUE_ALIGN);
+    return 0;
+}
+
+/**
+ * Start the device
+ */
+void virtio_driver_ok(virtio_device_t* vdev) {
+    outb(vdev->io + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+}
+
+/**
+ * Read (and so clear) the interrupt status
+ */
+uint8_t virtio_isr(virtio_device_t* vdev) {
+    return inb(vdev->io + VIRTIO_PCI_ISR);
+}
+
+/**
+ * Read a configuration byte
+ */
+uint8_t virtio_config_read8(virtio_device_t* vdev, uint32_t offset) {
+    return inb(vdev->io + VIRTIO_PCI_CONFIG + offset);
+}
+
+/**
+ * Put a one-descriptor buffer on the available ring
+ */
+int virtqueue_add(virtqueue_t* vq, uint32_t phys, uint32_t len, bool writable, void* cookie) {
+    if (vq->num_free == 0) {
+        return -1;
+    }
+    uint16_t head = vq->free_head;
+    vring_desc_t* desc = &vq->desc[head];
+    vq->free_head = desc->next;
+    vq->num_free--;
+    desc->addr = phys;
+    desc->len = len;
+    desc->flags = writable ? VRING_DESC_F_WRITE : 0;
+    vq->cookies[head] = cookie;
+    uint16_t idx = vq->avail->idx;
+    vq->avail->ring[idx % vq->size] = head;
+    virtio_barrier();       /* The entry before the index that publishes it */
+    vq->avail->idx = (uint16_t) (idx + 1);
+    return 0;
+}
+
+/**
+ * Notify the device
+ */
+void virtqueue_kick(virtqueue_t* vq) {
+    /* The new avail->idx must be visible before reading the device's flag */
+    virtio_mb();
+    if (!(vq->used->flags & VRING_USED_F_NO_NOTIFY)) {
+        outw(vq->vdev->io + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+    }
+}
+
+/**
+ * Take a used buffer
+ */
+void* virtqueue_get(virtqueue_t* vq, uint32_t* len) {
+    if (vq->last_used == vq->used->idx) {
+        return NULL;
+    }
+    virtio_barrier();       /* Read the entry only after seeing the index */
+    volatile vring_used_elem_t* elem = &vq->used->ring[vq->last_used % vq->size];
+    uint16_t id = (uint16_t) elem->id;
+    *len = elem->len;
+    vq->last_used++;
+    void* cookie = vq->cookies[id];
+    vq->cookies[id] = NULL;
+    vq->desc[id].next = vq->free_head;
+    vq->free_head = id;
+    vq->num_free++;
+    return cookie;
+}
+
+/**
+ * Suppress interrupts for the queue
+ */
+void virtqueue_disable_irq(virtqueue_t* vq) {
+    vq->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+}
+
+/**
+ * Re-enable interrupts for the queue
+ */
+bool virtqueue_enable_irq(virtqueue_t* vq) {
+    vq->avail->flags &= (uint16_t) ~VRING_AVAIL_F_NO_INTERRUPT;
+    /* A buffer used before the device saw the flag is never signalled */
+    virtio_mb();
+    return vq->last_used != vq->used->idx;
+}
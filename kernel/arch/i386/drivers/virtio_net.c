@@ -0,0 +1,289 @@
+// Reference: Virtual I/O Device (VIRTIO) Version 1.1, 5.1 (network device)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/virtio_net.h>
+#include <kernel/virtio.h>
+#include <kernel/net.h>
+#include <kernel/pci.h>
+#include <kernel/softirq.h>
+#include <kernel/spinlock.h>
+#include <kernel/klog.h>
+
+#include "../include/io.h"
+#include "../include/irq.h"
+#include "../include/interrupts.h"
+
+#define VIRTIO_NET_PCI_DEVICE   0x1000  /* Transitional device: legacy interface in BAR0 */
+
+#define VIRTIO_NET_F_MAC        (1u << 5)
+#define VIRTIO_NET_F_STATUS     (1u << 16)
+
+/* Device configuration */
+#define VIRTIO_NET_CFG_MAC      0
+#define VIRTIO_NET_CFG_STATUS   6
+#define VIRTIO_NET_S_LINK_UP    0x1
+
+#define VIRTIO_NET_RXQ          0
+#define VIRTIO_NET_TXQ          1
+
+/* In front of every frame, both ways (no offloads, no merged buffers: 10 bytes) */
+typedef struct {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+} __attribute__((packed)) virtio_net_hdr_t;
+
+typedef struct {
+    net_device_t net;
+    virtio_device_t vdev;
+    virtqueue_t rx;
+    virtqueue_t tx;
+    uint16_t rx_target;                 /* Buffers to keep posted */
+    spinlock_t lock;                    /* Both queues and stats */
+    tasklet_t poll;
+    virtio_net_stats_t stats;
+} virtio_net_t;
+
+static virtio_net_t virtio_nets[VIRTIO_NET_MAX_DEVICES];
+static uint32_t virtio_net_count = 0;
+
+/**
+ * Free the buffers the device has sent (lock held)
+ */
+static void virtio_net_reap_tx(virtio_net_t* vn) {
+    uint32_t len;
+    netbuf_t* nb;
+    while ((nb = (netbuf_t*) virtqueue_get(&vn->tx, &len)) != NULL) {
+        netbuf_free(nb);
+    }
+}
+
+/**
+ * Post receive buffers up to the target (lock held)
+ *
+ * @return Buffers added
+ */
+static uint32_t virtio_net_refill(virtio_net_t* vn) {
+    uint32_t added = 0;
+    while (vn->stats.rx_posted < vn->rx_target) {
+        netbuf_t* nb = netbuf_alloc();
+        if (nb == NULL) {
+            vn->stats.rx_refill_failed++;
+            break;
+        }
+        if (virtqueue_add(&vn->rx, nb->phys, NETBUF_SIZE, true, nb) != 0) {
+            netbuf_free(nb);
+            break;
+        }
+        vn->stats.rx_posted++;
+        added++;
+    }
+    return added;
+}
+
+/**
+ * Queue a frame behind its virtio header, which goes into the headroom
+ */
+static int virtio_net_xmit(net_device_t* dev, netbuf_t* nb) {
+    virtio_net_t* vn = (virtio_net_t*) dev->priv;
+    if ((uint32_t) (nb->data - nb->head) < sizeof(virtio_net_hdr_t)) {
+        netbuf_free(nb);
+        return -1;
+    }
+    nb->data -= sizeof(virtio_net_hdr_t);
+    nb->len += sizeof(virtio_net_hdr_t);
+    memset(nb->data, 0, sizeof(virtio_net_hdr_t));
+
+    uint32_t flags = spin_lock_irqsave(&vn->lock);
+    virtio_net_reap_tx(vn);
+    int result = virtqueue_add(&vn->tx, netbuf_phys(nb), nb->len, false, nb);
+    if (result == 0) {
+        virtqueue_kick(&vn->tx);
+    }
+    spin_unlock_irqrestore(&vn->lock, flags);
+    if (result != 0) {
+        netbuf_free(nb);
+    }
+    return result;
+}
+
+static const net_ops_t virtio_net_ops = {
+    .xmit = virtio_net_xmit,
+};
+
+/**
+ * Poll tasklet: receive up to VIRTIO_NET_BUDGET frames
+ */
+static void virtio_net_poll(void* data) {
+    virtio_net_t* vn = (virtio_net_t*) data;
+    netbuf_t* frames = NULL;
+    netbuf_t** tail = &frames;
+    uint32_t count = 0;
+
+    uint32_t flags = spin_lock_irqsave(&vn->lock);
+    virtio_net_reap_tx(vn);
+    netbuf_t* nb;
+    uint32_t len;
+    while (count < VIRTIO_NET_BUDGET && (nb = (netbuf_t*) virtqueue_get(&vn->rx, &len)) != NULL) {
+        vn->stats.rx_posted--;
+        if (len < sizeof(virtio_net_hdr_t) + NET_ETH_HLEN || len > NETBUF_SIZE) {
+            netbuf_free(nb);    /* Runt: nothing to deliver */
+            continue;
+        }
+        nb->data = nb->head + sizeof(virtio_net_hdr_t);
+        nb->len = len - sizeof(virtio_net_hdr_t);
+        *tail = nb;
+        tail = &nb->next;
+        count++;
+    }
+    *tail = NULL;
+    if (virtio_net_refill(vn) > 0) {
+        virtqueue_kick(&vn->rx);
+    }
+    vn->stats.polls++;
+    bool again = count == VIRTIO_NET_BUDGET;
+    if (again) {
+        vn->stats.polls_exhausted++;
+    }
+    else if (virtqueue_enable_irq(&vn->rx)) {
+        /* Frames arrived after the last look: they won't interrupt, so keep polling */
+        virtqueue_disable_irq(&vn->rx);
+        again = true;
+    }
+    spin_unlock_irqrestore(&vn->lock, flags);
+
+    /* The stack runs without the lock; it may transmit */
+    while (frames != NULL) {
+        nb = frames;
+        frames = nb->next;
+        nb->next = NULL;
+        net_receive(&vn->net, nb);
+    }
+    if (again) {
+        tasklet_schedule(&vn->poll);
+    }
+}
+
+/**
+ * Interrupt: switch the device that raised it to polling
+ */
+static void virtio_net_irq(regs_t* r) {
+    (void) r;
+    /* Devices may share the line; reading ISR of one that didn't interrupt returns 0 */
+    for (uint32_t i = 0; i < virtio_net_count; i++) {
+        virtio_net_t* vn = &virtio_nets[i];
+        uint8_t isr = virtio_isr(&vn->vdev);
+        if (isr == 0) {
+            continue;
+        }
+        spin_lock(&vn->lock);
+        vn->stats.interrupts++;
+        if (isr & VIRTIO_ISR_CONFIG && (vn->vdev.features & VIRTIO_NET_F_STATUS)) {
+            vn->net.link_up = (virtio_config_read8(&vn->vdev, VIRTIO_NET_CFG_STATUS) & VIRTIO_NET_S_LINK_UP) != 0;
+        }
+        if (isr & VIRTIO_ISR_QUEUE) {
+            virtqueue_disable_irq(&vn->rx);
+        }
+        spin_unlock(&vn->lock);
+        if (isr & VIRTIO_ISR_QUEUE) {
+            tasklet_schedule(&vn->poll);
+        }
+    }
+}
+
+/**
+ * Bring up one function
+ */
+static int virtio_net_probe(const pci_device_t* pci, virtio_net_t* vn) {
+    memset(vn, 0, sizeof(*vn));
+    spin_lock_init(&vn->lock);
+    tasklet_init(&vn->poll, virtio_net_poll, vn);
+    if (virtio_pci_init(pci, &vn->vdev) != 0 || vn->vdev.irq >= 16) {
+        return -1;
+    }
+    uint32_t features = virtio_negotiate(&vn->vdev, VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS);
+    if (virtqueue_init(&vn->vdev, &vn->rx, VIRTIO_NET_RXQ) != 0 ||
+        virtqueue_init(&vn->vdev, &vn->tx, VIRTIO_NET_TXQ) != 0) {
+        outb(vn->vdev.io + VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+    virtqueue_disable_irq(&vn->tx);
+    vn->rx_target = vn->rx.size < VIRTIO_NET_RX_POSTED ? vn->rx.size : VIRTIO_NET_RX_POSTED;
+
+    for (uint32_t i = 0; i < NET_ETH_ALEN; i++) {
+        vn->net.mac[i] = (features & VIRTIO_NET_F_MAC) ? virtio_config_read8(&vn->vdev, VIRTIO_NET_CFG_MAC + i) : 0;
+    }
+    if (!(features & VIRTIO_NET_F_MAC)) {
+        vn->net.mac[0] = 0x02;      /* Locally administered */
+        vn->net.mac[5] = (uint8_t) (virtio_net_count + 1);
+    }
+    vn->net.link_up = !(features & VIRTIO_NET_F_STATUS) ||
+                      (virtio_config_read8(&vn->vdev, VIRTIO_NET_CFG_STATUS) & VIRTIO_NET_S_LINK_UP);
+    vn->net.ops = &virtio_net_ops;
+    vn->net.priv = vn;
+
+    uint32_t flags = spin_lock_irqsave(&vn->lock);
+    virtio_net_refill(vn);
+    spin_unlock_irqrestore(&vn->lock, flags);
+    virtio_driver_ok(&vn->vdev);
+    virtqueue_kick(&vn->rx);
+    return 0;
+}
+
+/**
+ * Format a MAC address as xx:xx:xx:xx:xx:xx (printf has no field widths)
+ */
+static void virtio_net_mac_string(const uint8_t* mac, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (uint32_t i = 0; i < NET_ETH_ALEN; i++) {
+        out[i * 3] = digits[mac[i] >> 4];
+        out[i * 3 + 1] = digits[mac[i] & 0xF];
+        out[i * 3 + 2] = i + 1 < NET_ETH_ALEN ? ':' : '\0';
+    }
+}
+
+/**
+ * Find and register virtio-net devices
+ */
+int virtio_net_init(void) {
+    pci_device_t pci;
+    for (uint32_t i = 0; virtio_net_count < VIRTIO_NET_MAX_DEVICES &&
+                         pci_find_device(VIRTIO_PCI_VENDOR, VIRTIO_NET_PCI_DEVICE, i, &pci) == 0; i++) {
+        virtio_net_t* vn = &virtio_nets[virtio_net_count];
+        if (virtio_net_probe(&pci, vn) != 0 || net_register(&vn->net) != 0) {
+            klog(KLOG_WARN, "virtio-net: Device %u:%u.%u could not be set up\n", pci.bus, pci.slot, pci.func);
+            continue;
+        }
+        /* Visible to the handler before its line is unmasked */
+        __atomic_store_n(&virtio_net_count, virtio_net_count + 1, __ATOMIC_RELEASE);
+        reqister_irq(vn->vdev.irq, virtio_net_irq);
+        char mac[3 * NET_ETH_ALEN];
+        virtio_net_mac_string(vn->net.mac, mac);
+        klog(KLOG_INFO, "[  OK  ] virtio-net: %s is %s, IRQ %u, %u/%u queue entries\n", vn->net.name, mac,
+             vn->vdev.irq, vn->rx.size, vn->tx.size);
+    }
+    return 0;
+}
+
+/**
+ * Get a device's driver counters
+ */
+int virtio_net_get_stats(net_device_t* dev, virtio_net_stats_t* stats) {
+    for (uint32_t i = 0; i < virtio_net_count; i++) {
+        virtio_net_t* vn = &virtio_nets[i];
+        if (&vn->net == dev) {
+            uint32_t flags = spin_lock_irqsave(&vn->lock);
+            *stats = vn->stats;
+            spin_unlock_irqrestore(&vn->lock, flags);
+            return 0;
+        }
+    }
+    return -1;
+}
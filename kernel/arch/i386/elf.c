@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/elf.h>
+#include <kernel/paging.h>
+#include <kernel/klog.h>
+
+#include "include/elf32.h"
+
+/**
+ * ELF Program Loader
+ *
+ * Reference: https://refspecs.linuxfoundation.org/elf/elf.pdf (Book I, Program Loading)
+ *
+ * Every PT_LOAD program header becomes one process segment:
+ *
+ *   p_offset 0x1000, p_vaddr 0x40001000, p_filesz 0x2345, p_memsz 0x5000, R+W
+ *     → segment [0x40001000, 0x40006000), file bytes 0x40001000 - 0x40003345,
+ *       zero-filled after that, pages writable
+ */
+
+/* Highest address a segment can reach: the system call ring and the stack sit above it */
+#define ELF_LOAD_LIMIT      USER_VCLOCK_BASE
+
+/**
+ * Check that [offset, offset + len) lies inside a file of 'size' bytes
+ */
+static inline bool elf_in_file(uint32_t offset, uint32_t len, size_t size) {
+    return offset <= size && len <= size - offset;
+}
+
+/**
+ * Validate an executable and record its segments in a process
+ */
+int elf_load(process_t* proc, const module_t* mod) {
+    const uint8_t* file = (const uint8_t*) mod->data;
+    const Elf32_Ehdr_t* ehdr = (const Elf32_Ehdr_t*) file;
+    if (mod->size < sizeof(Elf32_Ehdr_t) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
+        klog(KLOG_ERR, "[FAILED] elf_load: '%s' is not an ELF32 little-endian file\n", mod->name);
+        return -1;
+    }
+    if (ehdr->e_type != ET_EXEC || ehdr->e_machine != EM_386) {
+        klog(KLOG_ERR, "[FAILED] elf_load: '%s' is not an i386 executable (type %u, machine %u)\n",
+                       mod->name, ehdr->e_type, ehdr->e_machine);
+        return -1;
+    }
+    if (ehdr->e_phentsize != sizeof(Elf32_Phdr_t) ||
+        !elf_in_file(ehdr->e_phoff, (uint32_t) ehdr->e_phnum * sizeof(Elf32_Phdr_t), mod->size)) {
+        klog(KLOG_ERR, "[FAILED] elf_load: '%s' has a malformed program header table\n", mod->name);
+        return -1;
+    }
+
+    const Elf32_Phdr_t* phdrs = (const Elf32_Phdr_t*) (file + ehdr->e_phoff);
+    uint32_t count = 0;
+    bool entry_mapped = false;
+    for (uint32_t i = 0; i < ehdr->e_phnum; i++) {
+        const Elf32_Phdr_t* ph = &phdrs[i];
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+            continue;
+        }
+        if (ph->p_filesz > ph->p_memsz || !elf_in_file(ph->p_offset, ph->p_filesz, mod->size) ||
+            ph->p_vaddr < USER_CODE_START || ph->p_vaddr > ELF_LOAD_LIMIT ||
+            ph->p_memsz > ELF_LOAD_LIMIT - ph->p_vaddr) {
+            klog(KLOG_ERR, "[FAILED] elf_load: '%s' segment %u (%p, %u bytes) is outside user memory\n",
+                           mod->name, i, ph->p_vaddr, ph->p_memsz);
+            return -1;
+        }
+        if (count == PROCESS_MAX_SEGMENTS) {
+            klog(KLOG_ERR, "[FAILED] elf_load: '%s' has more than %u loadable segments\n", mod->name,
+                 PROCESS_MAX_SEGMENTS);
+            return -1;
+        }
+        process_segment_t* seg = &proc->segments[count++];
+        seg->start = ph->p_vaddr & ~(PAGE_SIZE - 1);
+        seg->end = (ph->p_vaddr + ph->p_memsz + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        seg->vaddr = ph->p_vaddr;
+        seg->file = file + ph->p_offset;
+        seg->file_phys = mod->phys + ph->p_offset;
+        seg->file_size = ph->p_filesz;
+        seg->flags = PTE_USER | ((ph->p_flags & PF_W) ? PTE_WRITABLE : 0);
+        if (ehdr->e_entry >= ph->p_vaddr && ehdr->e_entry - ph->p_vaddr < ph->p_memsz) {
+            entry_mapped = true;
+        }
+    }
+    if (!entry_mapped) {
+        klog(KLOG_ERR, "[FAILED] elf_load: '%s' entry point %p is not in a loadable segment\n", mod->name,
+             ehdr->e_entry);
+        return -1;
+    }
+    proc->entry = ehdr->e_entry;
+    proc->segment_count = count;
+    return 0;
+}
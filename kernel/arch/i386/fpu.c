@@ -0,0 +1,267 @@
+/**
+ * Lazy FPU/SSE Context Switching
+ *
+ * Based on: https://wiki.osdev.org/FPU and https://wiki.osdev.org/SSE
+ *
+ * CR0.TS makes the next FPU/SSE instruction fault with #NM (ISR 7), so the
+ * 512-byte state is only swapped when a second thread actually needs it:
+ *
+ *   schedule() → fpu_switch(next): next owns the registers? clear TS : set TS
+ *   next executes fld/movaps/... → #NM → fpu_trap()
+ *     → clts → fxsave into the owner's area → fxrstor next's area
+ *       (first use: allocate the area, fninit, default MXCSR)
+ *     → next becomes the owner → iret retries the instruction
+ *
+ * Two threads that alternate but only one of which uses the FPU never trap
+ * after the first time: the FPU user stays the owner while the other runs.
+ *
+ * kernel_fpu_begin() saves the owner's state and leaves no owner, so after
+ * kernel_fpu_end() the next FPU instruction of any thread traps and reloads:
+ *
+ *   kernel_fpu_begin(): preempt off → clts → fxsave owner → owner = NULL
+ *   kernel_fpu_end():   set TS → preempt on
+ *
+ * The owner is per CPU (cpu_t.fpu_owner). A thread only changes CPU when it
+ * wakes up, and before a blocked thread leaves a CPU fpu_thread_leave() saves
+ * its registers there, so they are never live on a CPU it no longer runs on.
+ *
+ * Reference: Intel SDM Vol. 3A, 2.5 "Control Registers" (CR0.TS, CR4.OSFXSR)
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include <kernel/fpu.h>
+#include <kernel/thread.h>
+#include <kernel/process.h>
+#include <kernel/kheap.h>
+#include <kernel/debug.h>
+#include <kernel/klog.h>
+
+#include "include/cpuid.h"
+#include "include/percpu.h"
+#include "include/interrupts.h"
+
+#define CR0_MP              0x02    /* Monitor coprocessor: wait/fwait honour TS too */
+#define CR0_EM              0x04    /* Emulation: every FPU instruction faults with #NM */
+#define CR0_TS              0x08    /* Task switched: the next FPU instruction faults with #NM */
+#define CR0_NE              0x20    /* Report FPU errors as #MF instead of through IRQ 13 */
+
+#define CR4_OSFXSR          0x200   /* fxsave/fxrstor cover SSE, SSE instructions allowed */
+#define CR4_OSXMMEXCPT      0x400   /* Unmasked SSE exceptions raise #XM instead of #UD */
+
+#define MXCSR_DEFAULT       0x1F80  /* All SSE exceptions masked, round to nearest */
+
+static bool fpu_enabled;
+static bool fpu_has_fxsr;           /* fxsave/fxrstor, else fnsave/frstor (x87 only) */
+static bool fpu_has_sse;
+static volatile uint32_t fpu_traps;
+
+static inline uint32_t read_cr0(void) {
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void write_cr0(uint32_t cr0) {
+    asm volatile("mov %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+/**
+ * Save the registers into a thread's area
+ */
+static inline void fpu_save(void* state) {
+    if (fpu_has_fxsr) {
+        asm volatile("fxsave (%0)" :: "r"(state) : "memory");
+    }
+    else {
+        asm volatile("fnsave (%0)" :: "r"(state) : "memory");
+    }
+}
+
+/**
+ * Load the registers from a thread's area
+ */
+static inline void fpu_restore(const void* state) {
+    if (fpu_has_fxsr) {
+        asm volatile("fxrstor (%0)" :: "r"(state) : "memory");
+    }
+    else {
+        asm volatile("frstor (%0)" :: "r"(state) : "memory");
+    }
+}
+
+/**
+ * Reset the registers for a thread's first FPU instruction
+ */
+static inline void fpu_reset(void) {
+    asm volatile("fninit");
+    if (fpu_has_sse) {
+        /* fninit leaves MXCSR alone: don't hand over the previous owner's modes */
+        uint32_t mxcsr = MXCSR_DEFAULT;
+        asm volatile("ldmxcsr %0" :: "m"(mxcsr));
+    }
+}
+
+/**
+ * #NM handler: hand the registers to the running thread
+ */
+static void fpu_trap(regs_t* r) {
+    cpu_t* cpu = cpu_self();
+    thread_t* self = thread_current();
+    /* Before the scheduler runs (or with TS inherited by an AP) there is nobody to swap with */
+    if (self == NULL || cpu->fpu_owner == self) {
+        asm volatile("clts");
+        return;
+    }
+    bool first_use = self->fpu_state == NULL;
+    if (first_use) {
+        self->fpu_state = kmalloc_aligned(FPU_STATE_SIZE, FPU_STATE_ALIGN);
+        if (self->fpu_state == NULL) {
+            if ((r->cs & 0x3) == 3 && process_current() != NULL) {
+                klog(KLOG_ERR, "[FAILED] Process %u (%s): Out of memory for the FPU state, killed\n",
+                               process_current()->pid, self->name);
+                process_exit(-1);
+            }
+            panic("fpu_trap: Out of memory for the FPU state of thread '%s'\n", self->name);
+        }
+    }
+    /* Only now: the allocation may copy with SSE, which sets TS again when done */
+    asm volatile("clts");
+    if (cpu->fpu_owner != NULL) {
+        fpu_save(cpu->fpu_owner->fpu_state);
+    }
+    if (first_use) {
+        fpu_reset();
+    }
+    else {
+        fpu_restore(self->fpu_state);
+    }
+    cpu->fpu_owner = self;
+    __atomic_add_fetch(&fpu_traps, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Enable the FPU and SSE on the running CPU
+ */
+void fpu_init_cpu(void) {
+    if (!fpu_enabled) {
+        return;
+    }
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    if (fpu_has_fxsr) {
+        uint32_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (fpu_has_sse) {
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        asm volatile("mov %0, %%cr4" :: "r"(cr4));
+    }
+    fpu_reset();
+    cpu_self()->fpu_owner = NULL;
+}
+
+/**
+ * Enable the FPU and SSE on the boot CPU and install the #NM handler
+ */
+int fpu_init(void) {
+    if (!cpuid_has_edx(CPUID_EDX_FPU)) {
+        klog(KLOG_ERR, "[FAILED] fpu_init: No FPU, floating point stays disabled\n");
+        return -1;
+    }
+    fpu_has_fxsr = cpuid_has_edx(CPUID_EDX_FXSR);
+    fpu_has_sse = fpu_has_fxsr && cpuid_has_edx(CPUID_EDX_SSE);
+    register_isr(7, fpu_trap);
+    fpu_enabled = true;
+    fpu_init_cpu();
+    klog(KLOG_INFO, "[  OK  ] FPU initialized (lazy %s switching%s).\n", fpu_has_fxsr ? "fxsave" : "fnsave",
+                    fpu_has_sse ? ", SSE enabled" : "");
+    return 0;
+}
+
+/**
+ * Arm the #NM trap for the thread about to run
+ */
+void fpu_switch(thread_t* next) {
+    if (!fpu_enabled) {
+        return;
+    }
+    uint32_t cr0 = read_cr0();
+    if (cpu_self()->fpu_owner == next) {
+        if (cr0 & CR0_TS) {
+            asm volatile("clts");
+        }
+    }
+    else if (!(cr0 & CR0_TS)) {
+        write_cr0(cr0 | CR0_TS);
+    }
+}
+
+/**
+ * Borrow the SSE registers for kernel code
+ */
+bool kernel_fpu_begin(void) {
+    if (!fpu_has_sse) {
+        return false;
+    }
+    preempt_disable();
+    cpu_t* cpu = cpu_self();
+    /* An IRQ that interrupts this check runs its whole section before we go on */
+    if (cpu->fpu_kernel) {
+        preempt_enable();
+        return false;
+    }
+    cpu->fpu_kernel = true;
+    asm volatile("clts" ::: "memory");
+    if (cpu->fpu_owner != NULL) {
+        fpu_save(cpu->fpu_owner->fpu_state);
+        cpu->fpu_owner = NULL;
+    }
+    return true;
+}
+
+/**
+ * End a kernel FPU section
+ */
+void kernel_fpu_end(void) {
+    cpu_t* cpu = cpu_self();
+    write_cr0(read_cr0() | CR0_TS);
+    cpu->fpu_kernel = false;
+    preempt_enable();
+}
+
+/**
+ * Save the registers of a thread that may run on another CPU next
+ */
+void fpu_thread_leave(thread_t* thread) {
+    cpu_t* cpu = cpu_self();
+    if (!fpu_enabled || cpu->fpu_owner != thread) {
+        return;
+    }
+    asm volatile("clts");
+    fpu_save(thread->fpu_state);
+    cpu->fpu_owner = NULL;
+}
+
+/**
+ * Drop an exited thread's FPU state
+ */
+void fpu_thread_exit(thread_t* thread) {
+    cpu_t* cpu = cpu_self();
+    if (cpu->fpu_owner == thread) {
+        cpu->fpu_owner = NULL;
+    }
+    kfree(thread->fpu_state);
+    thread->fpu_state = NULL;
+}
+
+/**
+ * Number of #NM traps handled
+ */
+uint32_t fpu_trap_count(void) {
+    return __atomic_load_n(&fpu_traps, __ATOMIC_RELAXED);
+}
@@ -1,26 +1,27 @@
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 
+#include <kernel/klog.h>
+
 #include "include/gdt.h"
+#include "include/percpu.h"
 
 // Assembly function (gdt_load.nasm) that loads the GDT and reloads segment registers
 extern void gdt_load(uint32_t);
 // Assembly function (gdt_load.nasm) that loads the TSS into the Task Register
 extern void tss_flush(void);
-// Kernel stack defined in boot.nasm (top of 16KB stack)
+// Boot CPU's kernel stack defined in boot.nasm (top of 16KB stack)
 extern uint32_t stack_top;
 
-// Global Descriptor Table: Array of segment descriptors defining memory segments
-static gdt_entry_t gdt[NUM_SEGMENTS];
-// GDT Register: Structure containing GDT size and base address, loaded into GDTR
-static gdt_register_t gdtr;
-// Task State Segment: Hardware context structure used for task switching and privilege changes
-static tss_entry_t tss;
+/* The Global Descriptor Table, its GDTR value and the Task State Segment are per CPU: they live in the
+ * CPU's cpu_t (percpu.h). A busy TSS can't be loaded by a second CPU, and each CPU needs its own esp0 and
+ * its own SEGMENT_PERCPU base anyway. All GDTs have the same layout, so the selectors are the same everywhere. */
 
 /**
  * Setup one GDT entry.
  */
-static void gdt_set_entry(int idx, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+static void gdt_set_entry(gdt_entry_t* gdt, int idx, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
     gdt[idx].limit_lo       =  (uint16_t) (limit & 0xFFFF);
     gdt[idx].base_lo        =  (uint16_t) (base & 0xFFFF);
     gdt[idx].base_mi        =  (uint8_t) ((base >> 16) & 0xFF);
@@ -38,9 +39,10 @@ static void gdt_set_entry(int idx, uint32_t base, uint32_t limit, uint8_t access
  *
  * Reference: https://wiki.osdev.org/Getting_to_Ring_3
  */
-static void tss_init(void) {
-    uint32_t base = (uint32_t) &tss;
-    uint32_t limit = sizeof(tss);
+static void tss_init(cpu_t* cpu) {
+    tss_entry_t* tss = &cpu->tss;
+    uint32_t base = (uint32_t) tss;
+    uint32_t limit = sizeof(*tss);
     /* Add TSS descriptor to GDT
      * Access Byte for TSS:
      * - P    = 1: Present
@@ -49,9 +51,9 @@ static void tss_init(void) {
      * - Type = 1001 (0x9): Available 32-bit TSS
      *   Result: 0b1000_1001 = 0x89
      */
-    gdt_set_entry(SEGMENT_TSS, base, limit, 0x89, 0x00);
+    gdt_set_entry(cpu->gdt, SEGMENT_TSS, base, limit, 0x89, 0x00);
     /* Zero out the TSS to ensure clean state */
-    memset(&tss, 0, sizeof(tss));
+    memset(tss, 0, sizeof(*tss));
     /* Set up the kernel stack for privilege level transitions.
      * When an interrupt/syscall occurs in user mode (Ring 3), the CPU will:
      * 1. Read ss0 and esp0 from the TSS
@@ -59,22 +61,44 @@ static void tss_init(void) {
      * 3. Push user ss, esp, eflags, cs, eip (interrupt frame)
      * 4. Jump to the interrupt handler
      *
-     * We use the same 16KB stack that the kernel has been using since boot.
-     * This works for a simple OS without multitasking. For proper task switching,
-     * each task would need its own kernel stack, and esp0 would be updated on
-     * every context switch.
+     * We start with the stack the CPU booted on (for the boot CPU, the 16KB stack defined in boot.nasm).
+     * Once threads exist, each has its own kernel stack and the scheduler points
+     * esp0 at it on every context switch (tss_set_kernel_stack()).
      */
-    tss.ss0 = KERNEL_DS;
-    tss.esp0 = (uint32_t) &stack_top;  /* Point to the kernel stack (16KB, defined in boot.nasm) */
+    tss->ss0 = KERNEL_DS;
+    tss->esp0 = cpu->stack_top;
     /* Set I/O map base address to end of TSS (no I/O port permissions) */
-    tss.iomap_base = sizeof(tss);
+    tss->iomap_base = sizeof(*tss);
     /* Load the TSS into the task register using assembly instruction */
     tss_flush();
 }
 
 /**
- * Initialize the global descriptor table (GDT) by setting up the 6 entries of GDT, setting the GDTR register
- * to point to our GDT address, and then (through assembly `lgdt` instruction) load our GDT.
+ * Set the stack the CPU switches to on entry from Ring 3
+ *
+ * Each thread has its own kernel stack, so the scheduler updates esp0 on every switch.
+ *
+ * @param esp0 Top of the kernel stack
+ */
+void tss_set_kernel_stack(uint32_t esp0) {
+    cpu_self()->tss.esp0 = esp0;
+}
+
+/**
+ * Address of the TSS esp0 field
+ *
+ * SYSENTER doesn't use the TSS, so its entry stub loads the kernel stack from here.
+ *
+ * @return Pointer to the running CPU's esp0
+ */
+const uint32_t* tss_kernel_stack_slot(void) {
+    /* The TSS is packed but 16-byte aligned in cpu_t and esp0 sits at offset 4, so the pointer is aligned */
+    return (const uint32_t*) ((uint8_t*) &cpu_self()->tss + offsetof(tss_entry_t, esp0));
+}
+
+/**
+ * Initialize the global descriptor table (GDT) of one CPU by setting up the 7 entries of GDT, setting the GDTR
+ * register to point to our GDT address, and then (through assembly `lgdt` instruction) load our GDT.
  *
  * - Entry 0: Null descriptor     (required by x86 architecture)
  * - Entry 1: Kernel code segment (0x00000000 - 0xFFFFFFFF, executable, ring 0)
@@ -82,8 +106,10 @@ static void tss_init(void) {
  * - Entry 3: User code segment   (0x00000000 - 0xFFFFFFFF, executable, ring 3)
  * - Entry 4: User data segment   (0x00000000 - 0xFFFFFFFF, read/write, ring 3)
  * - Entry 5: TSS                 (Task State Segment for privilege transitions)
+ * - Entry 6: Per-CPU data        (the CPU's cpu_t, read/write, ring 0, loaded into FS)
  */
-void gdt_init() {
+void gdt_init_cpu(cpu_t* cpu) {
+    gdt_entry_t* gdt = cpu->gdt;
     /**
      * Access Byte -
      *   - P     = 1: present, must be 1 for valid selectors
@@ -108,37 +134,50 @@ void gdt_init() {
      */
 
     // The first descriptor in the GDT is always a null descriptor and can never be used to access memory.
-    gdt_set_entry(SEGMENT_UNUSED, 0u, 0u, 0u, 0u);
+    gdt_set_entry(gdt, SEGMENT_UNUSED, 0u, 0u, 0u, 0u);
     /* Access:
      * Bit:     |  7  |  6  5 |  4  |  3  |  2  |  1  |  0  |
      * Content: |  P  |  DPL  |  S  |  E  |  DC |  RW |  A  |
      * Value:   |  1  |  0 0  |  1  |  1  |  0  |  1  |  0  | = 1001 1010 = 0x9A
     */
-    gdt_set_entry(SEGMENT_KCODE, 0u, 0xFFFFF, 0x9A, 0xC0);
+    gdt_set_entry(gdt, SEGMENT_KCODE, 0u, 0xFFFFF, 0x9A, 0xC0);
     /* Access:
      * Bit:     |  7  |  6  5 |  4  |  3  |  2  |  1  |  0  |
      * Content: |  P  |  DPL  |  S  |  E  |  DC |  RW |  A  |
      * Value:   |  1  |  0 0  |  1  |  0  |  0  |  1  |  0  | = 1001 0010 = 0x92
     */
-    gdt_set_entry(SEGMENT_KDATA, 0u, 0xFFFFF, 0x92, 0xC0);
+    gdt_set_entry(gdt, SEGMENT_KDATA, 0u, 0xFFFFF, 0x92, 0xC0);
     /* Access:
      * Bit:     |  7  |  6  5 |  4  |  3  |  2  |  1  |  0  |
      * Content: |  P  |  DPL  |  S  |  E  |  DC |  RW |  A  |
      * Value:   |  1  |  1 1  |  1  |  1  |  0  |  1  |  0  | = 1111 1010 = 0xFA
     */
-    gdt_set_entry(SEGMENT_UCODE, 0u, 0xFFFFF, 0xFA, 0xC0);
+    gdt_set_entry(gdt, SEGMENT_UCODE, 0u, 0xFFFFF, 0xFA, 0xC0);
     /* Access:
      * Bit:     |  7  |  6  5 |  4  |  3  |  2  |  1  |  0  |
      * Content: |  P  |  DPL  |  S  |  E  |  DC |  RW |  A  |
      * Value:   |  1  |  1 1  |  1  |  0  |  0  |  1  |  0  | = 1111 0010 = 0xF2
     */
-    gdt_set_entry(SEGMENT_UDATA, 0u, 0xFFFFF, 0xF2, 0xC0);
+    gdt_set_entry(gdt, SEGMENT_UDATA, 0u, 0xFFFFF, 0xF2, 0xC0);
+    /* Same access byte as the kernel data segment, but based at the cpu_t and only as long as it, with
+     * byte granularity (G = 0, DB = 1 → flags 0x40): %fs:offset addresses a field of this CPU's data. */
+    cpu->self = cpu;
+    gdt_set_entry(gdt, SEGMENT_PERCPU, (uint32_t) cpu, sizeof(cpu_t) - 1, 0x92, 0x40);
     /* Setup the GDTR register value. */
-    gdtr.boundary = (sizeof(gdt_entry_t) * NUM_SEGMENTS) - 1;
-    gdtr.base     = (uint32_t) &gdt;
+    cpu->gdtr.boundary = (sizeof(gdt_entry_t) * NUM_SEGMENTS) - 1;
+    cpu->gdtr.base     = (uint32_t) gdt;
     /* Load the new GDT */
-    gdt_load((uint32_t) &gdtr);
+    gdt_load((uint32_t) &cpu->gdtr);
     /* Initialize and load the TSS */
-    tss_init();
-    printf("[  OK  ] GDT initialized successfully.\n");
+    tss_init(cpu);
+}
+
+/**
+ * Initialize the GDT and TSS of the boot CPU (cpus[0]), which keeps running on the boot stack.
+ */
+void gdt_init() {
+    cpus[0].id = 0;
+    cpus[0].stack_top = (uint32_t) &stack_top;
+    gdt_init_cpu(&cpus[0]);
+    klog(KLOG_INFO, "[  OK  ] GDT initialized successfully.\n");
 }
@@ -0,0 +1,60 @@
+/**
+ * CPU Idle (MONITOR/MWAIT or HLT)
+ *
+ * hlt only ends with an interrupt, so a CPU that wakes a halted one has to
+ * send it an IPI. MONITOR arms a watch on one cache line, and MWAIT then
+ * sleeps like hlt until an interrupt or a store to that line:
+ *
+ *   cli → monitor &wake → wake set? → done
+ *                        → sti; mwait (sti's shadow covers the mwait: an
+ *                          interrupt can't slip in between and be missed)
+ *
+ * Checking the flag after MONITOR closes the other race: a store that comes
+ * before the watch is armed is seen by the check, one after it ends mwait.
+ *
+ * The hint asks for C1, the state hlt enters; deeper C-states are the
+ * business of a power-management driver this kernel doesn't have.
+ *
+ * Reference: Intel SDM Vol. 2B, MONITOR and MWAIT; Vol. 3A, 14.5 "MWAIT Extensions"
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "include/idle.h"
+#include "include/cpuid.h"
+
+#define MWAIT_HINT_C1           0x0
+
+/* 1 if MONITOR/MWAIT are usable, -1 until the first cpu_idle() checks CPUID */
+static int idle_mwait = -1;
+
+/**
+ * Check whether cpu_idle() waits with MONITOR/MWAIT
+ */
+bool cpu_idle_mwait(void) {
+    if (idle_mwait < 0) {
+        /* C1 needs nothing from leaf 5, which hypervisors often leave empty */
+        idle_mwait = cpuid_has_ecx(CPUID_ECX_MONITOR) ? 1 : 0;
+    }
+    return idle_mwait == 1;
+}
+
+/**
+ * Idle until an interrupt or a store to *wake
+ */
+void cpu_idle(const volatile bool* wake) {
+    bool mwait = cpu_idle_mwait();
+    if (mwait) {
+        asm volatile("monitor" :: "a"(wake), "c"(0), "d"(0));
+    }
+    if (*wake) {
+        asm volatile("sti" ::: "memory");
+    }
+    else if (mwait) {
+        asm volatile("sti; mwait" :: "a"(MWAIT_HINT_C1), "c"(0) : "memory");
+    }
+    else {
+        asm volatile("sti; hlt" ::: "memory");
+    }
+}
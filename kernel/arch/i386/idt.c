@@ -2,6 +2,8 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <kernel/klog.h>
+
 #include "include/interrupts.h"
 #include "include/pic.h"
 
@@ -123,6 +125,15 @@ void idt_init(void) {
 
 	/* This allows the CPU to respond to interrupts. Without this, the CPU will ignore all interrupts except
 	 * NMI (Non-Maskable Interrupt). */
-	printf("[  OK  ] IDT initialized successfully.\n");
+	klog(KLOG_INFO, "[  OK  ] IDT initialized successfully.\n");
 	asm volatile ("sti");  /* Enable interrupts globally */
 }
+
+/**
+ * Load the IDT on the calling CPU.
+ *
+ * All CPUs share one table; the application processors only need their IDTR pointed at it.
+ */
+void idt_load_cpu(void) {
+	idt_load((uint32_t)&idtr);
+}
@@ -0,0 +1,49 @@
+#ifndef ARCH_I386_ACPI_H
+#define ARCH_I386_ACPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ACPI Static Tables (MADT only)
+ *
+ * acpi_init() finds the RSDP in the EBDA or the BIOS area, walks the RSDT
+ * and reads the MADT ("APIC"): the local APIC address, the CPUs, the first
+ * IOAPIC and the ISA interrupt source overrides.
+ *
+ * Reference: ACPI Specification 6.5, 5.2.12 Multiple APIC Description Table
+ */
+
+#define ACPI_MAX_CPUS           16
+
+/* MADT interrupt source override flags (MPS INTI flags) */
+#define ACPI_INTI_POLARITY_MASK 0x3
+#define ACPI_INTI_ACTIVE_LOW    0x3
+#define ACPI_INTI_TRIGGER_MASK  0xC
+#define ACPI_INTI_LEVEL         0xC
+
+typedef struct {
+    uint32_t lapic_phys;                /* Local APIC registers */
+    uint32_t ioapic_phys;               /* First IOAPIC's registers, 0 if none */
+    uint32_t ioapic_gsi_base;           /* First global system interrupt of that IOAPIC */
+    uint8_t ioapic_id;
+    uint32_t cpu_count;                 /* Enabled processors */
+    uint8_t cpu_apic_ids[ACPI_MAX_CPUS];  /* Local APIC ID of each, boot CPU among them */
+    uint32_t isa_gsi[16];               /* GSI each ISA IRQ is wired to */
+    uint16_t isa_flags[16];             /* ACPI_INTI_* flags of each ISA IRQ */
+    bool pcat_compat;                   /* Dual 8259s are present (and must be masked) */
+} acpi_madt_t;
+
+/**
+ * Find and parse the MADT
+ *
+ * @return 0 on success, -1 if there is no valid RSDP, RSDT or MADT
+ */
+int acpi_init(void);
+
+/**
+ * Parsed MADT (valid after acpi_init() succeeded)
+ */
+const acpi_madt_t* acpi_madt(void);
+
+#endif
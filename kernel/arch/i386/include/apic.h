@@ -0,0 +1,103 @@
+#ifndef ARCH_I386_APIC_H
+#define ARCH_I386_APIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/apic.h>
+
+#define APIC_SPURIOUS_VECTOR    0xFF    /* Low 4 bits must be set on older CPUs */
+/* Local interrupts of the kernel's own; must match isr_stubs.nasm */
+#define LAPIC_TICK_VECTOR       0xF0    /* Scheduler tick of an application processor (timer.c) */
+#define IPI_RESCHED_VECTOR      0xF1    /* A thread woke up in another CPU's run queue (thread.c) */
+#define IPI_TLB_VECTOR          0xF2    /* TLB shootdown (paging.c) */
+
+/* Interrupt command register values for lapic_send_ipi() */
+#define LAPIC_IPI_FIXED         0x4000  /* Fixed delivery, level assert; low byte = vector */
+#define LAPIC_IPI_INIT          0x4500  /* INIT, level assert: reset the target into wait-for-SIPI */
+#define LAPIC_IPI_STARTUP       0x4600  /* STARTUP; low byte = page number of the real-mode entry point */
+
+/**
+ * Signal end of interrupt to the local APIC
+ */
+void lapic_eoi(void);
+
+/**
+ * Local APIC ID of the running CPU
+ */
+uint8_t lapic_id(void);
+
+/**
+ * Send an inter-processor interrupt and wait until the LAPIC has accepted it
+ *
+ * @param apic_id Local APIC ID of the target CPU
+ * @param command Low word of the interrupt command register (LAPIC_IPI_*, or a fixed vector)
+ */
+void lapic_send_ipi(uint8_t apic_id, uint32_t command);
+
+/**
+ * Enable the local APIC of the running CPU (application processors; apic_init() does the boot CPU)
+ *
+ * Does nothing if apic_init() didn't enable the APIC.
+ */
+void lapic_init_cpu(void);
+
+/**
+ * Route an ISA IRQ to vector 32 + irq and unmask it at the IOAPIC
+ *
+ * @param irq ISA IRQ (0..15)
+ */
+void ioapic_unmask_irq(uint8_t irq);
+
+/**
+ * Mask an ISA IRQ at the IOAPIC
+ *
+ * @param irq ISA IRQ (0..15)
+ */
+void ioapic_mask_irq(uint8_t irq);
+
+/**
+ * Start the LAPIC timer counting down from its maximum, without interrupts
+ *
+ * Used to measure its rate against the PIT; read with lapic_timer_elapsed().
+ */
+void lapic_timer_count_start(void);
+
+/**
+ * LAPIC timer counts since lapic_timer_count_start()
+ */
+uint32_t lapic_timer_elapsed(void);
+
+/**
+ * Fire the LAPIC timer periodically on a vector
+ *
+ * @param count Timer counts per period (at the divider lapic_timer_count_start() set)
+ * @param vector Interrupt vector
+ */
+void lapic_timer_periodic(uint32_t count, uint8_t vector);
+
+/**
+ * Fire the LAPIC timer once on a vector
+ *
+ * @param count Timer counts until it fires (at the divider lapic_timer_count_start() set)
+ * @param vector Interrupt vector
+ */
+void lapic_timer_oneshot(uint32_t count, uint8_t vector);
+
+/**
+ * Fire the LAPIC timer once when the TSC reaches a value (TSC-deadline mode)
+ *
+ * Only if CPUID reports CPUID_ECX_TSC_DEADLINE. A deadline already passed
+ * fires at once. lapic_timer_periodic() or lapic_timer_oneshot() leave the mode.
+ *
+ * @param tsc TSC value to fire at
+ * @param vector Interrupt vector
+ */
+void lapic_timer_deadline(uint64_t tsc, uint8_t vector);
+
+/**
+ * Spurious interrupts the LAPIC raised (vector APIC_SPURIOUS_VECTOR)
+ */
+uint32_t apic_spurious_count(void);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ARCH_I386_CPUID_H
+#define ARCH_I386_CPUID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * CPUID leaf 1 feature bits
+ * Reference: Intel SDM Vol. 2A, CPUID - Table 3-10/3-11
+ */
+#define CPUID_LEAF_FEATURES     0x1
+
+/* EDX */
+#define CPUID_EDX_FPU           (1 << 0)    /* x87 FPU on chip */
+#define CPUID_EDX_PSE           (1 << 3)    /* Page Size Extension (4 MiB pages) */
+#define CPUID_EDX_TSC           (1 << 4)    /* Time Stamp Counter (rdtsc) */
+#define CPUID_EDX_APIC          (1 << 9)    /* Local APIC on chip */
+#define CPUID_EDX_SEP           (1 << 11)   /* SYSENTER/SYSEXIT */
+#define CPUID_EDX_PGE           (1 << 13)   /* Page Global Enable */
+#define CPUID_EDX_FXSR          (1 << 24)   /* fxsave/fxrstor */
+#define CPUID_EDX_SSE           (1 << 25)
+#define CPUID_EDX_SSE2          (1 << 26)
+
+/* ECX */
+#define CPUID_ECX_SSE3          (1 << 0)
+#define CPUID_ECX_MONITOR       (1 << 3)    /* MONITOR/MWAIT */
+#define CPUID_ECX_TSC_DEADLINE  (1 << 24)   /* LAPIC timer TSC-deadline mode */
+
+/**
+ * Execute CPUID for a leaf (subleaf 0)
+ *
+ * @param leaf Value loaded into EAX
+ * @param eax, ebx, ecx, edx Output registers
+ */
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    asm volatile("cpuid"
+                 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                 : "a"(leaf), "c"(0));
+}
+
+/**
+ * Check an EDX feature bit of CPUID leaf 1
+ */
+static inline bool cpuid_has_edx(uint32_t feature) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_LEAF_FEATURES, &eax, &ebx, &ecx, &edx);
+    return (edx & feature) != 0;
+}
+
+/**
+ * Check an ECX feature bit of CPUID leaf 1
+ */
+static inline bool cpuid_has_ecx(uint32_t feature) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_LEAF_FEATURES, &eax, &ebx, &ecx, &edx);
+    return (ecx & feature) != 0;
+}
+
+#endif
@@ -14,6 +14,64 @@ typedef uint8_t		Elf32_Char;
 #define ELF32_ST_TYPE(info)		((info) & 0xf)
 #define ELF_SYM_TYPE_FUNC		0x2
 
+/* e_ident[] indexes and values */
+#define EI_MAG0			0
+#define EI_CLASS		4		/* File class. */
+#define EI_DATA			5		/* Data encoding. */
+#define EI_NIDENT		16		/* Size of e_ident array. */
+
+#define ELFMAG			"\177ELF"
+#define SELFMAG			4
+#define ELFCLASS32		1		/* 32-bit objects. */
+#define ELFDATA2LSB		1		/* 2's complement little-endian. */
+
+#define ET_EXEC			2		/* Executable. */
+#define EM_386			3		/* Intel i386. */
+
+/* Values for p_type. */
+#define PT_LOAD			1		/* Loadable segment. */
+
+/* Values for p_flags. */
+#define PF_X			0x1		/* Executable. */
+#define PF_W			0x2		/* Writable. */
+#define PF_R			0x4		/* Readable. */
+
+/*
+ * ELF header.
+ */
+struct Elf32_Ehdr {
+    unsigned char	e_ident[EI_NIDENT];	/* File identification. */
+    Elf32_Half	e_type;			/* File type. */
+    Elf32_Half	e_machine;		/* Machine architecture. */
+    Elf32_Word	e_version;		/* ELF format version. */
+    Elf32_Addr	e_entry;		/* Entry point. */
+    Elf32_Off	e_phoff;		/* Program header file offset. */
+    Elf32_Off	e_shoff;		/* Section header file offset. */
+    Elf32_Word	e_flags;		/* Architecture-specific flags. */
+    Elf32_Half	e_ehsize;		/* Size of ELF header in bytes. */
+    Elf32_Half	e_phentsize;	/* Size of program header entry. */
+    Elf32_Half	e_phnum;		/* Number of program header entries. */
+    Elf32_Half	e_shentsize;	/* Size of section header entry. */
+    Elf32_Half	e_shnum;		/* Number of section header entries. */
+    Elf32_Half	e_shstrndx;		/* Section name strings section. */
+} __attribute__((packed));
+typedef struct Elf32_Ehdr Elf32_Ehdr_t;
+
+/*
+ * Program header.
+ */
+struct Elf32_Phdr {
+    Elf32_Word	p_type;			/* Entry type. */
+    Elf32_Off	p_offset;		/* File offset of contents. */
+    Elf32_Addr	p_vaddr;		/* Virtual address in memory image. */
+    Elf32_Addr	p_paddr;		/* Physical address (not used). */
+    Elf32_Word	p_filesz;		/* Size of contents in file. */
+    Elf32_Word	p_memsz;		/* Size of contents in memory. */
+    Elf32_Word	p_flags;		/* Access permission flags. */
+    Elf32_Word	p_align;		/* Alignment in memory and file. */
+} __attribute__((packed));
+typedef struct Elf32_Phdr Elf32_Phdr_t;
+
 /*
  * Section header.
  */
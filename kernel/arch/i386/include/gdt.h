@@ -181,8 +181,9 @@ typedef struct tss_entry tss_entry_t;
 #define SEGMENT_UCODE  0x3
 #define SEGMENT_UDATA  0x4
 #define SEGMENT_TSS    0x5
+#define SEGMENT_PERCPU 0x6  /* Data segment based at the CPU's cpu_t (percpu.h) */
 
-#define NUM_SEGMENTS    6
+#define NUM_SEGMENTS    7
 
 /* Segment selectors with proper RPL (Requested Privilege Level) encoding.
  *
@@ -204,8 +205,12 @@ typedef struct tss_entry tss_entry_t;
  * - SEGMENT_KDATA (2) → (2 << 3) | 0 | 0 = 0x10 (kernel data selector)
  * - SEGMENT_UCODE (3) → (3 << 3) | 0 | 3 = 0x1B (user code selector, Ring 3)
  * - SEGMENT_UDATA (4) → (4 << 3) | 0 | 3 = 0x23 (user data selector, Ring 3)
+ * - SEGMENT_PERCPU (6) → (6 << 3) | 0 | 0 = 0x30 (per-CPU data selector, kept in FS)
  */
 #define KERNEL_CS ((SEGMENT_KCODE << 3) | 0x0)  /* 0x08: Kernel code segment, Ring 0, GDT */
 #define KERNEL_DS ((SEGMENT_KDATA << 3) | 0x0)  /* 0x10: Kernel data segment, Ring 0, GDT */
+#define USER_CS   ((SEGMENT_UCODE << 3) | 0x3)  /* 0x1B: User code segment, Ring 3, GDT */
+#define USER_DS   ((SEGMENT_UDATA << 3) | 0x3)  /* 0x23: User data segment, Ring 3, GDT */
+#define KERNEL_PERCPU ((SEGMENT_PERCPU << 3) | 0x0)  /* 0x30: Per-CPU data segment, Ring 0, GDT */
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef ARCH_I386_IDLE_H
+#define ARCH_I386_IDLE_H
+
+#include <stdbool.h>
+
+/**
+ * Idle the running CPU until an interrupt or a store to a wake flag
+ *
+ * With MONITOR/MWAIT the CPU watches the cache line of *wake, so a store to
+ * it, from this CPU's IRQs or another CPU, ends the wait as well as an
+ * interrupt does. Without it the CPU halts
+ * and only an interrupt ends the wait. Returns at once if *wake is set.
+ *
+ * Call with interrupts disabled, after checking the condition the caller
+ * sleeps on; interrupts are enabled on return. The wait may also end for no
+ * reason (another store to the same line), so callers re-check in a loop.
+ *
+ * @param wake Flag to watch
+ */
+void cpu_idle(const volatile bool* wake);
+
+/**
+ * Check whether cpu_idle() waits with MONITOR/MWAIT
+ */
+bool cpu_idle_mwait(void);
+
+#endif
@@ -310,4 +310,9 @@ void isr_handler(regs_t* r);
  */
 void idt_init(void);
 
+/**
+ * Load the IDT built by idt_init() on the calling CPU (application processors share it)
+ */
+void idt_load_cpu(void);
+
 #endif
@@ -17,4 +17,54 @@ void outb(unsigned short port, unsigned char data);
 */
 unsigned char inb(unsigned short port);
 
+/** outw:
+ * Sends a 16-bit word to an I/O port. Defined in io.nasm
+ *
+ * @param port    The I/O port to send the data to
+ * @param data    The word to send to the I/O port
+*/
+void outw(unsigned short port, unsigned short data);
+
+/** inw:
+ * Read a 16-bit word from an I/O port. Defined in io.nasm
+ *
+ * @param port    The address of the I/O port
+ * @return        The read word
+*/
+unsigned short inw(unsigned short port);
+
+/** outl:
+ * Sends a 32-bit double word to an I/O port. Defined in io.nasm
+ *
+ * @param port    The I/O port to send the data to
+ * @param data    The double word to send to the I/O port
+*/
+void outl(unsigned short port, unsigned int data);
+
+/** inl:
+ * Read a 32-bit double word from an I/O port. Defined in io.nasm
+ *
+ * @param port    The address of the I/O port
+ * @return        The read double word
+*/
+unsigned int inl(unsigned short port);
+
+/** insw:
+ * Read count words from an I/O port into a buffer (rep insw). Defined in io.nasm
+ *
+ * @param port    The address of the I/O port
+ * @param buf     Destination, count * 2 bytes
+ * @param count   Number of words
+*/
+void insw(unsigned short port, void* buf, unsigned int count);
+
+/** outsw:
+ * Write count words from a buffer to an I/O port (rep outsw). Defined in io.nasm
+ *
+ * @param port    The I/O port to send the data to
+ * @param buf     Source, count * 2 bytes
+ * @param count   Number of words
+*/
+void outsw(unsigned short port, const void* buf, unsigned int count);
+
 #endif
\ No newline at end of file
@@ -32,4 +32,11 @@ int reqister_irq(int irq, irq_handler_fn handler);
  */
 int unregister_irq(int irq);
 
+/**
+ * Deliver IRQs through the IOAPIC and acknowledge them at the LAPIC from now on
+ *
+ * Called by apic_init() with interrupts disabled, once both are programmed.
+ */
+void irq_use_apic(void);
+
 #endif
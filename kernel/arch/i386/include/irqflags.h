@@ -0,0 +1,40 @@
+#ifndef ARCH_I386_IRQFLAGS_H
+#define ARCH_I386_IRQFLAGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EFLAGS_IF   0x200   /* Interrupt enable flag */
+
+/**
+ * Disable interrupts and return the previous EFLAGS
+ *
+ * @return EFLAGS before cli, for irq_restore()
+ */
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/**
+ * Re-enable interrupts if they were enabled when irq_save() was called
+ *
+ * @param flags Value returned by irq_save()
+ */
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        asm volatile("sti" : : : "memory");
+    }
+}
+
+/**
+ * Check whether interrupts are enabled
+ */
+static inline bool irqs_enabled(void) {
+    uint32_t flags;
+    asm volatile("pushf; pop %0" : "=r"(flags));
+    return (flags & EFLAGS_IF) != 0;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef ARCH_I386_MSR_H
+#define ARCH_I386_MSR_H
+
+#include <stdint.h>
+
+/**
+ * Model-specific registers
+ * Reference: Intel SDM Vol. 4, Table 2-2 (IA-32 Architectural MSRs)
+ */
+#define MSR_IA32_SYSENTER_CS    0x174       /* Ring 0 CS for SYSENTER; SS = CS + 8, SYSEXIT uses CS + 16/24 */
+#define MSR_IA32_SYSENTER_ESP   0x175       /* ESP loaded by SYSENTER */
+#define MSR_IA32_SYSENTER_EIP   0x176       /* EIP loaded by SYSENTER */
+
+/**
+ * Read a model-specific register
+ */
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+/**
+ * Write a model-specific register
+ */
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" :: "c"(msr), "a"((uint32_t) value), "d"((uint32_t) (value >> 32)));
+}
+
+#endif
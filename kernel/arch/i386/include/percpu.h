@@ -0,0 +1,68 @@
+#ifndef ARCH_I386_PERCPU_H
+#define ARCH_I386_PERCPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/smp.h>
+
+#include "gdt.h"
+
+/**
+ * Per-CPU Data
+ *
+ * Every CPU has a cpu_t holding its GDT and TSS. Descriptor SEGMENT_PERCPU
+ * of that GDT is a data segment based at the cpu_t itself, and the kernel
+ * runs with FS = KERNEL_PERCPU, so one instruction finds a different
+ * structure on each CPU:
+ *
+ *   mov %fs:0, %eax     → eax = this CPU's cpu_t (its self pointer)
+ *
+ * gdt_init_cpu() loads FS. The interrupt and system call stubs reload it on
+ * entry from ring 3 and give user space its own value back on the way out.
+ */
+
+typedef struct cpu {
+    struct cpu* self;           /* At FS:0, see cpu_self() */
+    uint32_t id;                /* 0 = boot CPU, then in MADT order */
+    uint8_t apic_id;            /* Local APIC ID, the target of IPIs */
+    volatile bool online;       /* Set by the CPU itself once it is running kernel code */
+    uint32_t stack_top;         /* Stack it booted on, TSS esp0 until it runs a thread */
+    volatile uint32_t rcu_nesting;  /* Depth of rcu_read_lock() sections running here */
+    volatile uint32_t rcu_seq;      /* Outermost rcu_read_unlock() calls so far */
+    struct thread* fpu_owner;   /* Thread whose state is in the FPU registers (fpu.c), NULL if none */
+    volatile bool fpu_kernel;   /* Inside kernel_fpu_begin() .. kernel_fpu_end() */
+    volatile uint32_t cr3;      /* Page directory loaded here, for TLB shootdowns (paging.c) */
+    tss_entry_t tss __attribute__((aligned(16)));
+    gdt_entry_t gdt[NUM_SEGMENTS] __attribute__((aligned(8)));
+    gdt_register_t gdtr;
+} __attribute__((aligned(64))) cpu_t;  /* One cache line apart: no false sharing of the hot fields */
+
+/* Indexed by cpu_t.id; defined in smp.c */
+extern cpu_t cpus[SMP_MAX_CPUS];
+
+/**
+ * Per-CPU data of the running CPU
+ *
+ * Before gdt_init() FS still holds the boot loader's selector; only the boot
+ * CPU is running then, so its entry is returned.
+ */
+static inline cpu_t* cpu_self(void) {
+    uint16_t fs;
+    asm volatile("mov %%fs, %0" : "=r"(fs));
+    if (fs != KERNEL_PERCPU) {
+        return &cpus[0];
+    }
+    cpu_t* cpu;
+    asm("mov %%fs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+/**
+ * Build and load a CPU's GDT and TSS, and point FS at its cpu_t
+ *
+ * @param cpu CPU to set up; must be the one running. cpu->stack_top becomes esp0.
+ */
+void gdt_init_cpu(cpu_t* cpu);
+
+#endif
@@ -15,6 +15,9 @@ void pic_unmask(uint8_t irq);
 /** Mask (disable) a specific IRQ line at the PIC. */
 void pic_mask(uint8_t irq);
 
+/** Mask all lines of both PICs (the IOAPIC delivers interrupts instead). */
+void pic_disable(void);
+
 /** Read the Interrupt Request Register (IRR) from both PICs. Returns pending interrupts. */
 uint16_t pic_get_irr(void);
 
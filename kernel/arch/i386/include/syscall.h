@@ -1,6 +1,9 @@
 #ifndef ARCH_I386_SYSCALL_H
 #define ARCH_I386_SYSCALL_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 /* System call numbers
  * 
  * These syscall numbers match the Linux i386 syscall table for compatibility.
@@ -9,8 +12,18 @@
  * @see https://chromium.googlesource.com/chromiumos/docs/+/master/constants/syscalls.md#x86-32_bit
  */
 #define SYSCALL_EXIT    1   /* Exit process */
-#define SYSCALL_READ    3   /* Read from keyboard */
+#define SYSCALL_FORK    2   /* Duplicate the calling process (copy-on-write) */
+#define SYSCALL_READ    3   /* Read from keyboard or an open file */
 #define SYSCALL_WRITE   4   /* Write to console */
+#define SYSCALL_OPEN    5   /* Open a file of the VFS */
+#define SYSCALL_CLOSE   6   /* Close a file descriptor */
+#define SYSCALL_LSEEK   19  /* Move the offset of an open file */
+#define SYSCALL_BRK     45  /* Move the end of the heap */
+#define SYSCALL_MMAP    90  /* Map a file or anonymous memory (old_mmap: arguments in a struct) */
+#define SYSCALL_MUNMAP  91  /* Remove a mapping */
+#define SYSCALL_MADVISE 219 /* Give memory back to the kernel */
+#define SYSCALL_IORING_SETUP    425 /* Map a submission/completion ring (io_uring_setup) */
+#define SYSCALL_IORING_ENTER    426 /* Run queued submissions (io_uring_enter) */
 
 /**
  * Initialize the system call interface.
@@ -19,4 +32,42 @@
  */
 void syscall_init(void);
 
+/**
+ * Program the SYSENTER MSRs of the running CPU
+ *
+ * syscall_init() does it for the boot CPU; every application processor that
+ * runs user threads needs it too, since the MSRs are per CPU. Works before
+ * syscall_init() as well.
+ *
+ * @return true if the CPU supports SYSENTER
+ */
+bool syscall_init_cpu(void);
+
+/**
+ * Check whether the SYSENTER fast system call entry is set up
+ *
+ * @return true if the CPU supports SYSENTER and syscall_init() programmed its MSRs
+ */
+bool syscall_sysenter_enabled(void);
+
+/**
+ * Name of a system call, for diagnostics
+ *
+ * @param num System call number
+ * @return Name, or "unknown" for unassigned numbers
+ */
+const char* syscall_name(uint32_t num);
+
+/**
+ * Run a system call on behalf of the current process
+ *
+ * Buffer arguments are validated as for a call from ring 3. Used to run
+ * queued requests (see kernel/ioring.h).
+ *
+ * @param num System call number
+ * @param arg1, arg2, arg3 Arguments (EBX, ECX, EDX)
+ * @return The system call's result
+ */
+uint32_t syscall_invoke_user(uint32_t num, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
 #endif
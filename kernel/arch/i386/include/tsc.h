@@ -0,0 +1,19 @@
+#ifndef ARCH_I386_TSC_H
+#define ARCH_I386_TSC_H
+
+#include <stdint.h>
+
+/**
+ * Read the Time Stamp Counter
+ *
+ * Counts CPU cycles since reset. Check CPUID_EDX_TSC before relying on it.
+ *
+ * @return Current TSC value
+ */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+#endif
@@ -10,6 +10,17 @@
 static const size_t VGA_WIDTH = 80;
 static const size_t VGA_HEIGHT = 25;
 
+/* Largest text grid, for the framebuffer console (kernel/fbcon.h) */
+#define CONSOLE_MAX_COLS    256
+#define CONSOLE_MAX_ROWS    128
+
+/* Lines kept in the shadow ring: the screen plus scrollback history */
+#define VGA_RING_LINES      256
+
+/* Current text grid: VGA_WIDTH x VGA_HEIGHT until the framebuffer console takes over */
+extern size_t console_cols;
+extern size_t console_rows;
+
 /* VGA ports for controlling the text-mode cursor */
 // CRT Controller Index Register - selects which register to write to
 #define VGA_COMMAND_PORT    0x3D4
@@ -121,15 +132,26 @@ void vga_initialize(void);
  *
  * @param c     Character to write
  * @param color Combined foreground/background color attribute
- * @param x     Column position (0 to VGA_WIDTH - 1)
- * @param y     Row position (0 to VGA_HEIGHT - 1)
+ * @param x     Column position (0 to console_cols - 1)
+ * @param y     Row position (0 to console_rows - 1)
  */
 void vga_write_char_at(unsigned char c, uint8_t color, size_t x, size_t y);
 
+/**
+ * Write a run of characters on one row, starting at a position
+ *
+ * @param data  Characters to write (no control characters)
+ * @param size  Number of characters (must fit before the end of the row)
+ * @param color Combined foreground/background color attribute
+ * @param x     Column of the first character
+ * @param y     Row position (0 to console_rows - 1)
+ */
+void vga_write_run_at(const char* data, size_t size, uint8_t color, size_t x, size_t y);
+
 /**
  * Update the cursor to a specific position
  *
- * @param pos New cursor position (row * VGA_WIDTH + column)
+ * @param pos New cursor position (row * console_cols + column)
  */
 void vga_update_cursor_position(uint16_t pos);
 
@@ -138,7 +160,35 @@ void vga_update_cursor_position(uint16_t pos);
  *
  * Moves all lines up one position and clears the bottom line.
  * Used when terminal output reaches the bottom of the screen.
+ * The line scrolled off is kept as scrollback history.
  */
 void vga_scroll(void);
 
+/**
+ * Copy the cells changed since the last flush to VGA memory (or the framebuffer)
+ *
+ * Writes only go to the shadow buffer until this is called.
+ */
+void vga_flush(void);
+
+/**
+ * Hand the screen over to the framebuffer console with a larger grid
+ *
+ * The shadow lines keep their contents (now with blanks to their right) and
+ * everything is redrawn through fbcon_draw_cells(). Called once by fbcon_init().
+ *
+ * @param cols Columns (VGA_WIDTH to CONSOLE_MAX_COLS)
+ * @param rows Rows (VGA_HEIGHT to CONSOLE_MAX_ROWS)
+ */
+void vga_attach_framebuffer(size_t cols, size_t rows);
+
+/**
+ * Move the view into the scrollback history and redraw
+ *
+ * Any new output returns the view to the live screen.
+ *
+ * @param lines Lines to move (positive = back in history, negative = towards the live screen)
+ */
+void vga_scroll_view(int lines);
+
 #endif
@@ -0,0 +1,250 @@
+/**
+ * Boot Initcalls
+ *
+ *   initcall_run(table): for each stage
+ *     → deferred or parallel? record it for later
+ *     → else stamp → func() → stamp → record start and cycles
+ *
+ *   initcall_start_deferred()
+ *     → "initcalls" thread: the deferred stages, in table order
+ *     → one thread per parallel stage
+ *     → the last thread to finish logs their breakdown, wakes waiters
+ *
+ * Stamps are raw rdtsc values: the stages before timer_initialize() run
+ * before the TSC is calibrated, so cycles are only converted to time when
+ * they are reported. Without a TSC the stages run untimed.
+ *
+ * deferred_left counts the threads still running, plus one held by
+ * initcall_start_deferred() while it creates them, so a thread that finishes
+ * early can't report before the others exist.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/initcall.h>
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+
+#include "include/cpuid.h"
+#include "include/tsc.h"
+
+static initcall_record_t records[INITCALL_MAX];
+static int (*record_funcs[INITCALL_MAX])(void);
+static size_t record_count = 0;
+
+static bool boot_started = false;
+static bool has_tsc = false;
+static uint64_t boot_tsc = 0;
+
+static bool deferred_started = false;
+static uint32_t deferred_left = 0;
+static wait_queue_t deferred_wq = WAIT_QUEUE_INIT;
+
+static inline uint64_t initcall_stamp(void) {
+    return has_tsc ? rdtsc() : 0;
+}
+
+static inline bool is_deferred(uint32_t flags) {
+    return (flags & (INITCALL_DEFERRED | INITCALL_PARALLEL)) != 0;
+}
+
+/**
+ * Run a recorded stage and time it
+ */
+static void initcall_exec(size_t index) {
+    initcall_record_t* record = &records[index];
+    uint64_t start = initcall_stamp();
+    int result = record_funcs[index]();
+    uint64_t end = initcall_stamp();
+    record->start = start - boot_tsc;
+    record->cycles = end - start;
+    record->result = result;
+    __atomic_store_n(&record->done, true, __ATOMIC_RELEASE);
+    if (result < 0) {
+        klog(KLOG_WARN, "initcall: %s failed (%d)\n", record->name, result);
+    }
+}
+
+/**
+ * Log one stage of the breakdown
+ */
+static void report_record(const initcall_record_t* record) {
+    const char* kind = (record->flags & INITCALL_PARALLEL) ? ", parallel" :
+                       (record->flags & INITCALL_DEFERRED) ? ", deferred" : "";
+    if (!__atomic_load_n(&record->done, __ATOMIC_ACQUIRE)) {
+        klog(KLOG_INFO, "  %s: pending%s\n", record->name, kind);
+        return;
+    }
+    klog(KLOG_INFO, "  %s: %u us, at %u us%s%s\n", record->name, (uint32_t) initcall_cycles_to_us(record->cycles),
+                    (uint32_t) initcall_cycles_to_us(record->start), kind, record->result < 0 ? ", FAILED" : "");
+}
+
+/**
+ * Drop a reference on deferred_left; the last one reports the deferred stages
+ */
+static void deferred_put(void) {
+    if (__atomic_sub_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    klog(KLOG_INFO, "[  OK  ] Deferred initcalls finished (%u us since boot):\n",
+                    (uint32_t) initcall_cycles_to_us(initcall_stamp() - boot_tsc));
+    for (size_t i = 0; i < record_count; i++) {
+        if (is_deferred(records[i].flags)) {
+            report_record(&records[i]);
+        }
+    }
+    wake_up(&deferred_wq);
+}
+
+/**
+ * Thread running the INITCALL_DEFERRED stages in order
+ *
+ * @param arg Number of stages recorded when it was started (later ones run in initcall_run())
+ */
+static void initcall_serial_thread(void* arg) {
+    size_t count = (size_t) (uintptr_t) arg;
+    for (size_t i = 0; i < count; i++) {
+        if ((records[i].flags & INITCALL_DEFERRED) && !(records[i].flags & INITCALL_PARALLEL)) {
+            initcall_exec(i);
+        }
+    }
+    deferred_put();
+}
+
+/**
+ * Thread running one INITCALL_PARALLEL stage
+ */
+static void initcall_parallel_thread(void* arg) {
+    initcall_exec((size_t) (uintptr_t) arg);
+    deferred_put();
+}
+
+/**
+ * Run the stages of a table in order
+ */
+void initcall_run(const initcall_t* calls, size_t count) {
+    if (!boot_started) {
+        has_tsc = cpuid_has_edx(CPUID_EDX_TSC);
+        boot_tsc = initcall_stamp();
+        boot_started = true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (record_count == INITCALL_MAX) {
+            calls[i].func();    /* No slot left: runs untimed, and right away */
+            continue;
+        }
+        size_t index = record_count++;
+        records[index] = (initcall_record_t) { calls[i].name, calls[i].flags, 0, false, 0, 0 };
+        record_funcs[index] = calls[i].func;
+        if (!is_deferred(calls[i].flags) || deferred_started) {
+            initcall_exec(index);
+        }
+    }
+}
+
+/**
+ * Start the threads for the deferred and parallel stages
+ */
+int initcall_start_deferred(void) {
+    if (deferred_started) {
+        return 0;
+    }
+    deferred_started = true;
+    __atomic_store_n(&deferred_left, 1, __ATOMIC_RELEASE);
+
+    int started = 0;
+    bool failed = false;
+    bool serial = false;
+    for (size_t i = 0; i < record_count; i++) {
+        if (!is_deferred(records[i].flags)) {
+            continue;
+        }
+        if (!(records[i].flags & INITCALL_PARALLEL)) {
+            serial = true;
+            continue;
+        }
+        if (!sched_active()) {
+            initcall_exec(i);
+            continue;
+        }
+        __atomic_add_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL);
+        if (thread_create(records[i].name, initcall_parallel_thread, (void*) (uintptr_t) i) == NULL) {
+            klog(KLOG_ERR, "[FAILED] initcall: No thread for %s, running it at once\n", records[i].name);
+            __atomic_sub_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL);
+            initcall_exec(i);
+            failed = true;
+            continue;
+        }
+        started++;
+    }
+    if (serial) {
+        __atomic_add_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL);
+        void* arg = (void*) (uintptr_t) record_count;
+        if (!sched_active() || thread_create("initcalls", initcall_serial_thread, arg) == NULL) {
+            if (sched_active()) {
+                klog(KLOG_ERR, "[FAILED] initcall: No thread for the deferred initcalls, running them at once\n");
+                failed = true;
+            }
+            initcall_serial_thread(arg);
+        }
+        else {
+            started++;
+        }
+    }
+    deferred_put();
+    return failed ? -1 : started;
+}
+
+/**
+ * Wait until every deferred and parallel stage has finished
+ */
+void initcall_wait_deferred(void) {
+    wait_event(&deferred_wq, __atomic_load_n(&deferred_left, __ATOMIC_ACQUIRE) == 0);
+}
+
+/**
+ * Log the boot-time breakdown of the stages that have finished
+ */
+void initcall_report(void) {
+    if (!has_tsc) {
+        klog(KLOG_INFO, "Boot time breakdown: no TSC, %u initcalls ran untimed\n", (uint32_t) record_count);
+        return;
+    }
+    klog(KLOG_INFO, "Boot time breakdown (%u us since the first initcall):\n",
+                    (uint32_t) initcall_cycles_to_us(initcall_stamp() - boot_tsc));
+    for (size_t i = 0; i < record_count; i++) {
+        report_record(&records[i]);
+    }
+}
+
+/**
+ * Number of stages recorded
+ */
+size_t initcall_count(void) {
+    return record_count;
+}
+
+/**
+ * Get the record of a stage
+ */
+int initcall_get_record(size_t index, initcall_record_t* record) {
+    if (index >= record_count) {
+        return -1;
+    }
+    *record = records[index];
+    record->done = __atomic_load_n(&records[index].done, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+/**
+ * Convert TSC cycles to microseconds
+ */
+uint64_t initcall_cycles_to_us(uint64_t cycles) {
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    return stats.tsc_hz ? cycles * 1000000ull / stats.tsc_hz : 0;
+}
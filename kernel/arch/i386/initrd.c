@@ -0,0 +1,387 @@
+/**
+ * Initial RAM Filesystem (tar and cpio archives)
+ *
+ * Mounting walks the archive once:
+ *
+ *   ustar:  [512-byte header][data, padded to 512] ... two zero blocks
+ *   newc:   ["070701" + 13 hex fields][name, padded to 4][data, padded to 4] ... "TRAILER!!!"
+ *
+ *   each entry → strip "./" and "/" → create the directories on its path
+ *              → node { inode, name, children, data → into the archive }
+ *
+ * A directory keeps its children in archive order, so readdir() lists
+ * them the way the archive did. Lookups scan the children list; the dentry
+ * cache in front of it means each name is scanned for only once.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/initrd.h>
+#include <kernel/vfs.h>
+#include <kernel/module.h>
+#include <kernel/kheap.h>
+#include <kernel/klog.h>
+
+#define TAR_BLOCK               512
+#define CPIO_HEADER_SIZE        110
+#define CPIO_MODE_TYPE          0170000
+#define CPIO_MODE_DIR           0040000
+#define CPIO_MODE_FILE          0100000
+
+typedef struct initrd_node {
+    inode_t inode;
+    char name[VFS_NAME_MAX];
+    struct initrd_node* children;       /* First child (directories) */
+    struct initrd_node* last_child;
+    struct initrd_node* next;           /* Next entry of the same directory */
+    const uint8_t* data;                /* Contents in the archive (files) */
+    uint32_t phys;                      /* Physical address of data, 0 if unknown */
+} initrd_node_t;
+
+/* State of one archive walk */
+typedef struct {
+    uint32_t next_ino;
+    uint32_t skipped;                   /* Entries not kept */
+    bool failed;                        /* Out of memory */
+} initrd_build_t;
+
+static const inode_ops_t initrd_ops;
+
+/**
+ * Parse a fixed-width number field (octal in tar, hex in cpio)
+ */
+static uint32_t parse_number(const uint8_t* field, size_t len, uint32_t base) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = field[i];
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        }
+        else if (base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            digit = (c | 0x20) - 'a' + 10;
+        }
+        else if (c == ' ' && value == 0) {
+            continue;   /* Leading padding */
+        }
+        else {
+            break;      /* NUL or space terminator */
+        }
+        if (digit >= base) {
+            break;
+        }
+        value = value * base + digit;
+    }
+    return value;
+}
+
+/**
+ * Length of a name field that is NUL-terminated only if it is shorter than max
+ */
+static size_t field_len(const uint8_t* field, size_t max) {
+    size_t len = 0;
+    while (len < max && field[len] != '\0') {
+        len++;
+    }
+    return len;
+}
+
+static inline uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+/**
+ * Allocate a node under a directory
+ */
+static initrd_node_t* node_create(initrd_build_t* build, initrd_node_t* dir, const char* name, size_t len,
+                                  uint32_t type) {
+    initrd_node_t* node = (initrd_node_t*) kcalloc(1, sizeof(initrd_node_t));
+    if (node == NULL) {
+        build->failed = true;
+        return NULL;
+    }
+    node->inode = (inode_t) { build->next_ino++, type, 0, &initrd_ops, node };
+    memcpy(node->name, name, len);
+    node->name[len] = '\0';
+    if (dir != NULL) {
+        if (dir->last_child != NULL) {
+            dir->last_child->next = node;
+        }
+        else {
+            dir->children = node;
+        }
+        dir->last_child = node;
+    }
+    return node;
+}
+
+/**
+ * Child of a directory by name
+ */
+static initrd_node_t* node_find(initrd_node_t* dir, const char* name, size_t len) {
+    for (initrd_node_t* child = dir->children; child != NULL; child = child->next) {
+        if (memcmp(child->name, name, len) == 0 && child->name[len] == '\0') {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Free a node and everything below it
+ */
+static void node_free(initrd_node_t* node) {
+    initrd_node_t* child = node->children;
+    while (child != NULL) {
+        initrd_node_t* next = child->next;
+        node_free(child);
+        child = next;
+    }
+    kfree(node);
+}
+
+/**
+ * Add an archive entry to the tree
+ *
+ * @return false if the entry was skipped
+ */
+static bool node_insert(initrd_build_t* build, initrd_node_t* root, const char* path, uint32_t type,
+                        const uint8_t* data, uint32_t size, uint32_t phys) {
+    initrd_node_t* dir = root;
+    while (*path == '/' || (path[0] == '.' && path[1] == '/')) {
+        path += *path == '/' ? 1 : 2;
+    }
+    while (*path != '\0') {
+        size_t len = 0;
+        while (path[len] != '\0' && path[len] != '/') {
+            len++;
+        }
+        const char* rest = path + len;
+        while (*rest == '/') {
+            rest++;
+        }
+        bool last = *rest == '\0';
+        if (len == 1 && path[0] == '.') {
+            path = rest;
+            continue;
+        }
+        if ((len == 2 && path[0] == '.' && path[1] == '.') || len >= VFS_NAME_MAX) {
+            return false;
+        }
+        initrd_node_t* child = node_find(dir, path, len);
+        if (!last) {
+            if (child == NULL) {
+                child = node_create(build, dir, path, len, VFS_TYPE_DIR);
+            }
+            if (child == NULL || child->inode.type != VFS_TYPE_DIR) {
+                return false;
+            }
+            dir = child;
+            path = rest;
+            continue;
+        }
+        if (child == NULL) {
+            child = node_create(build, dir, path, len, type);
+        }
+        if (child == NULL || child->inode.type != type) {
+            return false;
+        }
+        if (type == VFS_TYPE_FILE) {
+            /* A later entry for the same path replaces the earlier one, as tar extraction would */
+            child->inode.size = size;
+            child->data = data;
+            child->phys = phys;
+        }
+        return true;
+    }
+    return type == VFS_TYPE_DIR;    /* The root itself ("./") */
+}
+
+/**
+ * Walk a ustar archive
+ */
+static void load_tar(initrd_build_t* build, initrd_node_t* root, const uint8_t* base, size_t size, uint32_t phys) {
+    char path[VFS_PATH_MAX + 4];
+    size_t offset = 0;
+    while (offset + TAR_BLOCK <= size) {
+        const uint8_t* header = base + offset;
+        if (header[0] == '\0') {
+            break;      /* End-of-archive block */
+        }
+        uint32_t file_size = parse_number(header + 124, 12, 8);
+        size_t data_offset = offset + TAR_BLOCK;
+        if (file_size > size - data_offset) {
+            klog(KLOG_WARN, "initrd: Archive is truncated\n");
+            break;
+        }
+        /* Full name: prefix (155 bytes at 345), '/', name (100 bytes at 0), neither necessarily terminated */
+        size_t len = field_len(header + 345, 155);
+        memcpy(path, header + 345, len);
+        if (len > 0) {
+            path[len++] = '/';
+        }
+        size_t name_len = field_len(header, 100);
+        memcpy(path + len, header, name_len);
+        path[len + name_len] = '\0';
+
+        char flag = (char) header[156];
+        uint32_t type = (flag == '0' || flag == '\0') ? VFS_TYPE_FILE : flag == '5' ? VFS_TYPE_DIR : 0;
+        uint32_t entry_phys = phys != 0 ? phys + (uint32_t) data_offset : 0;
+        if (type == 0 || !node_insert(build, root, path, type, base + data_offset, file_size, entry_phys)) {
+            build->skipped++;
+        }
+        offset = data_offset + align_up(file_size, TAR_BLOCK);
+    }
+}
+
+/**
+ * Walk a newc cpio archive
+ */
+static void load_cpio(initrd_build_t* build, initrd_node_t* root, const uint8_t* base, size_t size, uint32_t phys) {
+    size_t offset = 0;
+    while (offset + CPIO_HEADER_SIZE <= size) {
+        const uint8_t* header = base + offset;
+        if (memcmp(header, "07070", 5) != 0 || (header[5] != '1' && header[5] != '2')) {
+            klog(KLOG_WARN, "initrd: Bad cpio header at offset %u\n", (uint32_t) offset);
+            break;
+        }
+        uint32_t mode = parse_number(header + 6 + 1 * 8, 8, 16);
+        uint32_t file_size = parse_number(header + 6 + 6 * 8, 8, 16);
+        uint32_t name_size = parse_number(header + 6 + 11 * 8, 8, 16);
+        const char* name = (const char*) header + CPIO_HEADER_SIZE;
+        if (name_size == 0 || name_size > size - offset - CPIO_HEADER_SIZE || name[name_size - 1] != '\0') {
+            klog(KLOG_WARN, "initrd: Archive is truncated\n");
+            break;
+        }
+        if (strcmp(name, "TRAILER!!!") == 0) {
+            break;
+        }
+        size_t data_offset = align_up(offset + CPIO_HEADER_SIZE + name_size, 4);
+        if (data_offset > size || file_size > size - data_offset) {
+            klog(KLOG_WARN, "initrd: Archive is truncated\n");
+            break;
+        }
+        uint32_t type = (mode & CPIO_MODE_TYPE) == CPIO_MODE_FILE ? VFS_TYPE_FILE :
+                        (mode & CPIO_MODE_TYPE) == CPIO_MODE_DIR ? VFS_TYPE_DIR : 0;
+        uint32_t entry_phys = phys != 0 ? phys + (uint32_t) data_offset : 0;
+        if (type == 0 || !node_insert(build, root, name, type, base + data_offset, file_size, entry_phys)) {
+            build->skipped++;
+        }
+        offset = align_up(data_offset + file_size, 4);
+    }
+}
+
+/**
+ * Build the inode tree of an archive
+ */
+inode_t* initrd_load(const void* data, size_t size, uint32_t phys) {
+    const uint8_t* base = (const uint8_t*) data;
+    bool is_cpio = size >= CPIO_HEADER_SIZE && memcmp(base, "07070", 5) == 0;
+    bool is_tar = size >= TAR_BLOCK && memcmp(base + 257, "ustar", 5) == 0;
+    if (!is_cpio && !is_tar) {
+        klog(KLOG_ERR, "[FAILED] initrd: Neither a ustar nor a newc cpio archive\n");
+        return NULL;
+    }
+    initrd_build_t build = { 1, 0, false };
+    initrd_node_t* root = node_create(&build, NULL, "/", 1, VFS_TYPE_DIR);
+    if (root == NULL) {
+        return NULL;
+    }
+    if (is_cpio) {
+        load_cpio(&build, root, base, size, phys);
+    }
+    else {
+        load_tar(&build, root, base, size, phys);
+    }
+    if (build.failed) {
+        klog(KLOG_ERR, "[FAILED] initrd: Out of memory building the inode tree\n");
+        node_free(root);
+        return NULL;
+    }
+    if (build.skipped > 0) {
+        klog(KLOG_WARN, "initrd: Skipped %u entries (links, devices or bad paths)\n", build.skipped);
+    }
+    return &root->inode;
+}
+
+/**
+ * Mount the first boot module named initrd* as the root
+ */
+int initrd_init(void) {
+    size_t prefix_len = strlen(INITRD_MODULE_PREFIX);
+    for (uint32_t i = 0; i < module_count(); i++) {
+        const module_t* mod = module_get(i);
+        if (memcmp(mod->name, INITRD_MODULE_PREFIX, prefix_len) != 0) {
+            continue;
+        }
+        inode_t* root = initrd_load(mod->data, mod->size, mod->phys);
+        if (root == NULL || vfs_mount_root(root) != 0) {
+            klog(KLOG_ERR, "[FAILED] initrd: Could not mount '%s'\n", mod->name);
+            return -1;
+        }
+        klog(KLOG_INFO, "[  OK  ] initrd: Mounted '%s' (%u KiB) as /\n", mod->name, (uint32_t) (mod->size / 1024));
+        return 0;
+    }
+    klog(KLOG_INFO, "initrd: No initrd module, no root filesystem\n");
+    return 0;
+}
+
+/**
+ * inode_ops_t.lookup: child of a directory by name
+ */
+static inode_t* initrd_lookup(inode_t* dir, const char* name, size_t len) {
+    initrd_node_t* child = node_find((initrd_node_t*) dir->priv, name, len);
+    return child != NULL ? &child->inode : NULL;
+}
+
+/**
+ * inode_ops_t.read: copy file bytes out of the archive
+ */
+static int32_t initrd_read(inode_t* inode, uint32_t offset, void* buf, size_t count) {
+    const initrd_node_t* node = (const initrd_node_t*) inode->priv;
+    memcpy(buf, node->data + offset, count);
+    return (int32_t) count;
+}
+
+/**
+ * inode_ops_t.readdir: name of the index-th child
+ */
+static int initrd_readdir(inode_t* dir, uint32_t index, char* name, size_t size) {
+    const initrd_node_t* child = ((const initrd_node_t*) dir->priv)->children;
+    while (child != NULL && index > 0) {
+        child = child->next;
+        index--;
+    }
+    if (child == NULL) {
+        return -1;
+    }
+    size_t len = strlen(child->name);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(name, child->name, len);
+    name[len] = '\0';
+    return 0;
+}
+
+/**
+ * inode_ops_t.memory: files are the archive's own bytes
+ */
+static const void* initrd_memory(inode_t* inode, uint32_t* phys) {
+    const initrd_node_t* node = (const initrd_node_t*) inode->priv;
+    if (node->phys == 0) {
+        return NULL;
+    }
+    *phys = node->phys;
+    return node->data;
+}
+
+static const inode_ops_t initrd_ops = {
+    .lookup = initrd_lookup,
+    .read = initrd_read,
+    .readdir = initrd_readdir,
+    .memory = initrd_memory,
+};
@@ -0,0 +1,216 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/ioring.h>
+#include <kernel/process.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/syscall.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+
+/**
+ * Batched System Calls
+ *
+ * Example: three writes with one kernel entry
+ *
+ *   user:   sqes[0..2] = WRITE ..., sq_tail = 3, ioring_enter(3, 0, 0)
+ *   kernel: sq_head 0 → 3, each SQE runs through the SYSCALL_WRITE handler,
+ *           cqes[0..2] = { user_data, bytes written }, cq_tail 0 → 3
+ *   user:   reads cqes[cq_head .. cq_tail), cq_head = 3
+ *
+ * The ring's frames are ordinary user pages of the owner and go away with its
+ * page directory. The polling thread belongs to the process too (same
+ * directory, counted in live_threads), so the directory outlives it.
+ */
+
+/**
+ * Size in bytes of a ring with 'entries' SQEs
+ */
+static inline uint32_t ioring_size(uint32_t entries) {
+    return IORING_SQ_OFFSET + entries * sizeof(ioring_sqe_t) + 2 * entries * sizeof(ioring_cqe_t);
+}
+
+/**
+ * Run one SQE through the matching system call handler
+ */
+static int32_t ioring_run(const ioring_sqe_t* sqe) {
+    switch (sqe->opcode) {
+        case IORING_OP_NOP:
+            return 0;
+        case IORING_OP_READ:
+            return (int32_t) syscall_invoke_user(SYSCALL_READ, (uint32_t) sqe->fd, sqe->addr, sqe->len);
+        case IORING_OP_WRITE:
+            return (int32_t) syscall_invoke_user(SYSCALL_WRITE, (uint32_t) sqe->fd, sqe->addr, sqe->len);
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Run up to 'max' pending SQEs, stopping early if the completion queue is full
+ *
+ * @return Number of SQEs consumed
+ */
+static uint32_t ioring_submit(ioring_t* ring, uint32_t max) {
+    ioring_shared_t* shared = ring->shared;
+    ioring_sqe_t* sqes = (ioring_sqe_t*) ((uint8_t*) shared + IORING_SQ_OFFSET);
+    ioring_cqe_t* cqes = (ioring_cqe_t*) ((uint8_t*) shared + shared->cq_offset);
+    uint32_t tail = shared->sq_tail;
+    __sync_synchronize();  /* Read the SQEs only after the tail that published them */
+    uint32_t done = 0;
+    while (ring->sq_head != tail && done < max) {
+        if (ring->cq_tail - shared->cq_head > ring->cq_mask) {
+            break;  /* No room for the result; the SQE stays queued */
+        }
+        /* Private copy, so user space can't change it between checks and use */
+        ioring_sqe_t sqe = sqes[ring->sq_head & ring->sq_mask];
+        int32_t res = ioring_run(&sqe);
+        ioring_cqe_t* cqe = &cqes[ring->cq_tail & ring->cq_mask];
+        cqe->user_data = sqe.user_data;
+        cqe->res = res;
+        __sync_synchronize();  /* The CQE is complete before the tail moves past it */
+        shared->cq_tail = ++ring->cq_tail;
+        shared->sq_head = ++ring->sq_head;
+        done++;
+    }
+    if (done > 0) {
+        wake_up(&ring->cq_wait);
+    }
+    return done;
+}
+
+/**
+ * Polling thread: run submissions as they appear, sleep after a quiet spell
+ */
+static void ioring_sqpoll(void* arg) {
+    ioring_t* ring = (ioring_t*) arg;
+    ioring_shared_t* shared = ring->shared;
+    uint64_t idle_since = ktime_ns();
+    while (!ring->stopping) {
+        if (ioring_submit(ring, UINT32_MAX) > 0) {
+            idle_since = ktime_ns();
+            continue;
+        }
+        if (ktime_ns() - idle_since < (uint64_t) IORING_SQPOLL_IDLE_MS * 1000000) {
+            thread_yield();
+            continue;
+        }
+        /* Announce the sleep, then look at the tail once more: a submitter either sees the flag or we see its SQE */
+        shared->flags |= IORING_SQ_NEED_WAKEUP;
+        __sync_synchronize();
+        wait_event(&ring->sq_wait, ring->stopping || shared->sq_tail != ring->sq_head);
+        shared->flags &= ~IORING_SQ_NEED_WAKEUP;
+        idle_since = ktime_ns();
+    }
+}
+
+/**
+ * Create the calling process's ring
+ */
+int32_t ioring_setup(uint32_t entries, uint32_t flags) {
+    process_t* proc = process_current();
+    if (proc == NULL || proc->ioring != NULL) {
+        klog(KLOG_ERR, "[FAILED] ioring_setup: %s\n",
+             proc ? "Process already has a ring" : "Not called from a process");
+        return -1;
+    }
+    if (entries == 0 || entries > IORING_MAX_ENTRIES || (flags & ~IORING_SETUP_SQPOLL) != 0) {
+        klog(KLOG_ERR, "[FAILED] ioring_setup: Invalid ring (%u entries, flags 0x%x)\n", entries, flags);
+        return -1;
+    }
+    uint32_t sq_entries = 1;
+    while (sq_entries < entries) {
+        sq_entries <<= 1;
+    }
+    uint32_t size = ioring_size(sq_entries);
+    ioring_t* ring = (ioring_t*) kcalloc(1, sizeof(ioring_t));
+    if (ring == NULL) {
+        klog(KLOG_ERR, "[FAILED] ioring_setup: Out of memory\n");
+        return -1;
+    }
+
+    /* Fresh zeroed user pages; mapped ones can stay if this fails, they go with the directory */
+    for (uint32_t off = 0; off < size; off += PAGE_SIZE) {
+        uint32_t frame = frame_alloc();
+        if (frame == 0 || paging_map(USER_RING_BASE + off, frame, PTE_WRITABLE | PTE_USER) != 0) {
+            if (frame != 0) {
+                frame_free(frame);
+            }
+            klog(KLOG_ERR, "[FAILED] ioring_setup: Out of memory mapping the ring\n");
+            kfree(ring);
+            return -1;
+        }
+        memset((void*) (USER_RING_BASE + off), 0, PAGE_SIZE);
+    }
+    ioring_shared_t* shared = (ioring_shared_t*) USER_RING_BASE;
+    shared->sq_entries = sq_entries;
+    shared->cq_entries = 2 * sq_entries;
+    shared->sq_offset = IORING_SQ_OFFSET;
+    shared->cq_offset = IORING_SQ_OFFSET + sq_entries * sizeof(ioring_sqe_t);
+    ring->shared = shared;
+    ring->sq_mask = sq_entries - 1;
+    ring->cq_mask = 2 * sq_entries - 1;
+    wait_queue_init(&ring->sq_wait);
+    wait_queue_init(&ring->cq_wait);
+
+    if (flags & IORING_SETUP_SQPOLL) {
+        /* Runs in our address space as one of our threads, so it is set up before it can run */
+        thread_t* thread = thread_prepare("ioring-sq", ioring_sqpoll, ring);
+        if (thread == NULL) {
+            kfree(ring);
+            return -1;
+        }
+        thread->process = proc;
+        thread->cr3 = proc->page_directory;
+        thread_set_priority(thread, thread_current()->base_priority);
+        spin_lock(&proc->lock);
+        proc->live_threads++;
+        spin_unlock(&proc->lock);
+        ring->sq_thread = thread;
+        proc->ioring = ring;
+        thread_launch(thread);
+    }
+    else {
+        proc->ioring = ring;
+    }
+    return (int32_t) USER_RING_BASE;
+}
+
+/**
+ * Run submissions and optionally wait for completions
+ */
+int32_t ioring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    process_t* proc = process_current();
+    ioring_t* ring = proc ? proc->ioring : NULL;
+    if (ring == NULL) {
+        return -1;
+    }
+    if (ring->sq_thread != NULL) {
+        /* The polling thread does the work; we only wake it and wait for results */
+        if (flags & IORING_ENTER_SQ_WAKEUP) {
+            wake_up(&ring->sq_wait);
+        }
+        if ((flags & IORING_ENTER_GETEVENTS) && min_complete > 0) {
+            ioring_shared_t* shared = ring->shared;
+            wait_event(&ring->cq_wait, ring->cq_tail - shared->cq_head >= min_complete || ring->stopping);
+        }
+        return 0;
+    }
+    /* Everything completes inline, so there is nothing left to wait for afterwards */
+    return (int32_t) ioring_submit(ring, to_submit);
+}
+
+/**
+ * Tell a process's polling thread to finish
+ */
+void ioring_stop(process_t* proc) {
+    ioring_t* ring = proc->ioring;
+    if (ring != NULL && ring->sq_thread != NULL) {
+        ring->stopping = 1;
+        wake_up(&ring->sq_wait);
+    }
+}
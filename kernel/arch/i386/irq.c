@@ -1,12 +1,77 @@
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/thread.h>
+#include <kernel/profile.h>
+#include <kernel/trace.h>
+#include <kernel/irqstat.h>
+#include <kernel/softirq.h>
+#include <kernel/spinlock.h>
+#include <kernel/rcu.h>
+#include <kernel/timer.h>
+#include <kernel/shell.h>
+#include <kernel/paging.h>
 
 #include "include/irq.h"
 #include "include/interrupts.h"
 #include "include/pic.h"
+#include "include/apic.h"
+#include "include/irqflags.h"
+#include "include/cpuid.h"
+#include "include/tsc.h"
+
+/* Simple fixed-size table for legacy PIC (16 lines); read under RCU, written under irq_table_lock */
+static irq_handler_fn irq_handlers[IRQ_LINES] = {0};
+static spinlock_t irq_table_lock = SPINLOCK_INIT;
+
+/* Written by irq_handler() with interrupts off; readers on other CPUs take irq_stats_lock for the 64-bit counters */
+static irq_stats_t irq_stats[IRQ_LINES];
+static spinlock_t irq_stats_lock = SPINLOCK_INIT;
+
+/* 1 if handlers are timed with rdtsc, -1 until the first IRQ checks CPUID */
+static int irq_tsc = -1;
+
+/* Lines are masked and acknowledged at the IOAPIC / LAPIC instead of the 8259s */
+static bool irq_apic = false;
 
-/* Simple fixed-size table for legacy PIC (16 lines) */
-static irq_handler_fn irq_handlers[16] = {0};
+/**
+ * Acknowledge an IRQ at the controller that delivered it
+ */
+static inline void irq_eoi(int irq) {
+	if (irq_apic) {
+		lapic_eoi();
+	}
+	else {
+		pic_send_eoi((uint8_t)irq);
+	}
+}
+
+/**
+ * Check whether an IRQ 7 / IRQ 15 is spurious
+ *
+ * The PIC sets the line's In-Service bit when it delivers a real interrupt.
+ * A spurious one must not get an EOI from the PIC that raised it; for IRQ 15
+ * the master still saw a real interrupt on the cascade line and needs one.
+ *
+ * @return true if the interrupt was spurious (and is fully handled)
+ */
+static bool irq_spurious(int irq) {
+	/* Through the IOAPIC, vectors 39 and 47 are real IRQs; the LAPIC has its own spurious vector */
+	if (irq_apic || (irq != 7 && irq != 15)) {
+		return false;
+	}
+	if (pic_get_isr() & (1u << irq)) {
+		return false;
+	}
+	irq_stats[irq].spurious++;
+	if (irq == 15) {
+		pic_send_eoi(2);  /* Master only: the cascade line */
+	}
+	return true;
+}
 
 /**
  * Low-level IRQ entry point called from assembly stubs.
@@ -14,16 +79,71 @@ static irq_handler_fn irq_handlers[16] = {0};
  * @param r Saved CPU register state captured on interrupt entry.
  *          The field r->int_no contains the vector number; hardware IRQs are mapped to 32..47 after PIC remap.
  *
- * Dispatches to any registered handler for the IRQ and sends EOI to the PIC.
+ * Dispatches to any registered handler for the IRQ and sends EOI to the PIC (or the LAPIC, see kernel/apic.h). IRQ 0 (timer) also charges a tick to
+ * the running thread and feeds the sampling profiler. Once the PIC has its EOI, the running thread is switched out if its time slice ran out or a
+ * thread woken by the handler should run instead of idle. Spurious IRQ 7 / 15 are counted and dropped. Every other
+ * interrupt is counted and, with a TSC, timed up to the EOI (kernel/irqstat.h). Tasklets that handlers queued run
+ * after the EOI (kernel/softirq.h). Inter-processor interrupts (vectors in apic.h) are served and acknowledged
+ * at the LAPIC; they aren't IRQ lines and aren't counted. The same goes for an application processor's LAPIC timer
+ * tick, which only charges the tick to the thread running there.
  */
 void irq_handler(regs_t* r) {
 	uint32_t int_no = r->int_no;
 	if (int_no >= 32 && int_no < 48) {
 		int irq = (int)(int_no - 32);
-		if (irq_handlers[irq]) {
-			irq_handlers[irq](r);
+		if (irq_spurious(irq)) {
+			return;
 		}
-		pic_send_eoi((uint8_t)irq);
+		if (irq != 0) {
+			/* The tick may be stopped: the handler should see the current time */
+			timer_irq_enter();
+		}
+		if (irq_tsc < 0) {
+			irq_tsc = cpuid_has_edx(CPUID_EDX_TSC) ? 1 : 0;
+		}
+		uint64_t start = irq_tsc ? rdtsc() : 0;
+		TRACE(IRQ, irq, r->eip);
+		/* unregister_irq() waits for this section to end before the handler's code or data may go away */
+		rcu_read_lock();
+		irq_handler_fn handler = rcu_dereference(irq_handlers[irq]);
+		if (handler) {
+			handler(r);
+		}
+		rcu_read_unlock();
+		if (irq == 0) {
+			profile_tick(r);
+			sched_tick();
+		}
+		uint64_t cycles = irq_tsc ? rdtsc() - start : 0;
+		irq_stats_t* stats = &irq_stats[irq];
+		spin_lock(&irq_stats_lock);
+		stats->count++;
+		if (irq_tsc) {
+			stats->total_cycles += cycles;
+			if (cycles > stats->max_cycles) {
+				stats->max_cycles = cycles > UINT32_MAX ? UINT32_MAX : (uint32_t) cycles;
+			}
+		}
+		spin_unlock(&irq_stats_lock);
+		irq_eoi(irq);
+		/* Bottom halves run with the line acknowledged and interrupts on */
+		softirq_irq_exit();
+		/* Switch after the EOI: the next thread may run for a whole slice */
+		sched_preempt();
+	}
+	else if (int_no == LAPIC_TICK_VECTOR) {
+		sched_tick();
+		lapic_eoi();
+		sched_preempt();
+	}
+	else if (int_no == IPI_RESCHED_VECTOR) {
+		/* check_preempt() already set need_resched; the IPI only gets us here */
+		lapic_eoi();
+		sched_preempt();
+	}
+	else if (int_no == IPI_TLB_VECTOR) {
+		tlb_shootdown_poll();
+		lapic_eoi();
 	}
 }
 
@@ -35,11 +155,18 @@ void irq_handler(regs_t* r) {
  * @return 0 on success, -1 if the IRQ is out of range
  */
 int reqister_irq(int irq, irq_handler_fn handler) {
-	if (irq < 0 || irq >= 16) {
+	if (irq < 0 || irq >= IRQ_LINES) {
 		return -1;
 	}
-	irq_handlers[irq] = handler;
-	pic_unmask((uint8_t)irq);
+	uint32_t flags = spin_lock_irqsave(&irq_table_lock);
+	rcu_assign_pointer(irq_handlers[irq], handler);
+	if (irq_apic) {
+		ioapic_unmask_irq((uint8_t)irq);
+	}
+	else {
+		pic_unmask((uint8_t)irq);
+	}
+	spin_unlock_irqrestore(&irq_table_lock, flags);
 	return 0;
 }
 
@@ -49,14 +176,118 @@ int reqister_irq(int irq, irq_handler_fn handler) {
  * This function removes the registered handler for the specified IRQ and masks (disables)
  * the interrupt at the PIC level, preventing further interrupts from this line.
  *
+ * Returns only after any CPU running the old handler has left it, so the
+ * caller may free what the handler uses. Call from thread context.
+ *
  * @param irq Hardware IRQ line number (0..15 on legacy PIC)
  * @return 0 on success, -1 if the IRQ is out of range
  */
 int unregister_irq(int irq) {
-	if (irq < 0 || irq >= 16) {
+	if (irq < 0 || irq >= IRQ_LINES) {
 		return -1;
 	}
-	pic_mask((uint8_t)irq);   /* Mask the IRQ first to prevent spurious interrupts */
-	irq_handlers[irq] = NULL; /* Then remove the handler */
+	uint32_t flags = spin_lock_irqsave(&irq_table_lock);
+	/* Mask the IRQ first to prevent spurious interrupts */
+	if (irq_apic) {
+		ioapic_mask_irq((uint8_t)irq);
+	}
+	else {
+		pic_mask((uint8_t)irq);
+	}
+	rcu_assign_pointer(irq_handlers[irq], NULL); /* Then remove the handler */
+	spin_unlock_irqrestore(&irq_table_lock, flags);
+	/* A CPU may still be running the old handler; once this returns, none is */
+	synchronize_rcu();
 	return 0;
 }
+
+/**
+ * Move interrupt delivery from the 8259s to the IOAPIC (called by apic_init()).
+ *
+ * Masks both PICs and unmasks the lines that already have handlers at the IOAPIC. Interrupts must be disabled.
+ */
+void irq_use_apic(void) {
+	pic_disable();
+	irq_apic = true;
+	for (int irq = 0; irq < IRQ_LINES; irq++) {
+		if (irq_handlers[irq]) {
+			ioapic_unmask_irq((uint8_t)irq);
+		}
+	}
+}
+
+/**
+ * Copy the statistics of one IRQ line.
+ *
+ * @param irq IRQ line number (0..15)
+ * @param out Destination
+ * @return 0 on success, -1 if the IRQ is out of range
+ */
+int irq_get_stats(int irq, irq_stats_t* out) {
+	if (irq < 0 || irq >= IRQ_LINES) {
+		return -1;
+	}
+	uint32_t flags = spin_lock_irqsave(&irq_stats_lock);  /* The 64-bit counters are not updated atomically */
+	*out = irq_stats[irq];
+	spin_unlock_irqrestore(&irq_stats_lock, flags);
+	return 0;
+}
+
+/**
+ * Clear the statistics of all lines.
+ */
+void irq_reset_stats(void) {
+	uint32_t flags = spin_lock_irqsave(&irq_stats_lock);
+	for (int irq = 0; irq < IRQ_LINES; irq++) {
+		irq_stats[irq] = (irq_stats_t) {0};
+	}
+	spin_unlock_irqrestore(&irq_stats_lock, flags);
+}
+
+/**
+ * Print a table of the lines that saw interrupts.
+ *
+ * Cycle columns are empty without a TSC.
+ */
+void irq_print_stats(void) {
+	printf("IRQ  count  spurious  avg cycles  max cycles\n");
+	for (int irq = 0; irq < IRQ_LINES; irq++) {
+		irq_stats_t stats;
+		irq_get_stats(irq, &stats);
+		if (stats.count == 0 && stats.spurious == 0) {
+			continue;
+		}
+		/* printf has no 64-bit conversions; counts are shown modulo 2^32 */
+		uint32_t avg = stats.count ? (uint32_t) (stats.total_cycles / stats.count) : 0;
+		if (irq_tsc > 0) {
+			printf("%d  %u  %u  %u  %u\n", irq, (uint32_t) stats.count, (uint32_t) stats.spurious, avg,
+			       stats.max_cycles);
+		}
+		else {
+			printf("%d  %u  %u\n", irq, (uint32_t) stats.count, (uint32_t) stats.spurious);
+		}
+	}
+}
+
+/**
+ * Shell command: irqstat
+ *
+ * Shows interrupt counts, spurious interrupts and handler cycles per IRQ line:
+ *   irqstat		 print the table
+ *   irqstat reset   clear the counters
+ *
+ * @param args Command arguments
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(irqstat, "interrupt counts per IRQ line [reset]") {
+	if (args[1] == NULL) {
+		irq_print_stats();
+	}
+	else if (strcmp(args[1], "reset") == 0) {
+		irq_reset_stats();
+	}
+	else {
+		printf("usage: irqstat [reset]\n");
+	}
+	return 1;
+}
@@ -2,6 +2,11 @@
 #include <assert.h>
 #include <string.h>
 
+#include <kernel/process.h>
+#include <kernel/thread.h>
+#include <kernel/klog.h>
+#include <kernel/crashdump.h>
+
 #include "include/interrupts.h"
 
 /*
@@ -88,8 +93,15 @@ void isr_handler(regs_t* r) {
 	if (isr_handlers[r->int_no] != NULL) {
 		isr_handlers[r->int_no](r);
 	}
+	else if ((r->cs & 0x3) == 3 && process_current() != NULL) {
+		/* A faulting process dies instead of taking the kernel down */
+		klog(KLOG_ERR, "[FAILED] Process %u (%s): Exception %u (%s) at EIP %p, killed\n", process_current()->pid,
+		       thread_current()->name, r->int_no, exception_messages[r->int_no], r->eip);
+		process_exit(-1);
+	}
 	else {
 		const char* reason = (r->int_no < 32) ? exception_messages[r->int_no] : "Unknown";
+		crashdump_write(r, reason);
 		panic("Exception %u: %s\n", r->int_no, reason);
 	}
 }
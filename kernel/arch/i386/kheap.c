@@ -6,24 +6,60 @@
 
 #include <kernel/kheap.h>
 #include <kernel/paging.h>
+#include <kernel/thread.h>
+#include <kernel/trace.h>
+#include <kernel/spinlock.h>
+#include <kernel/smp.h>
+#include <kernel/klog.h>
+
+#include "include/percpu.h"
 
 /**
  * Simple Bitmap-Based Heap Allocator
  * Based on: https://wiki.osdev.org/User:Pancakes/BitmapHeapImplementation
+ *
+ * Small requests (<= SLAB_MAX_SIZE) are served by power-of-two size-class
+ * slabs carved out of single bitmap blocks; larger requests use the block
+ * allocator directly.
+ * Based on: https://www.kernel.org/doc/gorman/html/understand/understand011.html
+ *
+ * The heap lives in its own virtual range (KHEAP_VIRT_START) and is backed by
+ * frame_alloc() + paging_map(). Only the first heap_blocks blocks are mapped:
+ * when no free run is found the heap grows, and fully free trailing blocks
+ * go back to the frame allocator.
+ *
+ *   KHEAP_VIRT_START                    heap end                 HEAP_META_START
+ *   ┌──────────────────────────────────┬────────────── ─ ─ ─ ──┬─────────────────┐
+ *   │ mapped blocks (heap_blocks)      │ unmapped (room to grow) │ slab descriptors│
+ *   └──────────────────────────────────┴────────────── ─ ─ ─ ──┴─────────────────┘
+ *
+ * kmalloc() and kfree() of slab sizes first go through per-CPU magazines
+ * (see "Magazine layer" below), so most pairs never take the heap lock.
+ * Based on: Bonwick & Adams, "Magazines and Vmem" (USENIX 2001)
  */
 
 #define HEAP_BLOCK_SIZE     4096                     /* 4 KB blocks */
-#define HEAP_BLOCKS_MAX     2048                     /* 8 MB total heap (2048 * 4KB) */
-#define BITMAP_SIZE         (HEAP_BLOCKS_MAX / 8)    /* 256 bytes for bitmap */
-
-/* External from debug.c - marks where kernel sections end */
-extern uint32_t elf_sections_end;
+#define HEAP_BLOCKS_MAX     65536                    /* 256 MB maximum heap (65536 * 4KB) */
+#define BITMAP_WORDS        (HEAP_BLOCKS_MAX / 32)   /* 2048 words (8 KB) for bitmap */
+#define HEAP_INITIAL_BLOCKS 256                      /* 1 MB mapped at boot */
+#define HEAP_GROW_BLOCKS    64                       /* Grow by at least 256 KB at a time */
+#define HEAP_SHRINK_BLOCKS  128                      /* Trim once 512 KB at the end are free */
+#define HEAP_META_START     (KHEAP_VIRT_START + HEAP_BLOCKS_MAX * HEAP_BLOCK_SIZE)
 
-/* Start of the heap */
+/* Current end of the heap (first unmapped address) */
 uint32_t kheap_curr = 0;
 
-/* Bitmap: 1 bit per block (0=free, 1=used) */
-static uint8_t heap_bitmap[BITMAP_SIZE];
+/* Number of blocks currently mapped */
+static uint32_t heap_blocks = 0;
+
+/* End of the mapped part of the slab descriptor table */
+static uint32_t meta_mapped_end = 0;
+
+/* Bitmap: 1 bit per block (0=free, 1=used), scanned a word at a time */
+static uint32_t heap_bitmap[BITMAP_WORDS];
+
+/* Rotating next-fit hint: block index where the next search starts */
+static uint32_t heap_hint = 0;
 
 /* Heap start address */
 static uint32_t heap_start = 0;
@@ -31,105 +67,560 @@ static uint32_t heap_start = 0;
 /* Number of blocks allocated */
 static uint32_t blocks_used = 0;
 
+#define SLAB_MIN_SHIFT      4                        /* Smallest class: 16 bytes */
+#define SLAB_MAX_SHIFT      11                       /* Largest class: 2 KiB */
+#define SLAB_MIN_SIZE       (1 << SLAB_MIN_SHIFT)
+#define SLAB_MAX_SIZE       (1 << SLAB_MAX_SHIFT)
+#define SLAB_NUM_CLASSES    (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+
+#if SLAB_NUM_CLASSES != KHEAP_SLAB_CLASSES
+#error "KHEAP_SLAB_CLASSES in kheap.h must match the slab size classes"
+#endif
+
+/* Free object inside a slab: the first word links to the next free object */
+typedef struct slab_object {
+    struct slab_object* next;
+} slab_object_t;
+
+struct slab_cache;
+
+/**
+ * Slab descriptor (one per heap block)
+ *
+ * Kept out-of-line so the whole 4 KiB block is available for objects: a
+ * 2 KiB class still fits two objects per block. A block is a slab page
+ * when its descriptor has a non-NULL cache.
+ */
+typedef struct slab {
+    slab_object_t* free_list;   /* Free objects in this slab */
+    struct slab* next;          /* Next slab in the cache's partial list */
+    struct slab* prev;          /* Previous slab in the cache's partial list */
+    struct slab_cache* cache;   /* Owning size class (NULL = not a slab) */
+    uint16_t in_use;            /* Objects currently allocated */
+    uint8_t on_partial;         /* Linked into cache->partial? */
+    uint8_t zeroed;             /* Free block known to be all zero (fresh from heap_grow) */
+    uint32_t run_blocks;        /* Headerless (aligned) allocation starting here: its block count */
+} slab_t;
+
+/**
+ * Size class cache
+ *
+ * partial holds every slab of this class with at least one free object, so
+ * both allocation and free are O(1).
+ */
+typedef struct slab_cache {
+    uint32_t obj_size;          /* Object size in bytes (power of two) */
+    uint32_t objs_per_slab;     /* HEAP_BLOCK_SIZE / obj_size */
+    slab_t* partial;            /* Slabs with free objects */
+    uint32_t slabs;             /* Blocks owned by this class */
+    uint32_t objs_in_use;       /* Live objects across all slabs */
+} slab_cache_t;
+
+static slab_cache_t slab_caches[SLAB_NUM_CLASSES];
+
+#define MAG_ROUNDS          14                       /* Objects per magazine: the magazine is 64 bytes */
+#define MAG_DEPOT_MAX_FULL  4                        /* Full magazines a depot keeps per class; more go back to the slabs */
+
+/* Stack of free objects of one size class */
+typedef struct magazine {
+    struct magazine* next;      /* Next magazine in a depot list */
+    uint32_t rounds;            /* Objects in objs[] */
+    void* objs[MAG_ROUNDS];
+} magazine_t;
+
+/* One CPU's magazines for one class; 'previous' is always full, empty or NULL */
+typedef struct {
+    magazine_t* loaded;
+    magazine_t* previous;
+} mag_cpu_t;
+
+/* A CPU's magazines, touched only by that CPU with preemption disabled */
+typedef struct {
+    mag_cpu_t classes[SLAB_NUM_CLASSES];
+    uint32_t alloc_hits;        /* Allocations served from the CPU's own magazines */
+    uint32_t allocs;            /* All slab-sized kmalloc() calls */
+    uint32_t free_hits;         /* Frees taken by the CPU's own magazines */
+    uint32_t frees;             /* All slab kfree() calls */
+} mag_percpu_t;
+
+/* Shared pool of magazines per class */
+typedef struct {
+    spinlock_t lock;
+    magazine_t* full;
+    magazine_t* empty;
+    uint32_t full_count;
+    uint32_t exchanges;         /* Magazines handed out or taken in */
+} mag_depot_t;
+
+static mag_percpu_t mag_cpus[SMP_MAX_CPUS];
+static mag_depot_t mag_depots[SLAB_NUM_CLASSES];
+
+/* Descriptors for every heap block, mapped alongside the blocks they describe */
+static slab_t* const slab_table = (slab_t*) HEAP_META_START;
+
 /**
  * Check if a block is allocated
  */
 static inline bool is_block_used(uint32_t block_idx) {
-    uint32_t byte_idx = block_idx / 8;
-    uint32_t bit_idx = block_idx % 8;
-    return (heap_bitmap[byte_idx] & (1 << bit_idx)) != 0;
+    uint32_t word_idx = block_idx / 32;
+    uint32_t bit_idx = block_idx % 32;
+    return (heap_bitmap[word_idx] & (1u << bit_idx)) != 0;
 }
 
 /**
  * Mark a block as used
  */
 static inline void mark_block_used(uint32_t block_idx) {
-    uint32_t byte_idx = block_idx / 8;
-    uint32_t bit_idx = block_idx % 8;
-    heap_bitmap[byte_idx] |= (1 << bit_idx);
+    uint32_t word_idx = block_idx / 32;
+    uint32_t bit_idx = block_idx % 32;
+    heap_bitmap[word_idx] |= (1u << bit_idx);
 }
 
 /**
  * Mark a block as free
  */
 static inline void mark_block_free(uint32_t block_idx) {
-    uint32_t byte_idx = block_idx / 8;
-    uint32_t bit_idx = block_idx % 8;
-    heap_bitmap[byte_idx] &= ~(1 << bit_idx);
+    uint32_t word_idx = block_idx / 32;
+    uint32_t bit_idx = block_idx % 32;
+    heap_bitmap[word_idx] &= ~(1u << bit_idx);
+}
+
+/**
+ * Find the first block in [from, end) whose bit equals 'used'
+ *
+ * Works a word at a time: words with no matching bit (all used when looking
+ * for a free block, all free when looking for a used one) are skipped with a
+ * single compare, and __builtin_ctz picks the first matching bit in a word.
+ *
+ * @return Block index, or 'end' if there is none
+ */
+static uint32_t find_next_block(uint32_t from, uint32_t end, bool used) {
+    if (from >= end) {
+        return end;
+    }
+    uint32_t word_idx = from / 32;
+    /* Flip the word when looking for free blocks, so set bits are always matches.
+     * Bits below 'from' in the first word are masked out. */
+    uint32_t word = (used ? heap_bitmap[word_idx] : ~heap_bitmap[word_idx]) & (~0u << (from % 32));
+    while (word == 0) {
+        word_idx++;
+        if (word_idx * 32 >= end) {
+            return end;
+        }
+        word = used ? heap_bitmap[word_idx] : ~heap_bitmap[word_idx];
+    }
+    uint32_t block_idx = word_idx * 32 + __builtin_ctz(word);
+    return block_idx < end ? block_idx : end;
 }
 
 /**
- * Find N contiguous free blocks (First-Fit with Skip-Ahead)
+ * Find N contiguous free blocks starting in [from, end)
  *
- * Algorithm:
- *   1. Start at block i
- *   2. Check blocks i, i + 1, i + 2, ... i + (count - 1) for contiguous free space
- *   3. If block at i + j is used, skip ahead to i + j + 1 (optimization)
- *   4. Return starting index if found, -1 otherwise
+ * Jumps from the start of one free run to the next: the first free block is
+ * found, then the first used block after it; if the run in between is too
+ * short, the search continues after that used block.
  *
  * Example: Need 3 contiguous blocks
  *   Bitmap: [F F U F F F U ...]  (F=free, U=used)
  *   Index:   0 1 2 3 4 5 6
  *
- *   i=0: Check [0,1,2] → Block 2 used (j=2) → Skip to i=2
- *   i=2: Start at used block → Skip immediately
- *   i=3: Check [3,4,5] → All free! Return 3
+ *   Free at 0, used at 2 → run of 2, too short → continue at 2
+ *   Free at 3, no used block before 3 + 3 → Return 3
+ *
+ * @return Starting block index, or -1 if not found
+ */
+static int32_t find_free_run(uint32_t from, uint32_t end, uint32_t count) {
+    uint32_t i = from;
+    while (i < end) {
+        i = find_next_block(i, end, false);
+        if (i >= end || i + count > heap_blocks) {
+            return -1;
+        }
+        uint32_t run_end = find_next_block(i, i + count, true);
+        if (run_end == i + count) {
+            return i;
+        }
+        i = run_end;
+    }
+    return -1;
+}
+
+/**
+ * Find N contiguous free blocks (Next-Fit with a rotating hint)
+ *
+ * The search starts at heap_hint (just past the previous allocation) and wraps
+ * around to the start of the heap, so the cost depends on how fragmented
+ * the heap is rather than on how many blocks are already handed out.
  *
  * @param count Number of contiguous blocks needed
  * @return Starting block index, or -1 if not found
  */
 static int32_t find_free_blocks(uint32_t count) {
-    for (uint32_t i = 0; i < HEAP_BLOCKS_MAX; i++) {
-        /* Assume we'll find enough contiguous blocks starting here */
-        bool all_free = true;
-        /* Check 'count' blocks starting from position i */
-        for (uint32_t j = 0; j < count && (i + j) < HEAP_BLOCKS_MAX; j++) {
-            if (is_block_used(i + j)) {
-                /* Found a used block at position i + j
-                 *
-                 * Skip-ahead optimization: Since blocks i, i + 1, ... i + j - 1 are free
-                 * but i + j is used, we know none of those can be valid starting points.
-                 * Jump directly to i + j (the outer loop will increment to i + j + 1).
-                 *
-                 * Example: i = 0, found used block at j = 2
-                 *   [F F U ...] → Skip i = 0,1,2 directly to i = 2
-                 *         ^
-                 *       i + j = 2
-                 */
-                all_free = false;
-                i += j;  /* Skip ahead */
-                break;
+    if (heap_hint >= heap_blocks) {
+        heap_hint = 0;
+    }
+    int32_t start = find_free_run(heap_hint, heap_blocks, count);
+    if (start < 0 && heap_hint > 0) {
+        /* Wrap around: runs starting before the hint may extend up to hint + count - 1 */
+        uint32_t end = heap_hint + count - 1;
+        start = find_free_run(0, end < heap_blocks ? end : heap_blocks, count);
+    }
+    return start;
+}
+
+/**
+ * Get the address of a heap block
+ */
+static inline uint32_t block_address(uint32_t block_idx) {
+    return heap_start + (block_idx * HEAP_BLOCK_SIZE);
+}
+
+/**
+ * Count the free blocks at the end of the mapped heap
+ */
+static uint32_t trailing_free_blocks(void) {
+    uint32_t count = 0;
+    while (count < heap_blocks && !is_block_used(heap_blocks - count - 1)) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Unmap the blocks from [keep] to the end of the heap and give their frames back
+ *
+ * One paging_unmap_range(): the other CPUs flush their TLBs once per batch,
+ * not once per block.
+ */
+static void heap_release_blocks(uint32_t keep) {
+    paging_unmap_range(block_address(keep), (heap_blocks - keep) * HEAP_BLOCK_SIZE, frame_free);
+    heap_blocks = keep;
+}
+
+/**
+ * Map more blocks at the end of the heap
+ *
+ * Each new block gets its own frame; the slab descriptor table is extended
+ * (zero-filled) to cover the new blocks. New blocks come from
+ * frame_alloc_zeroed() and are flagged, so kcalloc() doesn't clear them. On failure everything
+ * mapped here is undone.
+ *
+ * @param count Number of blocks to add
+ * @return 0 on success, -1 if out of virtual space or frames
+ */
+static int heap_grow(uint32_t count) {
+    if (count > HEAP_BLOCKS_MAX - heap_blocks) {
+        return -1;
+    }
+    uint32_t new_blocks = heap_blocks + count;
+    uint32_t meta_end = HEAP_META_START + new_blocks * sizeof(slab_t);
+    while (meta_mapped_end < meta_end) {
+        uint32_t frame = frame_alloc_zeroed();
+        if (frame == 0 || paging_map(meta_mapped_end, frame, PTE_WRITABLE) != 0) {
+            if (frame != 0) {
+                frame_free(frame);
             }
+            return -1;
         }
-        /* Check if we found enough contiguous blocks and they fit within bounds */
-        if (all_free && (i + count) <= HEAP_BLOCKS_MAX) {
-            return i;  /* Success: found starting block index */
+        meta_mapped_end += PAGE_SIZE;
+    }
+    uint32_t old_blocks = heap_blocks;
+    while (heap_blocks < new_blocks) {
+        uint32_t frame = frame_alloc_zeroed();
+        if (frame == 0 || paging_map(block_address(heap_blocks), frame, PTE_WRITABLE) != 0) {
+            if (frame != 0) {
+                frame_free(frame);
+            }
+            heap_release_blocks(old_blocks);
+            return -1;
         }
+        slab_table[heap_blocks].zeroed = 1;
+        heap_blocks++;
+    }
+    kheap_curr = KHEAP_VIRT_START + heap_blocks * HEAP_BLOCK_SIZE;
+    return 0;
+}
+
+/**
+ * Return fully free trailing blocks to the frame allocator
+ *
+ * Only trims once HEAP_SHRINK_BLOCKS are free at the end, so a burst of
+ * alloc/free right at the boundary doesn't map and unmap on every call.
+ */
+static void heap_shrink(void) {
+    uint32_t trailing = trailing_free_blocks();
+    if (trailing < HEAP_SHRINK_BLOCKS || heap_blocks <= HEAP_INITIAL_BLOCKS) {
+        return;
+    }
+    uint32_t keep = heap_blocks - trailing;
+    if (keep < HEAP_INITIAL_BLOCKS) {
+        keep = HEAP_INITIAL_BLOCKS;
+    }
+    heap_release_blocks(keep);
+    kheap_curr = KHEAP_VIRT_START + heap_blocks * HEAP_BLOCK_SIZE;
+}
+
+/**
+ * Extend the heap so that 'needed' more blocks are free at its end
+ *
+ * Grows by at least HEAP_GROW_BLOCKS (clamped to the heap limit).
+ *
+ * @return 0 on success, -1 if out of virtual space or frames
+ */
+static int heap_grow_tail(uint32_t needed) {
+    if (needed > HEAP_BLOCKS_MAX - heap_blocks) {
+        return -1;
+    }
+    uint32_t grow = needed < HEAP_GROW_BLOCKS ? HEAP_GROW_BLOCKS : needed;
+    if (grow > HEAP_BLOCKS_MAX - heap_blocks) {
+        grow = HEAP_BLOCKS_MAX - heap_blocks;
+    }
+    return heap_grow(grow);
+}
+
+/**
+ * Mark free blocks as used, clearing them if asked to
+ *
+ * @param zero Clear the blocks (skipped for blocks still zero since heap_grow)
+ */
+static void claim_blocks(uint32_t start_block, uint32_t count, bool zero) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t block_idx = start_block + i;
+        mark_block_used(block_idx);
+        if (zero && !slab_table[block_idx].zeroed) {
+            memset((void*) block_address(block_idx), 0, HEAP_BLOCK_SIZE);
+        }
+        /* The owner will write to it from now on */
+        slab_table[block_idx].zeroed = 0;
+    }
+    blocks_used += count;
+}
+
+/**
+ * Allocate N contiguous blocks and account for them in the bitmap
+ *
+ * Grows the heap when no free run is big enough.
+ *
+ * @param count Number of blocks
+ * @param zero Clear the blocks (skipped for blocks still zero since heap_grow)
+ * @return Starting block index, or -1 if not found
+ */
+static int32_t alloc_blocks(uint32_t count, bool zero) {
+    int32_t start_block = find_free_blocks(count);
+    if (start_block < 0) {
+        /* Grow so a run fits at the end, reusing the free blocks already there */
+        uint32_t trailing = trailing_free_blocks();
+        if (heap_grow_tail(count > trailing ? count - trailing : 0) != 0) {
+            return -1;
+        }
+        start_block = find_free_blocks(count);
+        if (start_block < 0) {
+            return -1;
+        }
+    }
+    claim_blocks(start_block, count, zero);
+    heap_hint = start_block + count;
+    return start_block;
+}
+
+/**
+ * Return N contiguous blocks to the bitmap
+ */
+static void release_blocks(uint32_t start_block, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        mark_block_free(start_block + i);
+    }
+    blocks_used -= count;
+}
+
+/**
+ * Resize a block run in place
+ *
+ * Shrinking releases the tail. Growing takes the free blocks right after the
+ * run, mapping more heap first when the run reaches the end of the heap.
+ *
+ * @return 0 on success, -1 if the blocks after the run are taken
+ */
+static int resize_blocks(uint32_t start_block, uint32_t old_count, uint32_t new_count) {
+    if (new_count <= old_count) {
+        release_blocks(start_block + new_count, old_count - new_count);
+        return 0;
+    }
+    if (new_count > HEAP_BLOCKS_MAX - start_block) {
+        return -1;
+    }
+    uint32_t end = start_block + old_count;
+    uint32_t target = start_block + new_count;
+    uint32_t free_end = find_next_block(end, target < heap_blocks ? target : heap_blocks, true);
+    if (free_end < target) {
+        if (free_end < heap_blocks || heap_grow_tail(target - heap_blocks) != 0) {
+            return -1;
+        }
+    }
+    claim_blocks(end, new_count - old_count, false);
+    return 0;
+}
+
+/**
+ * Map a request size to its size class index
+ *
+ * Example: 1..16 → 0 (16 B), 17..32 → 1 (32 B), ... 1025..2048 → 7 (2 KiB)
+ */
+static inline uint32_t slab_class_index(size_t size) {
+    uint32_t idx = 0;
+    size_t class_size = SLAB_MIN_SIZE;
+    while (class_size < size) {
+        class_size <<= 1;
+        idx++;
+    }
+    return idx;
+}
+
+/**
+ * Link a slab at the head of its cache's partial list
+ */
+static void slab_partial_push(slab_cache_t* cache, slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = cache->partial;
+    if (cache->partial) {
+        cache->partial->prev = slab;
+    }
+    cache->partial = slab;
+    slab->on_partial = 1;
+}
+
+/**
+ * Unlink a slab from its cache's partial list
+ */
+static void slab_partial_remove(slab_cache_t* cache, slab_t* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    }
+    else {
+        cache->partial = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = NULL;
+    slab->prev = NULL;
+    slab->on_partial = 0;
+}
+
+/**
+ * Grab a fresh block and carve it into objects of the cache's size
+ *
+ * @return New slab (already on the partial list), or NULL if out of blocks
+ */
+static slab_t* slab_grow(slab_cache_t* cache) {
+    int32_t block = alloc_blocks(1, false);
+    if (block < 0) {
+        return NULL;
+    }
+    slab_t* slab = &slab_table[block];
+    uint8_t* base = (uint8_t*) block_address(block);
+    /* Thread the free list through the block, lowest address first */
+    slab_object_t* head = NULL;
+    for (uint32_t i = cache->objs_per_slab; i > 0; i--) {
+        slab_object_t* obj = (slab_object_t*) (base + (i - 1) * cache->obj_size);
+        obj->next = head;
+        head = obj;
+    }
+    slab->free_list = head;
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab_partial_push(cache, slab);
+    cache->slabs++;
+    return slab;
+}
+
+/**
+ * Allocate one object from a size class
+ */
+static void* slab_alloc(slab_cache_t* cache) {
+    slab_t* slab = cache->partial;
+    if (slab == NULL) {
+        slab = slab_grow(cache);
+        if (slab == NULL) {
+            return NULL;
+        }
+    }
+    slab_object_t* obj = slab->free_list;
+    slab->free_list = obj->next;
+    slab->in_use++;
+    cache->objs_in_use++;
+    /* Full slabs leave the partial list until an object comes back */
+    if (slab->free_list == NULL) {
+        slab_partial_remove(cache, slab);
+    }
+    return (void*) obj;
+}
+
+/**
+ * Return an object to its slab
+ *
+ * Empty slabs go back to the bitmap, except for the last one of the class,
+ * which stays cached so an alloc/free loop doesn't thrash the bitmap.
+ */
+static void slab_free(slab_t* slab, uint32_t block_idx, void* ptr) {
+    slab_cache_t* cache = slab->cache;
+    uint32_t offset = (uint32_t) ptr - block_address(block_idx);
+    if (offset % cache->obj_size != 0) {
+        klog(KLOG_ERR, "[FAILED] kfree: Misaligned slab pointer %p (%u-byte class)\n", ptr, cache->obj_size);
+        return;
+    }
+    slab_object_t* obj = (slab_object_t*) ptr;
+    obj->next = slab->free_list;
+    slab->free_list = obj;
+    slab->in_use--;
+    cache->objs_in_use--;
+    if (!slab->on_partial) {
+        slab_partial_push(cache, slab);
+    }
+    if (slab->in_use == 0 && cache->slabs > 1) {
+        slab_partial_remove(cache, slab);
+        slab->cache = NULL;
+        slab->free_list = NULL;
+        cache->slabs--;
+        release_blocks(block_idx, 1);
+        heap_shrink();
     }
-    /* No contiguous blocks found - return -1 to indicate failure */
-    return -1;
 }
 
 /**
  * Initialize the bitmap heap allocator
  */
 void kheap_init(void) {
-    /* Heap starts right after kernel sections end */
-    kheap_curr = elf_sections_end;
-    /* Align to block boundary (4KB) - rounds UP to next 4096-byte boundary
-     * Formula: (addr + alignment - 1) & ~(alignment - 1)
-     * Example: If elf_sections_end = 0x106789
-     *   Step 1: 0x106789 + 0xFFF = 0x107788
-     *   Step 2: 0x107788 & 0xFFFFF000 = 0x107000 (aligned)
-     */
-    kheap_curr = (kheap_curr + HEAP_BLOCK_SIZE - 1) & ~(HEAP_BLOCK_SIZE - 1);
-    heap_start = kheap_curr;
+    /* Heap has its own virtual range, page-aligned by definition */
+    heap_start = KHEAP_VIRT_START;
+    kheap_curr = heap_start;
+    heap_blocks = 0;
+    meta_mapped_end = HEAP_META_START;
     /* Clear the bitmap (all blocks free) */
-    memset(heap_bitmap, 0, BITMAP_SIZE);
+    memset(heap_bitmap, 0, sizeof(heap_bitmap));
     blocks_used = 0;
-    printf("[  OK  ] Heap initialized at %p\n", heap_start);
+    heap_hint = 0;
+    /* Set up the size classes: 16, 32, 64, ... 2048 bytes */
+    for (uint32_t i = 0; i < SLAB_NUM_CLASSES; i++) {
+        slab_caches[i].obj_size = SLAB_MIN_SIZE << i;
+        slab_caches[i].objs_per_slab = HEAP_BLOCK_SIZE / slab_caches[i].obj_size;
+        slab_caches[i].partial = NULL;
+        slab_caches[i].slabs = 0;
+        slab_caches[i].objs_in_use = 0;
+    }
+    memset(mag_cpus, 0, sizeof(mag_cpus));
+    memset(mag_depots, 0, sizeof(mag_depots));
+    /* Map the initial blocks (and their zeroed slab descriptors) */
+    if (heap_grow(HEAP_INITIAL_BLOCKS) != 0) {
+        klog(KLOG_ERR, "[FAILED] kheap_init: Could not map the initial %u KB\n",
+             (HEAP_INITIAL_BLOCKS * HEAP_BLOCK_SIZE) / 1024);
+        return;
+    }
+    klog(KLOG_INFO, "[  OK  ] Heap initialized at %p\n", heap_start);
 }
 
+static void* block_alloc(size_t size, bool zero);
+
 /**
  * Allocate memory from kernel heap
  *
@@ -145,10 +636,13 @@ void kheap_init(void) {
  * We return (ptr + 1) which skips over the metadata, so the user
  * never sees or modifies it. On free, we go back (ptr - 1) to find it.
  *
- * Example: kmalloc(8) with heap_start = 0x11E000, block 0 allocated:
- *   0x11E000: [0x00000001]  ← Metadata (1 block used) - HIDDEN
- *   0x11E004: [User's 8 bytes of data starts here] ← RETURNED to user
- *   0x11E00C: [Unused 4084 bytes...]
+ * Example: kmalloc(8000) with heap_start = 0xD0000000, block 0 allocated:
+ *   0xD0000000: [0x00000002]  ← Metadata (2 blocks used) - HIDDEN
+ *   0xD0000004: [User's 8000 bytes of data starts here] ← RETURNED to user
+ *   0xD0001F44: [Unused 188 bytes...]
+ *
+ * Requests up to SLAB_MAX_SIZE skip all of this and come from the matching
+ * size-class slab instead (no metadata, object aligned to its class size).
  *
  * Strategy:
  * 1. Calculate blocks needed (data + metadata)
@@ -157,30 +651,42 @@ void kheap_init(void) {
  * 4. Mark blocks as used
  * 5. Return pointer skipping metadata (ptr + 1)
  */
-void* kmalloc(size_t size) {
+static void* heap_malloc(size_t size) {
     if (size == 0) {
         return NULL;
     }
+    /* Small request: take an object from the size-class slab */
+    if (size <= SLAB_MAX_SIZE) {
+        void* obj = slab_alloc(&slab_caches[slab_class_index(size)]);
+        if (obj == NULL) {
+            klog(KLOG_ERR, "[FAILED] kmalloc: Out of memory! (no block for %zu-byte slab)\n", size);
+        }
+        return obj;
+    }
+    return block_alloc(size, false);
+}
+
+/**
+ * Allocate a block run with the block count header (see kmalloc())
+ *
+ * @param zero Clear the run before handing it out
+ */
+static void* block_alloc(size_t size, bool zero) {
     /* Calculate blocks needed: requested size + 4 bytes for metadata */
     size_t total_size = size + sizeof(uint32_t);
     uint32_t blocks_needed = (total_size + HEAP_BLOCK_SIZE - 1) / HEAP_BLOCK_SIZE;
     if (blocks_needed > HEAP_BLOCKS_MAX) {
-        printf("[FAILED] kmalloc: Request too large (%zu bytes, %u blocks)\n", size, blocks_needed);
+        klog(KLOG_ERR, "[FAILED] kmalloc: Request too large (%zu bytes, %u blocks)\n", size, blocks_needed);
         return NULL;
     }
-    /* Find free blocks using first-fit */
-    int32_t start_block = find_free_blocks(blocks_needed);
+    /* Find free blocks using first-fit and mark them as used in bitmap */
+    int32_t start_block = alloc_blocks(blocks_needed, zero);
     if (start_block < 0) {
-        printf("[FAILED] kmalloc: Out of memory! (need %u blocks for %zu bytes)\n", blocks_needed, size);
+        klog(KLOG_ERR, "[FAILED] kmalloc: Out of memory! (need %u blocks for %zu bytes)\n", blocks_needed, size);
         return NULL;
     }
-    /* Mark blocks as used in bitmap */
-    for (uint32_t i = 0; i < blocks_needed; i++) {
-        mark_block_used(start_block + i);
-    }
-    blocks_used += blocks_needed;
     /* Get pointer to start of allocated blocks */
-    uint32_t* ptr = (uint32_t*) (heap_start + (start_block * HEAP_BLOCK_SIZE));
+    uint32_t* ptr = (uint32_t*) block_address(start_block);
     /* Store metadata (block count) at the very beginning. This occupies the first 4 bytes of the allocation */
     *ptr = blocks_needed;
     /* Return pointer AFTER metadata (skip 4 bytes)
@@ -192,8 +698,8 @@ void* kmalloc(size_t size) {
  * Free previously allocated memory
  *
  * Metadata Recovery:
- * User has pointer to data (e.g., 0x11E004)
- * We need to go BACK 4 bytes to find metadata (0x11E000)
+ * User has pointer to data (e.g., 0xD0000004)
+ * We need to go BACK 4 bytes to find metadata (0xD0000000)
  *
  * Memory Layout:
  * ┌───────────────┬───────────┐
@@ -202,10 +708,13 @@ void* kmalloc(size_t size) {
  *  ↑               ↑
  *  ptr - 1         ptr (what user gave us)
  *
- * Example: User calls kfree(0x11E004)
- *   count_ptr = 0x11E004 - 1 = 0x11E000  ← Go back to metadata
- *   blocks_to_free = *0x11E000 = 1       ← Read block count
- *   Free block 0                         ← Mark as free in bitmap
+ * Example: User calls kfree(0xD0000004)
+ *   count_ptr = 0xD0000004 - 1 = 0xD0000000  ← Go back to metadata
+ *   blocks_to_free = *0xD0000000 = 2         ← Read block count
+ *   Free blocks 0-1                          ← Mark as free in bitmap
+ *
+ * Slab objects are recognised by the descriptor of the block they live in
+ * and go back to their size class instead.
  *
  * Strategy:
  * 1. Subtract 1 from user pointer to get metadata pointer
@@ -213,10 +722,25 @@ void* kmalloc(size_t size) {
  * 3. Calculate block index from address
  * 4. Mark all blocks as free in bitmap
  */
-void kfree(void* ptr) {
+static void heap_free(void* ptr) {
     if (ptr == NULL) {
         return;
     }
+    uint32_t addr = (uint32_t) ptr;
+    if (addr >= heap_start && addr < kheap_curr) {
+        uint32_t block_idx = (addr - heap_start) / HEAP_BLOCK_SIZE;
+        if (slab_table[block_idx].cache != NULL) {
+            slab_free(&slab_table[block_idx], block_idx, ptr);
+            return;
+        }
+        /* Headerless run from kmalloc_aligned(): starts exactly at a block */
+        if (slab_table[block_idx].run_blocks != 0 && addr == block_address(block_idx)) {
+            release_blocks(block_idx, slab_table[block_idx].run_blocks);
+            slab_table[block_idx].run_blocks = 0;
+            heap_shrink();
+            return;
+        }
+    }
     /* Get metadata pointer by going BACK 4 bytes. (ptr - 1) moves back by sizeof(uint32_t) = 4 bytes */
     uint32_t* count_ptr = ((uint32_t*) ptr) - 1;
     /* Read block count from metadata */
@@ -230,30 +754,659 @@ void kfree(void* ptr) {
     }
     /* Calculate block index: offset from heap start divided by block size */
     uint32_t start_block = (block_addr - heap_start) / HEAP_BLOCK_SIZE;
-    if (start_block >= HEAP_BLOCKS_MAX) {
-        printf("[FAILED] kfree: Invalid pointer %p (beyond heap)\n", ptr);
+    if (start_block >= heap_blocks) {
+        klog(KLOG_ERR, "[FAILED] kfree: Invalid pointer %p (beyond heap)\n", ptr);
         return;
     }
     /* Sanity check */
-    if (blocks_to_free == 0 || blocks_to_free > HEAP_BLOCKS_MAX) {
-        printf("[FAILED] kfree: Corrupted block count %u at %p\n", blocks_to_free, ptr);
+    if (blocks_to_free == 0 || blocks_to_free > heap_blocks - start_block) {
+        klog(KLOG_ERR, "[FAILED] kfree: Corrupted block count %u at %p\n", blocks_to_free, ptr);
         return;
     }
     /* Free all blocks */
-    for (uint32_t i = 0; i < blocks_to_free; i++) {
-        mark_block_free(start_block + i);
+    release_blocks(start_block, blocks_to_free);
+    /* Give memory back if this freed the end of the heap */
+    heap_shrink();
+}
+
+/**
+ * Allocate memory aligned to a power of two
+ *
+ * Slab objects are aligned to their class size, so small requests just use
+ * the class max(size, align). Larger ones take a headerless block run (the
+ * block count lives in the run's descriptor), over-allocated and trimmed
+ * when the alignment exceeds a block:
+ *
+ *   align = 16 KiB, size = 8 KiB: allocate 2 + 3 blocks
+ *   ┌─────┬───────────┬─────────┐
+ *   │ pre │ 2 aligned │  post   │  → pre and post go straight back
+ *   └─────┴───────────┴─────────┘
+ */
+static void* heap_malloc_aligned(size_t size, size_t align) {
+    if (align == 0 || (align & (align - 1)) != 0) {
+        klog(KLOG_ERR, "[FAILED] kmalloc_aligned: Alignment %zu is not a power of two\n", align);
+        return NULL;
+    }
+    if (size == 0) {
+        return NULL;
+    }
+    if (size <= SLAB_MAX_SIZE && align <= SLAB_MAX_SIZE) {
+        return heap_malloc(size > align ? size : align);
+    }
+    /* heap_start is aligned to the whole heap size, so block indices carry the alignment */
+    uint32_t align_blocks = align <= HEAP_BLOCK_SIZE ? 1 : align / HEAP_BLOCK_SIZE;
+    uint32_t blocks_needed = (size + HEAP_BLOCK_SIZE - 1) / HEAP_BLOCK_SIZE;
+    if (size > HEAP_BLOCKS_MAX * HEAP_BLOCK_SIZE || align_blocks > HEAP_BLOCKS_MAX ||
+        blocks_needed > HEAP_BLOCKS_MAX - (align_blocks - 1)) {
+        klog(KLOG_ERR, "[FAILED] kmalloc_aligned: Request too large (%zu bytes, align %zu)\n", size, align);
+        return NULL;
     }
-    blocks_used -= blocks_to_free;
+    uint32_t total = blocks_needed + align_blocks - 1;
+    int32_t start_block = alloc_blocks(total, false);
+    if (start_block < 0) {
+        klog(KLOG_ERR, "[FAILED] kmalloc_aligned: Out of memory! (need %u blocks for %zu bytes)\n", total, size);
+        return NULL;
+    }
+    uint32_t aligned = (start_block + align_blocks - 1) & ~(align_blocks - 1);
+    uint32_t prefix = aligned - start_block;
+    release_blocks(start_block, prefix);
+    release_blocks(aligned + blocks_needed, total - prefix - blocks_needed);
+    slab_table[aligned].run_blocks = blocks_needed;
+    return (void*) block_address(aligned);
+}
+
+/**
+ * Allocate zeroed memory for an array
+ *
+ * Blocks fresh from heap_grow() are known to be zero and aren't cleared again.
+ */
+static void* heap_calloc(size_t count, size_t size) {
+    if (count == 0 || size == 0) {
+        return NULL;
+    }
+    if (count > SIZE_MAX / size) {
+        klog(KLOG_ERR, "[FAILED] kcalloc: %zu * %zu bytes overflows\n", count, size);
+        return NULL;
+    }
+    size_t total = count * size;
+    if (total > SLAB_MAX_SIZE) {
+        return block_alloc(total, true);
+    }
+    void* ptr = heap_malloc(total);
+    if (ptr != NULL) {
+        memset(ptr, 0, total);
+    }
+    return ptr;
+}
+
+/**
+ * Move an allocation to a new one of 'size' bytes, copying 'old_size' bytes
+ */
+static void* krealloc_move(void* ptr, size_t old_size, size_t size, bool block_aligned) {
+    void* new_ptr = block_aligned ? heap_malloc_aligned(size, HEAP_BLOCK_SIZE) : heap_malloc(size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    heap_free(ptr);
+    return new_ptr;
+}
+
+/**
+ * Resize an allocation, in place when possible
+ *
+ * Slab objects stay put while the new size fits their class. Block runs
+ * shrink by releasing their tail and grow into the free blocks that follow
+ * them (mapping more heap if they sit at its end); only when those are taken
+ * is the data copied to a new allocation.
+ */
+static void* heap_realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return heap_malloc(size);
+    }
+    if (size == 0) {
+        heap_free(ptr);
+        return NULL;
+    }
+    uint32_t addr = (uint32_t) ptr;
+    if (addr < heap_start + sizeof(uint32_t) || addr >= kheap_curr) {
+        klog(KLOG_ERR, "[FAILED] krealloc: Invalid pointer %p\n", ptr);
+        return NULL;
+    }
+    uint32_t block_idx = (addr - heap_start) / HEAP_BLOCK_SIZE;
+    slab_t* slab = &slab_table[block_idx];
+    /* Slab object: its capacity is the class size */
+    if (slab->cache != NULL) {
+        if (size <= slab->cache->obj_size) {
+            return ptr;
+        }
+        return krealloc_move(ptr, slab->cache->obj_size, size, false);
+    }
+    /* Headerless run from kmalloc_aligned() */
+    if (slab->run_blocks != 0 && addr == block_address(block_idx)) {
+        uint32_t old_count = slab->run_blocks;
+        uint32_t new_count = (size + HEAP_BLOCK_SIZE - 1) / HEAP_BLOCK_SIZE;
+        if (size <= HEAP_BLOCKS_MAX * HEAP_BLOCK_SIZE && resize_blocks(block_idx, old_count, new_count) == 0) {
+            slab->run_blocks = new_count;
+            heap_shrink();
+            return ptr;
+        }
+        return krealloc_move(ptr, old_count * HEAP_BLOCK_SIZE, size, true);
+    }
+    /* Block run with the count header just before ptr */
+    uint32_t* count_ptr = ((uint32_t*) ptr) - 1;
+    uint32_t old_count = *count_ptr;
+    uint32_t start_block = ((uint32_t) count_ptr - heap_start) / HEAP_BLOCK_SIZE;
+    if (old_count == 0 || old_count > heap_blocks - start_block) {
+        klog(KLOG_ERR, "[FAILED] krealloc: Corrupted block count %u at %p\n", old_count, ptr);
+        return NULL;
+    }
+    if (size <= HEAP_BLOCKS_MAX * HEAP_BLOCK_SIZE - sizeof(uint32_t)) {
+        uint32_t new_count = (size + sizeof(uint32_t) + HEAP_BLOCK_SIZE - 1) / HEAP_BLOCK_SIZE;
+        if (resize_blocks(start_block, old_count, new_count) == 0) {
+            *count_ptr = new_count;
+            heap_shrink();
+            return ptr;
+        }
+    }
+    return krealloc_move(ptr, old_count * HEAP_BLOCK_SIZE - sizeof(uint32_t), size, false);
+}
+
+/*
+ * Magazine layer
+ *
+ * Each CPU keeps two magazines per size class. Allocation pops from the
+ * loaded one, free pushes onto it; only when both are exhausted does the
+ * CPU trade with the class's depot, and only when the depot can't help does
+ * it fall back to the slabs under heap_lock:
+ *
+ *   kmalloc(40) on CPU 1, 64 B class
+ *     loaded has rounds         → pop                            (no lock)
+ *     previous is full          → swap loaded/previous, pop      (no lock)
+ *     depot has a full one      → previous to the depot as empty,
+ *                                 previous = loaded, load the full one, pop
+ *     else                      → slab_alloc() under heap_lock
+ *
+ *   kfree() mirrors it with empty magazines; a new magazine is allocated
+ *   when the depot has no empty one, and a full magazine the depot has no
+ *   room for goes back to the slabs.
+ *
+ * Per-CPU state is only touched by its own CPU with preemption disabled,
+ * which is enough because IRQ handlers don't allocate. Lock order: depot
+ * lock, then heap_lock. Objects in magazines count as in use for the slabs.
+ */
+
+static spinlock_t heap_lock = SPINLOCK_INIT;
+
+/**
+ * Pop a full magazine off a depot, or NULL
+ */
+static magazine_t* depot_take_full(mag_depot_t* depot) {
+    magazine_t* mag = depot->full;
+    if (mag != NULL) {
+        depot->full = mag->next;
+        depot->full_count--;
+        depot->exchanges++;
+    }
+    return mag;
+}
+
+/**
+ * Pop an empty magazine off a depot, or NULL
+ */
+static magazine_t* depot_take_empty(mag_depot_t* depot) {
+    magazine_t* mag = depot->empty;
+    if (mag != NULL) {
+        depot->empty = mag->next;
+        depot->exchanges++;
+    }
+    return mag;
+}
+
+/**
+ * Push an empty magazine onto a depot
+ */
+static void depot_put_empty(mag_depot_t* depot, magazine_t* mag) {
+    mag->next = depot->empty;
+    depot->empty = mag;
+}
+
+/**
+ * Allocate an object of a class from the running CPU's magazines or the depot
+ *
+ * @return Object, or NULL if the caller must go to the slabs
+ */
+static void* mag_alloc(uint32_t class_idx) {
+    preempt_disable();
+    mag_percpu_t* pc = &mag_cpus[cpu_self()->id];
+    mag_cpu_t* mc = &pc->classes[class_idx];
+    void* obj = NULL;
+    pc->allocs++;
+    if (mc->loaded == NULL || mc->loaded->rounds == 0) {
+        if (mc->previous != NULL && mc->previous->rounds == MAG_ROUNDS) {
+            magazine_t* tmp = mc->loaded;
+            mc->loaded = mc->previous;
+            mc->previous = tmp;
+        }
+        else {
+            mag_depot_t* depot = &mag_depots[class_idx];
+            spin_lock(&depot->lock);
+            magazine_t* full = depot_take_full(depot);
+            if (full != NULL) {
+                if (mc->previous != NULL) {
+                    depot_put_empty(depot, mc->previous);
+                }
+                mc->previous = mc->loaded;
+                mc->loaded = full;
+            }
+            spin_unlock(&depot->lock);
+            if (full != NULL) {
+                obj = full->objs[--full->rounds];
+            }
+            preempt_enable();
+            return obj;
+        }
+    }
+    obj = mc->loaded->objs[--mc->loaded->rounds];
+    pc->alloc_hits++;
+    preempt_enable();
+    return obj;
+}
+
+/**
+ * Free an object of a class into the running CPU's magazines
+ */
+static void mag_free(uint32_t class_idx, void* ptr) {
+    preempt_disable();
+    mag_percpu_t* pc = &mag_cpus[cpu_self()->id];
+    mag_cpu_t* mc = &pc->classes[class_idx];
+    pc->frees++;
+    if (mc->loaded != NULL && mc->loaded->rounds < MAG_ROUNDS) {
+        mc->loaded->objs[mc->loaded->rounds++] = ptr;
+        pc->free_hits++;
+        preempt_enable();
+        return;
+    }
+    if (mc->previous != NULL && mc->previous->rounds == 0) {
+        magazine_t* tmp = mc->loaded;
+        mc->loaded = mc->previous;
+        mc->previous = tmp;
+        mc->loaded->objs[mc->loaded->rounds++] = ptr;
+        pc->free_hits++;
+        preempt_enable();
+        return;
+    }
+    /* Both are full (or missing): get an empty one, from the depot or the slabs */
+    mag_depot_t* depot = &mag_depots[class_idx];
+    spin_lock(&depot->lock);
+    magazine_t* empty = depot_take_empty(depot);
+    spin_unlock(&depot->lock);
+    if (empty == NULL) {
+        spin_lock(&heap_lock);
+        empty = (magazine_t*) slab_alloc(&slab_caches[slab_class_index(sizeof(magazine_t))]);
+        if (empty == NULL) {
+            /* No memory for a magazine: the object goes straight back */
+            heap_free(ptr);
+            spin_unlock(&heap_lock);
+            preempt_enable();
+            return;
+        }
+        spin_unlock(&heap_lock);
+        empty->rounds = 0;
+    }
+    /* The full previous one goes to the depot, or back to the slabs if the depot has enough */
+    magazine_t* flush = NULL;
+    if (mc->previous != NULL) {
+        spin_lock(&depot->lock);
+        if (depot->full_count < MAG_DEPOT_MAX_FULL) {
+            mc->previous->next = depot->full;
+            depot->full = mc->previous;
+            depot->full_count++;
+            depot->exchanges++;
+        }
+        else {
+            flush = mc->previous;
+        }
+        spin_unlock(&depot->lock);
+    }
+    if (flush != NULL) {
+        spin_lock(&heap_lock);
+        while (flush->rounds > 0) {
+            heap_free(flush->objs[--flush->rounds]);
+        }
+        spin_unlock(&heap_lock);
+        spin_lock(&depot->lock);
+        depot_put_empty(depot, flush);
+        spin_unlock(&depot->lock);
+    }
+    mc->previous = mc->loaded;
+    mc->loaded = empty;
+    empty->objs[empty->rounds++] = ptr;
+    preempt_enable();
+}
+
+/**
+ * Size class of a live slab object, or -1 if ptr isn't one
+ */
+static int32_t mag_class_of(void* ptr) {
+    uint32_t addr = (uint32_t) ptr;
+    if (addr < heap_start || addr >= kheap_curr) {
+        return -1;
+    }
+    uint32_t block_idx = (addr - heap_start) / HEAP_BLOCK_SIZE;
+    /* Stable while the object is live: its slab can't be released under it */
+    slab_cache_t* cache = slab_table[block_idx].cache;
+    if (cache == NULL || (addr - block_address(block_idx)) % cache->obj_size != 0) {
+        return -1;  /* Block run, or a bad pointer heap_free() will report */
+    }
+    return (int32_t) (cache - slab_caches);
+}
+
+/*
+ * Call-site histogram
+ *
+ * Two open-addressed tables under sites_lock, both probed linearly:
+ *   sites       return address → kheap_site_t (empty while allocs is 0)
+ *   sites_live  live pointer → its site and size, for kfree()
+ * A freed entry is filled by shifting the rest of its cluster back, so long
+ * runs leave no tombstones behind. Sites beyond KHEAP_SITES share
+ * sites_other; allocations beyond KHEAP_SITES_LIVE count as untracked.
+ */
+
+#if (KHEAP_SITES & (KHEAP_SITES - 1)) != 0 || (KHEAP_SITES_LIVE & (KHEAP_SITES_LIVE - 1)) != 0
+#error "KHEAP_SITES and KHEAP_SITES_LIVE must be powers of two"
+#endif
+
+#define SITES_OTHER         KHEAP_SITES              /* Site index of sites_other */
+
+typedef struct {
+    void* ptr;                  /* NULL: empty slot */
+    uint32_t site;              /* Index into sites, or SITES_OTHER */
+    uint32_t size;              /* Bytes requested */
+} kheap_live_t;
+
+static volatile bool sites_enabled = false;
+static spinlock_t sites_lock = SPINLOCK_INIT;
+static kheap_site_t sites[KHEAP_SITES];
+static kheap_site_t sites_other;
+static kheap_live_t sites_live[KHEAP_SITES_LIVE];
+
+static inline uint32_t sites_hash(uint32_t key) {
+    return (key * 0x9E3779B1u) >> 16;
+}
+
+/**
+ * Find or add the entry of a call site (sites_lock held)
+ *
+ * @return Site index, or SITES_OTHER if the table is full
+ */
+static uint32_t sites_find(uint32_t pc) {
+    for (uint32_t probe = 0; probe < KHEAP_SITES; probe++) {
+        uint32_t i = (sites_hash(pc) + probe) & (KHEAP_SITES - 1);
+        if (sites[i].allocs == 0) {
+            sites[i].pc = pc;
+            return i;
+        }
+        if (sites[i].pc == pc) {
+            return i;
+        }
+    }
+    return SITES_OTHER;
+}
+
+static inline kheap_site_t* sites_entry(uint32_t index) {
+    return index == SITES_OTHER ? &sites_other : &sites[index];
+}
+
+/**
+ * Count an allocation against the call site that made it
+ */
+static void sites_record_alloc(uint32_t pc, void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    spin_lock(&sites_lock);
+    uint32_t index = sites_find(pc);
+    kheap_site_t* site = sites_entry(index);
+    site->allocs++;
+    site->untracked++;
+    for (uint32_t probe = 0; probe < KHEAP_SITES_LIVE; probe++) {
+        kheap_live_t* live = &sites_live[(sites_hash((uint32_t) ptr) + probe) & (KHEAP_SITES_LIVE - 1)];
+        if (live->ptr == NULL) {
+            live->ptr = ptr;
+            live->site = index;
+            live->size = (uint32_t) size;
+            site->untracked--;
+            site->live_bytes += (uint32_t) size;
+            break;
+        }
+    }
+    spin_unlock(&sites_lock);
+}
+
+/**
+ * Credit a free to the call site its memory came from, if it was recorded
+ *
+ * Must run before the memory can be handed out again.
+ */
+static void sites_record_free(void* ptr) {
+    const uint32_t mask = KHEAP_SITES_LIVE - 1;
+    spin_lock(&sites_lock);
+    uint32_t i = sites_hash((uint32_t) ptr) & mask;
+    uint32_t probe = 0;
+    while (probe < KHEAP_SITES_LIVE && sites_live[i].ptr != NULL && sites_live[i].ptr != ptr) {
+        i = (i + 1) & mask;
+        probe++;
+    }
+    if (probe == KHEAP_SITES_LIVE || sites_live[i].ptr != ptr) {
+        spin_unlock(&sites_lock);
+        return;     /* Allocated before the histogram was on, or untracked */
+    }
+    kheap_site_t* site = sites_entry(sites_live[i].site);
+    site->frees++;
+    site->live_bytes -= sites_live[i].size;
+
+    /* Pull later entries of the cluster into the hole; one may move unless its home slot is past the hole */
+    uint32_t hole = i;
+    for (uint32_t n = 1; n < KHEAP_SITES_LIVE; n++) {
+        uint32_t j = (i + n) & mask;
+        if (sites_live[j].ptr == NULL) {
+            break;
+        }
+        uint32_t home = sites_hash((uint32_t) sites_live[j].ptr) & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            sites_live[hole] = sites_live[j];
+            hole = j;
+        }
+    }
+    sites_live[hole].ptr = NULL;
+    spin_unlock(&sites_lock);
+}
+
+/**
+ * Start or stop the call-site histogram
+ */
+void kheap_sites_enable(bool enable) {
+    spin_lock(&sites_lock);
+    if (enable && !sites_enabled) {
+        memset(sites, 0, sizeof(sites));
+        memset(&sites_other, 0, sizeof(sites_other));
+        memset(sites_live, 0, sizeof(sites_live));
+    }
+    sites_enabled = enable;
+    spin_unlock(&sites_lock);
+}
+
+/**
+ * Copy out the call sites, most live bytes first (insertion into the top max)
+ */
+size_t kheap_get_sites(kheap_site_t* out, size_t max) {
+    size_t n = 0;
+    spin_lock(&sites_lock);
+    for (uint32_t i = 0; i <= KHEAP_SITES; i++) {
+        const kheap_site_t* site = sites_entry(i);
+        if (site->allocs == 0) {
+            continue;
+        }
+        size_t pos = n;
+        while (pos > 0 && out[pos - 1].live_bytes < site->live_bytes) {
+            if (pos < max) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max) {
+            out[pos] = *site;
+        }
+        n = n < max ? n + 1 : max;
+    }
+    spin_unlock(&sites_lock);
+    return n;
+}
+
+/*
+ * Public entry points
+ *
+ * Other CPUs may allocate at the same time, so every entry point holds
+ * heap_lock. Holding it also disables preemption: a switch that falls due
+ * meanwhile happens on the way out. Interrupts stay on, so IRQ handlers still
+ * must not allocate (they would spin on a lock their CPU holds).
+ */
+
+void* kmalloc(size_t size) {
+    void* ptr = NULL;
+    if (size != 0 && size <= SLAB_MAX_SIZE) {
+        ptr = mag_alloc(slab_class_index(size));
+    }
+    if (ptr == NULL) {
+        spin_lock(&heap_lock);
+        ptr = heap_malloc(size);
+        spin_unlock(&heap_lock);
+    }
+    TRACE(KMALLOC, size, ptr);
+    if (__builtin_expect(sites_enabled, 0)) {
+        sites_record_alloc((uint32_t) __builtin_return_address(0), ptr, size);
+    }
+    return ptr;
+}
+
+void kfree(void* ptr) {
+    if (__builtin_expect(sites_enabled, 0) && ptr != NULL) {
+        sites_record_free(ptr);
+    }
+    int32_t class_idx = ptr != NULL ? mag_class_of(ptr) : -1;
+    if (class_idx >= 0) {
+        mag_free((uint32_t) class_idx, ptr);
+    }
+    else {
+        spin_lock(&heap_lock);
+        heap_free(ptr);
+        spin_unlock(&heap_lock);
+    }
+    TRACE(KFREE, ptr, 0);
+}
+
+void* kmalloc_aligned(size_t size, size_t align) {
+    spin_lock(&heap_lock);
+    void* ptr = heap_malloc_aligned(size, align);
+    spin_unlock(&heap_lock);
+    TRACE(KMALLOC, size, ptr);
+    if (__builtin_expect(sites_enabled, 0)) {
+        sites_record_alloc((uint32_t) __builtin_return_address(0), ptr, size);
+    }
+    return ptr;
+}
+
+void* kcalloc(size_t count, size_t size) {
+    spin_lock(&heap_lock);
+    void* ptr = heap_calloc(count, size);
+    spin_unlock(&heap_lock);
+    TRACE(KMALLOC, count * size, ptr);
+    if (__builtin_expect(sites_enabled, 0)) {
+        sites_record_alloc((uint32_t) __builtin_return_address(0), ptr, count * size);
+    }
+    return ptr;
+}
+
+void* krealloc(void* ptr, size_t size) {
+    spin_lock(&heap_lock);
+    void* new_ptr = heap_realloc(ptr, size);
+    if (__builtin_expect(sites_enabled, 0) && (new_ptr != NULL || size == 0)) {
+        /* Still under heap_lock, so ptr can't be handed out again before it leaves the table */
+        if (ptr != NULL) {
+            sites_record_free(ptr);
+        }
+        sites_record_alloc((uint32_t) __builtin_return_address(0), new_ptr, size);
+    }
+    spin_unlock(&heap_lock);
+    return new_ptr;
 }
 
 /**
  * Get heap statistics (for debugging)
  */
 void kheap_stats(void) {
-    uint32_t free_blocks = HEAP_BLOCKS_MAX - blocks_used;
+    uint32_t free_blocks = heap_blocks - blocks_used;
     printf("Heap statistics:\n");
-    printf("Blocks used:  %u / %u\n", blocks_used, HEAP_BLOCKS_MAX);
+    printf("Heap size:    %u KB (max %u MB)\n", (heap_blocks * HEAP_BLOCK_SIZE) / 1024,
+           (HEAP_BLOCKS_MAX * HEAP_BLOCK_SIZE) / (1024 * 1024));
+    printf("Blocks used:  %u / %u\n", blocks_used, heap_blocks);
     printf("Blocks free:  %u\n", free_blocks);
     printf("Memory used:  %u KB\n", (blocks_used * HEAP_BLOCK_SIZE) / 1024);
     printf("Memory free:  %u KB\n", (free_blocks * HEAP_BLOCK_SIZE) / 1024);
+    printf("Largest free: %u blocks\n", kheap_largest_free());
+    printf("Slab classes:\n");
+    for (uint32_t i = 0; i < SLAB_NUM_CLASSES; i++) {
+        slab_cache_t* cache = &slab_caches[i];
+        /* Read without the CPUs' cooperation: a snapshot, not exact */
+        uint32_t cached = mag_depots[i].full_count * MAG_ROUNDS;
+        for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+            mag_cpu_t* mc = &mag_cpus[cpu].classes[i];
+            cached += (mc->loaded ? mc->loaded->rounds : 0) + (mc->previous ? mc->previous->rounds : 0);
+        }
+        printf("  %u B: %u slabs, %u / %u objects (%u in magazines, %u depot exchanges)\n", cache->obj_size,
+               cache->slabs, cache->objs_in_use, cache->slabs * cache->objs_per_slab, cached,
+               mag_depots[i].exchanges);
+    }
+    printf("Magazine hit rates:\n");
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        mag_percpu_t* pc = &mag_cpus[cpu];
+        if (pc->allocs == 0 && pc->frees == 0) {
+            continue;
+        }
+        printf("  CPU %u: alloc %u%% (%u / %u), free %u%% (%u / %u)\n", cpu,
+               pc->allocs ? (uint32_t) ((uint64_t) pc->alloc_hits * 100 / pc->allocs) : 0, pc->alloc_hits, pc->allocs,
+               pc->frees ? (uint32_t) ((uint64_t) pc->free_hits * 100 / pc->frees) : 0, pc->free_hits, pc->frees);
+    }
+}
+
+/**
+ * Get the heap occupancy without taking a lock
+ */
+void kheap_get_info(kheap_info_t* info) {
+    info->blocks = heap_blocks;
+    info->blocks_used = blocks_used;
+    info->blocks_max = HEAP_BLOCKS_MAX;
+    for (uint32_t i = 0; i < SLAB_NUM_CLASSES; i++) {
+        info->slab[i].obj_size = slab_caches[i].obj_size;
+        info->slab[i].slabs = slab_caches[i].slabs;
+        info->slab[i].objs_in_use = slab_caches[i].objs_in_use;
+    }
+}
+
+/**
+ * Longest run of free blocks in the mapped heap
+ */
+uint32_t kheap_largest_free(void) {
+    uint32_t best = 0;
+    spin_lock(&heap_lock);
+    uint32_t from = 0;
+    while (from < heap_blocks) {
+        uint32_t start = find_next_block(from, heap_blocks, false);
+        uint32_t end = find_next_block(start, heap_blocks, true);
+        best = end - start > best ? end - start : best;
+        from = end;
+    }
+    spin_unlock(&heap_lock);
+    return best;
 }
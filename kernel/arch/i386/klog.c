@@ -0,0 +1,389 @@
+/**
+ * Kernel Log Ring
+ *
+ *   klog(level, ...) → format into a line → [header | text] at head
+ *     → console deferred? the idle thread renders it later : render now
+ *
+ * Positions only grow and are taken modulo KLOG_BUFFER_SIZE, so a record may
+ * wrap around the end of the buffer:
+ *
+ *   tail ......... console ......... head
+ *   oldest record  next to render    next free byte
+ *
+ * A message that doesn't fit evicts records at tail. If the console hadn't
+ * rendered them yet it moves along, and a notice tells how many it skipped.
+ *
+ * klog_lock (taken with interrupts off) guards the ring, only for a copy in
+ * or out. console_lock elects the one context that renders, so the slow VGA
+ * and serial writes run without klog_lock and with interrupts on. It is only
+ * ever tried: a context that finds it taken (an IRQ interrupting a render,
+ * another CPU) leaves its message to the holder, which renders until nothing
+ * is pending.
+ *
+ * Rendered text reaches COM1 in batches of up to KLOG_SERIAL_BATCH bytes,
+ * one serial_write() each, instead of one per message.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/klog.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer.h>
+#include <kernel/tty.h>
+#include <kernel/serial.h>
+#include <kernel/shell.h>
+
+#define KLOG_MASK               (KLOG_BUFFER_SIZE - 1)
+#define KLOG_SERIAL_BATCH       512
+
+/* Record header; the text follows, padded to 4 bytes */
+typedef struct {
+    uint64_t time_ns;
+    uint32_t seq;
+    uint16_t len;
+    uint8_t level;
+    uint8_t reserved;
+} klog_header_t;
+
+static uint8_t klog_buf[KLOG_BUFFER_SIZE];
+static uint32_t klog_head = 0;              /* Byte positions, see above */
+static uint32_t klog_tail = 0;
+static uint32_t klog_console = 0;
+static uint32_t klog_tail_seq = 0;          /* Number of the record at tail */
+static uint32_t klog_console_seq = 0;       /* Number of the record at console */
+static uint32_t klog_next_seq = 0;
+static uint32_t klog_dropped = 0;
+static uint32_t klog_dropped_notice = 0;    /* Dropped since the console last said so */
+static int console_level = KLOG_INFO;
+static bool klog_deferred = false;
+static spinlock_t klog_lock = SPINLOCK_INIT;
+static spinlock_t console_lock = SPINLOCK_INIT;
+
+/* Owned by the console_lock holder */
+static char console_text[KLOG_LINE_MAX];
+static char serial_batch[KLOG_SERIAL_BATCH];
+static size_t serial_batch_len = 0;
+
+static const char* const klog_level_names[] = { "err", "warn", "info", "debug" };
+
+/**
+ * Bytes a record with len bytes of text takes in the ring
+ */
+static inline uint32_t record_size(uint32_t len) {
+    return (uint32_t) sizeof(klog_header_t) + ((len + 3) & ~3u);
+}
+
+/**
+ * Copy into the ring at a position, wrapping around its end
+ */
+static void ring_copy_in(uint32_t pos, const void* data, size_t len) {
+    uint32_t index = pos & KLOG_MASK;
+    size_t first = len < KLOG_BUFFER_SIZE - index ? len : KLOG_BUFFER_SIZE - index;
+    memcpy(&klog_buf[index], data, first);
+    memcpy(klog_buf, (const uint8_t*) data + first, len - first);
+}
+
+/**
+ * Copy out of the ring from a position, wrapping around its end
+ */
+static void ring_copy_out(uint32_t pos, void* data, size_t len) {
+    uint32_t index = pos & KLOG_MASK;
+    size_t first = len < KLOG_BUFFER_SIZE - index ? len : KLOG_BUFFER_SIZE - index;
+    memcpy(data, &klog_buf[index], first);
+    memcpy((uint8_t*) data + first, klog_buf, len - first);
+}
+
+/**
+ * Drop the oldest record (klog_lock held)
+ */
+static void ring_evict(void) {
+    klog_header_t header;
+    ring_copy_out(klog_tail, &header, sizeof(header));
+    if (klog_console == klog_tail) {
+        klog_console += record_size(header.len);
+        klog_console_seq++;
+        klog_dropped++;
+        klog_dropped_notice++;
+    }
+    klog_tail += record_size(header.len);
+    klog_tail_seq++;
+}
+
+/**
+ * Check whether making room for need bytes would evict a warning or error the console hasn't shown (klog_lock held)
+ */
+static bool ring_would_drop_important(uint32_t need) {
+    uint32_t pos = klog_tail;
+    while (klog_head + need - pos > KLOG_BUFFER_SIZE) {
+        klog_header_t header;
+        ring_copy_out(pos, &header, sizeof(header));
+        if ((int32_t) (pos - klog_console) >= 0 && header.level <= KLOG_WARN) {
+            return true;
+        }
+        pos += record_size(header.len);
+    }
+    return false;
+}
+
+/**
+ * Send the collected serial output (console_lock held)
+ */
+static void console_serial_flush(void) {
+    if (serial_batch_len > 0) {
+        serial_write(SERIAL_COM1_BASE, serial_batch, serial_batch_len);
+        serial_batch_len = 0;
+    }
+}
+
+/**
+ * Write text to the terminal, and into the serial batch (console_lock held)
+ */
+static void console_write(const char* text, size_t len) {
+    terminal_write(text, len);
+    if (len > sizeof(serial_batch) - serial_batch_len) {
+        console_serial_flush();
+    }
+    memcpy(serial_batch + serial_batch_len, text, len);
+    serial_batch_len += len;
+}
+
+/**
+ * Take the next record the console hasn't shown into console_text (console_lock held)
+ *
+ * @return Its text length, or -1 if nothing is pending
+ */
+static int console_next(int* level, uint32_t* dropped) {
+    uint32_t flags = spin_lock_irqsave(&klog_lock);
+    *dropped = klog_dropped_notice;
+    klog_dropped_notice = 0;
+    if (klog_console == klog_head) {
+        spin_unlock_irqrestore(&klog_lock, flags);
+        return -1;
+    }
+    klog_header_t header;
+    ring_copy_out(klog_console, &header, sizeof(header));
+    ring_copy_out(klog_console + sizeof(header), console_text, header.len);
+    klog_console += record_size(header.len);
+    klog_console_seq++;
+    spin_unlock_irqrestore(&klog_lock, flags);
+    *level = header.level;
+    return header.len;
+}
+
+/**
+ * Render up to max pending records, if no other context is rendering already
+ */
+static void console_render(uint32_t max) {
+    do {
+        if (!spin_trylock(&console_lock)) {
+            return;     /* The holder renders ours too */
+        }
+        for (uint32_t done = 0; done < max; done++) {
+            int level;
+            uint32_t dropped;
+            int len = console_next(&level, &dropped);
+            if (dropped > 0) {
+                char notice[64];
+                int notice_len = snprintf(notice, sizeof(notice), "[klog] %u messages dropped\n", dropped);
+                console_write(notice, (size_t) notice_len);
+            }
+            if (len < 0) {
+                break;
+            }
+            if (level <= console_level) {
+                console_write(console_text, (size_t) len);
+            }
+        }
+        console_serial_flush();
+        spin_unlock(&console_lock);
+        /* A message that came while we held the lock found it taken and left itself to us */
+    } while (max == UINT32_MAX && __atomic_load_n(&klog_console, __ATOMIC_RELAXED) !=
+                                  __atomic_load_n(&klog_head, __ATOMIC_RELAXED));
+}
+
+/**
+ * Defer console output from now on
+ */
+void klog_init(void) {
+    klog_deferred = true;
+    klog(KLOG_INFO, "[  OK  ] Kernel log initialized (%u KiB ring, console deferred to idle time).\n",
+         KLOG_BUFFER_SIZE / 1024);
+}
+
+/**
+ * Log a message
+ */
+int klog(int level, const char* format, ...) {
+    if (level < KLOG_ERR || level > KLOG_DEBUG) {
+        return -1;
+    }
+    char line[KLOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len < 0) {
+        return -1;
+    }
+    uint32_t stored = (size_t) len < sizeof(line) ? (uint32_t) len : sizeof(line) - 1;
+    uint32_t need = record_size(stored);
+
+    uint32_t flags = spin_lock_irqsave(&klog_lock);
+    if (klog_deferred && ring_would_drop_important(need)) {
+        /* Show them first; if someone else is rendering right now they go anyway */
+        spin_unlock_irqrestore(&klog_lock, flags);
+        klog_flush();
+        flags = spin_lock_irqsave(&klog_lock);
+    }
+    while (klog_head + need - klog_tail > KLOG_BUFFER_SIZE) {
+        ring_evict();
+    }
+    klog_header_t header = { ktime_ns(), klog_next_seq++, (uint16_t) stored, (uint8_t) level, 0 };
+    ring_copy_in(klog_head, &header, sizeof(header));
+    ring_copy_in(klog_head + sizeof(header), line, stored);
+    __atomic_store_n(&klog_head, klog_head + need, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&klog_lock, flags);
+
+    if (!klog_deferred || level == KLOG_ERR) {
+        klog_flush();
+    }
+    return len;
+}
+
+/**
+ * Show every pending message
+ */
+void klog_flush(void) {
+    console_render(UINT32_MAX);
+}
+
+/**
+ * Show the next pending message
+ */
+bool klog_drain_idle(void) {
+    if (__atomic_load_n(&klog_console, __ATOMIC_RELAXED) == __atomic_load_n(&klog_head, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    console_render(1);
+    return true;
+}
+
+/**
+ * Set the least important level the console shows
+ */
+void klog_set_console_level(int level) {
+    if (level >= KLOG_ERR && level <= KLOG_DEBUG) {
+        console_level = level;
+    }
+}
+
+/**
+ * Read a message back from the ring
+ */
+bool klog_read(uint32_t* seq, klog_entry_t* entry, char* text, size_t size) {
+    uint32_t flags = spin_lock_irqsave(&klog_lock);
+    uint32_t want = *seq;
+    if ((int32_t) (want - klog_tail_seq) < 0) {
+        want = klog_tail_seq;   /* Overwritten already: continue with the oldest left */
+    }
+    if ((int32_t) (want - klog_next_seq) >= 0) {
+        spin_unlock_irqrestore(&klog_lock, flags);
+        return false;
+    }
+    klog_header_t header;
+    uint32_t pos = klog_tail;
+    for (uint32_t s = klog_tail_seq; s != want; s++) {
+        ring_copy_out(pos, &header, sizeof(header));
+        pos += record_size(header.len);
+    }
+    ring_copy_out(pos, &header, sizeof(header));
+    size_t copied = 0;
+    if (size > 0) {
+        copied = header.len < size - 1 ? header.len : size - 1;
+        ring_copy_out(pos + sizeof(header), text, copied);
+        text[copied] = '\0';
+    }
+    spin_unlock_irqrestore(&klog_lock, flags);
+    entry->seq = header.seq;
+    entry->time_ns = header.time_ns;
+    entry->level = header.level;
+    entry->len = header.len;
+    *seq = want + 1;
+    return true;
+}
+
+/**
+ * Name of a level
+ */
+const char* klog_level_name(int level) {
+    return level >= KLOG_ERR && level <= KLOG_DEBUG ? klog_level_names[level] : "?";
+}
+
+/**
+ * Get log statistics
+ */
+void klog_get_stats(klog_stats_t* stats) {
+    uint32_t flags = spin_lock_irqsave(&klog_lock);
+    stats->records = klog_next_seq - klog_tail_seq;
+    stats->next_seq = klog_next_seq;
+    stats->pending = klog_next_seq - klog_console_seq;
+    stats->dropped = klog_dropped;
+    stats->console_level = console_level;
+    stats->deferred = klog_deferred;
+    spin_unlock_irqrestore(&klog_lock, flags);
+}
+
+/**
+ * Shell command: dmesg
+ *
+ * Replays the kernel log ring, with the time of each message since boot:
+ *   dmesg           every message still in the ring
+ *   dmesg <level>   only messages at err, warn, info or debug and more important ones
+ *
+ * @param args Command arguments
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(dmesg, "kernel log [err | warn | info | debug]") {
+    int max_level = KLOG_DEBUG;
+    if (args[1] != NULL) {
+        for (max_level = KLOG_ERR; max_level <= KLOG_DEBUG; max_level++) {
+            if (strcmp(args[1], klog_level_name(max_level)) == 0) {
+                break;
+            }
+        }
+        if (max_level > KLOG_DEBUG) {
+            printf("usage: dmesg [err | warn | info | debug]\n");
+            return 1;
+        }
+    }
+    static char text[KLOG_LINE_MAX];
+    klog_entry_t entry;
+    uint32_t seq = 0;
+    while (klog_read(&seq, &entry, text, sizeof(text))) {
+        if (entry.level > max_level) {
+            continue;
+        }
+        /* [seconds.microseconds], the fraction zero-padded to 6 digits */
+        uint64_t us = entry.time_ns / 1000;
+        char frac[7];
+        uint32_t rest = (uint32_t) (us % 1000000);
+        for (int i = 5; i >= 0; i--) {
+            frac[i] = (char) ('0' + rest % 10);
+            rest /= 10;
+        }
+        frac[6] = '\0';
+        size_t len = strlen(text);
+        printf("[%u.%s] %s%s", (uint32_t) (us / 1000000), frac, text, len > 0 && text[len - 1] == '\n' ? "" : "\n");
+    }
+    klog_stats_t stats;
+    klog_get_stats(&stats);
+    if (stats.dropped > 0) {
+        printf("(%u messages were overwritten before the console showed them)\n", stats.dropped);
+    }
+    return 1;
+}
@@ -0,0 +1,176 @@
+/**
+ * In-Kernel Test Runner
+ *
+ *   kernel_main() → ktest_main(mbi) → "ktest=..." on the command line?
+ *     no  → return, boot goes on to the shell
+ *     yes → for each test in .ktest the selection names:
+ *             KTEST_BEGIN → func() → KTEST_PASS / KTEST_FAIL
+ *           → KTEST_DONE → isa-debug-exit
+ *
+ * The linker script gathers the ktest_t entries into one array, so the
+ * runner walks __ktest_start .. __ktest_end in link order.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/ktest.h>
+#include <kernel/paging.h>
+#include <kernel/serial.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+#include <kernel/initcall.h>
+
+#define KTEST_EXIT_PORT         0xf4    /* QEMU isa-debug-exit: exits with (value << 1) | 1 */
+#define KTEST_SELECTION_MAX     512
+
+extern const ktest_t __ktest_start[];
+extern const ktest_t __ktest_end[];
+
+static const ktest_t* ktest_current = NULL;
+static bool ktest_failed = false;
+static char ktest_selection[KTEST_SELECTION_MAX];
+
+/**
+ * Check whether one comma-separated item selects a test
+ */
+static bool item_selects(const char* item, size_t len, const ktest_t* test) {
+    size_t suite_len = strlen(test->suite);
+    if (len == 3 && memcmp(item, "all", 3) == 0) {
+        return true;
+    }
+    if (len < suite_len || memcmp(item, test->suite, suite_len) != 0) {
+        return false;
+    }
+    if (len == suite_len) {
+        return true;    /* The whole suite */
+    }
+    return item[suite_len] == '_' && len - suite_len - 1 == strlen(test->name) &&
+           memcmp(item + suite_len + 1, test->name, len - suite_len - 1) == 0;
+}
+
+/**
+ * Check whether a selection names a test
+ */
+static bool selects(const char* selection, const ktest_t* test) {
+    while (*selection != '\0') {
+        const char* end = strchr(selection, ',');
+        size_t len = end != NULL ? (size_t) (end - selection) : strlen(selection);
+        if (item_selects(selection, len, test)) {
+            return true;
+        }
+        selection += end != NULL ? len + 1 : len;
+    }
+    return false;
+}
+
+/**
+ * Find the value of a "key=" option in the command line
+ *
+ * @return Length copied into value, or -1 if the option is missing
+ */
+static int cmdline_option(multiboot_info_t* mbi, const char* key, char* value, size_t size) {
+    if (!(mbi->flags & MULTIBOOT_INFO_CMDLINE) || mbi->cmdline == 0 || mbi->cmdline >= KMEM_MAX) {
+        return -1;
+    }
+    size_t key_len = strlen(key);
+    const char* word = (const char*) mbi->cmdline;
+    while (*word != '\0') {
+        while (*word == ' ') {
+            word++;
+        }
+        size_t len = 0;
+        while (word[len] != '\0' && word[len] != ' ') {
+            len++;
+        }
+        if (len >= key_len && memcmp(word, key, key_len) == 0) {
+            size_t copied = len - key_len < size - 1 ? len - key_len : size - 1;
+            memcpy(value, word + key_len, copied);
+            value[copied] = '\0';
+            return (int) copied;
+        }
+        word += len;
+    }
+    return -1;
+}
+
+/**
+ * Report a failed expectation
+ */
+void ktest_fail(const char* file, int line, const char* condition) {
+    ktest_failed = true;
+    if (ktest_current != NULL) {
+        serial_printf(SERIAL_COM1_BASE, "KTEST_FAIL %s_%s %s:%d: %s\n", ktest_current->suite, ktest_current->name,
+                      file, line, condition);
+    }
+}
+
+/**
+ * Run the tests a selection names
+ */
+uint32_t ktest_run(const char* selection) {
+    uint32_t passed = 0, failed = 0;
+    for (const ktest_t* test = __ktest_start; test < __ktest_end; test++) {
+        if (!selects(selection, test)) {
+            continue;
+        }
+        serial_printf(SERIAL_COM1_BASE, "KTEST_BEGIN %s_%s\n", test->suite, test->name);
+        ktest_current = test;
+        ktest_failed = false;
+        uint64_t start = ktime_ns();
+        int result = test->func();
+        uint32_t us = (uint32_t) ((ktime_ns() - start) / 1000);
+        /* Output of the test itself goes first */
+        klog_flush();
+        if (result == 0 && !ktest_failed) {
+            serial_printf(SERIAL_COM1_BASE, "KTEST_PASS %s_%s %u us\n", test->suite, test->name, us);
+            passed++;
+        }
+        else {
+            if (!ktest_failed) {
+                serial_printf(SERIAL_COM1_BASE, "KTEST_FAIL %s_%s returned %d\n", test->suite, test->name, result);
+            }
+            failed++;
+        }
+        ktest_current = NULL;
+    }
+    serial_printf(SERIAL_COM1_BASE, "KTEST_DONE passed=%u failed=%u\n", passed, failed);
+    return failed;
+}
+
+/**
+ * Number of tests built into the kernel
+ */
+size_t ktest_count(void) {
+    return (size_t) (__ktest_end - __ktest_start);
+}
+
+/**
+ * Run the tests the "ktest=" option of the command line selects
+ */
+int ktest_main(multiboot_info_t* mbi) {
+    if (cmdline_option(mbi, "ktest=", ktest_selection, sizeof(ktest_selection)) < 0) {
+        return -1;
+    }
+    /* Tests get the whole kernel, the stages boot left running in threads included */
+    initcall_wait_deferred();
+    klog_flush();
+    uint32_t failed = 0;
+    if (strcmp(ktest_selection, "list") == 0) {
+        for (const ktest_t* test = __ktest_start; test < __ktest_end; test++) {
+            serial_printf(SERIAL_COM1_BASE, "KTEST_LIST %s_%s\n", test->suite, test->name);
+        }
+    }
+    else {
+        failed = ktest_run(ktest_selection);
+    }
+    uint32_t code = failed > 0 ? 1 : 0;
+    serial_flush(SERIAL_COM1_BASE);
+    asm volatile("outl %0, %1" :: "a"(code), "Nd"((uint16_t) KTEST_EXIT_PORT));
+    /* No isa-debug-exit device: stay here, the results are on COM1 */
+    while (1) {
+        asm volatile("cli; hlt");
+    }
+}
@@ -0,0 +1,128 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/module.h>
+#include <kernel/paging.h>
+#include <kernel/klog.h>
+
+/**
+ * Boot Modules
+ *
+ * Modules are mapped back to back in the module window, page by page:
+ *
+ *   module_register("init", 0x0012B400, 0x1800)
+ *     frames 0x0012B000, 0x0012C000 → 0xE0400000, 0xE0401000
+ *     data = 0xE0400400 (keeps the offset inside the first page)
+ */
+
+static module_t modules[MODULE_MAX];
+static uint32_t num_modules = 0;
+/* Next free page of the module window */
+static uint32_t module_window_next = MODULE_VIRT_START;
+
+/**
+ * Map and record a module
+ */
+const module_t* module_register(const char* name, uint32_t phys, size_t size) {
+    if (num_modules == MODULE_MAX) {
+        klog(KLOG_ERR, "[FAILED] module_register: Module table full (max %u)\n", MODULE_MAX);
+        return NULL;
+    }
+    uint32_t first = phys & ~(PAGE_SIZE - 1);
+    uint32_t span = ((phys + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1)) - first;
+    if (size == 0 || phys + size < phys || span > MODULE_VIRT_END - module_window_next) {
+        klog(KLOG_ERR, "[FAILED] module_register: No room to map '%s' (%zu bytes)\n", name, size);
+        return NULL;
+    }
+    for (uint32_t off = 0; off < span; off += PAGE_SIZE) {
+        if (paging_map(module_window_next + off, first + off, 0) != 0) {
+            /* Leave the window cursor alone; the partial mapping is just unused */
+            return NULL;
+        }
+    }
+    module_t* mod = &modules[num_modules++];
+    snprintf(mod->name, MODULE_NAME_MAX, "%s", name);
+    mod->phys = phys;
+    mod->data = (const void*) (module_window_next + (phys - first));
+    mod->size = size;
+    module_window_next += span;
+    return mod;
+}
+
+/**
+ * Module name from its command line: basename of the first word
+ */
+static void module_name(uint32_t cmdline, uint32_t index, char* name) {
+    /* Command lines outside the identity map can't be read any more */
+    if (cmdline == 0 || cmdline >= KMEM_MAX) {
+        snprintf(name, MODULE_NAME_MAX, "module%u", index);
+        return;
+    }
+    const char* start = (const char*) cmdline;
+    const char* end = start;
+    while (*end != '\0' && *end != ' ') {
+        if (*end++ == '/') {
+            start = end;
+        }
+    }
+    size_t len = (size_t) (end - start);
+    if (len == 0) {
+        snprintf(name, MODULE_NAME_MAX, "module%u", index);
+        return;
+    }
+    if (len >= MODULE_NAME_MAX) {
+        len = MODULE_NAME_MAX - 1;
+    }
+    memcpy(name, start, len);
+    name[len] = '\0';
+}
+
+/**
+ * Map the multiboot modules and record them
+ */
+void module_init(multiboot_info_t* mbi) {
+    if (mbi == NULL || !(mbi->flags & MULTIBOOT_INFO_MODS) || mbi->mods_count == 0) {
+        return;
+    }
+    if (mbi->mods_addr >= KMEM_MAX) {
+        klog(KLOG_ERR, "[FAILED] module_init: Module list at %p is not identity mapped\n", mbi->mods_addr);
+        return;
+    }
+    multiboot_module_t* mods = (multiboot_module_t*) mbi->mods_addr;
+    for (uint32_t i = 0; i < mbi->mods_count; i++) {
+        char name[MODULE_NAME_MAX];
+        module_name(mods[i].cmdline, i, name);
+        const module_t* mod = module_register(name, mods[i].mod_start, mods[i].mod_end - mods[i].mod_start);
+        if (mod != NULL) {
+            klog(KLOG_INFO, "[  OK  ] Module '%s' at %p (%zu bytes)\n", mod->name, mod->phys, mod->size);
+        }
+    }
+}
+
+/**
+ * Find a module by name
+ */
+const module_t* module_find(const char* name) {
+    for (uint32_t i = 0; i < num_modules; i++) {
+        if (strcmp(modules[i].name, name) == 0) {
+            return &modules[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Number of registered modules
+ */
+uint32_t module_count(void) {
+    return num_modules;
+}
+
+/**
+ * Get a module by index
+ */
+const module_t* module_get(uint32_t index) {
+    return index < num_modules ? &modules[index] : NULL;
+}
@@ -0,0 +1,220 @@
+/**
+ * Network Device Registry and Packet Buffer Pool
+ *
+ * The pool's memory is taken in chunks of 2^NETBUF_CHUNK_ORDER frames and
+ * mapped once; every descriptor keeps the physical address of its buffer,
+ * so netbuf_phys() needs no page walk.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/net.h>
+#include <kernel/paging.h>
+#include <kernel/spinlock.h>
+#include <kernel/klog.h>
+
+#define NETBUF_CHUNK_ORDER      4       /* 64 KiB, 32 buffers */
+#define NETBUF_PER_CHUNK        (((1u << NETBUF_CHUNK_ORDER) * PAGE_SIZE) / NETBUF_SIZE)
+
+static netbuf_t netbufs[NETBUF_POOL_SIZE];
+static netbuf_t* netbuf_free_list = NULL;
+static uint32_t netbuf_free_count = 0;
+static spinlock_t netbuf_lock = SPINLOCK_INIT;
+
+static net_device_t* net_devices = NULL;
+static uint32_t net_device_count = 0;
+static spinlock_t net_devices_lock = SPINLOCK_INIT;
+
+/**
+ * Fill the packet buffer pool
+ */
+int net_init(void) {
+    if (netbuf_free_count > 0) {
+        return 0;
+    }
+    uint32_t count = 0;
+    while (count < NETBUF_POOL_SIZE) {
+        uint32_t phys = frame_alloc_order(NETBUF_CHUNK_ORDER);
+        uint8_t* virt = phys != 0 ? paging_map_physical(phys, NETBUF_PER_CHUNK * NETBUF_SIZE, PTE_WRITABLE) : NULL;
+        if (virt == NULL) {
+            if (phys != 0) {
+                frame_free_order(phys, NETBUF_CHUNK_ORDER);
+            }
+            break;
+        }
+        for (uint32_t i = 0; i < NETBUF_PER_CHUNK && count < NETBUF_POOL_SIZE; i++, count++) {
+            netbuf_t* nb = &netbufs[count];
+            nb->head = virt + i * NETBUF_SIZE;
+            nb->phys = phys + i * NETBUF_SIZE;
+            nb->next = netbuf_free_list;
+            netbuf_free_list = nb;
+        }
+    }
+    netbuf_free_count = count;
+    if (count == 0) {
+        klog(KLOG_ERR, "[FAILED] net_init: No memory for packet buffers\n");
+        return -1;
+    }
+    klog(KLOG_INFO, "[  OK  ] Packet buffer pool initialized (%u buffers)\n", count);
+    return 0;
+}
+
+/**
+ * Take a packet buffer
+ */
+netbuf_t* netbuf_alloc(void) {
+    uint32_t flags = spin_lock_irqsave(&netbuf_lock);
+    netbuf_t* nb = netbuf_free_list;
+    if (nb != NULL) {
+        netbuf_free_list = nb->next;
+        netbuf_free_count--;
+    }
+    spin_unlock_irqrestore(&netbuf_lock, flags);
+    if (nb != NULL) {
+        nb->data = nb->head + NETBUF_HEADROOM;
+        nb->len = 0;
+        nb->dev = NULL;
+        nb->next = NULL;
+    }
+    return nb;
+}
+
+/**
+ * Give a packet buffer back
+ */
+void netbuf_free(netbuf_t* nb) {
+    uint32_t flags = spin_lock_irqsave(&netbuf_lock);
+    nb->next = netbuf_free_list;
+    netbuf_free_list = nb;
+    netbuf_free_count++;
+    spin_unlock_irqrestore(&netbuf_lock, flags);
+}
+
+/**
+ * Packet buffers left in the pool
+ */
+uint32_t netbuf_available(void) {
+    return __atomic_load_n(&netbuf_free_count, __ATOMIC_RELAXED);
+}
+
+/**
+ * Add a network device
+ */
+int net_register(net_device_t* dev) {
+    if (dev->ops == NULL || dev->ops->xmit == NULL) {
+        return -1;
+    }
+    spin_lock_init(&dev->lock);
+    memset(&dev->stats, 0, sizeof(dev->stats));
+    if (dev->mtu == 0) {
+        dev->mtu = NET_ETH_MTU;
+    }
+    uint32_t flags = spin_lock_irqsave(&net_devices_lock);
+    uint32_t index = net_device_count++;
+    dev->name[0] = 'e';
+    dev->name[1] = 't';
+    dev->name[2] = 'h';
+    dev->name[3] = (char) ('0' + index);
+    dev->name[4] = '\0';
+    dev->next = NULL;
+    net_device_t** link = &net_devices;
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    *link = dev;
+    spin_unlock_irqrestore(&net_devices_lock, flags);
+    return 0;
+}
+
+/**
+ * Find a device by name
+ */
+net_device_t* net_find(const char* name) {
+    uint32_t flags = spin_lock_irqsave(&net_devices_lock);
+    net_device_t* dev = net_devices;
+    while (dev != NULL && strcmp(dev->name, name) != 0) {
+        dev = dev->next;
+    }
+    spin_unlock_irqrestore(&net_devices_lock, flags);
+    return dev;
+}
+
+/**
+ * Get the index-th device
+ */
+net_device_t* net_get(uint32_t index) {
+    uint32_t flags = spin_lock_irqsave(&net_devices_lock);
+    net_device_t* dev = net_devices;
+    while (dev != NULL && index-- > 0) {
+        dev = dev->next;
+    }
+    spin_unlock_irqrestore(&net_devices_lock, flags);
+    return dev;
+}
+
+/**
+ * Set a device's rx handler
+ */
+void net_set_rx_handler(net_device_t* dev, net_rx_fn rx) {
+    __atomic_store_n(&dev->rx, rx, __ATOMIC_RELEASE);
+}
+
+/**
+ * Send a frame
+ */
+int net_transmit(net_device_t* dev, netbuf_t* nb) {
+    uint32_t len = nb->len;
+    if (len < NET_ETH_HLEN || len > (uint32_t) dev->mtu + NET_ETH_HLEN) {
+        netbuf_free(nb);
+        uint32_t flags = spin_lock_irqsave(&dev->lock);
+        dev->stats.tx_dropped++;
+        spin_unlock_irqrestore(&dev->lock, flags);
+        return -1;
+    }
+    int result = dev->ops->xmit(dev, nb);
+    uint32_t flags = spin_lock_irqsave(&dev->lock);
+    if (result == 0) {
+        dev->stats.tx_packets++;
+        dev->stats.tx_bytes += len;
+    }
+    else {
+        dev->stats.tx_dropped++;
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return result;
+}
+
+/**
+ * Hand a received frame to the rx handler
+ */
+void net_receive(net_device_t* dev, netbuf_t* nb) {
+    net_rx_fn rx = __atomic_load_n(&dev->rx, __ATOMIC_ACQUIRE);
+    uint32_t flags = spin_lock_irqsave(&dev->lock);
+    if (rx != NULL) {
+        dev->stats.rx_packets++;
+        dev->stats.rx_bytes += nb->len;
+    }
+    else {
+        dev->stats.rx_dropped++;
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
+    nb->dev = dev;
+    if (rx != NULL) {
+        rx(dev, nb);
+    }
+    else {
+        netbuf_free(nb);
+    }
+}
+
+/**
+ * Copy a device's counters
+ */
+void net_get_stats(net_device_t* dev, net_stats_t* stats) {
+    uint32_t flags = spin_lock_irqsave(&dev->lock);
+    *stats = dev->stats;
+    spin_unlock_irqrestore(&dev->lock, flags);
+}
@@ -8,6 +8,19 @@
 #include <kernel/paging.h>
 #include <kernel/interrupts.h>
 #include <kernel/debug.h>
+#include <kernel/vmm.h>
+#include <kernel/kheap.h>
+#include <kernel/process.h>
+#include <kernel/trace.h>
+#include <kernel/spinlock.h>
+#include <kernel/klog.h>
+#include <kernel/crashdump.h>
+#include <kernel/smp.h>
+
+#include "include/cpuid.h"
+#include "include/irqflags.h"
+#include "include/percpu.h"
+#include "include/apic.h"
 
 /**
  * Ultra-Simple Page Frame Allocator & Paging
@@ -34,24 +47,140 @@
  * 
  * Implementation details:
  * - Statically allocate page directory and tables (no dynamic allocation)
- * - Bitmap for frame allocation (first - fit algorithm)
- * - Identity map kernel region (0x0 - KMEM_MAX = 8MB)
- * - Unmapped addresses trigger page faults (ISR #14)
+ * - Bitmap tracking used frames, plus buddy free lists for (multi-)frame allocation
+ * - Identity map kernel region (0x0 - KMEM_MAX = 8MB) with 4 MiB PSE pages when the
+ *   CPU supports them, else with 4 KiB page tables
+ * - Kernel mappings are global (CR4.PGE) so they survive CR3 reloads
+ * - The last PDE points back at the page directory (recursive mapping), so every
+ *   page table is reachable at PAGE_TABLES_VIRT once paging is on, wherever its
+ *   frame lives in physical memory
+ * - Up to FRAME_ZERO_POOL frames are kept allocated but already zeroed: the
+ *   idle thread fills the pool, frame_alloc_zeroed() takes from it, and
+ *   frame_alloc_order() hands it back to the buddy lists before failing
+ * - After that, the page cache is asked to evict clean pages (frame_set_reclaim())
+ * - Unmapped addresses trigger page faults (ISR #14); faults inside regions
+ *   reserved with vmm_reserve() are backed on demand, anything else panics
+ *   (or, from ring 3, kills the process)
+ *
+ * Address spaces:
+ *
+ *   PD[0 .. 255]      kernel  identity map, ...          shared
+ *   PD[256 .. 767]    user    0x40000000 - 0xBFFFFFFF    private per process
+ *   PD[768 .. 1022]   kernel  heap, scratch pages, ...   shared
+ *   PD[1023]          recursive slot                     points at its own directory
+ *
+ * A kernel PDE is the same page table in every directory, so a mapping added
+ * below it shows up everywhere. kernel_page_directory is the master copy: a
+ * new kernel page table goes there first (under pde_lock, so two CPUs can't
+ * each make one) and reaches other directories when they are created, or on
+ * their first fault in that range.
+ *
+ * Every CPU has its own TLB. Removing a mapping, or taking rights away from
+ * it, also has to flush the other CPUs that may have cached it before the
+ * frame is reused: see tlb_shootdown().
  */
 
 /* External variable from debug.c marking where kernel sections end */
 extern uint32_t elf_sections_end;
 
+/* Linker symbol marking the end of the kernel image */
+extern uint32_t _kernel_sections_end;
+
 /* Page directory (1024 entries = 4KB) - statically allocated */
 static page_directory_t kernel_page_directory __attribute__((aligned(4096)));
 
-/* Page tables for kernel identity mapping
+/* Number of page directory entries covering the kernel region (each maps 4MB) */
+#define KERNEL_PDE_COUNT    (KMEM_MAX / LARGE_PAGE_SIZE)
+
+/* Page tables for kernel identity mapping, only used without PSE
  * We need 2 tables to map 8MB (0x0 - 0x800000)
- * Each table maps 4MB (1024 pages * 4KB) */
-static page_table_t kernel_page_tables[2] __attribute__((aligned(4096)));
+ * Each table maps 4MB (1024 pages * 4KB)
+ * Carved from boot memory by frame_bitmap_init() instead of being static */
+static page_table_t* kernel_page_tables = NULL;
+
+/* Map the kernel region with 4 MiB pages (CPUID.PSE) */
+static bool pse_enabled = false;
 
-/* Frame bitmap: 1 bit per 4KB frame (0=free, 1=used) */
-static uint32_t frame_bitmap[NUM_FRAMES / 32];
+/* Mark kernel mappings global (CPUID.PGE) */
+static bool pge_enabled = false;
+
+/**
+ * Recursive mapping
+ *
+ * PD[1023] points to the page directory itself, so the MMU treats the page
+ * directory as the page table for the top 4MB of virtual memory:
+ *   0xFFC00000 + pd_idx * 4KB → page table for PD index pd_idx
+ *   0xFFFFF000               → the page directory itself
+ */
+#define RECURSIVE_PDE_INDEX 1023
+#define PAGE_TABLES_VIRT    0xFFC00000
+#define PAGE_DIR_VIRT       0xFFFFF000
+
+/* Kernel-only pages right below the page table window for touching frames outside the identity map */
+#define PAGING_SCRATCH_VIRT 0xFF800000
+#define SCRATCH_SLOTS       3       /* Per CPU, which only flushes its own: SCRATCH_SLOTS * SMP_MAX_CPUS pages */
+#define SCRATCH_SLOT_ZERO   2       /* Slots 0 and 1 are taken by directory and table copies */
+
+/* First and one-past-last PDE of the per-address-space user range */
+#define USER_PDE_FIRST      (USER_SPACE_START >> 22)
+#define USER_PDE_END        (USER_SPACE_END >> 22)
+
+/* Set once the kernel heap's page tables exist in the master directory */
+static bool kernel_tables_shared = false;
+
+/* Serializes creating page tables, and with them kernel_page_directory's entries */
+static spinlock_t pde_lock = SPINLOCK_INIT;
+
+/* Above this many pages, paging_flush_range() flushes the whole TLB instead */
+#define TLB_FLUSH_THRESHOLD 32
+
+/* Number of physical frames managed (sized from the multiboot memory map) */
+static uint32_t num_frames = 0;
+
+/* Frame bitmap: 1 bit per 4KB frame (0=free, 1=used), placed at boot after the kernel */
+static uint32_t* frame_bitmap = NULL;
+
+/* Extra references per frame (0 = one owner), for pages shared copy-on-write between address spaces */
+static uint16_t* frame_refs = NULL;
+#define FRAME_REFS_MAX      0xFFFF
+
+/* Guards the bitmap, buddy lists and reference counts; taken with interrupts off since fault handlers allocate */
+static spinlock_t frame_lock = SPINLOCK_INIT;
+
+/* Frames zeroed ahead of time (physical addresses), a stack under frame_lock */
+static uint32_t zero_pool[FRAME_ZERO_POOL];
+static uint32_t zero_pool_count = 0;
+
+/* Zero pool frames with movnti (SSE2) instead of cached stores */
+static bool zero_nontemporal = false;
+
+/* End of memory reserved at boot (kernel, modules, allocator metadata) */
+uint32_t frame_reserved_end = 0;
+
+/**
+ * Buddy allocator state
+ *
+ * Free memory is kept as blocks of 2^order frames, aligned to their size. Each
+ * order has a bitmap with one bit per aligned block (1 = free block starts
+ * here). A block's buddy is the block it was split from:
+ * buddy = frame ^ (1 << order), so checking it on free is a single bit test.
+ * Free blocks are found a word at a time from a rotating per-order hint,
+ * skipping empty words.
+ *
+ * The bitmaps take about 2 bits per frame in total (vs. 9 bytes per frame for
+ * linked free lists), so they scale with the memory found at boot and still
+ * fit in the identity-mapped region. Frames above KMEM_MAX are not mapped
+ * and can't hold list links themselves.
+ *
+ * Based on: https://www.kernel.org/doc/gorman/html/understand/understand009.html
+ */
+static uint32_t* buddy_free_map[FRAME_MAX_ORDER + 1];
+static uint32_t buddy_map_words[FRAME_MAX_ORDER + 1];
+static uint32_t buddy_hint[FRAME_MAX_ORDER + 1];
+static uint32_t buddy_free_count[FRAME_MAX_ORDER + 1];
+
+/* Frames the buddy lists started out with; the rest are holes or reserved at boot */
+static uint32_t frames_usable = 0;
 
 /**
  * Bitmap helper functions (inline for performance)
@@ -74,19 +203,409 @@ static inline void frame_clear(uint32_t frame_num) {
     frame_bitmap[idx] &= ~(1 << bit);
 }
 
+static inline void frame_set_range(uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        frame_set(first + i);
+    }
+}
+
+static inline void frame_clear_range(uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        frame_clear(first + i);
+    }
+}
+
+/**
+ * Is a free block of this order starting at frame_num?
+ */
+static inline bool buddy_is_free(uint32_t frame_num, uint32_t order) {
+    uint32_t block = frame_num >> order;
+    if (block / 32 >= buddy_map_words[order]) {
+        return false;
+    }
+    return (buddy_free_map[order][block / 32] & (1u << (block % 32))) != 0;
+}
+
+/**
+ * Record a free block of 2^order frames starting at frame_num
+ */
+static void buddy_mark_free(uint32_t frame_num, uint32_t order) {
+    uint32_t block = frame_num >> order;
+    buddy_free_map[order][block / 32] |= (1u << (block % 32));
+    buddy_free_count[order]++;
+}
+
+/**
+ * Remove a free block from its order's bitmap
+ */
+static void buddy_mark_taken(uint32_t frame_num, uint32_t order) {
+    uint32_t block = frame_num >> order;
+    buddy_free_map[order][block / 32] &= ~(1u << (block % 32));
+    buddy_free_count[order]--;
+}
+
+/**
+ * Find a free block of exactly this order (caller checks buddy_free_count)
+ *
+ * @return First frame of the block
+ */
+static uint32_t buddy_find(uint32_t order) {
+    uint32_t* map = buddy_free_map[order];
+    uint32_t words = buddy_map_words[order];
+    for (uint32_t n = 0; n < words; n++) {
+        uint32_t idx = (buddy_hint[order] + n) % words;
+        if (map[idx] != 0) {
+            buddy_hint[order] = idx;
+            return (idx * 32 + __builtin_ctz(map[idx])) << order;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Check whether frames [first, first + count) are all free in the bitmap
+ */
+static bool frame_range_free(uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (frame_test(first + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Build the buddy bitmaps from the frame bitmap
+ *
+ * Every run of free frames is split into the largest aligned blocks that fit.
+ *
+ * Example: frames 0-299 used by the kernel, 300-32767 free
+ *   300 (order 2), 304 (order 4), 320 (order 6), 384 (order 7), 512 (order 9),
+ *   1024 (order 10), 2048 (order 10), ...
+ */
+static void buddy_init(void) {
+    for (uint32_t i = 0; i <= FRAME_MAX_ORDER; i++) {
+        memset(buddy_free_map[i], 0, buddy_map_words[i] * sizeof(uint32_t));
+        buddy_hint[i] = 0;
+        buddy_free_count[i] = 0;
+    }
+    frames_usable = 0;
+    uint32_t frame_num = 0;
+    while (frame_num < num_frames) {
+        if (frame_test(frame_num)) {
+            frame_num++;
+            continue;
+        }
+        uint32_t order = FRAME_MAX_ORDER;
+        while (order > 0 && ((frame_num & ((1u << order) - 1)) != 0 ||
+                             frame_num + (1u << order) > num_frames ||
+                             !frame_range_free(frame_num, 1u << order))) {
+            order--;
+        }
+        buddy_mark_free(frame_num, order);
+        frame_num += 1u << order;
+        frames_usable += 1u << order;
+    }
+}
+
+/**
+ * Find the top of usable physical memory
+ *
+ * Uses the multiboot memory map if present, else mem_upper, else 128 MiB.
+ * Memory above 4 GiB is ignored (no PAE).
+ *
+ * @return Number of frames up to the highest available address
+ */
+static uint32_t detect_memory_frames(multiboot_info_t* mbi) {
+    uint64_t top = DEFAULT_PHYS_MEMORY;
+    if (mbi && (mbi->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        top = 0;
+        uint32_t mmap_end = mbi->mmap_addr + mbi->mmap_length;
+        multiboot_memory_map_t* entry = (multiboot_memory_map_t*) mbi->mmap_addr;
+        while ((uint32_t) entry < mmap_end) {
+            if (entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->addr + entry->len > top) {
+                top = entry->addr + entry->len;
+            }
+            /* 'size' does not count itself */
+            entry = (multiboot_memory_map_t*) ((uint32_t) entry + entry->size + sizeof(entry->size));
+        }
+    }
+    else if (mbi && (mbi->flags & MULTIBOOT_INFO_MEMORY)) {
+        /* mem_upper: KiB of memory starting at 1 MiB */
+        top = 0x100000 + (uint64_t) mbi->mem_upper * 1024;
+    }
+    if (top > MAX_PHYS_MEMORY) {
+        top = MAX_PHYS_MEMORY;
+    }
+    return (uint32_t) (top >> 12);
+}
+
+/**
+ * Mark frames fully inside [addr, addr + len) as free, or partially covered
+ * frames too as used
+ */
+static void frame_mark_region(uint64_t addr, uint64_t len, bool available) {
+    uint64_t end = addr + len;
+    if (addr >= (uint64_t) num_frames * FRAME_SIZE) {
+        return;
+    }
+    if (end > (uint64_t) num_frames * FRAME_SIZE) {
+        end = (uint64_t) num_frames * FRAME_SIZE;
+    }
+    if (available) {
+        /* Only whole frames are usable: round start up, end down */
+        uint32_t first = (uint32_t) ((addr + FRAME_SIZE - 1) >> 12);
+        uint32_t last = (uint32_t) (end >> 12);
+        if (first < last) {
+            frame_clear_range(first, last - first);
+        }
+    }
+    else {
+        /* Any frame touching a reserved range is unusable: round start down, end up */
+        uint32_t first = (uint32_t) (addr >> 12);
+        uint32_t last = (uint32_t) ((end + FRAME_SIZE - 1) >> 12);
+        frame_set_range(first, last - first);
+    }
+}
+
+/**
+ * Extend the boot reservation to cover [addr, addr + len) if it lies past it
+ *
+ * The bootloader may place multiboot structures and modules right after the
+ * kernel, where the bitmaps would otherwise go. Ranges ending above KMEM_MAX
+ * can't hold the bitmaps anyway; frame_reserve_range() keeps them used.
+ */
+static void frame_reserve_boot_range(uint32_t addr, uint32_t len) {
+    if (addr + len > frame_reserved_end && addr + len <= KMEM_MAX) {
+        frame_reserved_end = addr + len;
+    }
+}
+
+/**
+ * Mark the frames of [addr, addr + len) as used, wherever they are
+ */
+static void frame_reserve_range(uint32_t addr, uint32_t len) {
+    frame_mark_region(addr, len, false);
+}
+
+/**
+ * Call reserve() on everything the bootloader handed us: the multiboot
+ * structure, command lines, the memory map, the module list and the modules
+ *
+ * Runs before paging is enabled, so command lines above KMEM_MAX can still be read.
+ */
+static void frame_boot_ranges(multiboot_info_t* mbi, void (*reserve)(uint32_t addr, uint32_t len)) {
+    reserve((uint32_t) mbi, sizeof(multiboot_info_t));
+    if (mbi->flags & MULTIBOOT_INFO_CMDLINE) {
+        reserve(mbi->cmdline, strlen((const char*) mbi->cmdline) + 1);
+    }
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        reserve(mbi->mmap_addr, mbi->mmap_length);
+    }
+    if (mbi->flags & MULTIBOOT_INFO_MODS) {
+        multiboot_module_t* mods = (multiboot_module_t*) mbi->mods_addr;
+        reserve(mbi->mods_addr, mbi->mods_count * sizeof(multiboot_module_t));
+        for (uint32_t i = 0; i < mbi->mods_count; i++) {
+            reserve(mods[i].mod_start, mods[i].mod_end - mods[i].mod_start);
+            if (mods[i].cmdline) {
+                reserve(mods[i].cmdline, strlen((const char*) mods[i].cmdline) + 1);
+            }
+        }
+    }
+}
+
+/**
+ * Carve the allocator's bitmaps out of memory right after the boot reservations
+ */
+static uint32_t* frame_boot_alloc(uint32_t words) {
+    uint32_t* ptr = (uint32_t*) frame_reserved_end;
+    frame_reserved_end += words * sizeof(uint32_t);
+    return ptr;
+}
+
 /**
  * Initialize frame bitmap
- * Mark kernel binary frames as used, leave rest free for allocation
+ *
+ * 1. Size physical memory from the multiboot info
+ * 2. Place the bitmaps after the kernel image and any multiboot modules
+ * 3. Free the ranges the memory map reports as available, then mark every
+ *    other range (reserved, ACPI, bad RAM) as used, so holes stay excluded
+ * 4. Mark everything below frame_reserved_end as used, and every range the
+ *    bootloader handed us wherever it lies
  */
-static void frame_bitmap_init(void) {
-    /* Mark all frames as free initially */
-    memset(frame_bitmap, 0, sizeof(frame_bitmap));
-    /* Calculate how many frames the kernel binary occupies */
-    uint32_t kernel_frames = (elf_sections_end + FRAME_SIZE - 1) / FRAME_SIZE;
-    /* Mark only the kernel binary frames as allocated */
-    for (uint32_t i = 0; i < kernel_frames; i++) {
-        frame_set(i);
+static void frame_bitmap_init(multiboot_info_t* mbi) {
+    num_frames = detect_memory_frames(mbi);
+
+    /* Boot reservations: kernel image and everything the bootloader handed us */
+    frame_reserved_end = elf_sections_end;
+    frame_reserve_boot_range(0, (uint32_t) &_kernel_sections_end);
+    if (mbi) {
+        frame_boot_ranges(mbi, frame_reserve_boot_range);
+    }
+    frame_reserved_end = (frame_reserved_end + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+
+    /* Allocator metadata */
+    uint32_t bitmap_words = (num_frames + 31) / 32;
+    frame_bitmap = frame_boot_alloc(bitmap_words);
+    frame_refs = (uint16_t*) frame_boot_alloc((num_frames + 1) / 2);
+    for (uint32_t i = 0; i <= FRAME_MAX_ORDER; i++) {
+        buddy_map_words[i] = ((num_frames >> i) + 31) / 32;
+        buddy_free_map[i] = frame_boot_alloc(buddy_map_words[i]);
+    }
+    frame_reserved_end = (frame_reserved_end + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+    if (!pse_enabled) {
+        /* 4 KiB identity-map page tables (page-aligned, right after the bitmaps) */
+        kernel_page_tables = (page_table_t*) frame_boot_alloc(KERNEL_PDE_COUNT * 1024);
     }
+    /* Everything the kernel reaches before paging_map() works must be identity-mapped */
+    if (frame_reserved_end > KMEM_MAX) {
+        panic("frame_bitmap_init: Boot data and frame allocator metadata end at %p, past KMEM_MAX",
+              frame_reserved_end);
+    }
+    memset(frame_refs, 0, ((num_frames + 1) / 2) * sizeof(uint32_t));
+
+    if (mbi && (mbi->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        /* Start with everything used, then apply the memory map */
+        memset(frame_bitmap, 0xFF, bitmap_words * sizeof(uint32_t));
+        uint32_t mmap_end = mbi->mmap_addr + mbi->mmap_length;
+        for (int pass = 0; pass < 2; pass++) {
+            multiboot_memory_map_t* entry = (multiboot_memory_map_t*) mbi->mmap_addr;
+            while ((uint32_t) entry < mmap_end) {
+                bool available = entry->type == MULTIBOOT_MEMORY_AVAILABLE;
+                /* Pass 0 frees available ranges, pass 1 re-reserves overlaps */
+                if (available == (pass == 0)) {
+                    frame_mark_region(entry->addr, entry->len, available);
+                }
+                entry = (multiboot_memory_map_t*) ((uint32_t) entry + entry->size + sizeof(entry->size));
+            }
+        }
+    }
+    else {
+        /* Mark all frames as free initially */
+        memset(frame_bitmap, 0, bitmap_words * sizeof(uint32_t));
+    }
+    /* Mark the kernel binary, modules and allocator metadata frames as allocated.
+     * This also covers frame 0, so a physical address of 0 always means failure. */
+    frame_set_range(0, frame_reserved_end / FRAME_SIZE);
+    /* Boot data may also lie above KMEM_MAX, apart from the range above (modules in particular) */
+    if (mbi) {
+        frame_boot_ranges(mbi, frame_reserve_range);
+    }
+    buddy_init();
+}
+
+static void frame_free_locked(uint32_t frame_num, uint32_t order);
+
+/* Frees cached frames when an allocation finds none (kernel/pcache.h) */
+static uint32_t (*frame_reclaim)(uint32_t frames) = NULL;
+
+/**
+ * Register the function that gives back cached frames under memory pressure
+ */
+void frame_set_reclaim(uint32_t (*reclaim)(uint32_t frames)) {
+    __atomic_store_n(&frame_reclaim, reclaim, __ATOMIC_RELEASE);
+}
+
+/**
+ * Take 2^order physically contiguous frames from the buddy lists
+ *
+ * Takes a block from the smallest non-empty order at or above 'order' and
+ * splits it in halves, putting the upper half back each time, until it has
+ * the requested size: O(FRAME_MAX_ORDER) splits.
+ *
+ * Example: frame_alloc_order(0) with only an order-2 block at frame 300 free
+ *   Split 300 (order 2) → 300 (order 1) + 302 (order 1, freed)
+ *   Split 300 (order 1) → 300 (order 0) + 301 (order 0, freed)
+ *   Return frame 300
+ */
+static uint32_t frame_alloc_buddy(uint32_t order) {
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    uint32_t current = order;
+    while (current <= FRAME_MAX_ORDER && buddy_free_count[current] == 0) {
+        current++;
+    }
+    if (current > FRAME_MAX_ORDER && zero_pool_count > 0) {
+        /* Rather give up the pre-zeroed frames than fail */
+        while (zero_pool_count > 0) {
+            frame_free_locked(zero_pool[--zero_pool_count] / FRAME_SIZE, 0);
+        }
+        current = order;
+        while (current <= FRAME_MAX_ORDER && buddy_free_count[current] == 0) {
+            current++;
+        }
+    }
+    if (current > FRAME_MAX_ORDER) {
+        /* Out of memory (or too fragmented for this order) */
+        spin_unlock_irqrestore(&frame_lock, flags);
+        return 0;
+    }
+    uint32_t frame_num = buddy_find(current);
+    buddy_mark_taken(frame_num, current);
+    while (current > order) {
+        current--;
+        buddy_mark_free(frame_num + (1u << current), current);
+    }
+    frame_set_range(frame_num, 1u << order);
+    spin_unlock_irqrestore(&frame_lock, flags);
+    return frame_num * FRAME_SIZE;
+}
+
+/**
+ * Allocate 2^order frames, evicting cached pages once if none are free
+ */
+uint32_t frame_alloc_order(uint32_t order) {
+    if (order > FRAME_MAX_ORDER) {
+        klog(KLOG_ERR, "[FAILED] frame_alloc_order: Invalid order %u (max %u)\n", order, FRAME_MAX_ORDER);
+        return 0;
+    }
+    uint32_t frame = frame_alloc_buddy(order);
+    uint32_t (*reclaim)(uint32_t) = __atomic_load_n(&frame_reclaim, __ATOMIC_ACQUIRE);
+    if (frame == 0 && reclaim != NULL && reclaim(1u << order) > 0) {
+        frame = frame_alloc_buddy(order);
+    }
+    return frame;
+}
+
+/**
+ * frame_free_order() with frame_lock held
+ */
+static void frame_free_locked(uint32_t frame_num, uint32_t order) {
+    frame_clear_range(frame_num, 1u << order);
+    for (uint32_t i = 0; i < (1u << order); i++) {
+        frame_refs[frame_num + i] = 0;
+    }
+    while (order < FRAME_MAX_ORDER) {
+        uint32_t buddy = frame_num ^ (1u << order);
+        if (buddy >= num_frames || !buddy_is_free(buddy, order)) {
+            break;
+        }
+        buddy_mark_taken(buddy, order);
+        frame_num &= ~(1u << order);    /* Merged block starts at the lower half */
+        order++;
+    }
+    buddy_mark_free(frame_num, order);
+}
+
+/**
+ * Free 2^order frames previously allocated with frame_alloc_order()
+ *
+ * Merges the block with its buddy for as long as the buddy is free and of
+ * the same order: O(FRAME_MAX_ORDER).
+ */
+void frame_free_order(uint32_t frame_addr, uint32_t order) {
+    uint32_t frame_num = frame_addr / FRAME_SIZE;
+    if (order > FRAME_MAX_ORDER || frame_num >= num_frames || (frame_num & ((1u << order) - 1)) != 0) {
+        printf("frame_free: Invalid frame address %p (order %u)\n", frame_addr, order);
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    if (!frame_test(frame_num)) {
+        spin_unlock_irqrestore(&frame_lock, flags);
+        klog(KLOG_ERR, "[FAILED] frame_free: Frame %p is already free\n", frame_addr);
+        return;
+    }
+    frame_free_locked(frame_num, order);
+    spin_unlock_irqrestore(&frame_lock, flags);
 }
 
 /**
@@ -94,27 +613,130 @@ static void frame_bitmap_init(void) {
  * Returns physical address of frame, or 0 if none available
  */
 uint32_t frame_alloc(void) {
-    /* Simple first-fit: scan bitmap for first free frame */
-    for (uint32_t i = 0; i < NUM_FRAMES; i++) {
-        if (!frame_test(i)) {
-            frame_set(i);
-            return i * FRAME_SIZE;
-        }
-    }
-    /* Out of memory */
-    return 0;
+    return frame_alloc_order(0);
 }
 
 /**
  * Free a physical frame
  */
 void frame_free(uint32_t frame_addr) {
+    frame_free_order(frame_addr, 0);
+}
+
+/**
+ * Add a reference to an allocated frame
+ */
+int frame_ref(uint32_t frame_addr) {
+    uint32_t frame_num = frame_addr / FRAME_SIZE;
+    int result = -1;
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    if (frame_num < num_frames && frame_test(frame_num) && frame_refs[frame_num] != FRAME_REFS_MAX) {
+        frame_refs[frame_num]++;
+        result = 0;
+    }
+    spin_unlock_irqrestore(&frame_lock, flags);
+    return result;
+}
+
+/**
+ * Drop a reference to a frame, freeing it with the last one
+ */
+void frame_release(uint32_t frame_addr) {
     uint32_t frame_num = frame_addr / FRAME_SIZE;
-    if (frame_num >= NUM_FRAMES) {
-        printf("frame_free: Invalid frame address %p\n", frame_addr);
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    /* Decide and free under one hold, so two last references can't both free the frame */
+    if (frame_num < num_frames && frame_refs[frame_num] > 0) {
+        frame_refs[frame_num]--;
+    }
+    else if (frame_num < num_frames && frame_test(frame_num)) {
+        frame_free_locked(frame_num, 0);
+    }
+    else {
+        spin_unlock_irqrestore(&frame_lock, flags);
+        frame_free(frame_addr);     /* Reports the bad address */
         return;
     }
-    frame_clear(frame_num);
+    spin_unlock_irqrestore(&frame_lock, flags);
+}
+
+/**
+ * Number of references to a frame
+ */
+uint32_t frame_refcount(uint32_t frame_addr) {
+    uint32_t frame_num = frame_addr / FRAME_SIZE;
+    uint32_t count = 0;
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    if (frame_num < num_frames && frame_test(frame_num)) {
+        count = frame_refs[frame_num] + 1u;
+    }
+    spin_unlock_irqrestore(&frame_lock, flags);
+    return count;
+}
+
+/**
+ * Get the number of physical frames detected at boot
+ */
+uint32_t frame_total(void) {
+    return num_frames;
+}
+
+/**
+ * Longest run of free frames in the bitmap (frame_lock held)
+ *
+ * Whole words are counted with one compare; only words with both used and
+ * free frames are walked bit by bit. Bits past num_frames count as used.
+ */
+static uint32_t frame_largest_free_run(void) {
+    uint32_t best = 0;
+    uint32_t run = 0;
+    for (uint32_t first = 0; first < num_frames; first += 32) {
+        uint32_t word = frame_bitmap[first / 32];
+        uint32_t bits = num_frames - first < 32 ? num_frames - first : 32;
+        if (word == 0 && bits == 32) {
+            run += 32;
+            continue;
+        }
+        for (uint32_t bit = 0; bit < bits; bit++) {
+            if (word & (1u << bit)) {
+                best = run > best ? run : best;
+                run = 0;
+            }
+            else {
+                run++;
+            }
+        }
+    }
+    return run > best ? run : best;
+}
+
+/**
+ * Get the frame allocator's counters
+ */
+void frame_get_stats(frame_stats_t* stats) {
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    stats->total = num_frames;
+    stats->reserved = num_frames - frames_usable;
+    stats->free = 0;
+    for (uint32_t order = 0; order <= FRAME_MAX_ORDER; order++) {
+        stats->free_blocks[order] = buddy_free_count[order];
+        stats->free += buddy_free_count[order] << order;
+    }
+    stats->zeroed = zero_pool_count;
+    stats->used = frames_usable - stats->free - stats->zeroed;
+    stats->largest_free_run = frame_largest_free_run();
+    spin_unlock_irqrestore(&frame_lock, flags);
+}
+
+/**
+ * Take a frame from the zeroed pool
+ *
+ * @return Physical address, or 0 if the pool is empty
+ */
+static uint32_t zero_pool_take(void) {
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    uint32_t frame = zero_pool_count > 0 ? zero_pool[--zero_pool_count] : 0;
+    spin_unlock_irqrestore(&frame_lock, flags);
+    return frame;
 }
 
 /**
@@ -158,9 +780,13 @@ static void map_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t ph
      * 
      * Using & ~0xFFF masks off the flag bits to get just the address.
      */
+    if (*pde & PDE_PAGE_SIZE) {
+        klog(KLOG_ERR, "[FAILED] map_page: %p is covered by a 4 MiB page!\n", virt_addr);
+        return;
+    }
     page_table_t* page_table = (page_table_t*) (*pde & ~0xFFF);
     if (!page_table) {
-        printf("[FAILED] map_page: Page table not allocated for index %u!\n", pd_idx);
+        klog(KLOG_ERR, "[FAILED] map_page: Page table not allocated for index %u!\n", pd_idx);
         return;
     }
     
@@ -182,14 +808,33 @@ static void map_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t ph
  *   ...
  *   Virtual 0x7FFFFF → Physical 0x7FFFFF
  * 
+ * With PSE, each PDE maps a whole 4MB page directly (PS bit set, address in
+ * bits 31-22), so no page tables are needed and the kernel region takes
+ * 2 TLB entries instead of 2048:
+ *   PD[0] = 0x000000 | PS | RW | P   covers 0x000000 - 0x3FFFFF
+ *   PD[1] = 0x400000 | PS | RW | P   covers 0x400000 - 0x7FFFFF
+ * 
  * After this function, the page tables are set up but translation is NOT
  * active yet. enable_paging() must be called to activate the MMU.
  */
 static void setup_identity_mapping(void) {
+    /* Kernel mappings are the same in every address space: keep them in the TLB */
+    uint32_t global = pge_enabled ? PTE_GLOBAL : 0;
+
     /* Clear page directory */
     memset(&kernel_page_directory, 0, sizeof(page_directory_t));
+    /* Recursive slot: page tables become visible at PAGE_TABLES_VIRT */
+    kernel_page_directory.entries[RECURSIVE_PDE_INDEX] = ((uint32_t) &kernel_page_directory) | PDE_PRESENT | PDE_WRITABLE;
+
+    if (pse_enabled) {
+        for (uint32_t i = 0; i < KERNEL_PDE_COUNT; i++) {
+            kernel_page_directory.entries[i] = (i * LARGE_PAGE_SIZE) | PDE_PRESENT | PDE_WRITABLE | PDE_PAGE_SIZE | global;
+        }
+        return;
+    }
+
     /* Clear page tables */
-    memset(kernel_page_tables, 0, sizeof(kernel_page_tables));
+    memset(kernel_page_tables, 0, KERNEL_PDE_COUNT * sizeof(page_table_t));
     
     /* Install page tables in page directory
      * 
@@ -202,14 +847,773 @@ static void setup_identity_mapping(void) {
      *   PD[0] → page_table[0] covers virtual 0x000000 - 0x3FFFFF (0 - 4MB)
      *   PD[1] → page_table[1] covers virtual 0x400000 - 0x7FFFFF (4 - 8MB)
      */
-    kernel_page_directory.entries[0] = ((uint32_t) &kernel_page_tables[0]) | PDE_PRESENT | PDE_WRITABLE;
-    kernel_page_directory.entries[1] = ((uint32_t) &kernel_page_tables[1]) | PDE_PRESENT | PDE_WRITABLE;
+    for (uint32_t i = 0; i < KERNEL_PDE_COUNT; i++) {
+        kernel_page_directory.entries[i] = ((uint32_t) &kernel_page_tables[i]) | PDE_PRESENT | PDE_WRITABLE;
+    }
     
     /* Identity map the kernel region (virtual = physical) for all 2048 pages
      * 2048 pages = 8MB / 4KB = 8192KB / 4KB */
     for (uint32_t addr = 0; addr < KMEM_MAX; addr += PAGE_SIZE) {
-        map_page(&kernel_page_directory, addr, addr, PTE_PRESENT | PTE_WRITABLE);
+        map_page(&kernel_page_directory, addr, addr, PTE_PRESENT | PTE_WRITABLE | global);
+    }
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static inline void write_cr4(uint32_t cr4) {
+    asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+}
+
+/**
+ * Page directory entry for a virtual address (current address space)
+ */
+static inline pde_t* current_pde(uint32_t virt_addr) {
+    return &((pde_t*) PAGE_DIR_VIRT)[virt_addr >> 22];
+}
+
+/**
+ * Page table entry for a virtual address, through the recursive mapping.
+ * Only valid when the PDE is present and not a 4 MiB page.
+ */
+static inline pte_t* current_pte(uint32_t virt_addr) {
+    return &((pte_t*) PAGE_TABLES_VIRT)[virt_addr >> 12];
+}
+
+/**
+ * Invalidate the TLB entry of a single page
+ */
+static inline void invlpg(uint32_t virt_addr) {
+    asm volatile("invlpg (%0)" :: "r"(virt_addr) : "memory");
+}
+
+/**
+ * Flush the whole TLB, including global entries
+ *
+ * Reloading CR3 keeps global pages, so with PGE on, toggle CR4.PGE instead.
+ */
+static void tlb_flush_all(void) {
+    if (pge_enabled) {
+        uint32_t cr4 = read_cr4();
+        write_cr4(cr4 & ~CR4_PGE);
+        write_cr4(cr4);
+    }
+    else {
+        uint32_t cr3;
+        asm volatile("mov %%cr3, %0" : "=r"(cr3));
+        asm volatile("mov %0, %%cr3" :: "r"(cr3) : "memory");
+    }
+}
+
+/**
+ * Drop this CPU's TLB entries for a range of pages
+ *
+ * invlpg each page for small ranges; past TLB_FLUSH_THRESHOLD pages one full
+ * flush is cheaper than that many invalidations.
+ */
+static void tlb_flush_local(uint32_t start, uint32_t pages) {
+    if (pages > TLB_FLUSH_THRESHOLD) {
+        tlb_flush_all();
+        return;
+    }
+    for (uint32_t i = 0; i < pages; i++) {
+        invlpg(start + i * PAGE_SIZE);
+    }
+}
+
+/**
+ * TLB shootdown
+ *
+ * invlpg and CR3 loads only reach the CPU that runs them. After changing
+ * PTEs other CPUs may have cached, the CPU that changed them asks those to
+ * flush too, and waits until they have:
+ *
+ *   sender:  PTEs changed, own TLB flushed → fence → tlb_request = range,
+ *            one pending bit per target → IPI_TLB_VECTOR to each → spin until
+ *            pending == 0
+ *   target:  tlb_shootdown_poll(): flush the range → clear its bit
+ *
+ * Kernel addresses go to every other online CPU; user addresses only to the
+ * CPUs with the same directory loaded (cpu_t.cr3), as a CR3 load drops the
+ * others' entries anyway. One request is out at a time.
+ *
+ * The sender spins with interrupts off, possibly holding a lock, and a target
+ * may be spinning for that lock with its interrupts off too: spin_lock() and
+ * the rwlocks serve requests while they wait, which also covers a second
+ * sender waiting for tlb_request.lock.
+ */
+typedef struct {
+    spinlock_t lock;            /* Held by the sender until every target is done */
+    uint32_t start;             /* First page of the range */
+    uint32_t pages;             /* Its length; past TLB_FLUSH_THRESHOLD targets flush everything */
+    volatile uint32_t pending;  /* Bit cpu_t.id set: that CPU hasn't flushed yet */
+} tlb_request_t;
+
+static tlb_request_t tlb_request = { SPINLOCK_INIT, 0, 0, 0 };
+
+/**
+ * Flush the range of a TLB shootdown aimed at this CPU, if there is one
+ */
+void tlb_shootdown_poll(void) {
+    uint32_t pending = __atomic_load_n(&tlb_request.pending, __ATOMIC_ACQUIRE);
+    if (pending == 0) {
+        return;
+    }
+    uint32_t bit = 1u << cpu_self()->id;
+    if (!(pending & bit)) {
+        return;
+    }
+    tlb_flush_local(tlb_request.start, tlb_request.pages);
+    __atomic_fetch_and(&tlb_request.pending, ~bit, __ATOMIC_RELEASE);
+}
+
+/**
+ * Flush a range from the TLBs of the other CPUs that may hold it, and wait for them
+ *
+ * The caller changed the PTEs and flushed its own TLB already.
+ */
+static void tlb_shootdown(uint32_t start, uint32_t pages) {
+    /* The PTE stores before the reads of cpus[] below: a CPU we don't see yet walks the new entries */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (smp_cpu_count() < 2) {
+        return;
+    }
+    bool user = start >= USER_SPACE_START && start < USER_SPACE_END &&
+                pages <= (USER_SPACE_END - start) / PAGE_SIZE;
+    uint32_t cr3 = paging_current_directory();
+    uint32_t flags = spin_lock_irqsave(&tlb_request.lock);
+    cpu_t* self = cpu_self();
+    uint32_t targets = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t* cpu = &cpus[i];
+        if (cpu == self || !__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        if (user && __atomic_load_n(&cpu->cr3, __ATOMIC_ACQUIRE) != cr3) {
+            continue;
+        }
+        targets |= 1u << i;
+    }
+    if (targets != 0) {
+        tlb_request.start = start;
+        tlb_request.pages = pages;
+        __atomic_store_n(&tlb_request.pending, targets, __ATOMIC_RELEASE);
+        for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+            if (targets & (1u << i)) {
+                lapic_send_ipi(cpus[i].apic_id, LAPIC_IPI_FIXED | IPI_TLB_VECTOR);
+            }
+        }
+        while (__atomic_load_n(&tlb_request.pending, __ATOMIC_ACQUIRE) != 0) {
+            asm volatile("pause");
+        }
     }
+    spin_unlock_irqrestore(&tlb_request.lock, flags);
+}
+
+/**
+ * Start taking part in TLB shootdowns on an application processor
+ */
+void paging_init_cpu(void) {
+    __atomic_store_n(&cpu_self()->cr3, paging_current_directory(), __ATOMIC_SEQ_CST);
+    /* Shootdowns skipped this CPU until it was online: drop whatever it cached meanwhile */
+    tlb_flush_all();
+}
+
+/**
+ * Is this PDE private to each address space?
+ */
+static inline bool is_user_pde(uint32_t pd_idx) {
+    return pd_idx >= USER_PDE_FIRST && pd_idx < USER_PDE_END;
+}
+
+/**
+ * Current PDE for a kernel address, pulled in from the master directory
+ * if it was created while another address space was loaded
+ */
+static pde_t* sync_kernel_pde(uint32_t virt_addr) {
+    uint32_t pd_idx = virt_addr >> 22;
+    pde_t* pde = current_pde(virt_addr);
+    if (!is_user_pde(pd_idx) && !(*pde & PDE_PRESENT) && (kernel_page_directory.entries[pd_idx] & PDE_PRESENT)) {
+        *pde = kernel_page_directory.entries[pd_idx];
+    }
+    return pde;
+}
+
+/**
+ * Page table for a virtual address in the current address space, made if missing
+ *
+ * A table outside the user range is recorded in the master directory too.
+ * Creation happens under pde_lock: otherwise two CPUs could each install a
+ * table for the same kernel PDE, and one of the two would be lost.
+ *
+ * @param user PTE_USER if user pages go in the table, else 0
+ * @return The PDE, or NULL if out of frames
+ */
+static pde_t* paging_make_table(uint32_t virt_addr, uint32_t user) {
+    uint32_t pd_idx = virt_addr >> 22;
+    uint32_t flags = spin_lock_irqsave(&pde_lock);
+    pde_t* pde = sync_kernel_pde(virt_addr);
+    if (!(*pde & PDE_PRESENT)) {
+        /* Not frame_alloc_zeroed(): zeroing on a pool miss maps a scratch page, which may need this table */
+        uint32_t table = zero_pool_take();
+        bool zeroed = table != 0;
+        if (!zeroed) {
+            table = frame_alloc();
+        }
+        if (table == 0) {
+            spin_unlock_irqrestore(&pde_lock, flags);
+            return NULL;
+        }
+        *pde = table | PDE_PRESENT | PDE_WRITABLE | user;
+        /* The table's window page may be cached from before: drop it, then clear the table */
+        uint32_t table_virt = (uint32_t) current_pte(virt_addr) & ~0xFFF;
+        invlpg(table_virt);
+        if (!zeroed) {
+            memset((void*) table_virt, 0, PAGE_SIZE);
+        }
+    }
+    else {
+        /* A user page in a table first made for kernel pages */
+        *pde |= user;
+    }
+    if (!is_user_pde(pd_idx)) {
+        kernel_page_directory.entries[pd_idx] = *pde;
+    }
+    spin_unlock_irqrestore(&pde_lock, flags);
+    return pde;
+}
+
+/**
+ * paging_map() without notifying other CPUs: only this one flushes the page
+ *
+ * @param old Set to the PTE that was replaced (0 if none)
+ */
+static int map_local(uint32_t virt_addr, uint32_t phys_addr, uint32_t flags, pte_t* old) {
+    uint32_t pd_idx = virt_addr >> 22;
+    *old = 0;
+    if (pd_idx == RECURSIVE_PDE_INDEX) {
+        klog(KLOG_ERR, "[FAILED] paging_map: %p is inside the page table window\n", virt_addr);
+        return -1;
+    }
+    pde_t* pde = sync_kernel_pde(virt_addr);
+    if (*pde & PDE_PAGE_SIZE) {
+        klog(KLOG_ERR, "[FAILED] paging_map: %p is covered by a 4 MiB page!\n", virt_addr);
+        return -1;
+    }
+    /* A missing table, or one user pages can't reach yet */
+    bool table_needed = !(*pde & PDE_PRESENT) || (flags & PTE_USER & ~*pde);
+    if (table_needed && paging_make_table(virt_addr, flags & PTE_USER) == NULL) {
+        klog(KLOG_ERR, "[FAILED] paging_map: Out of frames for a page table (%p)\n", virt_addr);
+        return -1;
+    }
+    if (!(flags & PTE_USER) && pge_enabled) {
+        flags |= PTE_GLOBAL;
+    }
+    pte_t* pte = current_pte(virt_addr);
+    *old = *pte;
+    *pte = (phys_addr & ~0xFFF) | flags | PTE_PRESENT;
+    invlpg(virt_addr);
+    return 0;
+}
+
+/**
+ * Map a virtual page in the current address space
+ *
+ * Allocates and clears a page table if the PDE is empty. Kernel mappings
+ * (no PTE_USER) are made global when PGE is available. A new page table
+ * outside the user range is recorded in the master directory too. Replacing
+ * a mapping flushes it from every CPU that may have cached it.
+ */
+int paging_map(uint32_t virt_addr, uint32_t phys_addr, uint32_t flags) {
+    pte_t old;
+    if (map_local(virt_addr, phys_addr, flags, &old) != 0) {
+        return -1;
+    }
+    if (old & PTE_PRESENT) {
+        tlb_shootdown(virt_addr & ~0xFFF, 1);
+    }
+    return 0;
+}
+
+/* Next free page of the paging_map_physical() window */
+static uint32_t phys_map_next = PHYS_MAP_VIRT_START;
+static spinlock_t phys_map_lock = SPINLOCK_INIT;
+
+/**
+ * Map a physical range into the kernel's address space for good
+ */
+void* paging_map_physical(uint32_t phys_addr, size_t len, uint32_t flags) {
+    uint32_t end = phys_addr + len;
+    if (end <= KMEM_MAX && !(flags & PTE_CACHE_DISABLE)) {
+        return (void*) phys_addr;
+    }
+    uint32_t first = phys_addr & ~(PAGE_SIZE - 1);
+    uint32_t pages = (end - first + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t irq_flags = spin_lock_irqsave(&phys_map_lock);
+    if (len == 0 || end < phys_addr || pages > (PHYS_MAP_VIRT_END - phys_map_next) / PAGE_SIZE) {
+        spin_unlock_irqrestore(&phys_map_lock, irq_flags);
+        klog(KLOG_ERR, "[FAILED] paging_map_physical: Can't map %p (+%zu bytes)\n", phys_addr, len);
+        return NULL;
+    }
+    uint32_t virt = phys_map_next;
+    for (uint32_t i = 0; i < pages; i++) {
+        if (paging_map(virt + i * PAGE_SIZE, first + i * PAGE_SIZE, flags & ~PTE_USER) != 0) {
+            spin_unlock_irqrestore(&phys_map_lock, irq_flags);
+            return NULL;
+        }
+    }
+    phys_map_next += pages * PAGE_SIZE;
+    spin_unlock_irqrestore(&phys_map_lock, irq_flags);
+    return (void*) (virt + (phys_addr - first));
+}
+
+/**
+ * paging_unmap() without notifying other CPUs: only this one flushes the page
+ */
+static uint32_t unmap_local(uint32_t virt_addr) {
+    if ((virt_addr >> 22) == RECURSIVE_PDE_INDEX) {
+        return 0;
+    }
+    pde_t* pde = sync_kernel_pde(virt_addr);
+    if (!(*pde & PDE_PRESENT) || (*pde & PDE_PAGE_SIZE)) {
+        return 0;
+    }
+    pte_t* pte = current_pte(virt_addr);
+    if (!(*pte & PTE_PRESENT)) {
+        return 0;
+    }
+    uint32_t phys_addr = *pte & ~0xFFF;
+    *pte = 0;
+    invlpg(virt_addr);
+    return phys_addr;
+}
+
+/**
+ * Remove a virtual page mapping from the current address space
+ *
+ * Returns once no CPU can reach the frame through its TLB any more.
+ */
+uint32_t paging_unmap(uint32_t virt_addr) {
+    uint32_t phys_addr = unmap_local(virt_addr);
+    if (phys_addr != 0) {
+        tlb_shootdown(virt_addr & ~0xFFF, 1);
+    }
+    return phys_addr;
+}
+
+/**
+ * Flush the pages [first, last] everywhere, then release the frames they mapped
+ */
+static void release_batch(uint32_t first, uint32_t last, const uint32_t* frames, uint32_t count,
+                          void (*release)(uint32_t frame)) {
+    tlb_shootdown(first, (last - first) / PAGE_SIZE + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        release(frames[i]);
+    }
+}
+
+/**
+ * Unmap a range of pages and hand their frames to a release function
+ *
+ * Frames are collected TLB_FLUSH_THRESHOLD at a time, so the other CPUs are
+ * interrupted once per batch rather than once per page.
+ */
+void paging_unmap_range(uint32_t virt_addr, size_t len, void (*release)(uint32_t frame)) {
+    if (len == 0) {
+        return;
+    }
+    uint32_t start = virt_addr & ~(PAGE_SIZE - 1);
+    uint32_t pages = ((virt_addr + len - 1) / PAGE_SIZE) - (start / PAGE_SIZE) + 1;
+    uint32_t frames[TLB_FLUSH_THRESHOLD];
+    uint32_t count = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < pages; i++) {
+        uint32_t page = start + i * PAGE_SIZE;
+        uint32_t frame = unmap_local(page);
+        if (frame == 0) {
+            continue;
+        }
+        if (count == 0) {
+            first = page;
+        }
+        last = page;
+        frames[count++] = frame;
+        if (count == TLB_FLUSH_THRESHOLD) {
+            release_batch(first, last, frames, count, release);
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        release_batch(first, last, frames, count, release);
+    }
+}
+
+/**
+ * Physical address a virtual address is mapped to in the current address space
+ */
+uint32_t paging_virt_to_phys(uint32_t virt_addr) {
+    pde_t pde = *sync_kernel_pde(virt_addr);
+    if (!(pde & PDE_PRESENT)) {
+        return 0;
+    }
+    if (pde & PDE_PAGE_SIZE) {
+        return (pde & ~(LARGE_PAGE_SIZE - 1)) | (virt_addr & (LARGE_PAGE_SIZE - 1));
+    }
+    pte_t pte = *current_pte(virt_addr);
+    if (!(pte & PTE_PRESENT)) {
+        return 0;
+    }
+    return (pte & ~0xFFF) | (virt_addr & 0xFFF);
+}
+
+/**
+ * Physical address of the kernel's page directory
+ */
+uint32_t paging_kernel_directory(void) {
+    return (uint32_t) &kernel_page_directory;
+}
+
+/**
+ * Physical address of the page directory in CR3
+ */
+uint32_t paging_current_directory(void) {
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+/**
+ * Load a page directory into CR3
+ */
+void paging_switch_directory(uint32_t page_dir) {
+    /* Announced before the load: from then on, shootdowns for this directory's user range come here */
+    __atomic_store_n(&cpu_self()->cr3, page_dir, __ATOMIC_SEQ_CST);
+    asm volatile("mov %0, %%cr3" :: "r"(page_dir) : "memory");
+}
+
+/**
+ * Address of one of the running CPU's scratch pages
+ */
+static inline uint32_t scratch_virt(uint32_t slot) {
+    return PAGING_SCRATCH_VIRT + (cpu_self()->id * SCRATCH_SLOTS + slot) * PAGE_SIZE;
+}
+
+/**
+ * Map a frame at one of the running CPU's scratch pages (interrupts disabled)
+ *
+ * No other CPU touches these pages, so remapping and unmapping them only
+ * flushes the local TLB.
+ *
+ * @return Virtual address of the frame, or NULL if no page table could be made
+ */
+static void* scratch_map(uint32_t slot, uint32_t frame) {
+    uint32_t virt = scratch_virt(slot);
+    pte_t old;
+    if (map_local(virt, frame, PTE_WRITABLE, &old) != 0) {
+        return NULL;
+    }
+    return (void*) virt;
+}
+
+/**
+ * Unmap one of the running CPU's scratch pages
+ */
+static void scratch_unmap(uint32_t slot) {
+    unmap_local(scratch_virt(slot));
+}
+
+/**
+ * Zero a page with non-temporal stores, which go to memory without filling the cache
+ */
+static void zero_page_nontemporal(void* page) {
+    uint32_t blocks = PAGE_SIZE / 32;
+    asm volatile("1:\n\t"
+                 "movnti %2, (%0)\n\t"
+                 "movnti %2, 4(%0)\n\t"
+                 "movnti %2, 8(%0)\n\t"
+                 "movnti %2, 12(%0)\n\t"
+                 "movnti %2, 16(%0)\n\t"
+                 "movnti %2, 20(%0)\n\t"
+                 "movnti %2, 24(%0)\n\t"
+                 "movnti %2, 28(%0)\n\t"
+                 "add $32, %0\n\t"
+                 "dec %1\n\t"
+                 "jnz 1b\n\t"
+                 "sfence"       /* Order the weakly-ordered stores before the frame is handed out */
+                 : "+r"(page), "+r"(blocks)
+                 : "r"(0)
+                 : "memory", "cc");
+}
+
+/**
+ * Allocate a zeroed frame
+ */
+uint32_t frame_alloc_zeroed(void) {
+    uint32_t frame = zero_pool_take();
+    if (frame != 0) {
+        return frame;
+    }
+    frame = frame_alloc();
+    if (frame == 0) {
+        return 0;
+    }
+    uint32_t flags = irq_save();
+    void* page = scratch_map(SCRATCH_SLOT_ZERO, frame);
+    if (page == NULL) {
+        irq_restore(flags);
+        frame_free(frame);
+        return 0;
+    }
+    /* Ordinary stores here: the caller touches the page next, so it may as well be cached */
+    memset(page, 0, PAGE_SIZE);
+    scratch_unmap(SCRATCH_SLOT_ZERO);
+    irq_restore(flags);
+    return frame;
+}
+
+/**
+ * Zero one more frame for the pool
+ */
+bool frame_zero_idle(void) {
+    if (__atomic_load_n(&zero_pool_count, __ATOMIC_RELAXED) >= FRAME_ZERO_POOL) {
+        return false;
+    }
+    uint32_t frame = frame_alloc();
+    if (frame == 0) {
+        return false;
+    }
+    uint32_t flags = irq_save();
+    void* page = scratch_map(SCRATCH_SLOT_ZERO, frame);
+    if (page == NULL) {
+        irq_restore(flags);
+        frame_free(frame);
+        return false;
+    }
+    if (zero_nontemporal) {
+        zero_page_nontemporal(page);
+    }
+    else {
+        memset(page, 0, PAGE_SIZE);
+    }
+    scratch_unmap(SCRATCH_SLOT_ZERO);
+    irq_restore(flags);
+
+    flags = spin_lock_irqsave(&frame_lock);
+    bool stored = zero_pool_count < FRAME_ZERO_POOL;
+    if (stored) {
+        zero_pool[zero_pool_count++] = frame;
+    }
+    spin_unlock_irqrestore(&frame_lock, flags);
+    if (!stored) {
+        frame_free(frame);
+    }
+    return stored;
+}
+
+/**
+ * Number of zeroed frames waiting in the pool
+ */
+uint32_t frame_zeroed_count(void) {
+    return __atomic_load_n(&zero_pool_count, __ATOMIC_RELAXED);
+}
+
+/**
+ * Allocate the page tables of every kernel PDE that processes must see from the start
+ *
+ * Kernel stacks live in the heap, and a switch runs on the old thread's stack
+ * with the new thread's directory loaded: a heap PDE missing from a directory
+ * could never be faulted in. 65 tables cover the heap's 260 MiB range.
+ */
+static int share_kernel_tables(void) {
+    for (uint32_t addr = KHEAP_VIRT_START; addr < KHEAP_VIRT_END; addr += LARGE_PAGE_SIZE) {
+        if (paging_make_table(addr, 0) == NULL) {
+            return -1;
+        }
+    }
+    /* The scratch pages' table, used below */
+    if (paging_make_table(PAGING_SCRATCH_VIRT, 0) == NULL) {
+        return -1;
+    }
+    __atomic_store_n(&kernel_tables_shared, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Create an address space with an empty user range
+ */
+uint32_t paging_create_directory(void) {
+    uint32_t flags = irq_save();
+    if (!__atomic_load_n(&kernel_tables_shared, __ATOMIC_ACQUIRE) && share_kernel_tables() != 0) {
+        irq_restore(flags);
+        klog(KLOG_ERR, "[FAILED] paging_create_directory: Out of frames for kernel page tables\n");
+        return 0;
+    }
+    uint32_t frame = frame_alloc();
+    pde_t* dir = frame ? scratch_map(0, frame) : NULL;
+    if (dir == NULL) {
+        if (frame != 0) {
+            frame_free(frame);
+        }
+        irq_restore(flags);
+        klog(KLOG_ERR, "[FAILED] paging_create_directory: Out of frames for a page directory\n");
+        return 0;
+    }
+    for (uint32_t i = 0; i < 1024; i++) {
+        dir[i] = is_user_pde(i) ? 0 : kernel_page_directory.entries[i];
+    }
+    dir[RECURSIVE_PDE_INDEX] = frame | PDE_PRESENT | PDE_WRITABLE;
+    scratch_unmap(0);
+    irq_restore(flags);
+    return frame;
+}
+
+/**
+ * Free an address space: its user pages, user page tables and directory
+ */
+void paging_destroy_directory(uint32_t page_dir) {
+    if (page_dir == 0 || page_dir == paging_kernel_directory()) {
+        return;
+    }
+    uint32_t flags = irq_save();
+    if (paging_current_directory() == page_dir) {
+        paging_switch_directory(paging_kernel_directory());
+    }
+    /* The scratch table exists since paging_create_directory() made it */
+    pde_t* dir = scratch_map(0, page_dir);
+    for (uint32_t i = USER_PDE_FIRST; i < USER_PDE_END; i++) {
+        if (!(dir[i] & PDE_PRESENT) || (dir[i] & PDE_PAGE_SIZE)) {
+            continue;
+        }
+        uint32_t table = dir[i] & ~0xFFF;
+        pte_t* entries = scratch_map(1, table);
+        for (uint32_t j = 0; j < 1024; j++) {
+            if (entries[j] & PTE_PRESENT) {
+                frame_release(entries[j] & ~0xFFF);
+            }
+        }
+        frame_free(table);
+    }
+    scratch_unmap(0);
+    scratch_unmap(1);
+    frame_free(page_dir);
+    irq_restore(flags);
+}
+
+/**
+ * Copy the current address space, sharing its user pages copy-on-write
+ */
+uint32_t paging_clone_directory(void) {
+    uint32_t page_dir = paging_create_directory();
+    if (page_dir == 0) {
+        return 0;
+    }
+    uint32_t flags = irq_save();
+    int result = 0;
+    for (uint32_t i = USER_PDE_FIRST; i < USER_PDE_END && result == 0; i++) {
+        pde_t pde = ((pde_t*) PAGE_DIR_VIRT)[i];
+        if (!(pde & PDE_PRESENT) || (pde & PDE_PAGE_SIZE)) {
+            continue;
+        }
+        uint32_t table = frame_alloc();
+        pte_t* child = table ? scratch_map(1, table) : NULL;
+        if (child == NULL) {
+            if (table != 0) {
+                frame_free(table);
+            }
+            result = -1;
+            break;
+        }
+        pte_t* parent = &((pte_t*) PAGE_TABLES_VIRT)[i * 1024];
+        for (uint32_t j = 0; j < 1024; j++) {
+            pte_t pte = parent[j];
+            if (!(pte & PTE_PRESENT) || frame_ref(pte & ~0xFFF) != 0) {
+                /* Not mapped, or too many sharers to take another reference */
+                child[j] = 0;
+                if (pte & PTE_PRESENT) {
+                    result = -1;
+                }
+                continue;
+            }
+            if (pte & (PTE_WRITABLE | PTE_COW)) {
+                /* Both sides fault on the next write and get their own copy then */
+                pte = (pte & ~PTE_WRITABLE) | PTE_COW;
+                parent[j] = pte;
+            }
+            child[j] = pte;
+        }
+        /* The table frame goes into the child's directory */
+        pde_t* dir = scratch_map(0, page_dir);
+        dir[i] = table | (pde & 0xFFF);
+    }
+    scratch_unmap(0);
+    scratch_unmap(1);
+    /* Our own user pages just became read-only: drop their writable TLB entries (kernel ones are global) */
+    paging_switch_directory(paging_current_directory());
+    /* ...here and wherever another thread of this address space runs */
+    tlb_shootdown(USER_SPACE_START, (USER_SPACE_END - USER_SPACE_START) / PAGE_SIZE);
+    irq_restore(flags);
+    if (result != 0) {
+        klog(KLOG_ERR, "[FAILED] paging_clone_directory: Out of memory copying the address space\n");
+        paging_destroy_directory(page_dir);
+        return 0;
+    }
+    return page_dir;
+}
+
+/**
+ * Give the current address space a private, writable copy of a copy-on-write page
+ *
+ * The last sharer just gets write access back; anyone else copies the frame.
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+static int paging_resolve_cow(uint32_t page) {
+    pte_t* pte = current_pte(page);
+    uint32_t frame = *pte & ~0xFFF;
+    uint32_t pte_flags = (*pte & 0xFFF & ~PTE_COW) | PTE_WRITABLE;
+    if (frame_refcount(frame) == 1) {
+        *pte = frame | pte_flags;
+        invlpg(page);
+        tlb_shootdown(page, 1);
+        return 0;
+    }
+    uint32_t copy = frame_alloc();
+    if (copy == 0) {
+        return -1;
+    }
+    uint32_t flags = irq_save();
+    void* dst = scratch_map(0, copy);
+    if (dst == NULL) {
+        irq_restore(flags);
+        frame_free(copy);
+        return -1;
+    }
+    memcpy(dst, (const void*) page, PAGE_SIZE);
+    scratch_unmap(0);
+    *pte = copy | pte_flags;
+    invlpg(page);
+    irq_restore(flags);
+    /* Other threads of this address space must stop reading the shared frame before we let go of it */
+    tlb_shootdown(page, 1);
+    frame_release(frame);
+    return 0;
+}
+
+/**
+ * Drop TLB entries for [virt_addr, virt_addr + len), here and on the other CPUs that may hold them
+ */
+void paging_flush_range(uint32_t virt_addr, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    uint32_t start = virt_addr & ~(PAGE_SIZE - 1);
+    uint32_t pages = ((virt_addr + len - 1) / PAGE_SIZE) - (start / PAGE_SIZE) + 1;
+    tlb_flush_local(start, pages);
+    tlb_shootdown(start, pages);
 }
 
 /**
@@ -226,11 +1630,13 @@ static void setup_identity_mapping(void) {
  */
 static void enable_paging(page_directory_t* page_dir) {
     /* Load page directory address into CR3 (tells MMU where page tables are) */
+    cpu_self()->cr3 = (uint32_t) page_dir;
     asm volatile("mov %0, %%cr3" :: "r"(page_dir));
     /* Enable paging by setting PG bit (bit 31) in CR0 */
     uint32_t cr0;
     asm volatile("mov %%cr0, %0" : "=r"(cr0));
     cr0 |= 0x80000000;  /* Set PG bit - translation now active! */
+    cr0 |= CR0_WP;      /* Ring 0 honours read-only pages too, so kernel writes to copy-on-write pages fault */
     asm volatile("mov %0, %%cr0" :: "r"(cr0));
 }
 
@@ -242,7 +1648,46 @@ static void page_fault_handler(regs_t* regs) {
     /* CR2 holds the faulting address */
     uint32_t faulty_addr;
     asm volatile("mov %%cr2, %0" : "=r"(faulty_addr));
+    TRACE(PAGE_FAULT, faulty_addr, regs->err_code);
+
+    bool user_mode = (regs->err_code & 0x4) != 0;
+    uint32_t page = faulty_addr & ~(PAGE_SIZE - 1);
+    /* Write to a shared page (from ring 3, or the kernel writing a user buffer): copy it now */
+    if ((regs->err_code & 0x3) == 0x3 && is_user_pde(faulty_addr >> 22) && (*current_pde(page) & PDE_PRESENT) &&
+        (*current_pte(page) & PTE_COW)) {
+        if (paging_resolve_cow(page) == 0) {
+            return;
+        }
+        klog(KLOG_ERR, "[FAILED] page_fault_handler: Out of memory copying %p\n", faulty_addr);
+    }
+    if (!(regs->err_code & 0x1)) {
+        /* Kernel page table added to the master directory after this one was created */
+        uint32_t pd_idx = faulty_addr >> 22;
+        if (!is_user_pde(pd_idx) && pd_idx != RECURSIVE_PDE_INDEX &&
+            (kernel_page_directory.entries[pd_idx] & PDE_PRESENT) && !(*current_pde(faulty_addr) & PDE_PRESENT)) {
+            *current_pde(faulty_addr) = kernel_page_directory.entries[pd_idx];
+            return;
+        }
+        /* Not-present fault inside a reserved region: allocate the page and retry */
+        if (vmm_handle_fault(faulty_addr, user_mode) == 0) {
+            return;
+        }
+        /* Untouched page of a process's program segments */
+        if (is_user_pde(pd_idx) && process_handle_fault(faulty_addr) == 0) {
+            return;
+        }
+    }
 
+    /* A process touching memory it doesn't own dies, also when the kernel touches it on the process's behalf
+     * (a system call buffer); the kernel keeps running */
+    if ((user_mode || is_user_pde(faulty_addr >> 22)) && process_current() != NULL) {
+        klog(KLOG_ERR, "[FAILED] Process %u (%s): Page fault at %p (%s, EIP %p), killed\n",
+                       process_current()->pid, thread_current()->name, faulty_addr,
+                       regs->err_code & 0x2 ? "write" : "read", regs->eip);
+        process_exit(-1);
+    }
+
+    crashdump_write(regs, "Page fault not handled");
     printf("\n========================================\n");
     printf("PAGE FAULT!\n");
     printf("========================================\n");
@@ -261,19 +1706,32 @@ static void page_fault_handler(regs_t* regs) {
  * Initialize paging system
  * 
  * Steps:
- * 1. Initialize frame bitmap
- * 2. Set up identity mapping (using static page tables)
+ * 1. Initialize frame bitmap (sized from the multiboot memory map)
+ * 2. Set up identity mapping (4 MiB pages if the CPU has PSE)
  * 3. Register page fault handler
  * 4. Enable paging
  */
-void paging_init(void) {
+void paging_init(multiboot_info_t* mbi) {
+    pse_enabled = cpuid_has_edx(CPUID_EDX_PSE);
+    pge_enabled = cpuid_has_edx(CPUID_EDX_PGE);
+    zero_nontemporal = cpuid_has_edx(CPUID_EDX_SSE2);
     /* Step 1: Initialize frame allocator */
-    frame_bitmap_init();
-    /* Step 2: Set up identity mapping using static structures */
+    frame_bitmap_init(mbi);
+    /* Step 2: Set up identity mapping */
     setup_identity_mapping();
+    /* 4 MiB pages must be enabled before the MMU sees large-page PDEs */
+    uint32_t cr4 = read_cr4();
+    if (pse_enabled) {
+        cr4 |= CR4_PSE;
+    }
+    if (pge_enabled) {
+        cr4 |= CR4_PGE;
+    }
+    write_cr4(cr4);
     /* Step 3: Register page fault handler */
     register_isr(14, page_fault_handler);
     /* Step 4: Enable paging */
     enable_paging(&kernel_page_directory);
-    printf("[  OK  ] Paging initialized successfully.\n");
+    klog(KLOG_INFO, "[  OK  ] Paging initialized successfully (%u MiB physical memory, %s pages).\n",
+                    num_frames / 256, pse_enabled ? "4 MiB" : "4 KiB");
 }
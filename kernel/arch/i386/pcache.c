@@ -0,0 +1,667 @@
+/**
+ * Page Cache
+ *
+ * One lock, pcache_lock, guards the hash, the clock list, the slot bitmap,
+ * page flags and the statistics. It is taken with interrupts disabled since
+ * I/O completions update pages from the disk's IRQ; nothing sleeps, copies
+ * or submits I/O while holding it.
+ *
+ * A page's life:
+ *
+ *   page_get() miss → slot + frame + descriptor → hashed, on the clock,
+ *     LOCKED → block_submit() → IRQ: pcache_io_done() → UPTODATE, waiters woken
+ *   pcache_write() → LOCKED while copying → DIRTY
+ *   write-back → LOCKED, !DIRTY → block_submit() → IRQ → clean
+ *   clock hand → !REFERENCED, clean, unused → unmapped, frame freed
+ *
+ * The reclaimer runs inside frame allocations too, where it can't sleep or
+ * allocate. Evicted descriptors go on a free list instead of kfree() and it
+ * only try-locks pcache_lock, so an allocation made while the cache itself
+ * holds the lock just doesn't reclaim.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/pcache.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+
+#define PCACHE_SLOTS            ((PCACHE_VIRT_END - PCACHE_VIRT_START) / PAGE_SIZE)
+#define SECTORS_PER_PAGE        (PAGE_SIZE / BLOCK_SECTOR_SIZE)
+
+static spinlock_t pcache_lock = SPINLOCK_INIT;
+static pcache_page_t* pcache_hash[PCACHE_HASH_BUCKETS];
+static pcache_page_t* clock_hand = NULL;        /* Next page the reclaimer looks at */
+static pcache_page_t* free_descs = NULL;        /* Descriptors of evicted pages */
+static uint32_t slot_bitmap[PCACHE_SLOTS / 32];
+static uint32_t slot_hint = 0;
+static pcache_stats_t pcache_stats;
+
+/* Write-back thread: woken by the timer or by too many dirty pages */
+static wait_queue_t wb_wait = WAIT_QUEUE_INIT;
+static volatile bool wb_kick = false;
+static ktimer_t wb_timer;
+
+static inline uint32_t page_hash(const pcache_mapping_t* m, uint32_t index) {
+    return ((index * 0x9E3779B1u) ^ ((uint32_t) m >> 4)) & (PCACHE_HASH_BUCKETS - 1);
+}
+
+/**
+ * Find a cached page (lock held)
+ */
+static pcache_page_t* page_find(const pcache_mapping_t* m, uint32_t index) {
+    for (pcache_page_t* p = pcache_hash[page_hash(m, index)]; p != NULL; p = p->hash_next) {
+        if (p->mapping == m && p->index == index) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Hash a page and put it behind the clock hand, where it is looked at last (lock held)
+ */
+static void page_insert(pcache_page_t* page) {
+    uint32_t bucket = page_hash(page->mapping, page->index);
+    page->hash_next = pcache_hash[bucket];
+    pcache_hash[bucket] = page;
+    if (clock_hand == NULL) {
+        page->clock_next = page;
+        page->clock_prev = page;
+        clock_hand = page;
+    }
+    else {
+        page->clock_next = clock_hand;
+        page->clock_prev = clock_hand->clock_prev;
+        clock_hand->clock_prev->clock_next = page;
+        clock_hand->clock_prev = page;
+    }
+    pcache_stats.pages++;
+}
+
+/**
+ * Take a free window slot (lock held)
+ *
+ * @return Its address, or 0 if every slot is in use
+ */
+static uint32_t slot_alloc(void) {
+    const uint32_t words = PCACHE_SLOTS / 32;
+    for (uint32_t n = 0; n < words; n++) {
+        uint32_t w = (slot_hint + n) % words;
+        if (slot_bitmap[w] != 0xFFFFFFFFu) {
+            uint32_t bit = (uint32_t) __builtin_ctz(~slot_bitmap[w]);
+            slot_bitmap[w] |= 1u << bit;
+            slot_hint = w;
+            return PCACHE_VIRT_START + (w * 32 + bit) * PAGE_SIZE;
+        }
+    }
+    return 0;
+}
+
+static void slot_free(uint32_t virt) {
+    uint32_t slot = (virt - PCACHE_VIRT_START) / PAGE_SIZE;
+    slot_bitmap[slot / 32] &= ~(1u << (slot % 32));
+}
+
+/**
+ * Remove a page from the cache and free its memory (lock held, page unused)
+ */
+static void page_evict(pcache_page_t* page) {
+    pcache_page_t** link = &pcache_hash[page_hash(page->mapping, page->index)];
+    while (*link != page) {
+        link = &(*link)->hash_next;
+    }
+    *link = page->hash_next;
+    if (page->clock_next == page) {
+        clock_hand = NULL;
+    }
+    else {
+        page->clock_prev->clock_next = page->clock_next;
+        page->clock_next->clock_prev = page->clock_prev;
+        if (clock_hand == page) {
+            clock_hand = page->clock_next;
+        }
+    }
+    paging_unmap((uint32_t) page->data);
+    frame_free(page->frame);
+    slot_free((uint32_t) page->data);
+    page->hash_next = free_descs;
+    free_descs = page;
+    pcache_stats.pages--;
+    pcache_stats.evicted++;
+}
+
+/**
+ * Start write-back now (any context)
+ */
+static void writeback_kick(void) {
+    wb_kick = true;
+    wake_up(&wb_wait);
+}
+
+/**
+ * Run the clock hand until count pages are freed or every page was seen twice (lock held)
+ *
+ * @return Pages freed
+ */
+static uint32_t reclaim_locked(uint32_t count) {
+    uint32_t freed = 0;
+    uint32_t budget = pcache_stats.pages * 2;
+    bool dirty_seen = false;
+    while (freed < count && clock_hand != NULL && budget-- > 0) {
+        pcache_page_t* page = clock_hand;
+        clock_hand = page->clock_next;
+        if (page->users > 0 || (page->flags & PCACHE_LOCKED)) {
+            continue;
+        }
+        if (page->flags & PCACHE_DIRTY) {
+            dirty_seen = true;
+            continue;
+        }
+        if (page->flags & PCACHE_REFERENCED) {
+            page->flags &= ~PCACHE_REFERENCED;      /* Second chance */
+            continue;
+        }
+        page_evict(page);
+        freed++;
+    }
+    if (dirty_seen && freed < count) {
+        writeback_kick();       /* Clean them so the next pass can take them */
+    }
+    return freed;
+}
+
+/**
+ * Evict clean pages for the frame allocator
+ */
+uint32_t pcache_shrink(uint32_t count) {
+    uint32_t flags = irq_save();
+    if (!spin_trylock(&pcache_lock)) {
+        irq_restore(flags);
+        return 0;
+    }
+    uint32_t freed = reclaim_locked(count);
+    spin_unlock_irqrestore(&pcache_lock, flags);
+    return freed;
+}
+
+/**
+ * Make a page mark dirty, arming write-back (lock held)
+ */
+static void page_set_dirty(pcache_page_t* page) {
+    if (page->flags & PCACHE_DIRTY) {
+        return;
+    }
+    page->flags |= PCACHE_DIRTY;
+    if (++pcache_stats.dirty >= PCACHE_DIRTY_KICK) {
+        writeback_kick();
+    }
+    else if (!timer_pending(&wb_timer)) {
+        timer_add(&wb_timer, ktime_ns() + (uint64_t) PCACHE_WRITEBACK_MS * 1000000);
+    }
+}
+
+/**
+ * I/O completion for a page (IRQ)
+ */
+static void pcache_io_done(block_io_t* io) {
+    pcache_page_t* page = (pcache_page_t*) io->data;
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    uint32_t state = page->flags & ~(PCACHE_LOCKED | PCACHE_ERROR);
+    if (io->write) {
+        if (io->status == 0) {
+            pcache_stats.written_back++;
+        }
+        else {
+            /* Keep the data: it goes out with the next write-back */
+            page->flags = state;
+            page_set_dirty(page);
+            state = page->flags;
+        }
+    }
+    else {
+        state |= io->status == 0 ? PCACHE_UPTODATE : PCACHE_ERROR;
+    }
+    page->flags = state;
+    spin_unlock_irqrestore(&pcache_lock, flags);
+    wake_up(&page->wait);
+}
+
+/**
+ * Sectors of a page inside the mapping (the last page may be partial)
+ */
+static uint32_t page_sectors(const pcache_mapping_t* m, uint32_t index) {
+    uint32_t total = (m->size + BLOCK_SECTOR_SIZE - 1) / BLOCK_SECTOR_SIZE;
+    uint32_t first = index * SECTORS_PER_PAGE;
+    return total - first < SECTORS_PER_PAGE ? total - first : SECTORS_PER_PAGE;
+}
+
+/**
+ * Submit a page's read or write (page LOCKED by the caller, lock not held)
+ */
+static void page_submit(pcache_page_t* page, bool write) {
+    pcache_mapping_t* m = page->mapping;
+    uint32_t count = page_sectors(m, page->index);
+    if (!write && count < SECTORS_PER_PAGE) {
+        memset(page->data + count * BLOCK_SECTOR_SIZE, 0, (SECTORS_PER_PAGE - count) * BLOCK_SECTOR_SIZE);
+    }
+    uint32_t lba = m->bmap != NULL ? m->bmap(m, page->index) : m->first_sector + page->index * SECTORS_PER_PAGE;
+    page->io = (block_io_t) {
+        .lba = lba,
+        .count = count,
+        .buffer = page->data,
+        .write = write,
+        .done = pcache_io_done,
+        .data = page,
+    };
+    if (block_submit(m->dev, &page->io) != 0) {
+        page->io.status = -1;
+        pcache_io_done(&page->io);
+    }
+}
+
+/**
+ * Allocate a page's memory, not yet in the cache
+ *
+ * @return Page with data mapped, or NULL if out of memory
+ */
+static pcache_page_t* page_new(void) {
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    if (pcache_stats.pages >= pcache_stats.limit) {
+        reclaim_locked(1);
+    }
+    uint32_t virt = pcache_stats.pages < pcache_stats.limit ? slot_alloc() : 0;
+    pcache_page_t* page = free_descs;
+    if (virt != 0 && page != NULL) {
+        free_descs = page->hash_next;
+    }
+    spin_unlock_irqrestore(&pcache_lock, flags);
+    if (virt == 0) {
+        return NULL;
+    }
+    if (page == NULL) {
+        page = (pcache_page_t*) kmalloc(sizeof(pcache_page_t));
+    }
+    uint32_t frame = page != NULL ? frame_alloc() : 0;
+    if (frame == 0 || paging_map(virt, frame, PTE_WRITABLE) != 0) {
+        if (frame != 0) {
+            frame_free(frame);
+        }
+        flags = spin_lock_irqsave(&pcache_lock);
+        slot_free(virt);
+        if (page != NULL) {
+            page->hash_next = free_descs;
+            free_descs = page;
+        }
+        spin_unlock_irqrestore(&pcache_lock, flags);
+        return NULL;
+    }
+    memset(page, 0, sizeof(*page));
+    page->frame = frame;
+    page->data = (uint8_t*) virt;
+    wait_queue_init(&page->wait);
+    return page;
+}
+
+/**
+ * Give back a page that lost the race to be inserted
+ */
+static void page_discard(pcache_page_t* page) {
+    paging_unmap((uint32_t) page->data);
+    frame_free(page->frame);
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    slot_free((uint32_t) page->data);
+    page->hash_next = free_descs;
+    free_descs = page;
+    spin_unlock_irqrestore(&pcache_lock, flags);
+}
+
+/**
+ * Find or create a page
+ *
+ * @param fill Start reading the page if its contents aren't there; otherwise a
+ *             new page is returned LOCKED and empty, for the caller to fill
+ * @param pin Return the page with a user reference (else NULL is returned once it's cached)
+ * @param created Set if the page was created by this call (may be NULL)
+ * @return Page, or NULL if out of memory (or !pin)
+ */
+static pcache_page_t* page_get(pcache_mapping_t* m, uint32_t index, bool fill, bool pin, bool* created) {
+    pcache_page_t* fresh = NULL;
+    for (;;) {
+        uint32_t flags = spin_lock_irqsave(&pcache_lock);
+        pcache_page_t* page = page_find(m, index);
+        bool read = false;
+        if (page != NULL) {
+            if (fresh != NULL) {
+                spin_unlock_irqrestore(&pcache_lock, flags);
+                page_discard(fresh);
+                fresh = NULL;
+                continue;
+            }
+            pcache_stats.hits += pin;
+            page->flags |= PCACHE_REFERENCED;
+            /* A failed read is retried by the next reader */
+            if (fill && !(page->flags & (PCACHE_UPTODATE | PCACHE_LOCKED))) {
+                page->flags = (page->flags & ~PCACHE_ERROR) | PCACHE_LOCKED;
+                read = true;
+            }
+            if (created != NULL) {
+                *created = false;
+            }
+        }
+        else if (fresh != NULL) {
+            page = fresh;
+            page->mapping = m;
+            page->index = index;
+            page->flags = PCACHE_LOCKED | PCACHE_REFERENCED;
+            page_insert(page);
+            pcache_stats.misses += pin;
+            read = fill;
+            if (created != NULL) {
+                *created = true;
+            }
+        }
+        else {
+            spin_unlock_irqrestore(&pcache_lock, flags);
+            fresh = page_new();
+            if (fresh == NULL) {
+                return NULL;
+            }
+            continue;
+        }
+        if (pin) {
+            page->users++;
+        }
+        spin_unlock_irqrestore(&pcache_lock, flags);
+        if (read) {
+            page_submit(page, false);
+        }
+        return pin ? page : NULL;
+    }
+}
+
+/**
+ * Drop a user reference
+ */
+static void page_put(pcache_page_t* page) {
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    page->users--;
+    spin_unlock_irqrestore(&pcache_lock, flags);
+}
+
+/**
+ * Sleep until a page has no I/O in flight
+ */
+static void page_wait(pcache_page_t* page) {
+    wait_event(&page->wait, !(page->flags & PCACHE_LOCKED));
+}
+
+/**
+ * Take a page's LOCKED bit for writing into it
+ */
+static void page_lock(pcache_page_t* page) {
+    for (;;) {
+        page_wait(page);
+        uint32_t flags = spin_lock_irqsave(&pcache_lock);
+        if (!(page->flags & PCACHE_LOCKED)) {
+            page->flags |= PCACHE_LOCKED;
+            spin_unlock_irqrestore(&pcache_lock, flags);
+            return;
+        }
+        spin_unlock_irqrestore(&pcache_lock, flags);
+    }
+}
+
+/**
+ * Read the next window ahead of a sequential reader
+ *
+ * The window is submitted once the reader is halfway through the previous
+ * one, so the disk works while the reader copies. Random access resets it.
+ */
+static void readahead(pcache_mapping_t* m, uint32_t index) {
+    uint32_t pages = (m->size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    bool sequential = index == m->ra_next || index + 1 == m->ra_next;
+    m->ra_next = index + 1;
+    if (!sequential) {
+        m->ra_window = 0;
+        m->ra_end = index + 1;
+        spin_unlock_irqrestore(&pcache_lock, flags);
+        return;
+    }
+    if (m->ra_end > index + m->ra_window / 2) {
+        spin_unlock_irqrestore(&pcache_lock, flags);
+        return;
+    }
+    m->ra_window = m->ra_window == 0 ? PCACHE_RA_MIN : m->ra_window * 2;
+    if (m->ra_window > PCACHE_RA_MAX) {
+        m->ra_window = PCACHE_RA_MAX;
+    }
+    uint32_t start = m->ra_end > index + 1 ? m->ra_end : index + 1;
+    uint32_t end = start + m->ra_window < pages ? start + m->ra_window : pages;
+    m->ra_end = end > start ? end : start;
+    spin_unlock_irqrestore(&pcache_lock, flags);
+
+    for (uint32_t i = start; i < end; i++) {
+        bool created = false;
+        page_get(m, i, true, false, &created);
+        if (created) {
+            flags = spin_lock_irqsave(&pcache_lock);
+            pcache_stats.readahead++;
+            spin_unlock_irqrestore(&pcache_lock, flags);
+        }
+    }
+}
+
+/**
+ * Set up a contiguous mapping
+ */
+void pcache_mapping_init(pcache_mapping_t* m, block_device_t* dev, uint32_t first_sector, uint32_t size) {
+    memset(m, 0, sizeof(*m));
+    m->dev = dev;
+    m->first_sector = first_sector;
+    m->size = size;
+}
+
+/**
+ * Read through the cache
+ */
+int32_t pcache_read(pcache_mapping_t* m, uint32_t offset, void* buf, size_t len) {
+    if (offset >= m->size) {
+        return 0;
+    }
+    if (len > m->size - offset) {
+        len = m->size - offset;
+    }
+    size_t done = 0;
+    while (done < len) {
+        uint32_t pos = offset + (uint32_t) done;
+        uint32_t index = pos / PAGE_SIZE;
+        uint32_t in_page = pos % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page < len - done ? PAGE_SIZE - in_page : len - done;
+        pcache_page_t* page = page_get(m, index, true, true, NULL);
+        if (page == NULL) {
+            break;
+        }
+        readahead(m, index);
+        page_wait(page);
+        bool ok = (page->flags & PCACHE_UPTODATE) != 0;
+        if (ok) {
+            memcpy((uint8_t*) buf + done, page->data + in_page, chunk);
+        }
+        page_put(page);
+        if (!ok) {
+            break;
+        }
+        done += chunk;
+    }
+    return done > 0 || len == 0 ? (int32_t) done : -1;
+}
+
+/**
+ * Write into the cache
+ */
+int32_t pcache_write(pcache_mapping_t* m, uint32_t offset, const void* buf, size_t len) {
+    if (offset >= m->size) {
+        return len == 0 ? 0 : -1;
+    }
+    if (len > m->size - offset) {
+        len = m->size - offset;
+    }
+    size_t done = 0;
+    while (done < len) {
+        uint32_t pos = offset + (uint32_t) done;
+        uint32_t index = pos / PAGE_SIZE;
+        uint32_t in_page = pos % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page < len - done ? PAGE_SIZE - in_page : len - done;
+        /* Overwriting all of the page's bytes: no need to read it first */
+        bool whole = in_page == 0 && (chunk == PAGE_SIZE || pos + chunk == m->size);
+        bool created = false;
+        pcache_page_t* page = page_get(m, index, !whole, true, &created);
+        if (page == NULL) {
+            break;
+        }
+        if (!created || !whole) {
+            if (!whole) {
+                page_wait(page);
+            }
+            page_lock(page);
+        }
+        uint32_t flags = spin_lock_irqsave(&pcache_lock);
+        bool ok = whole || (page->flags & PCACHE_UPTODATE);
+        spin_unlock_irqrestore(&pcache_lock, flags);
+        if (ok) {
+            memcpy(page->data + in_page, (const uint8_t*) buf + done, chunk);
+        }
+        flags = spin_lock_irqsave(&pcache_lock);
+        page->flags &= ~PCACHE_LOCKED;
+        if (ok) {
+            page->flags = (page->flags & ~PCACHE_ERROR) | PCACHE_UPTODATE;
+            page_set_dirty(page);
+        }
+        spin_unlock_irqrestore(&pcache_lock, flags);
+        wake_up(&page->wait);
+        page_put(page);
+        if (!ok) {
+            break;
+        }
+        done += chunk;
+    }
+    return done > 0 || len == 0 ? (int32_t) done : -1;
+}
+
+/**
+ * Write dirty pages back and wait for them
+ *
+ * All of them are submitted before the first wait, so neighbouring pages
+ * merge into one request in the device queue.
+ */
+static int writeback(pcache_mapping_t* m) {
+    pcache_page_t* batch = NULL;
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    pcache_page_t* page = clock_hand;
+    for (uint32_t i = 0; i < pcache_stats.pages; i++, page = page->clock_next) {
+        if ((page->flags & (PCACHE_DIRTY | PCACHE_LOCKED)) == PCACHE_DIRTY && (m == NULL || page->mapping == m)) {
+            page->flags = (page->flags & ~PCACHE_DIRTY) | PCACHE_LOCKED;
+            pcache_stats.dirty--;
+            page->users++;
+            page->wb_next = batch;
+            batch = page;
+        }
+    }
+    spin_unlock_irqrestore(&pcache_lock, flags);
+
+    for (page = batch; page != NULL; page = page->wb_next) {
+        page_submit(page, true);
+    }
+    int result = 0;
+    while (batch != NULL) {
+        page = batch;
+        batch = page->wb_next;
+        page_wait(page);
+        if (page->io.status != 0) {
+            result = -1;
+        }
+        page_put(page);
+    }
+    return result;
+}
+
+/**
+ * Write a mapping's dirty pages back
+ */
+int pcache_sync(pcache_mapping_t* m) {
+    return writeback(m);
+}
+
+/**
+ * Drop a mapping's pages
+ */
+void pcache_invalidate(pcache_mapping_t* m) {
+    writeback(m);
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    for (uint32_t i = 0; i < PCACHE_HASH_BUCKETS; i++) {
+        pcache_page_t* page = pcache_hash[i];
+        while (page != NULL) {
+            pcache_page_t* next = page->hash_next;
+            if (page->mapping == m && page->users == 0 && !(page->flags & (PCACHE_LOCKED | PCACHE_DIRTY))) {
+                page_evict(page);
+                pcache_stats.evicted--;     /* Dropped, not reclaimed */
+            }
+            page = next;
+        }
+    }
+    m->ra_next = 0;
+    m->ra_end = 0;
+    m->ra_window = 0;
+    spin_unlock_irqrestore(&pcache_lock, flags);
+}
+
+static void writeback_timer(void* data) {
+    (void) data;
+    writeback_kick();
+}
+
+/**
+ * Write-back thread: one pass per kick
+ */
+static void writeback_thread(void* arg) {
+    (void) arg;
+    for (;;) {
+        wait_event(&wb_wait, wb_kick);
+        wb_kick = false;
+        writeback(NULL);
+    }
+}
+
+/**
+ * Set up the cache
+ */
+int pcache_init(void) {
+    uint32_t limit = frame_total() / PCACHE_MEMORY_SHARE;
+    pcache_stats.limit = limit < PCACHE_SLOTS ? limit : PCACHE_SLOTS;
+    timer_setup(&wb_timer, writeback_timer, NULL);
+    if (thread_create("pcache-wb", writeback_thread, NULL) == NULL) {
+        klog(KLOG_ERR, "[FAILED] pcache_init: Could not start the write-back thread\n");
+        return -1;
+    }
+    frame_set_reclaim(pcache_shrink);
+    klog(KLOG_INFO, "[  OK  ] Page cache initialized (up to %u MiB)\n", pcache_stats.limit / 256);
+    return 0;
+}
+
+/**
+ * Get cache statistics
+ */
+void pcache_get_stats(pcache_stats_t* stats) {
+    uint32_t flags = spin_lock_irqsave(&pcache_lock);
+    *stats = pcache_stats;
+    spin_unlock_irqrestore(&pcache_lock, flags);
+}
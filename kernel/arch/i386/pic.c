@@ -141,6 +141,8 @@ void pic_unmask(uint8_t irq) {
 	else {
 		port = PIC2_DATA;  /* IRQs 8-15: Slave PIC */
 		irq -= 8;          /* Convert to slave PIC's local IRQ number (0-7) */
+		/* The slave only reaches the CPU through the master's cascade line (IRQ 2) */
+		outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << 2));
 	}
 
 	/* Read current mask, clear the bit for this IRQ (0 = unmasked), and write back.
@@ -170,6 +172,8 @@ void pic_mask(uint8_t irq) {
 	else {
 		port = PIC2_DATA;  /* IRQs 8-15: Slave PIC */
 		irq -= 8;          /* Convert to slave PIC's local IRQ number (0-7) */
+		/* The slave only reaches the CPU through the master's cascade line (IRQ 2) */
+		outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << 2));
 	}
 	/* Read current mask, set the bit for this IRQ (1 = masked), and write back */
 	value = inb(port) | (1 << irq);
@@ -241,3 +245,15 @@ uint16_t pic_get_irr(void) {
 uint16_t pic_get_isr(void) {
 	return pic_get_irq_reg(PIC_READ_ISR);
 }
+
+/**
+ * Mask every line of both PICs.
+ *
+ * Used when the IOAPIC takes over: the 8259s stay initialized (their vectors
+ * remain 32-47, so a stray interrupt still lands in irq_handler()) but never
+ * raise a line again.
+ */
+void pic_disable(void) {
+	outb(PIC1_DATA, 0xFF);
+	outb(PIC2_DATA, 0xFF);
+}
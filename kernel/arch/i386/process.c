@@ -0,0 +1,647 @@
+/**
+ * User Processes
+ *
+ * Life of a process:
+ *
+ *   process_create()  new page directory, thread with cr3 = that directory
+ *   process_start()   (in the thread, own directory loaded) map image, stack
+ *                     and clock page, enter_user_mode() → ring 3 at USER_CODE_START
+ *   SYSCALL_EXIT / fatal fault → process_exit() → thread_exit()
+ *   process_reap()    (next thread) free user pages and directory → ZOMBIE
+ *   process_wait()    collect exit code, free the process
+ *
+ * process_exec() creates the same way, but the thread maps only the stack;
+ * the ELF segments recorded by elf_load() fault in page by page.
+ *
+ * process_fork() makes the child's directory with paging_clone_directory()
+ * (copy-on-write, only page tables are copied) and starts its thread on a copy
+ * of the parent's system call frame, so both return from the same int 0x80.
+ *
+ * Mapping happens in the new thread itself, so paging_map() works on the
+ * current directory as usual and no other address space has to be edited.
+ *
+ * process_lock guards the process list and PID counter. Each process's own
+ * lock guards its segments and heap bounds, which its page faults read while
+ * its ring polling thread may be changing them from another CPU.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/process.h>
+#include <kernel/thread.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/wait.h>
+#include <kernel/elf.h>
+#include <kernel/ioring.h>
+#include <kernel/vclock.h>
+#include <kernel/klog.h>
+#include <kernel/vfs.h>
+#include <kernel/uaccess.h>
+
+#include "include/interrupts.h"
+
+static inline uint32_t page_align_up(uint32_t addr) {
+    return (addr + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+/* Drop to ring 3 (switch.nasm) */
+extern void enter_user_mode(uint32_t entry, uint32_t user_esp) __attribute__((noreturn));
+extern void enter_user_frame(regs_t* frame) __attribute__((noreturn));
+
+static spinlock_t process_lock = SPINLOCK_INIT;
+static uint32_t next_pid = 1;
+/* Every process from creation until process_wait() */
+static process_t* process_list = NULL;
+
+/**
+ * Give a process its thread and publish it
+ */
+static void process_attach(process_t* proc, thread_t* thread) {
+    spin_lock_init(&proc->lock);
+    proc->thread = thread;
+    proc->live_threads = 1;
+    proc->state = PROCESS_RUNNING;
+    wait_queue_init(&proc->exit_wait);
+    thread->process = proc;
+    thread->cr3 = proc->page_directory;
+    spin_lock(&process_lock);
+    proc->pid = next_pid++;
+    proc->next = process_list;
+    process_list = proc;
+    spin_unlock(&process_lock);
+}
+
+/**
+ * Map fresh frames for [start, start + len) in the current address space
+ *
+ * @return 0 on success, -1 if out of memory (frames mapped so far stay mapped
+ *         and are freed with the directory)
+ */
+static int process_map_user(uint32_t start, size_t len) {
+    for (uint32_t addr = start; addr < start + len; addr += PAGE_SIZE) {
+        uint32_t frame = frame_alloc_zeroed();
+        if (frame == 0 || paging_map(addr, frame, PTE_WRITABLE | PTE_USER) != 0) {
+            if (frame != 0) {
+                frame_free(frame);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * First code of a process's thread: load the program and enter ring 3
+ */
+static void process_start(void* arg) {
+    process_t* proc = (process_t*) arg;
+    size_t image_len = (proc->image_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t stack_len = USER_STACK_PAGES * PAGE_SIZE;
+    if ((proc->image != NULL && process_map_user(USER_CODE_START, image_len) != 0) ||
+        process_map_user(USER_STACK_TOP - stack_len, stack_len) != 0 || vclock_map() != 0) {
+        klog(KLOG_ERR, "[FAILED] process_start: Out of memory loading process %u\n", proc->pid);
+        kfree(proc->image);
+        proc->image = NULL;
+        process_exit(-1);
+    }
+    if (proc->image != NULL) {
+        memcpy((void*) USER_CODE_START, proc->image, proc->image_size);
+        kfree(proc->image);
+        proc->image = NULL;
+    }
+    enter_user_mode(proc->entry, USER_STACK_TOP);
+}
+
+/**
+ * Give a prepared process its directory and thread
+ *
+ * @return proc, or NULL after freeing it (and its image) on failure
+ */
+static process_t* process_launch(const char* name, process_t* proc) {
+    /* The heap starts above the program: its image, or its highest segment */
+    uint32_t top = USER_CODE_START + page_align_up(proc->image_size);
+    for (uint32_t i = 0; i < proc->segment_count; i++) {
+        top = proc->segments[i].end > top ? proc->segments[i].end : top;
+    }
+    proc->heap_start = top;
+    proc->heap_end = top;
+    proc->page_directory = paging_create_directory();
+    if (proc->page_directory == 0) {
+        kfree(proc->image);
+        kfree(proc);
+        return NULL;
+    }
+    /* The thread must not run before it has its directory */
+    thread_t* thread = thread_prepare(name, process_start, proc);
+    if (thread == NULL) {
+        paging_destroy_directory(proc->page_directory);
+        kfree(proc->image);
+        kfree(proc);
+        return NULL;
+    }
+    process_attach(proc, thread);
+    thread_launch(thread);
+    return proc;
+}
+
+/**
+ * Start a user program in a new address space
+ */
+process_t* process_create(const char* name, const void* image, size_t size) {
+    if (!sched_active()) {
+        klog(KLOG_ERR, "[FAILED] process_create: Scheduler not initialized\n");
+        return NULL;
+    }
+    if (image == NULL || size == 0 || size > USER_IMAGE_MAX) {
+        klog(KLOG_ERR, "[FAILED] process_create: Invalid image (%zu bytes, max %u)\n", size, USER_IMAGE_MAX);
+        return NULL;
+    }
+    process_t* proc = (process_t*) kcalloc(1, sizeof(process_t));
+    void* copy = proc ? kmalloc(size) : NULL;
+    if (copy == NULL) {
+        klog(KLOG_ERR, "[FAILED] process_create: Out of memory for '%s'\n", name);
+        kfree(proc);
+        return NULL;
+    }
+    memcpy(copy, image, size);
+    proc->image = copy;
+    proc->image_size = size;
+    proc->entry = USER_CODE_START;
+    return process_launch(name, proc);
+}
+
+/**
+ * Describe a resident VFS file as a module, so elf_load() can map it the same way
+ *
+ * @return 0, or -1 if the path doesn't name a file held in memory
+ */
+static int exec_file(const char* path, module_t* mod) {
+    dentry_t* dentry = vfs_lookup(path);
+    inode_t* inode = dentry != NULL ? dentry->inode : NULL;
+    if (inode == NULL || inode->type != VFS_TYPE_FILE || inode->ops->memory == NULL) {
+        return -1;
+    }
+    mod->data = inode->ops->memory(inode, &mod->phys);
+    if (mod->data == NULL) {
+        return -1;
+    }
+    mod->size = inode->size;
+    size_t len = strlen(dentry->name);
+    if (len >= MODULE_NAME_MAX) {
+        len = MODULE_NAME_MAX - 1;
+    }
+    memcpy(mod->name, dentry->name, len);
+    mod->name[len] = '\0';
+    return 0;
+}
+
+/**
+ * Start an ELF executable from a boot module or the VFS
+ */
+process_t* process_exec(const char* name) {
+    if (!sched_active()) {
+        klog(KLOG_ERR, "[FAILED] process_exec: Scheduler not initialized\n");
+        return NULL;
+    }
+    /* elf_load() keeps only the data and phys pointers, so the module may live on this stack */
+    module_t file;
+    const module_t* mod;
+    if (strchr(name, '/') != NULL) {
+        mod = exec_file(name, &file) == 0 ? &file : NULL;
+    }
+    else {
+        mod = module_find(name);
+    }
+    if (mod == NULL) {
+        klog(KLOG_ERR, "[FAILED] process_exec: No module or resident file named '%s'\n", name);
+        return NULL;
+    }
+    process_t* proc = (process_t*) kcalloc(1, sizeof(process_t));
+    if (proc == NULL) {
+        klog(KLOG_ERR, "[FAILED] process_exec: Out of memory for '%s'\n", name);
+        return NULL;
+    }
+    if (elf_load(proc, mod) != 0) {
+        kfree(proc);
+        return NULL;
+    }
+    return process_launch(name, proc);
+}
+
+/**
+ * First code of a forked child: return to ring 3 where the parent made the syscall
+ */
+static void process_fork_start(void* arg) {
+    /* The frame moves onto our own stack; iret takes it from there */
+    regs_t frame = *(regs_t*) arg;
+    kfree(arg);
+    enter_user_frame(&frame);
+}
+
+/**
+ * Duplicate the calling process
+ */
+int process_fork(const regs_t* frame) {
+    process_t* parent = process_current();
+    if (parent == NULL) {
+        klog(KLOG_ERR, "[FAILED] process_fork: Not called from a process\n");
+        return -1;
+    }
+    process_t* child = (process_t*) kcalloc(1, sizeof(process_t));
+    regs_t* child_frame = child ? (regs_t*) kmalloc(sizeof(regs_t)) : NULL;
+    if (child_frame == NULL) {
+        klog(KLOG_ERR, "[FAILED] process_fork: Out of memory\n");
+        kfree(child);
+        return -1;
+    }
+    *child_frame = *frame;
+    child_frame->eax = 0;  /* fork() returns 0 in the child */
+    /* Pages the parent never touched still fault in from the same segments */
+    child->entry = parent->entry;
+    child->heap_start = parent->heap_start;
+    child->heap_end = parent->heap_end;
+    memcpy(child->segments, parent->segments, sizeof(child->segments));
+    child->segment_count = parent->segment_count;
+    /* Open files are shared, offsets included */
+    vfs_fd_copy(child->files, parent->files);
+    child->page_directory = paging_clone_directory();
+    if (child->page_directory == 0) {
+        vfs_fd_close_all(child->files);
+        kfree(child_frame);
+        kfree(child);
+        return -1;
+    }
+    thread_t* thread = thread_prepare(parent->thread->name, process_fork_start, child_frame);
+    if (thread == NULL) {
+        paging_destroy_directory(child->page_directory);
+        vfs_fd_close_all(child->files);
+        kfree(child_frame);
+        kfree(child);
+        return -1;
+    }
+    process_attach(child, thread);
+    thread_set_priority(thread, parent->thread->base_priority);
+    uint32_t pid = child->pid;
+    thread_launch(thread);
+    return (int) pid;
+}
+
+/**
+ * Find a process by PID
+ */
+process_t* process_find(uint32_t pid) {
+    spin_lock(&process_lock);
+    process_t* proc = process_list;
+    while (proc != NULL && proc->pid != pid) {
+        proc = proc->next;
+    }
+    spin_unlock(&process_lock);
+    return proc;
+}
+
+/**
+ * Wait for a process to exit and free it
+ */
+int process_wait(process_t* proc) {
+    /* Check under the queue's lock: once it is ours, process_reap() is done touching proc */
+    uint32_t flags = wait_begin(&proc->exit_wait);
+    while (proc->state != PROCESS_ZOMBIE) {
+        wait_sleep(&proc->exit_wait);
+    }
+    wait_end(&proc->exit_wait, flags);
+    int exit_code = proc->exit_code;
+    spin_lock(&process_lock);
+    process_t** link = &process_list;
+    while (*link != NULL && *link != proc) {
+        link = &(*link)->next;
+    }
+    if (*link != NULL) {
+        *link = proc->next;
+    }
+    spin_unlock(&process_lock);
+    kfree(proc);
+    return exit_code;
+}
+
+/**
+ * Process of the running thread
+ */
+process_t* process_current(void) {
+    thread_t* thread = thread_current();
+    return thread ? thread->process : NULL;
+}
+
+/**
+ * Terminate the running thread, recording an exit code if it belongs to a process
+ */
+void process_exit(int exit_code) {
+    process_t* proc = process_current();
+    if (proc != NULL) {
+        proc->exit_code = exit_code;
+        /* A ring polling thread shares the address space; it has to finish before it can be freed */
+        ioring_stop(proc);
+    }
+    thread_exit();
+}
+
+/**
+ * Drop the pages in [start, end) that have faulted in, releasing their frames
+ */
+static void unmap_range(uint32_t start, uint32_t end) {
+    if (end > start) {
+        paging_unmap_range(start, end - start, frame_release);
+    }
+}
+
+/**
+ * Check whether [start, end) overlaps a segment of a process
+ */
+static bool segments_overlap(const process_t* proc, uint32_t start, uint32_t end) {
+    for (uint32_t i = 0; i < proc->segment_count; i++) {
+        if (start < proc->segments[i].end && proc->segments[i].start < end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Highest free range of len bytes in the mmap area, top-down
+ *
+ * @return Its start, or 0 if none is left
+ */
+static uint32_t mmap_find_free(const process_t* proc, uint32_t len) {
+    uint32_t start = USER_MMAP_TOP - len;
+    while (start >= USER_MMAP_BASE) {
+        /* Below the lowest segment that overlaps, if any */
+        uint32_t lowest = start;
+        bool overlap = false;
+        for (uint32_t i = 0; i < proc->segment_count; i++) {
+            const process_segment_t* seg = &proc->segments[i];
+            if (start < seg->end && seg->start < start + len) {
+                lowest = seg->start < lowest ? seg->start : lowest;
+                overlap = true;
+            }
+        }
+        if (!overlap) {
+            return start;
+        }
+        if (lowest < USER_MMAP_BASE + len) {
+            break;
+        }
+        start = lowest - len;
+    }
+    return 0;
+}
+
+/**
+ * Map a file or anonymous memory into the calling process
+ */
+uint32_t process_mmap(uint32_t addr, size_t len, uint32_t prot, uint32_t flags, file_t* file, uint32_t offset) {
+    process_t* proc = process_current();
+    uint32_t share = flags & (MMAP_SHARED | MMAP_PRIVATE);
+    bool anonymous = (flags & MMAP_ANONYMOUS) != 0;
+    if (proc == NULL || len == 0 || len > USER_MMAP_TOP - USER_MMAP_BASE || !(prot & MMAP_PROT_READ) ||
+        (share != MMAP_SHARED && share != MMAP_PRIVATE) || (anonymous && share == MMAP_SHARED) ||
+        (flags & ~(MMAP_SHARED | MMAP_PRIVATE | MMAP_FIXED | MMAP_ANONYMOUS)) != 0) {
+        return MMAP_FAILED;
+    }
+    uint32_t length = (len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    /* Resolve the file bytes before touching the address space */
+    const uint8_t* data = NULL;
+    uint32_t phys = 0, file_size = 0;
+    if (!anonymous) {
+        inode_t* inode = file != NULL ? file->inode : NULL;
+        if (inode == NULL || inode->type != VFS_TYPE_FILE || inode->ops->memory == NULL ||
+            (offset & (PAGE_SIZE - 1)) != 0 || offset > inode->size ||
+            (share == MMAP_SHARED && (prot & MMAP_PROT_WRITE))) {
+            return MMAP_FAILED;
+        }
+        data = (const uint8_t*) inode->ops->memory(inode, &phys);
+        if (data == NULL) {
+            return MMAP_FAILED;
+        }
+        data += offset;
+        phys += offset;
+        file_size = inode->size - offset < length ? inode->size - offset : length;
+    }
+
+    spin_lock(&proc->lock);
+    uint32_t start;
+    if (flags & MMAP_FIXED) {
+        start = addr;
+        if ((start & (PAGE_SIZE - 1)) != 0 || start < USER_MMAP_BASE || start > USER_MMAP_TOP - length ||
+            segments_overlap(proc, start, start + length)) {
+            start = 0;
+        }
+    }
+    else {
+        start = mmap_find_free(proc, length);
+    }
+    if (start == 0 || proc->segment_count == PROCESS_MAX_SEGMENTS) {
+        spin_unlock(&proc->lock);
+        return MMAP_FAILED;
+    }
+    process_segment_t* seg = &proc->segments[proc->segment_count++];
+    seg->start = start;
+    seg->end = start + length;
+    seg->vaddr = start;
+    seg->file = data;
+    seg->file_phys = phys;
+    seg->file_size = file_size;
+    seg->flags = PTE_USER | ((prot & MMAP_PROT_WRITE) ? PTE_WRITABLE : 0);
+    seg->mmap = true;
+    spin_unlock(&proc->lock);
+    return start;
+}
+
+/**
+ * Remove a mapping of the calling process
+ */
+int process_munmap(uint32_t addr, size_t len) {
+    process_t* proc = process_current();
+    if (proc == NULL) {
+        return -1;
+    }
+    uint32_t length = (len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    spin_lock(&proc->lock);
+    for (uint32_t i = 0; i < proc->segment_count; i++) {
+        process_segment_t* seg = &proc->segments[i];
+        if (!seg->mmap || seg->start != addr || seg->end - seg->start != length) {
+            continue;
+        }
+        /* Pages that faulted in hold a frame reference each (shared archive frames included) */
+        unmap_range(seg->start, seg->end);
+        *seg = proc->segments[--proc->segment_count];
+        spin_unlock(&proc->lock);
+        return 0;
+    }
+    spin_unlock(&proc->lock);
+    return -1;
+}
+
+/**
+ * Move the end of the calling process's heap
+ */
+uint32_t process_brk(uint32_t end) {
+    process_t* proc = process_current();
+    if (proc == NULL) {
+        return 0;
+    }
+    spin_lock(&proc->lock);
+    uint32_t old_top = page_align_up(proc->heap_end);
+    uint32_t new_top = page_align_up(end);
+    bool ok = end >= proc->heap_start && end <= USER_MMAP_BASE &&
+              (new_top <= old_top || !segments_overlap(proc, old_top, new_top));
+    if (ok) {
+        /* Pages given back start zero-filled again if the heap grows over them later */
+        if (new_top < old_top) {
+            unmap_range(new_top, old_top);
+        }
+        proc->heap_end = end;
+    }
+    uint32_t result = proc->heap_end;
+    spin_unlock(&proc->lock);
+    return result;
+}
+
+/**
+ * Give memory of the calling process back to the kernel
+ */
+int process_madvise(uint32_t addr, size_t len, uint32_t advice) {
+    process_t* proc = process_current();
+    uint32_t end = page_align_up(addr + len);
+    if (proc == NULL || (addr & (PAGE_SIZE - 1)) != 0 || end < addr || !access_ok(addr, end - addr)) {
+        return -1;
+    }
+    if (advice != MADV_DONTNEED) {
+        return advice == MADV_NORMAL || advice == MADV_WILLNEED ? 0 : -1;
+    }
+    spin_lock(&proc->lock);
+    /* Only pages that can fault back in: heap and segments, not the eagerly mapped image and stack */
+    for (uint32_t page = addr; page < end; page += PAGE_SIZE) {
+        bool backed = page >= proc->heap_start && page < page_align_up(proc->heap_end);
+        for (uint32_t i = 0; i < proc->segment_count && !backed; i++) {
+            backed = page >= proc->segments[i].start && page < proc->segments[i].end;
+        }
+        if (!backed) {
+            spin_unlock(&proc->lock);
+            return -1;
+        }
+    }
+    unmap_range(addr, end);
+    spin_unlock(&proc->lock);
+    return 0;
+}
+
+/**
+ * Back a not-present page of a process's segments (process locked)
+ */
+static int process_fault_locked(process_t* proc, uint32_t page) {
+    const process_segment_t* seg = NULL;
+    uint32_t covering = 0;
+    uint32_t flags = 0;
+    for (uint32_t i = 0; i < proc->segment_count; i++) {
+        if (page >= proc->segments[i].start && page < proc->segments[i].end) {
+            seg = &proc->segments[i];
+            flags |= seg->flags;
+            covering++;
+        }
+    }
+    /* The heap is anonymous memory: zero-filled, writable */
+    if (page >= proc->heap_start && page < page_align_up(proc->heap_end)) {
+        flags |= PTE_USER | PTE_WRITABLE;
+        covering++;
+    }
+    if (covering == 0) {
+        return -1;
+    }
+
+    /* Read-only page made only of file bytes: map the module's frame itself, shared by every instance */
+    if (covering == 1 && !(flags & PTE_WRITABLE) && page >= seg->vaddr &&
+        page + PAGE_SIZE <= seg->vaddr + seg->file_size) {
+        uint32_t frame = seg->file_phys + (page - seg->vaddr);
+        if ((frame & (PAGE_SIZE - 1)) == 0 && frame_ref(frame) == 0) {
+            if (paging_map(page, frame, flags) == 0) {
+                return 0;
+            }
+            frame_release(frame);
+            return -1;
+        }
+    }
+
+    /* Private page: zeroed frame, copy in the file bytes, then apply the permissions */
+    uint32_t frame = frame_alloc_zeroed();
+    if (frame == 0 || paging_map(page, frame, flags | PTE_WRITABLE) != 0) {
+        if (frame != 0) {
+            frame_free(frame);
+        }
+        klog(KLOG_ERR, "[FAILED] process_handle_fault: Out of memory backing %p\n", page);
+        return -1;
+    }
+    for (uint32_t i = 0; i < proc->segment_count; i++) {
+        seg = &proc->segments[i];
+        uint32_t lo = page > seg->vaddr ? page : seg->vaddr;
+        uint32_t hi = seg->vaddr + seg->file_size;
+        if (hi > page + PAGE_SIZE) {
+            hi = page + PAGE_SIZE;
+        }
+        if (lo < hi) {
+            memcpy((void*) lo, seg->file + (lo - seg->vaddr), hi - lo);
+        }
+    }
+    if (!(flags & PTE_WRITABLE)) {
+        paging_map(page, frame, flags);
+    }
+    return 0;
+}
+
+/**
+ * Back a not-present page of the current process's segments
+ *
+ * Segments may share a boundary page, so every segment covering the page
+ * contributes its bytes and its permissions.
+ */
+int process_handle_fault(uint32_t fault_addr) {
+    process_t* proc = process_current();
+    if (proc == NULL) {
+        return -1;
+    }
+    /* Held until the page is mapped, so munmap() can't drop the segment in between */
+    spin_lock(&proc->lock);
+    int result = process_fault_locked(proc, fault_addr & ~(PAGE_SIZE - 1));
+    spin_unlock(&proc->lock);
+    return result;
+}
+
+/**
+ * Release an exited process's address space
+ */
+void process_reap(process_t* proc, thread_t* thread) {
+    spin_lock(&proc->lock);
+    if (proc->thread == thread) {
+        proc->thread = NULL;
+    }
+    uint32_t live = --proc->live_threads;
+    spin_unlock(&proc->lock);
+    if (live > 0) {
+        return;
+    }
+    paging_destroy_directory(proc->page_directory);
+    proc->page_directory = 0;
+    kfree(proc->ioring);
+    proc->ioring = NULL;
+    vfs_fd_close_all(proc->files);
+    kfree(proc->image);
+    proc->image = NULL;
+    /* process_wait() may free proc as soon as it sees the state, so both happen under the queue's lock */
+    uint32_t flags = wait_begin(&proc->exit_wait);
+    proc->state = PROCESS_ZOMBIE;
+    wake_up_locked(&proc->exit_wait);
+    wait_end(&proc->exit_wait, flags);
+}
@@ -0,0 +1,375 @@
+/**
+ * Sampling Profiler
+ *
+ * The timer IRQ does as little as possible: copy EIP and, if asked, the
+ * frame pointer chain into the next ring slot. Everything else (symbol
+ * lookup, aggregation) happens when a report is printed, with sampling
+ * paused so the ring holds still.
+ *
+ * Aggregation uses small open-addressed hash tables allocated for the
+ * report:
+ *   flat    function base → samples (self time)
+ *   folded  stack of function bases → samples
+ * so a report is O(samples), plus one symbol lookup per address.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/profile.h>
+#include <kernel/debug.h>
+#include <kernel/kheap.h>
+#include <kernel/serial.h>
+#include <kernel/klog.h>
+#include <kernel/shell.h>
+
+#define PROFILE_RING_MASK       (PROFILE_RING_SIZE - 1)
+
+/* Function keys for addresses that don't resolve */
+#define PROFILE_KEY_UNKNOWN     0       /* Kernel address without a symbol */
+#define PROFILE_KEY_USER        1       /* Anywhere in ring 3 */
+
+#define PROFILE_SHELL_TOP       10      /* Functions "prof top" shows by default */
+
+/* Ring state; there is one CPU, so one ring */
+typedef struct {
+    profile_sample_t* samples;          /* PROFILE_RING_SIZE slots, allocated on first start */
+    volatile uint32_t head;             /* Samples written since profile_start() */
+    uint32_t interval;                  /* Ticks per sample */
+    uint32_t countdown;                 /* Ticks left until the next sample */
+    bool callchain;
+    volatile bool running;
+} profile_ring_t;
+
+static profile_ring_t ring;
+
+/* A distinct function or stack seen in the samples */
+typedef struct {
+    uint32_t key;                       /* Function base, or hash of the stack */
+    uint32_t count;
+    uint32_t first;                     /* Oldest sample with this key (folded) */
+} profile_bucket_t;
+
+/**
+ * Start sampling
+ */
+int profile_start(uint32_t interval, bool callchain) {
+    ring.running = false;
+    if (ring.samples == NULL) {
+        ring.samples = (profile_sample_t*) kmalloc(PROFILE_RING_SIZE * sizeof(profile_sample_t));
+        if (ring.samples == NULL) {
+            klog(KLOG_ERR, "[FAILED] profile_start: Out of memory for %u samples\n", PROFILE_RING_SIZE);
+            return -1;
+        }
+    }
+    ring.head = 0;
+    ring.interval = interval ? interval : 1;
+    ring.countdown = ring.interval;
+    ring.callchain = callchain;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    ring.running = true;
+    return 0;
+}
+
+/**
+ * Stop sampling
+ */
+void profile_stop(void) {
+    ring.running = false;
+}
+
+/**
+ * Check whether sampling is on
+ */
+bool profile_running(void) {
+    return ring.running;
+}
+
+/**
+ * Record a sample (timer IRQ)
+ */
+void profile_tick(const regs_t* r) {
+    if (!ring.running || --ring.countdown != 0) {
+        return;
+    }
+    ring.countdown = ring.interval;
+    profile_sample_t* sample = &ring.samples[ring.head & PROFILE_RING_MASK];
+    sample->eip = r->eip;
+    sample->user = (r->cs & 3) != 0;
+    sample->depth = 0;
+    if (ring.callchain && !sample->user) {
+        sample->depth = (uint8_t) debug_unwind(r->ebp, sample->frames, PROFILE_MAX_DEPTH);
+    }
+    ring.head++;
+}
+
+/**
+ * Number of samples in the ring and the index of the oldest
+ */
+static uint32_t profile_window(uint32_t* oldest) {
+    uint32_t head = ring.head;
+    uint32_t count = head < PROFILE_RING_SIZE ? head : PROFILE_RING_SIZE;
+    *oldest = head - count;
+    return ring.samples ? count : 0;
+}
+
+/**
+ * Copy the recorded samples, oldest first
+ */
+size_t profile_read(profile_sample_t* out, size_t max) {
+    bool was_running = ring.running;
+    ring.running = false;
+    uint32_t oldest;
+    uint32_t count = profile_window(&oldest);
+    if (count > max) {
+        oldest += count - max;
+        count = max;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = ring.samples[(oldest + i) & PROFILE_RING_MASK];
+    }
+    ring.running = was_running;
+    return count;
+}
+
+/**
+ * Function key of an address: its function's base, or a PROFILE_KEY_* value
+ *
+ * @param addr Code address
+ * @param is_return addr is a return address (look up the call before it)
+ */
+static uint32_t profile_function(uint32_t addr, bool is_return) {
+    uint32_t base = 0;
+    if (debug_find_symbol(is_return ? addr - 1 : addr, &base) == NULL) {
+        return PROFILE_KEY_UNKNOWN;
+    }
+    return base;
+}
+
+/**
+ * Printable name of a function key
+ */
+static const char* profile_function_name(uint32_t key) {
+    if (key == PROFILE_KEY_USER) {
+        return "[user]";
+    }
+    const char* name = key == PROFILE_KEY_UNKNOWN ? NULL : debug_find_symbol(key, NULL);
+    return name ? name : "[unknown]";
+}
+
+/**
+ * Function key of the instruction a sample interrupted
+ */
+static uint32_t profile_leaf(const profile_sample_t* sample) {
+    return sample->user ? PROFILE_KEY_USER : profile_function(sample->eip, false);
+}
+
+/**
+ * Find or insert a key in an open-addressed table (size is a power of two)
+ *
+ * @return Bucket, or NULL if the table is full
+ */
+static profile_bucket_t* profile_bucket(profile_bucket_t* table, uint32_t size, uint32_t key, uint32_t hash) {
+    for (uint32_t probe = 0; probe < size; probe++) {
+        profile_bucket_t* bucket = &table[(hash + probe) & (size - 1)];
+        if (bucket->count == 0) {
+            bucket->key = key;
+            return bucket;
+        }
+        if (bucket->key == key) {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Table size for n keys: a power of two at least twice n
+ */
+static uint32_t profile_table_size(uint32_t n) {
+    uint32_t size = 16;
+    while (size < 2 * n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/**
+ * Print the functions with the most samples
+ */
+void profile_print_flat(uint32_t top) {
+    bool was_running = ring.running;
+    ring.running = false;
+    uint32_t oldest;
+    uint32_t count = profile_window(&oldest);
+    uint32_t size = profile_table_size(count);
+    profile_bucket_t* table = count ? (profile_bucket_t*) kcalloc(size, sizeof(profile_bucket_t)) : NULL;
+    if (table == NULL) {
+        printf(count ? "[FAILED] profile_print_flat: Out of memory\n" : "No samples\n");
+        ring.running = was_running;
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t key = profile_leaf(&ring.samples[(oldest + i) & PROFILE_RING_MASK]);
+        profile_bucket(table, size, key, key * 2654435761u)->count++;
+    }
+
+    uint32_t lost = ring.head - count;
+    printf("%u samples (%u overwritten)\n", count, lost);
+    printf("  samples  percent  function\n");
+    for (uint32_t shown = 0; shown < top; shown++) {
+        /* Selection: top is small, the table is not sorted */
+        profile_bucket_t* best = NULL;
+        for (uint32_t i = 0; i < size; i++) {
+            if (table[i].count != 0 && (best == NULL || table[i].count > best->count)) {
+                best = &table[i];
+            }
+        }
+        if (best == NULL) {
+            break;
+        }
+        uint32_t permille = best->count * 1000 / count;  /* count <= PROFILE_RING_SIZE, no overflow */
+        printf("  %u  %u.%u%%  %s\n", best->count, permille / 10, permille % 10, profile_function_name(best->key));
+        best->count = 0;
+    }
+    kfree(table);
+    ring.running = was_running;
+}
+
+/**
+ * Function keys of a sample's stack, outermost first
+ *
+ * @return Number of keys
+ */
+static uint32_t profile_stack(const profile_sample_t* sample, uint32_t* keys) {
+    uint32_t n = 0;
+    for (uint32_t i = sample->depth; i-- > 0;) {
+        keys[n++] = profile_function(sample->frames[i], true);
+    }
+    keys[n++] = profile_leaf(sample);
+    return n;
+}
+
+/**
+ * Hash of a stack (FNV-1a over the function keys)
+ */
+static uint32_t profile_stack_hash(const uint32_t* keys, uint32_t n) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < n; i++) {
+        hash = (hash ^ keys[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Write the samples as folded stacks to a serial port
+ */
+void profile_print_folded(uint16_t port) {
+    bool was_running = ring.running;
+    ring.running = false;
+    uint32_t oldest;
+    uint32_t count = profile_window(&oldest);
+    uint32_t size = profile_table_size(count);
+    profile_bucket_t* table = count ? (profile_bucket_t*) kcalloc(size, sizeof(profile_bucket_t)) : NULL;
+    if (table == NULL) {
+        if (count) {
+            klog(KLOG_ERR, "[FAILED] profile_print_folded: Out of memory\n");
+        }
+        ring.running = was_running;
+        return;
+    }
+
+    /*
+     * Merge samples by stack. Buckets are keyed by the stack hash; two
+     * different stacks with the same hash are compared and the second one is
+     * moved on to the next bucket (key + 1), so neither is lost.
+     */
+    uint32_t keys[PROFILE_MAX_DEPTH + 1], other[PROFILE_MAX_DEPTH + 1];
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = (oldest + i) & PROFILE_RING_MASK;
+        uint32_t n = profile_stack(&ring.samples[index], keys);
+        uint32_t key = profile_stack_hash(keys, n);
+        profile_bucket_t* bucket;
+        for (;;) {
+            bucket = profile_bucket(table, size, key, key);
+            if (bucket->count == 0) {
+                bucket->first = index;
+                break;
+            }
+            uint32_t m = profile_stack(&ring.samples[bucket->first], other);
+            if (m == n && memcmp(keys, other, n * sizeof(uint32_t)) == 0) {
+                break;
+            }
+            key++;
+        }
+        bucket->count++;
+    }
+
+    for (uint32_t i = 0; i < size; i++) {
+        if (table[i].count == 0) {
+            continue;
+        }
+        uint32_t n = profile_stack(&ring.samples[table[i].first], keys);
+        for (uint32_t j = 0; j < n; j++) {
+            serial_write_string(port, profile_function_name(keys[j]));
+            serial_write_char(port, j + 1 < n ? ';' : ' ');
+        }
+        char line_end[16];
+        snprintf(line_end, sizeof(line_end), "%u\n", table[i].count);
+        serial_write_string(port, line_end);
+    }
+    kfree(table);
+    ring.running = was_running;
+}
+
+/**
+ * Shell command: prof
+ *
+ * Controls the sampling profiler:
+ *   prof start [-g] [ticks]   sample every 'ticks' timer ticks (default 1), -g with call chains
+ *   prof stop
+ *   prof top [n]              functions with the most samples
+ *   prof folded               folded stacks on COM1 (flamegraph.pl input)
+ *
+ * @param args Command arguments
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(prof, "sampling profiler: start [-g] [ticks] | stop | top [n] | folded") {
+    if (args[1] != NULL && strcmp(args[1], "start") == 0) {
+        bool callchain = false;
+        uint32_t interval = 1;
+        for (int i = 2; args[i] != NULL; i++) {
+            if (strcmp(args[i], "-g") == 0) {
+                callchain = true;
+            }
+            else if (!shell_parse_uint(args[i], &interval)) {
+                printf("prof: invalid interval '%s'\n", args[i]);
+                return 1;
+            }
+        }
+        if (profile_start(interval, callchain) == 0) {
+            printf("Profiling every %u ticks%s\n", interval ? interval : 1, callchain ? " with call chains" : "");
+        }
+    }
+    else if (args[1] != NULL && strcmp(args[1], "stop") == 0) {
+        profile_stop();
+    }
+    else if (args[1] != NULL && strcmp(args[1], "top") == 0) {
+        uint32_t top = PROFILE_SHELL_TOP;
+        if (args[2] != NULL && !shell_parse_uint(args[2], &top)) {
+            printf("prof: invalid count '%s'\n", args[2]);
+            return 1;
+        }
+        profile_print_flat(top);
+    }
+    else if (args[1] != NULL && strcmp(args[1], "folded") == 0) {
+        profile_print_folded(SERIAL_COM1_BASE);
+    }
+    else {
+        printf("usage: prof start [-g] [ticks] | stop | top [n] | folded\n");
+    }
+    return 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * Read-Copy-Update Grace Periods
+ *
+ * Readers touch only their own CPU's counters (percpu.h):
+ *
+ *   rcu_read_lock():   preempt off → rcu_nesting++
+ *   rcu_read_unlock(): rcu_nesting-- → 0? rcu_seq++ → preempt on
+ *
+ * synchronize_rcu() looks at every other online CPU once:
+ *
+ *   seq = rcu_seq, then rcu_nesting == 0?   outside any reader: done with it
+ *   else wait until rcu_seq != seq          the reader we saw has ended
+ *
+ * The reader's increment (lock xadd) and the writer's fence before the reads
+ * order "publish the pointer" against "enter a section": a reader the writer
+ * misses is one that began afterwards, so it already sees the new pointer.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/rcu.h>
+#include <kernel/smp.h>
+#include <kernel/thread.h>
+
+#include "include/percpu.h"
+
+/**
+ * Enter a read-side section
+ */
+void rcu_read_lock(void) {
+    preempt_disable();
+    __atomic_add_fetch(&cpu_self()->rcu_nesting, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Leave a read-side section
+ */
+void rcu_read_unlock(void) {
+    cpu_t* cpu = cpu_self();
+    if (__atomic_sub_fetch(&cpu->rcu_nesting, 1, __ATOMIC_RELEASE) == 0) {
+        __atomic_add_fetch(&cpu->rcu_seq, 1, __ATOMIC_RELEASE);
+    }
+    preempt_enable();
+}
+
+/**
+ * Wait for the readers on other CPUs
+ */
+void synchronize_rcu(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    cpu_t* self = cpu_self();
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t* cpu = &cpus[i];
+        if (cpu == self || !__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        uint32_t seq = __atomic_load_n(&cpu->rcu_seq, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&cpu->rcu_nesting, __ATOMIC_ACQUIRE) == 0) {
+            continue;
+        }
+        while (__atomic_load_n(&cpu->rcu_seq, __ATOMIC_ACQUIRE) == seq) {
+            asm volatile("pause");
+        }
+    }
+}
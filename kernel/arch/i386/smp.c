@@ -0,0 +1,179 @@
+/**
+ * Application Processor Startup
+ *
+ * The boot CPU starts every other CPU of the MADT, one at a time:
+ *
+ *   copy smp_trampoline to SMP_TRAMPOLINE_BASE, fill in its parameter block
+ *   INIT IPI → 10 ms → STARTUP IPI (vector = trampoline page) → 200 µs
+ *     → second STARTUP IPI if the AP isn't online yet → wait up to 100 ms
+ *   AP: trampoline (real mode → protected mode → paging) → smp_ap_main(cpu)
+ *     → own GDT and TSS, FS = its cpu_t → shared IDT → LAPIC, FPU and SYSENTER set up → online
+ *     → TLB flushed, from now on reached by TLB shootdowns
+ *     → LAPIC timer ticking → its boot stack becomes its idle thread, it runs threads (thread.c)
+ *
+ * Reference: Intel SDM Vol. 3A, 8.4.4 "MP Initialization Example"
+ *
+ * Each AP has its own run queue. New and woken threads go to the least busy
+ * CPU, pinned ones (thread_create_on()) to theirs; a wakeup for another CPU
+ * is signalled with a reschedule IPI. Device interrupts still only reach the
+ * boot CPU: the IOAPIC delivers there, and the clock and the timer wheel stay
+ * on IRQ 0. An AP's LAPIC timer only ends time slices.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/smp.h>
+#include <kernel/kheap.h>
+#include <kernel/paging.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/fpu.h>
+#include <kernel/klog.h>
+
+#include "include/percpu.h"
+#include "include/apic.h"
+#include "include/acpi.h"
+#include "include/interrupts.h"
+#include "include/syscall.h"
+
+#define SMP_TRAMPOLINE_BASE     0x8000      /* Must match smp_trampoline.nasm; page-aligned, below 1 MiB */
+#define SMP_INIT_DELAY_MS       10
+#define SMP_SIPI_DELAY_US       200
+#define SMP_ONLINE_TIMEOUT_MS   100
+
+/* Parameter block at the end of the trampoline (smp_trampoline.nasm) */
+typedef struct {
+    uint32_t cr0;
+    uint32_t cr3;
+    uint32_t cr4;
+    uint32_t stack;
+    uint32_t cpu;
+} __attribute__((packed)) smp_trampoline_params_t;
+
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_params[];
+extern uint8_t smp_trampoline_end[];
+
+cpu_t cpus[SMP_MAX_CPUS];
+static volatile uint32_t cpus_online = 1;
+
+/**
+ * Entry point of an application processor, called by the trampoline on its own stack
+ */
+__attribute__((noreturn)) void smp_ap_main(cpu_t* cpu) {
+    gdt_init_cpu(cpu);
+    idt_load_cpu();
+    lapic_init_cpu();
+    fpu_init_cpu();
+    syscall_init_cpu();
+    __atomic_add_fetch(&cpus_online, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&cpu->online, true, __ATOMIC_SEQ_CST);
+    paging_init_cpu();
+    timer_init_cpu();
+    sched_init_cpu();
+}
+
+/**
+ * Wait until a CPU reports online or a timeout expires
+ *
+ * @return true if it came online
+ */
+static bool smp_wait_online(cpu_t* cpu, uint64_t timeout_ns) {
+    uint64_t start = ktime_ns();
+    while (!__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE)) {
+        if (ktime_ns() - start >= timeout_ns) {
+            return false;
+        }
+        asm volatile("pause");
+    }
+    return true;
+}
+
+/**
+ * Start one application processor with INIT-SIPI-SIPI
+ *
+ * @return 0 once it is online, -1 if it didn't respond
+ */
+static int smp_start_cpu(cpu_t* cpu, smp_trampoline_params_t* params) {
+    void* stack = kmalloc(THREAD_STACK_SIZE);
+    if (stack == NULL) {
+        klog(KLOG_ERR, "[FAILED] smp_init: Out of memory for the stack of CPU %u\n", cpu->id);
+        return -1;
+    }
+    cpu->stack_top = ((uint32_t) stack + THREAD_STACK_SIZE) & ~0xFu;
+    params->stack = cpu->stack_top;
+    params->cpu = (uint32_t) cpu;
+
+    uint8_t vector = SMP_TRAMPOLINE_BASE >> 12;
+    lapic_send_ipi(cpu->apic_id, LAPIC_IPI_INIT);
+    ksleep(SMP_INIT_DELAY_MS);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        lapic_send_ipi(cpu->apic_id, LAPIC_IPI_STARTUP | vector);
+        if (smp_wait_online(cpu, attempt == 0 ? SMP_SIPI_DELAY_US * 1000ull : SMP_ONLINE_TIMEOUT_MS * 1000000ull)) {
+            return 0;
+        }
+    }
+    klog(KLOG_ERR, "[FAILED] smp_init: CPU %u (APIC ID %u) did not start\n", cpu->id, cpu->apic_id);
+    /* Leave the stack allocated in case it wakes up late */
+    return -1;
+}
+
+/**
+ * Start the application processors
+ */
+uint32_t smp_init(void) {
+    const acpi_madt_t* madt = acpi_madt();
+    if (!apic_enabled() || madt == NULL) {
+        return cpus_online;
+    }
+    cpus[0].apic_id = lapic_id();
+    cpus[0].online = true;
+
+    size_t size = (size_t) (smp_trampoline_end - smp_trampoline_start);
+    uint8_t* trampoline = (uint8_t*) SMP_TRAMPOLINE_BASE;
+    memcpy(trampoline, smp_trampoline_start, size);
+    smp_trampoline_params_t* params =
+        (smp_trampoline_params_t*) (trampoline + (smp_trampoline_params - smp_trampoline_start));
+    uint32_t cr0, cr4;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    params->cr0 = cr0;
+    params->cr3 = paging_kernel_directory();
+    params->cr4 = cr4;
+
+    uint32_t next_id = 1;
+    for (uint32_t i = 0; i < madt->cpu_count; i++) {
+        if (madt->cpu_apic_ids[i] == cpus[0].apic_id) {
+            continue;
+        }
+        if (next_id == SMP_MAX_CPUS) {
+            klog(KLOG_ERR, "[FAILED] smp_init: Only %u CPUs supported, ignoring the rest\n", SMP_MAX_CPUS);
+            break;
+        }
+        /* A CPU that didn't respond keeps its slot: it may still start late and use it */
+        cpu_t* cpu = &cpus[next_id];
+        cpu->id = next_id++;
+        cpu->apic_id = madt->cpu_apic_ids[i];
+        smp_start_cpu(cpu, params);
+    }
+    klog(KLOG_INFO, "[  OK  ] SMP initialized (%u of %u CPUs online).\n", cpus_online, madt->cpu_count);
+    return cpus_online;
+}
+
+/**
+ * Number of CPUs online, the boot CPU included
+ */
+uint32_t smp_cpu_count(void) {
+    return cpus_online;
+}
+
+/**
+ * Index of the running CPU (0 = boot CPU)
+ */
+uint32_t smp_processor_id(void) {
+    return cpu_self()->id;
+}
@@ -0,0 +1,190 @@
+/**
+ * Deferred Interrupt Work (Tasklets)
+ *
+ *   IRQ → handler → tasklet_schedule() → pending queue
+ *       → EOI → softirq_irq_exit(): sti, run queue, cli → sched_preempt()
+ *
+ * The queue is a singly linked FIFO changed only under pending_lock, with
+ * interrupts off. A drain takes the whole list at once and runs it with
+ * interrupts on; work queued meanwhile waits for the next round. in_softirq
+ * (claimed under the same lock) keeps a nested IRQ, or an IRQ exit on another
+ * CPU, from starting a second drain beside the first, so a tasklet never runs
+ * on two CPUs at once. Preemption stays off during a drain so the interrupted
+ * thread gets its stack back before any other thread runs.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <kernel/softirq.h>
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/klog.h>
+#include <kernel/spinlock.h>
+
+static spinlock_t pending_lock = SPINLOCK_INIT;
+static tasklet_t* pending_head = NULL;
+static tasklet_t* pending_tail = NULL;
+static volatile bool in_softirq = false;
+static softirq_stats_t stats;
+
+static thread_t* ksoftirqd = NULL;
+static wait_queue_t ksoftirqd_wait = WAIT_QUEUE_INIT;
+
+/**
+ * Initialize a tasklet
+ */
+void tasklet_init(tasklet_t* tasklet, void (*func)(void*), void* data) {
+    tasklet->func = func;
+    tasklet->data = data;
+    tasklet->next = NULL;
+    tasklet->state = 0;
+}
+
+/**
+ * Queue a tasklet to run after the current IRQ
+ */
+bool tasklet_schedule(tasklet_t* tasklet) {
+    uint32_t flags = spin_lock_irqsave(&pending_lock);
+    if (tasklet->state & TASKLET_QUEUED) {
+        spin_unlock_irqrestore(&pending_lock, flags);
+        return false;
+    }
+    tasklet->state |= TASKLET_QUEUED;
+    tasklet->next = NULL;
+    if (pending_tail != NULL) {
+        pending_tail->next = tasklet;
+    }
+    else {
+        pending_head = tasklet;
+    }
+    pending_tail = tasklet;
+    stats.scheduled++;
+    spin_unlock_irqrestore(&pending_lock, flags);
+    return true;
+}
+
+/**
+ * Check whether tasklets are queued
+ */
+bool softirq_pending(void) {
+    return __atomic_load_n(&pending_head, __ATOMIC_RELAXED) != NULL;
+}
+
+/**
+ * Claim the drain if tasklets are queued and nobody drains them (interrupts disabled)
+ *
+ * @return true if the caller now runs the queue and must call softirq_end()
+ */
+static bool softirq_begin(void) {
+    spin_lock(&pending_lock);
+    bool claimed = !in_softirq && pending_head != NULL;
+    if (claimed) {
+        in_softirq = true;
+    }
+    spin_unlock(&pending_lock);
+    return claimed;
+}
+
+/**
+ * Give up the drain claimed with softirq_begin() (interrupts disabled)
+ *
+ * @return true if tasklets arrived that nobody has run yet
+ */
+static bool softirq_end(void) {
+    spin_lock(&pending_lock);
+    in_softirq = false;
+    bool more = pending_head != NULL;
+    spin_unlock(&pending_lock);
+    return more;
+}
+
+/**
+ * Run the tasklets queued so far (interrupts disabled on entry and exit)
+ *
+ * @param from_thread Called from ksoftirqd (for the counters)
+ */
+static void softirq_drain(bool from_thread) {
+    spin_lock(&pending_lock);
+    tasklet_t* tasklet = pending_head;
+    pending_head = pending_tail = NULL;
+    spin_unlock(&pending_lock);
+    asm volatile("sti" : : : "memory");
+    while (tasklet != NULL) {
+        tasklet_t* next = tasklet->next;
+        /* Clear before the call: the tasklet (or an IRQ) may queue it again */
+        __atomic_and_fetch(&tasklet->state, ~TASKLET_QUEUED, __ATOMIC_SEQ_CST);
+        tasklet->func(tasklet->data);
+        stats.runs++;
+        if (from_thread) {
+            stats.thread_runs++;
+        }
+        tasklet = next;
+    }
+    asm volatile("cli" : : : "memory");
+}
+
+/**
+ * Run queued tasklets at the end of an IRQ
+ */
+void softirq_irq_exit(void) {
+    if (in_softirq || pending_head == NULL || !softirq_begin()) {
+        return;
+    }
+    preempt_disable();
+    for (uint32_t round = 0; round < SOFTIRQ_MAX_ROUNDS && pending_head != NULL; round++) {
+        softirq_drain(false);
+    }
+    bool more = softirq_end();
+    /* Interrupts are off here: the switch, if due, happens in sched_preempt() */
+    preempt_enable();
+    if (more && ksoftirqd != NULL) {
+        wake_up(&ksoftirqd_wait);
+    }
+}
+
+/**
+ * ksoftirqd: runs tasklets that kept arriving faster than IRQ exits drained them
+ */
+static void softirq_thread(void* arg) {
+    (void) arg;
+    for (;;) {
+        wait_event(&ksoftirqd_wait, pending_head != NULL);
+        uint32_t flags = irq_save();
+        if (softirq_begin()) {
+            preempt_disable();
+            softirq_drain(true);
+            softirq_end();
+            preempt_enable();
+        }
+        irq_restore(flags);
+        /* Let the threads at this priority run between rounds */
+        thread_yield();
+    }
+}
+
+/**
+ * Start the ksoftirqd thread
+ */
+int softirq_init(void) {
+    if (ksoftirqd != NULL) {
+        return 0;
+    }
+    ksoftirqd = thread_create("ksoftirqd", softirq_thread, NULL);
+    if (ksoftirqd == NULL) {
+        klog(KLOG_ERR, "[FAILED] softirq_init: Could not create ksoftirqd\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Copy the tasklet counters
+ */
+void softirq_get_stats(softirq_stats_t* out) {
+    uint32_t flags = spin_lock_irqsave(&pending_lock);
+    *out = stats;
+    spin_unlock_irqrestore(&pending_lock, flags);
+}
@@ -0,0 +1,109 @@
+/**
+ * Reader-Writer Locks
+ *
+ * Readers count themselves in, writers announce themselves and wait for the
+ * count to drain:
+ *
+ *   read_lock():  wait while writing → readers++ → writing after all? readers--, retry
+ *   write_lock(): writer ticket lock → writing = 1 → wait until readers == 0
+ *
+ * The increment and the writer's store of writing are both full barriers
+ * (lock xadd, xchg), so of a reader and a writer arriving together at least
+ * one sees the other and backs off.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/spinlock.h>
+
+/**
+ * Initialize an unlocked reader-writer lock
+ */
+void rwlock_init(rwlock_t* lock) {
+    spin_lock_init(&lock->writer);
+    lock->readers = 0;
+    lock->writing = 0;
+}
+
+/**
+ * Acquire for reading
+ */
+void read_lock(rwlock_t* lock) {
+    preempt_disable();
+    for (;;) {
+        while (__atomic_load_n(&lock->writing, __ATOMIC_ACQUIRE)) {
+            tlb_shootdown_poll();
+            asm volatile("pause");
+        }
+        __atomic_add_fetch(&lock->readers, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&lock->writing, __ATOMIC_SEQ_CST)) {
+            return;
+        }
+        /* A writer got in first: let it drain the readers */
+        __atomic_sub_fetch(&lock->readers, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Release a read hold
+ */
+void read_unlock(rwlock_t* lock) {
+    __atomic_sub_fetch(&lock->readers, 1, __ATOMIC_RELEASE);
+    preempt_enable();
+}
+
+/**
+ * Acquire for writing
+ */
+void write_lock(rwlock_t* lock) {
+    spin_lock(&lock->writer);
+    __atomic_store_n(&lock->writing, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&lock->readers, __ATOMIC_ACQUIRE) != 0) {
+        tlb_shootdown_poll();
+        asm volatile("pause");
+    }
+}
+
+/**
+ * Release a write hold
+ */
+void write_unlock(rwlock_t* lock) {
+    __atomic_store_n(&lock->writing, 0, __ATOMIC_RELEASE);
+    spin_unlock(&lock->writer);
+}
+
+/**
+ * Disable interrupts, then acquire for reading
+ */
+uint32_t read_lock_irqsave(rwlock_t* lock) {
+    uint32_t flags = irq_save();
+    read_lock(lock);
+    return flags;
+}
+
+/**
+ * Release a read hold and restore interrupts
+ */
+void read_unlock_irqrestore(rwlock_t* lock, uint32_t flags) {
+    __atomic_sub_fetch(&lock->readers, 1, __ATOMIC_RELEASE);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+/**
+ * Disable interrupts, then acquire for writing
+ */
+uint32_t write_lock_irqsave(rwlock_t* lock) {
+    uint32_t flags = irq_save();
+    write_lock(lock);
+    return flags;
+}
+
+/**
+ * Release a write hold and restore interrupts
+ */
+void write_unlock_irqrestore(rwlock_t* lock, uint32_t flags) {
+    __atomic_store_n(&lock->writing, 0, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&lock->writer, flags);
+}
@@ -0,0 +1,151 @@
+/**
+ * Mutexes, Semaphores and Condition Variables
+ *
+ * Each primitive is a small piece of state plus a wait queue. State is only
+ * changed between wait_begin() and wait_end(), under the queue's lock, so
+ * testing it and going to sleep is atomic with respect to the releasing side:
+ *
+ *   mutex_lock():   locked? → sleep in waiters → re-check → take it
+ *   mutex_unlock(): locked = false → wake the longest waiter
+ *
+ * A woken waiter competes with threads that arrive meanwhile; whoever runs
+ * first takes the lock and the other goes back to sleep.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <kernel/sync.h>
+#include <kernel/wait.h>
+#include <kernel/thread.h>
+#include <kernel/klog.h>
+
+/**
+ * Initialize an unlocked mutex
+ */
+void mutex_init(mutex_t* mutex) {
+    mutex->locked = false;
+    mutex->owner = NULL;
+    wait_queue_init(&mutex->waiters);
+}
+
+/**
+ * Acquire a mutex, sleeping while another thread holds it
+ */
+void mutex_lock(mutex_t* mutex) {
+    uint32_t flags = wait_begin(&mutex->waiters);
+    while (mutex->locked) {
+        wait_sleep(&mutex->waiters);
+    }
+    mutex->locked = true;
+    mutex->owner = thread_current();
+    wait_end(&mutex->waiters, flags);
+}
+
+/**
+ * Acquire a mutex only if it is free
+ */
+bool mutex_trylock(mutex_t* mutex) {
+    uint32_t flags = wait_begin(&mutex->waiters);
+    bool acquired = !mutex->locked;
+    if (acquired) {
+        mutex->locked = true;
+        mutex->owner = thread_current();
+    }
+    wait_end(&mutex->waiters, flags);
+    return acquired;
+}
+
+/**
+ * Release a mutex held by the calling thread
+ */
+void mutex_unlock(mutex_t* mutex) {
+    uint32_t flags = wait_begin(&mutex->waiters);
+    if (!mutex->locked || mutex->owner != thread_current()) {
+        wait_end(&mutex->waiters, flags);
+        klog(KLOG_ERR, "[FAILED] mutex_unlock: Mutex not held by the calling thread\n");
+        return;
+    }
+    mutex->locked = false;
+    mutex->owner = NULL;
+    wake_up_one_locked(&mutex->waiters);
+    wait_end(&mutex->waiters, flags);
+}
+
+/**
+ * Initialize a semaphore
+ */
+void sem_init(semaphore_t* sem, int32_t count) {
+    sem->count = count;
+    wait_queue_init(&sem->waiters);
+}
+
+/**
+ * Take one unit, sleeping until one is available
+ */
+void sem_wait(semaphore_t* sem) {
+    uint32_t flags = wait_begin(&sem->waiters);
+    while (sem->count <= 0) {
+        wait_sleep(&sem->waiters);
+    }
+    sem->count--;
+    wait_end(&sem->waiters, flags);
+}
+
+/**
+ * Take one unit only if one is available
+ */
+bool sem_trywait(semaphore_t* sem) {
+    uint32_t flags = wait_begin(&sem->waiters);
+    bool taken = sem->count > 0;
+    if (taken) {
+        sem->count--;
+    }
+    wait_end(&sem->waiters, flags);
+    return taken;
+}
+
+/**
+ * Return one unit and wake a waiter
+ */
+void sem_post(semaphore_t* sem) {
+    uint32_t flags = wait_begin(&sem->waiters);
+    sem->count++;
+    wake_up_one_locked(&sem->waiters);
+    wait_end(&sem->waiters, flags);
+}
+
+/**
+ * Initialize a condition variable
+ */
+void cond_init(condvar_t* cond) {
+    wait_queue_init(&cond->waiters);
+}
+
+/**
+ * Release a mutex, sleep until signalled, then re-acquire the mutex
+ */
+void cond_wait(condvar_t* cond, mutex_t* mutex) {
+    /* The queue stays locked from the unlock until we sleep, so no signal slips in between */
+    uint32_t flags = wait_begin(&cond->waiters);
+    mutex_unlock(mutex);
+    wait_sleep(&cond->waiters);
+    wait_end(&cond->waiters, flags);
+    mutex_lock(mutex);
+}
+
+/**
+ * Wake one thread waiting on a condition variable
+ */
+void cond_signal(condvar_t* cond) {
+    wake_up_one(&cond->waiters);
+}
+
+/**
+ * Wake every thread waiting on a condition variable
+ */
+void cond_broadcast(condvar_t* cond) {
+    wake_up(&cond->waiters);
+}
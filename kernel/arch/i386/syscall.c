@@ -1,5 +1,5 @@
 /**
- * System Call Interface (int 0x80)
+ * System Call Interface (int 0x80, SYSENTER)
  *
  * This module implements the system call interface for user-space programs. When a user program needs kernel
  * services (I/O, memory allocation, etc.), it uses the 'int 0x80' instruction to trigger a controlled transition
@@ -13,6 +13,10 @@
  * 5. Handler validates request and performs privileged operation
  * 6. iret returns to Ring 3 with result in EAX
  *
+ * SYSENTER is the fast path to the same handler: no IDT lookup, no privilege check through a gate descriptor, and
+ * SYSEXIT instead of iret. It saves no return state, so the caller passes its stack pointer in EBP with the
+ * return address on top (see sysenter_entry in isr_stubs.nasm); ECX and EDX come back clobbered.
+ *
  * Register Convention (follows Linux i386 ABI):
  * - EAX: System call number (input) / Return value (output)
  * - EBX: Argument 1 (e.g., file descriptor for read/write)
@@ -21,101 +25,416 @@
  * - ESI: Argument 4
  * - EDI: Argument 5
  *
+ * Each number indexes syscall_table, which holds the handler, its arity and which argument is a user buffer (and
+ * which one its length), so a new system call is one handler plus one table entry.
+ *
  * Available System Calls:
  * - SYSCALL_EXIT   (1):  Exit user program (status in EBX)
+ * - SYSCALL_FORK   (2):  Duplicate the calling process (child PID in the parent, 0 in the child)
  * - SYSCALL_READ   (3):  Read from fd (EBX=fd, ECX=buf, EDX=count)
  * - SYSCALL_WRITE  (4):  Write to fd (EBX=fd, ECX=buf, EDX=count)
+ * - SYSCALL_OPEN   (5):  Open a file (EBX=path, ECX=flags), returns its fd
+ * - SYSCALL_CLOSE  (6):  Close a file (EBX=fd)
+ * - SYSCALL_LSEEK  (19): Move a file's offset (EBX=fd, ECX=offset, EDX=whence), returns the new one
+ * - SYSCALL_BRK    (45): Move the end of the heap (EBX=new end, 0 to query), returns the end after the call
+ * - SYSCALL_MMAP   (90): Map memory (EBX=pointer to addr, len, prot, flags, fd, offset), returns the address
+ * - SYSCALL_MUNMAP (91): Remove a mapping (EBX=addr, ECX=len)
+ * - SYSCALL_MADVISE (219): Advise on a range (EBX=addr, ECX=len, EDX=advice); MADV_DONTNEED frees its pages
+ * - SYSCALL_IORING_SETUP (425): Map a submission/completion ring (EBX=entries, ECX=flags), returns its address
+ * - SYSCALL_IORING_ENTER (426): Run queued submissions (EBX=to_submit, ECX=min_complete, EDX=flags)
  */
 #include <stdio.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <kernel/syscall.h>
+#include <kernel/keyboard.h>
+#include <kernel/thread.h>
+#include <kernel/process.h>
+#include <kernel/paging.h>
+#include <kernel/gdt.h>
+#include <kernel/uaccess.h>
+#include <kernel/ioring.h>
+#include <kernel/trace.h>
+#include <kernel/klog.h>
+#include <kernel/vfs.h>
 
 #include "include/interrupts.h"
-#include "include/gdt.h"
+#include "include/cpuid.h"
+#include "include/msr.h"
 
 /* Forward declaration of idt_set_gate (defined in idt.c) */
 extern void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
 /* Assembly stub for system call interrupt handler (defined in isr_stubs.nasm) */
 extern void isr128(void);
+/* SYSENTER entry stub (defined in isr_stubs.nasm) */
+extern void sysenter_entry(void);
+
+/* True once the SYSENTER MSRs are programmed */
+static bool sysenter_available = false;
+
+/**
+ * System call handler function
+ *
+ * @param r Saved registers of the caller (for calls that need the whole frame, like fork)
+ * @param args Arguments from EBX, ECX, EDX, ESI, EDI; those past the entry's arity are 0
+ * @return Value for EAX
+ */
+typedef uint32_t (*syscall_fn_t)(regs_t* r, const uint32_t* args);
+
+/**
+ * System call table entry
+ *
+ * buf_arg/len_arg describe one user buffer argument (1-based indexes, 0 for
+ * none). The dispatcher checks it once, so handlers can use the pointer.
+ */
+typedef struct {
+    syscall_fn_t handler;
+    const char* name;
+    uint8_t arity;          /* Number of register arguments used */
+    uint8_t buf_arg;        /* Argument holding a user buffer address */
+    uint8_t len_arg;        /* Argument holding that buffer's length */
+} syscall_entry_t;
+
+#define SYSCALL_MAX_ARGS    5
+
+/**
+ * SYSCALL_EXIT: end the calling thread (and its process)
+ */
+static uint32_t sys_exit(regs_t* r, const uint32_t* args) {
+    (void) r;
+    int exit_code = (int) args[0];
+    printf("\n[SYSCALL] User program exited with code %d\n", exit_code);
+    /* The calling thread (and its process, if any) ends here; other threads keep running */
+    if (sched_active()) {
+        process_exit(exit_code);
+    }
+    /* Without a scheduler, loop forever in kernel mode instead of returning to user mode */
+    while (1) {
+        asm volatile("hlt");
+    }
+}
+
+/**
+ * SYSCALL_FORK: duplicate the calling process
+ */
+static uint32_t sys_fork(regs_t* r, const uint32_t* args) {
+    (void) args;
+    /* The child starts from a copy of this frame, with EAX = 0 */
+    return (uint32_t) process_fork(r);
+}
+
+/**
+ * SYSCALL_READ: read from fd (stdin, fd 0, or an open file)
+ */
+static uint32_t sys_read(regs_t* r, const uint32_t* args) {
+    (void) r;
+    int fd = (int) args[0];
+    char* buf = (char*) args[1];
+    size_t count = (size_t) args[2];
+    if (fd != 0) {
+        file_t* file = vfs_fd_get(fd);
+        if (file == NULL) {
+            return (uint32_t) -1;  /* Error: fd not open */
+        }
+        return (uint32_t) vfs_read(file, buf, count);
+    }
+    if (count == 0) {
+        return 0;
+    }
+    /* Sleep once, then take everything already typed (or one line in canonical mode) */
+    return keyboard_read(buf, count);  /* Bytes read */
+}
+
+/**
+ * SYSCALL_WRITE: write to fd (stdout, fd 1, and stderr, fd 2)
+ */
+static uint32_t sys_write(regs_t* r, const uint32_t* args) {
+    (void) r;
+    int fd = (int) args[0];
+    const char* buf = (const char*) args[1];
+    size_t count = (size_t) args[2];
+    if (fd != 1 && fd != 2) {
+        return (uint32_t) -1;  /* Error: unsupported fd */
+    }
+    if (count == 0) {
+        return 0;
+    }
+    /* Hand the whole buffer to the console in one call (no per-byte formatting) */
+    return fwrite(buf, 1, count, fd == 2 ? stderr : stdout);  /* Bytes written */
+}
+
+/**
+ * SYSCALL_OPEN: open a file of the VFS (read-only)
+ */
+static uint32_t sys_open(regs_t* r, const uint32_t* args) {
+    (void) r;
+    char path[VFS_PATH_MAX];
+    if (strncpy_from_user(path, (const char*) args[0], sizeof(path)) < 0) {
+        return (uint32_t) -1;  /* Error: bad or too long path */
+    }
+    file_t* file = vfs_open(path, args[1]);
+    if (file == NULL) {
+        return (uint32_t) -1;  /* Error: no such file, or opened for writing */
+    }
+    int fd = vfs_fd_install(file);
+    if (fd < 0) {
+        vfs_close(file);
+    }
+    return (uint32_t) fd;
+}
+
+/**
+ * SYSCALL_CLOSE: close a file descriptor
+ */
+static uint32_t sys_close(regs_t* r, const uint32_t* args) {
+    (void) r;
+    return (uint32_t) vfs_fd_close((int) args[0]);
+}
+
+/**
+ * SYSCALL_LSEEK: move the offset of an open file
+ */
+static uint32_t sys_lseek(regs_t* r, const uint32_t* args) {
+    (void) r;
+    file_t* file = vfs_fd_get((int) args[0]);
+    if (file == NULL) {
+        return (uint32_t) -1;  /* Error: fd not open */
+    }
+    return (uint32_t) vfs_lseek(file, (int32_t) args[1], (int) args[2]);
+}
+
+/**
+ * SYSCALL_BRK: move the end of the caller's heap
+ */
+static uint32_t sys_brk(regs_t* r, const uint32_t* args) {
+    (void) r;
+    return process_brk(args[0]);
+}
+
+/**
+ * SYSCALL_MMAP: map a file or anonymous memory into the caller
+ *
+ * Six arguments don't fit the registers, so EBX points to them (Linux old_mmap).
+ */
+static uint32_t sys_mmap(regs_t* r, const uint32_t* args) {
+    (void) r;
+    struct {
+        uint32_t addr, len, prot, flags;
+        int32_t fd;
+        uint32_t offset;
+    } a;
+    if (copy_from_user(&a, (const void*) args[0], sizeof(a)) != 0) {
+        return MMAP_FAILED;
+    }
+    file_t* file = NULL;
+    if (!(a.flags & MMAP_ANONYMOUS) && (file = vfs_fd_get(a.fd)) == NULL) {
+        return MMAP_FAILED;  /* Error: fd not open */
+    }
+    return process_mmap(a.addr, a.len, a.prot, a.flags, file, a.offset);
+}
+
+/**
+ * SYSCALL_MUNMAP: remove a mapping of the caller
+ */
+static uint32_t sys_munmap(regs_t* r, const uint32_t* args) {
+    (void) r;
+    return (uint32_t) process_munmap(args[0], args[1]);
+}
+
+/**
+ * SYSCALL_MADVISE: give memory of the caller back to the kernel
+ */
+static uint32_t sys_madvise(regs_t* r, const uint32_t* args) {
+    (void) r;
+    return (uint32_t) process_madvise(args[0], args[1], args[2]);
+}
+
+/**
+ * SYSCALL_IORING_SETUP: map a submission/completion ring into the caller
+ */
+static uint32_t sys_ioring_setup(regs_t* r, const uint32_t* args) {
+    (void) r;
+    return (uint32_t) ioring_setup(args[0], args[1]);
+}
+
+/**
+ * SYSCALL_IORING_ENTER: run queued submissions, optionally wait for completions
+ */
+static uint32_t sys_ioring_enter(regs_t* r, const uint32_t* args) {
+    (void) r;
+    return (uint32_t) ioring_enter(args[0], args[1], args[2]);
+}
+
+/**
+ * System call table, indexed by system call number
+ *
+ * The numbers are the ABI: an entry never moves, unused slots stay NULL.
+ */
+static const syscall_entry_t syscall_table[] = {
+    [SYSCALL_EXIT]  = { sys_exit,  "exit",  1, 0, 0 },
+    [SYSCALL_FORK]  = { sys_fork,  "fork",  0, 0, 0 },
+    [SYSCALL_READ]  = { sys_read,  "read",  3, 2, 3 },
+    [SYSCALL_WRITE] = { sys_write, "write", 3, 2, 3 },
+    [SYSCALL_OPEN]  = { sys_open,  "open",  2, 0, 0 },
+    [SYSCALL_CLOSE] = { sys_close, "close", 1, 0, 0 },
+    [SYSCALL_LSEEK] = { sys_lseek, "lseek", 3, 0, 0 },
+    [SYSCALL_BRK]   = { sys_brk,   "brk",   1, 0, 0 },
+    [SYSCALL_MMAP]  = { sys_mmap,  "mmap",  1, 0, 0 },
+    [SYSCALL_MUNMAP] = { sys_munmap, "munmap", 2, 0, 0 },
+    [SYSCALL_MADVISE] = { sys_madvise, "madvise", 3, 0, 0 },
+    [SYSCALL_IORING_SETUP] = { sys_ioring_setup, "ioring_setup", 2, 0, 0 },
+    [SYSCALL_IORING_ENTER] = { sys_ioring_enter, "ioring_enter", 3, 0, 0 },
+};
+
+#define SYSCALL_TABLE_SIZE  (sizeof(syscall_table) / sizeof(syscall_table[0]))
+
+/**
+ * Check that a syscall buffer is addressable by the caller
+ *
+ * Ring 3 callers may only pass memory in the user range, so a process can't
+ * make the kernel read or write kernel memory for it.
+ *
+ * @param r Saved registers of the caller
+ * @param buf Buffer address
+ * @param count Buffer length in bytes (non-zero)
+ * @return true if the buffer is acceptable
+ */
+static inline bool syscall_buffer_ok(regs_t* r, uint32_t buf, size_t count) {
+    if ((r->cs & 0x3) == 3) {
+        return access_ok(buf, count);
+    }
+    return buf != 0 && buf + count >= buf;  /* Not NULL and doesn't wrap around */
+}
+
+/**
+ * Name of a system call
+ */
+const char* syscall_name(uint32_t num) {
+    if (num < SYSCALL_TABLE_SIZE && syscall_table[num].handler != NULL) {
+        return syscall_table[num].name;
+    }
+    return "unknown";
+}
 
 /**
  * System call handler
  *
- * This is invoked when a user-mode program executes 'int 0x80'. The system call number is in EAX, and up to 5 arguments
- * can be passed in EBX, ECX, EDX, ESI, EDI.
+ * This is invoked when a user-mode program executes 'int 0x80' (or SYSENTER). The system call number is in
+ * EAX, and up to 5 arguments can be passed in EBX, ECX, EDX, ESI, EDI.
  *
  * The handler:
- * 1. Validates the syscall number
- * 2. Performs the requested kernel operation
- * 3. Returns the result in EAX
- * 4. iret restores user mode execution
+ * 1. Looks the number up in syscall_table (one bounds check, no branch chain)
+ * 2. Collects the entry's arguments and validates its buffer argument, if any
+ * 3. Stores the handler's result in EAX
+ * 4. iret (or SYSEXIT) restores user mode execution
  *
  * @param r Pointer to saved CPU register state (on kernel stack)
  */
 void syscall_handler(regs_t* r) {
     uint32_t syscall_num = r->eax;
+    TRACE(SYSCALL, syscall_num, r->ebx);
+    if (syscall_num >= SYSCALL_TABLE_SIZE || syscall_table[syscall_num].handler == NULL) {
+        printf("[SYSCALL] Unknown system call: %u\n", syscall_num);
+        r->eax = (uint32_t) -1;  /* Error */
+        return;
+    }
+    const syscall_entry_t* entry = &syscall_table[syscall_num];
+
+    const uint32_t regs_args[SYSCALL_MAX_ARGS] = { r->ebx, r->ecx, r->edx, r->esi, r->edi };
+    uint32_t args[SYSCALL_MAX_ARGS] = { 0 };
+    for (uint32_t i = 0; i < entry->arity; i++) {
+        args[i] = regs_args[i];
+    }
+    /* Reject NULL buffers, ranges that wrap around and, from ring 3, kernel memory */
+    if (entry->buf_arg != 0) {
+        uint32_t len = args[entry->len_arg - 1];
+        if (len != 0 && !syscall_buffer_ok(r, args[entry->buf_arg - 1], len)) {
+            r->eax = (uint32_t) -1;  /* Error: bad buffer */
+            return;
+        }
+    }
+    r->eax = entry->handler(r, args);
+}
+
+/**
+ * Run a system call on behalf of the current process
+ */
+uint32_t syscall_invoke_user(uint32_t num, uint32_t arg1, uint32_t arg2, uint32_t arg3) {
+    regs_t r;
+    memset(&r, 0, sizeof(r));
+    r.cs = USER_CS;  /* Buffers are checked as if they came from ring 3 */
+    r.eax = num;
+    r.ebx = arg1;
+    r.ecx = arg2;
+    r.edx = arg3;
+    syscall_handler(&r);
+    return r.eax;
+}
 
-    switch (syscall_num) {
-        case SYSCALL_EXIT:
-            {
-                int exit_code = (int) r->ebx;
-                printf("\n[SYSCALL] User program exited with code %d\n", exit_code);
-                r->eax = 0;
-                /* Loop forever in kernel mode instead of returning to user mode */
-                while (1) {
-                    asm volatile("hlt");
-                }
-            }
-            break;
-
-        case SYSCALL_READ:
-            {
-                extern int getchar(void);  /* Kernel getchar */
-                int fd = (int) r->ebx;
-                char *buf = (char*) r->ecx;
-                size_t count = (size_t) r->edx;
-                /* For now, only support stdin (fd = 0) */
-                if (fd != 0) {
-                    r->eax = (uint32_t) -1;  /* Error: unsupported fd */
-                    break;
-                }
-                /* Read characters from keyboard */
-                size_t i;
-                for (i = 0; i < count; i++) {
-                    int c = getchar();
-                    if (c == -1) {
-                        break;  /* EOF or error */
-                    }
-                    buf[i] = (char) c;
-                }
-                r->eax = i;  /* Return number of bytes read */
-            }
-            break;
-
-        case SYSCALL_WRITE:
-            {
-                int fd = (int) r->ebx;
-                const char *buf = (const char*) r->ecx;
-                size_t count = (size_t) r->edx;
-                /* For now, only support stdout (fd = 1) and stderr (fd = 2) */
-                if (fd != 1 && fd != 2) {
-                    r->eax = (uint32_t) - 1;  /* Error: unsupported fd */
-                    break;
-                }
-                /* Write each character in the buffer */
-                for (size_t i = 0; i < count; i++) {
-                    printf("%c", buf[i]);
-                }
-                r->eax = count;  /* Return number of bytes written */
-            }
-            break;
-
-        default:
-            printf("[SYSCALL] Unknown system call: %u\n", syscall_num);
-            r->eax = (uint32_t) - 1;  /* Error */
-            break;
+/**
+ * SYSENTER system call handler
+ *
+ * Completes the frame built by sysenter_entry: the return address is the
+ * top word of the user stack. After dispatch, ECX and EDX carry the user
+ * ESP and EIP for SYSEXIT.
+ *
+ * @param r Pointer to saved CPU register state (on kernel stack)
+ */
+void sysenter_handler(regs_t* r) {
+    uint32_t user_esp = r->useresp;
+    if (user_esp < USER_SPACE_START || user_esp > USER_SPACE_END - sizeof(uint32_t) ||
+        (user_esp & (sizeof(uint32_t) - 1)) != 0) {
+        printf("[SYSCALL] SYSENTER with a bad user stack (%p), killing the caller\n", user_esp);
+        process_exit(-1);
     }
+    r->eip = *(const uint32_t*) user_esp;
+    r->useresp = user_esp + sizeof(uint32_t);
+    syscall_handler(r);
+    r->ecx = r->useresp;
+    r->edx = r->eip;
+}
+
+/**
+ * Check for a usable SYSENTER
+ *
+ * The Pentium Pro reports SEP but doesn't implement it (family 6, model < 3, stepping < 3).
+ */
+static bool sysenter_supported(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_LEAF_FEATURES, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_SEP)) {
+        return false;
+    }
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/**
+ * Check whether the SYSENTER entry point is set up
+ */
+bool syscall_sysenter_enabled(void) {
+    return sysenter_available;
+}
+
+/**
+ * Program the SYSENTER MSRs of the running CPU
+ */
+bool syscall_init_cpu(void) {
+    if (!sysenter_supported()) {
+        return false;
+    }
+    /* SYSENTER: CS from the MSR (SS = CS + 8, SYSEXIT returns to CS + 16 / SS + 24, i.e. USER_CS / USER_DS).
+     * ESP can't follow the running thread by itself, so it points at tss.esp0 and the stub loads the stack
+     * from there; each CPU's MSR at its own TSS. */
+    wrmsr(MSR_IA32_SYSENTER_CS, KERNEL_CS);
+    wrmsr(MSR_IA32_SYSENTER_ESP, (uint32_t) tss_kernel_stack_slot());
+    wrmsr(MSR_IA32_SYSENTER_EIP, (uint32_t) sysenter_entry);
+    return true;
 }
 
 /**
@@ -149,5 +468,8 @@ void syscall_init(void) {
     const uint16_t kernel_code_selector = KERNEL_CS;
     /* Set up interrupt 0x80 with Ring 3 access */
     idt_set_gate(0x80, (uint32_t) isr128, kernel_code_selector, flags_syscall_gate);
-    printf("[  OK  ] System call interface initialized (int 0x80, trap gate)\n");
+
+    sysenter_available = syscall_init_cpu();
+    klog(KLOG_INFO, "[  OK  ] System call interface initialized (int 0x80, trap gate%s)\n",
+                    sysenter_available ? ", SYSENTER" : "");
 }
@@ -0,0 +1,737 @@
+/**
+ * Kernel Threads and O(1) Priority Scheduling
+ *
+ * One FIFO run queue per priority level plus a bitmap of the non-empty ones.
+ * Priority 0 is the highest, so the next thread comes from the lowest set bit:
+ *
+ *   ready_bitmap = 0b...0001_0000_0100_0000 → bsf → level 6 → its queue head
+ *
+ * Enqueue, dequeue and pick each touch one queue and one bitmap word, no matter
+ * how many threads exist. The running thread is not in any queue.
+ *
+ *   IRQ 0 → sched_tick(): slice_left-- → 0? need_resched if an equal or higher level is ready
+ *   wakeup of a higher-priority thread → need_resched
+ *   end of IRQ → sched_preempt(): need_resched? schedule()
+ *   schedule(): current to the back of its level, switch to the best ready one
+ *
+ * A thread woken from an input wait is boosted below its base priority, so the
+ * shell gets the CPU as soon as a key arrives. The boost wears off by one level
+ * for every full time slice the thread then uses.
+ *
+ * The FPU/SSE registers are not part of the switch: fpu_switch() only sets
+ * CR0.TS, and the next FPU instruction swaps the state lazily (fpu.c).
+ *
+ * Each thread carries the page directory it runs in. CR3 is only reloaded when
+ * the next thread's differs, so switching between kernel threads keeps the
+ * whole TLB; kernel pages are global and survive the reload anyway.
+ *
+ * Switches happen on the kernel stack of the thread being switched out, inside
+ * whatever call chain got it there (an IRQ frame, thread_yield(), thread_block()).
+ * When the thread is picked again, context_switch() returns into that chain.
+ *
+ * Every CPU that runs threads has its own run queue (sched_rq_t), with its
+ * own lock, idle thread and preemption count. A queue and the state of the
+ * threads in it change under its lock with interrupts disabled, so a wakeup
+ * can come from any CPU. The lock is dropped before context_switch(): only
+ * the CPU that owns a queue takes threads off it.
+ *
+ * A thread only changes CPU when it starts or wakes up (select_cpu()); a
+ * preempted one goes back into the queue of the CPU it ran on. So the running
+ * thread and the preemption count of "this CPU" stay the same while a thread
+ * reads them, preempted or not. A thread that blocked is still on_cpu until
+ * the switch away from it is complete; a wakeup before that keeps it where it
+ * is rather than let another CPU resume a half-saved context.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/thread.h>
+#include <kernel/kheap.h>
+#include <kernel/gdt.h>
+#include <kernel/paging.h>
+#include <kernel/process.h>
+#include <kernel/trace.h>
+#include <kernel/fpu.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+#include <kernel/spinlock.h>
+#include <kernel/smp.h>
+
+#include "include/irqflags.h"
+#include "include/idle.h"
+#include "include/percpu.h"
+#include "include/apic.h"
+
+#define EFLAGS_RESERVED     0x002   /* Bit 1 of EFLAGS always reads as 1 */
+
+/* Assembly routine (switch.nasm) that saves the current context and resumes another */
+extern void context_switch(uint32_t* old_esp, uint32_t new_esp);
+/* Boot stack defined in boot.nasm; the boot thread keeps running on it */
+extern uint32_t stack_top;
+
+/* Scheduler state of one CPU */
+typedef struct {
+    spinlock_t lock;                    /* Queues, bitmap, current, and the state of threads in the queues */
+    uint32_t cpu;                       /* Index of this entry in runqueues[] */
+    thread_t* current;                  /* Running thread, NULL before this CPU runs threads */
+    thread_t* idle;                     /* Runs when every level is empty; never queued */
+    /* Run queue per priority level; bit n of ready_bitmap is set while level n is non-empty */
+    thread_t* head[SCHED_PRIO_LEVELS];
+    thread_t* tail[SCHED_PRIO_LEVELS];
+    uint32_t ready_bitmap;
+    uint32_t nr_ready;                  /* Threads in the queues, for select_cpu() */
+    /* Exited thread whose stack was still in use; freed right after the switch away from it */
+    thread_t* reap_pending;
+    /* Thread the last switch left; its on_cpu is cleared once we are off its stack */
+    thread_t* switched_from;
+    uint32_t slice_left;
+    volatile bool need_resched;
+    volatile uint32_t preempt_count;
+} sched_rq_t;
+
+static thread_t boot_thread;
+static sched_rq_t runqueues[SMP_MAX_CPUS];
+static uint32_t next_id = 1;
+
+/**
+ * Scheduler state of the running CPU
+ */
+static inline sched_rq_t* this_rq(void) {
+    return &runqueues[cpu_self()->id];
+}
+
+/**
+ * Index of the lowest set bit (value must be non-zero)
+ */
+static inline uint32_t bit_scan_forward(uint32_t value) {
+    uint32_t index;
+    asm("bsf %1, %0" : "=r"(index) : "rm"(value));
+    return index;
+}
+
+/**
+ * Bitmap of the levels at least as important as prio (0 .. prio)
+ */
+static inline uint32_t prio_mask_upto(uint32_t prio) {
+    return prio >= SCHED_PRIO_LEVELS - 1 ? 0xFFFFFFFF : (2u << prio) - 1;
+}
+
+/**
+ * Append a thread to the run queue of its priority on its CPU (queue locked)
+ */
+static void run_enqueue(thread_t* thread) {
+    sched_rq_t* rq = &runqueues[thread->cpu];
+    uint32_t prio = thread->priority;
+    thread->next = NULL;
+    thread->prev = rq->tail[prio];
+    if (rq->tail[prio] == NULL) {
+        rq->head[prio] = thread;
+        rq->ready_bitmap |= 1u << prio;
+    }
+    else {
+        rq->tail[prio]->next = thread;
+    }
+    rq->tail[prio] = thread;
+    rq->nr_ready++;
+}
+
+/**
+ * Unlink a queued thread from the run queue of its priority (queue locked)
+ */
+static void run_remove(thread_t* thread) {
+    sched_rq_t* rq = &runqueues[thread->cpu];
+    uint32_t prio = thread->priority;
+    if (thread->prev != NULL) {
+        thread->prev->next = thread->next;
+    }
+    else {
+        rq->head[prio] = thread->next;
+    }
+    if (thread->next != NULL) {
+        thread->next->prev = thread->prev;
+    }
+    else {
+        rq->tail[prio] = thread->prev;
+    }
+    if (rq->head[prio] == NULL) {
+        rq->ready_bitmap &= ~(1u << prio);
+    }
+    rq->nr_ready--;
+    thread->next = NULL;
+    thread->prev = NULL;
+}
+
+/**
+ * Take the first thread of the highest non-empty level (queue locked)
+ *
+ * @return Thread, or NULL if nothing is ready
+ */
+static thread_t* run_dequeue(sched_rq_t* rq) {
+    if (rq->ready_bitmap == 0) {
+        return NULL;
+    }
+    thread_t* thread = rq->head[bit_scan_forward(rq->ready_bitmap)];
+    run_remove(thread);
+    return thread;
+}
+
+/**
+ * Request a switch if a thread that just became ready outranks the one running on its CPU (queue locked)
+ *
+ * Another CPU only notices at its next interrupt, so it gets one right away.
+ */
+static void check_preempt(thread_t* thread) {
+    sched_rq_t* rq = &runqueues[thread->cpu];
+    if (rq->current == rq->idle || thread->priority < rq->current->priority) {
+        rq->need_resched = true;
+        if (rq != this_rq()) {
+            lapic_send_ipi(cpus[rq->cpu].apic_id, LAPIC_IPI_FIXED | IPI_RESCHED_VECTOR);
+        }
+    }
+}
+
+/**
+ * Lock the run queue a thread belongs to (interrupts disabled)
+ *
+ * thread->cpu changes under the new queue's lock, so check it again once
+ * the lock is ours.
+ */
+static sched_rq_t* lock_thread_rq(thread_t* thread) {
+    for (;;) {
+        sched_rq_t* rq = &runqueues[__atomic_load_n(&thread->cpu, __ATOMIC_ACQUIRE)];
+        spin_lock(&rq->lock);
+        if (rq == &runqueues[thread->cpu]) {
+            return rq;
+        }
+        spin_unlock(&rq->lock);
+    }
+}
+
+/**
+ * Threads a CPU has to run: queued ones plus the running one unless it idles
+ */
+static inline uint32_t rq_load(sched_rq_t* rq) {
+    return __atomic_load_n(&rq->nr_ready, __ATOMIC_RELAXED) +
+           (__atomic_load_n(&rq->current, __ATOMIC_RELAXED) != rq->idle ? 1 : 0);
+}
+
+/**
+ * CPU to start or wake a thread on
+ *
+ * A pinned thread goes to its CPU. Otherwise the CPU it ran on last keeps it
+ * while nothing else is to run there (its cache may still hold the thread's
+ * data), else the CPU with the least to do takes it. The loads are read
+ * without the queues' locks: a stale one only makes a worse choice.
+ */
+static uint32_t select_cpu(thread_t* thread) {
+    if (thread->affinity != THREAD_CPU_ANY) {
+        return thread->affinity;
+    }
+    uint32_t best = thread->cpu;
+    uint32_t best_load = rq_load(&runqueues[best]);
+    for (uint32_t i = 0; i < SMP_MAX_CPUS && best_load > 0; i++) {
+        sched_rq_t* rq = &runqueues[i];
+        if (__atomic_load_n(&rq->idle, __ATOMIC_ACQUIRE) == NULL) {
+            continue;   /* Doesn't run threads */
+        }
+        uint32_t load = rq_load(rq);
+        if (load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+/**
+ * Free the thread that exited before the last switch
+ */
+static void sched_reap(void) {
+    sched_rq_t* rq = this_rq();
+    thread_t* dead = rq->reap_pending;
+    if (dead == NULL || dead == rq->current) {
+        return;
+    }
+    rq->reap_pending = NULL;
+    if (dead->process != NULL) {
+        process_reap(dead->process, dead);
+    }
+    fpu_thread_exit(dead);
+    if (dead != &boot_thread) {
+        kfree(dead->stack);
+        kfree(dead);
+    }
+}
+
+/**
+ * Finish a switch on the new thread's stack: the old thread's stack is free now
+ */
+static void sched_finish_switch(void) {
+    sched_rq_t* rq = this_rq();
+    thread_t* prev = rq->switched_from;
+    if (prev != NULL) {
+        rq->switched_from = NULL;
+        /* Its saved context is complete: a waker may send it to another CPU from here on */
+        __atomic_store_n(&prev->on_cpu, false, __ATOMIC_RELEASE);
+    }
+    sched_reap();
+}
+
+/**
+ * Switch to the next runnable thread (interrupts disabled)
+ *
+ * A RUNNING caller goes to the back of the queue; a BLOCKED or DEAD one just
+ * leaves the CPU. With nothing else ready the idle thread runs.
+ */
+static void schedule(void) {
+    sched_rq_t* rq = this_rq();
+    spin_lock(&rq->lock);
+    thread_t* prev = rq->current;
+    rq->need_resched = false;
+    if (prev->state == THREAD_RUNNING) {
+        prev->state = THREAD_READY;
+        if (prev != rq->idle) {
+            run_enqueue(prev);
+        }
+    }
+    /* Blocked, it may wake up on another CPU */
+    bool may_migrate = prev->state == THREAD_BLOCKED && prev->affinity == THREAD_CPU_ANY;
+    thread_t* next = run_dequeue(rq);
+    if (next == NULL) {
+        next = rq->idle;
+    }
+    rq->slice_left = SCHED_QUANTUM_TICKS;
+    next->state = THREAD_RUNNING;
+    next->on_cpu = true;
+    rq->current = next;
+    if (next != prev) {
+        rq->switched_from = prev;
+    }
+    spin_unlock(&rq->lock);
+    if (next == prev) {
+        return;
+    }
+    TRACE(SCHED_SWITCH, prev->id, next->id);
+    if (may_migrate && smp_cpu_count() > 1) {
+        /* Its FPU registers must not stay behind in this CPU's */
+        fpu_thread_leave(prev);
+    }
+    tss_set_kernel_stack(next->stack_top);
+    if (next->cr3 != prev->cr3) {
+        paging_switch_directory(next->cr3);
+    }
+    fpu_switch(next);
+    context_switch(&prev->esp, next->esp);
+    /* Back on prev's stack: some other thread switched to us */
+    sched_finish_switch();
+}
+
+/**
+ * First code a new thread runs (reached via context_switch()'s ret)
+ */
+static void thread_start(void) {
+    sched_finish_switch();
+    asm volatile("sti");
+    thread_t* self = thread_current();
+    self->entry(self->arg);
+    thread_exit();
+}
+
+/**
+ * Idle thread: render queued kernel log messages, zero frames for frame_alloc_zeroed(), then sleep until something
+ * becomes runnable
+ *
+ * One message or frame at a time, so a thread woken meanwhile preempts the loop quickly.
+ * The sleep watches need_resched: a wakeup from an IRQ switches at the IRQ's
+ * exit, one that only stored the flag (MWAIT ends on the store) switches here.
+ * Every CPU runs one; tickless idle is the boot CPU's alone (timer_idle_enter()).
+ */
+static void idle_loop(void* arg) {
+    (void) arg;
+    sched_rq_t* rq = this_rq();
+    while (1) {
+        if (rq->need_resched) {
+            thread_yield();
+        }
+        else if (!klog_drain_idle() && !frame_zero_idle()) {
+            asm volatile("cli");
+            timer_idle_enter();
+            cpu_idle(&rq->need_resched);
+        }
+    }
+}
+
+/**
+ * Check if sched_init() has run
+ */
+bool sched_active(void) {
+    return this_rq()->current != NULL;
+}
+
+/**
+ * Allocate a thread and its stack, ready to be switched to
+ *
+ * @return Thread in state BLOCKED (not queued), or NULL if out of memory
+ */
+static thread_t* thread_alloc(const char* name, void (*entry)(void*), void* arg) {
+    thread_t* thread = (thread_t*) kcalloc(1, sizeof(thread_t));
+    void* stack = thread ? kmalloc(THREAD_STACK_SIZE) : NULL;
+    if (stack == NULL) {
+        klog(KLOG_ERR, "[FAILED] thread_create: Out of memory for thread '%s'\n", name);
+        kfree(thread);
+        return NULL;
+    }
+    size_t len = 0;
+    while (name[len] != '\0' && len < THREAD_NAME_LEN - 1) {
+        thread->name[len] = name[len];
+        len++;
+    }
+    thread->name[len] = '\0';
+    thread->stack = stack;
+    thread->stack_top = ((uint32_t) stack + THREAD_STACK_SIZE) & ~0xFu;
+    thread->entry = entry;
+    thread->arg = arg;
+    thread->cr3 = paging_kernel_directory();
+    thread->base_priority = SCHED_PRIO_DEFAULT;
+    thread->priority = SCHED_PRIO_DEFAULT;
+    thread->cpu = cpu_self()->id;
+    thread->affinity = THREAD_CPU_ANY;
+    /* Build the frame context_switch() pops: edi, esi, ebx, ebp, eflags, return address */
+    uint32_t* sp = (uint32_t*) thread->stack_top;
+    *--sp = 0;                              /* thread_start()'s return address (never used) */
+    *--sp = (uint32_t) thread_start;
+    *--sp = EFLAGS_RESERVED;                /* Interrupts off until thread_start() */
+    *--sp = 0;                              /* ebp: ends backtraces here */
+    *--sp = 0;                              /* ebx */
+    *--sp = 0;                              /* esi */
+    *--sp = 0;                              /* edi */
+    thread->esp = (uint32_t) sp;
+
+    thread->state = THREAD_BLOCKED;
+    thread->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    return thread;
+}
+
+/**
+ * Create a kernel thread without starting it
+ */
+thread_t* thread_prepare(const char* name, void (*entry)(void*), void* arg) {
+    if (!sched_active()) {
+        klog(KLOG_ERR, "[FAILED] thread_create: Scheduler not initialized\n");
+        return NULL;
+    }
+    return thread_alloc(name, entry, arg);
+}
+
+/**
+ * Start a thread made by thread_prepare()
+ */
+void thread_launch(thread_t* thread) {
+    thread_unblock(thread);
+}
+
+/**
+ * Create a kernel thread and put it in a run queue
+ */
+thread_t* thread_create(const char* name, void (*entry)(void*), void* arg) {
+    thread_t* thread = thread_prepare(name, entry, arg);
+    if (thread != NULL) {
+        thread_launch(thread);
+    }
+    return thread;
+}
+
+/**
+ * Create a kernel thread that only ever runs on one CPU
+ */
+thread_t* thread_create_on(uint32_t cpu, const char* name, void (*entry)(void*), void* arg) {
+    if (cpu >= SMP_MAX_CPUS || __atomic_load_n(&runqueues[cpu].idle, __ATOMIC_ACQUIRE) == NULL) {
+        klog(KLOG_ERR, "[FAILED] thread_create_on: CPU %u doesn't run threads\n", cpu);
+        return NULL;
+    }
+    thread_t* thread = thread_prepare(name, entry, arg);
+    if (thread != NULL) {
+        thread->affinity = cpu;
+        thread_launch(thread);
+    }
+    return thread;
+}
+
+/**
+ * Start the scheduler
+ */
+void sched_init(void) {
+    sched_rq_t* rq = this_rq();
+    rq->cpu = cpu_self()->id;
+    rq->slice_left = SCHED_QUANTUM_TICKS;
+    boot_thread.id = 0;
+    boot_thread.state = THREAD_RUNNING;
+    boot_thread.stack = NULL;
+    boot_thread.stack_top = (uint32_t) &stack_top;
+    boot_thread.cr3 = paging_current_directory();
+    boot_thread.base_priority = SCHED_PRIO_DEFAULT;
+    boot_thread.priority = SCHED_PRIO_DEFAULT;
+    boot_thread.cpu = rq->cpu;
+    boot_thread.affinity = THREAD_CPU_ANY;
+    boot_thread.on_cpu = true;
+    memcpy(boot_thread.name, "kernel", sizeof("kernel"));
+    /* The idle thread is never queued; it only runs when every level is empty */
+    thread_t* idle = thread_alloc("idle", idle_loop, NULL);
+    if (idle == NULL) {
+        klog(KLOG_ERR, "[FAILED] sched_init: Could not create the idle thread\n");
+        return;
+    }
+    idle->state = THREAD_READY;
+    idle->affinity = rq->cpu;
+    rq->current = &boot_thread;
+    __atomic_store_n(&rq->idle, idle, __ATOMIC_RELEASE);
+    klog(KLOG_INFO, "[  OK  ] Scheduler initialized (%u priority levels, %u-tick slices).\n",
+                    SCHED_PRIO_LEVELS, SCHED_QUANTUM_TICKS);
+}
+
+/**
+ * Run threads on an application processor
+ */
+void sched_init_cpu(void) {
+    cpu_t* cpu = cpu_self();
+    sched_rq_t* rq = this_rq();
+    /* The boot context becomes the idle thread: it already runs on the stack smp.c gave this CPU */
+    thread_t* idle = runqueues[0].current != NULL ? (thread_t*) kcalloc(1, sizeof(thread_t)) : NULL;
+    if (idle == NULL) {
+        klog(KLOG_ERR, "[FAILED] sched_init_cpu: CPU %u runs no threads\n", cpu->id);
+        while (1) {
+            asm volatile("sti; hlt");
+        }
+    }
+    memcpy(idle->name, "idle", sizeof("idle"));
+    idle->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    idle->state = THREAD_RUNNING;
+    idle->stack_top = cpu->stack_top;
+    idle->cr3 = paging_current_directory();
+    idle->base_priority = SCHED_PRIO_DEFAULT;
+    idle->priority = SCHED_PRIO_DEFAULT;
+    idle->cpu = cpu->id;
+    idle->affinity = cpu->id;
+    idle->on_cpu = true;
+    rq->cpu = cpu->id;
+    rq->slice_left = SCHED_QUANTUM_TICKS;
+    rq->current = idle;
+    /* From here on select_cpu() may send threads here */
+    __atomic_store_n(&rq->idle, idle, __ATOMIC_RELEASE);
+    idle_loop(NULL);
+    __builtin_unreachable();
+}
+
+/**
+ * Currently running thread
+ */
+thread_t* thread_current(void) {
+    return this_rq()->current;
+}
+
+/**
+ * Give up the rest of the time slice
+ */
+void thread_yield(void) {
+    if (!sched_active()) {
+        return;
+    }
+    uint32_t flags = irq_save();
+    schedule();
+    irq_restore(flags);
+}
+
+/**
+ * Terminate the calling thread
+ */
+void thread_exit(void) {
+    irq_save();
+    sched_rq_t* rq = this_rq();
+    if (rq->current != NULL) {
+        spin_lock(&rq->lock);
+        rq->current->state = THREAD_DEAD;
+        rq->reap_pending = rq->current;
+        spin_unlock(&rq->lock);
+        schedule();
+    }
+    /* Only reached without a scheduler */
+    while (1) {
+        asm volatile("hlt");
+    }
+}
+
+/**
+ * Block the calling thread until thread_unblock() (interrupts disabled)
+ */
+void thread_block(void) {
+    thread_t* self = thread_current();
+    if (self == NULL) {
+        /* No other thread to run: sleep until the next interrupt */
+        asm volatile("sti; hlt; cli" : : : "memory");
+        return;
+    }
+    sched_rq_t* rq = this_rq();
+    spin_lock(&rq->lock);
+    self->state = THREAD_BLOCKED;
+    spin_unlock(&rq->lock);
+    schedule();
+}
+
+/**
+ * Block the calling thread and release a spinlock its waker takes first (interrupts disabled)
+ */
+void thread_block_unlock(spinlock_t* lock) {
+    sched_rq_t* rq = this_rq();
+    spin_lock(&rq->lock);
+    rq->current->state = THREAD_BLOCKED;
+    spin_unlock(&rq->lock);
+    /* Any waker now finds us BLOCKED; interrupts are off, so this is no preemption point */
+    spin_unlock(lock);
+    schedule();
+}
+
+/**
+ * Make a blocked thread runnable
+ */
+void thread_unblock(thread_t* thread) {
+    thread_unblock_boost(thread, 0);
+}
+
+/**
+ * Make a blocked thread runnable with a temporary priority boost
+ */
+void thread_unblock_boost(thread_t* thread, uint32_t boost) {
+    if (thread == NULL) {
+        return;
+    }
+    uint32_t flags = irq_save();
+    sched_rq_t* rq = lock_thread_rq(thread);
+    if (thread->state != THREAD_BLOCKED) {
+        spin_unlock_irqrestore(&rq->lock, flags);
+        return;
+    }
+    uint32_t boosted = thread->base_priority > boost ? thread->base_priority - boost : 0;
+    if (boosted < thread->priority) {
+        thread->priority = boosted;
+    }
+    /* Still switching out: its stack is in use, so it stays where it is */
+    uint32_t cpu = __atomic_load_n(&thread->on_cpu, __ATOMIC_ACQUIRE) ? thread->cpu : select_cpu(thread);
+    if (cpu != thread->cpu) {
+        /* Other wakers see it isn't BLOCKED and leave it alone while it moves */
+        thread->state = THREAD_WAKING;
+        spin_unlock(&rq->lock);
+        rq = &runqueues[cpu];
+        spin_lock(&rq->lock);
+        __atomic_store_n(&thread->cpu, cpu, __ATOMIC_RELEASE);
+    }
+    thread->state = THREAD_READY;
+    run_enqueue(thread);
+    /* Don't leave the CPU to less important work (or idling) until the next tick */
+    check_preempt(thread);
+    spin_unlock_irqrestore(&rq->lock, flags);
+}
+
+/**
+ * Change a thread's base priority
+ */
+int thread_set_priority(thread_t* thread, uint32_t priority) {
+    if (thread == NULL || priority >= SCHED_PRIO_LEVELS) {
+        klog(KLOG_ERR, "[FAILED] thread_set_priority: Invalid priority %u\n", priority);
+        return -1;
+    }
+    uint32_t flags = irq_save();
+    sched_rq_t* rq = lock_thread_rq(thread);
+    if (thread->state == THREAD_READY && thread != rq->idle) {
+        /* Move it to the queue of its new level */
+        run_remove(thread);
+        thread->base_priority = priority;
+        thread->priority = priority;
+        run_enqueue(thread);
+        check_preempt(thread);
+    }
+    else {
+        thread->base_priority = priority;
+        thread->priority = priority;
+        /* The running thread may now rank below a ready one */
+        if (thread == rq->current && (rq->ready_bitmap & ((1u << priority) - 1)) != 0) {
+            rq->need_resched = true;
+            if (rq != this_rq()) {
+                lapic_send_ipi(cpus[rq->cpu].apic_id, LAPIC_IPI_FIXED | IPI_RESCHED_VECTOR);
+            }
+        }
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+    return 0;
+}
+
+/**
+ * Account one timer tick to the running thread
+ */
+void sched_tick(void) {
+    sched_rq_t* rq = this_rq();
+    thread_t* current = rq->current;
+    if (current == NULL) {
+        return;
+    }
+    spin_lock(&rq->lock);
+    if (current == rq->idle) {
+        rq->need_resched = rq->ready_bitmap != 0;
+        spin_unlock(&rq->lock);
+        return;
+    }
+    if (rq->slice_left > 0) {
+        rq->slice_left--;
+    }
+    if (rq->slice_left == 0) {
+        /* A full slice used: wear off one level of wakeup boost */
+        if (current->priority < current->base_priority) {
+            current->priority++;
+        }
+        if (rq->ready_bitmap & prio_mask_upto(current->priority)) {
+            rq->need_resched = true;
+        }
+        else {
+            rq->slice_left = SCHED_QUANTUM_TICKS;  /* Nobody as important waiting: keep running */
+        }
+    }
+    spin_unlock(&rq->lock);
+}
+
+/**
+ * Switch threads if a reschedule is pending (end of an IRQ, interrupts disabled)
+ */
+void sched_preempt(void) {
+    sched_rq_t* rq = this_rq();
+    if (rq->current != NULL && rq->need_resched && rq->preempt_count == 0) {
+        schedule();
+    }
+}
+
+/**
+ * Disable preemption of the running thread
+ *
+ * Only this CPU writes its count, and an interrupt in between leaves it as it
+ * was, so the increment needs no lock prefix.
+ */
+void preempt_disable(void) {
+    this_rq()->preempt_count++;
+    asm volatile("" : : : "memory");
+}
+
+/**
+ * Re-enable preemption, switching now if a reschedule became due meanwhile
+ */
+void preempt_enable(void) {
+    asm volatile("" : : : "memory");
+    sched_rq_t* rq = this_rq();
+    if (--rq->preempt_count == 0 && rq->need_resched && irqs_enabled()) {
+        /* Interrupts on means thread context; in an IRQ the exit path switches instead */
+        uint32_t flags = irq_save();
+        sched_preempt();
+        irq_restore(flags);
+    }
+}
@@ -0,0 +1,207 @@
+/**
+ * Trace Ring Buffer
+ *
+ *   TRACE(IRQ, 0, eip) → slot = head++ (xadd) → records[slot & mask] = { ... }
+ *                        → seq = slot + 1 (the record is complete)
+ *
+ * head only grows; the ring keeps the newest TRACE_RING_SIZE records. Any
+ * CPU may hit a tracepoint, and so may an IRQ handler interrupting one; lock
+ * xadd claims a slot atomically with respect to both.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/trace.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/kheap.h>
+#include <kernel/serial.h>
+#include <kernel/klog.h>
+#include <kernel/shell.h>
+
+#include "include/cpuid.h"
+#include "include/tsc.h"
+
+#define TRACE_RING_MASK     (TRACE_RING_SIZE - 1)
+
+static const char* const trace_event_names[TRACE_EVENT_COUNT] = {
+    [TRACE_IRQ] = "irq",
+    [TRACE_SYSCALL] = "syscall",
+    [TRACE_PAGE_FAULT] = "page_fault",
+    [TRACE_SCHED_SWITCH] = "sched_switch",
+    [TRACE_KMALLOC] = "kmalloc",
+    [TRACE_KFREE] = "kfree",
+    [TRACE_MARK] = "mark",
+};
+
+volatile bool trace_enabled = false;
+
+static trace_record_t* records = NULL;  /* Allocated on the first trace_start() */
+static volatile uint32_t head = 0;      /* Slots claimed since trace_start() */
+static bool use_tsc = false;
+
+/**
+ * Append a record
+ */
+void trace_record(trace_event_t event, uint32_t a, uint32_t b) {
+    uint32_t slot = 1;
+    asm volatile("lock xaddl %0, %1" : "+r"(slot), "+m"(head) : : "memory");
+    trace_record_t* rec = &records[slot & TRACE_RING_MASK];
+    rec->seq = 0;  /* Incomplete until the last store */
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    rec->time = use_tsc ? rdtsc() : timer_ticks();
+    rec->event = (uint16_t) event;
+    thread_t* thread = thread_current();
+    rec->thread = thread ? (uint16_t) thread->id : 0;
+    rec->a = a;
+    rec->b = b;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    rec->seq = slot + 1;
+}
+
+/**
+ * Start tracing
+ */
+int trace_start(void) {
+    trace_enabled = false;
+    if (records == NULL) {
+        trace_record_t* ring = (trace_record_t*) kcalloc(TRACE_RING_SIZE, sizeof(trace_record_t));
+        if (ring == NULL) {
+            klog(KLOG_ERR, "[FAILED] trace_start: Out of memory for %u records\n", TRACE_RING_SIZE);
+            return -1;
+        }
+        records = ring;
+    }
+    else {
+        /* Stale seq values of the last run must not pass for complete records */
+        memset(records, 0, TRACE_RING_SIZE * sizeof(trace_record_t));
+    }
+    use_tsc = cpuid_has_edx(CPUID_EDX_TSC);
+    head = 0;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    trace_enabled = true;
+    return 0;
+}
+
+/**
+ * Stop tracing
+ */
+void trace_stop(void) {
+    trace_enabled = false;
+}
+
+/**
+ * Visit the complete records, oldest first
+ */
+size_t trace_walk(void (*visit)(const trace_record_t* rec, void* ctx), void* ctx, size_t max) {
+    if (records == NULL) {
+        return 0;
+    }
+    uint32_t end = head;
+    uint32_t start = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+    size_t count = 0;
+    for (uint32_t slot = start; slot != end && count < max; slot++) {
+        const trace_record_t* rec = &records[slot & TRACE_RING_MASK];
+        if (rec->seq == slot + 1) {
+            visit(rec, ctx);
+            count++;
+        }
+    }
+    return count;
+}
+
+static void trace_copy(const trace_record_t* rec, void* ctx) {
+    trace_record_t** out = (trace_record_t**) ctx;
+    *(*out)++ = *rec;
+}
+
+/**
+ * Copy the complete records
+ */
+size_t trace_read(trace_record_t* out, size_t max) {
+    bool was_enabled = trace_enabled;
+    trace_enabled = false;
+    size_t count = trace_walk(trace_copy, &out, max);
+    trace_enabled = was_enabled;
+    return count;
+}
+
+/**
+ * Name of an event
+ */
+const char* trace_event_name(uint32_t event) {
+    return event < TRACE_EVENT_COUNT && trace_event_names[event] ? trace_event_names[event] : "unknown";
+}
+
+/* State of a dump in progress */
+typedef struct {
+    uint16_t port;
+    bool started;
+    uint64_t first;                     /* Time of the first record */
+    uint64_t units_per_sec;             /* TSC frequency, or tick rate without a TSC */
+} trace_dump_t;
+
+static void trace_print(const trace_record_t* rec, void* ctx) {
+    trace_dump_t* dump = (trace_dump_t*) ctx;
+    if (!dump->started) {
+        dump->first = rec->time;
+        dump->started = true;
+    }
+    uint64_t us = dump->units_per_sec ? (rec->time - dump->first) * 1000000 / dump->units_per_sec : 0;
+    char line[96];
+    snprintf(line, sizeof(line), "%u us  thread %u  %s  0x%x 0x%x\n", (uint32_t) us, rec->thread,
+             trace_event_name(rec->event), rec->a, rec->b);
+    serial_write_string(dump->port, line);
+}
+
+/**
+ * Write the records as text to a serial port
+ */
+void trace_dump(uint16_t port) {
+    bool was_enabled = trace_enabled;
+    trace_enabled = false;
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    trace_dump_t dump = {
+        .port = port,
+        .started = false,
+        .first = 0,
+        .units_per_sec = use_tsc ? stats.tsc_hz : stats.hz,
+    };
+    size_t count = trace_walk(trace_print, &dump, TRACE_RING_SIZE);
+    char line[64];
+    snprintf(line, sizeof(line), "%u records (%u claimed)\n", (uint32_t) count, head);
+    serial_write_string(port, line);
+    trace_enabled = was_enabled;
+}
+
+/**
+ * Shell command: trace
+ *
+ * Controls the tracepoint ring buffer:
+ *   trace start   record IRQs, system calls, page faults, switches and allocations
+ *   trace stop
+ *   trace dump    write the records to COM1
+ *
+ * @param args Command arguments
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(trace, "tracepoint ring: start | stop | dump") {
+    if (args[1] != NULL && strcmp(args[1], "start") == 0) {
+        trace_start();
+    }
+    else if (args[1] != NULL && strcmp(args[1], "stop") == 0) {
+        trace_stop();
+    }
+    else if (args[1] != NULL && strcmp(args[1], "dump") == 0) {
+        trace_dump(SERIAL_COM1_BASE);
+    }
+    else {
+        printf("usage: trace start | stop | dump\n");
+    }
+    return 1;
+}
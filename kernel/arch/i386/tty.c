@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include <kernel/tty.h>
+#include <kernel/spinlock.h>
 
 #include "include/vga.h"
 
@@ -13,6 +14,9 @@ static size_t terminal_column;
 /* Current text color and background color */
 uint8_t terminal_color;
 
+/* Cursor and screen are shared by every CPU; IRQ handlers print too */
+static spinlock_t terminal_lock = SPINLOCK_INIT;
+
 /**
  * Initializes the terminal interface
  *
@@ -40,9 +44,9 @@ void terminal_setcolor(uint8_t color) {
  * Check if terminal needs to scroll and handle it
  */
 void terminal_check_scroll() {
-    if (terminal_row == VGA_HEIGHT) {
+    if (terminal_row == console_rows) {
         vga_scroll();
-        terminal_row = VGA_HEIGHT - 1;
+        terminal_row = console_rows - 1;
     }
 }
 
@@ -57,47 +61,98 @@ void terminal_handle_newline() {
 }
 
 /**
- * Writes a character to the terminal at current cursor position
+ * Push changed rows to the screen and move the hardware cursor
  *
- * Handles basic cursor advancement, wrapping, and scrolling:
- * - Processes '\n' as a newline (advances row, resets column)
- * - Processes '\b' as backspace (moves cursor back, erases character)
- * - Moves to next line when reaching end of current line
- * - Scrolls the screen when reaching bottom
- * - Updates the hardware cursor position after writing
- *
- * @param c Character to write
+ * Costs MMIO and four port writes, so it is done once per write, not per character.
  */
-void terminal_putchar(char c) {
-    unsigned char uc = c;
+static void terminal_sync_cursor(void) {
+    vga_flush();
+    uint16_t cursor_pos = terminal_row * console_cols + terminal_column;
+    vga_update_cursor_position(cursor_pos);
+}
+
+/**
+ * Render a character at the current position without moving the hardware cursor
+ */
+static void terminal_render_char(unsigned char uc) {
     if (uc == '\n') {
         terminal_handle_newline();
     }
     else if (uc == '\b') {
-        terminal_column--;
-        vga_write_char_at(' ', terminal_color, terminal_column, terminal_row);
+        if (terminal_column > 0) {
+            terminal_column--;
+            vga_write_char_at(' ', terminal_color, terminal_column, terminal_row);
+        }
     }
     else {
         vga_write_char_at(uc, terminal_color, terminal_column, terminal_row);
-        if (++terminal_column == VGA_WIDTH) {
+        if (++terminal_column == console_cols) {
             terminal_handle_newline();
         }
     }
-    // Update hardware cursor
-    uint16_t cursor_pos = terminal_row * VGA_WIDTH + terminal_column;
-    vga_update_cursor_position(cursor_pos);
+}
+
+/**
+ * Writes a character to the terminal at current cursor position
+ *
+ * Handles basic cursor advancement, wrapping, and scrolling:
+ * - Processes '\n' as a newline (advances row, resets column)
+ * - Processes '\b' as backspace (moves cursor back, erases character)
+ * - Moves to next line when reaching end of current line
+ * - Scrolls the screen when reaching bottom
+ * - Updates the hardware cursor position after writing
+ *
+ * @param c Character to write
+ */
+void terminal_putchar(char c) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    terminal_render_char((unsigned char) c);
+    terminal_sync_cursor();
+    spin_unlock_irqrestore(&terminal_lock, flags);
 }
 
 /**
  * Writes a string of specific length to the terminal
  *
+ * Runs of ordinary characters are copied straight into the current row of
+ * the VGA buffer; the hardware cursor is updated once at the end.
+ *
  * @param data Pointer to the string to write
  * @param size Number of characters to write
  */
 void terminal_write(const char* data, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        terminal_putchar(data[i]);
+    /* One caller's output stays in one piece (cursor state is shared) */
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    size_t i = 0;
+    while (i < size) {
+        // Longest run of ordinary characters that fits on the current row
+        size_t run = 0;
+        size_t room = console_cols - terminal_column;
+        while (run < room && i + run < size && data[i + run] != '\n' && data[i + run] != '\b') {
+            run++;
+        }
+        if (run == 0) {
+            terminal_render_char((unsigned char) data[i++]);
+            continue;
+        }
+        vga_write_run_at(data + i, run, terminal_color, terminal_column, terminal_row);
+        i += run;
+        terminal_column += run;
+        if (terminal_column == console_cols) {
+            terminal_handle_newline();
+        }
     }
+    terminal_sync_cursor();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+/**
+ * Scroll the view through the scrollback history
+ *
+ * @param lines Lines to move (positive = back in history, negative = towards the live screen)
+ */
+void terminal_scroll_view(int lines) {
+    vga_scroll_view(lines);
 }
 
 /**
@@ -0,0 +1,61 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/uaccess.h>
+#include <kernel/process.h>
+
+/**
+ * Check a caller-supplied range: user memory for a process, anything non-NULL for kernel threads
+ */
+static inline bool uaccess_range_ok(uint32_t addr, size_t len) {
+    if (process_current() != NULL) {
+        return access_ok(addr, len);
+    }
+    return addr != 0 && addr + len >= addr;
+}
+
+/**
+ * Copy from a user buffer into kernel memory
+ */
+int copy_from_user(void* dst, const void* src, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (!uaccess_range_ok((uint32_t) src, len)) {
+        return -1;
+    }
+    memcpy(dst, src, len);
+    return 0;
+}
+
+/**
+ * Copy from kernel memory into a user buffer
+ */
+int copy_to_user(void* dst, const void* src, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (!uaccess_range_ok((uint32_t) dst, len)) {
+        return -1;
+    }
+    memcpy(dst, src, len);
+    return 0;
+}
+
+/**
+ * Copy a NUL-terminated string from user memory
+ */
+int32_t strncpy_from_user(char* dst, const char* src, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        /* Checked byte by byte: the string may end right below the top of the user range */
+        if (!uaccess_range_ok((uint32_t) (src + i), 1)) {
+            return -1;
+        }
+        dst[i] = src[i];
+        if (dst[i] == '\0') {
+            return (int32_t) i;
+        }
+    }
+    return -1;
+}
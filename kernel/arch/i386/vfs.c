@@ -0,0 +1,343 @@
+/**
+ * Virtual File System
+ *
+ * Path walk, one component at a time:
+ *
+ *   hash = fnv1a(name) mixed with the parent dentry's address
+ *   bucket = dcache[hash & (VFS_DCACHE_BUCKETS - 1)]
+ *     → a dentry with that parent and name? hit
+ *     → else parent->inode->ops->lookup() → new dentry at the head of the bucket
+ *
+ * Dentries are never freed (the filesystems are read-only, so what they name
+ * never changes); negative ones are only added while fewer than
+ * VFS_NEGATIVE_MAX exist, which keeps a scan for missing names from growing
+ * the cache without bound.
+ *
+ * dcache_lock guards the buckets and is held over the filesystem's lookup(),
+ * so two threads missing on the same name can't both add it.
+ *
+ * A file's offset is guarded by its mutex rather than a spinlock: read()
+ * copies into user memory, which may fault and sleep.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/vfs.h>
+#include <kernel/kheap.h>
+#include <kernel/spinlock.h>
+#include <kernel/process.h>
+
+static dentry_t* dcache[VFS_DCACHE_BUCKETS];
+static spinlock_t dcache_lock = SPINLOCK_INIT;
+static dentry_t* vfs_root = NULL;
+static vfs_stats_t vfs_stats;
+
+/* Descriptor table of kernel threads (no process) */
+static file_t* kernel_files[VFS_FD_MAX];
+/* Slot updates in any descriptor table (kernel threads share theirs across CPUs) */
+static spinlock_t fd_lock = SPINLOCK_INIT;
+
+/**
+ * Hash of a name under a parent dentry
+ */
+static uint32_t dentry_hash(const dentry_t* parent, const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+    }
+    return hash ^ ((uint32_t) parent * 0x9E3779B1u);
+}
+
+/**
+ * Find a cached dentry (dcache_lock held)
+ */
+static dentry_t* dcache_find(const dentry_t* parent, const char* name, size_t len, uint32_t hash) {
+    for (dentry_t* d = dcache[hash & (VFS_DCACHE_BUCKETS - 1)]; d != NULL; d = d->hash_next) {
+        if (d->hash == hash && d->parent == parent && memcmp(d->name, name, len) == 0 && d->name[len] == '\0') {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Allocate a dentry and add it to the cache (dcache_lock held)
+ */
+static dentry_t* dcache_add(dentry_t* parent, const char* name, size_t len, uint32_t hash, inode_t* inode) {
+    dentry_t* d = (dentry_t*) kcalloc(1, sizeof(dentry_t));
+    if (d == NULL) {
+        return NULL;
+    }
+    memcpy(d->name, name, len);
+    d->name[len] = '\0';
+    d->hash = hash;
+    d->parent = parent != NULL ? parent : d;
+    d->inode = inode;
+    uint32_t bucket = hash & (VFS_DCACHE_BUCKETS - 1);
+    d->hash_next = dcache[bucket];
+    dcache[bucket] = d;
+    vfs_stats.dentries++;
+    if (inode == NULL) {
+        vfs_stats.negative++;
+    }
+    return d;
+}
+
+/**
+ * Look a name up under a directory dentry, through the cache
+ *
+ * @return Dentry (negative if the name doesn't exist), or NULL if it can't be cached
+ */
+static dentry_t* dentry_child(dentry_t* parent, const char* name, size_t len) {
+    uint32_t hash = dentry_hash(parent, name, len);
+    uint32_t flags = spin_lock_irqsave(&dcache_lock);
+    vfs_stats.lookups++;
+    dentry_t* d = dcache_find(parent, name, len, hash);
+    if (d != NULL) {
+        vfs_stats.hits++;
+        spin_unlock_irqrestore(&dcache_lock, flags);
+        return d;
+    }
+    vfs_stats.misses++;
+    inode_t* dir = parent->inode;
+    inode_t* inode = dir->ops->lookup != NULL ? dir->ops->lookup(dir, name, len) : NULL;
+    if (inode != NULL || vfs_stats.negative < VFS_NEGATIVE_MAX) {
+        d = dcache_add(parent, name, len, hash, inode);
+    }
+    spin_unlock_irqrestore(&dcache_lock, flags);
+    return d;
+}
+
+/**
+ * Make a directory inode the root of the namespace
+ */
+int vfs_mount_root(inode_t* root) {
+    if (root == NULL || root->type != VFS_TYPE_DIR) {
+        return -1;
+    }
+    uint32_t flags = spin_lock_irqsave(&dcache_lock);
+    dentry_t* d = dcache_add(NULL, "/", 1, dentry_hash(NULL, "/", 1), root);
+    if (d != NULL) {
+        vfs_root = d;
+    }
+    spin_unlock_irqrestore(&dcache_lock, flags);
+    return d != NULL ? 0 : -1;
+}
+
+/**
+ * Find the dentry of a path
+ */
+dentry_t* vfs_lookup(const char* path) {
+    dentry_t* d = __atomic_load_n(&vfs_root, __ATOMIC_ACQUIRE);
+    if (d == NULL || path == NULL) {
+        return NULL;
+    }
+    while (*path != '\0') {
+        while (*path == '/') {
+            path++;
+        }
+        size_t len = 0;
+        while (path[len] != '\0' && path[len] != '/') {
+            len++;
+        }
+        if (len == 0 || (len == 1 && path[0] == '.')) {
+            path += len;
+            continue;
+        }
+        if (len == 2 && path[0] == '.' && path[1] == '.') {
+            d = d->parent;
+        }
+        else {
+            if (len >= VFS_NAME_MAX || d->inode->type != VFS_TYPE_DIR) {
+                return NULL;
+            }
+            d = dentry_child(d, path, len);
+            if (d == NULL || d->inode == NULL) {
+                return NULL;
+            }
+        }
+        path += len;
+    }
+    return d;
+}
+
+/**
+ * Open a file or directory
+ */
+file_t* vfs_open(const char* path, uint32_t flags) {
+    if ((flags & VFS_O_ACCMODE) != VFS_O_RDONLY) {
+        return NULL;    /* Nothing is writable */
+    }
+    dentry_t* d = vfs_lookup(path);
+    if (d == NULL) {
+        return NULL;
+    }
+    file_t* file = (file_t*) kcalloc(1, sizeof(file_t));
+    if (file == NULL) {
+        return NULL;
+    }
+    file->dentry = d;
+    file->inode = d->inode;
+    file->flags = flags;
+    file->refs = 1;
+    mutex_init(&file->lock);
+    return file;
+}
+
+/**
+ * Read from the current offset and advance it
+ */
+int32_t vfs_read(file_t* file, void* buf, size_t count) {
+    inode_t* inode = file->inode;
+    if (inode->type != VFS_TYPE_FILE || inode->ops->read == NULL) {
+        return -1;
+    }
+    mutex_lock(&file->lock);
+    int32_t done = 0;
+    if (file->offset < inode->size && count > 0) {
+        uint32_t left = inode->size - file->offset;
+        done = inode->ops->read(inode, file->offset, buf, count < left ? count : left);
+        if (done > 0) {
+            file->offset += (uint32_t) done;
+        }
+    }
+    mutex_unlock(&file->lock);
+    return done;
+}
+
+/**
+ * Move the offset of an open file
+ */
+int32_t vfs_lseek(file_t* file, int32_t offset, int whence) {
+    mutex_lock(&file->lock);
+    int64_t base;
+    switch (whence) {
+        case VFS_SEEK_SET: base = 0; break;
+        case VFS_SEEK_CUR: base = file->offset; break;
+        case VFS_SEEK_END: base = file->inode->size; break;
+        default: base = -1; offset = 0; break;
+    }
+    int64_t target = base + offset;
+    int32_t result = -1;
+    if (base >= 0 && target >= 0 && target <= INT32_MAX) {
+        file->offset = (uint32_t) target;
+        result = (int32_t) target;
+    }
+    mutex_unlock(&file->lock);
+    return result;
+}
+
+/**
+ * Name of the index-th entry of an open directory
+ */
+int vfs_readdir(file_t* file, uint32_t index, char* name, size_t size) {
+    inode_t* inode = file->inode;
+    if (inode->type != VFS_TYPE_DIR || inode->ops->readdir == NULL || size == 0) {
+        return -1;
+    }
+    return inode->ops->readdir(inode, index, name, size);
+}
+
+/**
+ * Take another reference to an open file
+ */
+file_t* vfs_dup(file_t* file) {
+    __atomic_add_fetch(&file->refs, 1, __ATOMIC_RELAXED);
+    return file;
+}
+
+/**
+ * Drop a reference to an open file
+ */
+void vfs_close(file_t* file) {
+    if (__atomic_sub_fetch(&file->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        kfree(file);
+    }
+}
+
+/**
+ * Descriptor table of the caller
+ */
+static file_t** fd_table(void) {
+    process_t* proc = process_current();
+    return proc != NULL ? proc->files : kernel_files;
+}
+
+/**
+ * Install an open file in the caller's descriptor table
+ */
+int vfs_fd_install(file_t* file) {
+    file_t** table = fd_table();
+    spin_lock(&fd_lock);
+    for (int fd = VFS_FD_FIRST; fd < VFS_FD_MAX; fd++) {
+        if (table[fd] == NULL) {
+            table[fd] = file;
+            spin_unlock(&fd_lock);
+            return fd;
+        }
+    }
+    spin_unlock(&fd_lock);
+    return -1;
+}
+
+/**
+ * Open file behind a descriptor of the caller
+ */
+file_t* vfs_fd_get(int fd) {
+    if (fd < VFS_FD_FIRST || fd >= VFS_FD_MAX) {
+        return NULL;
+    }
+    return fd_table()[fd];
+}
+
+/**
+ * Close a descriptor of the caller
+ */
+int vfs_fd_close(int fd) {
+    if (fd < VFS_FD_FIRST || fd >= VFS_FD_MAX) {
+        return -1;
+    }
+    file_t** table = fd_table();
+    spin_lock(&fd_lock);
+    file_t* file = table[fd];
+    table[fd] = NULL;
+    spin_unlock(&fd_lock);
+    if (file == NULL) {
+        return -1;
+    }
+    vfs_close(file);
+    return 0;
+}
+
+/**
+ * Give a descriptor table references to every file of another
+ */
+void vfs_fd_copy(file_t** dst, file_t* const* src) {
+    for (int fd = 0; fd < VFS_FD_MAX; fd++) {
+        dst[fd] = src[fd] != NULL ? vfs_dup(src[fd]) : NULL;
+    }
+}
+
+/**
+ * Close every descriptor of a table
+ */
+void vfs_fd_close_all(file_t** table) {
+    for (int fd = 0; fd < VFS_FD_MAX; fd++) {
+        if (table[fd] != NULL) {
+            vfs_close(table[fd]);
+            table[fd] = NULL;
+        }
+    }
+}
+
+/**
+ * Get dentry cache statistics
+ */
+void vfs_get_stats(vfs_stats_t* stats) {
+    uint32_t flags = spin_lock_irqsave(&dcache_lock);
+    *stats = vfs_stats;
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
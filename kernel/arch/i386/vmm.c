@@ -0,0 +1,155 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <kernel/vmm.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/module.h>
+#include <kernel/klog.h>
+#include <kernel/spinlock.h>
+
+/**
+ * Demand-Paged Virtual Memory Regions
+ *
+ * Based on: https://wiki.osdev.org/Page_Fault
+ *
+ * vmm_reserve() only records the range. Pages get frames on first touch:
+ *
+ *   access 0x50003010 → #PF (not present) → vmm_handle_fault()
+ *     → region [0x50000000, 0x51000000) found
+ *     → frame_alloc_zeroed() (pre-zeroed by the idle thread), map 0x50003000
+ *     → return, CPU retries the instruction
+ *
+ * regions_lock guards the table, and is held from the lookup until the page
+ * is mapped so a release on another CPU can't slip in between.
+ */
+
+/* Top 8 MiB hold the paging scratch pages and the recursive page table window */
+#define VMM_LIMIT           0xFF800000
+
+typedef struct {
+    uint32_t start;     /* First address (page-aligned) */
+    uint32_t end;       /* One past the last address (page-aligned) */
+    uint32_t flags;     /* PTE flags applied to every page */
+    bool used;          /* Slot in use */
+} vmm_region_t;
+
+static vmm_region_t regions[VMM_MAX_REGIONS];
+static spinlock_t regions_lock = SPINLOCK_INIT;
+
+/**
+ * Find the region containing an address (regions_lock held)
+ *
+ * @return Region, or NULL if the address isn't reserved
+ */
+static vmm_region_t* vmm_find_region(uint32_t addr) {
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+        if (regions[i].used && addr >= regions[i].start && addr < regions[i].end) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Reserve a region; no frames are allocated until pages are touched
+ */
+int vmm_reserve(uint32_t start, size_t len, uint32_t flags) {
+    if (len == 0 || (start & (PAGE_SIZE - 1)) != 0) {
+        klog(KLOG_ERR, "[FAILED] vmm_reserve: Invalid region %p (+%zu bytes)\n", start, len);
+        return -1;
+    }
+    uint32_t end = start + ((len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    if (start < KMEM_MAX || end > VMM_LIMIT || end < start) {
+        klog(KLOG_ERR, "[FAILED] vmm_reserve: Region %p - %p overlaps kernel mappings\n", start, end);
+        return -1;
+    }
+    if (start < KHEAP_VIRT_END && KHEAP_VIRT_START < end) {
+        klog(KLOG_ERR, "[FAILED] vmm_reserve: Region %p - %p overlaps the kernel heap\n", start, end);
+        return -1;
+    }
+    if (start < MODULE_VIRT_END && MODULE_VIRT_START < end) {
+        klog(KLOG_ERR, "[FAILED] vmm_reserve: Region %p - %p overlaps the module window\n", start, end);
+        return -1;
+    }
+    if (start < PHYS_MAP_VIRT_END && PHYS_MAP_VIRT_START < end) {
+        klog(KLOG_ERR, "[FAILED] vmm_reserve: Region %p - %p overlaps the physical mapping window\n", start, end);
+        return -1;
+    }
+    uint32_t irq_flags = spin_lock_irqsave(&regions_lock);
+    vmm_region_t* free_slot = NULL;
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+        if (!regions[i].used) {
+            if (free_slot == NULL) {
+                free_slot = &regions[i];
+            }
+        }
+        else if (start < regions[i].end && regions[i].start < end) {
+            spin_unlock_irqrestore(&regions_lock, irq_flags);
+            klog(KLOG_ERR, "[FAILED] vmm_reserve: Region %p - %p overlaps an existing reservation\n", start, end);
+            return -1;
+        }
+    }
+    if (free_slot == NULL) {
+        spin_unlock_irqrestore(&regions_lock, irq_flags);
+        klog(KLOG_ERR, "[FAILED] vmm_reserve: No free region slots (max %u)\n", VMM_MAX_REGIONS);
+        return -1;
+    }
+    free_slot->start = start;
+    free_slot->end = end;
+    free_slot->flags = flags & (PTE_WRITABLE | PTE_USER);
+    free_slot->used = true;
+    spin_unlock_irqrestore(&regions_lock, irq_flags);
+    return 0;
+}
+
+/**
+ * Release a region and free the frames of its touched pages
+ */
+int vmm_release(uint32_t start) {
+    uint32_t flags = spin_lock_irqsave(&regions_lock);
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+        if (regions[i].used && regions[i].start == start) {
+            /* Give back every page that was faulted in */
+            paging_unmap_range(regions[i].start, regions[i].end - regions[i].start, frame_release);
+            regions[i].used = false;
+            spin_unlock_irqrestore(&regions_lock, flags);
+            return 0;
+        }
+    }
+    spin_unlock_irqrestore(&regions_lock, flags);
+    klog(KLOG_ERR, "[FAILED] vmm_release: No region starts at %p\n", start);
+    return -1;
+}
+
+/**
+ * Back the faulting page with a fresh zeroed frame
+ */
+int vmm_handle_fault(uint32_t fault_addr, bool user_mode) {
+    uint32_t irq_flags = spin_lock_irqsave(&regions_lock);
+    vmm_region_t* region = vmm_find_region(fault_addr);
+    if (region == NULL || (user_mode && !(region->flags & PTE_USER))) {
+        spin_unlock_irqrestore(&regions_lock, irq_flags);
+        return -1;
+    }
+    uint32_t page = fault_addr & ~(PAGE_SIZE - 1);
+    /* Another CPU took the same fault and backed the page first */
+    if (paging_virt_to_phys(page) != 0) {
+        spin_unlock_irqrestore(&regions_lock, irq_flags);
+        return 0;
+    }
+    uint32_t frame = frame_alloc_zeroed();
+    int result = 0;
+    if (frame == 0) {
+        klog(KLOG_ERR, "[FAILED] vmm_handle_fault: Out of memory backing %p\n", fault_addr);
+        result = -1;
+    }
+    else if (paging_map(page, frame, region->flags) != 0) {
+        frame_free(frame);
+        result = -1;
+    }
+    spin_unlock_irqrestore(&regions_lock, irq_flags);
+    return result;
+}
@@ -0,0 +1,142 @@
+/**
+ * Memory Statistics
+ *
+ * Collects the counters each allocator keeps for itself (see
+ * kernel/vmstat.h) and formats them for the shell. Nothing here is on an
+ * allocation path; the call-site histogram is recorded by kheap.c.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/vmstat.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/pcache.h>
+#include <kernel/debug.h>
+#include <kernel/shell.h>
+
+/* Filled by vmstat_print_sites(); only the shell prints it */
+static kheap_site_t vmstat_sites[KHEAP_SITES + 1];
+
+/**
+ * Take a snapshot of the memory counters
+ */
+void vmstat_get(vmstat_t* stats) {
+    frame_get_stats(&stats->frames);
+    pcache_stats_t cache;
+    pcache_get_stats(&cache);
+    stats->cached = cache.pages;
+    stats->cached_dirty = cache.dirty;
+    kheap_get_info(&stats->heap);
+    stats->heap_largest_free = kheap_largest_free();
+}
+
+/**
+ * Print a frame count with its size
+ */
+static void vmstat_print_frames(const char* name, uint32_t frames) {
+    printf("  %s: %u (%u KiB)\n", name, frames, frames * (FRAME_SIZE / 1024));
+}
+
+/**
+ * Print the memory counters
+ */
+void vmstat_print(void) {
+    vmstat_t stats;
+    vmstat_get(&stats);
+    printf("Frames:\n");
+    vmstat_print_frames("total", stats.frames.total);
+    vmstat_print_frames("reserved", stats.frames.reserved);
+    vmstat_print_frames("free", stats.frames.free);
+    vmstat_print_frames("used", stats.frames.used);
+    vmstat_print_frames("page cache", stats.cached);
+    vmstat_print_frames("page cache dirty", stats.cached_dirty);
+    vmstat_print_frames("zeroed", stats.frames.zeroed);
+    vmstat_print_frames("largest free run", stats.frames.largest_free_run);
+    printf("  free blocks by order:");
+    for (uint32_t order = 0; order <= FRAME_MAX_ORDER; order++) {
+        printf(" %u:%u", order, stats.frames.free_blocks[order]);
+    }
+    printf("\n");
+
+    printf("Heap:\n");
+    printf("  blocks %u / %u used (max %u), largest free run %u\n", stats.heap.blocks_used, stats.heap.blocks,
+           stats.heap.blocks_max, stats.heap_largest_free);
+    for (uint32_t i = 0; i < KHEAP_SLAB_CLASSES; i++) {
+        if (stats.heap.slab[i].slabs != 0) {
+            printf("  %u B: %u slabs, %u objects in use\n", stats.heap.slab[i].obj_size, stats.heap.slab[i].slabs,
+                   stats.heap.slab[i].objs_in_use);
+        }
+    }
+}
+
+/**
+ * Print the call sites with the most live heap memory
+ */
+void vmstat_print_sites(size_t top) {
+    top = top < KHEAP_SITES + 1 ? top : KHEAP_SITES + 1;
+    size_t n = kheap_get_sites(vmstat_sites, top);
+    if (n == 0) {
+        printf("No allocations recorded (vmstat sites on)\n");
+        return;
+    }
+    printf("  live bytes / allocs / frees  site\n");
+    for (size_t i = 0; i < n; i++) {
+        const kheap_site_t* site = &vmstat_sites[i];
+        uint32_t base = 0;
+        const char* name = site->pc != 0 ? debug_find_symbol(site->pc, &base) : "[other sites]";
+        printf("  %u / %u / %u  ", site->live_bytes, site->allocs, site->frees);
+        if (name == NULL) {
+            printf("%p", site->pc);
+        }
+        else if (site->pc != 0) {
+            printf("%s+0x%x", name, site->pc - base);
+        }
+        else {
+            printf("%s", name);
+        }
+        if (site->untracked != 0) {
+            printf(" (%u untracked)", site->untracked);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * Shell command: vmstat
+ *
+ *   vmstat                memory counters
+ *   vmstat sites on|off   start (from empty) or stop the call-site histogram
+ *   vmstat sites [n]      the n call sites with the most live heap memory
+ *
+ * @param args Command arguments
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(vmstat, "memory counters; sites on | off | [n]: heap memory per call site") {
+    if (args[1] == NULL) {
+        vmstat_print();
+    }
+    else if (strcmp(args[1], "sites") == 0 && args[2] != NULL && strcmp(args[2], "on") == 0) {
+        kheap_sites_enable(true);
+        printf("Recording heap allocations per call site\n");
+    }
+    else if (strcmp(args[1], "sites") == 0 && args[2] != NULL && strcmp(args[2], "off") == 0) {
+        kheap_sites_enable(false);
+    }
+    else if (strcmp(args[1], "sites") == 0) {
+        uint32_t top = VMSTAT_SITES_TOP;
+        if (args[2] != NULL && !shell_parse_uint(args[2], &top)) {
+            printf("vmstat: invalid count '%s'\n", args[2]);
+            return 1;
+        }
+        vmstat_print_sites(top);
+    }
+    else {
+        printf("usage: vmstat [sites on | off | [n]]\n");
+    }
+    return 1;
+}
@@ -0,0 +1,174 @@
+/**
+ * Wait Queues
+ *
+ * A FIFO of blocked threads linked through thread_t.wait_next. Each thread
+ * sleeps in at most one queue at a time. Waking unlinks the thread before
+ * making it runnable, so the queue only ever holds actual sleepers.
+ *
+ * Each queue has a spinlock, taken with interrupts disabled since IRQ
+ * handlers wake queues. A sleeper holds it from its condition check until it
+ * is marked blocked, so a waker on any CPU either runs before the check or
+ * finds the sleeper in the queue.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/wait.h>
+#include <kernel/thread.h>
+#include <kernel/spinlock.h>
+
+/**
+ * Unlink a thread from the queue it sleeps in (queue locked)
+ */
+static void wait_remove(wait_queue_t* wq, thread_t* thread) {
+    thread_t* prev = NULL;
+    for (thread_t* t = wq->head; t != NULL; prev = t, t = t->wait_next) {
+        if (t == thread) {
+            if (prev == NULL) {
+                wq->head = t->wait_next;
+            }
+            else {
+                prev->wait_next = t->wait_next;
+            }
+            if (wq->tail == t) {
+                wq->tail = prev;
+            }
+            break;
+        }
+    }
+    thread->wait_next = NULL;
+    thread->wait_queue = NULL;
+}
+
+/**
+ * Take the first sleeper off a queue (queue locked)
+ *
+ * @return Thread, or NULL if the queue is empty
+ */
+static thread_t* wait_dequeue(wait_queue_t* wq) {
+    thread_t* thread = wq->head;
+    if (thread != NULL) {
+        wq->head = thread->wait_next;
+        if (wq->head == NULL) {
+            wq->tail = NULL;
+        }
+        thread->wait_next = NULL;
+        thread->wait_queue = NULL;
+    }
+    return thread;
+}
+
+/**
+ * Initialize an empty wait queue
+ */
+void wait_queue_init(wait_queue_t* wq) {
+    spin_lock_init(&wq->lock);
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+/**
+ * Check if any thread sleeps in a wait queue
+ */
+bool wait_queue_active(const wait_queue_t* wq) {
+    return wq->head != NULL;
+}
+
+/**
+ * Lock a wait queue for a check-then-sleep sequence
+ */
+uint32_t wait_begin(wait_queue_t* wq) {
+    return spin_lock_irqsave(&wq->lock);
+}
+
+/**
+ * Unlock a wait queue and restore interrupts after wait_begin()
+ */
+void wait_end(wait_queue_t* wq, uint32_t flags) {
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * Put the calling thread to sleep in a wait queue (queue locked)
+ */
+void wait_sleep(wait_queue_t* wq) {
+    thread_t* self = thread_current();
+    if (self == NULL) {
+        /* No scheduler yet: halt until the next interrupt, whose handler may need the lock */
+        spin_unlock(&wq->lock);
+        thread_block();
+        spin_lock(&wq->lock);
+        return;
+    }
+    self->wait_next = NULL;
+    self->wait_queue = wq;
+    if (wq->tail == NULL) {
+        wq->head = self;
+    }
+    else {
+        wq->tail->wait_next = self;
+    }
+    wq->tail = self;
+    thread_block_unlock(&wq->lock);
+    spin_lock(&wq->lock);
+    /* Woken directly with thread_unblock() rather than through the queue */
+    if (self->wait_queue != NULL) {
+        wait_remove(self->wait_queue, self);
+    }
+}
+
+/**
+ * Wake every sleeper of a locked queue with a priority boost
+ */
+static void wake_up_boost_locked(wait_queue_t* wq, uint32_t boost) {
+    thread_t* thread;
+    while ((thread = wait_dequeue(wq)) != NULL) {
+        thread_unblock_boost(thread, boost);
+    }
+}
+
+/**
+ * Wake every sleeper of a queue locked with wait_begin()
+ */
+void wake_up_locked(wait_queue_t* wq) {
+    wake_up_boost_locked(wq, 0);
+}
+
+/**
+ * Wake the longest sleeper of a queue locked with wait_begin()
+ */
+bool wake_up_one_locked(wait_queue_t* wq) {
+    thread_t* thread = wait_dequeue(wq);
+    if (thread != NULL) {
+        thread_unblock(thread);
+    }
+    return thread != NULL;
+}
+
+/**
+ * Wake every sleeper with a priority boost
+ */
+void wake_up_boost(wait_queue_t* wq, uint32_t boost) {
+    uint32_t flags = wait_begin(wq);
+    wake_up_boost_locked(wq, boost);
+    wait_end(wq, flags);
+}
+
+/**
+ * Wake every thread sleeping in a wait queue
+ */
+void wake_up(wait_queue_t* wq) {
+    wake_up_boost(wq, 0);
+}
+
+/**
+ * Wake the thread that has slept longest in a wait queue
+ */
+bool wake_up_one(wait_queue_t* wq) {
+    uint32_t flags = wait_begin(wq);
+    bool woken = wake_up_one_locked(wq);
+    wait_end(wq, flags);
+    return woken;
+}
@@ -0,0 +1,35 @@
+#ifndef _KERNEL_APIC_H
+#define _KERNEL_APIC_H
+
+#include <stdbool.h>
+
+/**
+ * APIC Interrupt Delivery
+ *
+ * With a local APIC and an IOAPIC described by the ACPI MADT, apic_init()
+ * masks the 8259 PICs and routes the 16 ISA IRQs through the IOAPIC to the
+ * same vectors (32-47), so irq_handler() and reqister_irq() work unchanged:
+ *
+ *   device → IOAPIC pin (GSI, from the MADT overrides) → LAPIC → vector 32 + irq
+ *   EOI: one MMIO store to the LAPIC instead of port writes to the PICs
+ *
+ * timer_initialize() then replaces the PIT with the LAPIC timer as the tick
+ * source. Without an APIC (or before apic_init()) the 8259s stay in charge.
+ */
+
+/**
+ * Switch interrupt delivery to the local APIC and IOAPIC
+ *
+ * Call after paging_init() (the registers are memory-mapped) and before
+ * timer_initialize(). Handlers registered earlier are rerouted.
+ *
+ * @return 0 on success, -1 if there is no usable APIC (the PICs stay in use)
+ */
+int apic_init(void);
+
+/**
+ * Check whether interrupts are delivered through the APIC
+ */
+bool apic_enabled(void);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef KERNEL_ARENA_H
+#define KERNEL_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Arena (Bump-Pointer) Allocator
+ * Based on: https://www.gingerbill.org/article/2019/02/08/memory-allocation-strategies-002/
+ *
+ * For short-lived allocations that all die together, e.g. everything one
+ * shell command parses and executes. Allocation moves a pointer forward;
+ * arena_reset() drops everything at once instead of kfree()ing each object.
+ *
+ * Chunks are whole heap blocks. The first chunk is kept across resets;
+ * chunks added when it fills up are returned to the heap by arena_reset().
+ */
+
+/* Alignment of every arena allocation */
+#define ARENA_ALIGN         8
+
+/* Chunk header, at the start of every chunk */
+typedef struct arena_chunk {
+    struct arena_chunk* next;   /* Next extra chunk (NULL for the base chunk) */
+} arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t* base;        /* First chunk, kept across resets */
+    arena_chunk_t* extra;       /* Chunks added since the last reset */
+    uint8_t* ptr;               /* Next free byte in the current chunk */
+    uint8_t* end;               /* End of the current chunk */
+    void* last;                 /* Most recent allocation (for arena_realloc()) */
+    size_t chunk_size;          /* Size of new chunks in bytes */
+} arena_t;
+
+/**
+ * Initialize an arena and allocate its first chunk
+ *
+ * @param arena Arena to initialize
+ * @param chunk_size Chunk size in bytes (rounded up to whole heap blocks)
+ * @return 0 on success, -1 if the first chunk could not be allocated
+ */
+int arena_init(arena_t* arena, size_t chunk_size);
+
+/**
+ * Allocate from an arena
+ *
+ * Requests larger than a chunk get a chunk of their own.
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes
+ * @return Pointer aligned to ARENA_ALIGN, or NULL on failure
+ */
+void* arena_alloc(arena_t* arena, size_t size);
+
+/**
+ * Resize an arena allocation
+ *
+ * The most recent allocation grows or shrinks in place while it fits the
+ * current chunk; anything else is copied to a new allocation (the old space
+ * is reclaimed by the next reset).
+ *
+ * @param arena Arena the allocation came from
+ * @param ptr Allocation to resize (NULL behaves like arena_alloc())
+ * @param old_size Current size of the allocation
+ * @param size New size in bytes
+ * @return New pointer, or NULL on failure (ptr stays valid)
+ */
+void* arena_realloc(arena_t* arena, void* ptr, size_t old_size, size_t size);
+
+/**
+ * Free everything allocated from an arena
+ *
+ * O(1) unless extra chunks were added since the last reset.
+ */
+void arena_reset(arena_t* arena);
+
+/**
+ * Free an arena's chunks, including the base chunk
+ */
+void arena_destroy(arena_t* arena);
+
+#endif /* KERNEL_ARENA_H */
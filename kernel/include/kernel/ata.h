@@ -0,0 +1,58 @@
+#ifndef _KERNEL_ATA_H
+#define _KERNEL_ATA_H
+
+#include <stdint.h>
+
+#include <kernel/block.h>
+
+/**
+ * ATA Disk Driver (IDE, PIO and Bus-Master DMA)
+ *
+ * The two legacy IDE channels, each with a master and a slave drive,
+ * become block devices hda, hdb (primary, IRQ 14) and hdc, hdd (secondary,
+ * IRQ 15). ATAPI drives (CD-ROMs) answer IDENTIFY with their signature and
+ * are skipped.
+ *
+ * A request is one ATA command of up to 256 sectors (LBA28):
+ *
+ *   DMA (drive and controller capable, buffers translate to physical pages):
+ *     PRD table ← one entry per physically contiguous piece of every I/O
+ *     READ DMA / WRITE DMA → start the bus master → IRQ once, at the end
+ *   PIO:
+ *     READ SECTORS  → IRQ per sector → insw 256 words
+ *     WRITE SECTORS → outsw the first sector → IRQ per sector → next one
+ *
+ * Either way the submitting thread sleeps (kernel/block.h) and the IRQ
+ * completes the request. Master and slave share their channel's registers,
+ * so a drive whose channel is busy waits for the other drive's command to
+ * end.
+ *
+ * Writes end in the drive's write cache; there is no FLUSH CACHE yet.
+ *
+ * Reference: https://wiki.osdev.org/ATA_PIO_Mode, https://wiki.osdev.org/ATA/ATAPI_using_DMA
+ */
+
+#define ATA_MAX_SECTORS         256     /* Sector count 0 means 256 */
+#define ATA_PRD_MAX             512     /* Scatter/gather entries in the one-page PRD table */
+
+typedef struct {
+    uint64_t dma_requests;              /* Requests moved by the bus master */
+    uint64_t pio_requests;              /* ... and by the CPU */
+    uint64_t interrupts;                /* Completion IRQs for this drive */
+} ata_stats_t;
+
+/**
+ * Probe both IDE channels and register their drives (initcall)
+ *
+ * @return 0, with or without drives
+ */
+int ata_init(void);
+
+/**
+ * Get transfer statistics of an ATA drive
+ *
+ * @return 0 on success, -1 if dev isn't an ATA drive
+ */
+int ata_get_stats(block_device_t* dev, ata_stats_t* stats);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _KERNEL_BENCH_H
+#define _KERNEL_BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Microbenchmarks
+ *
+ *   BENCH("kmalloc_64", 1000) {
+ *       kfree(kmalloc(64));
+ *   }
+ *
+ * runs the body 1000 times and times every iteration on its own with a
+ * serialized TSC read (cpuid; rdtsc), so out-of-order execution can't move
+ * work across the boundaries. The cost of the timing itself is measured once
+ * with an empty body and subtracted. When the loop ends, one line goes to
+ * COM1:
+ *
+ *   BENCH kmalloc_64 iterations=1000 min=152 median=160 p99=410 max=2210
+ *
+ * (cycles per iteration). tests/run_benchmarks.py boots a kernel full of
+ * these and compares the numbers with a stored baseline.
+ */
+
+#define BENCH_MAX_ITERATIONS    4096    /* Samples kept per benchmark */
+
+typedef struct {
+    const char* name;           /* NULL for the internal calibration run */
+    uint32_t iterations;        /* 0 if the benchmark can't run */
+    uint32_t done;              /* Iterations timed so far */
+    uint32_t* cycles;           /* Cycles of each iteration */
+    uint64_t start;             /* TSC at the start of the current iteration */
+    bool timing;                /* An iteration is in progress */
+} bench_t;
+
+typedef struct {
+    uint32_t iterations;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+} bench_result_t;
+
+/**
+ * Time the following statement or block
+ *
+ * @param name Benchmark name (no spaces; the runner keys results by it)
+ * @param iterations Number of timed runs (at most BENCH_MAX_ITERATIONS)
+ */
+#define BENCH(name, iterations) \
+    for (bench_t bench_state_ = bench_begin((name), (iterations)); bench_next(&bench_state_);)
+
+/**
+ * Prepare a benchmark (use BENCH())
+ */
+bench_t bench_begin(const char* name, uint32_t iterations);
+
+/**
+ * End the current iteration and start the next (use BENCH())
+ *
+ * @return false once all iterations ran; the result has then been reported
+ */
+bool bench_next(bench_t* bench);
+
+/**
+ * Result of the last benchmark that finished
+ */
+bench_result_t bench_last_result(void);
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef _KERNEL_BLOCK_H
+#define _KERNEL_BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/spinlock.h>
+#include <kernel/wait.h>
+
+/**
+ * Block Devices
+ *
+ * Callers describe a transfer with a block_io_t and submit it; the device's
+ * queue turns I/Os into requests, orders them and feeds them to the driver
+ * one at a time:
+ *
+ *   block_submit(io)
+ *     → a queued request of the same direction ends where io starts, or
+ *       starts where io ends (and the sum fits max_sectors)?  merge into it
+ *     → else take a request from the pool, insert it sorted by LBA
+ *     → device idle?  dispatch
+ *
+ *   dispatch (elevator, C-LOOK): the first queued request at or after the
+ *   end of the last one, wrapping to the lowest LBA once none is left ahead
+ *     → ops->start(dev, req)                       (driver programs the disk)
+ *
+ *   IRQ → driver → block_complete(dev, status)
+ *     → every I/O of the request gets status and its done() callback
+ *       (default: wake the thread sleeping in block_wait())
+ *     → dispatch the next request
+ *
+ * The caller's thread only sleeps while its I/O is in flight: the CPU runs
+ * other threads until the completion interrupt. block_read() and
+ * block_write() are the synchronous wrappers.
+ *
+ * Requests come from a fixed pool per device (BLOCK_QUEUE_DEPTH); a submitter
+ * finding it empty sleeps until one completes. The queue lock is taken with
+ * interrupts disabled, since completions run in IRQ handlers.
+ */
+
+#define BLOCK_SECTOR_SIZE       512
+#define BLOCK_QUEUE_DEPTH       32      /* Requests a device can have queued and in flight */
+#define BLOCK_NAME_MAX          8
+#define BLOCK_PENDING           1       /* block_io_t.status until the I/O completes */
+
+typedef struct block_device block_device_t;
+typedef struct block_io block_io_t;
+typedef struct block_request block_request_t;
+
+/**
+ * One transfer a caller asked for
+ */
+struct block_io {
+    uint32_t lba;                       /* First sector */
+    uint32_t count;                     /* Sectors */
+    void* buffer;                       /* count * BLOCK_SECTOR_SIZE bytes, kernel memory */
+    bool write;
+    volatile int status;                /* BLOCK_PENDING, then 0 or -1 */
+    void (*done)(block_io_t* io);       /* Called from the completion IRQ; NULL wakes block_wait() */
+    void* data;                         /* For done() */
+    wait_queue_t wait;
+    block_io_t* next;                   /* Next I/O of the same request, in LBA order */
+};
+
+/**
+ * I/Os merged into one contiguous transfer
+ */
+struct block_request {
+    uint32_t lba;
+    uint32_t count;                     /* Sum of the I/Os' counts */
+    bool write;
+    block_io_t* first;
+    block_io_t* last;
+    block_request_t* next;              /* Queue (sorted by LBA) or pool link */
+};
+
+typedef struct {
+    /**
+     * Start a transfer (queue lock held, interrupts disabled)
+     *
+     * The driver reports the end with block_complete() once the device
+     * interrupts.
+     *
+     * @return 0 if the transfer was started, -1 if it fails right away
+     */
+    int (*start)(block_device_t* dev, block_request_t* req);
+} block_ops_t;
+
+typedef struct {
+    uint64_t ios;                       /* I/Os submitted */
+    uint64_t merged;                    /* ... that joined a queued request */
+    uint64_t requests;                  /* Requests dispatched to the driver */
+    uint64_t sectors_read;
+    uint64_t sectors_written;
+    uint64_t errors;                    /* I/Os completed with -1 */
+} block_stats_t;
+
+struct block_device {
+    char name[BLOCK_NAME_MAX];
+    uint32_t sectors;                   /* Capacity */
+    uint32_t max_sectors;               /* Largest request the driver takes */
+    const block_ops_t* ops;
+    void* priv;                         /* Driver data */
+
+    /* Set up by block_register() */
+    spinlock_t lock;
+    block_request_t* queue;             /* Waiting requests, sorted by LBA */
+    block_request_t* active;            /* In flight, NULL if idle */
+    block_request_t* pool;              /* Free requests */
+    block_request_t requests[BLOCK_QUEUE_DEPTH];
+    wait_queue_t pool_wait;             /* Submitters waiting for a free request */
+    uint32_t head;                      /* LBA after the last dispatched request */
+    block_stats_t stats;
+    block_device_t* next;               /* Registered devices */
+};
+
+/**
+ * Make a driver's device usable (name, sectors, max_sectors and ops filled in)
+ *
+ * @return 0 on success, -1 if the name is taken
+ */
+int block_register(block_device_t* dev);
+
+/**
+ * Find a registered device by name ("hda", ...)
+ */
+block_device_t* block_find(const char* name);
+
+/**
+ * Registered device by position, for listing them
+ *
+ * @return Device, or NULL past the last one
+ */
+block_device_t* block_get(uint32_t index);
+
+/**
+ * Queue an I/O and return without waiting (io->status is BLOCK_PENDING until done)
+ *
+ * Sleeps only if the device's request pool is exhausted.
+ *
+ * @return 0 if queued, -1 if the range is outside the device or empty (io isn't touched further)
+ */
+int block_submit(block_device_t* dev, block_io_t* io);
+
+/**
+ * Sleep until a submitted I/O without done() has completed
+ *
+ * @return Its status: 0 on success, -1 on a device error
+ */
+int block_wait(block_io_t* io);
+
+/**
+ * Read sectors, sleeping until they are there
+ *
+ * @return 0 on success, -1 on error
+ */
+int block_read(block_device_t* dev, uint32_t lba, uint32_t count, void* buffer);
+
+/**
+ * Write sectors, sleeping until the device has taken them
+ *
+ * @return 0 on success, -1 on error
+ */
+int block_write(block_device_t* dev, uint32_t lba, uint32_t count, const void* buffer);
+
+/**
+ * Finish the request in flight and start the next (driver, from its IRQ handler)
+ *
+ * @param status 0 if the transfer succeeded, -1 otherwise
+ */
+void block_complete(block_device_t* dev, int status);
+
+/**
+ * Get a device's queue statistics
+ */
+void block_get_stats(block_device_t* dev, block_stats_t* stats);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _KERNEL_CRASHDUMP_H
+#define _KERNEL_CRASHDUMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/multiboot.h>
+
+struct regs;
+
+/**
+ * Binary Crash Dump
+ *
+ * A panic prints text to the console, which is slow, and the text scrolls
+ * away. With "crashdump" on the kernel command line (or after
+ * crashdump_enable()), the first panic or unhandled fault first sends one
+ * binary dump to the serial port. Interrupts are off, and the bytes go out
+ * in bursts of one FIFO each, before any text is printed:
+ *
+ *   "OLYCRASH" version                  crashdump_header_t
+ *   type length payload                 one crashdump_section_t per section; payloads are padded to 4 bytes
+ *     REASON     the panic message (format string, not formatted)
+ *     REGS       crashdump_regs_t: trap frame, control registers, thread
+ *     BACKTRACE  return addresses of the frame pointer chain
+ *     STACK      base address, then the raw stack from ESP to the top
+ *     TRACE      count, then the newest trace_record_t of the trace ring
+ *     HEAP       kheap_info_t
+ *   END        CRC-32 of every byte before this section
+ *
+ * Nothing is symbolized in the kernel. tests/crashdump.py finds the dumps in
+ * a serial log and decodes them with the kernel ELF's symbols:
+ *
+ *   python tests/crashdump.py serial.log isodir/boot/olympos.kernel
+ */
+
+#define CRASHDUMP_MAGIC         "OLYCRASH"
+#define CRASHDUMP_VERSION       1
+#define CRASHDUMP_STACK_MAX     4096    /* Most stack bytes dumped */
+#define CRASHDUMP_TRACE_MAX     256     /* Newest trace records dumped */
+
+/* Section types */
+#define CRASHDUMP_SECTION_REASON        1
+#define CRASHDUMP_SECTION_REGS          2
+#define CRASHDUMP_SECTION_BACKTRACE     3
+#define CRASHDUMP_SECTION_STACK         4
+#define CRASHDUMP_SECTION_TRACE         5
+#define CRASHDUMP_SECTION_HEAP          6
+#define CRASHDUMP_SECTION_END           0xFFFF
+
+/* crashdump_regs_t.flags */
+#define CRASHDUMP_REGS_TRAP     0x1     /* From a trap frame; otherwise the registers of the crashdump_write() call */
+
+typedef struct {
+    char magic[8];                      /* CRASHDUMP_MAGIC, no terminator */
+    uint32_t version;
+} crashdump_header_t;
+
+typedef struct {
+    uint16_t type;                      /* CRASHDUMP_SECTION_* */
+    uint16_t reserved;
+    uint32_t length;                    /* Payload bytes, without the padding */
+} crashdump_section_t;
+
+typedef struct {
+    /* regs_t, in the order isr_stubs.nasm pushes it */
+    uint32_t ds, edi, esi, ebp, esp_dummy, ebx, edx, ecx, eax;
+    uint32_t int_no, err_code;
+    uint32_t eip, cs, eflags, useresp, ss;
+    /* Real ESP of the interrupted code: useresp from ring 3, the end of the frame in ring 0 */
+    uint32_t esp;
+    uint32_t cr0, cr2, cr3, cr4;
+    uint32_t thread;                    /* ID of the running thread */
+    uint32_t flags;                     /* CRASHDUMP_REGS_* */
+} crashdump_regs_t;
+
+/**
+ * Enable the dump if the command line asks for it
+ *
+ * "crashdump" on the command line selects COM1.
+ *
+ * @param mbi Multiboot information (for the command line)
+ * @return 0 (no dump is no error)
+ */
+int crashdump_init(multiboot_info_t* mbi);
+
+/**
+ * Select where crashdump_write() sends the dump
+ *
+ * @param port Serial port base (SERIAL_COM1_BASE, ...), 0 to disable the dump
+ */
+void crashdump_enable(uint16_t port);
+
+/**
+ * Send the crash dump, unless it is disabled or a dump was sent before
+ *
+ * Takes no locks and allocates nothing; tracing stops. The first caller is
+ * the only one that sends a dump, so a panic after a fault dump adds none.
+ *
+ * @param regs Trap frame, or NULL for the registers of this call
+ * @param reason What happened
+ * @return 0 if the dump was sent, -1 if not
+ */
+int crashdump_write(const struct regs* regs, const char* reason);
+
+/**
+ * Build the crash dump in memory instead
+ *
+ * @param buf Destination
+ * @param size Capacity of buf
+ * @param regs Trap frame, or NULL for the registers of this call
+ * @param reason What happened
+ * @return Size of the dump, or 0 if it doesn't fit into buf
+ */
+size_t crashdump_capture(void* buf, size_t size, const struct regs* regs, const char* reason);
+
+#endif
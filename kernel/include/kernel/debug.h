@@ -2,6 +2,7 @@
 #define _KERNEL_DEBUG_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <kernel/multiboot.h>
 
@@ -12,11 +13,35 @@
  */
 void debug_initialize(multiboot_info_t* mbi);
 
+/* Deepest backtrace print_backtrace() shows */
+#define DEBUG_BACKTRACE_MAX     32
+
 /**
  * Print a backtrace of the current call stack
  */
 void print_backtrace(void);
 
+/**
+ * Get the bounds of the running thread's kernel stack
+ *
+ * @param lo Set to the lowest address of the stack
+ * @param hi Set to the address just above it (the initial ESP)
+ */
+void debug_stack_bounds(uint32_t* lo, uint32_t* hi);
+
+/**
+ * Collect the return addresses of a frame pointer chain
+ *
+ * Stops at the first frame that isn't on the current stack or doesn't lie
+ * above the previous one, so it is safe on a corrupt chain and in IRQ context.
+ *
+ * @param ebp Frame pointer to start from (the innermost frame)
+ * @param pcs Filled with return addresses, innermost first
+ * @param max Capacity of pcs
+ * @return Number of addresses stored
+ */
+size_t debug_unwind(uint32_t ebp, uint32_t* pcs, size_t max);
+
 /**
  * Find and return the symbol name for a given memory address
  *
@@ -25,6 +50,17 @@ void print_backtrace(void);
  */
 const char* find_symbol_for_address(uint32_t addr);
 
+/**
+ * Find the function containing an address
+ *
+ * One binary search over the symbol index built by debug_initialize().
+ *
+ * @param addr The memory address to look up
+ * @param base If not NULL, set to the function's start address on success
+ * @return The function's name, or NULL if no function contains addr
+ */
+const char* debug_find_symbol(uint32_t addr, uint32_t* base);
+
 /**
  * End of all kernel ELF sections (page-aligned)
  * This marks where the kernel heap can begin
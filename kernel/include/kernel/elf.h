@@ -0,0 +1,26 @@
+#ifndef _KERNEL_ELF_H
+#define _KERNEL_ELF_H
+
+#include <kernel/process.h>
+#include <kernel/module.h>
+
+/**
+ * ELF Program Loader
+ *
+ * Accepts statically linked ELF32 i386 executables (ET_EXEC) whose PT_LOAD
+ * segments lie in the user range, below the stack.
+ */
+
+/**
+ * Validate an executable and record its segments in a process
+ *
+ * Fills proc->entry, proc->segments and proc->segment_count; no memory is
+ * mapped. The module must stay registered while the process runs.
+ *
+ * @param proc Process being created
+ * @param mod Module holding the executable
+ * @return 0 on success, -1 if the file is not a loadable program
+ */
+int elf_load(process_t* proc, const module_t* mod);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _KERNEL_FBCON_H
+#define _KERNEL_FBCON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/multiboot.h>
+
+/**
+ * Framebuffer Console
+ *
+ * When GRUB sets a linear RGB mode (multiboot framebuffer info), the text
+ * console draws its cells there instead of into VGA text memory. The cell
+ * model stays in vga.c: the shadow ring, scrollback and dirty tracking all
+ * work as before, only vga_flush() hands each dirty span of cells here.
+ *
+ * Glyphs are 8x16 bitmaps. Turning bits into pixels is done once per
+ * (color attribute, character) into a glyph cache, so drawing a cell is a
+ * copy of 16 rows of ready pixels, 32-bit words at a time:
+ *
+ *   cell (char, attr) → cache for attr (LRU over FBCON_GLYPH_CACHES slots)
+ *                     → glyph rendered? no: expand bitmap to pixels once
+ *                     → per pixel row, across the whole span: copy 8 px
+ *
+ * A span is drawn row by row over all its cells, so the framebuffer is
+ * written in address order, one scanline segment after the other.
+ */
+
+#define FBCON_GLYPH_WIDTH       8
+#define FBCON_GLYPH_HEIGHT      16
+#define FBCON_GLYPH_CACHES      8       /* Color attributes with rendered glyphs at a time */
+
+/* Console font, one byte per glyph row, bit 7 = leftmost pixel */
+extern const uint8_t fbcon_font[256][FBCON_GLYPH_HEIGHT];
+
+typedef struct {
+    uint64_t cells_drawn;               /* Cells copied to the framebuffer */
+    uint64_t spans_drawn;               /* Calls to fbcon_draw_cells() */
+    uint64_t glyphs_rendered;           /* Cache misses: bitmaps expanded to pixels */
+    uint64_t cache_evictions;           /* Attributes that lost their slot to another */
+} fbcon_stats_t;
+
+/**
+ * Take over the console if the bootloader set up a linear framebuffer
+ *
+ * Needs the kernel heap for the glyph caches. The text grid becomes
+ * width / 8 by height / 16 cells (at most CONSOLE_MAX_COLS x CONSOLE_MAX_ROWS)
+ * and what was on the screen is redrawn there.
+ *
+ * @param mbi Multiboot information
+ * @return 0 on success, -1 if there is no 16/24/32 bpp RGB framebuffer of at
+ *         least 80x25 cells (or no memory): the console stays in VGA text mode
+ */
+int fbcon_init(multiboot_info_t* mbi);
+
+/**
+ * Check whether the console draws to the framebuffer
+ */
+bool fbcon_active(void);
+
+/**
+ * Draw a span of text cells (caller serializes, as vga.c does under the terminal lock)
+ *
+ * @param x     Column of the first cell
+ * @param y     Row
+ * @param cells VGA-style cells: character in the low byte, color attribute in the high byte
+ * @param count Cells (must fit on the row)
+ */
+void fbcon_draw_cells(size_t x, size_t y, const uint16_t* cells, size_t count);
+
+/**
+ * Draw the cursor, an underline in the cell's foreground color
+ *
+ * It stays until the cell is drawn again.
+ */
+void fbcon_draw_cursor(size_t x, size_t y, uint16_t cell);
+
+/**
+ * Get the drawing counters
+ */
+void fbcon_get_stats(fbcon_stats_t* stats);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _KERNEL_FPU_H
+#define _KERNEL_FPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/thread.h>
+
+/**
+ * Lazy FPU/SSE Context Switching
+ *
+ * The x87 and SSE registers are not saved on a thread switch. They stay in
+ * the CPU until a different thread executes an FPU or SSE instruction, which
+ * traps (#NM) and swaps the state then. Threads that never use the FPU cost
+ * nothing: no trap, no save area.
+ *
+ * A forked child and every new thread start from a freshly initialized FPU.
+ * fork() is a function call, and the i386 ABI keeps no live values in FPU
+ * registers across calls, so only a changed control word is not inherited.
+ *
+ * Kernel code itself is built without floating point. To run SSE code it
+ * borrows the registers for a short section:
+ *
+ *   if (kernel_fpu_begin()) {   preemption off, the owner's state saved, TS clear
+ *       ... movups/movaps ...
+ *       kernel_fpu_end();       TS set: the owner traps and reloads on its next use
+ *   } else {
+ *       ... integer fallback ...
+ *   }
+ */
+
+#define FPU_STATE_SIZE          512     /* fxsave area (fnsave needs 108 bytes of it) */
+#define FPU_STATE_ALIGN         16      /* Required by fxsave/fxrstor */
+
+/**
+ * Enable the FPU and SSE on the boot CPU and install the #NM handler
+ *
+ * Call after idt_init(). Without an FPU floating point stays disabled and
+ * context switches never touch CR0.
+ *
+ * @return 0 on success, -1 if the CPU has no FPU
+ */
+int fpu_init(void);
+
+/**
+ * Enable the FPU and SSE on the running CPU (application processors)
+ */
+void fpu_init_cpu(void);
+
+/**
+ * Arm the #NM trap for the thread about to run (scheduler, interrupts disabled)
+ *
+ * Clears CR0.TS if next's state is the one in the registers, sets it otherwise.
+ *
+ * @param next Thread being switched to
+ */
+void fpu_switch(thread_t* next);
+
+/**
+ * Save a blocking thread's registers if this CPU holds them (scheduler, before switching away from it)
+ *
+ * Its next FPU instruction then traps and reloads them, on whichever CPU it wakes up.
+ *
+ * @param thread Thread leaving the CPU
+ */
+void fpu_thread_leave(thread_t* thread);
+
+/**
+ * Drop an exited thread's FPU state (scheduler, after switching away from it)
+ *
+ * @param thread Dead thread; its save area is freed
+ */
+void fpu_thread_exit(thread_t* thread);
+
+/**
+ * Borrow the SSE registers for kernel code
+ *
+ * Saves the state of the thread that owns the registers and disables
+ * preemption until kernel_fpu_end(). The section must not sleep. Usable from
+ * IRQ handlers too; an interrupt that arrives inside a section gets false
+ * instead of clobbering it.
+ *
+ * @return true if SSE code may run now; false without SSE (or before
+ *         fpu_init()) or inside another section on this CPU
+ */
+bool kernel_fpu_begin(void);
+
+/**
+ * End a section started by a successful kernel_fpu_begin()
+ */
+void kernel_fpu_end(void);
+
+/**
+ * Number of #NM traps handled (state swaps plus first uses)
+ */
+uint32_t fpu_trap_count(void);
+
+#endif
@@ -6,5 +6,7 @@
 
 /* Cross-architecture GDT functions (architecture-specific types live under arch/<arch>/include) */
 void gdt_init(void);
+void tss_set_kernel_stack(uint32_t esp0);
+const uint32_t* tss_kernel_stack_slot(void);
 
 #endif
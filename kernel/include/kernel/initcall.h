@@ -0,0 +1,98 @@
+#ifndef _KERNEL_INITCALL_H
+#define _KERNEL_INITCALL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Boot Initcalls
+ *
+ * kernel_main() lists its init stages in a table and hands it to
+ * initcall_run(), which stamps the TSC around each one. initcall_report()
+ * then logs how long each stage took and how far into boot it started.
+ *
+ * Stages nothing else at boot depends on can be flagged to run later, once
+ * the scheduler is up:
+ *
+ *   INITCALL_DEFERRED  run in order by one "initcalls" thread
+ *   INITCALL_PARALLEL  run by a thread of its own, next to the others
+ *
+ * initcall_start_deferred() starts those threads; the last one to finish
+ * logs their timings. Threads only run on the boot CPU, so parallel stages
+ * overlap their waits (ksleep(), polling a device), not their CPU time.
+ */
+
+#define INITCALL_DEFERRED       0x1     /* Run after boot, in order, in the initcall thread */
+#define INITCALL_PARALLEL       0x2     /* Run after boot in a thread of its own */
+
+#define INITCALL_MAX            32      /* Stages recorded; more still run, untimed */
+
+/* An init stage */
+typedef struct {
+    const char* name;
+    int (*func)(void);                  /* 0 on success, -1 on failure */
+    uint32_t flags;                     /* INITCALL_* */
+} initcall_t;
+
+/* What happened to a stage */
+typedef struct {
+    const char* name;
+    uint32_t flags;
+    int result;                         /* Return value of func, valid once done */
+    bool done;
+    uint64_t start;                     /* TSC cycles after the first initcall_run() when it started */
+    uint64_t cycles;                    /* TSC cycles it took (0 without a TSC) */
+} initcall_record_t;
+
+/**
+ * Run the stages of a table in order
+ *
+ * Deferred and parallel stages are only recorded until
+ * initcall_start_deferred(). The first call marks the start of boot.
+ *
+ * @param calls Table of stages (must stay valid until the deferred ones ran)
+ * @param count Number of entries
+ */
+void initcall_run(const initcall_t* calls, size_t count);
+
+/**
+ * Start the threads for the deferred and parallel stages
+ *
+ * Call after sched_init(). Before it the stages run right here instead.
+ *
+ * @return Number of threads started, or -1 if one couldn't be created
+ *         (its stages then run in the caller)
+ */
+int initcall_start_deferred(void);
+
+/**
+ * Wait until every deferred and parallel stage has finished
+ */
+void initcall_wait_deferred(void);
+
+/**
+ * Log the boot-time breakdown of the stages that have finished
+ */
+void initcall_report(void);
+
+/**
+ * Number of stages recorded
+ */
+size_t initcall_count(void);
+
+/**
+ * Get the record of a stage
+ *
+ * @param index 0 .. initcall_count() - 1, in table order
+ * @param record Filled with a copy
+ * @return 0 on success, -1 if index is out of range
+ */
+int initcall_get_record(size_t index, initcall_record_t* record);
+
+/**
+ * Convert TSC cycles to microseconds (0 until the timer calibrated the TSC)
+ */
+uint64_t initcall_cycles_to_us(uint64_t cycles);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _KERNEL_INITRD_H
+#define _KERNEL_INITRD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/vfs.h>
+
+/**
+ * Initial RAM Filesystem
+ *
+ * A tar (ustar) or cpio (newc) archive loaded as a boot module becomes the
+ * root of the VFS, read-only:
+ *
+ *   menuentry ... {
+ *       multiboot /boot/olympos.kernel
+ *       module /boot/modules/initrd.tar     (iso.sh packs sysroot/initrd/ into it)
+ *   }
+ *
+ * The archive is parsed once, when it is mounted, into a tree of inodes that
+ * point into the module's memory: file contents are never copied, and ELF
+ * programs run from it share their text frames like programs loaded from
+ * their own module (see process_exec()).
+ *
+ * Regular files and directories are kept; directories an entry's path
+ * implies are created even if the archive doesn't list them. Links, devices
+ * and other entry types are skipped.
+ */
+
+#define INITRD_MODULE_PREFIX    "initrd"        /* Modules named initrd* are mounted at boot */
+
+/**
+ * Build the inode tree of an archive
+ *
+ * @param data Archive contents (must stay mapped: files point into it)
+ * @param size Archive size in bytes
+ * @param phys Physical address of data, 0 if it isn't physically contiguous
+ * @return Root directory inode (for vfs_mount_root()), or NULL if data isn't tar or cpio, or out of memory
+ */
+inode_t* initrd_load(const void* data, size_t size, uint32_t phys);
+
+/**
+ * Mount the first boot module named initrd* as the root (after module_init() and kheap_init())
+ *
+ * @return 0 if it was mounted or there is none, -1 if it couldn't be
+ */
+int initrd_init(void);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef _KERNEL_IORING_H
+#define _KERNEL_IORING_H
+
+#include <stdint.h>
+
+#include <kernel/wait.h>
+#include <kernel/thread.h>
+
+/**
+ * Batched System Calls (submission/completion rings, io_uring style)
+ *
+ * SYSCALL_IORING_SETUP maps a ring into the calling process at
+ * USER_RING_BASE. User space fills submission entries (SQEs) and advances
+ * sq_tail; one SYSCALL_IORING_ENTER runs all of them. Each result comes
+ * back as a completion entry (CQE) that user space consumes by advancing
+ * cq_head. With IORING_SETUP_SQPOLL a kernel thread runs the submissions
+ * instead, so a busy process needs no system call at all.
+ *
+ * Ring layout (one allocation, the offsets are fixed):
+ *
+ *   USER_RING_BASE + 0                      ioring_shared_t header
+ *                  + IORING_SQ_OFFSET       sq_entries SQEs
+ *                  + cq_offset              cq_entries CQEs (2 x sq_entries)
+ *
+ * Who writes what:
+ *   sq_tail, cq_head   user space (producer of SQEs, consumer of CQEs)
+ *   sq_head, cq_tail   kernel (consumer of SQEs, producer of CQEs)
+ *
+ * The kernel copies each SQE before looking at it, so user space changing it
+ * concurrently can't get a buffer past validation. Buffers are checked like
+ * those of the equivalent system call, which does the actual work.
+ *
+ * A process has at most one ring; it lives until the process exits.
+ */
+
+#define IORING_MAX_ENTRIES      128         /* Submission entries per ring (power of two) */
+#define IORING_SQ_OFFSET        64          /* SQEs start after the header */
+
+/* Setup flags */
+#define IORING_SETUP_SQPOLL     0x1         /* A kernel thread polls the submission queue */
+
+/* Enter flags */
+#define IORING_ENTER_GETEVENTS  0x1         /* Wait for min_complete completions (SQPOLL rings) */
+#define IORING_ENTER_SQ_WAKEUP  0x2         /* Wake a polling thread that went to sleep */
+
+/* Shared flags (kernel → user) */
+#define IORING_SQ_NEED_WAKEUP   0x1         /* The polling thread sleeps: enter with IORING_ENTER_SQ_WAKEUP */
+
+/* Time a polling thread spins on an empty queue before it sleeps */
+#define IORING_SQPOLL_IDLE_MS   20
+
+/* Operations */
+#define IORING_OP_NOP           0
+#define IORING_OP_READ          1           /* read(fd, addr, len) */
+#define IORING_OP_WRITE         2           /* write(fd, addr, len) */
+
+/**
+ * Ring header, at the start of the mapping
+ */
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    volatile uint32_t flags;                /* IORING_SQ_NEED_WAKEUP */
+    uint32_t sq_offset;                     /* Byte offset of the SQE array */
+    uint32_t cq_offset;                     /* Byte offset of the CQE array */
+} ioring_shared_t;
+
+/**
+ * Submission queue entry
+ */
+typedef struct {
+    uint8_t opcode;                         /* IORING_OP_* */
+    uint8_t flags;                          /* Reserved, 0 */
+    uint16_t reserved;
+    int32_t fd;
+    uint32_t addr;                          /* Buffer */
+    uint32_t len;                           /* Buffer length */
+    uint32_t user_data;                     /* Copied into the completion */
+    uint32_t pad[3];
+} ioring_sqe_t;
+
+/**
+ * Completion queue entry
+ */
+typedef struct {
+    uint32_t user_data;                     /* From the SQE */
+    int32_t res;                            /* System call result */
+} ioring_cqe_t;
+
+struct process;
+
+/**
+ * Kernel side of a ring
+ */
+typedef struct ioring {
+    ioring_shared_t* shared;                /* User mapping (valid in the owner's address space) */
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+    uint32_t sq_head;                       /* Kernel copy: next SQE to run */
+    uint32_t cq_tail;                       /* Kernel copy: next CQE to fill */
+    thread_t* sq_thread;                    /* Polling thread (SQPOLL), NULL otherwise */
+    volatile int stopping;                  /* Owner is exiting: the polling thread must quit */
+    wait_queue_t sq_wait;                   /* Polling thread sleeping on an empty queue */
+    wait_queue_t cq_wait;                   /* Callers waiting for completions */
+} ioring_t;
+
+/**
+ * Create the calling process's ring (SYSCALL_IORING_SETUP)
+ *
+ * @param entries Submission queue size, rounded up to a power of two (1..IORING_MAX_ENTRIES)
+ * @param flags IORING_SETUP_* flags
+ * @return User address of the ring, or -1 on failure
+ */
+int32_t ioring_setup(uint32_t entries, uint32_t flags);
+
+/**
+ * Run submissions and optionally wait for completions (SYSCALL_IORING_ENTER)
+ *
+ * @param to_submit Most SQEs to run (ignored for SQPOLL rings)
+ * @param min_complete Completions to wait for with IORING_ENTER_GETEVENTS
+ * @param flags IORING_ENTER_* flags
+ * @return Number of SQEs run, or -1 if the process has no ring
+ */
+int32_t ioring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+/**
+ * Tell a process's polling thread to finish (the process is exiting)
+ *
+ * @param proc Process owning the ring
+ */
+void ioring_stop(struct process* proc);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _KERNEL_IRQSTAT_H
+#define _KERNEL_IRQSTAT_H
+
+#include <stdint.h>
+
+/**
+ * Per-IRQ Statistics
+ *
+ * irq_handler() counts every interrupt of the 16 PIC lines and, with a TSC,
+ * the cycles from entry to EOI (the registered handler plus the timer's
+ * scheduler and profiler work on IRQ 0).
+ *
+ * IRQ 7 and IRQ 15 are also what the PICs raise for a request that went away
+ * before it was acknowledged. Such an interrupt has no bit in the In-Service
+ * Register; it is counted as spurious and not passed to the handler.
+ */
+
+#define IRQ_LINES               16
+
+typedef struct {
+    uint64_t count;                     /* Interrupts handled */
+    uint64_t spurious;                  /* Spurious IRQ 7 / 15 (not in count) */
+    uint64_t total_cycles;              /* Cycles in the handler, summed */
+    uint32_t max_cycles;                /* Slowest single interrupt */
+} irq_stats_t;
+
+/**
+ * Copy the statistics of one IRQ line
+ *
+ * @param irq IRQ line (0..15)
+ * @param out Destination
+ * @return 0 on success, -1 if irq is out of range
+ */
+int irq_get_stats(int irq, irq_stats_t* out);
+
+/**
+ * Clear the statistics of all lines
+ */
+void irq_reset_stats(void);
+
+/**
+ * Print a table of the lines that saw interrupts
+ */
+void irq_print_stats(void);
+
+#endif
@@ -1,6 +1,72 @@
 #ifndef _KERNEL_KEYBOARD_H
 #define _KERNEL_KEYBOARD_H
 
+#include <stdint.h>
+#include <stddef.h>
+
+/* Key events buffered between the keyboard IRQ and its readers (power of two) */
+#define KEYBOARD_BUFFER_SIZE 256
+
+/* keyboard_read() modes */
+#define KEYBOARD_MODE_RAW           0   /* Return whatever has been typed */
+#define KEYBOARD_MODE_CANONICAL     1   /* Return whole lines; backspace edits the pending line */
+
+/*
+ * Key codes: the Scancode Set 1 make code, with KEY_EXTENDED set for keys
+ * sent behind an 0xE0 prefix. Keys that type a character don't need a name.
+ */
+#define KEY_EXTENDED        0x80
+
+#define KEY_ESC             0x01
+#define KEY_BACKSPACE       0x0E
+#define KEY_TAB             0x0F
+#define KEY_ENTER           0x1C
+#define KEY_LCTRL           0x1D
+#define KEY_LSHIFT          0x2A
+#define KEY_RSHIFT          0x36
+#define KEY_LALT            0x38
+#define KEY_CAPSLOCK        0x3A
+#define KEY_F1              0x3B    /* F1-F10 are consecutive */
+#define KEY_F10             0x44
+#define KEY_NUMLOCK         0x45
+#define KEY_SCROLLLOCK      0x46
+#define KEY_F11             0x57
+#define KEY_F12             0x58
+#define KEY_KP_ENTER        (KEY_EXTENDED | 0x1C)
+#define KEY_RCTRL           (KEY_EXTENDED | 0x1D)
+#define KEY_KP_SLASH        (KEY_EXTENDED | 0x35)
+#define KEY_RALT            (KEY_EXTENDED | 0x38)
+#define KEY_PAUSE           (KEY_EXTENDED | 0x45)  /* Sent as E1 1D 45 E1 9D C5, press and release at once */
+#define KEY_HOME            (KEY_EXTENDED | 0x47)
+#define KEY_UP              (KEY_EXTENDED | 0x48)
+#define KEY_PAGEUP          (KEY_EXTENDED | 0x49)
+#define KEY_LEFT            (KEY_EXTENDED | 0x4B)
+#define KEY_RIGHT           (KEY_EXTENDED | 0x4D)
+#define KEY_END             (KEY_EXTENDED | 0x4F)
+#define KEY_DOWN            (KEY_EXTENDED | 0x50)
+#define KEY_PAGEDOWN        (KEY_EXTENDED | 0x51)
+#define KEY_INSERT          (KEY_EXTENDED | 0x52)
+#define KEY_DELETE          (KEY_EXTENDED | 0x53)
+
+/* key_event_t.modifiers: held modifiers and active locks */
+#define KEY_MOD_SHIFT       0x01
+#define KEY_MOD_CTRL        0x02
+#define KEY_MOD_ALT         0x04
+#define KEY_MOD_CAPS        0x08    /* Caps Lock on */
+#define KEY_MOD_NUM         0x10    /* Num Lock on */
+
+/* key_event_t.flags */
+#define KEY_EVENT_RELEASED  0x01
+#define KEY_EVENT_REPEAT    0x02    /* Typematic repeat of a key that is still down */
+
+/* A key press or release */
+typedef struct {
+    uint8_t keycode;                /* KEY_* */
+    uint8_t ascii;                  /* Character the key types with these modifiers, 0 if none */
+    uint8_t modifiers;              /* KEY_MOD_*, including the key's own change */
+    uint8_t flags;                  /* KEY_EVENT_* */
+} key_event_t;
+
 /**
  * Initializes the PS/2 keyboard driver
  *
@@ -13,10 +79,64 @@ void keyboard_initialize(void);
  * Blocking keyboard character input
  *
  * Waits for and returns the next character from the keyboard input buffer. This function blocks (using HLT instruction)
- * until a character is available. Used by getchar() to implement blocking input for the shell.
+ * until a character is available; events that type nothing (releases, modifiers, arrows) are skipped. Used by
+ * getchar() to implement blocking input for the shell.
  *
  * @return ASCII character code of the key pressed
  */
 int keyboard_callback_getchar(void);
 
+/**
+ * Blocking multi-byte keyboard input
+ *
+ * Waits until input is available, then copies everything available in one pass. In raw mode that is every queued
+ * character; in canonical mode it is one complete line including its '\n'. Used by SYSCALL_READ.
+ *
+ * @param buf Destination buffer
+ * @param count Buffer size in bytes
+ * @return Number of bytes copied (0 only if count is 0)
+ */
+size_t keyboard_read(char* buf, size_t count);
+
+/**
+ * Blocking key event input
+ *
+ * Waits for and returns the next event from the input ring: presses and releases of every key, with the modifiers
+ * at the time. In canonical mode only the presses that type characters are queued.
+ *
+ * @param event Filled with the event
+ */
+void keyboard_read_event(key_event_t* event);
+
+/**
+ * Feed one scancode byte to the decoder
+ *
+ * The IRQ handler calls this for every byte from the controller; it may also be called with IRQ 1 unable to run on
+ * this CPU (e.g. to inject input). Prefix bytes only advance the decoder; complete keys queue an event.
+ *
+ * @param scancode Scancode Set 1 byte
+ */
+void keyboard_process_scancode(uint8_t scancode);
+
+/**
+ * Select how keyboard_read() delimits input
+ *
+ * @param mode KEYBOARD_MODE_RAW (default) or KEYBOARD_MODE_CANONICAL
+ */
+void keyboard_set_mode(int mode);
+
+/**
+ * Number of key events not yet read
+ *
+ * @return Queued events
+ */
+uint32_t keyboard_pending(void);
+
+/**
+ * Number of key events dropped because the input buffer was full
+ *
+ * @return Dropped events since boot
+ */
+uint32_t keyboard_overflows(void);
+
 #endif
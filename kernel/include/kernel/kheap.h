@@ -3,12 +3,50 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 /**
  * Simple Bitmap-Based Heap Allocator
  * Based on: https://wiki.osdev.org/User:Pancakes/BitmapHeapImplementation
+ *
+ * Requests up to 2 KiB are served from power-of-two size-class slabs
+ * (16 B .. 2 KiB) carved out of heap blocks. Each CPU caches freed objects
+ * of every class in magazines, so most kmalloc()/kfree() pairs take no lock.
+ *
+ * The heap has its own virtual range, mapped on demand with frames from the
+ * frame allocator, so it grows with installed RAM (up to 256 MiB).
  */
 
+/* Virtual range of the kernel heap (blocks + slab descriptors) */
+#define KHEAP_VIRT_START    0xD0000000
+#define KHEAP_VIRT_END      0xE0400000
+
+#define KHEAP_SLAB_CLASSES  8           /* Size classes, 16 B .. 2 KiB */
+
+/* Heap occupancy (kheap_get_info()) */
+typedef struct {
+    uint32_t blocks;                    /* 4 KiB blocks mapped */
+    uint32_t blocks_used;
+    uint32_t blocks_max;
+    struct {
+        uint32_t obj_size;
+        uint32_t slabs;                 /* Blocks carved into objects of this size */
+        uint32_t objs_in_use;           /* Handed out, including those cached in magazines */
+    } slab[KHEAP_SLAB_CLASSES];
+} kheap_info_t;
+
+#define KHEAP_SITES         128         /* Call sites the allocation histogram tells apart */
+#define KHEAP_SITES_LIVE    4096        /* Live allocations it can attribute a kfree() to */
+
+/* Allocations made from one call site while the histogram was on (kheap_get_sites()) */
+typedef struct {
+    uint32_t pc;                        /* Return address into the caller; 0 collects sites that didn't fit */
+    uint32_t allocs;
+    uint32_t frees;                     /* Of the allocations made here */
+    uint32_t live_bytes;                /* Bytes requested here and not freed yet */
+    uint32_t untracked;                 /* Allocations left out of frees and live_bytes (too many live) */
+} kheap_site_t;
+
 /**
  * Initialize the kernel heap allocator
  *
@@ -19,21 +57,99 @@ void kheap_init(void);
 /**
  * Allocate memory from the kernel heap
  *
+ * Small requests are rounded up to the next size class and are aligned to
+ * it; larger ones take whole 4 KiB blocks.
+ *
  * @param size Number of bytes to allocate
  * @return Pointer to allocated memory, or NULL on failure
  */
 void* kmalloc(size_t size);
 
+/**
+ * Allocate memory aligned to a power of two
+ *
+ * @param size Number of bytes to allocate
+ * @param align Alignment in bytes (power of two)
+ * @return Aligned pointer (free with kfree()), or NULL on failure
+ */
+void* kmalloc_aligned(size_t size, size_t align);
+
+/**
+ * Allocate zero-filled memory for an array
+ *
+ * @param count Number of elements
+ * @param size Size of each element
+ * @return Pointer to zeroed memory, or NULL on failure or overflow
+ */
+void* kcalloc(size_t count, size_t size);
+
+/**
+ * Resize an allocation, growing or shrinking it in place when possible
+ *
+ * krealloc(NULL, size) is kmalloc(size); krealloc(ptr, 0) frees ptr. If the
+ * allocation has to move, the contents are copied; alignment beyond 4 KiB
+ * from kmalloc_aligned() is not kept in that case.
+ *
+ * @param ptr Pointer from kmalloc(), kmalloc_aligned(), kcalloc() or krealloc()
+ * @param size New size in bytes
+ * @return New pointer, or NULL on failure (ptr is then left untouched)
+ */
+void* krealloc(void* ptr, size_t size);
+
 /**
  * Free previously allocated memory
  *
- * @param ptr Pointer to memory to free (from kmalloc())
+ * @param ptr Pointer to memory to free (from any of the allocators above)
  */
 void kfree(void* ptr);
 
 /**
- * Print heap statistics (for debugging)
+ * Print heap statistics (for debugging), including per-size-class slab usage
+ * and per-CPU magazine hit rates
  */
 void kheap_stats(void);
 
+/**
+ * Get the heap occupancy
+ *
+ * Takes no lock, so it also works in a crash with the heap lock held;
+ * while other CPUs allocate it is a snapshot, not exact.
+ *
+ * @param info Filled with the counters
+ */
+void kheap_get_info(kheap_info_t* info);
+
+/**
+ * Longest run of free 4 KiB blocks in the mapped heap
+ *
+ * Larger than a slab class, a request needs that many contiguous blocks;
+ * below it the heap grows even with free blocks left. Scans the heap bitmap
+ * with the heap lock held.
+ *
+ * @return Blocks in the longest run
+ */
+uint32_t kheap_largest_free(void);
+
+/**
+ * Turn the per-call-site allocation histogram on or off
+ *
+ * While on, every allocation is counted against the return address of its
+ * kmalloc()/kmalloc_aligned()/kcalloc()/krealloc() call, and kfree() finds
+ * which site the memory came from, so live_bytes growing at one site points
+ * at a leak. Off, the entry points only test a flag. Turning it on starts
+ * from empty tables.
+ *
+ * @param enable true to start recording, false to stop (the counts are kept)
+ */
+void kheap_sites_enable(bool enable);
+
+/**
+ * Get the histogram, most live bytes first
+ *
+ * @param sites Filled with up to max sites
+ * @param max Capacity of sites (KHEAP_SITES for all of them)
+ * @return Number of sites filled in
+ */
+size_t kheap_get_sites(kheap_site_t* sites, size_t max);
+
 #endif /* KERNEL_KHEAP_H */
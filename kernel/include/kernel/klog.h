@@ -0,0 +1,112 @@
+#ifndef _KERNEL_KLOG_H
+#define _KERNEL_KLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Kernel Log
+ *
+ * klog() appends a message to an in-memory ring, and the console (terminal
+ * and COM1) shows it from there. The ring keeps the last KLOG_BUFFER_SIZE
+ * bytes of messages for dmesg, console or not.
+ *
+ * Until klog_init() the console shows each message right away, like
+ * printf(). After it klog() only appends; the idle thread renders what has
+ * collected, and klog_flush() does so on the spot. Errors always render at
+ * once, and so does everything else once the ring is about to overwrite
+ * warnings or errors the console hasn't shown. Other messages that get
+ * overwritten before being shown are counted as dropped.
+ */
+
+#define KLOG_ERR                0       /* Something failed */
+#define KLOG_WARN               1       /* Something is off, the kernel carries on */
+#define KLOG_INFO               2       /* Progress ("[  OK  ] ... initialized") */
+#define KLOG_DEBUG              3       /* Details, on the console only if asked for */
+
+#define KLOG_BUFFER_SIZE        16384   /* Ring size in bytes (power of two) */
+#define KLOG_LINE_MAX           256     /* Longest message; longer ones are cut */
+
+/* A message read back from the ring */
+typedef struct {
+    uint32_t seq;                       /* Number of the message since boot */
+    uint64_t time_ns;                   /* ktime_ns() when it was logged */
+    int level;
+    size_t len;                         /* Text length (may exceed what was copied) */
+} klog_entry_t;
+
+/* Log statistics */
+typedef struct {
+    uint32_t records;                   /* Messages in the ring */
+    uint32_t next_seq;                  /* Number the next message gets */
+    uint32_t pending;                   /* Messages the console hasn't shown yet */
+    uint32_t dropped;                   /* Messages overwritten before the console showed them */
+    int console_level;
+    bool deferred;                      /* klog_init() has run */
+} klog_stats_t;
+
+/**
+ * Defer console output from now on
+ *
+ * klog() then costs a copy into the ring; rendering happens when the CPU is
+ * idle, on klog_flush(), or right away for errors.
+ */
+void klog_init(void);
+
+/**
+ * Log a message
+ *
+ * Usable anywhere, IRQ handlers included. A message normally ends with '\n'.
+ *
+ * @param level KLOG_ERR .. KLOG_DEBUG
+ * @param format Format string (see vformat())
+ * @return Length of the formatted message, or -1 on an invalid level
+ */
+int klog(int level, const char* format, ...);
+
+/**
+ * Show every message the console hasn't shown yet
+ *
+ * If another context on this CPU is rendering, it shows them instead.
+ */
+void klog_flush(void);
+
+/**
+ * Show the next pending message (idle thread)
+ *
+ * @return true if there was one
+ */
+bool klog_drain_idle(void);
+
+/**
+ * Set the least important level the console shows (the ring keeps all)
+ *
+ * @param level KLOG_ERR .. KLOG_DEBUG (default KLOG_INFO)
+ */
+void klog_set_console_level(int level);
+
+/**
+ * Read a message back from the ring
+ *
+ * Start with *seq = 0 to get the oldest message still in the ring.
+ *
+ * @param seq Number of the message wanted; set past the one returned
+ * @param entry Filled with the message's details
+ * @param text Receives the text, NUL-terminated (cut to size - 1 bytes)
+ * @param size Size of text
+ * @return true if a message was read, false if there is none at or after *seq
+ */
+bool klog_read(uint32_t* seq, klog_entry_t* entry, char* text, size_t size);
+
+/**
+ * Name of a level ("err", "warn", "info", "debug")
+ */
+const char* klog_level_name(int level);
+
+/**
+ * Get log statistics
+ */
+void klog_get_stats(klog_stats_t* stats);
+
+#endif
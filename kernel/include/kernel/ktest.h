@@ -0,0 +1,100 @@
+#ifndef _KERNEL_KTEST_H
+#define _KERNEL_KTEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/multiboot.h>
+
+/**
+ * In-Kernel Tests
+ *
+ *   KTEST(kheap, realloc_grows) {
+ *       char* p = kmalloc(16);
+ *       KTEST_EXPECT(p != NULL);
+ *       ...
+ *       return 0;
+ *   }
+ *
+ * puts the test into the .ktest linker section; the kernel finds every test
+ * there between __ktest_start and __ktest_end, no list to keep up to date.
+ * Tests live in kernel/ktest/ and are only built with KTEST=1.
+ *
+ * The multiboot command line picks what runs once the kernel has booted:
+ *
+ *   ktest=all                  every test
+ *   ktest=kheap,klog_read      whole suites and single tests (suite_name)
+ *   ktest=list                 print the names only
+ *
+ * Each test reports to COM1, then QEMU exits through isa-debug-exit
+ * (0 if all passed, 1 otherwise):
+ *
+ *   KTEST_BEGIN kheap_realloc_grows
+ *   KTEST_PASS kheap_realloc_grows 12 us
+ *   KTEST_DONE passed=1 failed=0
+ *
+ * A failed expectation prints "KTEST_FAIL name file:line: condition". A test
+ * that crashes the kernel prints no result; tests/run_tests.py then starts a
+ * new boot with the tests that come after it.
+ */
+
+/* One registered test */
+typedef struct {
+    const char* suite;
+    const char* name;
+    int (*func)(void);                  /* 0 if it passed */
+} ktest_t;
+
+/**
+ * Define and register a test
+ *
+ * @param suite Suite the test belongs to (the first part of its full name)
+ * @param name Name within the suite
+ */
+#define KTEST(suite, name)                                                                          \
+    static int ktest_##suite##_##name(void);                                                        \
+    static const ktest_t ktest_entry_##suite##_##name                                               \
+        __attribute__((used, section(".ktest"), aligned(4))) = { #suite, #name, ktest_##suite##_##name }; \
+    static int ktest_##suite##_##name(void)
+
+/**
+ * Fail the running test unless a condition holds
+ */
+#define KTEST_EXPECT(condition)                                         \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            ktest_fail(__FILE__, __LINE__, #condition);                 \
+            return -1;                                                  \
+        }                                                               \
+    } while (0)
+
+/**
+ * Run the tests the "ktest=" option of the command line selects
+ *
+ * Returns only if there is no such option; otherwise exits QEMU (or halts)
+ * after the last test.
+ *
+ * @param mbi Multiboot information (for the command line)
+ * @return -1 if the command line has no "ktest=" option
+ */
+int ktest_main(multiboot_info_t* mbi);
+
+/**
+ * Run the tests a selection names
+ *
+ * @param selection "all", or comma-separated suites and suite_name tests
+ * @return Number of tests that failed
+ */
+uint32_t ktest_run(const char* selection);
+
+/**
+ * Number of tests built into the kernel
+ */
+size_t ktest_count(void);
+
+/**
+ * Report a failed expectation (use KTEST_EXPECT())
+ */
+void ktest_fail(const char* file, int line, const char* condition);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef _KERNEL_MODULE_H
+#define _KERNEL_MODULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/multiboot.h>
+
+/**
+ * Boot Modules
+ *
+ * Files loaded next to the kernel by the bootloader (multiboot 'module'
+ * lines). Each one is mapped read-only into the module window of the kernel
+ * address space, so its contents are reachable wherever GRUB put them in
+ * physical memory. The frames stay reserved for the lifetime of the system,
+ * which lets user address spaces map them directly.
+ *
+ * A module's name is the last path component of the first word of its
+ * command line: "module /boot/hello.elf arg" is found as "hello.elf".
+ */
+
+#define MODULE_MAX              16
+#define MODULE_NAME_MAX         32
+#define MODULE_VIRT_START       0xE0400000      /* Right above the kernel heap */
+#define MODULE_VIRT_END         0xF0000000
+
+typedef struct {
+    char name[MODULE_NAME_MAX];
+    uint32_t phys;              /* Physical address of the first byte */
+    const void* data;           /* Contents, mapped in the module window */
+    size_t size;
+} module_t;
+
+/**
+ * Map the multiboot modules and record them (after paging_init())
+ *
+ * @param mbi Multiboot information structure
+ */
+void module_init(multiboot_info_t* mbi);
+
+/**
+ * Register memory that was not loaded as a multiboot module
+ *
+ * The frames must stay allocated for as long as the module is in use.
+ *
+ * @param name Module name
+ * @param phys Physical address of the contents
+ * @param size Size in bytes
+ * @return Module, or NULL if the table or the module window is full
+ */
+const module_t* module_register(const char* name, uint32_t phys, size_t size);
+
+/**
+ * Find a module by name
+ *
+ * @param name Module name
+ * @return Module, or NULL if there is none
+ */
+const module_t* module_find(const char* name);
+
+/**
+ * Number of registered modules
+ */
+uint32_t module_count(void);
+
+/**
+ * Get a module by index
+ *
+ * @param index 0 .. module_count() - 1
+ * @return Module, or NULL if out of range
+ */
+const module_t* module_get(uint32_t index);
+
+#endif
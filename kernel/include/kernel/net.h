@@ -0,0 +1,153 @@
+#ifndef _KERNEL_NET_H
+#define _KERNEL_NET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/spinlock.h>
+
+/**
+ * Network Devices and Packet Buffers
+ *
+ * Packets live in netbufs: fixed NETBUF_SIZE buffers carved out of frames
+ * the pool takes at boot, each with its physical address, so drivers hand
+ * them to the NIC as they are and nothing is copied on the way:
+ *
+ *   receive:  driver posts netbuf_alloc() buffers to the NIC
+ *             → NIC writes a frame into one → driver sets data/len
+ *             → net_receive() → the device's rx handler owns it → netbuf_free()
+ *   transmit: netbuf_alloc() → build the frame at data (NETBUF_HEADROOM bytes
+ *             in front are free for the driver's own header)
+ *             → net_transmit() → driver queues netbuf_phys() → freed when sent
+ *
+ * netbuf_alloc() and netbuf_free() take a spinlock and nothing else, so
+ * drivers call them from IRQs and tasklets. The pool doesn't grow; when it
+ * is empty, receive rings stop being refilled and packets are dropped by
+ * the NIC rather than queued without bound.
+ */
+
+#define NETBUF_SIZE             2048    /* Two per frame; holds an Ethernet frame plus a driver header */
+#define NETBUF_HEADROOM         64      /* Free in front of data in a new netbuf */
+#define NETBUF_POOL_SIZE        512     /* Buffers in the pool (1 MiB) */
+
+#define NET_ETH_ALEN            6
+#define NET_ETH_HLEN            14
+#define NET_ETH_MTU             1500
+
+typedef struct net_device net_device_t;
+
+typedef struct netbuf {
+    uint8_t* head;                      /* NETBUF_SIZE bytes of buffer */
+    uint32_t phys;                      /* Physical address of head */
+    uint8_t* data;                      /* First byte of the packet */
+    uint32_t len;                       /* Bytes at data */
+    net_device_t* dev;                  /* Device it was received on */
+    struct netbuf* next;                /* Free list, or the owner's queue */
+} netbuf_t;
+
+typedef struct {
+    /**
+     * Queue a frame; the driver owns nb from here on, also on failure
+     *
+     * @return 0 if queued, -1 if dropped
+     */
+    int (*xmit)(net_device_t* dev, netbuf_t* nb);
+} net_ops_t;
+
+typedef void (*net_rx_fn)(net_device_t* dev, netbuf_t* nb);
+
+typedef struct {
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t rx_dropped;                /* No rx handler */
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t tx_dropped;                /* Too long, or the driver's queue was full */
+} net_stats_t;
+
+struct net_device {
+    char name[8];                       /* "eth0", chosen by net_register() */
+    uint8_t mac[NET_ETH_ALEN];
+    uint16_t mtu;
+    bool link_up;
+    const net_ops_t* ops;
+    void* priv;                         /* Driver data */
+    net_rx_fn rx;                       /* Receiver of incoming frames, NULL drops them */
+    spinlock_t lock;                    /* stats */
+    net_stats_t stats;
+    net_device_t* next;
+};
+
+/**
+ * Fill the packet buffer pool (initcall, after kheap_init())
+ *
+ * @return 0 on success, -1 if no buffer could be allocated
+ */
+int net_init(void);
+
+/**
+ * Take a packet buffer
+ *
+ * @return Buffer with len 0 and NETBUF_HEADROOM bytes in front of data, or NULL if the pool is empty
+ */
+netbuf_t* netbuf_alloc(void);
+
+/**
+ * Give a packet buffer back to the pool
+ */
+void netbuf_free(netbuf_t* nb);
+
+/**
+ * Packet buffers left in the pool
+ */
+uint32_t netbuf_available(void);
+
+/**
+ * Physical address of a buffer's data
+ */
+static inline uint32_t netbuf_phys(const netbuf_t* nb) {
+    return nb->phys + (uint32_t) (nb->data - nb->head);
+}
+
+/**
+ * Add a network device, named eth0, eth1, ... in registration order
+ *
+ * @return 0 on success, -1 if dev has no ops
+ */
+int net_register(net_device_t* dev);
+
+/**
+ * Find a device by name
+ */
+net_device_t* net_find(const char* name);
+
+/**
+ * Get the index-th registered device, NULL past the last
+ */
+net_device_t* net_get(uint32_t index);
+
+/**
+ * Set the function incoming frames go to
+ *
+ * It runs in the driver's tasklet, owns the buffer and must netbuf_free() it eventually.
+ */
+void net_set_rx_handler(net_device_t* dev, net_rx_fn rx);
+
+/**
+ * Send a frame (nb->data points at the Ethernet header); nb is consumed
+ *
+ * @return 0 if queued, -1 if dropped
+ */
+int net_transmit(net_device_t* dev, netbuf_t* nb);
+
+/**
+ * Hand a received frame to the device's rx handler (for drivers); nb is consumed
+ */
+void net_receive(net_device_t* dev, netbuf_t* nb);
+
+/**
+ * Copy a device's counters
+ */
+void net_get_stats(net_device_t* dev, net_stats_t* stats);
+
+#endif
@@ -5,25 +5,63 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include <kernel/multiboot.h>
+
 /**
  * Memory layout constants
  * 
- * We support up to 128 MiB of physical memory, divided into 4 KiB frames.
+ * Physical memory is sized at boot from the multiboot memory map (up to 4 GiB),
+ * divided into 4 KiB frames.
  * The kernel is identity-mapped and reserves the first 8 MiB for its use.
  */
 #define PAGE_SIZE           4096                                /* 4 KiB pages */
 #define FRAME_SIZE          PAGE_SIZE
-#define NUM_FRAMES          (128 * 1024 * 1024 / FRAME_SIZE)    /* 32768 frames for 128 MiB */
+#define LARGE_PAGE_SIZE     (4 * 1024 * 1024)                   /* 4 MiB PSE pages */
+#define DEFAULT_PHYS_MEMORY (128ULL * 1024 * 1024)              /* Used when multiboot reports no memory info */
+#define MAX_PHYS_MEMORY     (4ULL * 1024 * 1024 * 1024)         /* 32-bit physical address space (no PAE) */
 #define KMEM_MAX            (8 * 1024 * 1024)                   /* 8 MiB reserved for kernel */
+#define FRAME_MAX_ORDER     10                                  /* Largest buddy block: 2^10 frames = 4 MiB */
+#define FRAME_ZERO_POOL     64                                  /* Frames the idle thread keeps zeroed (256 KiB) */
+
+/**
+ * Address space split
+ *
+ * [USER_SPACE_START, USER_SPACE_END) is private to each address space. Every
+ * other page directory entry is the kernel's and is shared by all of them.
+ */
+#define USER_SPACE_START    0x40000000
+#define USER_SPACE_END      0xC0000000
+
+/* paging_map_physical() window: ACPI tables and device registers, never unmapped */
+#define PHYS_MAP_VIRT_START 0xF0000000
+#define PHYS_MAP_VIRT_END   0xF1000000
 
 /**
  * Page Directory and Page Table entry flags
  */
 #define PDE_PRESENT         0x1     /* Page is present in memory */
 #define PDE_WRITABLE        0x2     /* Page is writable */
+#define PDE_USER            0x4     /* Page is accessible from ring 3 */
+#define PDE_PAGE_SIZE       0x80    /* PDE maps a 4 MiB page directly (requires CR4.PSE) */
 
 #define PTE_PRESENT         PDE_PRESENT
 #define PTE_WRITABLE        PDE_WRITABLE
+#define PTE_USER            PDE_USER
+#define PTE_WRITE_THROUGH   0x8     /* Write-through caching */
+#define PTE_CACHE_DISABLE   0x10    /* Uncached: device registers (MMIO) */
+#define PTE_GLOBAL          0x100   /* Kept in the TLB across CR3 reloads (requires CR4.PGE) */
+#define PTE_COW             0x200   /* Available bit: read-only because shared, copy on write */
+
+/**
+ * Control register 0 bits
+ */
+#define CR0_WP              0x10000 /* Write Protect: ring 0 writes fault on read-only pages */
+
+/**
+ * Control register 4 bits
+ */
+#define CR4_PSE             0x10    /* Page Size Extension: allow 4 MiB pages */
+#define CR4_PGE             0x80    /* Page Global Enable: honour PTE_GLOBAL */
 
 /**
  * Page Directory Entry (PDE)
@@ -44,6 +82,7 @@
  * Bit 8    (G)   - Global (Ignored for PDEs)
  * Bits 9-11      - Available for OS use
  * Bits 12-31     - Page Table 4KB-aligned physical address
+ *                  (PS = 1: bits 22-31 hold the 4MB page's physical address)
  */
 typedef uint32_t pde_t;
 
@@ -85,8 +124,157 @@ typedef struct {
 
 /**
  * Initialize the paging system and switch to paging mode
+ *
+ * @param mbi Multiboot information (memory map, modules); may be NULL
+ */
+void paging_init(multiboot_info_t* mbi);
+
+/**
+ * Map a virtual page to a physical frame in the current address space
+ *
+ * Allocates the page table if needed and invalidates the page's TLB entry,
+ * on every CPU if it replaces a mapping. Must be called after paging_init(). The top 4 MiB (page table window) and
+ * the 4 MiB pages of the kernel identity map can't be remapped.
+ *
+ * @param virt_addr Virtual address (rounded down to a page)
+ * @param phys_addr Physical address (rounded down to a frame)
+ * @param flags PTE_WRITABLE, PTE_USER, ... (PTE_PRESENT is implied)
+ * @return 0 on success, -1 on failure
+ */
+int paging_map(uint32_t virt_addr, uint32_t phys_addr, uint32_t flags);
+
+/**
+ * Unmap a virtual page and invalidate its TLB entry
+ *
+ * The other CPUs that may have cached the page flush it too before this
+ * returns, so its frame can be freed right away.
+ *
+ * @param virt_addr Virtual address of the page
+ * @return Physical address it was mapped to, or 0 if it wasn't mapped
+ */
+uint32_t paging_unmap(uint32_t virt_addr);
+
+/**
+ * Unmap the pages of a range and release their frames
+ *
+ * Like paging_unmap() on each page, but the other CPUs flush once per
+ * batch of pages instead of once per page. Pages that aren't mapped are
+ * skipped.
+ *
+ * @param virt_addr Start of the range
+ * @param len Length in bytes
+ * @param release Called with each frame once no TLB maps it (frame_free, frame_release, ...)
+ */
+void paging_unmap_range(uint32_t virt_addr, size_t len, void (*release)(uint32_t frame));
+
+/**
+ * Translate a virtual address of the current address space
+ *
+ * Kernel mappings look the same in every address space, so drivers use this
+ * to find the physical pages behind a kernel buffer (DMA).
+ *
+ * @param virt_addr Virtual address (any alignment)
+ * @return Physical address it is mapped to, or 0 if its page isn't present
  */
-void paging_init(void);
+uint32_t paging_virt_to_phys(uint32_t virt_addr);
+
+/**
+ * Map a physical range into the kernel's address space for good
+ *
+ * Used for firmware tables and memory-mapped device registers outside RAM
+ * the kernel owns. Ranges inside the kernel identity map are returned as is
+ * unless they must be uncached. The mapping is never removed.
+ *
+ * @param phys_addr Physical address (any alignment)
+ * @param len Length in bytes
+ * @param flags PTE_WRITABLE, PTE_CACHE_DISABLE, ...
+ * @return Virtual address of phys_addr, or NULL if the window is full
+ */
+void* paging_map_physical(uint32_t phys_addr, size_t len, uint32_t flags);
+
+/**
+ * Invalidate the TLB entries covering a virtual range
+ *
+ * Uses invlpg per page for small ranges and a full flush (global pages
+ * included) for large ones. Other CPUs that may hold entries of the range
+ * (all of them for kernel addresses, those in the same address space for
+ * user ones) get a TLB shootdown IPI and have flushed when this returns.
+ *
+ * @param virt_addr Start of the range
+ * @param len Length in bytes
+ */
+void paging_flush_range(uint32_t virt_addr, size_t len);
+
+/**
+ * Serve a pending TLB shootdown aimed at the running CPU
+ *
+ * Called by the shootdown IPI, and by spin loops: a CPU spinning with
+ * interrupts off could otherwise keep the sender, which may hold the lock
+ * it waits for, waiting forever.
+ */
+void tlb_shootdown_poll(void);
+
+/**
+ * Take part in TLB shootdowns on an application processor
+ *
+ * Called by the AP once it is marked online; flushes its whole TLB.
+ */
+void paging_init_cpu(void);
+
+/**
+ * Physical address of the kernel's page directory (the boot address space)
+ */
+uint32_t paging_kernel_directory(void);
+
+/**
+ * Physical address of the page directory in CR3
+ */
+uint32_t paging_current_directory(void);
+
+/**
+ * Load a page directory into CR3
+ *
+ * Global (kernel) TLB entries survive the switch; user ones are flushed. The
+ * directory is also recorded for this CPU, so TLB shootdowns of its user
+ * range reach it.
+ *
+ * @param page_dir Physical address of the page directory
+ */
+void paging_switch_directory(uint32_t page_dir);
+
+/**
+ * Create an address space with an empty user range
+ *
+ * The new page directory shares every kernel page table with the kernel's
+ * directory, so kernel mappings look the same in all address spaces.
+ * Before the first one is made, page tables covering the whole kernel heap
+ * are allocated so no kernel stack can be missing from a directory.
+ *
+ * @return Physical address of the page directory, or 0 if out of memory
+ */
+uint32_t paging_create_directory(void);
+
+/**
+ * Free an address space: its user pages, user page tables and directory
+ *
+ * Frames mapped in the user range are returned to the frame allocator. If the
+ * directory is loaded, the kernel's is loaded first.
+ *
+ * @param page_dir Physical address returned by paging_create_directory()
+ */
+void paging_destroy_directory(uint32_t page_dir);
+
+/**
+ * Copy the current address space, sharing its user pages copy-on-write
+ *
+ * Only page tables are copied. Every present user page is mapped read-only
+ * with PTE_COW in both directories and gains a frame reference; the first
+ * write on either side copies the page (or, for the last sharer, makes it
+ * writable again).
+ *
+ * @return Physical address of the new page directory, or 0 if out of memory
+ */
+uint32_t paging_clone_directory(void);
 
 /**
  * Allocate a physical frame
@@ -95,6 +283,32 @@ void paging_init(void);
  */
 uint32_t frame_alloc(void);
 
+/**
+ * Allocate a physical frame filled with zeros
+ *
+ * Takes a frame the idle thread zeroed ahead of time in O(1); only when that
+ * pool is empty is a frame zeroed on the spot. Free it with frame_free() or
+ * frame_release() like any other frame.
+ *
+ * @return Physical address of the zeroed frame, or 0 if none available
+ */
+uint32_t frame_alloc_zeroed(void);
+
+/**
+ * Zero one more frame for frame_alloc_zeroed() (idle thread)
+ *
+ * Uses non-temporal stores when the CPU has SSE2, so zeroing in the
+ * background doesn't push the working set out of the cache.
+ *
+ * @return true if a frame was added, false if the pool is full or memory is out
+ */
+bool frame_zero_idle(void);
+
+/**
+ * Number of zeroed frames waiting in the pool
+ */
+uint32_t frame_zeroed_count(void);
+
 /**
  * Free a physical frame
  * 
@@ -102,4 +316,95 @@ uint32_t frame_alloc(void);
  */
 void frame_free(uint32_t frame_addr);
 
+/**
+ * Add a reference to an allocated frame (shared mapping)
+ *
+ * A freshly allocated frame has one reference.
+ *
+ * @param frame_addr Physical address of the frame
+ * @return 0 on success, -1 if the frame is free or has too many references
+ */
+int frame_ref(uint32_t frame_addr);
+
+/**
+ * Drop a reference to a frame, freeing it when it was the last one
+ *
+ * @param frame_addr Physical address of the frame
+ */
+void frame_release(uint32_t frame_addr);
+
+/**
+ * Number of references to a frame
+ *
+ * @param frame_addr Physical address of the frame
+ * @return References (1 for a frame with a single owner), 0 if the frame is free
+ */
+uint32_t frame_refcount(uint32_t frame_addr);
+
+/**
+ * Allocate 2^order physically contiguous frames (buddy allocator)
+ *
+ * The block is aligned to its size (e.g. order 4 = 64 KiB, 64 KiB aligned).
+ *
+ * @param order Block size as a power of two number of frames (0..FRAME_MAX_ORDER)
+ * @return Physical address of the first frame, or 0 if none available
+ */
+uint32_t frame_alloc_order(uint32_t order);
+
+/**
+ * Free a block allocated with frame_alloc_order()
+ *
+ * @param frame_addr Physical address of the first frame
+ * @param order Order the block was allocated with
+ */
+void frame_free_order(uint32_t frame_addr, uint32_t order);
+
+/**
+ * Register the function that frees reclaimable frames when memory runs out
+ * When no block of the requested order is free, the frame allocator calls it
+ * once, with no lock of its own held, and retries. It may run in any context
+ * an allocation does (IRQ handlers, under other spinlocks), so it must not
+ * sleep or allocate, and should give up rather than wait for a lock.
+ * @param reclaim Frees up to 'frames' frames and returns how many it freed
+ */
+void frame_set_reclaim(uint32_t (*reclaim)(uint32_t frames));
+
+/* Frame allocator counters (frame_get_stats()); total = reserved + free + used + zeroed */
+typedef struct {
+    uint32_t total;                     /* Frames covered by the allocator */
+    uint32_t reserved;                  /* Never handed out: memory holes, kernel image, allocator metadata */
+    uint32_t free;                      /* In the buddy lists */
+    uint32_t used;                      /* Allocated (page cache, heap, page tables, processes, ...) */
+    uint32_t zeroed;                    /* Zeroed ahead of time, waiting for frame_alloc_zeroed() */
+    uint32_t largest_free_run;          /* Longest run of contiguous free frames */
+    uint32_t free_blocks[FRAME_MAX_ORDER + 1];      /* Free blocks of each order */
+} frame_stats_t;
+
+/**
+ * Get the frame allocator's counters
+ *
+ * largest_free_run against free shows fragmentation: with free memory in
+ * many short runs, large frame_alloc_order() requests fail although plenty
+ * of frames are free. Finding the run walks the frame bitmap with
+ * frame_lock held, so this is for statistics, not for hot paths.
+ *
+ * @param stats Filled with the counters
+ */
+void frame_get_stats(frame_stats_t* stats);
+
+/**
+ * Get the number of physical frames detected at boot
+ *
+ * @return Frames covered by the frame allocator (usable or not)
+ */
+uint32_t frame_total(void);
+
+/**
+ * End of memory reserved at boot (page-aligned)
+ * Covers the kernel image, the multiboot data right after it and the frame
+ * allocator's bitmaps (boot data above KMEM_MAX is reserved separately).
+ * This marks where the kernel heap can begin
+ */
+extern uint32_t frame_reserved_end;
+
 #endif
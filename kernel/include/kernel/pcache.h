@@ -0,0 +1,157 @@
+#ifndef _KERNEL_PCACHE_H
+#define _KERNEL_PCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/block.h>
+#include <kernel/wait.h>
+
+/**
+ * Page Cache
+ *
+ * Data read from or written to block devices is kept in whole pages, found
+ * by (mapping, page index). A mapping is anything with pages on a disk: a
+ * whole device, a partition, or a file whose filesystem translates page
+ * indexes to sectors with bmap().
+ *
+ *   pcache_read(m, offset, ...)
+ *     → hash (m, index) → cached and up to date?  copy out       (no I/O)
+ *     → else a frame, I/O started into it, sleep until it's there
+ *     → the reads so far were sequential?  the next window of pages is
+ *       submitted too, without waiting (read-ahead); adjacent pages merge
+ *       into large requests in the device's queue
+ *
+ *   pcache_write(m, offset, ...) → copy into the page (read first unless
+ *     the whole page is overwritten) → dirty; the "pcache-wb" thread writes
+ *     dirty pages back every PCACHE_WRITEBACK_MS, or sooner once
+ *     PCACHE_DIRTY_KICK are waiting
+ *
+ * Every page sits on one clock list. A hit sets the page's referenced bit;
+ * the reclaimer's hand clears it and evicts the pages it finds clear, as
+ * long as they are clean, idle and not being copied. It runs when the cache
+ * reaches its size limit and, through frame_set_reclaim(), whenever the
+ * frame allocator runs out, so cached pages give way to any other use of
+ * memory.
+ *
+ * Page contents live in frames mapped into their own kernel window, one
+ * slot per page, so DMA goes directly into the cache.
+ */
+
+#define PCACHE_VIRT_START       0xF1000000      /* Right above the paging_map_physical() window */
+#define PCACHE_VIRT_END         0xF9000000      /* 128 MiB: pages the cache can ever hold */
+#define PCACHE_HASH_BUCKETS     1024
+#define PCACHE_RA_MIN           4               /* First read-ahead window, in pages */
+#define PCACHE_RA_MAX           32              /* Window doubles up to this */
+#define PCACHE_WRITEBACK_MS     500             /* Dirty pages are at most this old before write-back */
+#define PCACHE_DIRTY_KICK       256             /* Dirty pages that start write-back early */
+#define PCACHE_MEMORY_SHARE     4               /* The cache holds at most 1/4 of physical memory */
+
+/* pcache_page_t.flags */
+#define PCACHE_UPTODATE         0x01            /* Contents match (or are newer than) the disk */
+#define PCACHE_DIRTY            0x02            /* Written since the last write-back */
+#define PCACHE_LOCKED           0x04            /* I/O in flight */
+#define PCACHE_REFERENCED       0x08            /* Used since the clock hand passed */
+#define PCACHE_ERROR            0x10            /* Last read failed */
+
+typedef struct pcache_mapping pcache_mapping_t;
+
+struct pcache_mapping {
+    block_device_t* dev;
+    uint32_t first_sector;              /* Page 0's first sector when bmap is NULL */
+    uint32_t size;                      /* Bytes; reads stop here */
+    /**
+     * First sector of a page, for mappings that aren't one contiguous range
+     * (a page's sectors must still be contiguous). NULL: first_sector + index * 8.
+     */
+    uint32_t (*bmap)(pcache_mapping_t* m, uint32_t index);
+    void* priv;                         /* For bmap() */
+
+    /* Read-ahead state (pcache lock) */
+    uint32_t ra_next;                   /* Page a sequential reader touches next */
+    uint32_t ra_end;                    /* First page past the last read-ahead */
+    uint32_t ra_window;                 /* Pages the next read-ahead covers */
+};
+
+typedef struct pcache_page {
+    pcache_mapping_t* mapping;
+    uint32_t index;
+    uint32_t frame;
+    uint8_t* data;                      /* Slot in the cache window */
+    volatile uint32_t flags;            /* PCACHE_* */
+    uint32_t users;                     /* Copies in progress; pinned while non-zero */
+    block_io_t io;
+    wait_queue_t wait;                  /* Threads waiting for the I/O */
+    struct pcache_page* hash_next;
+    struct pcache_page* clock_next;     /* Circular clock list */
+    struct pcache_page* clock_prev;
+    struct pcache_page* wb_next;        /* Write-back batch */
+} pcache_page_t;
+
+typedef struct {
+    uint64_t hits;                      /* Page lookups served from the cache */
+    uint64_t misses;                    /* ... that had to read the disk */
+    uint64_t readahead;                 /* Pages read ahead of the reader */
+    uint64_t evicted;                   /* Clean pages reclaimed */
+    uint64_t written_back;              /* Dirty pages written to disk */
+    uint32_t pages;                     /* Pages cached now */
+    uint32_t dirty;                     /* ... of which dirty */
+    uint32_t limit;                     /* Pages the cache may hold */
+} pcache_stats_t;
+
+/**
+ * Set up the cache and start the write-back thread (after sched_init() and timer_initialize())
+ */
+int pcache_init(void);
+
+/**
+ * Describe a contiguous range of sectors as a mapping
+ *
+ * @param m Mapping to fill in
+ * @param dev Device holding the data
+ * @param first_sector Sector of byte 0
+ * @param size Length in bytes
+ */
+void pcache_mapping_init(pcache_mapping_t* m, block_device_t* dev, uint32_t first_sector, uint32_t size);
+
+/**
+ * Read through the cache
+ *
+ * @return Bytes copied (short at the end of the mapping), -1 if the first page couldn't be read
+ */
+int32_t pcache_read(pcache_mapping_t* m, uint32_t offset, void* buf, size_t len);
+
+/**
+ * Write into the cache; the disk is updated later by write-back or pcache_sync()
+ *
+ * @return Bytes written (short at the end of the mapping), -1 if nothing could be
+ */
+int32_t pcache_write(pcache_mapping_t* m, uint32_t offset, const void* buf, size_t len);
+
+/**
+ * Write a mapping's dirty pages back and wait for them
+ *
+ * @param m Mapping, or NULL for every mapping
+ * @return 0 on success, -1 if a write failed (the page stays dirty)
+ */
+int pcache_sync(pcache_mapping_t* m);
+
+/**
+ * Drop a mapping's pages (none may be in use; dirty ones are written back first)
+ */
+void pcache_invalidate(pcache_mapping_t* m);
+
+/**
+ * Evict up to count clean pages, for the frame allocator
+ *
+ * @return Pages freed (0 if the cache is busy on this CPU)
+ */
+uint32_t pcache_shrink(uint32_t count);
+
+/**
+ * Get cache statistics
+ */
+void pcache_get_stats(pcache_stats_t* stats);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef _KERNEL_PCI_H
+#define _KERNEL_PCI_H
+
+#include <stdint.h>
+
+/**
+ * PCI Configuration Space (Mechanism #1)
+ *
+ * Every function's 256-byte configuration space is reached through two
+ * I/O ports:
+ *
+ *   outl(0xCF8, 1 << 31 | bus << 16 | slot << 11 | func << 8 | offset & 0xFC)
+ *   inl(0xCFC) / outl(0xCFC, value)     → that double word
+ *
+ * The bus is enumerated by brute force (256 buses x 32 slots); slots whose
+ * vendor ID reads 0xFFFF are empty, and functions 1-7 are only probed on
+ * multi-function devices.
+ *
+ * Reference: https://wiki.osdev.org/PCI
+ */
+
+#define PCI_CONFIG_ADDRESS      0xCF8
+#define PCI_CONFIG_DATA         0xCFC
+
+/* Configuration space offsets (header type 0) */
+#define PCI_VENDOR_ID           0x00
+#define PCI_DEVICE_ID           0x02
+#define PCI_COMMAND             0x04
+#define PCI_STATUS              0x06
+#define PCI_PROG_IF             0x09
+#define PCI_SUBCLASS            0x0A
+#define PCI_CLASS               0x0B
+#define PCI_HEADER_TYPE         0x0E
+#define PCI_BAR0                0x10
+#define PCI_INTERRUPT_LINE      0x3C
+
+/* PCI_COMMAND bits */
+#define PCI_COMMAND_IO          0x1     /* Respond to I/O space accesses */
+#define PCI_COMMAND_MEMORY      0x2     /* Respond to memory space accesses */
+#define PCI_COMMAND_MASTER      0x4     /* May master the bus (DMA) */
+
+#define PCI_BAR_IO              0x1     /* Bit 0 of a BAR: I/O ports instead of memory */
+#define PCI_BARS                6
+
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t irq_line;                   /* Legacy IRQ the firmware routed INTx to, 0xFF if none */
+    uint32_t bar[PCI_BARS];             /* Raw BARs (PCI_BAR_IO set for port ranges) */
+} pci_device_t;
+
+/**
+ * Read a double word of a function's configuration space
+ *
+ * @param offset Byte offset (rounded down to 4)
+ */
+uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
+
+/**
+ * Write a double word of a function's configuration space
+ *
+ * @param offset Byte offset (rounded down to 4)
+ */
+void pci_config_write(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint32_t value);
+
+/**
+ * Find the index-th function of a class
+ *
+ * @param class_code Base class (e.g. 0x01 mass storage)
+ * @param subclass Subclass (e.g. 0x01 IDE), 0xFF for any
+ * @param index 0 for the first match, 1 for the next, ...
+ * @param dev Filled in on success
+ * @return 0 if found, -1 otherwise
+ */
+int pci_find_class(uint8_t class_code, uint8_t subclass, uint32_t index, pci_device_t* dev);
+
+/**
+ * Find the index-th function with a vendor and device ID
+ *
+ * @param vendor_id Vendor ID
+ * @param device_id Device ID, 0xFFFF for any device of the vendor
+ * @param index 0 for the first match, 1 for the next, ...
+ * @param dev Filled in on success
+ * @return 0 if found, -1 otherwise
+ */
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, uint32_t index, pci_device_t* dev);
+
+/**
+ * Let a function master the bus (needed before it can DMA)
+ */
+void pci_enable_bus_master(const pci_device_t* dev);
+
+/**
+ * Base address of a BAR with its type bits cleared
+ */
+static inline uint32_t pci_bar_address(const pci_device_t* dev, int bar) {
+    uint32_t value = dev->bar[bar];
+    return (value & PCI_BAR_IO) ? (value & ~0x3u) : (value & ~0xFu);
+}
+
+#endif
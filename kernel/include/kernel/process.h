@@ -0,0 +1,266 @@
+#ifndef _KERNEL_PROCESS_H
+#define _KERNEL_PROCESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/spinlock.h>
+#include <kernel/paging.h>
+#include <kernel/module.h>
+#include <kernel/vfs.h>
+
+/**
+ * User Processes
+ *
+ * A process is a page directory of its own plus one thread that runs in it.
+ * The user range [USER_SPACE_START, USER_SPACE_END) is private, so every
+ * process can load at the same address without seeing the others; the kernel
+ * range is shared by all directories. The thread's kernel stack is loaded
+ * into TSS esp0 while it runs, so interrupts and system calls from ring 3
+ * land on it.
+ *
+ * User memory layout:
+ *
+ *   USER_CODE_START (0x40000000)   program image, entry at its first byte
+ *                                  heap (brk()), from the page above the program up
+ *   ...
+ *   USER_MMAP_BASE  (0x80000000)   mmap() regions, placed top-down from USER_MMAP_TOP
+ *   ...                            guard page
+ *   USER_VCLOCK_BASE (0xBFFF8000)  clock page, read-only and shared by all processes (kernel/vclock.h)
+ *   USER_RING_BASE  (0xBFFF9000)   system call ring, if the process made one (kernel/ioring.h)
+ *                                  guard page
+ *   USER_STACK_TOP  (0xC0000000)   initial ESP, USER_STACK_PAGES mapped below it
+ *
+ * An ELF program (process_exec()) is laid out by its PT_LOAD segments
+ * instead. Nothing is copied up front: each page faults in on first touch
+ * (process_handle_fault()). Read-only pages that lie wholly inside the file
+ * map the boot module's own frames, so all instances of a binary share one
+ * copy of its text.
+ *
+ * mmap() regions are segments too: a file mapping is one whose contents are
+ * the file's bytes in memory (an initrd file), an anonymous one has no file
+ * bytes. So a read-only file mapping costs no copy: its pages map the
+ * archive's frames, shared by every process, as long as the file's data is
+ * page-aligned in the archive (otherwise each page is copied on first touch).
+ * The heap faults in the same way, as zero-filled pages.
+ */
+
+#define USER_CODE_START     USER_SPACE_START
+#define USER_STACK_TOP      USER_SPACE_END
+#define USER_STACK_PAGES    4                           /* 16 KiB user stack */
+#define USER_IMAGE_MAX      (1024 * 1024)               /* Largest flat image process_create() accepts */
+#define PROCESS_MAX_SEGMENTS 16                         /* PT_LOAD segments and mmap() regions per process */
+#define USER_RING_PAGES     2                           /* Room for the largest system call ring */
+#define USER_RING_BASE      (USER_STACK_TOP - (USER_STACK_PAGES + 1 + USER_RING_PAGES) * PAGE_SIZE)
+#define USER_VCLOCK_BASE    (USER_RING_BASE - PAGE_SIZE)
+#define USER_MMAP_BASE      0x80000000                  /* Lowest address mmap() picks or accepts */
+#define USER_MMAP_TOP       (USER_VCLOCK_BASE - PAGE_SIZE)
+
+/* mmap() protections and flags (Linux i386 values) */
+#define MMAP_PROT_READ      0x1
+#define MMAP_PROT_WRITE     0x2
+#define MMAP_PROT_EXEC      0x4
+#define MMAP_SHARED         0x01
+#define MMAP_PRIVATE        0x02
+#define MMAP_FIXED          0x10
+#define MMAP_ANONYMOUS      0x20
+#define MMAP_FAILED         0xFFFFFFFF
+
+/* madvise() advice (Linux values) */
+#define MADV_NORMAL         0
+#define MADV_WILLNEED       3
+#define MADV_DONTNEED       4
+
+typedef enum {
+    PROCESS_RUNNING,            /* Its thread is alive */
+    PROCESS_ZOMBIE,             /* Exited; address space freed, waiting for process_wait() */
+} process_state_t;
+
+/**
+ * Lazily loaded part of the address space (one ELF PT_LOAD segment)
+ *
+ *   start     vaddr                 vaddr + file_size      end
+ *     |---------|==== file bytes ====|------ zeroes ------|
+ */
+typedef struct {
+    uint32_t start;             /* First page (page-aligned) */
+    uint32_t end;               /* One past the last page (page-aligned) */
+    uint32_t vaddr;             /* Address of the first file byte */
+    const uint8_t* file;        /* Segment contents in kernel memory */
+    uint32_t file_phys;         /* Physical address of 'file' */
+    uint32_t file_size;         /* Bytes taken from the file, the rest is zero-filled */
+    uint32_t flags;             /* PTE flags for its pages */
+    bool mmap;                  /* Made by process_mmap() (process_munmap() may remove it) */
+} process_segment_t;
+
+typedef struct process {
+    uint32_t pid;               /* Process ID (1, 2, ...) */
+    process_state_t state;
+    uint32_t page_directory;    /* Physical address of the page directory, 0 once freed */
+    thread_t* thread;           /* Thread running the program */
+    spinlock_t lock;            /* Segments, heap bounds and live_threads */
+    uint32_t live_threads;      /* Threads using the address space (program + ring polling thread) */
+    void* image;                /* Copy of a flat program, freed once it is mapped */
+    size_t image_size;
+    uint32_t entry;             /* First user instruction */
+    process_segment_t segments[PROCESS_MAX_SEGMENTS];
+    uint32_t segment_count;
+    uint32_t heap_start;        /* First heap byte (page-aligned, above the program) */
+    uint32_t heap_end;          /* Program break: one past the last heap byte */
+    struct ioring* ioring;      /* System call ring, NULL if none */
+    file_t* files[VFS_FD_MAX];  /* Open file descriptors (NULL: closed) */
+    int exit_code;              /* Status passed to SYSCALL_EXIT, -1 if killed */
+    wait_queue_t exit_wait;     /* Threads in process_wait() */
+    struct process* next;       /* Process list link */
+} process_t;
+
+struct regs;
+
+/**
+ * Start a user program in a new address space
+ *
+ * The flat binary image is copied, so the caller's buffer may be reused once
+ * this returns. The process's thread maps the image at USER_CODE_START plus a
+ * stack below USER_STACK_TOP, then enters ring 3 at USER_CODE_START.
+ *
+ * @param name Name for diagnostics (the thread's name)
+ * @param image Program code and data
+ * @param size Image size in bytes (at most USER_IMAGE_MAX)
+ * @return New process, or NULL on failure
+ */
+process_t* process_create(const char* name, const void* image, size_t size);
+
+/**
+ * Start an ELF executable from a boot module or the VFS in a new address space
+ *
+ * Only the headers are read here; segment pages are filled on first touch.
+ * A name with a '/' is a VFS path, whose file must be resident in memory
+ * (the initrd's are); others name a boot module.
+ *
+ * @param name Module name (see module_find()) or path
+ * @return New process, or NULL if there is no such module or file or it isn't a valid program
+ */
+process_t* process_exec(const char* name);
+
+/**
+ * Duplicate the calling process (SYSCALL_FORK)
+ *
+ * The child gets a copy-on-write copy of the parent's address space and
+ * resumes in ring 3 from the same system call frame, with 0 in EAX.
+ *
+ * @param frame Parent's saved registers at the system call
+ * @return Child's PID in the parent, or -1 on failure
+ */
+int process_fork(const struct regs* frame);
+
+/**
+ * Find a process by PID
+ *
+ * @param pid Process ID
+ * @return Process (possibly a zombie), or NULL if there is none
+ */
+process_t* process_find(uint32_t pid);
+
+/**
+ * Wait for a process to exit and free it
+ *
+ * Every process must be waited for once; after that the pointer is invalid.
+ *
+ * @param proc Process returned by process_create()
+ * @return Its exit code
+ */
+int process_wait(process_t* proc);
+
+/**
+ * Process of the running thread
+ *
+ * @return Process, or NULL in a kernel thread
+ */
+process_t* process_current(void);
+
+/**
+ * Terminate the running thread, recording an exit code if it belongs to a process
+ *
+ * @param exit_code Status reported by process_wait()
+ */
+__attribute__((noreturn)) void process_exit(int exit_code);
+
+/**
+ * Map a file or anonymous memory into the calling process (SYSCALL_MMAP)
+ *
+ * Nothing is mapped up front; pages fault in through process_handle_fault().
+ * File mappings need a file resident in memory (see inode_ops_t.memory) and
+ * can only be shared if read-only, since files can't be written; a private
+ * writable mapping gets its own copy of each page it touches. Anonymous
+ * mappings must be private and start zero-filled.
+ *
+ * @param addr Address for MMAP_FIXED (page-aligned, in [USER_MMAP_BASE, USER_MMAP_TOP)), otherwise ignored
+ * @param len Bytes to map (rounded up to pages)
+ * @param prot MMAP_PROT_READ, optionally with MMAP_PROT_WRITE and MMAP_PROT_EXEC
+ * @param flags MMAP_SHARED or MMAP_PRIVATE, optionally with MMAP_FIXED and MMAP_ANONYMOUS
+ * @param file Open file to map (ignored with MMAP_ANONYMOUS)
+ * @param offset Page-aligned offset of the first mapped byte in the file
+ * @return Address of the mapping, or MMAP_FAILED
+ */
+uint32_t process_mmap(uint32_t addr, size_t len, uint32_t prot, uint32_t flags, file_t* file, uint32_t offset);
+
+/**
+ * Remove a mapping of the calling process (SYSCALL_MUNMAP)
+ *
+ * @param addr Start of a mapping returned by process_mmap()
+ * @param len Its length (whole mappings only)
+ * @return 0, or -1 if [addr, addr + len) isn't exactly one mapping
+ */
+int process_munmap(uint32_t addr, size_t len);
+
+/**
+ * Move the end of the calling process's heap (SYSCALL_BRK)
+ *
+ * The heap lies in [heap_start, end); pages fault in zero-filled. Shrinking
+ * it frees the pages above the new end.
+ *
+ * @param end New program break, or 0 (any invalid value) to only query it
+ * @return The program break after the call (unchanged if end was refused), 0 in a kernel thread
+ */
+uint32_t process_brk(uint32_t end);
+
+/**
+ * Give memory of the calling process back to the kernel (SYSCALL_MADVISE)
+ *
+ * MADV_DONTNEED frees the pages of [addr, addr + len) that faulted in; the
+ * next touch faults them in again, zero-filled for the heap and anonymous
+ * mappings, from the file otherwise. Other advice is accepted and ignored.
+ *
+ * @param addr Page-aligned start
+ * @param len Length (rounded up to pages)
+ * @param advice MADV_*
+ * @return 0, or -1 if a page isn't heap or a segment (the stack, a flat image) or advice is unknown
+ */
+int process_madvise(uint32_t addr, size_t len, uint32_t advice);
+
+/**
+ * Back a not-present page of the current process's segments
+ *
+ * Called by the page fault handler for user addresses.
+ *
+ * @param fault_addr Faulting address (CR2)
+ * @return 0 if the page was mapped, -1 if no segment covers it or out of memory
+ */
+int process_handle_fault(uint32_t fault_addr);
+
+/**
+ * Release an exited process's address space (called by the scheduler)
+ *
+ * Runs after the switch away from a dead thread of the process, so its
+ * directory is no longer loaded. Once the last of its threads is gone, the
+ * address space is freed and the threads waiting in process_wait() wake.
+ *
+ * @param proc Process whose thread has died
+ * @param thread The dead thread
+ */
+void process_reap(process_t* proc, thread_t* thread);
+
+#endif
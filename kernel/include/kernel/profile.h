@@ -0,0 +1,87 @@
+#ifndef _KERNEL_PROFILE_H
+#define _KERNEL_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/interrupts.h>
+
+/**
+ * Sampling Profiler
+ *
+ * While running, every interval-th timer tick records where the CPU was:
+ *
+ *   IRQ 0 → profile_tick(regs) → ring[head++] = { regs->eip, return addresses }
+ *
+ * The call chain comes from debug_unwind() on the interrupted EBP (the kernel
+ * is built with frame pointers). Samples from ring 3 record only the EIP. The
+ * ring keeps the newest PROFILE_RING_SIZE samples.
+ *
+ * Reports resolve addresses with the symbol index (kernel/debug.h):
+ *   profile_print_flat()    top functions by samples, on the console
+ *   profile_print_folded()  one "outer;...;leaf count" line per distinct stack,
+ *                           the input format of flamegraph.pl
+ */
+
+#define PROFILE_RING_SIZE       4096    /* Samples kept (power of two) */
+#define PROFILE_MAX_DEPTH       8       /* Return addresses per sample */
+
+typedef struct {
+    uint32_t eip;                       /* Interrupted instruction */
+    uint8_t depth;                      /* Valid entries in frames[] */
+    uint8_t user;                       /* Sample taken in ring 3 (no call chain) */
+    uint16_t reserved;
+    uint32_t frames[PROFILE_MAX_DEPTH]; /* Return addresses, innermost first */
+} profile_sample_t;
+
+/**
+ * Start sampling, discarding earlier samples
+ *
+ * @param interval Sample every interval-th timer tick (0 is treated as 1)
+ * @param callchain Also record the call chain of each sample
+ * @return 0 on success, -1 if the ring could not be allocated
+ */
+int profile_start(uint32_t interval, bool callchain);
+
+/**
+ * Stop sampling; the samples stay until the next profile_start()
+ */
+void profile_stop(void);
+
+/**
+ * Check whether sampling is on
+ */
+bool profile_running(void);
+
+/**
+ * Record a sample (called from the timer IRQ)
+ *
+ * @param r Interrupted register state
+ */
+void profile_tick(const regs_t* r);
+
+/**
+ * Copy the recorded samples, oldest first
+ *
+ * @param out Destination
+ * @param max Capacity of out
+ * @return Number of samples copied
+ */
+size_t profile_read(profile_sample_t* out, size_t max);
+
+/**
+ * Print the functions with the most samples
+ *
+ * @param top Number of functions to show
+ */
+void profile_print_flat(uint32_t top);
+
+/**
+ * Write the samples as folded stacks (flamegraph.pl input) to a serial port
+ *
+ * @param port Serial port base (SERIAL_COM1_BASE, ...)
+ */
+void profile_print_folded(uint16_t port);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _KERNEL_RCU_H
+#define _KERNEL_RCU_H
+
+/**
+ * Read-Copy-Update
+ *
+ * For read-mostly data reached through a pointer (or a table of them).
+ * Readers take no lock and never wait; a writer publishes a new version and
+ * then waits one grace period before freeing or reusing the old one:
+ *
+ *   reader:  rcu_read_lock() → p = rcu_dereference(ptr) → use *p → rcu_read_unlock()
+ *   writer:  (own lock) → rcu_assign_pointer(ptr, new) → synchronize_rcu() → free old
+ *
+ * A grace period ends once every reader that might still see the old version
+ * has left its read-side section. Each CPU counts how deep it is in read-side
+ * sections and how many it has left; synchronize_rcu() waits, for every other
+ * CPU that is inside one, until that CPU leaves it. Readers run with
+ * preemption disabled, so none is asleep on the caller's own CPU.
+ *
+ * Read-side sections nest, may be used in IRQ handlers, and must not sleep.
+ */
+
+/**
+ * Load a pointer that a writer publishes with rcu_assign_pointer()
+ */
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+/**
+ * Publish a pointer; everything written to *v before is visible to readers that load it
+ */
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/**
+ * Enter a read-side section
+ */
+void rcu_read_lock(void);
+
+/**
+ * Leave a read-side section
+ */
+void rcu_read_unlock(void);
+
+/**
+ * Wait until all read-side sections that were running on other CPUs have ended
+ *
+ * Call from thread context, outside any read-side section and without
+ * spinlocks held an IRQ handler could want: it spins until the other CPUs
+ * get through their readers.
+ */
+void synchronize_rcu(void);
+
+#endif
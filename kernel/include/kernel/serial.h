@@ -2,6 +2,7 @@
 #define _KERNEL_SERIAL_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 /* Serial port base addresses */
@@ -20,9 +21,11 @@
 #define SERIAL_DIVISOR_LSB_REG          0x0        /* Divisor LSB (when DLAB = 1) */
 #define SERIAL_DIVISOR_MSB_REG          0x1        /* Divisor MSB (when DLAB = 1) */
 #define SERIAL_FIFO_CONTROL_REG         0x2        /* FIFO control register (write) */
+#define SERIAL_INTERRUPT_ID_REG         0x2        /* Interrupt identification register (read) */
 #define SERIAL_LINE_CONTROL_REG         0x3        /* Line control register */
 #define SERIAL_MODEM_CONTROL_REG        0x4        /* Modem control register */
 #define SERIAL_LINE_STATUS_REG          0x5        /* Line status register */
+#define SERIAL_MODEM_STATUS_REG         0x6        /* Modem status register */
 
 /* Line Control Register bits */
 /*
@@ -90,6 +93,13 @@
  */
 #define SERIAL_LINE_STATUS_THRE         0x20       /* Transmitter holding register empty */
 
+/*
+ * Transmitter Empty (TEMT) - Holding register and shift register both idle
+ * Bit:   | 7 | 6 | 5 | 4 | 3 | 2 | 1 | 0 |
+ * Value: | 0 | 1 | 0 | 0 | 0 | 0 | 0 | 0 | = 0x40
+ */
+#define SERIAL_LINE_STATUS_TEMT         0x40       /* Transmitter empty */
+
 /* FIFO Control Register bits */
 /*
  * FIFO Control Register - Configures FIFO buffers
@@ -196,6 +206,13 @@
  */
 #define SERIAL_INT_ENABLE_RDA           0x01       /* Received data available */
 
+/*
+ * Enable Transmitter Holding Register Empty Interrupt
+ * Bit:   | 7 | 6 | 5 | 4 | 3 | 2 | 1 | 0 |
+ * Value: | 0 | 0 | 0 | 0 | 0 | 0 | 1 | 0 | = 0x02
+ */
+#define SERIAL_INT_ENABLE_THRE          0x02       /* Transmitter holding register empty */
+
 /*
  * Disable All Interrupts
  * Bit:   | 7 | 6 | 5 | 4 | 3 | 2 | 1 | 0 |
@@ -203,6 +220,36 @@
  */
 #define SERIAL_INT_DISABLE_ALL          0x00       /* Disable all interrupts */
 
+/* Interrupt Identification Register bits */
+/*
+ * Interrupt Identification Register - Highest-priority pending interrupt
+ *
+ * Bit | Name | Description
+ * ----|------|------------
+ *  0  | IP   | Interrupt Pending (0=pending, 1=none)
+ * 1-3 | ID   | Interrupt ID (011=line status, 010=RDA, 110=RX timeout, 001=THRE, 000=modem status)
+ * 4-5 |      | Reserved
+ * 6-7 | FIFO | FIFOs enabled
+ */
+#define SERIAL_IIR_NO_INTERRUPT         0x01       /* No interrupt pending */
+#define SERIAL_IIR_ID_MASK              0x0E       /* Interrupt ID bits */
+#define SERIAL_IIR_MODEM_STATUS         0x00       /* Modem status changed (read MSR) */
+#define SERIAL_IIR_THRE                 0x02       /* Transmit holding register empty */
+#define SERIAL_IIR_RDA                  0x04       /* Received data available */
+#define SERIAL_IIR_LINE_STATUS          0x06       /* Line status error (read LSR) */
+#define SERIAL_IIR_RX_TIMEOUT           0x0C       /* Data sat in the RX FIFO below the trigger level */
+
+/* Interrupt-driven I/O */
+/*
+ * Once serial_enable_interrupts() is called on COM1 (IRQ 4) or COM2 (IRQ 3),
+ * writes go into a TX ring that the THRE interrupt drains into the 16-byte
+ * FIFO, and the RDA interrupt moves received bytes into an RX ring. Other
+ * ports, and any write made with interrupts disabled, use polled I/O.
+ */
+#define SERIAL_TX_RING_SIZE             4096       /* Bytes queued for transmit (power of two) */
+#define SERIAL_RX_RING_SIZE             256        /* Bytes buffered on receive (power of two) */
+#define SERIAL_FIFO_DEPTH               16         /* 16550A transmit FIFO size */
+
 /* Standard baud rate divisors */
 /*
  * Baud rate calculation: divisor = 115200 / desired_baud_rate
@@ -264,6 +311,41 @@ void serial_write_char(uint16_t port, char c);
  */
 void serial_write_string(uint16_t port, const char* str);
 
+/**
+ * Send a buffer over the serial port
+ *
+ * @param port Base port address
+ * @param data Bytes to send
+ * @param len Number of bytes
+ */
+void serial_write(uint16_t port, const char* data, size_t len);
+
+/**
+ * Wait until every queued byte has left the transmitter
+ *
+ * Call before anything that stops the machine (e.g. exiting QEMU) so that
+ * output still in the TX ring is not lost.
+ *
+ * @param port Base port address
+ */
+void serial_flush(uint16_t port);
+
+/**
+ * Number of bytes waiting in the TX ring
+ *
+ * @param port Base port address
+ * @return Queued bytes, 0 for polled ports
+ */
+size_t serial_tx_pending(uint16_t port);
+
+/**
+ * Number of received bytes dropped because the RX ring was full
+ *
+ * @param port Base port address
+ * @return Dropped bytes, 0 for polled ports
+ */
+uint32_t serial_rx_dropped(uint16_t port);
+
 /**
  * Send formatted output to the serial port (similar to printf)
  *
@@ -293,6 +375,9 @@ char serial_read_char(uint16_t port);
 /**
  * Enable serial port interrupts
  *
+ * On COM1 and COM2 this also registers the IRQ handler and switches the port
+ * to ring-buffered I/O.
+ *
  * @param port Base port address
  */
 void serial_enable_interrupts(uint16_t port);
@@ -300,6 +385,8 @@ void serial_enable_interrupts(uint16_t port);
 /**
  * Disable serial port interrupts
  *
+ * Flushes the TX ring and returns the port to polled I/O.
+ *
  * @param port Base port address
  */
 void serial_disable_interrupts(uint16_t port);
@@ -1,6 +1,59 @@
 #ifndef KERNEL_SHELL_H
 #define KERNEL_SHELL_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Shell Commands
+ *
+ *   SHELL_COMMAND(irqstat, "interrupt counts per IRQ line [reset]") {
+ *       irq_print_stats();
+ *       return 1;
+ *   }
+ *
+ * defines the handler shell_irqstat() and puts the command into the
+ * .shell_commands linker section, so a subsystem brings its own commands
+ * and the shell has no list to keep up to date. The first lookup hashes
+ * every name into a table of at least twice as many slots as commands (a
+ * seed is searched until no two names collide), so finding a command is one
+ * hash and one string compare however many there are:
+ *
+ *   "irqstat" → FNV-1a(seed) & mask → slot → strcmp → handler
+ *                                           → no match: /bin/irqstat from the initrd
+ *
+ * A word that is no command is run as a program: a path as it is, a plain
+ * name from /bin. The shell waits for it and reports a non-zero exit code.
+ */
+
+/* One registered command */
+typedef struct {
+    const char* name;
+    const char* help;                   /* One line for "help" */
+    int (*func)(char** args);           /* 1 to continue the shell loop, 0 to exit */
+} shell_command_t;
+
+/**
+ * Define and register a command
+ *
+ * @param cmd Command name (a C identifier; the handler is shell_<cmd>)
+ * @param help Description shown by "help"
+ */
+#define SHELL_COMMAND(cmd, help)                                                                    \
+    int shell_##cmd(char** args);                                                                   \
+    static const shell_command_t shell_command_##cmd                                                \
+        __attribute__((used, section(".shell_commands"), aligned(4))) = { #cmd, help, shell_##cmd }; \
+    int shell_##cmd(char** args)
+
+/**
+ * Parse a decimal command argument
+ *
+ * @param str Argument
+ * @param value Set to the number if it parses
+ * @return true if str is a non-empty string of digits
+ */
+bool shell_parse_uint(const char* str, uint32_t* value);
+
 /**
  * Initialize and run the interactive shell
  *
@@ -22,6 +75,14 @@ void init_shell(void);
  */
 int shell_num_builtins(void);
 
+/**
+ * Find a registered command
+ *
+ * @param name Command name
+ * @return The command, or NULL if none has that name
+ */
+const shell_command_t* shell_find_command(const char* name);
+
 /**
  * Execute a shell command
  *
@@ -0,0 +1,39 @@
+#ifndef _KERNEL_SMP_H
+#define _KERNEL_SMP_H
+
+#include <stdint.h>
+
+/**
+ * Multiprocessor Startup
+ *
+ * The boot CPU runs everything until smp_init() starts the other CPUs the
+ * firmware lists (the ACPI MADT). Each gets its own GDT, TSS, kernel stack
+ * and per-CPU data; smp_processor_id() tells the CPUs apart.
+ *
+ * Once started, an application processor runs threads from its own run
+ * queue (kernel/thread.h). Device interrupts stay with the boot CPU.
+ */
+
+#define SMP_MAX_CPUS            16      /* Size of the per-CPU arrays (matches ACPI_MAX_CPUS) */
+
+/**
+ * Start the application processors
+ *
+ * Call after apic_init() and timer_initialize() (the startup sequence waits
+ * on the clock). Without an APIC only the boot CPU runs.
+ *
+ * @return Number of CPUs online, the boot CPU included
+ */
+uint32_t smp_init(void);
+
+/**
+ * Number of CPUs online, the boot CPU included
+ */
+uint32_t smp_cpu_count(void);
+
+/**
+ * Index of the running CPU (0 = boot CPU)
+ */
+uint32_t smp_processor_id(void);
+
+#endif
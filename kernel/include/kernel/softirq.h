@@ -0,0 +1,85 @@
+#ifndef _KERNEL_SOFTIRQ_H
+#define _KERNEL_SOFTIRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Deferred Interrupt Work (Tasklets)
+ *
+ * An IRQ handler does only what can't wait (read the device, acknowledge
+ * it) and queues the rest:
+ *
+ *   static tasklet_t rx_work = TASKLET_INIT(rx_process, NULL);
+ *   void rx_irq(regs_t* r) { read FIFO; tasklet_schedule(&rx_work); }
+ *
+ * irq_handler() sends the EOI first and then runs queued tasklets with
+ * interrupts enabled, so a slow bottom half no longer holds the PIC line or
+ * delays other interrupts. Tasklets run one at a time and never nest; an IRQ
+ * arriving meanwhile only queues more work. After SOFTIRQ_MAX_ROUNDS rounds
+ * in one IRQ exit the rest is handed to the ksoftirqd thread, so a flood of
+ * work can't starve threads.
+ *
+ * A tasklet that is already queued is not queued twice. It may queue itself
+ * again while it runs.
+ */
+
+#define SOFTIRQ_MAX_ROUNDS      8       /* Queue drains per IRQ exit before ksoftirqd takes over */
+
+/* tasklet_t.state */
+#define TASKLET_QUEUED          0x1
+
+typedef struct tasklet {
+    void (*func)(void* data);
+    void* data;
+    struct tasklet* next;               /* Link in the pending queue */
+    volatile uint32_t state;            /* TASKLET_* */
+} tasklet_t;
+
+#define TASKLET_INIT(func, data)        { (func), (data), NULL, 0 }
+
+typedef struct {
+    uint64_t scheduled;                 /* tasklet_schedule() calls that queued a tasklet */
+    uint64_t runs;                      /* Tasklet functions run */
+    uint64_t thread_runs;               /* ... of which by ksoftirqd */
+} softirq_stats_t;
+
+/**
+ * Initialize a tasklet
+ */
+void tasklet_init(tasklet_t* tasklet, void (*func)(void*), void* data);
+
+/**
+ * Queue a tasklet to run after the current IRQ (safe from IRQ handlers)
+ *
+ * Outside an IRQ the tasklet runs at the next IRQ exit, or in ksoftirqd.
+ *
+ * @return true if queued, false if it was already queued
+ */
+bool tasklet_schedule(tasklet_t* tasklet);
+
+/**
+ * Start the ksoftirqd thread (after sched_init())
+ *
+ * @return 0 on success, -1 if the thread could not be created
+ */
+int softirq_init(void);
+
+/**
+ * Run queued tasklets at the end of an IRQ (called by irq_handler() after the EOI)
+ *
+ * Enables interrupts while tasklets run; returns with them disabled.
+ */
+void softirq_irq_exit(void);
+
+/**
+ * Check whether tasklets are queued
+ */
+bool softirq_pending(void);
+
+/**
+ * Copy the tasklet counters
+ */
+void softirq_get_stats(softirq_stats_t* out);
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef _KERNEL_SPINLOCK_H
+#define _KERNEL_SPINLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/thread.h>
+#include <kernel/paging.h>
+
+#include "../../arch/i386/include/irqflags.h"
+
+/**
+ * Spinlocks and Reader-Writer Locks
+ *
+ * For short critical sections that other CPUs may enter too. A waiter spins
+ * instead of sleeping, so the holder must not block. Holding one disables
+ * preemption; the _irqsave variants also disable interrupts, and are needed
+ * for any lock an IRQ handler takes (else the handler spins forever on the
+ * lock its own CPU holds).
+ *
+ * Ticket lock: take a number, wait until it is served. Waiters get the lock
+ * in arrival order, so none starves:
+ *
+ *   lock:   ticket = fetch_add(next, 1) → spin until owner == ticket
+ *   unlock: owner++
+ *
+ * Reader-writer lock: any number of readers or one writer. A waiting writer
+ * stops new readers from entering, so a stream of readers can't starve it.
+ * Writers queue on a ticket lock among themselves. For the same reason a
+ * reader must not take the lock again while it holds it.
+ *
+ * None of the locks nest on the same CPU: taking a lock the CPU already
+ * holds spins forever.
+ *
+ * Waiters serve TLB shootdowns while they spin (tlb_shootdown_poll()): the
+ * holder may be waiting for this CPU to flush, and with interrupts off the
+ * IPI asking for it can't get through.
+ */
+
+typedef union spinlock {
+    uint32_t word;                      /* Both halves, for spin_trylock() */
+    struct {
+        volatile uint16_t owner;        /* Ticket being served */
+        volatile uint16_t next;         /* Next ticket to hand out */
+    };
+} spinlock_t;
+
+typedef struct {
+    spinlock_t writer;                  /* Held by the writer, and queues the next ones */
+    volatile uint32_t readers;          /* Readers inside */
+    volatile uint32_t writing;          /* A writer holds or waits for the lock: readers stay out */
+} rwlock_t;
+
+#define SPINLOCK_INIT           { 0 }
+#define RWLOCK_INIT             { SPINLOCK_INIT, 0, 0 }
+
+/**
+ * Initialize an unlocked spinlock
+ */
+static inline void spin_lock_init(spinlock_t* lock) {
+    lock->word = 0;
+}
+
+/**
+ * Acquire a spinlock, spinning until it is this caller's turn
+ */
+static inline void spin_lock(spinlock_t* lock) {
+    preempt_disable();
+    uint16_t ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        tlb_shootdown_poll();
+        asm volatile("pause");
+    }
+}
+
+/**
+ * Acquire a spinlock only if nobody holds or waits for it
+ *
+ * @return true if the lock was taken
+ */
+static inline bool spin_trylock(spinlock_t* lock) {
+    preempt_disable();
+    uint32_t old = __atomic_load_n(&lock->word, __ATOMIC_RELAXED);
+    /* Free when the ticket being served is the next one handed out; take that ticket */
+    if ((old & 0xFFFF) == (old >> 16) && __atomic_compare_exchange_n(&lock->word, &old, old + 0x10000, false,
+                                                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return true;
+    }
+    preempt_enable();
+    return false;
+}
+
+/**
+ * Release a spinlock, serving the next ticket
+ */
+static inline void spin_unlock(spinlock_t* lock) {
+    /* Only the holder writes owner */
+    __atomic_store_n(&lock->owner, (uint16_t) (lock->owner + 1), __ATOMIC_RELEASE);
+    preempt_enable();
+}
+
+/**
+ * Check whether a spinlock is held (for assertions)
+ */
+static inline bool spin_is_locked(spinlock_t* lock) {
+    uint32_t word = __atomic_load_n(&lock->word, __ATOMIC_RELAXED);
+    return (word & 0xFFFF) != (word >> 16);
+}
+
+/**
+ * Disable interrupts, then acquire a spinlock
+ *
+ * @return Interrupt state for spin_unlock_irqrestore()
+ */
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+/**
+ * Release a spinlock taken with spin_lock_irqsave() and restore interrupts
+ */
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    /* Release without a preemption point: the switch must not happen with interrupts still off */
+    __atomic_store_n(&lock->owner, (uint16_t) (lock->owner + 1), __ATOMIC_RELEASE);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+/**
+ * Initialize an unlocked reader-writer lock
+ */
+void rwlock_init(rwlock_t* lock);
+
+/**
+ * Acquire a reader-writer lock for reading (shared)
+ */
+void read_lock(rwlock_t* lock);
+
+/**
+ * Release a read hold
+ */
+void read_unlock(rwlock_t* lock);
+
+/**
+ * Acquire a reader-writer lock for writing (exclusive), waiting for readers to leave
+ */
+void write_lock(rwlock_t* lock);
+
+/**
+ * Release a write hold
+ */
+void write_unlock(rwlock_t* lock);
+
+/**
+ * Disable interrupts, then acquire for reading
+ *
+ * @return Interrupt state for read_unlock_irqrestore()
+ */
+uint32_t read_lock_irqsave(rwlock_t* lock);
+
+/**
+ * Release a read hold taken with read_lock_irqsave() and restore interrupts
+ */
+void read_unlock_irqrestore(rwlock_t* lock, uint32_t flags);
+
+/**
+ * Disable interrupts, then acquire for writing
+ *
+ * @return Interrupt state for write_unlock_irqrestore()
+ */
+uint32_t write_lock_irqsave(rwlock_t* lock);
+
+/**
+ * Release a write hold taken with write_lock_irqsave() and restore interrupts
+ */
+void write_unlock_irqrestore(rwlock_t* lock, uint32_t flags);
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef _KERNEL_SYNC_H
+#define _KERNEL_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+
+/**
+ * Sleeping Locks and Semaphores
+ *
+ * Built on wait queues: a thread that can't proceed sleeps instead of
+ * spinning and is woken by the thread (or IRQ handler) that releases it.
+ * Mutexes and condition variables may only be used from threads; sem_post()
+ * is also safe from IRQ handlers.
+ */
+
+typedef struct {
+    bool locked;
+    thread_t* owner;            /* Thread holding the mutex */
+    wait_queue_t waiters;
+} mutex_t;
+
+typedef struct {
+    int32_t count;              /* Available units */
+    wait_queue_t waiters;
+} semaphore_t;
+
+typedef struct {
+    wait_queue_t waiters;
+} condvar_t;
+
+#define MUTEX_INIT              { false, NULL, WAIT_QUEUE_INIT }
+#define SEMAPHORE_INIT(n)       { (n), WAIT_QUEUE_INIT }
+#define CONDVAR_INIT            { WAIT_QUEUE_INIT }
+
+/**
+ * Initialize an unlocked mutex
+ *
+ * @param mutex Mutex
+ */
+void mutex_init(mutex_t* mutex);
+
+/**
+ * Acquire a mutex, sleeping while another thread holds it
+ *
+ * Not recursive: locking a mutex the caller already holds deadlocks.
+ *
+ * @param mutex Mutex
+ */
+void mutex_lock(mutex_t* mutex);
+
+/**
+ * Acquire a mutex only if it is free
+ *
+ * @param mutex Mutex
+ * @return true if the mutex was acquired
+ */
+bool mutex_trylock(mutex_t* mutex);
+
+/**
+ * Release a mutex held by the calling thread
+ *
+ * @param mutex Mutex
+ */
+void mutex_unlock(mutex_t* mutex);
+
+/**
+ * Initialize a semaphore
+ *
+ * @param sem Semaphore
+ * @param count Initial number of units
+ */
+void sem_init(semaphore_t* sem, int32_t count);
+
+/**
+ * Take one unit, sleeping until one is available
+ *
+ * @param sem Semaphore
+ */
+void sem_wait(semaphore_t* sem);
+
+/**
+ * Take one unit only if one is available
+ *
+ * @param sem Semaphore
+ * @return true if a unit was taken
+ */
+bool sem_trywait(semaphore_t* sem);
+
+/**
+ * Return one unit and wake a waiter (safe from IRQ handlers)
+ *
+ * @param sem Semaphore
+ */
+void sem_post(semaphore_t* sem);
+
+/**
+ * Initialize a condition variable
+ *
+ * @param cond Condition variable
+ */
+void cond_init(condvar_t* cond);
+
+/**
+ * Release a mutex, sleep until signalled, then re-acquire the mutex
+ *
+ * Releasing and sleeping happen atomically, so a signal sent right after the
+ * mutex is dropped isn't lost. Wakeups may be spurious; re-check the
+ * predicate in a loop.
+ *
+ * @param cond Condition variable
+ * @param mutex Mutex held by the caller
+ */
+void cond_wait(condvar_t* cond, mutex_t* mutex);
+
+/**
+ * Wake one thread waiting on a condition variable
+ *
+ * @param cond Condition variable
+ */
+void cond_signal(condvar_t* cond);
+
+/**
+ * Wake every thread waiting on a condition variable
+ *
+ * @param cond Condition variable
+ */
+void cond_broadcast(condvar_t* cond);
+
+#endif
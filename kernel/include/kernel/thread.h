@@ -0,0 +1,227 @@
+#ifndef _KERNEL_THREAD_H
+#define _KERNEL_THREAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Kernel Threads and Priority Scheduler
+ *
+ * Every thread has its own kernel stack. Switching saves the callee-saved
+ * registers and EFLAGS on the old stack and loads them from the new one
+ * (context_switch() in switch.nasm).
+ *
+ * The highest-priority ready thread runs; threads of equal priority share the
+ * CPU round-robin. The timer IRQ takes one tick off the running thread's time
+ * slice; when it runs out, the thread goes to the back of its level's queue at
+ * the end of the IRQ. A thread waiting for input blocks and the CPU runs other
+ * work, or the idle thread (hlt) when nothing is ready. Waking a thread that
+ * outranks the running one switches at the end of the waking IRQ.
+ *
+ * Every CPU has its own run queues, running thread and idle thread. A new
+ * or woken thread goes to the CPU it last ran on if that one has nothing
+ * else to do, else to the least busy one; thread_create_on() pins a thread
+ * to one CPU instead.
+ */
+
+#define THREAD_STACK_SIZE       8192    /* Kernel stack per thread */
+#define THREAD_NAME_LEN         16      /* Including the terminator */
+#define SCHED_QUANTUM_TICKS     10      /* Time slice in timer ticks (10 ms at 1 kHz) */
+#define SCHED_PRIO_LEVELS       32      /* One bit each in the ready bitmap */
+#define SCHED_PRIO_HIGHEST      0
+#define SCHED_PRIO_DEFAULT      16
+#define SCHED_PRIO_LOWEST       (SCHED_PRIO_LEVELS - 1)
+#define SCHED_BOOST_INPUT       8       /* Levels gained by a thread woken for keyboard/serial input */
+#define THREAD_CPU_ANY          0xFFFFFFFF  /* thread_t.affinity: not pinned */
+
+typedef enum {
+    THREAD_READY,               /* In the run queue of its priority */
+    THREAD_RUNNING,             /* On the CPU */
+    THREAD_BLOCKED,             /* Waiting for thread_unblock() */
+    THREAD_WAKING,              /* Woken, being moved to another CPU's run queue */
+    THREAD_DEAD,                /* Exited, stack freed by the next thread to run */
+} thread_state_t;
+
+struct process;
+
+typedef struct thread {
+    uint32_t esp;               /* Saved stack pointer while switched out */
+    uint32_t id;                /* Thread ID (0 = boot thread) */
+    thread_state_t state;
+    char name[THREAD_NAME_LEN];
+    void* stack;                /* Stack allocation, NULL for the boot stack */
+    uint32_t stack_top;         /* Initial ESP, loaded into TSS esp0 */
+    void (*entry)(void*);       /* Thread function */
+    void* arg;                  /* Argument for entry */
+    uint32_t cr3;               /* Page directory loaded while the thread runs */
+    struct process* process;    /* Owning process, NULL for kernel threads */
+    uint32_t base_priority;     /* Priority set with thread_set_priority() (0 = highest) */
+    uint32_t priority;          /* Effective priority: base minus what is left of a wakeup boost */
+    uint32_t cpu;               /* CPU whose run queue the thread is on, or ran on last */
+    uint32_t affinity;          /* CPU it is pinned to, THREAD_CPU_ANY if none */
+    volatile bool on_cpu;       /* Running, or still switching away: its stack is in use */
+    struct thread* next;        /* Run queue links */
+    struct thread* prev;
+    struct thread* wait_next;   /* Link in the wait queue the thread sleeps in */
+    void* wait_queue;           /* That wait queue (wait_queue_t*), NULL if none */
+    void* fpu_state;            /* FPU/SSE save area (kernel/fpu.h), NULL until the first FPU instruction */
+} thread_t;
+
+/**
+ * Start the scheduler
+ *
+ * Turns the running boot context into thread 0 and creates the idle thread.
+ * Call after kheap_init(); time slicing starts with the timer.
+ */
+void sched_init(void);
+
+/**
+ * Check if sched_init() has run
+ *
+ * @return true once threads can block and switch
+ */
+bool sched_active(void);
+
+/**
+ * Create a kernel thread and put it in the run queue
+ *
+ * Returning from entry is the same as calling thread_exit().
+ *
+ * @param name Name for diagnostics (truncated to THREAD_NAME_LEN - 1)
+ * @param entry Thread function
+ * @param arg Argument passed to entry
+ * @return New thread, or NULL if out of memory
+ */
+thread_t* thread_create(const char* name, void (*entry)(void*), void* arg);
+
+/**
+ * Create a kernel thread that only ever runs on one CPU
+ *
+ * @param cpu CPU index (as smp_processor_id()); must be online
+ * @return New thread, or NULL if out of memory or the CPU doesn't run threads
+ */
+thread_t* thread_create_on(uint32_t cpu, const char* name, void (*entry)(void*), void* arg);
+
+/**
+ * Create a kernel thread without starting it
+ *
+ * The thread is BLOCKED and known to nobody else, so the caller can finish
+ * setting it up (process, cr3, priority) before another CPU could run it.
+ * thread_launch() starts it.
+ *
+ * @return New thread, or NULL if out of memory
+ */
+thread_t* thread_prepare(const char* name, void (*entry)(void*), void* arg);
+
+/**
+ * Start a thread made by thread_prepare()
+ */
+void thread_launch(thread_t* thread);
+
+/**
+ * Run threads on an application processor
+ *
+ * Turns the AP's boot context into its idle thread. Call once the CPU is
+ * online, with interrupts disabled; does not return.
+ */
+__attribute__((noreturn)) void sched_init_cpu(void);
+
+/**
+ * Currently running thread
+ *
+ * @return Thread, or NULL before sched_init() (on an AP, before sched_init_cpu())
+ */
+thread_t* thread_current(void);
+
+/**
+ * Give up the rest of the time slice
+ */
+void thread_yield(void);
+
+/**
+ * Terminate the calling thread
+ */
+__attribute__((noreturn)) void thread_exit(void);
+
+/**
+ * Block the calling thread until thread_unblock()
+ *
+ * Must be called with interrupts disabled, after publishing the thread
+ * somewhere its waker will find it; returns with interrupts disabled. Callers
+ * re-check their condition in a loop. Before sched_init() this just sleeps
+ * until the next interrupt.
+ */
+void thread_block(void);
+
+union spinlock;
+
+/**
+ * Block the calling thread and release a spinlock its waker takes first
+ *
+ * Like thread_block(), but the thread counts as blocked before the lock is
+ * released, so a waker on another CPU that takes the lock, finds the thread
+ * and calls thread_unblock() can't run in between and be lost. Called with
+ * interrupts disabled and the lock held; returns with interrupts disabled
+ * and the lock released.
+ *
+ * @param lock Spinlock held by the caller
+ */
+void thread_block_unlock(union spinlock* lock);
+
+/**
+ * Make a blocked thread runnable (safe from IRQ handlers)
+ *
+ * @param thread Thread to wake
+ */
+void thread_unblock(thread_t* thread);
+
+/**
+ * Make a blocked thread runnable with a temporary priority boost (safe from IRQ handlers)
+ *
+ * The thread runs boost levels above its base priority (never above
+ * SCHED_PRIO_HIGHEST) and loses one level per full time slice it uses
+ * afterwards. Used by input drivers so interactive threads preempt
+ * background work as soon as input arrives.
+ *
+ * @param thread Thread to wake
+ * @param boost Number of levels to raise it by
+ */
+void thread_unblock_boost(thread_t* thread, uint32_t boost);
+
+/**
+ * Change a thread's base priority (0 = highest, SCHED_PRIO_LOWEST = lowest)
+ *
+ * Drops any wakeup boost. New threads start at SCHED_PRIO_DEFAULT.
+ *
+ * @param thread Thread to change
+ * @param priority New priority, below SCHED_PRIO_LEVELS
+ * @return 0 on success, -1 if the priority is out of range
+ */
+int thread_set_priority(thread_t* thread, uint32_t priority);
+
+/**
+ * Account one timer tick to the running thread (called from IRQ 0, on the APs from LAPIC_TICK_VECTOR)
+ */
+void sched_tick(void);
+
+/**
+ * Switch threads if a reschedule is pending (called at the end of an IRQ)
+ */
+void sched_preempt(void);
+
+/**
+ * Disable preemption of the running thread
+ *
+ * Nests. Interrupts still arrive; only the switch at the end of an IRQ is
+ * deferred. The count is the running CPU's, so it also keeps the thread on
+ * this CPU: per-CPU data (heap magazines, the FPU) stays the thread's own.
+ * Other CPUs are not kept out; that takes a spinlock.
+ */
+void preempt_disable(void);
+
+/**
+ * Re-enable preemption, switching now if a reschedule became due meanwhile
+ */
+void preempt_enable(void);
+
+#endif
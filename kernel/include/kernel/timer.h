@@ -0,0 +1,156 @@
+#ifndef _KERNEL_TIMER_H
+#define _KERNEL_TIMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * System Timer (PIT channel 0, IRQ 0)
+ *
+ * The PIT raises IRQ 0 at a programmable rate and the handler counts ticks.
+ * If the CPU has a TSC, it is calibrated against the PIT at boot, and
+ * ktime_ns() interpolates between ticks with it. Without a TSC the clock has
+ * tick resolution. When the APIC delivers interrupts, the LAPIC timer is
+ * calibrated to the PIT's period and replaces it as the tick source.
+ *
+ * Timers (ktimer_t) run a function at the first tick at or past a deadline.
+ * They sit in a hierarchical wheel, so adding and deleting one is O(1) no
+ * matter how many are pending.
+ *
+ * Tickless idle: with the LAPIC timer and a TSC, the idle thread stops the
+ * tick and arms one interrupt for the next timer expiry (TSC-deadline mode if
+ * the CPU has it). The ticks in between are counted from the TSC when the CPU
+ * wakes, so timer_ticks() and ktime_ns() run on undisturbed.
+ */
+
+#define PIT_BASE_HZ             1193182     /* PIT input clock */
+#define TIMER_DEFAULT_HZ        1000        /* Tick rate used by the kernel */
+
+/* Tick statistics */
+typedef struct {
+    uint64_t ticks;             /* Ticks since timer_initialize(), skipped idle ticks included */
+    uint32_t hz;                /* Programmed tick rate (actual, after divisor rounding) */
+    uint64_t tsc_hz;            /* Calibrated TSC frequency, 0 if there is no TSC */
+    uint64_t min_gap_ns;        /* Shortest observed interval between ticks */
+    uint64_t max_gap_ns;        /* Longest observed interval between ticks (jitter, missed ticks) */
+    uint64_t tick_irqs;         /* IRQ 0 count; below ticks once the idle CPU stopped the tick */
+    uint64_t idle_stops;        /* Times the idle CPU stopped the tick */
+    uint32_t timers_pending;    /* Timers in the wheel */
+    bool tickless;              /* Tickless idle available */
+    bool tsc_deadline;          /* Stopped ticks end with a TSC-deadline interrupt */
+} timer_stats_t;
+
+/* A timer; embedded by its owner, set up with timer_setup() */
+typedef struct ktimer {
+    struct ktimer* next;        /* Wheel slot list */
+    struct ktimer** pprev;      /* Link pointing at this timer, NULL while not pending */
+    uint64_t expires;           /* Tick it is due at */
+    void (*func)(void* data);   /* Runs in the timer IRQ with interrupts disabled; must not sleep */
+    void* data;
+} ktimer_t;
+
+/**
+ * Program the PIT, register the IRQ 0 handler and calibrate the TSC
+ *
+ * Must be called after idt_init(): calibration counts ticks, so interrupts
+ * need to be enabled.
+ *
+ * @param hz Tick rate (19 Hz - 1193182 Hz)
+ */
+void timer_initialize(uint32_t hz);
+
+/**
+ * Start the scheduler tick on an application processor
+ *
+ * Its LAPIC timer fires at the rate of the boot CPU's, on a vector of its own:
+ * the ticks only account time slices, the clock and the timers stay with IRQ 0.
+ * Without a measured LAPIC timer rate the CPU gets no ticks, and its threads
+ * only switch when they block, yield or are woken.
+ */
+void timer_init_cpu(void);
+
+/**
+ * Number of timer ticks since timer_initialize()
+ *
+ * @return Tick count
+ */
+uint64_t timer_ticks(void);
+
+/**
+ * Monotonic clock
+ *
+ * @return Nanoseconds since timer_initialize()
+ */
+uint64_t ktime_ns(void);
+
+/**
+ * Sleep for at least the given time
+ *
+ * The calling thread sleeps and other threads run; the timer IRQ wakes it at
+ * the first tick past the deadline. Before sched_init() the CPU halts instead.
+ *
+ * @param ms Milliseconds to sleep
+ */
+void ksleep(uint32_t ms);
+
+/**
+ * Prepare a timer (not pending)
+ *
+ * @param timer Timer
+ * @param func Called once the timer expires, in the timer IRQ
+ * @param data Passed to func
+ */
+void timer_setup(ktimer_t* timer, void (*func)(void* data), void* data);
+
+/**
+ * Start a timer, or move it if it is pending already
+ *
+ * The timer fires at the first tick at or past the deadline; a deadline that
+ * passed fires at the next tick. func may add its timer again.
+ *
+ * @param timer Timer set up with timer_setup()
+ * @param deadline_ns Absolute time on the ktime_ns() clock
+ */
+void timer_add(ktimer_t* timer, uint64_t deadline_ns);
+
+/**
+ * Stop a timer
+ *
+ * The function may still be running on the CPU that takes the tick.
+ *
+ * @param timer Timer
+ * @return true if it was pending, false if it had fired or was never added
+ */
+bool timer_del(ktimer_t* timer);
+
+/**
+ * Check whether a timer is waiting to fire
+ */
+static inline bool timer_pending(const ktimer_t* timer) {
+    return __atomic_load_n(&timer->pprev, __ATOMIC_ACQUIRE) != NULL;
+}
+
+/**
+ * Stop the tick until the next timer expiry (idle thread, interrupts disabled)
+ *
+ * Call right before halting. Does nothing without tickless idle, on other
+ * CPUs than the boot CPU, or if the next timer is due at the next tick.
+ */
+void timer_idle_enter(void);
+
+/**
+ * Bring the clock up to date after the CPU woke from a stopped tick (irq_handler(), interrupts disabled)
+ *
+ * Called for every IRQ but the timer's own; cheap if the tick runs.
+ */
+void timer_irq_enter(void);
+
+/**
+ * Get tick statistics
+ *
+ * @param stats Filled with the current statistics
+ */
+void timer_get_stats(timer_stats_t* stats);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef _KERNEL_TRACE_H
+#define _KERNEL_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Static Tracepoints (ftrace-lite)
+ *
+ *   TRACE(KMALLOC, size, ptr);
+ *
+ * appends a fixed-size binary record (timestamp, thread, event, two values)
+ * to a ring buffer. Disabled, a tracepoint is one load and a not-taken
+ * branch; enabled, it is an xadd to claim a slot, rdtsc and a few stores, no
+ * locks and no formatting. Records are rendered later, when trace_dump()
+ * writes them to a serial port.
+ *
+ * Tracepoints may fire in IRQ handlers that interrupt another tracepoint;
+ * claiming the slot is a single instruction, so both get their own record.
+ * A record is complete once its seq matches its slot, and the dump skips
+ * the ones that aren't (overwritten or still being written).
+ */
+
+#define TRACE_RING_SIZE     8192        /* Records kept (power of two) */
+
+/* Events; keep trace_event_names[] in trace.c in sync */
+typedef enum {
+    TRACE_IRQ,                          /* a = IRQ line, b = interrupted EIP */
+    TRACE_SYSCALL,                      /* a = system call number, b = first argument */
+    TRACE_PAGE_FAULT,                   /* a = faulting address, b = error code */
+    TRACE_SCHED_SWITCH,                 /* a = previous thread ID, b = next thread ID */
+    TRACE_KMALLOC,                      /* a = size, b = pointer (0 on failure) */
+    TRACE_KFREE,                        /* a = pointer */
+    TRACE_MARK,                         /* Free for ad hoc instrumentation */
+    TRACE_EVENT_COUNT,
+} trace_event_t;
+
+typedef struct {
+    uint64_t time;                      /* TSC, or timer ticks without a TSC */
+    uint32_t seq;                       /* Slot number + 1 once the record is complete */
+    uint16_t event;                     /* trace_event_t */
+    uint16_t thread;                    /* ID of the running thread */
+    uint32_t a;
+    uint32_t b;
+} trace_record_t;
+
+/* Checked by every tracepoint; set by trace_start()/trace_stop() */
+extern volatile bool trace_enabled;
+
+/**
+ * Record an event if tracing is on
+ */
+#define TRACE(event, a, b) do { \
+        if (__builtin_expect(trace_enabled, 0)) { \
+            trace_record(TRACE_##event, (uint32_t) (a), (uint32_t) (b)); \
+        } \
+    } while (0)
+
+/**
+ * Append a record (use TRACE())
+ */
+void trace_record(trace_event_t event, uint32_t a, uint32_t b);
+
+/**
+ * Start tracing, discarding earlier records
+ *
+ * @return 0 on success, -1 if the ring could not be allocated
+ */
+int trace_start(void);
+
+/**
+ * Stop tracing; the records stay until the next trace_start()
+ */
+void trace_stop(void);
+
+/**
+ * Copy the complete records, oldest first
+ *
+ * @param out Destination
+ * @param max Capacity of out
+ * @return Number of records copied
+ */
+size_t trace_read(trace_record_t* out, size_t max);
+
+/**
+ * Visit the complete records in place, oldest first
+ *
+ * Needs no memory, so it works in a crash; stop tracing first (trace_stop())
+ * or records may be overwritten while they are visited.
+ *
+ * @param visit Called with each record
+ * @param ctx Passed to visit
+ * @param max Most records to visit
+ * @return Number of records visited
+ */
+size_t trace_walk(void (*visit)(const trace_record_t* rec, void* ctx), void* ctx, size_t max);
+
+/**
+ * Name of an event
+ */
+const char* trace_event_name(uint32_t event);
+
+/**
+ * Write the records as text to a serial port, oldest first
+ *
+ * One line per record: time since the first record in microseconds, thread,
+ * event and values. Tracing is paused meanwhile.
+ *
+ * @param port Serial port base (SERIAL_COM1_BASE, ...)
+ */
+void trace_dump(uint16_t port);
+
+#endif
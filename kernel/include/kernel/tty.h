@@ -1,6 +1,8 @@
 #ifndef _KERNEL_TTY_H
 #define _KERNEL_TTY_H
 
+#include <stdint.h>
+
 /**
  * Initializes the terminal interface
  *
@@ -9,6 +11,13 @@
  */
 void terminal_initialize(void);
 
+/**
+ * Sets the terminal color
+ *
+ * @param color Combined color attribute byte (foreground and background)
+ */
+void terminal_setcolor(uint8_t color);
+
 /**
  * Writes a character to the terminal at current cursor position
  *
@@ -30,6 +39,15 @@ void terminal_putchar(char c);
  */
 void terminal_write(const char* data, size_t size);
 
+/**
+ * Scroll the view through the scrollback history
+ *
+ * The next output returns the view to the live screen.
+ *
+ * @param lines Lines to move (positive = back in history, negative = towards the live screen)
+ */
+void terminal_scroll_view(int lines);
+
 /**
  * Writes a null-terminated string to the terminal
  *
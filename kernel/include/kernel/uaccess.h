@@ -0,0 +1,62 @@
+#ifndef _KERNEL_UACCESS_H
+#define _KERNEL_UACCESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/paging.h>
+
+/**
+ * User Memory Access
+ *
+ * A process may only hand the kernel addresses inside its own user range
+ * [USER_SPACE_START, USER_SPACE_END). Checking a buffer is one range
+ * compare; pages that aren't present are faulted in (or the process killed)
+ * by the page fault handler during the copy.
+ *
+ * Kernel threads have no user range and may pass any kernel buffer.
+ */
+
+/**
+ * Check that [addr, addr + len) lies inside the user range
+ *
+ * @param addr Start address
+ * @param len Length in bytes
+ * @return true if the whole range is user memory
+ */
+static inline bool access_ok(uint32_t addr, size_t len) {
+    return addr >= USER_SPACE_START && len <= USER_SPACE_END - addr;
+}
+
+/**
+ * Copy from a user buffer into kernel memory
+ *
+ * @param dst Kernel destination
+ * @param src User source (checked with access_ok() when called for a process)
+ * @param len Bytes to copy
+ * @return 0 on success, -1 if the source is not the caller's memory
+ */
+int copy_from_user(void* dst, const void* src, size_t len);
+
+/**
+ * Copy from kernel memory into a user buffer
+ *
+ * @param dst User destination (checked with access_ok() when called for a process)
+ * @param src Kernel source
+ * @param len Bytes to copy
+ * @return 0 on success, -1 if the destination is not the caller's memory
+ */
+int copy_to_user(void* dst, const void* src, size_t len);
+
+/**
+ * Copy a NUL-terminated string from user memory
+ *
+ * @param dst Kernel destination of size bytes
+ * @param src User string (checked with access_ok() when called for a process)
+ * @param size Room in dst, terminator included
+ * @return Length of the string, or -1 if it isn't the caller's memory or doesn't fit
+ */
+int32_t strncpy_from_user(char* dst, const char* src, size_t size);
+
+#endif
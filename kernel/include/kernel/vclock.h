@@ -0,0 +1,55 @@
+#ifndef _KERNEL_VCLOCK_H
+#define _KERNEL_VCLOCK_H
+
+#include <stdint.h>
+
+/**
+ * User-Mapped Clock Page (vDSO style)
+ *
+ * The timer keeps its clock state in one page-aligned page, and every
+ * process gets that page mapped read-only at USER_VCLOCK_BASE. User space
+ * reads the time from it without entering the kernel:
+ *
+ *   do {
+ *       seq = page->seq                      odd: the IRQ handler is updating
+ *       base = page->tick_time, at = page->tick_tsc
+ *   } while ((seq & 1) || seq != page->seq)
+ *   ns = base + min((rdtsc() - at) * tsc_ns_mult >> tsc_ns_shift, tick_ns)
+ *
+ * This is the same computation as ktime_ns(), so both clocks agree. Without
+ * VCLOCK_TSC the clock has tick resolution (ns = tick_time).
+ *
+ * The layout is ABI: libc mirrors it in <time.h>. Only add fields at the end.
+ */
+
+#define VCLOCK_VERSION          1
+
+/* flags */
+#define VCLOCK_TSC              0x1     /* tsc_ns_mult is calibrated, interpolate with rdtsc */
+
+typedef struct {
+    volatile uint32_t seq;              /* Odd while the timer IRQ updates the fields below */
+    uint32_t version;                   /* VCLOCK_VERSION */
+    volatile uint64_t ticks;            /* Timer ticks since timer_initialize() */
+    volatile uint64_t tick_tsc;         /* TSC at the last tick */
+    volatile uint64_t tick_time;        /* ns since timer_initialize() at the last tick */
+    uint64_t tsc_ns_mult;               /* ns = cycles * tsc_ns_mult >> tsc_ns_shift */
+    uint32_t tsc_ns_shift;
+    uint32_t tick_ns;                   /* Length of one tick in ns (caps the interpolation) */
+    uint64_t tsc_hz;                    /* Calibrated TSC frequency, 0 without a TSC */
+    uint32_t hz;                        /* Tick rate */
+    volatile uint32_t flags;            /* VCLOCK_* */
+} vclock_t;
+
+/**
+ * Map the clock page read-only at USER_VCLOCK_BASE in the current address space
+ *
+ * Called by a process's thread before it enters ring 3. The page is shared by
+ * all processes; each mapping holds a frame reference, so tearing down a
+ * directory never frees it.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int vclock_map(void);
+
+#endif
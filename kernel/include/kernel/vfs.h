@@ -0,0 +1,202 @@
+#ifndef _KERNEL_VFS_H
+#define _KERNEL_VFS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/sync.h>
+
+/**
+ * Virtual File System
+ *
+ * A filesystem hands the VFS inodes (one per file or directory) with a table
+ * of operations. The VFS names them with dentries, one per path component,
+ * kept in a hash table keyed by (parent dentry, name):
+ *
+ *   vfs_lookup("/bin/hello")
+ *     → dcache (root, "bin")   hit? → its dentry : fs lookup() → new dentry
+ *     → dcache (bin, "hello")  ...
+ *
+ * So each component costs one hash probe once it has been seen, and the
+ * filesystem's own (possibly slow) lookup runs only the first time. Names
+ * that don't exist are cached too, as negative dentries, so repeated misses
+ * are cheap as well.
+ *
+ * Open files are file_t objects; a process refers to them through its file
+ * descriptor table (fd 0-2 are the console and never in the table). A
+ * forked child shares its parent's open files, offsets included.
+ *
+ * Filesystems are read-only for now, and there is a single mount: the root.
+ */
+
+#define VFS_NAME_MAX            64      /* Longest path component, terminator included */
+#define VFS_PATH_MAX            256     /* Longest path a system call accepts, terminator included */
+#define VFS_DCACHE_BUCKETS      256     /* Hash buckets of the dentry cache (power of two) */
+#define VFS_NEGATIVE_MAX        256     /* Negative dentries kept at most */
+#define VFS_FD_MAX              16      /* File descriptors per process, 0-2 included */
+#define VFS_FD_FIRST            3       /* Lowest descriptor open() returns */
+
+#define VFS_TYPE_FILE           1
+#define VFS_TYPE_DIR            2
+
+/* open() flags (Linux i386 values) */
+#define VFS_O_RDONLY            0x0
+#define VFS_O_WRONLY            0x1
+#define VFS_O_RDWR              0x2
+#define VFS_O_ACCMODE           0x3
+
+/* lseek() origins */
+#define VFS_SEEK_SET            0
+#define VFS_SEEK_CUR            1
+#define VFS_SEEK_END            2
+
+struct inode;
+
+/* What a filesystem implements; NULL entries are unsupported */
+typedef struct {
+    /* Child of a directory by name (not terminated), or NULL; must not sleep (runs under the dcache lock) */
+    struct inode* (*lookup)(struct inode* dir, const char* name, size_t len);
+    /* Read up to count bytes at offset (offset < size); bytes read, -1 on error */
+    int32_t (*read)(struct inode* inode, uint32_t offset, void* buf, size_t count);
+    /* Name of the index-th entry of a directory; 0, or -1 past the last one */
+    int (*readdir)(struct inode* dir, uint32_t index, char* name, size_t size);
+    /* Contents resident in memory: their address, the physical one in *phys; NULL if not */
+    const void* (*memory)(struct inode* inode, uint32_t* phys);
+} inode_ops_t;
+
+typedef struct inode {
+    uint32_t ino;                       /* Number, unique within its filesystem */
+    uint32_t type;                      /* VFS_TYPE_* */
+    uint32_t size;                      /* Bytes (files) */
+    const inode_ops_t* ops;
+    void* priv;                         /* Filesystem's own data */
+} inode_t;
+
+typedef struct dentry {
+    char name[VFS_NAME_MAX];
+    uint32_t hash;                      /* Of (parent, name) */
+    struct dentry* parent;              /* The root is its own parent */
+    inode_t* inode;                     /* NULL: negative, the name doesn't exist */
+    struct dentry* hash_next;           /* Bucket chain */
+} dentry_t;
+
+typedef struct file {
+    dentry_t* dentry;
+    inode_t* inode;
+    uint32_t offset;
+    uint32_t flags;                     /* VFS_O_* */
+    uint32_t refs;                      /* Descriptors referring to it */
+    mutex_t lock;                       /* Serializes reads and seeks (they move offset) */
+} file_t;
+
+/* Dentry cache statistics */
+typedef struct {
+    uint32_t lookups;                   /* Path components looked up */
+    uint32_t hits;                      /* Found in the cache */
+    uint32_t misses;                    /* Asked the filesystem */
+    uint32_t dentries;                  /* Dentries cached, negative ones included */
+    uint32_t negative;
+} vfs_stats_t;
+
+/**
+ * Make a directory inode the root of the namespace
+ *
+ * Replaces a previous root; dentries of the old one stay valid but are no
+ * longer reachable by path.
+ *
+ * @param root Directory inode of the filesystem to mount
+ * @return 0 on success, -1 if it isn't a directory or out of memory
+ */
+int vfs_mount_root(inode_t* root);
+
+/**
+ * Find the dentry of a path
+ *
+ * Paths are taken from the root ("bin/x" is "/bin/x"); "." and ".." work,
+ * repeated slashes are ignored.
+ *
+ * @param path Path
+ * @return Positive dentry, or NULL if the path doesn't exist
+ */
+dentry_t* vfs_lookup(const char* path);
+
+/**
+ * Open a file or directory
+ *
+ * @param path Path
+ * @param flags VFS_O_RDONLY (the filesystems are read-only)
+ * @return Open file, or NULL if it doesn't exist or flags ask for writing
+ */
+file_t* vfs_open(const char* path, uint32_t flags);
+
+/**
+ * Read from the current offset and advance it
+ *
+ * @return Bytes read (0 at the end of the file), -1 for directories or errors
+ */
+int32_t vfs_read(file_t* file, void* buf, size_t count);
+
+/**
+ * Move the offset of an open file
+ *
+ * @param offset Distance from whence
+ * @param whence VFS_SEEK_SET, VFS_SEEK_CUR or VFS_SEEK_END
+ * @return New offset, or -1 if it would be negative or whence is invalid
+ */
+int32_t vfs_lseek(file_t* file, int32_t offset, int whence);
+
+/**
+ * Name of the index-th entry of an open directory
+ *
+ * @return 0, or -1 past the last entry (or if file isn't a directory)
+ */
+int vfs_readdir(file_t* file, uint32_t index, char* name, size_t size);
+
+/**
+ * Take another reference to an open file
+ */
+file_t* vfs_dup(file_t* file);
+
+/**
+ * Drop a reference to an open file; the last one frees it
+ */
+void vfs_close(file_t* file);
+
+/**
+ * Install an open file in the caller's descriptor table
+ *
+ * @return File descriptor (>= VFS_FD_FIRST), or -1 if the table is full
+ */
+int vfs_fd_install(file_t* file);
+
+/**
+ * Open file behind a descriptor of the caller
+ *
+ * @return File, or NULL if fd isn't open
+ */
+file_t* vfs_fd_get(int fd);
+
+/**
+ * Close a descriptor of the caller
+ *
+ * @return 0, or -1 if fd isn't open
+ */
+int vfs_fd_close(int fd);
+
+/**
+ * Give a descriptor table references to every file of another (fork)
+ */
+void vfs_fd_copy(file_t** dst, file_t* const* src);
+
+/**
+ * Close every descriptor of a table (process exit)
+ */
+void vfs_fd_close_all(file_t** table);
+
+/**
+ * Get dentry cache statistics
+ */
+void vfs_get_stats(vfs_stats_t* stats);
+
+#endif
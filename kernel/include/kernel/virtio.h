@@ -0,0 +1,176 @@
+#ifndef _KERNEL_VIRTIO_H
+#define _KERNEL_VIRTIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/pci.h>
+
+/**
+ * Virtio over PCI (Legacy Interface) and Split Virtqueues
+ *
+ * A legacy virtio function has vendor 0x1AF4 and its registers in the I/O
+ * BAR0. The driver brings it up in a fixed order:
+ *
+ *   reset (status 0) → ACKNOWLEDGE → DRIVER → read host features, write the
+ *   accepted ones → per queue: select, read its size, give the page frame
+ *   number of the rings → DRIVER_OK
+ *
+ * A split virtqueue is three rings in physically contiguous memory:
+ *
+ *   desc[size]   buffers: physical address, length, device-writable flag
+ *   avail        driver → device: heads of descriptor chains, idx++ per buffer
+ *   used         device → driver: (head, bytes written), idx++ per buffer
+ *
+ * Here every buffer is a single descriptor, so a queue carries up to size
+ * buffers. The driver writes the queue number to QUEUE_NOTIFY after adding
+ * buffers unless the device set VRING_USED_F_NO_NOTIFY (it's already
+ * looking); the device interrupts after using buffers unless the driver set
+ * VRING_AVAIL_F_NO_INTERRUPT (it's polling). Reading ISR acknowledges the
+ * interrupt.
+ *
+ * Reference: Virtual I/O Device (VIRTIO) Version 1.1, 2.6 and 4.1.4.8 (legacy interface)
+ */
+
+#define VIRTIO_PCI_VENDOR               0x1AF4
+
+/* Legacy I/O registers */
+#define VIRTIO_PCI_HOST_FEATURES        0x00
+#define VIRTIO_PCI_GUEST_FEATURES       0x04
+#define VIRTIO_PCI_QUEUE_PFN            0x08
+#define VIRTIO_PCI_QUEUE_SIZE           0x0C
+#define VIRTIO_PCI_QUEUE_SEL            0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY         0x10
+#define VIRTIO_PCI_STATUS               0x12
+#define VIRTIO_PCI_ISR                  0x13
+#define VIRTIO_PCI_CONFIG               0x14    /* Device-specific configuration (without MSI-X) */
+
+/* VIRTIO_PCI_STATUS */
+#define VIRTIO_STATUS_ACKNOWLEDGE       0x01
+#define VIRTIO_STATUS_DRIVER            0x02
+#define VIRTIO_STATUS_DRIVER_OK         0x04
+#define VIRTIO_STATUS_FAILED            0x80
+
+/* VIRTIO_PCI_ISR */
+#define VIRTIO_ISR_QUEUE                0x01    /* A queue has used buffers */
+#define VIRTIO_ISR_CONFIG               0x02    /* The configuration changed */
+
+#define VRING_DESC_F_WRITE              0x2     /* Device writes the buffer (receive) */
+#define VRING_AVAIL_F_NO_INTERRUPT      0x1
+#define VRING_USED_F_NO_NOTIFY          0x1
+#define VIRTQUEUE_ALIGN                 4096    /* Legacy: the used ring starts on a page */
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) vring_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed)) vring_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) vring_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];
+} __attribute__((packed)) vring_used_t;
+
+typedef struct {
+    uint16_t io;                        /* BAR0 ports */
+    uint8_t irq;
+    uint32_t features;                  /* Negotiated */
+} virtio_device_t;
+
+typedef struct {
+    virtio_device_t* vdev;
+    uint16_t index;
+    uint16_t size;                      /* Descriptors, set by the device */
+    vring_desc_t* desc;
+    volatile vring_avail_t* avail;
+    volatile vring_used_t* used;
+    uint16_t free_head;                 /* Free descriptors, chained through next */
+    uint16_t num_free;
+    uint16_t last_used;                 /* used->idx seen so far */
+    void** cookies;                     /* Per descriptor: what virtqueue_get() returns */
+} virtqueue_t;
+
+/**
+ * Reset a legacy virtio function and announce the driver
+ *
+ * @return 0 on success, -1 if BAR0 isn't an I/O range
+ */
+int virtio_pci_init(const pci_device_t* pci, virtio_device_t* vdev);
+
+/**
+ * Accept the features both sides support
+ *
+ * @return The negotiated features
+ */
+uint32_t virtio_negotiate(virtio_device_t* vdev, uint32_t wanted);
+
+/**
+ * Allocate a queue's rings and hand them to the device
+ *
+ * @return 0 on success, -1 if the queue doesn't exist or there's no memory
+ */
+int virtqueue_init(virtio_device_t* vdev, virtqueue_t* vq, uint16_t index);
+
+/**
+ * Tell the device the driver is ready; queues run from here on
+ */
+void virtio_driver_ok(virtio_device_t* vdev);
+
+/**
+ * Read and acknowledge the interrupt status (VIRTIO_ISR_*)
+ */
+uint8_t virtio_isr(virtio_device_t* vdev);
+
+/**
+ * Read a byte of the device-specific configuration
+ */
+uint8_t virtio_config_read8(virtio_device_t* vdev, uint32_t offset);
+
+/**
+ * Offer a buffer to the device (caller serializes access to the queue)
+ *
+ * @param writable true if the device fills it, false if it reads it
+ * @param cookie Returned by virtqueue_get() once the device used the buffer
+ * @return 0 on success, -1 if the queue is full
+ */
+int virtqueue_add(virtqueue_t* vq, uint32_t phys, uint32_t len, bool writable, void* cookie);
+
+/**
+ * Notify the device of new buffers, unless it asked not to be
+ */
+void virtqueue_kick(virtqueue_t* vq);
+
+/**
+ * Take the next buffer the device used
+ *
+ * @param len Set to the bytes the device wrote
+ * @return Its cookie, or NULL if none is waiting
+ */
+void* virtqueue_get(virtqueue_t* vq, uint32_t* len);
+
+/**
+ * Ask the device not to interrupt for this queue
+ */
+void virtqueue_disable_irq(virtqueue_t* vq);
+
+/**
+ * Let the device interrupt for this queue again
+ *
+ * @return true if buffers were used meanwhile (no interrupt will come for them)
+ */
+bool virtqueue_enable_irq(virtqueue_t* vq);
+
+#endif
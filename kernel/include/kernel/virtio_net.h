@@ -0,0 +1,57 @@
+#ifndef _KERNEL_VIRTIO_NET_H
+#define _KERNEL_VIRTIO_NET_H
+
+#include <stdint.h>
+
+#include <kernel/net.h>
+
+/**
+ * Virtio Network Driver
+ *
+ * Each virtio-net function becomes a network device (eth0, ...) with one
+ * receive and one transmit queue. Receive buffers are netbufs posted to the
+ * device ahead of time; frames arrive in them and go up the stack as they
+ * are.
+ *
+ * Interrupts are only the trigger for polling (like Linux NAPI):
+ *
+ *   IRQ → read ISR (acknowledges) → receive interrupts off → poll tasklet
+ *   poll → up to VIRTIO_NET_BUDGET frames → net_receive() each
+ *        → repost buffers, one notify for all of them
+ *        → budget used up?  stay in polling mode, run again (ksoftirqd under load)
+ *        → else interrupts back on, and poll again if frames slipped in meanwhile
+ *
+ * Under load a single interrupt is followed by any number of polls, so the
+ * rate of interrupts no longer follows the rate of packets. Transmit never
+ * interrupts: sent buffers are reclaimed by the next transmit or poll, and
+ * the device suppresses notifications while it's still working through the
+ * queue.
+ */
+
+#define VIRTIO_NET_BUDGET       64      /* Frames per poll before yielding to other tasklets */
+#define VIRTIO_NET_RX_POSTED    128     /* Receive buffers kept posted per device (at most the queue size) */
+#define VIRTIO_NET_MAX_DEVICES  4
+
+typedef struct {
+    uint64_t interrupts;                /* Interrupts for this device */
+    uint64_t polls;                     /* Poll runs */
+    uint64_t polls_exhausted;           /* ... that used up the budget and stayed in polling mode */
+    uint64_t rx_refill_failed;          /* Polls that found the netbuf pool empty */
+    uint32_t rx_posted;                 /* Receive buffers the device holds now */
+} virtio_net_stats_t;
+
+/**
+ * Find virtio-net functions and register them as network devices (initcall, after net_init())
+ *
+ * @return 0, with or without devices
+ */
+int virtio_net_init(void);
+
+/**
+ * Get the driver's counters for a device
+ *
+ * @return 0 on success, -1 if dev isn't a virtio-net device
+ */
+int virtio_net_get_stats(net_device_t* dev, virtio_net_stats_t* stats);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef KERNEL_VMM_H
+#define KERNEL_VMM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Virtual Memory Regions with Demand Paging
+ *
+ * A reserved region has no frames behind it. The first access to each page
+ * faults, and the page fault handler allocates a frame, zeroes it and maps it
+ * with the region's flags. Only touched pages cost physical memory.
+ */
+
+/* Maximum number of reserved regions */
+#define VMM_MAX_REGIONS     32
+
+/**
+ * Reserve a virtual region to be backed lazily with zero-filled frames
+ *
+ * The region must not overlap the kernel identity map, the page table
+ * window or another reservation.
+ *
+ * @param start Start address (page-aligned)
+ * @param len Length in bytes (rounded up to whole pages)
+ * @param flags PTE flags for the pages (PTE_WRITABLE, PTE_USER)
+ * @return 0 on success, -1 on failure
+ */
+int vmm_reserve(uint32_t start, size_t len, uint32_t flags);
+
+/**
+ * Release a reserved region, unmapping and freeing the pages that were touched
+ *
+ * @param start Start address the region was reserved with
+ * @return 0 on success, -1 if no region starts there
+ */
+int vmm_release(uint32_t start);
+
+/**
+ * Resolve a not-present page fault inside a reserved region
+ *
+ * Called by the page fault handler.
+ *
+ * @param fault_addr Faulting address (CR2)
+ * @param user_mode True if the access came from ring 3
+ * @return 0 if the page was mapped, -1 if the fault is not ours to handle
+ */
+int vmm_handle_fault(uint32_t fault_addr, bool user_mode);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _KERNEL_VMSTAT_H
+#define _KERNEL_VMSTAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+
+/**
+ * Memory Statistics
+ *
+ * One snapshot of every memory counter, for finding leaks and fragmentation
+ * in a system that has been up for a while:
+ *
+ *   frame_get_stats()    frames reserved, free, used, zeroed; free blocks per order, largest free run
+ *   pcache_get_stats()   frames holding cached file pages
+ *   kheap_get_info()     heap blocks and slab objects, plus kheap_largest_free()
+ *   kheap_get_sites()    optional: live heap memory per kmalloc() call site
+ *
+ * The shell's "vmstat" command prints them, with call sites resolved through
+ * the symbol index (kernel/debug.h). Comparing two snapshots over time shows
+ * the trend: free shrinking while largest_free_run stays small is
+ * fragmentation, one site's live bytes growing without bound is a leak.
+ */
+
+#define VMSTAT_SITES_TOP        10      /* Call sites "vmstat sites" shows by default */
+
+typedef struct {
+    frame_stats_t frames;
+    uint32_t cached;                    /* Frames holding page cache pages (part of frames.used) */
+    uint32_t cached_dirty;              /* ... of which not written back yet */
+    kheap_info_t heap;
+    uint32_t heap_largest_free;         /* Longest run of free heap blocks */
+} vmstat_t;
+
+/**
+ * Take a snapshot of the memory counters
+ *
+ * The sources are read one after the other, so while other threads allocate
+ * the numbers don't add up exactly.
+ *
+ * @param stats Filled with the snapshot
+ */
+void vmstat_get(vmstat_t* stats);
+
+/**
+ * Print the memory counters on the console
+ */
+void vmstat_print(void);
+
+/**
+ * Print the call sites with the most live heap memory
+ *
+ * @param top Number of sites to show (at most KHEAP_SITES + 1)
+ */
+void vmstat_print_sites(size_t top);
+
+#endif
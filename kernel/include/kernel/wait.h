@@ -0,0 +1,138 @@
+#ifndef _KERNEL_WAIT_H
+#define _KERNEL_WAIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel/thread.h>
+#include <kernel/spinlock.h>
+
+/**
+ * Wait Queues
+ *
+ * A wait queue is the list of threads sleeping until some event happens. The
+ * code that produces the event (usually an IRQ handler) calls wake_up() on
+ * that queue only, so a sleeper runs again when its data is there and not on
+ * every unrelated interrupt.
+ *
+ *   reader: wait_event(&wq, ring_not_empty)   → sleeps in wq
+ *   IRQ:    put byte in ring; wake_up(&wq)     → reader READY
+ *   reader: re-checks ring_not_empty, returns
+ *
+ * The condition is checked again under the queue's lock before sleeping, and
+ * wake_up() takes the same lock, so a wake_up() between the check and the
+ * sleep can't be lost, whichever CPU it runs on.
+ */
+
+typedef struct {
+    spinlock_t lock;            /* Guards the list, and the waiter's condition check */
+    thread_t* head;             /* First sleeper (woken first) */
+    thread_t* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT     { SPINLOCK_INIT, NULL, NULL }
+
+/**
+ * Sleep until condition is true
+ *
+ * condition is evaluated repeatedly and must be cheap and side-effect free.
+ * Before sched_init() this halts until an interrupt instead of sleeping.
+ *
+ * @param wq Wait queue the event's producer wakes
+ * @param condition Expression to wait for
+ */
+#define wait_event(wq, condition)                       \
+    do {                                                \
+        while (!(condition)) {                          \
+            uint32_t __wait_flags = wait_begin(wq);     \
+            if (!(condition)) {                         \
+                wait_sleep(wq);                         \
+            }                                           \
+            wait_end(wq, __wait_flags);                 \
+        }                                               \
+    } while (0)
+
+/**
+ * Initialize an empty wait queue
+ *
+ * @param wq Wait queue
+ */
+void wait_queue_init(wait_queue_t* wq);
+
+/**
+ * Check if any thread sleeps in a wait queue
+ *
+ * @param wq Wait queue
+ * @return true if at least one thread is queued
+ */
+bool wait_queue_active(const wait_queue_t* wq);
+
+/**
+ * Lock a wait queue (interrupts disabled) for a check-then-sleep sequence
+ *
+ * State the waiters test should only change while this lock is held, or be
+ * followed by a wake_up() on the queue.
+ *
+ * @param wq Wait queue
+ * @return Saved EFLAGS for wait_end()
+ */
+uint32_t wait_begin(wait_queue_t* wq);
+
+/**
+ * Unlock a wait queue and restore interrupts after wait_begin()
+ *
+ * @param wq Wait queue
+ * @param flags Value returned by wait_begin()
+ */
+void wait_end(wait_queue_t* wq, uint32_t flags);
+
+/**
+ * Put the calling thread to sleep in a wait queue
+ *
+ * Call between wait_begin() and wait_end() after finding the condition false;
+ * the lock is dropped while asleep and held again on return, once woken
+ * (callers re-check their condition).
+ *
+ * @param wq Wait queue
+ */
+void wait_sleep(wait_queue_t* wq);
+
+/**
+ * Wake every sleeper of a queue locked with wait_begin()
+ *
+ * @param wq Wait queue
+ */
+void wake_up_locked(wait_queue_t* wq);
+
+/**
+ * Wake the longest sleeper of a queue locked with wait_begin()
+ *
+ * @param wq Wait queue
+ * @return true if a thread was woken
+ */
+bool wake_up_one_locked(wait_queue_t* wq);
+
+/**
+ * Wake every thread sleeping in a wait queue (safe from IRQ handlers)
+ *
+ * @param wq Wait queue
+ */
+void wake_up(wait_queue_t* wq);
+
+/**
+ * Wake the thread that has slept longest in a wait queue (safe from IRQ handlers)
+ *
+ * @param wq Wait queue
+ * @return true if a thread was woken
+ */
+bool wake_up_one(wait_queue_t* wq);
+
+/**
+ * Wake every sleeper with a priority boost (see thread_unblock_boost())
+ *
+ * @param wq Wait queue
+ * @param boost Priority levels to raise the woken threads by
+ */
+void wake_up_boost(wait_queue_t* wq, uint32_t boost);
+
+#endif
@@ -3,36 +3,163 @@
 #include <assert.h>
 
 #include <kernel/tty.h>
+#include <kernel/fbcon.h>
 #include <kernel/multiboot.h>
 #include <kernel/debug.h>
+#include <kernel/crashdump.h>
 #include <kernel/gdt.h>
 #include <kernel/interrupts.h>
 #include <kernel/keyboard.h>
+#include <kernel/serial.h>
+#include <kernel/timer.h>
 #include <kernel/paging.h>
 #include <kernel/kheap.h>
+#include <kernel/module.h>
+#include <kernel/thread.h>
+#include <kernel/fpu.h>
+#include <kernel/softirq.h>
+#include <kernel/apic.h>
+#include <kernel/smp.h>
 #include <kernel/shell.h>
+#include <kernel/klog.h>
+#include <kernel/initcall.h>
+#include <kernel/ktest.h>
+#include <kernel/initrd.h>
+#include <kernel/ata.h>
+#include <kernel/pcache.h>
+#include <kernel/net.h>
+#include <kernel/virtio_net.h>
 
-/**
- * Kernel entry point
- */
-void kernel_main(unsigned long magic, unsigned long addr) {
-    assert(magic == MULTIBOOT_BOOTLOADER_MAGIC && "Invalid bootloader magic");
+static multiboot_info_t* boot_mbi;
 
+/* Adapters from the init functions to initcall_t */
+static int boot_terminal(void) {
     terminal_initialize();
-    multiboot_info_t* mbi = (multiboot_info_t*) addr;
-    debug_initialize(mbi);
+    return 0;
+}
 
+static int boot_klog(void) {
+    klog_init();
+    return 0;
+}
+
+static int boot_debug(void) {
+    debug_initialize(boot_mbi);
+    return 0;
+}
+
+static int boot_crashdump(void) {
+    return crashdump_init(boot_mbi);
+}
+
+static int boot_gdt(void) {
     gdt_init();
+    return 0;
+}
+
+static int boot_idt(void) {
     idt_init();
-    paging_init();
+    return 0;
+}
+
+static int boot_paging(void) {
+    paging_init(boot_mbi);
+    return 0;
+}
+
+static int boot_module(void) {
+    module_init(boot_mbi);
+    return 0;
+}
+
+static int boot_kheap(void) {
     kheap_init();
+    return 0;
+}
+
+static int boot_fbcon(void) {
+    /* -1: no usable framebuffer, the console stays in VGA text mode */
+    fbcon_init(boot_mbi);
+    return 0;
+}
+
+static int boot_sched(void) {
+    sched_init();
+    return 0;
+}
+
+static int boot_keyboard(void) {
     keyboard_initialize();
+    return 0;
+}
+
+static int boot_timer(void) {
+    timer_initialize(TIMER_DEFAULT_HZ);
+    return 0;
+}
+
+static int boot_smp(void) {
+    smp_init();
+    return 0;
+}
+
+static int boot_serial(void) {
+    serial_initialize(SERIAL_COM1_BASE, SERIAL_BAUD_115200);
+    return 0;
+}
+
+/*
+ * Init stages, in dependency order. The application processors just start
+ * taking threads as each comes online, so nothing waits for smp_init(): it
+ * sleeps through the INIT-SIPI-SIPI delays in a thread of its own while the
+ * shell comes up.
+ */
+static const initcall_t boot_initcalls[] = {
+    { "terminal_initialize", boot_terminal, 0 },
+    { "klog_init", boot_klog, 0 },
+    { "debug_initialize", boot_debug, 0 },
+    { "crashdump_init", boot_crashdump, 0 },
+    { "gdt_init", boot_gdt, 0 },
+    { "idt_init", boot_idt, 0 },
+    { "paging_init", boot_paging, 0 },
+    { "apic_init", apic_init, 0 },
+    { "module_init", boot_module, 0 },
+    { "kheap_init", boot_kheap, 0 },
+    { "fbcon_init", boot_fbcon, 0 },
+    { "initrd_init", initrd_init, 0 },
+    { "sched_init", boot_sched, 0 },
+    { "fpu_init", fpu_init, 0 },
+    { "softirq_init", softirq_init, 0 },
+    { "keyboard_initialize", boot_keyboard, 0 },
+    { "timer_initialize", boot_timer, 0 },
+    { "pcache_init", pcache_init, 0 },
+    { "net_init", net_init, 0 },
+    { "smp_init", boot_smp, INITCALL_PARALLEL },
+    { "ata_init", ata_init, INITCALL_DEFERRED },
+    { "virtio_net_init", virtio_net_init, INITCALL_DEFERRED },
+    { "serial_initialize", boot_serial, 0 },
+};
+
+/**
+ * Kernel entry point
+ */
+void kernel_main(unsigned long magic, unsigned long addr) {
+    assert(magic == MULTIBOOT_BOOTLOADER_MAGIC && "Invalid bootloader magic");
+
+    boot_mbi = (multiboot_info_t*) addr;
+    initcall_run(boot_initcalls, sizeof(boot_initcalls) / sizeof(boot_initcalls[0]));
+    initcall_start_deferred();
+    initcall_report();
+    /* "ktest=..." on the command line: run the in-kernel tests instead of the shell */
+    ktest_main(boot_mbi);
 
+    /* The boot messages that are still queued go before the banner */
+    klog_flush();
     printf("=======================================\n");
     printf("Welcome to Olympos\n");
     printf("An experimental 32-bit Operating System\n");
     printf("=======================================\n");
-    printf("Supported physical memory size: %d MiB\n", NUM_FRAMES * 4 / 1024);
+    printf("Supported physical memory size: %d MiB\n", frame_total() * 4 / 1024);
     printf("Reserved memory for the kernel: %d MiB\n", KMEM_MAX / 1024 / 1024);
     printf("\n");
 
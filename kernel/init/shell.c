@@ -9,35 +9,150 @@
 
 #include <stdio.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <string.h>
 
-#include <kernel/kheap.h>
+#include <kernel/arena.h>
 #include <kernel/tty.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+#include <kernel/keyboard.h>
+#include <kernel/kheap.h>
+#include <kernel/shell.h>
+#include <kernel/process.h>
+#include <kernel/vfs.h>
 
-#define SHELL_TOK_BUFSIZE   64          /* Max number of tokens per command */
-#define SHELL_RL_BUFSIZE    1024        /* Max characters per input line */
+#define SHELL_TOK_BUFSIZE   64          /* Initial number of tokens per command (grows as needed) */
+#define SHELL_RL_BUFSIZE    1024        /* Initial characters per input line (grows as needed) */
 #define SHELL_TOK_DELIM     " \t\r\n\a" /* Delimiters for tokenization */
+#define SHELL_ARENA_SIZE    4096        /* Per-command arena chunk (line + tokens fit in one) */
+#define SHELL_HISTORY       16          /* Previous lines Up/Down can recall */
+#define SHELL_HASH_SLOTS    256         /* Largest command hash table (a power of two) */
+#define SHELL_HASH_SEEDS    1024        /* Seeds tried for a collision-free table */
+#define SHELL_BIN_DIR       "/bin/"     /* Where plain command names are looked up as programs */
 
-/* Forward declarations for built-in command handlers */
-int shell_clear(char** args);
-int shell_help(char** args);
+/* Arena for everything a single command allocates; reset after each command */
+static arena_t shell_arena;
 
-/* Built-in command registry
- * To add a new command:
- * 1. Add command name to builtin_str[]
- * 2. Add function pointer to builtin_func[]
- * 3. Implement the handler function with signature: int cmd(char **args)
- */
-char* builtin_str[] = {"clear", "help"};
-int (*builtin_func[]) (char**) = {&shell_clear, &shell_help};
+/* Previous lines (kheap copies, they outlive the arena): line i is in slot i % SHELL_HISTORY */
+static char* shell_history[SHELL_HISTORY];
+static int shell_history_count = 0;
+
+/* Registered commands (see SHELL_COMMAND()), placed by the linker script */
+extern const shell_command_t __shell_commands_start[];
+extern const shell_command_t __shell_commands_end[];
+
+/* Name hash table, built on the first lookup: slot of each command, NULL if empty */
+static const shell_command_t* shell_table[SHELL_HASH_SLOTS];
+static uint32_t shell_table_mask;
+static uint32_t shell_table_seed;
+/* Every command has a slot of its own; otherwise the table is linearly probed */
+static bool shell_table_perfect;
+static bool shell_table_ready = false;
 
 /**
- * Returns the number of built-in commands
+ * Returns the number of registered commands
  *
- * @return Count of registered built-in commands
+ * @return Count of commands in the .shell_commands section
  */
 int shell_num_builtins() {
-    return sizeof(builtin_str) / sizeof(char *);
+    return (int) (__shell_commands_end - __shell_commands_start);
+}
+
+/**
+ * Hash a command name (FNV-1a, the seed mixed into the offset basis)
+ */
+static uint32_t shell_hash(const char* name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (; *name != '\0'; name++) {
+        hash = (hash ^ (uint8_t) *name) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Place every command with one seed
+ *
+ * @param probe Move on to the next free slot when one is taken, instead of failing
+ * @return true if every command got a slot
+ */
+static bool shell_table_fill(uint32_t seed, bool probe) {
+    bool placed = true;
+    memset(shell_table, 0, sizeof(shell_table));
+    for (const shell_command_t* cmd = __shell_commands_start; cmd < __shell_commands_end; cmd++) {
+        uint32_t slot = shell_hash(cmd->name, seed) & shell_table_mask;
+        uint32_t probes = 0;
+        while (shell_table[slot] != NULL && strcmp(shell_table[slot]->name, cmd->name) != 0) {
+            if (!probe) {
+                return false;
+            }
+            if (++probes > shell_table_mask) {
+                break;                      /* Table full */
+            }
+            slot = (slot + 1) & shell_table_mask;
+        }
+        /* A duplicate name keeps the command registered first */
+        if (shell_table[slot] == NULL) {
+            shell_table[slot] = cmd;
+        }
+        else if (probes > shell_table_mask) {
+            placed = false;
+        }
+    }
+    return placed;
+}
+
+/**
+ * Build the name hash table
+ *
+ * The table is the smallest power of two with twice as many slots as there
+ * are commands; seeds are tried until no two names share a slot.
+ */
+static void shell_table_build(void) {
+    uint32_t count = (uint32_t) shell_num_builtins();
+    uint32_t size = 2;
+    while (size < count * 2 && size < SHELL_HASH_SLOTS) {
+        size *= 2;
+    }
+    shell_table_mask = size - 1;
+    shell_table_perfect = false;
+    for (uint32_t seed = 0; seed < SHELL_HASH_SEEDS && count * 2 <= size; seed++) {
+        if (shell_table_fill(seed, false)) {
+            shell_table_seed = seed;
+            shell_table_perfect = true;
+            break;
+        }
+    }
+    if (!shell_table_perfect) {
+        shell_table_seed = 0;
+        if (!shell_table_fill(0, true)) {
+            klog(KLOG_ERR, "[FAILED] shell: More than %u commands, some are unreachable\n", SHELL_HASH_SLOTS);
+        }
+        else {
+            klog(KLOG_WARN, "shell: No collision-free hash for %u commands, probing\n", count);
+        }
+    }
+    shell_table_ready = true;
+}
+
+/**
+ * Find a registered command
+ */
+const shell_command_t* shell_find_command(const char* name) {
+    if (!shell_table_ready) {
+        shell_table_build();
+    }
+    uint32_t slot = shell_hash(name, shell_table_seed) & shell_table_mask;
+    for (uint32_t i = 0; i <= shell_table_mask && shell_table[slot] != NULL; i++) {
+        if (strcmp(shell_table[slot]->name, name) == 0) {
+            return shell_table[slot];
+        }
+        if (shell_table_perfect) {
+            break;                          /* The only command that could be here is another one */
+        }
+        slot = (slot + 1) & shell_table_mask;
+    }
+    return NULL;
 }
 
 /**
@@ -49,7 +164,7 @@ int shell_num_builtins() {
  * @param args Command arguments (unused)
  * @return 1 to continue shell loop
  */
-int shell_clear(char **args) {
+SHELL_COMMAND(clear, "clear the screen") {
     (void) args;  // Unused parameter
     terminal_initialize();
     return 1;
@@ -58,25 +173,109 @@ int shell_clear(char **args) {
 /**
  * Built-in command: help
  *
- * Displays a list of available built-in commands.
+ * Displays the registered commands in alphabetical order.
  *
  * @param args Command arguments (unused)
  * @return 1 to continue shell loop
  */
-int shell_help(char **args) {
+SHELL_COMMAND(help, "list the commands") {
     (void) args;  // Unused parameter
     printf("Available commands:\n");
+    /* Selection by name: each round prints the smallest one after the previous */
+    const shell_command_t* prev = NULL;
     for (int i = 0; i < shell_num_builtins(); i++) {
-        printf("  %s\n", builtin_str[i]);
+        const shell_command_t* next = NULL;
+        for (const shell_command_t* cmd = __shell_commands_start; cmd < __shell_commands_end; cmd++) {
+            if ((prev == NULL || strcmp(cmd->name, prev->name) > 0) &&
+                (next == NULL || strcmp(cmd->name, next->name) < 0)) {
+                next = cmd;
+            }
+        }
+        if (next == NULL) {
+            break;                          /* Only duplicates are left */
+        }
+        printf("  %s - %s\n", next->name, next->help);
+        prev = next;
+    }
+    printf("Anything else runs as a program from %s\n", SHELL_BIN_DIR);
+    return 1;
+}
+
+/**
+ * Built-in command: uptime
+ *
+ * Prints the time since boot and the timer tick statistics.
+ *
+ * @param args Command arguments (unused)
+ * @return 1 to continue shell loop
+ */
+SHELL_COMMAND(uptime, "time since boot and timer statistics") {
+    (void) args;  // Unused parameter
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    printf("Up %u ms, %u ticks at %u Hz\n", (uint32_t) (ktime_ns() / 1000000), (uint32_t) stats.ticks, stats.hz);
+    if (stats.tsc_hz) {
+        printf("TSC %u MHz, tick interval %u - %u us\n", (uint32_t) (stats.tsc_hz / 1000000),
+               (uint32_t) (stats.min_gap_ns / 1000), (uint32_t) (stats.max_gap_ns / 1000));
     }
     return 1;
 }
 
+/**
+ * Parse a decimal command argument
+ */
+bool shell_parse_uint(const char* str, uint32_t* value) {
+    uint32_t result = 0;
+    if (*str == '\0') {
+        return false;
+    }
+    for (; *str != '\0'; str++) {
+        if (*str < '0' || *str > '9') {
+            return false;
+        }
+        result = result * 10 + (uint32_t) (*str - '0');
+    }
+    *value = result;
+    return true;
+}
+
+/**
+ * Run a program from the initrd and wait for it
+ *
+ * @param name Path, or a plain name looked up in SHELL_BIN_DIR
+ * @return false if there is no such file (nothing was started)
+ */
+static bool shell_run_program(const char* name) {
+    char path[VFS_NAME_MAX + sizeof(SHELL_BIN_DIR)];
+    if (strchr(name, '/') == NULL) {
+        if (strlen(name) >= VFS_NAME_MAX) {
+            return false;
+        }
+        snprintf(path, sizeof(path), "%s%s", SHELL_BIN_DIR, name);
+        name = path;
+    }
+    dentry_t* dentry = vfs_lookup(name);
+    if (dentry == NULL || dentry->inode == NULL || dentry->inode->type != VFS_TYPE_FILE) {
+        return false;
+    }
+    process_t* proc = process_exec(name);
+    if (proc == NULL) {
+        printf("%s: can't execute\n", name);
+        return true;
+    }
+    int status = process_wait(proc);
+    if (status != 0) {
+        printf("%s: exit code %d\n", name, status);
+    }
+    return true;
+}
+
 /**
  * Execute a command
  *
- * Looks up the command in the built-in command table and executes it if found.
- * If the command doesn't exist, prints an error message.
+ * Looks the command up among the registered ones and runs its handler. A
+ * word that is no command is started as a program from the initrd; if there
+ * is none either, prints an error message.
  *
  * @param args Null-terminated array of command and arguments
  * @return 1 to continue shell loop, 0 to exit
@@ -86,36 +285,125 @@ int shell_execute(char **args) {
     if (args[0] == NULL) {
         return 1;
     }
-    // Search for built-in command
-    for (int i = 0; i < shell_num_builtins(); i++) {
-        if (strcmp(args[0], builtin_str[i]) == 0) {
-            return (*builtin_func[i])(args);
-        }
+    const shell_command_t* cmd = shell_find_command(args[0]);
+    if (cmd != NULL) {
+        return cmd->func(args);
+    }
+    if (!shell_run_program(args[0])) {
+        printf("%s: command not found\n", args[0]);
     }
-    printf("%s: command not found\n", args[0]);
     return 1;
 }
 
+/**
+ * Get the command arena, creating it on first use
+ *
+ * @return Arena, or NULL if its first chunk could not be allocated
+ */
+static arena_t* shell_command_arena(void) {
+    if (shell_arena.base == NULL && arena_init(&shell_arena, SHELL_ARENA_SIZE) != 0) {
+        return NULL;
+    }
+    return &shell_arena;
+}
+
+/**
+ * Remember a line for recall, unless it is empty or repeats the previous one
+ */
+static void shell_history_add(const char* line) {
+    if (line[0] == '\0' || (shell_history_count > 0 &&
+                             strcmp(shell_history[(shell_history_count - 1) % SHELL_HISTORY], line) == 0)) {
+        return;
+    }
+    size_t len = strlen(line) + 1;
+    char* copy = (char*) kmalloc(len);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, line, len);
+    char** slot = &shell_history[shell_history_count % SHELL_HISTORY];
+    kfree(*slot);
+    *slot = copy;
+    shell_history_count++;
+}
+
+/**
+ * Replace the line being edited (on screen too) with a recalled one
+ *
+ * @return The buffer, moved if it had to grow, or NULL if it could not (the line is then left as it was)
+ */
+static char* shell_recall(arena_t* arena, char* buffer, int* bufsize, int* position, const char* entry) {
+    int len = (int) strlen(entry);
+    if (len >= *bufsize) {
+        int size = *bufsize;
+        while (len >= size) {
+            size *= 2;
+        }
+        char* bigger = (char*) arena_realloc(arena, buffer, *bufsize, sizeof(char) * size);
+        if (!bigger) {
+            return NULL;
+        }
+        buffer = bigger;
+        *bufsize = size;
+    }
+    while (*position > 0) {
+        putchar('\b');
+        (*position)--;
+    }
+    memcpy(buffer, entry, len + 1);
+    *position = len;
+    printf("%s", buffer);
+    return buffer;
+}
+
 /**
  * Read a line of input from the keyboard
  *
- * @return Pointer to allocated string containing the input line,
- *         or NULL if allocation fails. Caller must free with kfree().
+ * The buffer lives in the command arena and doubles in place when it fills up.
+ * Up and Down step through the previous lines; key events come straight off
+ * the keyboard ring, so arrows arrive in order with the characters.
+ *
+ * @return Pointer to the input line, or NULL if allocation fails.
+ *         Freed when the command arena is reset.
  */
 char* input_line(void) {
     int bufsize = SHELL_RL_BUFSIZE, position = 0;
-    char *buffer = (char*) kmalloc(sizeof(char) * bufsize);
+    arena_t* arena = shell_command_arena();
+    char *buffer = arena ? (char*) arena_alloc(arena, sizeof(char) * bufsize) : NULL;
+    /* Line of the history shown; shell_history_count = the new line */
+    int browse = shell_history_count;
+    int oldest = shell_history_count > SHELL_HISTORY ? shell_history_count - SHELL_HISTORY : 0;
 
     if (!buffer) {
         printf("[FAILED] input_line: buffer allocation error\n");
         return NULL;
     }
+    buffer[0] = '\0';
 
     while (1) {
-        int c = getchar();
+        key_event_t key;
+        keyboard_read_event(&key);
+        if (key.flags & KEY_EVENT_RELEASED) {
+            continue;
+        }
+        if ((key.keycode == KEY_UP && browse > oldest) || (key.keycode == KEY_DOWN && browse < shell_history_count)) {
+            int target = key.keycode == KEY_UP ? browse - 1 : browse + 1;
+            const char* entry = target < shell_history_count ? shell_history[target % SHELL_HISTORY] : "";
+            char* recalled = shell_recall(arena, buffer, &bufsize, &position, entry);
+            if (recalled) {
+                buffer = recalled;
+                browse = target;
+            }
+            continue;
+        }
+        int c = (unsigned char) key.ascii;
+        if (c == 0) {
+            continue;                       // Nothing to type (other navigation and function keys)
+        }
         if (c == '\n') {					// User pressed Enter - return the complete line
             putchar(c);
             buffer[position] = '\0';
+            shell_history_add(buffer);
             return buffer;
         }
         if (c == '\b') {
@@ -125,10 +413,16 @@ char* input_line(void) {
             }
         }
         else {
-            if (position >= bufsize - 1) {  // Buffer overflow protection: leave room for null terminator
-                continue;                   // Buffer is full, silently ignore additional input
+            if (position >= bufsize - 1) {  // Leave room for null terminator: grow the buffer
+                char* bigger = (char*) arena_realloc(arena, buffer, bufsize, sizeof(char) * bufsize * 2);
+                if (!bigger) {
+                    continue;               // Out of memory, ignore additional input
+                }
+                buffer = bigger;
+                bufsize *= 2;
             }
             buffer[position++] = c;         // Add character to buffer and echo to screen
+            buffer[position] = '\0';
             putchar(c);
         }
     }
@@ -144,12 +438,16 @@ char* input_line(void) {
  *   Input:  "help   arg1  arg2"
  *   Output: ["help", "arg1", "arg2", NULL]
  *
+ * The token array lives in the command arena and doubles when a command has
+ * more arguments.
+ *
  * @param line Input string to parse (will be modified by strtok)
- * @return Null-terminated array of string pointers. Caller must free with kfree().
+ * @return Null-terminated array of string pointers. Freed when the command arena is reset.
  */
 char** parse_line(char *line) {
     int bufsize = SHELL_TOK_BUFSIZE, position = 0;
-    char** tokens = (char**) kmalloc(bufsize * sizeof(char*)), *token;
+    arena_t* arena = shell_command_arena();
+    char** tokens = arena ? (char**) arena_alloc(arena, bufsize * sizeof(char*)) : NULL, *token;
 
     if (!tokens) {
         printf("[FAILED] parse_line: tokens allocation error\n");
@@ -158,7 +456,16 @@ char** parse_line(char *line) {
     token = strtok(line, SHELL_TOK_DELIM);
     while (token != NULL) {
         tokens[position++] = token;
-        // TODO: Handle case where position >= bufsize (too many arguments)
+        if (position >= bufsize) {          // Keep room for the NULL terminator
+            char** bigger = (char**) arena_realloc(arena, tokens, bufsize * sizeof(char*),
+                                                   bufsize * 2 * sizeof(char*));
+            if (!bigger) {
+                printf("[FAILED] parse_line: tokens allocation error\n");
+                return NULL;
+            }
+            tokens = bigger;
+            bufsize *= 2;
+        }
         // Subsequent calls: pass NULL to continue tokenizing same string
         token = strtok(NULL, SHELL_TOK_DELIM);
     }
@@ -174,7 +481,7 @@ char** parse_line(char *line) {
  * 2. Reads a line of input from the user
  * 3. Parses the line into command and arguments
  * 4. Executes the command
- * 5. Frees allocated memory
+ * 5. Resets the command arena (frees the line and tokens in one go)
  * 6. Repeats
  *
  * The loop continues until a command returns 0 (though currently no built-in commands do this - the shell runs forever)
@@ -184,6 +491,8 @@ void init_shell(void) {
     int status;
 
     do {
+        // Show the kernel messages still waiting for the console before the prompt
+        klog_flush();
         // Print prompt
         printf("$ ");
         // Read command line
@@ -192,9 +501,8 @@ void init_shell(void) {
         args = parse_line(line);
         // Execute command
         status = shell_execute(args);
-        // Clean up allocated memory
-        kfree(line);
-        kfree(args);
+        // Clean up everything the command allocated
+        arena_reset(&shell_arena);
     } while (status);
 
 }
@@ -0,0 +1,73 @@
+/**
+ * In-kernel tests for the kernel heap
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/ktest.h>
+#include <kernel/kheap.h>
+
+KTEST(kheap, malloc_free_reuse) {
+    void* first = kmalloc(64);
+    KTEST_EXPECT(first != NULL);
+    kfree(first);
+    void* again = kmalloc(64);
+    KTEST_EXPECT(again != NULL);
+    kfree(again);
+    kfree(NULL);
+    return 0;
+}
+
+KTEST(kheap, blocks_disjoint) {
+    uint8_t* blocks[16];
+    for (int i = 0; i < 16; i++) {
+        blocks[i] = kmalloc(100);
+        KTEST_EXPECT(blocks[i] != NULL);
+        memset(blocks[i], i, 100);
+    }
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 100; j++) {
+            KTEST_EXPECT(blocks[i][j] == i);
+        }
+        kfree(blocks[i]);
+    }
+    return 0;
+}
+
+KTEST(kheap, aligned) {
+    static const size_t aligns[] = { 16, 64, 4096 };
+    for (size_t i = 0; i < sizeof(aligns) / sizeof(aligns[0]); i++) {
+        void* block = kmalloc_aligned(200, aligns[i]);
+        KTEST_EXPECT(block != NULL && ((uintptr_t) block & (aligns[i] - 1)) == 0);
+        kfree(block);
+    }
+    return 0;
+}
+
+KTEST(kheap, calloc_zeroes) {
+    uint32_t* block = kmalloc(256);
+    KTEST_EXPECT(block != NULL);
+    memset(block, 0xFF, 256);
+    kfree(block);
+    block = kcalloc(64, sizeof(uint32_t));
+    KTEST_EXPECT(block != NULL);
+    for (int i = 0; i < 64; i++) {
+        KTEST_EXPECT(block[i] == 0);
+    }
+    kfree(block);
+    return 0;
+}
+
+KTEST(kheap, realloc_keeps_data) {
+    char* block = kmalloc(16);
+    KTEST_EXPECT(block != NULL);
+    memcpy(block, "olympos kernel!", 16);
+    block = krealloc(block, 8192);
+    KTEST_EXPECT(block != NULL && memcmp(block, "olympos kernel!", 16) == 0);
+    block = krealloc(block, 8);
+    KTEST_EXPECT(block != NULL && memcmp(block, "olympos ", 8) == 0);
+    kfree(block);
+    return 0;
+}
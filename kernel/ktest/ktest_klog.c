@@ -0,0 +1,44 @@
+/**
+ * In-kernel tests for the kernel log ring
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/ktest.h>
+#include <kernel/klog.h>
+
+KTEST(klog, read_back) {
+    klog_stats_t stats;
+    klog_get_stats(&stats);
+    KTEST_EXPECT(klog(KLOG_DEBUG, "ktest klog %u\n", 42u) == 14);
+    KTEST_EXPECT(klog(KLOG_DEBUG + 1, "invalid\n") == -1);
+
+    klog_entry_t entry;
+    char text[KLOG_LINE_MAX];
+    uint32_t seq = stats.next_seq;
+    KTEST_EXPECT(klog_read(&seq, &entry, text, sizeof(text)));
+    KTEST_EXPECT(entry.seq == stats.next_seq && entry.level == KLOG_DEBUG);
+    KTEST_EXPECT(strcmp(text, "ktest klog 42\n") == 0);
+    KTEST_EXPECT(!klog_read(&seq, &entry, text, sizeof(text)));
+    return 0;
+}
+
+KTEST(klog, flush_empties) {
+    klog(KLOG_DEBUG, "queued for the console\n");
+    klog_flush();
+    klog_stats_t stats;
+    klog_get_stats(&stats);
+    KTEST_EXPECT(stats.pending == 0);
+    KTEST_EXPECT(!klog_drain_idle());
+    return 0;
+}
+
+KTEST(klog, level_names) {
+    KTEST_EXPECT(strcmp(klog_level_name(KLOG_ERR), "err") == 0);
+    KTEST_EXPECT(strcmp(klog_level_name(KLOG_DEBUG), "debug") == 0);
+    KTEST_EXPECT(strcmp(klog_level_name(9), "?") == 0);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * In-kernel tests for the libk string functions
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <kernel/ktest.h>
+
+KTEST(string, strlen_lengths) {
+    KTEST_EXPECT(strlen("") == 0);
+    KTEST_EXPECT(strlen("a") == 1);
+    KTEST_EXPECT(strlen("olympos") == 7);
+    /* Start the scan at every alignment: the word-at-a-time loop must not overshoot */
+    static const char text[] = "0123456789abcdef0123456789";
+    for (size_t i = 0; i < sizeof(text) - 1; i++) {
+        KTEST_EXPECT(strlen(text + i) == sizeof(text) - 1 - i);
+    }
+    return 0;
+}
+
+KTEST(string, strcmp_order) {
+    KTEST_EXPECT(strcmp("abc", "abc") == 0);
+    KTEST_EXPECT(strcmp("abc", "abd") < 0);
+    KTEST_EXPECT(strcmp("abd", "abc") > 0);
+    KTEST_EXPECT(strcmp("ab", "abc") < 0);
+    KTEST_EXPECT(strcmp("", "") == 0);
+    return 0;
+}
+
+KTEST(string, strchr_finds) {
+    const char* text = "hello, world";
+    KTEST_EXPECT(strchr(text, 'h') == text);
+    KTEST_EXPECT(strchr(text, 'w') == text + 7);
+    KTEST_EXPECT(strchr(text, 'z') == NULL);
+    KTEST_EXPECT(strchr(text, '\0') == text + 12);
+    return 0;
+}
+
+KTEST(string, memcpy_memmove_overlap) {
+    static uint8_t buffer[256];
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t) i;
+    }
+    memmove(buffer + 1, buffer, 100);
+    KTEST_EXPECT(buffer[0] == 0 && buffer[1] == 0 && buffer[100] == 99);
+    memmove(buffer, buffer + 1, 100);
+    KTEST_EXPECT(buffer[0] == 0 && buffer[1] == 1 && buffer[99] == 99);
+
+    static uint8_t copy[256];
+    memcpy(copy + 3, buffer + 1, 200);
+    KTEST_EXPECT(memcmp(copy + 3, buffer + 1, 200) == 0);
+    return 0;
+}
+
+KTEST(string, memset_unaligned) {
+    static uint8_t buffer[64];
+    memset(buffer, 0, sizeof(buffer));
+    memset(buffer + 3, 0xAB, 37);
+    KTEST_EXPECT(buffer[2] == 0 && buffer[3] == 0xAB && buffer[39] == 0xAB && buffer[40] == 0);
+    return 0;
+}
+
+KTEST(string, snprintf_truncates) {
+    char buffer[8];
+    int len = snprintf(buffer, sizeof(buffer), "%d-%s", 12345, "abcdef");
+    KTEST_EXPECT(len == 12);
+    KTEST_EXPECT(strcmp(buffer, "12345-a") == 0);
+    snprintf(buffer, sizeof(buffer), "%x", 0xbeefu);
+    KTEST_EXPECT(strcmp(buffer, "beef") == 0);
+    return 0;
+}
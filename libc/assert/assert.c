@@ -1,9 +1,15 @@
 #include <stdio.h>
 
 #include <kernel/debug.h>
+#ifdef __is_libk
+#include <kernel/crashdump.h>
+#endif
 
 __attribute__((__noreturn__))
 void __assert_fail(const char *expr, const char *file, unsigned int line, const char *function) {
+#ifdef __is_libk
+    crashdump_write(NULL, expr);
+#endif
     printf("%s: %s:%d: %s: Assertion `%s' failed.\n", "kernel", file, line, function, expr);
     print_backtrace();
     while (1) {
@@ -8,8 +8,23 @@ void __assert_fail(const char *expr, const char *file, unsigned int line, const
 
 #define assert(expr) ((expr) ? ((void)0) : __assert_fail(#expr, __FILE__, __LINE__, __func__))
 
+#if defined(__is_libk) || defined(__is_kernel)
+/* Kernel log messages still queued for the console go out before the panic */
+void klog_flush(void);
+#define __panic_flush_log() klog_flush()
+/* The binary crash dump (kernel/crashdump.h), if enabled, goes first of all */
+struct regs;
+int crashdump_write(const struct regs* regs, const char* reason);
+#define __panic_crashdump(reason) crashdump_write(0, reason)
+#else
+#define __panic_flush_log() ((void) 0)
+#define __panic_crashdump(reason) ((void) 0)
+#endif
+
 #define panic(fmt, ...) do {                                \
     asm volatile("cli");                                    \
+    __panic_crashdump("Kernel panic: " fmt);                \
+    __panic_flush_log();                                    \
     printf("Kernel panic: " fmt "\n", ##__VA_ARGS__);       \
     print_backtrace();                                      \
     while (1) {                                             \
@@ -0,0 +1,38 @@
+/**
+ * fcntl.h - File control options (POSIX)
+ *
+ * @see https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/fcntl.h.html
+ */
+
+#ifndef _FCNTL_H
+#define _FCNTL_H 1
+
+#include <sys/syscall.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Access modes (Linux i386 values; only O_RDONLY succeeds, the filesystems are read-only) */
+#define O_RDONLY        0x0
+#define O_WRONLY        0x1
+#define O_RDWR          0x2
+#define O_ACCMODE       0x3
+
+/**
+ * Open a file.
+ *
+ * @param path Absolute path (relative ones are taken from the root)
+ * @param flags O_RDONLY
+ * @return File descriptor on success, -1 if the file doesn't exist or can't be opened that way
+ *
+ * @example
+ * int fd = open("/etc/motd", O_RDONLY);
+ */
+int open(const char *path, int flags, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FCNTL_H */
@@ -8,16 +8,61 @@
 
 #define EOF (-1)
 
+/* Buffering modes for setvbuf() */
+#define _IOFBF  0   /* Fully buffered: write when the buffer is full */
+#define _IOLBF  1   /* Line buffered: write at each newline */
+#define _IONBF  2   /* Unbuffered: write immediately */
+
+/* Default stream buffer size */
+#define BUFSIZ  1024
+
+/**
+ * Output stream
+ *
+ * Bytes collect in buf and reach the file descriptor in one write() per
+ * flush. In the kernel (libk) streams are unbuffered and go straight to
+ * the terminal.
+ */
+typedef struct {
+    int fd;         /* File descriptor written on flush */
+    int mode;       /* _IOFBF, _IOLBF or _IONBF */
+    char* buf;      /* Buffer (unused when unbuffered) */
+    size_t size;    /* Buffer capacity */
+    size_t pos;     /* Bytes waiting in buf */
+    int error;      /* Set when a write failed */
+} FILE;
+
+extern FILE* stdout;    /* Line buffered */
+extern FILE* stderr;    /* Unbuffered */
+
+/**
+ * Output callback of vformat(): receives the formatted text in chunks
+ *
+ * @return 0 to go on, -1 on a write error
+ */
+typedef int (*format_sink_t)(void* ctx, const char* data, size_t len);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int printf(const char* __restrict, ...);
+int vprintf(const char* __restrict, va_list);
+int vformat(format_sink_t, void*, const char* __restrict, va_list);
 int putchar(int);
 int getchar(void);
 int puts(const char*);
 int snprintf(char* __restrict, size_t, const char* __restrict, ...);
 int vsnprintf(char* __restrict, size_t, const char* __restrict, va_list);
+int fputc(int, FILE*);
+size_t fwrite(const void* __restrict, size_t, size_t, FILE* __restrict);
+int fflush(FILE*);
+int setvbuf(FILE* __restrict, char* __restrict, int, size_t);
+
+#if defined(__is_libk) || defined(__is_kernel)
+/* Kernel log output: the terminal and COM1 */
+int kprintf(const char* __restrict, ...);
+#endif
 
 #ifdef __cplusplus
 }
@@ -1,6 +1,9 @@
 #ifndef _STDLIB_H
 #define _STDLIB_H 1
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <sys/cdefs.h>
 
 #ifdef __cplusplus
@@ -11,6 +14,20 @@ __attribute__((__noreturn__))
 void abort(void);
 char* itoa(int value, char* str, int base);
 
+/* Fast unsigned conversions: write the digits and a null terminator, return the digit count */
+size_t utoa10(uint32_t value, char* str);
+size_t utoa16(uint32_t value, char* str);
+size_t utoa10_64(uint64_t value, char* str);
+size_t utoa16_64(uint64_t value, char* str);
+
+#if !defined(__is_libk) && !defined(__is_kernel)
+/* User-space heap (the kernel has kmalloc()): power-of-two bins on brk(), big blocks from mmap() */
+void* malloc(size_t size);
+void free(void* ptr);
+void* calloc(size_t count, size_t size);
+void* realloc(void* ptr, size_t size);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
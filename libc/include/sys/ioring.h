@@ -0,0 +1,128 @@
+#ifndef _SYS_IORING_H
+#define _SYS_IORING_H 1
+
+#include <stdint.h>
+
+/**
+ * Batched system calls (io_uring style submission/completion rings)
+ *
+ * Must match kernel/include/kernel/ioring.h.
+ *
+ * Usage:
+ *   struct ioring ring;
+ *   ioring_init(&ring, 32, 0);
+ *   for (...) {
+ *       struct ioring_sqe* sqe = ioring_get_sqe(&ring);
+ *       ioring_prep_write(sqe, 1, buf, len, tag);
+ *   }
+ *   ioring_submit(&ring);              // one kernel entry for all of them
+ *   struct ioring_cqe* cqe;
+ *   while ((cqe = ioring_peek_cqe(&ring)) != NULL) {
+ *       ... cqe->user_data, cqe->res ...
+ *       ioring_cqe_seen(&ring);
+ *   }
+ *
+ * With IORING_SETUP_SQPOLL a kernel thread picks the entries up by itself and
+ * ioring_submit() only enters the kernel when that thread went to sleep.
+ */
+
+#define IORING_SETUP_SQPOLL     0x1
+#define IORING_ENTER_GETEVENTS  0x1
+#define IORING_ENTER_SQ_WAKEUP  0x2
+#define IORING_SQ_NEED_WAKEUP   0x1
+
+#define IORING_OP_NOP           0
+#define IORING_OP_READ          1
+#define IORING_OP_WRITE         2
+
+struct ioring_header {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    volatile uint32_t flags;
+    uint32_t sq_offset;
+    uint32_t cq_offset;
+};
+
+struct ioring_sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t user_data;
+    uint32_t pad[3];
+};
+
+struct ioring_cqe {
+    uint32_t user_data;
+    int32_t res;
+};
+
+/* User-side view of a ring */
+struct ioring {
+    struct ioring_header* header;
+    struct ioring_sqe* sqes;
+    struct ioring_cqe* cqes;
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+    uint32_t sq_tail;               /* Next SQE to hand out (published by ioring_submit()) */
+    uint32_t setup_flags;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create the process's ring (SYS_ioring_setup)
+ *
+ * @return 0 on success, -1 on failure
+ */
+int ioring_init(struct ioring* ring, unsigned entries, unsigned flags);
+
+/**
+ * Next free submission entry, or NULL if the queue is full
+ */
+struct ioring_sqe* ioring_get_sqe(struct ioring* ring);
+
+/**
+ * Fill a submission entry
+ */
+void ioring_prep_rw(struct ioring_sqe* sqe, int op, int fd, const void* buf, unsigned len, uint32_t user_data);
+#define ioring_prep_read(sqe, fd, buf, len, data)   ioring_prep_rw((sqe), IORING_OP_READ, (fd), (buf), (len), (data))
+#define ioring_prep_write(sqe, fd, buf, len, data)  ioring_prep_rw((sqe), IORING_OP_WRITE, (fd), (buf), (len), (data))
+
+/**
+ * Publish the entries filled since the last call and start them
+ *
+ * @return Entries the kernel ran (or, with SQPOLL, that were handed over), -1 on error
+ */
+int ioring_submit(struct ioring* ring);
+
+/**
+ * Wait until at least 'count' completions are pending (SQPOLL rings)
+ *
+ * @return 0 on success, -1 on error
+ */
+int ioring_wait(struct ioring* ring, unsigned count);
+
+/**
+ * Oldest unconsumed completion, or NULL if there is none
+ */
+struct ioring_cqe* ioring_peek_cqe(struct ioring* ring);
+
+/**
+ * Consume the completion returned by ioring_peek_cqe()
+ */
+void ioring_cqe_seen(struct ioring* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H 1
+
+#include <sys/syscall.h>
+
+/**
+ * Memory mappings (POSIX)
+ *
+ * Must match the MMAP_* values in kernel/include/kernel/process.h.
+ *
+ * Usage:
+ *   int fd = open("/data/table.bin", O_RDONLY);
+ *   const uint8_t* table = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+ *   ...                                // pages fault in as they are touched
+ *   munmap((void*) table, size);
+ *
+ * A read-only file mapping shares the initrd's frames, with no copy. Writable
+ * file mappings must be MAP_PRIVATE; anonymous ones (MAP_ANONYMOUS, fd
+ * ignored) too, and start zero-filled.
+ *
+ * @see https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/sys_mman.h.html
+ */
+
+#define PROT_READ       0x1
+#define PROT_WRITE      0x2
+#define PROT_EXEC       0x4
+
+#define MAP_SHARED      0x01
+#define MAP_PRIVATE     0x02
+#define MAP_FIXED       0x10
+#define MAP_ANONYMOUS   0x20
+#define MAP_ANON        MAP_ANONYMOUS
+
+#define MAP_FAILED      ((void *) -1)
+
+/* madvise() advice */
+#define MADV_NORMAL     0
+#define MADV_WILLNEED   3
+#define MADV_DONTNEED   4   /* Free the pages; the next touch brings zeroes (anonymous) or the file back */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Map a file or anonymous memory.
+ *
+ * @param addr Address to map at with MAP_FIXED, otherwise ignored
+ * @param length Bytes to map (rounded up to pages)
+ * @param prot PROT_READ, optionally with PROT_WRITE and PROT_EXEC
+ * @param flags MAP_SHARED or MAP_PRIVATE, optionally with MAP_FIXED and MAP_ANONYMOUS
+ * @param fd File to map (from open())
+ * @param offset Page-aligned offset in the file
+ * @return Address of the mapping, or MAP_FAILED
+ */
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+
+/**
+ * Remove a mapping.
+ *
+ * @param addr Address mmap() returned
+ * @param length Length passed to mmap()
+ * @return 0 on success, -1 if the range isn't exactly one mapping
+ */
+int munmap(void *addr, size_t length);
+
+/**
+ * Advise on how a range will be used.
+ *
+ * @param addr Page-aligned start in the heap or a mapping
+ * @param length Bytes (rounded up to pages)
+ * @param advice MADV_DONTNEED frees the pages that are in memory; other advice is ignored
+ * @return 0 on success, -1 on error
+ */
+int madvise(void *addr, size_t length, int advice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
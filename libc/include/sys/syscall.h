@@ -10,19 +10,49 @@
 typedef long ssize_t;
 #endif
 
+#ifndef _OFF_T_DEFINED
+#define _OFF_T_DEFINED
+typedef long off_t;
+#endif
+
+#ifndef _PID_T_DEFINED
+#define _PID_T_DEFINED
+typedef int pid_t;
+#endif
+
 /* System call numbers - Linux i386 compatible
  * 
  * Must match kernel/include/kernel/syscall.h
  * These numbers align with Linux i386 syscall table for compatibility.
  */
 #define SYS_EXIT    1   /* Exit process (matches Linux sys_exit) */
-#define SYS_READ    3   /* Read from keyboard (matches Linux sys_read) */
+#define SYS_FORK    2   /* Duplicate process (matches Linux sys_fork) */
+#define SYS_READ    3   /* Read from keyboard or a file (matches Linux sys_read) */
 #define SYS_WRITE   4   /* Write to console (matches Linux sys_write) */
+#define SYS_OPEN    5   /* Open a file (matches Linux sys_open) */
+#define SYS_CLOSE   6   /* Close a file descriptor (matches Linux sys_close) */
+#define SYS_LSEEK   19  /* Move a file offset (matches Linux sys_lseek) */
+#define SYS_BRK     45  /* Move the end of the heap (matches Linux sys_brk) */
+#define SYS_MMAP    90  /* Map memory, arguments in a struct (matches Linux old_mmap) */
+#define SYS_MUNMAP  91  /* Remove a mapping (matches Linux sys_munmap) */
+#define SYS_MADVISE 219 /* Give memory back (matches Linux sys_madvise) */
+#define SYS_IORING_SETUP    425 /* Map a system call ring (matches Linux io_uring_setup) */
+#define SYS_IORING_ENTER    426 /* Run queued system calls (matches Linux io_uring_enter) */
 
 /* Linux-style lowercase aliases for compatibility */
 #define SYS_exit    SYS_EXIT
+#define SYS_fork    SYS_FORK
 #define SYS_read    SYS_READ
 #define SYS_write   SYS_WRITE
+#define SYS_open    SYS_OPEN
+#define SYS_close   SYS_CLOSE
+#define SYS_lseek   SYS_LSEEK
+#define SYS_brk     SYS_BRK
+#define SYS_mmap    SYS_MMAP
+#define SYS_munmap  SYS_MUNMAP
+#define SYS_madvise SYS_MADVISE
+#define SYS_ioring_setup    SYS_IORING_SETUP
+#define SYS_ioring_enter    SYS_IORING_ENTER
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +65,12 @@ extern "C" {
  */
 ssize_t write(int fd, const void *buf, size_t count);
 ssize_t read(int fd, void *buf, size_t count);
+int open(const char *path, int flags, ...);
+int close(int fd);
+off_t lseek(int fd, off_t offset, int whence);
+int brk(void *addr);
+void *sbrk(intptr_t increment);
+pid_t fork(void);
 void exit(int status) __attribute__((noreturn));
 void _exit(int status) __attribute__((noreturn));
 
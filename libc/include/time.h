@@ -0,0 +1,63 @@
+/**
+ * time.h - Time types and clocks (POSIX)
+ *
+ * In user space clock_gettime() reads the kernel's clock page, which every
+ * process has mapped read-only, so it needs no system call.
+ *
+ * @see https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/time.h.html
+ */
+
+#ifndef _TIME_H
+#define _TIME_H 1
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef long time_t;
+typedef int clockid_t;
+
+struct timespec {
+    time_t tv_sec;      /* Seconds */
+    long tv_nsec;       /* Nanoseconds [0, 999999999] */
+};
+
+/* Clock IDs (match Linux). Both count from boot; there is no wall clock yet. */
+#define CLOCK_MONOTONIC     1
+#define CLOCK_BOOTTIME      7
+
+/* Clock page, read-only in every process. Must match kernel/include/kernel/vclock.h */
+#define VCLOCK_PAGE_ADDR    0xBFFF8000
+#define VCLOCK_VERSION      1
+#define VCLOCK_TSC          0x1
+
+struct vclock {
+    volatile uint32_t seq;
+    uint32_t version;
+    volatile uint64_t ticks;
+    volatile uint64_t tick_tsc;
+    volatile uint64_t tick_time;
+    uint64_t tsc_ns_mult;
+    uint32_t tsc_ns_shift;
+    uint32_t tick_ns;
+    uint64_t tsc_hz;
+    uint32_t hz;
+    volatile uint32_t flags;
+};
+
+/**
+ * Get the time of a clock.
+ *
+ * @param clock_id CLOCK_MONOTONIC or CLOCK_BOOTTIME
+ * @param tp Filled with the time since boot
+ * @return 0 on success, -1 for an unknown clock
+ */
+int clock_gettime(clockid_t clock_id, struct timespec* tp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TIME_H */
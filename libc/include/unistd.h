@@ -22,6 +22,11 @@ extern "C" {
 #define STDOUT_FILENO   1   /* Standard output file descriptor */
 #define STDERR_FILENO   2   /* Standard error file descriptor */
 
+/* lseek() origins */
+#define SEEK_SET        0   /* From the start of the file */
+#define SEEK_CUR        1   /* From the current offset */
+#define SEEK_END        2   /* From the end of the file */
+
 /**
  * Write data to a file descriptor.
  * 
@@ -42,6 +47,50 @@ ssize_t write(int fd, const void *buf, size_t count);
  */
 ssize_t read(int fd, void *buf, size_t count);
 
+/**
+ * Close a file descriptor.
+ *
+ * @param fd File descriptor from open()
+ * @return 0 on success, -1 if fd isn't open
+ */
+int close(int fd);
+
+/**
+ * Move the offset of an open file.
+ *
+ * @param fd File descriptor from open()
+ * @param offset Distance from whence
+ * @param whence SEEK_SET, SEEK_CUR or SEEK_END
+ * @return New offset on success, -1 on error
+ */
+off_t lseek(int fd, off_t offset, int whence);
+
+/**
+ * Set the end of the heap (the program break).
+ *
+ * @param addr New break, above the program and below the mmap() area
+ * @return 0 on success, -1 on error
+ */
+int brk(void *addr);
+
+/**
+ * Move the end of the heap.
+ *
+ * @param increment Bytes to add (negative to give memory back, 0 to query)
+ * @return The previous break on success, (void *) -1 on error
+ */
+void *sbrk(intptr_t increment);
+
+/**
+ * Create a copy of the calling process.
+ *
+ * The child shares the parent's memory copy-on-write: pages are only copied
+ * when one of the two writes to them.
+ *
+ * @return Child's process ID in the parent, 0 in the child, -1 on error
+ */
+pid_t fork(void);
+
 /**
  * Terminate the calling process.
  * 
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#if defined(__is_libk)
+#include <kernel/tty.h>
+#endif
+
+#ifdef TEST
+#include <kernel/serial.h>
+#endif
+
+/**
+ * Buffered output streams (stdout, stderr)
+ *
+ * In user mode printf() used to cost one int 0x80 per byte. Now bytes are
+ * collected in the stream buffer and written with a single SYSCALL_WRITE
+ * per line (stdout) or per full buffer (_IOFBF):
+ *
+ *   printf("x = %d\n", 42)  →  buf: "x = 42\n"  →  write(1, buf, 7)
+ */
+
+#if defined(__is_libk)
+static FILE stdout_file = {STDOUT_FILENO, _IONBF, NULL, 0, 0, 0};
+#else
+static char stdout_buf[BUFSIZ];
+
+static FILE stdout_file = {STDOUT_FILENO, _IOLBF, stdout_buf, sizeof(stdout_buf), 0, 0};
+#endif
+static FILE stderr_file = {STDERR_FILENO, _IONBF, NULL, 0, 0, 0};
+
+FILE* stdout = &stdout_file;
+FILE* stderr = &stderr_file;
+
+#if !defined(__is_libk)
+/**
+ * Write all bytes to a file descriptor, retrying short writes
+ *
+ * @return 0 on success, EOF on error
+ */
+static int stream_write(FILE* stream, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(stream->fd, data, length);
+        if (written <= 0) {
+            stream->error = 1;
+            return EOF;
+        }
+        data += written;
+        length -= written;
+    }
+    return 0;
+}
+#endif
+
+/**
+ * Write the buffered bytes of a stream
+ *
+ * @param stream Stream to flush (NULL flushes stdout and stderr)
+ * @return 0 on success, EOF on error
+ */
+int fflush(FILE* stream) {
+    if (stream == NULL) {
+        int result = fflush(stdout);
+        return fflush(stderr) == EOF ? EOF : result;
+    }
+#if defined(__is_libk)
+    return 0;
+#else
+    if (stream->pos == 0) {
+        return 0;
+    }
+    int result = stream_write(stream, stream->buf, stream->pos);
+    stream->pos = 0;
+    return result;
+#endif
+}
+
+/**
+ * Set the buffering mode and buffer of a stream
+ *
+ * Any pending output is flushed first.
+ *
+ * @param stream Stream to change
+ * @param buf Buffer to use (NULL keeps the current one)
+ * @param mode _IOFBF, _IOLBF or _IONBF
+ * @param size Size of buf
+ * @return 0 on success, -1 on invalid arguments
+ */
+int setvbuf(FILE* restrict stream, char* restrict buf, int mode, size_t size) {
+    if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+        return -1;
+    }
+    if (mode != _IONBF && buf == NULL && stream->buf == NULL) {
+        return -1;  /* No buffer to use */
+    }
+    fflush(stream);
+    if (buf != NULL) {
+        if (size == 0) {
+            return -1;
+        }
+        stream->buf = buf;
+        stream->size = size;
+    }
+    stream->mode = mode;
+    return 0;
+}
+
+/**
+ * Write elements to a stream
+ *
+ * @param ptr Data to write
+ * @param size Size of each element
+ * @param count Number of elements
+ * @param stream Stream to write to
+ * @return Number of complete elements written
+ */
+size_t fwrite(const void* restrict ptr, size_t size, size_t count, FILE* restrict stream) {
+    if (size == 0 || count == 0) {
+        return 0;
+    }
+    if (count > (size_t) -1 / size) {
+        return 0;
+    }
+    const char* data = (const char*) ptr;
+    size_t total = size * count;
+#if defined(__is_libk)
+    (void) stream;
+    terminal_write(data, total);
+#ifdef TEST
+    serial_write(SERIAL_COM1_BASE, data, total);
+#endif
+    return count;
+#else
+    if (stream->mode == _IONBF) {
+        return stream_write(stream, data, total) == 0 ? count : 0;
+    }
+    size_t done = 0;
+    while (done < total) {
+        if (stream->pos == stream->size && fflush(stream) == EOF) {
+            return done / size;
+        }
+        size_t chunk = stream->size - stream->pos;
+        if (chunk > total - done) {
+            chunk = total - done;
+        }
+        memcpy(stream->buf + stream->pos, data + done, chunk);
+        stream->pos += chunk;
+        done += chunk;
+    }
+    if (stream->mode == _IOLBF) {
+        /* Flush if the data contained a newline */
+        for (size_t i = total; i > 0; i--) {
+            if (data[i - 1] == '\n') {
+                if (fflush(stream) == EOF) {
+                    return 0;
+                }
+                break;
+            }
+        }
+    }
+    return count;
+#endif
+}
+
+/**
+ * Write a character to a stream
+ *
+ * @return The character written as an unsigned char cast to an int, or EOF on error
+ */
+int fputc(int ic, FILE* stream) {
+    unsigned char c = (unsigned char) ic;
+    return fwrite(&c, 1, 1, stream) == 1 ? c : EOF;
+}
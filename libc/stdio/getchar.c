@@ -2,7 +2,8 @@
  * Read character from standard input
  *
  * Reads a single character from standard input. In kernel mode, this interfaces with the
- * keyboard driver to provide blocking character input. In user mode, uses system calls.
+ * keyboard driver to provide blocking character input. In user mode, uses system calls
+ * (stdout is flushed first so a pending prompt is visible).
  *
  * @return  The character read as an int, or EOF on end-of-file
  */
@@ -19,6 +20,7 @@ int getchar(void) {
 #if defined(__is_libk)
     return keyboard_callback_getchar();
 #else
+    fflush(stdout);
     char c;
     ssize_t result = read(STDIN_FILENO, &c, 1);
     if (result == 1) {
@@ -2,8 +2,6 @@
 
 #if defined(__is_libk)
 #include <kernel/tty.h>
-#else
-#include <unistd.h>
 #endif
 
 #ifdef TEST
@@ -16,7 +14,7 @@
  * This implementation has multiple modes:
  * - Kernel mode (__is_libk):   Writes directly to the terminal
  * - Test mode (TEST):          Also writes to serial port for test output
- * - User mode:                 Uses system calls to write to console
+ * - User mode:                 Goes through the stdout buffer (one SYSCALL_WRITE per line)
  *
  * @param ic    The character to write (as an int)
  * @return      The character written as an unsigned char cast to an int, or EOF on error
@@ -29,9 +27,7 @@ int putchar(int ic) {
     serial_write_char(SERIAL_COM1_BASE, c);
 #endif
 #else
-    char c = (char) ic;
-    ssize_t result = write(STDOUT_FILENO, &c, 1);
-    if (result != 1) {
+    if (fputc(ic, stdout) == EOF) {
         return EOF;
     }
 #endif
@@ -0,0 +1,223 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Formatting engine shared by printf(), vsnprintf(), kprintf() and serial_printf()
+ *
+ * Literal text and converted arguments are collected in a small chunk on
+ * the stack and handed to the sink only when the chunk is full or the
+ * format is done, so a typical line reaches the terminal or serial port in
+ * a single write:
+ *
+ *   printf("x = %d (%s)\n", 42, "ok")
+ *     chunk: "x = " + "42" + " (" + "ok" + ")\n"  →  sink("x = 42 (ok)\n", 12)
+ *
+ * A piece that doesn't fit in what is left of the chunk flushes it first;
+ * one larger than the whole chunk (a long %s) goes to the sink directly.
+ */
+
+#define FORMAT_CHUNK_SIZE   128
+
+typedef struct {
+    format_sink_t sink;
+    void* ctx;
+    size_t pos;                     /* Bytes waiting in chunk */
+    size_t total;                   /* Bytes produced so far */
+    int error;                      /* The sink failed: nothing more is sent */
+    char chunk[FORMAT_CHUNK_SIZE];
+} format_out_t;
+
+/**
+ * Hand the collected bytes to the sink
+ */
+static void format_flush(format_out_t* out) {
+    if (out->pos > 0 && !out->error && out->sink(out->ctx, out->chunk, out->pos) != 0) {
+        out->error = 1;
+    }
+    out->pos = 0;
+}
+
+/**
+ * Append bytes to the output
+ */
+static void format_emit(format_out_t* out, const char* data, size_t len) {
+    out->total += len;
+    if (len > FORMAT_CHUNK_SIZE - out->pos) {
+        format_flush(out);
+        if (len >= FORMAT_CHUNK_SIZE) {
+            if (!out->error && out->sink(out->ctx, data, len) != 0) {
+                out->error = 1;
+            }
+            return;
+        }
+    }
+    memcpy(out->chunk + out->pos, data, len);
+    out->pos += len;
+}
+
+/**
+ * Append an unsigned number in decimal or hexadecimal
+ */
+static void format_unsigned(format_out_t* out, uint32_t value, bool hex) {
+    char num_str[12];
+    format_emit(out, num_str, hex ? utoa16(value, num_str) : utoa10(value, num_str));
+}
+
+/**
+ * Append a signed number in decimal
+ */
+static void format_signed(format_out_t* out, int32_t value) {
+    char num_str[12];
+    if (value < 0) {
+        num_str[0] = '-';
+        format_emit(out, num_str, 1 + utoa10(-(uint32_t) value, num_str + 1));
+    }
+    else {
+        format_emit(out, num_str, utoa10((uint32_t) value, num_str));
+    }
+}
+
+/**
+ * Append a 64-bit number: signed decimal, unsigned decimal or hexadecimal
+ */
+static void format_64(format_out_t* out, uint64_t value, char type) {
+    char num_str[24];
+    size_t len = 0;
+    if (type == 'd' && (int64_t) value < 0) {
+        num_str[len++] = '-';
+        value = -value;
+    }
+    len += type == 'x' ? utoa16_64(value, num_str + len) : utoa10_64(value, num_str + len);
+    format_emit(out, num_str, len);
+}
+
+/**
+ * Format into a sink
+ *
+ * Supports the following format specifiers:
+ * - %c:  Character
+ * - %s:  String
+ * - %d:  Signed integer
+ * - %u:  Unsigned integer (decimal)
+ * - %p:  Pointer (prefixed with 0x)
+ * - %x:  Unsigned integer in hexadecimal
+ * - %ld: Long signed integer
+ * - %lu: Long unsigned integer
+ * - %lx: Long unsigned integer in hexadecimal
+ * - %zu: Size_t as unsigned
+ * - %zd: Size_t as signed decimal
+ * - %lld, %llu, %llx: 64-bit integer (signed, unsigned, hexadecimal)
+ *
+ * An unrecognized specifier is printed literally together with the rest of
+ * the format string.
+ *
+ * @param sink      Receives the output in chunks
+ * @param ctx       Passed to the sink
+ * @param format    Format string containing text and format specifiers
+ * @param args      Variable arguments corresponding to format specifiers
+ * @return          Number of characters produced, or -1 if the sink failed or the count overflows an int
+ */
+int vformat(format_sink_t sink, void* ctx, const char* restrict format, va_list args) {
+    format_out_t out;
+    out.sink = sink;
+    out.ctx = ctx;
+    out.pos = 0;
+    out.total = 0;
+    out.error = 0;
+
+    while (*format != '\0') {
+        /* Handle regular characters and %% escape sequences */
+        if (format[0] != '%' || format[1] == '%') {
+            /* Skip one character for %% to print a single % */
+            if (format[0] == '%') {
+                format++;
+            }
+            /* Count consecutive non-format characters */
+            size_t amount = 1;
+            while (format[amount] && format[amount] != '%') {
+                amount++;
+            }
+            format_emit(&out, format, amount);
+            format += amount;
+            continue;
+        }
+
+        /* Save the position of the format specifier */
+        const char* format_begun_at = format++;
+
+        if (*format == 'c') {
+            format++;
+            /* char is promoted to int in varargs */
+            char c = (char) va_arg(args, int);
+            format_emit(&out, &c, 1);
+        }
+        else if (*format == 's') {
+            format++;
+            const char* str = va_arg(args, const char*);
+            format_emit(&out, str, strlen(str));
+        }
+        else if (*format == 'd') {
+            format++;
+            format_signed(&out, va_arg(args, int));
+        }
+        else if (*format == 'u' || *format == 'x') {
+            bool hex = *format++ == 'x';
+            format_unsigned(&out, va_arg(args, unsigned int), hex);
+        }
+        else if (*format == 'p') {
+            format++;
+            void* ptr = va_arg(args, void*);
+            format_emit(&out, "0x", 2);
+            format_unsigned(&out, (uint32_t) (uintptr_t) ptr, true);
+        }
+        /* 64-bit formats: %lld, %llu, and %llx */
+        else if (format[0] == 'l' && format[1] == 'l' && (format[2] == 'd' || format[2] == 'u' || format[2] == 'x')) {
+            char type = format[2];
+            format += 3;
+            format_64(&out, va_arg(args, unsigned long long), type);
+        }
+        /* Long formats: %ld, %lu, and %lx (long is 32 bits) */
+        else if (*format == 'l' && (format[1] == 'd' || format[1] == 'u' || format[1] == 'x')) {
+            char type = format[1];
+            format += 2;
+            if (type == 'd') {
+                format_signed(&out, (int32_t) va_arg(args, long));
+            }
+            else {
+                format_unsigned(&out, (uint32_t) va_arg(args, unsigned long), type == 'x');
+            }
+        }
+        /* size_t: %zu and %zd */
+        else if (*format == 'z' && (format[1] == 'u' || format[1] == 'd')) {
+            char type = format[1];
+            format += 2;
+            size_t z = va_arg(args, size_t);
+            if (type == 'd') {
+                format_signed(&out, (int32_t) z);
+            }
+            else {
+                format_unsigned(&out, (uint32_t) z, false);
+            }
+        }
+        /* Unrecognized: print the rest of the format string as literal text */
+        else {
+            format = format_begun_at;
+            size_t len = strlen(format);
+            format_emit(&out, format, len);
+            format += len;
+        }
+    }
+
+    format_flush(&out);
+    if (out.error || out.total > INT_MAX) {
+        // TODO: Set errno to EOVERFLOW when the count overflows.
+        return -1;
+    }
+    return (int) out.total;
+}
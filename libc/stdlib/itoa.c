@@ -1,9 +1,14 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
 /**
  *  Converts an integer value to a null-terminated string using the
  *  specified base and stores the result in the array given by str parameter.
  *
  *  If base is 10 and value is negative, the resulting string is preceded with a minus sign (-).
  *  With any other base, value is always considered unsigned.
+ *  Bases 10 and 16 use the fast paths of utoa10() and utoa16().
  *  Based on: http://www.strudel.org.uk/itoa/
  *
  *  @param value     Value to be converted to a string.
@@ -19,27 +24,32 @@ char* itoa(int value, char* str, int base) {
         *str = '\0';
         return str;
     }
-
-    char *ptr = str, *ptr1 = str, tmp_char;
-    int tmp_value;
-
-    do {
-        tmp_value = value;
-        value /= base;
-        *ptr++ = "zyxwvutsrqponmlkjihgfedcba9876543210123456789abcdefghijklmnopqrstuvwxyz" [35 + (tmp_value - value * base)];
-    } while(value);
-
-    // Apply negative sign
-    if (tmp_value < 0 && base == 10) {
-        *ptr++ = '-';
+    if (base == 10) {
+        if (value < 0) {
+            *str = '-';
+            utoa10(-(uint32_t) value, str + 1);
+        }
+        else {
+            utoa10((uint32_t) value, str);
+        }
+        return str;
+    }
+    if (base == 16) {
+        utoa16((uint32_t) value, str);
+        return str;
     }
 
-    *ptr-- = '\0';
-    while(ptr1 < ptr) {
-        tmp_char = *ptr;
-        *ptr--= *ptr1;
-        *ptr1++ = tmp_char;
+    // Count the digits, then write them from the end
+    uint32_t u = (uint32_t) value;
+    size_t len = 1;
+    for (uint32_t rest = u / base; rest != 0; rest /= base) {
+        len++;
     }
+    str[len] = '\0';
+    do {
+        str[--len] = "0123456789abcdefghijklmnopqrstuvwxyz"[u % base];
+        u /= base;
+    } while (len > 0);
 
     return str;
 }
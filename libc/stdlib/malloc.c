@@ -0,0 +1,192 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**
+ * User-Space Heap
+ *
+ *   malloc(n) → block of 2^k bytes, 8-byte header included (16 B .. 64 KiB)
+ *     → bins[k] has a freed block?  pop it             (no system call)
+ *     → else carve it off the arena: the unused end of the heap
+ *     → arena too short? sbrk() another MALLOC_CHUNK at least
+ *   malloc(n > 64 KiB) → its own anonymous mmap(), munmap() on free()
+ *
+ *   free(p) → header says which bin → push; blocks of MALLOC_TRIM_SIZE and
+ *             more madvise(MADV_DONTNEED) their inner pages, so the memory
+ *             goes back to the kernel while the address range stays binned
+ *
+ * A process runs a single thread, so these bins already belong to one
+ * thread and need no lock; after warm-up, allocation is a list pop.
+ *
+ * Blocks are never split or merged: a bin only ever holds blocks of its own
+ * size, and wasted space is bounded by the rounding to a power of two.
+ */
+
+#define MALLOC_HEADER           8                       /* Keeps payloads 8-byte aligned */
+#define MALLOC_MIN_SHIFT        4                       /* Smallest block: 16 bytes */
+#define MALLOC_MAX_SHIFT        16                      /* Largest binned block: 64 KiB */
+#define MALLOC_BINS             (MALLOC_MAX_SHIFT - MALLOC_MIN_SHIFT + 1)
+#define MALLOC_LARGE            0xFFFFFFFFu             /* Bin of an mmap()ed block */
+#define MALLOC_CHUNK            (64 * 1024)             /* Least the heap grows by */
+#define MALLOC_TRIM_SIZE        (8 * 1024)              /* Freed blocks this large give their pages back */
+#define MALLOC_PAGE             4096
+
+typedef struct {
+    uint32_t bin;                       /* Index into bins, or MALLOC_LARGE */
+    uint32_t size;                      /* Block bytes, header included (mapping length if large) */
+} block_header_t;
+
+typedef struct free_block {
+    struct free_block* next;
+} free_block_t;
+
+static free_block_t* bins[MALLOC_BINS];
+static uintptr_t arena_next = 0;        /* Unused end of the heap */
+static uintptr_t arena_end = 0;
+
+static inline uintptr_t page_down(uintptr_t addr) {
+    return addr & ~(uintptr_t) (MALLOC_PAGE - 1);
+}
+
+static inline uintptr_t page_up(uintptr_t addr) {
+    return page_down(addr + MALLOC_PAGE - 1);
+}
+
+/**
+ * Bin for a request, MALLOC_LARGE if it is too big for one
+ */
+static uint32_t bin_for(size_t size) {
+    if (size > ((size_t) 1 << MALLOC_MAX_SHIFT) - MALLOC_HEADER) {
+        return MALLOC_LARGE;
+    }
+    size_t total = size + MALLOC_HEADER;
+    uint32_t shift = MALLOC_MIN_SHIFT;
+    while (((size_t) 1 << shift) < total) {
+        shift++;
+    }
+    return shift - MALLOC_MIN_SHIFT;
+}
+
+/**
+ * Take a new block off the end of the heap
+ */
+static block_header_t* arena_take(size_t size) {
+    if (arena_end - arena_next < size) {
+        size_t grow = size > MALLOC_CHUNK ? size : MALLOC_CHUNK;
+        void* old = sbrk((intptr_t) grow);
+        if (old == (void*) -1) {
+            return NULL;
+        }
+        /* Contiguous with the arena unless something else moved the break */
+        if ((uintptr_t) old != arena_end) {
+            arena_next = (uintptr_t) old;
+        }
+        arena_end = (uintptr_t) old + grow;
+    }
+    block_header_t* block = (block_header_t*) arena_next;
+    arena_next += size;
+    return block;
+}
+
+/**
+ * Allocate size bytes
+ */
+void* malloc(size_t size) {
+    uint32_t bin = bin_for(size);
+    block_header_t* block;
+    if (bin == MALLOC_LARGE) {
+        if (size > SIZE_MAX - MALLOC_HEADER - MALLOC_PAGE) {
+            return NULL;
+        }
+        size_t len = page_up(size + MALLOC_HEADER);
+        void* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            return NULL;
+        }
+        block = (block_header_t*) map;
+        block->size = len;
+    }
+    else if (bins[bin] != NULL) {
+        free_block_t* head = bins[bin];
+        bins[bin] = head->next;
+        block = (block_header_t*) head - 1;
+    }
+    else {
+        block = arena_take((size_t) 1 << (bin + MALLOC_MIN_SHIFT));
+        if (block == NULL) {
+            return NULL;
+        }
+        block->size = 1u << (bin + MALLOC_MIN_SHIFT);
+    }
+    block->bin = bin;
+    return block + 1;
+}
+
+/**
+ * Release a block from malloc(), calloc() or realloc()
+ */
+void free(void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    block_header_t* block = (block_header_t*) ptr - 1;
+    if (block->bin == MALLOC_LARGE) {
+        munmap(block, block->size);
+        return;
+    }
+    if (block->bin >= MALLOC_BINS) {
+        abort();    /* Not a block of ours, or a corrupted header */
+    }
+    free_block_t* node = (free_block_t*) ptr;
+    if (block->size >= MALLOC_TRIM_SIZE) {
+        /* The page holding the header and link stays; whole pages after it go back */
+        uintptr_t start = page_up((uintptr_t) (node + 1));
+        uintptr_t end = page_down((uintptr_t) block + block->size);
+        if (start < end) {
+            madvise((void*) start, end - start, MADV_DONTNEED);
+        }
+    }
+    node->next = bins[block->bin];
+    bins[block->bin] = node;
+}
+
+/**
+ * Allocate a zeroed array
+ */
+void* calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* ptr = malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/**
+ * Resize a block, moving it if it doesn't fit
+ */
+void* realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    block_header_t* block = (block_header_t*) ptr - 1;
+    size_t usable = block->size - MALLOC_HEADER;
+    if (size <= usable) {
+        return ptr;
+    }
+    void* moved = malloc(size);
+    if (moved != NULL) {
+        memcpy(moved, ptr, usable);
+        free(ptr);
+    }
+    return moved;
+}
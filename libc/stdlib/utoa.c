@@ -0,0 +1,177 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Fast Unsigned Integer to String Conversion
+ *
+ * The digits are counted first and then written right to left, so nothing
+ * has to be reversed. Base 10 takes two digits per step from a 200-byte
+ * table of "00".."99" and divides by 100 with a multiply and a shift
+ * instead of a div instruction:
+ *
+ *   utoa10(4711)  → 4 digits
+ *     4711 / 100 = 47 r 11  → "..11"
+ *     47 < 100              → "4711"
+ *
+ * Base 16 only shifts and masks. 64-bit values are split into pieces of
+ * nine decimal digits with the CPU's 64-by-32-bit divide, so neither path
+ * needs libgcc's 64-bit division.
+ * Based on: https://github.com/miloyip/itoa-benchmark
+ */
+
+static const char digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_digits[16] = "0123456789abcdef";
+
+static const uint32_t powers_of_10[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/**
+ * v / 100 for any 32-bit v: 0x51EB851F = ceil(2^37 / 100)
+ */
+static inline uint32_t div100(uint32_t v) {
+    return (uint32_t) (((uint64_t) v * 0x51EB851Fu) >> 37);
+}
+
+/**
+ * Number of decimal digits of v (1 for 0)
+ */
+static inline size_t dec_digits(uint32_t v) {
+    size_t n = 1;
+    while (n < 10 && v >= powers_of_10[n]) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Write v as decimal into the 'len' bytes ending at 'end' (leading zeros if v is shorter)
+ */
+static void put_dec(uint32_t v, char* end, size_t len) {
+    char* p = end;
+    char* start = end - len;
+    while (p - start >= 2) {
+        uint32_t q = div100(v);
+        uint32_t r = v - q * 100;
+        p -= 2;
+        memcpy(p, &digit_pairs[r * 2], 2);
+        v = q;
+    }
+    if (p > start) {
+        *--p = (char) ('0' + v);
+    }
+}
+
+/**
+ * Divide a 64-bit value by 10^9
+ *
+ * @param rem Remainder
+ * @return Quotient
+ */
+static inline uint64_t div_1e9(uint64_t v, uint32_t* rem) {
+    uint32_t hi = (uint32_t) (v >> 32);
+    uint32_t q_hi = hi / 1000000000u;
+    uint32_t r = hi - q_hi * 1000000000u;
+    uint32_t q_lo;
+#if defined(__i386__)
+    /* r < 10^9, so the quotient of r:lo fits in 32 bits */
+    asm("divl %4" : "=a"(q_lo), "=d"(r) : "a"((uint32_t) v), "d"(r), "rm"(1000000000u));
+#else
+    uint64_t low = ((uint64_t) r << 32) | (uint32_t) v;
+    q_lo = (uint32_t) (low / 1000000000u);
+    r = (uint32_t) (low % 1000000000u);
+#endif
+    *rem = r;
+    return ((uint64_t) q_hi << 32) | q_lo;
+}
+
+/**
+ * Convert an unsigned value to decimal
+ *
+ * @param value Value to convert
+ * @param str   Destination, at least 11 bytes
+ * @return      Number of digits written (not counting the null terminator)
+ */
+size_t utoa10(uint32_t value, char* str) {
+    size_t len = dec_digits(value);
+    put_dec(value, str + len, len);
+    str[len] = '\0';
+    return len;
+}
+
+/**
+ * Convert an unsigned value to lowercase hexadecimal without leading zeros
+ *
+ * @param value Value to convert
+ * @param str   Destination, at least 9 bytes
+ * @return      Number of digits written (not counting the null terminator)
+ */
+size_t utoa16(uint32_t value, char* str) {
+    size_t len = value ? (size_t) (32 - __builtin_clz(value) + 3) / 4 : 1;
+    char* p = str + len;
+    *p = '\0';
+    do {
+        *--p = hex_digits[value & 0xF];
+        value >>= 4;
+    } while (p > str);
+    return len;
+}
+
+/**
+ * Convert a 64-bit unsigned value to decimal
+ *
+ * @param value Value to convert
+ * @param str   Destination, at least 21 bytes
+ * @return      Number of digits written (not counting the null terminator)
+ */
+size_t utoa10_64(uint64_t value, char* str) {
+    /* Up to three pieces: the leading digits (fit in 32 bits), then nine digits each */
+    uint32_t pieces[2];
+    size_t count = 0;
+    while (value > UINT32_MAX) {
+        value = div_1e9(value, &pieces[count++]);
+    }
+    size_t len = utoa10((uint32_t) value, str);
+    while (count > 0) {
+        put_dec(pieces[--count], str + len + 9, 9);
+        len += 9;
+    }
+    str[len] = '\0';
+    return len;
+}
+
+/**
+ * Convert a 64-bit unsigned value to lowercase hexadecimal without leading zeros
+ *
+ * @param value Value to convert
+ * @param str   Destination, at least 17 bytes
+ * @return      Number of digits written (not counting the null terminator)
+ */
+size_t utoa16_64(uint64_t value, char* str) {
+    uint32_t hi = (uint32_t) (value >> 32);
+    uint32_t lo = (uint32_t) value;
+    if (hi == 0) {
+        return utoa16(lo, str);
+    }
+    size_t len = utoa16(hi, str);
+    for (size_t i = 8; i > 0; i--) {
+        str[len + i - 1] = hex_digits[lo & 0xF];
+        lo >>= 4;
+    }
+    len += 8;
+    str[len] = '\0';
+    return len;
+}
@@ -1,11 +1,17 @@
 #include <string.h>
 
+#include "word.h"
+
 /**
-* Compares two memory regions byte by byte
+* Compares two memory regions
 *
 * Compares the first 'size' bytes of memory regions pointed to by 'aptr' and 'bptr'.
 * The comparison is done treating data as unsigned chars.
 *
+* Equal prefixes are skipped four bytes at a time (unaligned loads are fine
+* on x86, and they never read past 'size'); the first differing word
+* is then resolved byte by byte.
+*
 * @param aptr Pointer to first memory region
 * @param bptr Pointer to second memory region
 * @param size Number of bytes to compare
@@ -17,7 +23,11 @@
 int memcmp(const void* aptr, const void* bptr, size_t size) {
     const unsigned char* a = (const unsigned char*) aptr;
     const unsigned char* b = (const unsigned char*) bptr;
-    for (size_t i = 0; i < size; i++) {
+    size_t i = 0;
+    while (i + 4 <= size && *(const string_word_t*) (a + i) == *(const string_word_t*) (b + i)) {
+        i += 4;
+    }
+    for (; i < size; i++) {
         if (a[i] < b[i]) {
             return -1;
         }
@@ -1,5 +1,9 @@
+#include <stdint.h>
 #include <string.h>
 
+/* Below this size the setup of rep movs costs more than a byte loop */
+#define MEMMOVE_REP_THRESHOLD   16
+
 /**
 * Copies a memory region to another (possibly overlapping) region
 *
@@ -8,6 +12,10 @@
 * by choosing the appropriate copy direction based on relative positions
 * of source and destination.
 *
+* Larger moves use rep movsd like memcpy. A backward move runs with the
+* direction flag set, aligning the end of the destination first; the flag
+* is cleared again before returning.
+*
 * @param dstptr Pointer to destination memory region
 * @param srcptr Pointer to source memory region
 * @param size   Number of bytes to copy
@@ -17,15 +25,54 @@
 void* memmove(void* dstptr, const void* srcptr, size_t size) {
     unsigned char* dst = (unsigned char*) dstptr;
     const unsigned char* src = (const unsigned char*) srcptr;
-    if (dst < src) {
-        for (size_t i = 0; i < size; i++) {
-            dst[i] = src[i];
+    if (size < MEMMOVE_REP_THRESHOLD) {
+        if (dst < src) {
+            for (size_t i = 0; i < size; i++) {
+                dst[i] = src[i];
+            }
+        }
+        else {
+            for (size_t i = size; i != 0; i--) {
+                dst[i - 1] = src[i - 1];
+            }
         }
+        return dstptr;
+    }
+    if (dst < src || dst >= src + size) {
+        /* Forward: a word is always read before the copy can overwrite it */
+        size_t head = -(uintptr_t) dst & 3;
+        size_t words = (size - head) / 4;
+        size_t tail = (size - head) & 3;
+        asm volatile("rep movsb\n\t"
+                     "mov %[words], %%ecx\n\t"
+                     "rep movsl\n\t"
+                     "mov %[tail], %%ecx\n\t"
+                     "rep movsb"
+                     : "+D"(dst), "+S"(src), "+c"(head)
+                     : [words] "rm"(words), [tail] "rm"(tail)
+                     : "memory");
     }
     else {
-        for (size_t i = size; i != 0; i--) {
-            dst[i - 1] = src[i - 1];
-        }
+        /* Backward from the last byte: align the destination end, then words, then the head */
+        unsigned char* dst_last = dst + size - 1;
+        const unsigned char* src_last = src + size - 1;
+        size_t tail = (uintptr_t) (dst + size) & 3;
+        size_t words = (size - tail) / 4;
+        size_t head = (size - tail) & 3;
+        asm volatile("std\n\t"
+                     "rep movsb\n\t"
+                     "sub $3, %%edi\n\t"
+                     "sub $3, %%esi\n\t"
+                     "mov %[words], %%ecx\n\t"
+                     "rep movsl\n\t"
+                     "add $3, %%edi\n\t"
+                     "add $3, %%esi\n\t"
+                     "mov %[head], %%ecx\n\t"
+                     "rep movsb\n\t"
+                     "cld"
+                     : "+D"(dst_last), "+S"(src_last), "+c"(tail)
+                     : [words] "rm"(words), [head] "rm"(head)
+                     : "memory", "cc");
     }
     return dstptr;
 }
@@ -1,11 +1,49 @@
+#include <stdint.h>
 #include <string.h>
 
+#if defined(__is_libk)
+#include <kernel/fpu.h>
+#endif
+
+/* Below this size the setup of rep stos costs more than a byte loop */
+#define MEMSET_REP_THRESHOLD    16
+/* From this size (a page, say) 64-byte SSE stores beat rep stosd, even when a thread's FPU state must be saved first */
+#define MEMSET_SSE_THRESHOLD    1024
+
+#if defined(__is_libk)
+/**
+ * Fill 64-byte blocks with SSE (inside kernel_fpu_begin(), buf 16-byte aligned)
+ *
+ * The kernel is built without SSE, so the compiler keeps nothing in xmm0.
+ */
+static inline void memset_sse_blocks(unsigned char* buf, uint32_t pattern, size_t blocks) {
+    uint32_t fill[4] = { pattern, pattern, pattern, pattern };
+    asm volatile("movups (%2), %%xmm0\n\t"
+                 "1:\n\t"
+                 "movaps %%xmm0, (%0)\n\t"
+                 "movaps %%xmm0, 16(%0)\n\t"
+                 "movaps %%xmm0, 32(%0)\n\t"
+                 "movaps %%xmm0, 48(%0)\n\t"
+                 "add $64, %0\n\t"
+                 "dec %1\n\t"
+                 "jnz 1b"
+                 : "+r"(buf), "+r"(blocks)
+                 : "r"(fill), "m"(fill)
+                 : "memory", "cc");
+}
+#endif
+
 /**
 * Fills a memory region with a specified byte value
 *
 * Sets 'size' bytes of memory starting at 'bufptr' to the specified value.
 * The value is truncated to an unsigned char.
 *
+* Larger fills repeat the byte into a 32-bit pattern and store it with
+* rep stosd between an aligning head and a tail of single bytes. In the
+* kernel, fills of MEMSET_SSE_THRESHOLD bytes or more store the bulk in
+* 64-byte SSE blocks instead, if kernel_fpu_begin() lends the registers.
+*
 * @param bufptr Pointer to the memory region to fill
 * @param value  Value to write (converted to unsigned char)
 * @param size   Number of bytes to fill
@@ -14,8 +52,34 @@
 */
 void* memset(void* bufptr, int value, size_t size) {
     unsigned char* buf = (unsigned char*) bufptr;
-    for (size_t i = 0; i < size; i++) {
-        buf[i] = (unsigned char) value;
+    if (size < MEMSET_REP_THRESHOLD) {
+        for (size_t i = 0; i < size; i++) {
+            buf[i] = (unsigned char) value;
+        }
+        return bufptr;
+    }
+    uint32_t pattern = (unsigned char) value * 0x01010101u;
+#if defined(__is_libk)
+    if (size >= MEMSET_SSE_THRESHOLD && kernel_fpu_begin()) {
+        size_t head = -(uintptr_t) buf & 15;
+        size_t bulk = (size - head) & ~(size_t) 63;
+        size -= head + bulk;
+        asm volatile("rep stosb" : "+D"(buf), "+c"(head) : "a"(pattern) : "memory");
+        memset_sse_blocks(buf, pattern, bulk / 64);
+        kernel_fpu_end();
+        buf += bulk;
     }
+#endif
+    size_t head = -(uintptr_t) buf & 3;
+    size_t words = (size - head) / 4;
+    size_t tail = (size - head) & 3;
+    asm volatile("rep stosb\n\t"
+                 "mov %[words], %%ecx\n\t"
+                 "rep stosl\n\t"
+                 "mov %[tail], %%ecx\n\t"
+                 "rep stosb"
+                 : "+D"(buf), "+c"(head)
+                 : "a"(pattern), [words] "rm"(words), [tail] "rm"(tail)
+                 : "memory");
     return bufptr;
 }
@@ -1,17 +1,37 @@
 #include <stddef.h>
 
+#include "word.h"
+
 /**
  * Locate character in string
  *
  * Searches for the first occurrence of character c in the string pointed to by str. The null terminator is considered
  * part of the string, so searching for '\0' will return a pointer to the null terminator.
  *
+ * Aligned words that contain neither the terminator nor c are skipped four bytes at a time.
+ *
  * @param str  Pointer to the string to be searched
  * @param c    Character to search for (passed as int, but converted to char)
  * @return     Pointer to the first occurrence of c in str, or NULL if not found
  */
 char* strchr(const char* str, int c) {
-    // Loop through each character in the string
+    // Reach an aligned address one character at a time
+    while (!WORD_ALIGNED(str)) {
+        if (*str == '\0' || *str == (char) c) {
+            break;
+        }
+        str++;
+    }
+    if (WORD_ALIGNED(str)) {
+        // Skip whole words that cannot contain the answer
+        uint32_t pattern = (unsigned char) c * WORD_ONES;
+        const string_word_t* w = (const string_word_t*) str;
+        while (!WORD_HAS_ZERO(*w) && !WORD_HAS_BYTE(*w, pattern)) {
+            w++;
+        }
+        str = (const char*) w;
+    }
+    // Loop through the remaining characters in the string
     while (*str != '\0') {
         if (*str == (char) c) {
             return (char *) str;	// Return a pointer to the character
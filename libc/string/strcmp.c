@@ -1,8 +1,14 @@
 #include <string.h>
 
+#include "word.h"
+
 /**
  * Compare two strings lexicographically
  *
+ * When both strings reach word alignment together, equal words without a
+ * terminator are skipped four bytes at a time; the final difference is found
+ * byte by byte.
+ *
  * @param s1 Pointer to the first string to be compared
  * @param s2 Pointer to the second string to be compared
  * @return   Integer result of comparison:
@@ -11,6 +17,20 @@
  *           - Positive value if s1 is greater than s2
  */
 int strcmp(const char *s1, const char *s2) {
+    while (!WORD_ALIGNED(s1) && *s1 && (*s1 == *s2)) {
+        s1++;
+        s2++;
+    }
+    if (WORD_ALIGNED(s1) && WORD_ALIGNED(s2)) {
+        const string_word_t* w1 = (const string_word_t*) s1;
+        const string_word_t* w2 = (const string_word_t*) s2;
+        while (*w1 == *w2 && !WORD_HAS_ZERO(*w1)) {
+            w1++;
+            w2++;
+        }
+        s1 = (const char*) w1;
+        s2 = (const char*) w2;
+    }
     while (*s1 && (*s1 == *s2)) {
         s1++;
         s2++;
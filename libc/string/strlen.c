@@ -1,18 +1,34 @@
 #include <string.h>
 
+#include "word.h"
+
 /**
  * Calculates the length of a null-terminated string
  *
  * Counts characters until a null terminator ('\0') is found.
  * The null terminator is not included in the returned length.
  *
+ * After reaching an aligned address the string is scanned a word at a time,
+ * stopping at the first word that contains a zero byte.
+ *
  * @param str Pointer to the null-terminated string
  * @return Number of characters in the string before the null terminator
  */
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (str[len]) {
-        len++;
+    const char* s = str;
+    while (!WORD_ALIGNED(s)) {
+        if (*s == '\0') {
+            return s - str;
+        }
+        s++;
+    }
+    const string_word_t* w = (const string_word_t*) s;
+    while (!WORD_HAS_ZERO(*w)) {
+        w++;
+    }
+    s = (const char*) w;
+    while (*s) {
+        s++;
     }
-    return len;
+    return s - str;
 }
@@ -0,0 +1,30 @@
+#ifndef LIBC_STRING_WORD_H
+#define LIBC_STRING_WORD_H
+
+#include <stdint.h>
+
+/**
+ * Helpers for word-at-a-time string functions (private to libc/string)
+ * Based on: https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord
+ *
+ * Strings are scanned four bytes at a time from an aligned address. An
+ * aligned 32-bit load never crosses a page boundary, so reading a few bytes
+ * past the terminator cannot fault.
+ */
+
+/* 32-bit load that may alias any object */
+typedef uint32_t __attribute__((__may_alias__)) string_word_t;
+
+#define WORD_ONES       0x01010101u
+#define WORD_HIGHS      0x80808080u
+
+/* Non-zero if any byte of w is zero */
+#define WORD_HAS_ZERO(w)    (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+
+/* Non-zero if any byte of w equals the byte repeated in pattern */
+#define WORD_HAS_BYTE(w, pattern)   WORD_HAS_ZERO((w) ^ (pattern))
+
+/* True if p is 4-byte aligned */
+#define WORD_ALIGNED(p)     (((uintptr_t) (p) & 3) == 0)
+
+#endif
@@ -0,0 +1,100 @@
+#include <stdint.h>
+#include <sys/ioring.h>
+#include <sys/syscall.h>
+
+/**
+ * Batched system call helpers on top of SYS_ioring_setup / SYS_ioring_enter.
+ *
+ * The ring is shared with the kernel, so the order of stores matters: an
+ * entry is written completely before sq_tail moves past it, and a completion
+ * is read only after cq_tail was seen past it (__sync_synchronize()).
+ */
+
+/**
+ * Create the process's ring
+ */
+int ioring_init(struct ioring* ring, unsigned entries, unsigned flags) {
+    long addr = syscall(SYS_ioring_setup, (long) entries, (long) flags, 0L, 0L, 0L);
+    if (addr == -1) {
+        return -1;
+    }
+    ring->header = (struct ioring_header*) addr;
+    ring->sqes = (struct ioring_sqe*) ((uint8_t*) addr + ring->header->sq_offset);
+    ring->cqes = (struct ioring_cqe*) ((uint8_t*) addr + ring->header->cq_offset);
+    ring->sq_mask = ring->header->sq_entries - 1;
+    ring->cq_mask = ring->header->cq_entries - 1;
+    ring->sq_tail = ring->header->sq_tail;
+    ring->setup_flags = flags;
+    return 0;
+}
+
+/**
+ * Next free submission entry
+ */
+struct ioring_sqe* ioring_get_sqe(struct ioring* ring) {
+    if (ring->sq_tail - ring->header->sq_head > ring->sq_mask) {
+        return 0;  /* The kernel hasn't consumed enough entries yet */
+    }
+    struct ioring_sqe* sqe = &ring->sqes[ring->sq_tail & ring->sq_mask];
+    ring->sq_tail++;
+    return sqe;
+}
+
+/**
+ * Fill a submission entry
+ */
+void ioring_prep_rw(struct ioring_sqe* sqe, int op, int fd, const void* buf, unsigned len, uint32_t user_data) {
+    sqe->opcode = (uint8_t) op;
+    sqe->flags = 0;
+    sqe->fd = fd;
+    sqe->addr = (uint32_t) buf;
+    sqe->len = len;
+    sqe->user_data = user_data;
+}
+
+/**
+ * Publish and start the new entries
+ */
+int ioring_submit(struct ioring* ring) {
+    uint32_t pending = ring->sq_tail - ring->header->sq_tail;
+    __sync_synchronize();  /* Entries are complete before the kernel can see the new tail */
+    ring->header->sq_tail = ring->sq_tail;
+    if (ring->setup_flags & IORING_SETUP_SQPOLL) {
+        __sync_synchronize();  /* Pairs with the polling thread's flag store before it re-checks the tail */
+        if (ring->header->flags & IORING_SQ_NEED_WAKEUP) {
+            syscall(SYS_ioring_enter, 0L, 0L, (long) IORING_ENTER_SQ_WAKEUP, 0L, 0L);
+        }
+        return (int) pending;
+    }
+    return (int) syscall(SYS_ioring_enter, (long) pending, 0L, 0L, 0L, 0L);
+}
+
+/**
+ * Wait for completions
+ */
+int ioring_wait(struct ioring* ring, unsigned count) {
+    if (ring->header->cq_tail - ring->header->cq_head >= count) {
+        return 0;
+    }
+    return syscall(SYS_ioring_enter, 0L, (long) count, (long) IORING_ENTER_GETEVENTS, 0L, 0L) == -1 ? -1 : 0;
+}
+
+/**
+ * Oldest unconsumed completion
+ */
+struct ioring_cqe* ioring_peek_cqe(struct ioring* ring) {
+    uint32_t head = ring->header->cq_head;
+    if (head == ring->header->cq_tail) {
+        return 0;
+    }
+    __sync_synchronize();  /* Read the entry only after seeing the tail that published it */
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+/**
+ * Consume a completion
+ */
+void ioring_cqe_seen(struct ioring* ring) {
+    __sync_synchronize();  /* Done reading the entry before the kernel may reuse it */
+    ring->header->cq_head++;
+}
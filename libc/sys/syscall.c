@@ -1,10 +1,14 @@
+#include <stdio.h>
 #include <sys/syscall.h>
+#include <sys/mman.h>
 
 /**
  * System call wrapper implementations for user space.
  * 
  * These functions use inline assembly to trigger the system call interrupt (int 0x80). The kernel system call handler
  * reads the syscall number from EAX and arguments from other registers (EBX, ECX, EDX, etc.).
+ * In user space, write(), read() and syscall() use the faster SYSENTER instruction instead when the CPU has it;
+ * the kernel (libk) always uses int 0x80, since SYSEXIT can only return to ring 3.
  * 
  * Linux i386 syscall convention:
  * - EAX: syscall number (input) / return value (output)
@@ -35,6 +39,57 @@
  * @see https://wiki.osdev.org/Inline_Assembly/Examples
  */
 
+#if !defined(__is_libk)
+/* SYSENTER support: -1 until probed, then 0 or 1 */
+static int sysenter_state = -1;
+
+/**
+ * Check once whether the CPU has SYSENTER (CPUID leaf 1, EDX bit 11)
+ *
+ * The kernel programs the SYSENTER MSRs whenever the CPU has them, so the
+ * feature bit alone decides. The Pentium Pro sets SEP without supporting it
+ * (family 6, model < 3, stepping < 3).
+ */
+static int use_sysenter(void) {
+    if (sysenter_state < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1), "c" (0));
+        unsigned int family = (eax >> 8) & 0xF, model = (eax >> 4) & 0xF, stepping = eax & 0xF;
+        sysenter_state = (edx & (1u << 11)) && !(family == 6 && model < 3 && stepping < 3);
+    }
+    return sysenter_state;
+}
+
+/**
+ * Make a system call through SYSENTER.
+ *
+ * SYSENTER saves no return state, so the kernel finds it on our stack: EBP holds
+ * the stack pointer with the return address (label 1) on top. SYSEXIT comes back
+ * to that label with ESP = EBP + 4, where the saved EBP is popped.
+ *
+ * Inline Assembly Breakdown:
+ * - "push %%ebp"       : Save EBP (the compiler may be using it as frame pointer)
+ * - "push $1f"         : Return address for SYSEXIT
+ * - "mov %%esp, %%ebp" : Pass the user stack to the kernel
+ * - "+c" / "+d"        : Arguments 2 and 3 go in, the kernel returns the user ESP/EIP in them
+ */
+static long sysenter_syscall(long number, long arg1, long arg2, long arg3, long arg4, long arg5) {
+    long ret;
+    asm volatile (
+        "push %%ebp\n\t"
+        "push $1f\n\t"
+        "mov %%esp, %%ebp\n\t"
+        "sysenter\n"
+        "1:\n\t"
+        "pop %%ebp"
+        : "=a" (ret), "+c" (arg2), "+d" (arg3)
+        : "0" (number), "b" (arg1), "S" (arg4), "D" (arg5)
+        : "memory"
+    );
+    return ret;
+}
+#endif
+
 /**
  * Write data to a file descriptor.
  * 
@@ -48,6 +103,11 @@
  * - "memory"           : Clobber - tell compiler memory might change (syscall side effects)
  */
 ssize_t write(int fd, const void *buf, size_t count) {
+#if !defined(__is_libk)
+    if (use_sysenter()) {
+        return (ssize_t) sysenter_syscall(SYS_WRITE, fd, (long) buf, (long) count, 0, 0);
+    }
+#endif
     ssize_t ret;
     asm volatile (
         "int $0x80"                 /* Trigger syscall interrupt */
@@ -71,6 +131,11 @@ ssize_t write(int fd, const void *buf, size_t count) {
  * - "memory"           : Clobber - tell compiler memory might change (buffer will be filled)
  */
 ssize_t read(int fd, void *buf, size_t count) {
+#if !defined(__is_libk)
+    if (use_sysenter()) {
+        return (ssize_t) sysenter_syscall(SYS_READ, fd, (long) buf, (long) count, 0, 0);
+    }
+#endif
     ssize_t ret;
     asm volatile (
         "int $0x80"                 /* Trigger syscall interrupt */
@@ -81,8 +146,113 @@ ssize_t read(int fd, void *buf, size_t count) {
     return ret;
 }
 
+/**
+ * Open a file.
+ *
+ * Goes through syscall(), so user space takes the SYSENTER path when it can.
+ * No mode argument is read: files can't be created.
+ */
+int open(const char *path, int flags, ...) {
+    return (int) syscall(SYS_OPEN, (long) path, (long) flags, 0L, 0L, 0L);
+}
+
+/**
+ * Close a file descriptor.
+ */
+int close(int fd) {
+    return (int) syscall(SYS_CLOSE, (long) fd, 0L, 0L, 0L, 0L);
+}
+
+/**
+ * Move the offset of an open file.
+ */
+off_t lseek(int fd, off_t offset, int whence) {
+    return (off_t) syscall(SYS_LSEEK, (long) fd, (long) offset, (long) whence, 0L, 0L);
+}
+
+/**
+ * Map a file or anonymous memory.
+ *
+ * SYS_MMAP takes its six arguments in memory (Linux old_mmap), EBX pointing to them.
+ */
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    long args[6] = { (long) addr, (long) length, prot, flags, fd, offset };
+    return (void *) syscall(SYS_MMAP, (long) args, 0L, 0L, 0L, 0L);
+}
+
+/**
+ * Give memory back to the kernel, or advise on how it will be used.
+ */
+int madvise(void *addr, size_t length, int advice) {
+    return (int) syscall(SYS_MADVISE, (long) addr, (long) length, (long) advice, 0L, 0L);
+}
+
+/* Program break as last returned by the kernel, 0 until the first call */
+static uintptr_t current_break = 0;
+
+/**
+ * Set the end of the heap.
+ *
+ * The kernel returns the break after the call, which is the old one if it refused.
+ */
+int brk(void *addr) {
+    current_break = (uintptr_t) syscall(SYS_BRK, (long) addr, 0L, 0L, 0L, 0L);
+    return current_break == (uintptr_t) addr ? 0 : -1;
+}
+
+/**
+ * Move the end of the heap by increment bytes.
+ */
+void *sbrk(intptr_t increment) {
+    if (current_break == 0) {
+        current_break = (uintptr_t) syscall(SYS_BRK, 0L, 0L, 0L, 0L, 0L);
+    }
+    uintptr_t old = current_break;
+    if (increment != 0 && brk((void *) (old + increment)) != 0) {
+        return (void *) -1;
+    }
+    return (void *) old;
+}
+
+/**
+ * Remove a mapping.
+ */
+int munmap(void *addr, size_t length) {
+    return (int) syscall(SYS_MUNMAP, (long) addr, (long) length, 0L, 0L, 0L);
+}
+
+/**
+ * Duplicate the calling process.
+ *
+ * Inline Assembly Breakdown:
+ * - "int $0x80"        : Trigger software interrupt 0x80 (syscall entry point)
+ * - "=a" (ret)         : Output - child's PID in the parent, 0 in the child
+ * - "a" (2)            : Input - load 2 (SYS_FORK) into EAX register
+ * - "memory"           : Clobber - after the call, writes reach private copies of shared pages
+ */
+pid_t fork(void) {
+    pid_t ret;
+    asm volatile (
+        "int $0x80"                 /* Trigger syscall interrupt; returns twice */
+        : "=a" (ret)                /* Output: EAX → ret (child PID, or 0 in the child) */
+        : "a" (2)                   /* Input: EAX=2 (SYS_FORK) */
+        : "memory"                  /* Clobbers: memory may be modified */
+    );
+    return ret;
+}
+
 /**
  * Exit the current user mode program.
+ *
+ * Flushes buffered stdio output, then terminates with _exit().
+ */
+void exit(int status) {
+    fflush(NULL);
+    _exit(status);
+}
+
+/**
+ * Terminate immediately (POSIX _exit), without flushing stdio buffers.
  * 
  * Inline Assembly Breakdown:
  * - "int $0x80"        : Trigger software interrupt 0x80 (syscall entry point)
@@ -91,7 +261,7 @@ ssize_t read(int fd, void *buf, size_t count) {
  * - "b" (status)       : Input - load 'status' into EBX register (exit code)
  * - No clobbers needed : Function never returns, so compiler state doesn't matter
  */
-void exit(int status) {
+void _exit(int status) {
     asm volatile (
         "int $0x80"                 /* Trigger syscall interrupt - never returns */
         :                           /* No outputs - this syscall terminates the process */
@@ -101,13 +271,6 @@ void exit(int status) {
     while (1);
 }
 
-/**
- * Alternate name for exit (POSIX _exit).
- */
-void _exit(int status) {
-    exit(status);
-}
-
 /**
  * Generic system call interface.
  * 
@@ -149,6 +312,12 @@ long syscall(long number, ...) {
     arg5 = __builtin_va_arg(args, long);
     
     __builtin_va_end(args);
+
+#if !defined(__is_libk)
+    if (use_sysenter()) {
+        return sysenter_syscall(number, arg1, arg2, arg3, arg4, arg5);
+    }
+#endif
     
     /* Make the system call - all 6 registers set up per Linux i386 ABI */
     asm volatile (
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__is_libk)
+#include <kernel/timer.h>
+#endif
+
+#define NS_PER_SEC  1000000000ULL
+
+#if !defined(__is_libk)
+/**
+ * Read the Time Stamp Counter (allowed in ring 3: the kernel leaves CR4.TSD clear)
+ */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+/**
+ * Nanoseconds since boot from the clock page, the same way ktime_ns() computes them
+ *
+ * seq is odd while the timer IRQ updates the page; a read that overlapped an
+ * update sees seq change and is retried.
+ */
+static uint64_t vclock_ns(void) {
+    const struct vclock* clock = (const struct vclock*) VCLOCK_PAGE_ADDR;
+    uint32_t seq;
+    uint64_t base, at;
+    do {
+        seq = clock->seq;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        base = clock->tick_time;
+        at = clock->tick_tsc;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    } while ((seq & 1) || seq != clock->seq);
+    if (!(clock->flags & VCLOCK_TSC)) {
+        return base;
+    }
+    uint64_t offset = ((rdtsc() - at) * clock->tsc_ns_mult) >> clock->tsc_ns_shift;
+    return base + (offset < clock->tick_ns ? offset : clock->tick_ns);
+}
+#endif
+
+/**
+ * Get the time of a clock
+ *
+ * The kernel (libk) asks the timer directly; processes read the clock page.
+ */
+int clock_gettime(clockid_t clock_id, struct timespec* tp) {
+    if (clock_id != CLOCK_MONOTONIC && clock_id != CLOCK_BOOTTIME) {
+        return -1;
+    }
+#if defined(__is_libk)
+    uint64_t ns = ktime_ns();
+#else
+    uint64_t ns = vclock_ns();
+#endif
+    tp->tv_sec = (time_t) (ns / NS_PER_SEC);
+    tp->tv_nsec = (long) (ns % NS_PER_SEC);
+    return 0;
+}
@@ -2,6 +2,15 @@
 set -e
 . ./iso.sh
 
+# disk.img, if present, becomes the primary master ATA disk (hda): qemu-img create -f raw disk.img 64M
+DISK=""
+if [ -f disk.img ]; then
+  DISK="-drive file=disk.img,format=raw,if=ide,index=0"
+fi
+
+# -netdev/-device: user-mode networking (NAT to the host, gateway 10.0.2.2) on a virtio NIC (eth0)
+NET="-netdev user,id=net0 -device virtio-net-pci,netdev=net0"
+
 # -cdrom olympos.iso: Use the Olympos ISO image as a CD-ROM
 # -serial file:serial.log: Redirect serial port output to a log file for debugging
-qemu-system-$(./target-triplet-to-arch.sh $HOST) -cdrom olympos.iso -serial file:serial.log
+qemu-system-$(./target-triplet-to-arch.sh $HOST) -cdrom olympos.iso -serial file:serial.log $DISK $NET
@@ -0,0 +1,181 @@
+import argparse
+import bisect
+import struct
+import subprocess
+import sys
+import zlib
+
+# Layout of kernel/include/kernel/crashdump.h (all little-endian)
+MAGIC = b"OLYCRASH"
+VERSION = 1
+HEADER = struct.Struct("<8sI")
+SECTION = struct.Struct("<HHI")
+REGS = struct.Struct("<23I")
+TRACE_RECORD = struct.Struct("<QIHHII")
+HEAP_SLAB_CLASSES = 8
+HEAP = struct.Struct(f"<3I{3 * HEAP_SLAB_CLASSES}I")
+
+SECTION_REASON = 1
+SECTION_REGS = 2
+SECTION_BACKTRACE = 3
+SECTION_STACK = 4
+SECTION_TRACE = 5
+SECTION_HEAP = 6
+SECTION_END = 0xFFFF
+
+REGS_FIELDS = [
+    "ds", "edi", "esi", "ebp", "esp_dummy", "ebx", "edx", "ecx", "eax", "int_no", "err_code",
+    "eip", "cs", "eflags", "useresp", "ss", "esp", "cr0", "cr2", "cr3", "cr4", "thread", "flags",
+]
+REGS_TRAP = 0x1
+
+# trace_event_names[] in kernel/arch/i386/trace.c
+TRACE_EVENTS = ["irq", "syscall", "page_fault", "sched_switch", "kmalloc", "kfree", "mark"]
+
+
+class Symbols:
+    """Function symbols of the kernel ELF, from nm"""
+
+    def __init__(self, kernel, nm):
+        self.starts = []
+        self.names = []
+        if kernel is None:
+            return
+        result = subprocess.run([nm, "-n", "--defined-only", kernel], capture_output=True, text=True, check=True)
+        for line in result.stdout.splitlines():
+            parts = line.split()
+            if len(parts) == 3 and parts[1] in "tTwW":
+                self.starts.append(int(parts[0], 16))
+                self.names.append(parts[2])
+
+    def lookup(self, addr):
+        """name+offset of the function containing addr, or None"""
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i < 0 or not self.names:
+            return None
+        offset = addr - self.starts[i]
+        # Past the last function: data, not code
+        if i == len(self.starts) - 1 and offset > 0x10000:
+            return None
+        return f"{self.names[i]}+0x{offset:x}"
+
+    def describe(self, addr):
+        name = self.lookup(addr)
+        return f"0x{addr:08x} {name}" if name else f"0x{addr:08x}"
+
+
+def parse_dump(data, offset):
+    """Sections of the dump at offset: (sections by type, total size, CRC ok) or raises ValueError"""
+    _, version = HEADER.unpack_from(data, offset)
+    if version != VERSION:
+        raise ValueError(f"version {version}, this tool reads {VERSION}")
+    pos = offset + HEADER.size
+    sections = {}
+    while True:
+        if pos + SECTION.size > len(data):
+            raise ValueError("truncated (no END section)")
+        kind, _, length = SECTION.unpack_from(data, pos)
+        payload_at = pos + SECTION.size
+        if payload_at + length > len(data):
+            raise ValueError(f"truncated in section {kind}")
+        payload = data[payload_at:payload_at + length]
+        if kind == SECTION_END:
+            (crc,) = struct.unpack_from("<I", payload)
+            ok = crc == zlib.crc32(data[offset:pos])
+            return sections, payload_at + length - offset, ok
+        sections[kind] = payload
+        pos = payload_at + (length + 3) // 4 * 4
+
+
+def print_dump(sections, symbols, crc_ok):
+    if not crc_ok:
+        print("WARNING: CRC mismatch, the dump is damaged")
+    reason = sections.get(SECTION_REASON, b"").decode("utf-8", errors="replace").strip()
+    print(f"Reason: {reason}")
+
+    if SECTION_REGS in sections:
+        regs = dict(zip(REGS_FIELDS, REGS.unpack(sections[SECTION_REGS])))
+        source = f"exception {regs['int_no']}, error code 0x{regs['err_code']:x}" if regs["flags"] & REGS_TRAP \
+            else "panic call site"
+        print(f"Thread {regs['thread']}, {source}")
+        print(f"EIP {symbols.describe(regs['eip'])}")
+        print(f"EAX 0x{regs['eax']:08x}  EBX 0x{regs['ebx']:08x}  ECX 0x{regs['ecx']:08x}  EDX 0x{regs['edx']:08x}")
+        print(f"ESI 0x{regs['esi']:08x}  EDI 0x{regs['edi']:08x}  EBP 0x{regs['ebp']:08x}  ESP 0x{regs['esp']:08x}")
+        print(f"CS 0x{regs['cs']:04x}  DS 0x{regs['ds']:04x}  SS 0x{regs['ss']:04x}  EFLAGS 0x{regs['eflags']:08x}")
+        print(f"CR0 0x{regs['cr0']:08x}  CR2 0x{regs['cr2']:08x}  CR3 0x{regs['cr3']:08x}  CR4 0x{regs['cr4']:08x}")
+
+    if SECTION_BACKTRACE in sections:
+        payload = sections[SECTION_BACKTRACE]
+        print("Backtrace:")
+        for (pc,) in struct.iter_unpack("<I", payload):
+            # A return address points after the call; the call itself is one byte back at least
+            name = symbols.lookup(pc - 1)
+            print(f"  0x{pc:08x} {name}" if name else f"  0x{pc:08x}")
+
+    if SECTION_STACK in sections:
+        payload = sections[SECTION_STACK]
+        (base,) = struct.unpack_from("<I", payload)
+        words = payload[4:len(payload) // 4 * 4]
+        print(f"Stack ({len(payload) - 4} bytes from 0x{base:08x}), words that point into functions:")
+        for i, (word,) in enumerate(struct.iter_unpack("<I", words)):
+            name = symbols.lookup(word)
+            if name:
+                print(f"  0x{base + 4 * i:08x}: 0x{word:08x} {name}")
+
+    if SECTION_TRACE in sections:
+        payload = sections[SECTION_TRACE]
+        (count,) = struct.unpack_from("<I", payload)
+        records = [TRACE_RECORD.unpack_from(payload, 4 + i * TRACE_RECORD.size) for i in range(count)]
+        records = [r for r in records if r[1] != 0]
+        print(f"Trace ({len(records)} newest records, times relative to the last):")
+        last = records[-1][0] if records else 0
+        for time, _, event, thread, a, b in records:
+            name = TRACE_EVENTS[event] if event < len(TRACE_EVENTS) else f"event{event}"
+            print(f"  {time - last:>14}  thread {thread:<4} {name:<13} 0x{a:x} 0x{b:x}")
+
+    if SECTION_HEAP in sections:
+        values = HEAP.unpack(sections[SECTION_HEAP])
+        blocks, used, maximum = values[:3]
+        print(f"Heap: {used} / {blocks} blocks used ({maximum} max)")
+        for i in range(HEAP_SLAB_CLASSES):
+            size, slabs, in_use = values[3 + 3 * i:6 + 3 * i]
+            if slabs:
+                print(f"  {size} B: {slabs} slabs, {in_use} objects in use")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Olympos crash dumps from a serial log")
+    parser.add_argument("log", help="Raw serial output (e.g. from -serial file:serial.log)")
+    parser.add_argument("kernel", nargs="?", help="Kernel ELF with symbols (e.g. isodir/boot/olympos.kernel)")
+    parser.add_argument("--nm", default="nm", help="nm to read the symbols with (e.g. i686-elf-nm)")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        data = f.read()
+    symbols = Symbols(args.kernel, args.nm)
+    damaged = False
+    count = 0
+    offset = data.find(MAGIC)
+    while offset >= 0:
+        count += 1
+        print(f"=== Crash dump {count} at byte {offset} ===")
+        try:
+            sections, size, crc_ok = parse_dump(data, offset)
+        except (ValueError, struct.error) as e:
+            print(f"Can't decode: {e}\n")
+            damaged = True
+            offset = data.find(MAGIC, offset + 1)
+            continue
+        print_dump(sections, symbols, crc_ok)
+        print(f"({size} bytes)\n")
+        damaged = damaged or not crc_ok
+        # The stack and trace may hold anything; the next dump starts after this one
+        offset = data.find(MAGIC, offset + size)
+    if count == 0:
+        print("No crash dump in the log")
+        sys.exit(1)
+    sys.exit(1 if damaged else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,193 @@
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+# Add parent directory to path
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from test_framework import OlymposTestFramework
+
+# Kernel that runs the benchmark suite; every BENCH() prints one result line to COM1
+BENCH_KERNEL = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/fpu.h>
+#include <kernel/syscall.h>
+#include <kernel/bench.h>
+
+#include <sys/syscall.h>
+
+void exit_qemu(uint32_t exit_code) {
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}
+
+static uint8_t copy_src[4096], copy_dst[4096];
+
+void kernel_main(unsigned long magic, unsigned long addr) {
+    (void) magic;
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    syscall_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    fpu_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    BENCH("kmalloc_free_64", 1000) {
+        kfree(kmalloc(64));
+    }
+    BENCH("kmalloc_free_4096", 1000) {
+        kfree(kmalloc(4096));
+    }
+    BENCH("frame_alloc_free", 1000) {
+        frame_free(frame_alloc());
+    }
+    BENCH("memcpy_4k", 1000) {
+        memcpy(copy_dst, copy_src, sizeof(copy_dst));
+    }
+    BENCH("memset_4k", 1000) {
+        memset(copy_dst, 0, sizeof(copy_dst));
+    }
+    char buffer[64];
+    BENCH("snprintf_int", 1000) {
+        snprintf(buffer, sizeof(buffer), "%d %u %x", -123456, 4000000000u, 0xdeadbeef);
+    }
+    BENCH("snprintf_u64", 1000) {
+        snprintf(buffer, sizeof(buffer), "%llu %llx", 18446744073709551615ull, 0x123456789abcdefull);
+    }
+    // ioring_enter without a ring returns at once: the int 0x80 round trip
+    BENCH("syscall_roundtrip", 1000) {
+        syscall(SYS_ioring_enter, 0, 0, 0);
+    }
+
+    exit_qemu(0);
+    while (1) {
+        asm volatile("hlt");
+    }
+}
+"""
+
+RESULT_LINE = re.compile(r"^BENCH (\S+) iterations=(\d+) min=(\d+) median=(\d+) p99=(\d+) max=(\d+)", re.M)
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench_baseline.json")
+
+
+def current_commit():
+    try:
+        result = subprocess.run(["git", "rev-parse", "--short", "HEAD"], capture_output=True, text=True)
+        return result.stdout.strip() or "unknown"
+    except OSError:
+        return "unknown"
+
+
+def run_suite(framework):
+    framework.backup_kernel()
+    try:
+        if not framework.create_test_kernel(BENCH_KERNEL):
+            print("Failed to build benchmark kernel")
+            return None
+        if not framework.create_test_iso():
+            print("Failed to create benchmark ISO")
+            return None
+        _, output = framework.run_qemu()
+    finally:
+        framework.restore_kernel()
+
+    results = {}
+    for name, iterations, low, median, p99, high in RESULT_LINE.findall(output):
+        results[name] = {
+            "iterations": int(iterations),
+            "min": int(low),
+            "median": int(median),
+            "p99": int(p99),
+            "max": int(high),
+        }
+    if framework.verbose:
+        print(output)
+    return results
+
+
+def compare(results, baseline, threshold):
+    """Print results next to the baseline; return the names whose median regressed"""
+    regressions = []
+    print(f"{'benchmark':<24}{'median':>10}{'baseline':>10}{'change':>9}{'p99':>10}")
+    for name, result in results.items():
+        base = baseline.get(name)
+        if base is None or base["median"] == 0:
+            print(f"{name:<24}{result['median']:>10}{'-':>10}{'new':>9}{result['p99']:>10}")
+            continue
+        change = (result["median"] - base["median"]) / base["median"]
+        flag = ""
+        if change > threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print(f"{name:<24}{result['median']:>10}{base['median']:>10}{change:>+9.1%}{result['p99']:>10}{flag}")
+    for name in baseline:
+        if name not in results:
+            print(f"{name:<24}{'missing':>10}")
+            regressions.append(name)
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Olympos Benchmark Runner")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="Baseline file (JSON)")
+    parser.add_argument("--save", action="store_true", help="Store this run as the new baseline")
+    parser.add_argument(
+        "--threshold", type=float, default=0.10, help="Flag medians slower than the baseline by this fraction"
+    )
+    parser.add_argument("--verbose", "-v", action="store_true", help="Show build and serial output")
+    args = parser.parse_args()
+
+    framework = OlymposTestFramework()
+    framework.set_verbose(args.verbose)
+    results = run_suite(framework)
+    framework.cleanup()
+    if not results:
+        print("No benchmark results")
+        sys.exit(1)
+
+    commit = current_commit()
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            stored = json.load(f)
+        baseline = stored.get("results", {})
+        print(f"Baseline: commit {stored.get('commit', 'unknown')}, this run: commit {commit}")
+    else:
+        print(f"No baseline at {args.baseline}, this run: commit {commit}")
+
+    regressions = compare(results, baseline, args.threshold)
+
+    if args.save:
+        with open(args.baseline, "w") as f:
+            json.dump({"commit": commit, "results": results}, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Saved baseline to {args.baseline}")
+        sys.exit(0)
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) over {args.threshold:.0%}: {', '.join(regressions)}")
+        sys.exit(1)
+    sys.exit(0)
+
+
+if __name__ == "__main__":
+    main()
@@ -10,15 +10,40 @@ from test_framework import OlymposTestFramework
 from test_printf import register_printf_tests
 from test_serial import register_serial_tests
 from test_assert import register_assert_tests
+from test_string import register_string_tests
 from test_gdt import register_gdt_tests
 from test_interrupt import register_interrupt_tests
 from test_pic import register_pic_tests
 from test_irq import register_irq_tests
+from test_timer import register_timer_tests
+from test_thread import register_thread_tests
+from test_sync import register_sync_tests
+from test_process import register_process_tests
 from test_paging import register_paging_tests
 from test_kheap import register_kheap_tests
+from test_arena import register_arena_tests
 from test_shell import register_shell_tests
 from test_tss import register_tss_tests
 from test_syscall import register_syscall_tests
+from test_debug import register_debug_tests
+from test_profile import register_profile_tests
+from test_trace import register_trace_tests
+from test_bench import register_bench_tests
+from test_softirq import register_softirq_tests
+from test_apic import register_apic_tests
+from test_smp import register_smp_tests
+from test_spinlock import register_spinlock_tests
+from test_fpu import register_fpu_tests
+from test_klog import register_klog_tests
+from test_initcall import register_initcall_tests
+from test_vfs import register_vfs_tests
+from test_ata import register_ata_tests
+from test_pcache import register_pcache_tests
+from test_virtio_net import register_virtio_net_tests
+from test_fbcon import register_fbcon_tests
+from test_keyboard import register_keyboard_tests
+from test_crashdump import register_crashdump_tests
+from test_vmstat import register_vmstat_tests
 
 
 def list_tests(framework):
@@ -33,6 +58,25 @@ def list_tests(framework):
         for test_case in test_cases:
             print(f"  test_{file_name}_{test_case}")
 
+    if framework.ktests:
+        print("\ntest_ktest (in-kernel, kernel/ktest):")
+        for name in framework.ktests:
+            print(f"  test_ktest_{name}")
+
+
+def filter_ktests(framework, test_patterns):
+    filtered = []
+
+    for pattern in test_patterns:
+        # test_ktest runs them all, test_ktest_<suite> one suite, test_ktest_<suite>_<name> one test
+        if pattern == "test_ktest":
+            filtered.extend(framework.ktests)
+        elif pattern.startswith("test_ktest_"):
+            name = pattern[len("test_ktest_") :]
+            filtered.extend(t for t in framework.ktests if t == name or t.startswith(f"{name}_"))
+
+    return list(dict.fromkeys(filtered))
+
 
 def filter_tests(framework, test_patterns):
     filtered = []
@@ -41,6 +85,8 @@ def filter_tests(framework, test_patterns):
         if not pattern.startswith("test_"):
             print(f"Warning: Test names should start with 'test_'. Ignoring '{pattern}'")
             continue
+        if pattern == "test_ktest" or pattern.startswith("test_ktest_"):
+            continue
         # Remove 'test_' prefix
         name = pattern[5:]
         # File-level pattern (e.g., test_printf)
@@ -58,6 +104,9 @@ def main():
     parser.add_argument("tests", nargs="*", help="Tests to run")
     parser.add_argument("--list", action="store_true", help="List all available tests")
     parser.add_argument("--verbose", "-v", action="store_true", help="Show build output")
+    parser.add_argument(
+        "--jobs", "-j", type=int, default=os.cpu_count() or 1, help="QEMU instances for the in-kernel tests"
+    )
     args = parser.parse_args()
 
     framework = OlymposTestFramework()
@@ -67,30 +116,57 @@ def main():
     register_serial_tests(framework)
     register_printf_tests(framework)
     register_assert_tests(framework)
+    register_string_tests(framework)
     register_gdt_tests(framework)
     register_interrupt_tests(framework)
     register_pic_tests(framework)
     register_irq_tests(framework)
+    register_timer_tests(framework)
     register_paging_tests(framework)
     register_kheap_tests(framework)
+    register_thread_tests(framework)
+    register_sync_tests(framework)
+    register_process_tests(framework)
+    register_arena_tests(framework)
     register_shell_tests(framework)
     register_tss_tests(framework)
     register_syscall_tests(framework)
+    register_debug_tests(framework)
+    register_profile_tests(framework)
+    register_trace_tests(framework)
+    register_bench_tests(framework)
+    register_softirq_tests(framework)
+    register_apic_tests(framework)
+    register_smp_tests(framework)
+    register_spinlock_tests(framework)
+    register_fpu_tests(framework)
+    register_klog_tests(framework)
+    register_initcall_tests(framework)
+    register_vfs_tests(framework)
+    register_ata_tests(framework)
+    register_pcache_tests(framework)
+    register_virtio_net_tests(framework)
+    register_fbcon_tests(framework)
+    register_keyboard_tests(framework)
+    register_crashdump_tests(framework)
+    register_vmstat_tests(framework)
+    framework.discover_ktests()
 
     if args.list:
         list_tests(framework)
         sys.exit(0)
     if args.tests:
         framework.tests = filter_tests(framework, args.tests)
-        if not framework.tests:
+        framework.ktests = filter_ktests(framework, args.tests)
+        if not framework.tests and not framework.ktests:
             print(f"No tests found matching: {args.tests}")
             sys.exit(1)
 
-    if not framework.tests:
+    if not framework.tests and not framework.ktests:
         print("No tests to run")
         sys.exit(1)
 
-    success = framework.run_all_tests()
+    success = framework.run_all_tests(args.jobs)
     framework.cleanup()
     sys.exit(0 if success else 1)
 
@@ -0,0 +1,79 @@
+from test_framework import OlymposTestFramework
+
+APIC_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/apic.h>
+#include <kernel/irqstat.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_apic_tests(framework: OlymposTestFramework):
+    # Test 1: The MADT is found and the LAPIC timer keeps the tick rate of the PIT
+    test_body = """
+    if (apic_init() != 0 || !apic_enabled()) {
+        printf("TEST_FAIL: apic_init failed\\n");
+        exit_qemu(1);
+    }
+    timer_initialize(TIMER_DEFAULT_HZ);
+    irq_reset_stats();
+    uint64_t start_ticks = timer_ticks();
+    uint64_t start_ns = ktime_ns();
+    while (ktime_ns() - start_ns < 100 * 1000000ull) {
+        asm volatile("hlt");
+    }
+    uint32_t ticks = (uint32_t) (timer_ticks() - start_ticks);
+    irq_stats_t timer;
+    irq_get_stats(0, &timer);
+    // 100 ms at 1000 Hz; the TSC clock and the tick both come from the calibration
+    if (ticks < 80 || ticks > 120 || timer.count < 80) {
+        printf("TEST_FAIL: %u ticks in 100 ms (%u IRQ 0)\\n", ticks, (uint32_t) timer.count);
+        exit_qemu(1);
+    }
+    printf("%u ticks in 100 ms\\n", ticks);
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="apic_lapic_timer",
+        test_code=APIC_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -0,0 +1,127 @@
+from test_framework import OlymposTestFramework
+
+ARENA_TEST_TEMPLATE = """
+#include <kernel/serial.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/arena.h>
+#include <kernel/multiboot.h>
+#include <stdint.h>
+#include <string.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    serial_setup(SERIAL_COM1_BASE, SERIAL_BAUD_115200);
+    serial_write_string(SERIAL_COM1_BASE, "Arena allocator test starting...\\n");
+
+    paging_init((multiboot_info_t*) addr);
+    kheap_init();
+
+    // Test code
+    {test_body}
+
+    serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_arena_tests(framework: OlymposTestFramework):
+    # Test 1: Bump allocation, alignment and reset
+    test_body = """
+    arena_t arena;
+    if (arena_init(&arena, 4096) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: arena_init failed!\\n");
+        exit_qemu(1);
+    }
+    uint8_t* a = (uint8_t*) arena_alloc(&arena, 3);
+    uint8_t* b = (uint8_t*) arena_alloc(&arena, 10);
+    if (!a || !b || b != a + ARENA_ALIGN || ((uint32_t) b & (ARENA_ALIGN - 1)) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Allocations are not bumped and aligned!\\n");
+        exit_qemu(1);
+    }
+    memset(a, 0x11, 3);
+    memset(b, 0x22, 10);
+
+    // Reset hands out the same memory again
+    arena_reset(&arena);
+    if (arena_alloc(&arena, 3) != a) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: arena_reset did not rewind!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Bump allocation and reset work\\n");
+    arena_destroy(&arena);
+    """
+
+    framework.register_test(
+        name="arena_bump_reset",
+        test_code=ARENA_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 2: Extra chunks, oversized requests and in-place resize
+    test_body = """
+    arena_t arena;
+    if (arena_init(&arena, 4096) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: arena_init failed!\\n");
+        exit_qemu(1);
+    }
+    // Many small objects spill into extra chunks; all must stay intact
+    uint32_t* objs[500];
+    for (int i = 0; i < 500; i++) {
+        objs[i] = (uint32_t*) arena_alloc(&arena, 64);
+        if (!objs[i]) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: arena_alloc failed!\\n");
+            exit_qemu(1);
+        }
+        objs[i][0] = i;
+        objs[i][15] = ~i;
+    }
+    for (uint32_t i = 0; i < 500; i++) {
+        if (objs[i][0] != i || objs[i][15] != ~i) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Arena objects overlap!\\n");
+            exit_qemu(1);
+        }
+    }
+    char* big = (char*) arena_alloc(&arena, 100000);
+    if (!big) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Oversized arena_alloc failed!\\n");
+        exit_qemu(1);
+    }
+    memset(big, 'x', 100000);
+
+    // The most recent allocation grows in place; an older one is copied
+    arena_reset(&arena);
+    char* line = (char*) arena_alloc(&arena, 16);
+    memcpy(line, "olympos", 8);
+    if (arena_realloc(&arena, line, 16, 256) != line) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: arena_realloc did not grow in place!\\n");
+        exit_qemu(1);
+    }
+    arena_alloc(&arena, 8);
+    char* copy = (char*) arena_realloc(&arena, line, 256, 512);
+    if (!copy || copy == line || strcmp(copy, "olympos") != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: arena_realloc copy lost data!\\n");
+        exit_qemu(1);
+    }
+    arena_destroy(&arena);
+    kheap_stats();
+    serial_write_string(SERIAL_COM1_BASE, "Arena chunks and resize work\\n");
+    """
+
+    framework.register_test(
+        name="arena_chunks_realloc",
+        test_code=ARENA_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
@@ -0,0 +1,258 @@
+import os
+import tempfile
+
+from test_framework import OlymposTestFramework
+
+ATA_DISK_SECTORS = 2048
+ATA_DISK_IMAGE = os.path.join(tempfile.gettempdir(), "olympos-ata-test.img")
+
+ATA_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/block.h>
+#include <kernel/ata.h>
+
+#include "../arch/i386/include/irqflags.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+static uint8_t buffer[64 * 512] __attribute__((aligned(4096)));
+
+// The image holds the LBA in the first 4 bytes of each sector, then (lba + offset) & 0xff
+__attribute__((unused)) static int check_sector(const uint8_t* sector, uint32_t lba) {{
+    uint32_t stored;
+    memcpy(&stored, sector, 4);
+    if (stored != lba) {{
+        return 0;
+    }}
+    for (uint32_t i = 4; i < 512; i++) {{
+        if (sector[i] != (uint8_t) (lba + i)) {{
+            return 0;
+        }}
+    }}
+    return 1;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+    ata_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def write_disk_image(path: str):
+    with open(path, "wb") as image:
+        for lba in range(ATA_DISK_SECTORS):
+            sector = bytearray((lba + i) & 0xFF for i in range(512))
+            sector[0:4] = lba.to_bytes(4, "little")
+            image.write(sector)
+
+
+def register_ata_tests(framework: OlymposTestFramework):
+    write_disk_image(ATA_DISK_IMAGE)
+    disk_args = ["-drive", f"file={ATA_DISK_IMAGE},format=raw,if=ide,index=0"]
+
+    # Test 1: The disk is found; aligned buffers go through bus-master DMA, an odd one falls back to PIO
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    block_device_t* dev = block_find("hda");
+    if (dev == NULL || dev->sectors != %d) {
+        printf("TEST_FAIL: hda missing or wrong size\\n");
+        exit_qemu(1);
+    }
+
+    if (block_read(dev, 100, 16, buffer) != 0) {
+        printf("TEST_FAIL: DMA read failed\\n");
+        exit_qemu(1);
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+        if (!check_sector(buffer + i * 512, 100 + i)) {
+            printf("TEST_FAIL: sector %%u has the wrong data\\n", 100 + i);
+            exit_qemu(1);
+        }
+    }
+    ata_stats_t stats;
+    ata_get_stats(dev, &stats);
+    if (stats.dma_requests != 1 || stats.pio_requests != 0) {
+        printf("TEST_FAIL: expected one DMA request, got %%u DMA %%u PIO\\n",
+               (uint32_t) stats.dma_requests, (uint32_t) stats.pio_requests);
+        exit_qemu(1);
+    }
+
+    // Odd address: no PRD entry can describe it
+    if (block_read(dev, 7, 3, buffer + 1) != 0 || !check_sector(buffer + 1, 7) || !check_sector(buffer + 1025, 9)) {
+        printf("TEST_FAIL: PIO read failed\\n");
+        exit_qemu(1);
+    }
+    ata_get_stats(dev, &stats);
+    if (stats.pio_requests != 1 || stats.interrupts != 4) {
+        printf("TEST_FAIL: expected one PIO request and 4 IRQs, got %%u and %%u\\n",
+               (uint32_t) stats.pio_requests, (uint32_t) stats.interrupts);
+        exit_qemu(1);
+    }
+
+    if (block_read(dev, %d, 1, buffer) == 0) {
+        printf("TEST_FAIL: read past the end succeeded\\n");
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """ % (ATA_DISK_SECTORS, ATA_DISK_SECTORS)
+
+    framework.register_test(
+        name="ata_read_dma_pio",
+        test_code=ATA_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=disk_args,
+    )
+
+    # Test 2: Adjacent writes queued behind a busy disk merge into one request and read back
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    block_device_t* dev = block_find("hda");
+    if (dev == NULL) {
+        printf("TEST_FAIL: no hda\\n");
+        exit_qemu(1);
+    }
+    for (uint32_t i = 0; i < 8 * 512; i++) {
+        buffer[i] = (uint8_t) (0xA5 ^ i);
+    }
+
+    // With interrupts off the first write can't complete, so the others queue behind it
+    block_io_t ios[4] = {
+        { .lba = 500, .count = 2, .buffer = buffer, .write = true },
+        { .lba = 602, .count = 2, .buffer = buffer + 2 * 512, .write = true },
+        { .lba = 604, .count = 2, .buffer = buffer + 4 * 512, .write = true },     // back merge
+        { .lba = 600, .count = 2, .buffer = buffer + 6 * 512, .write = true },     // front merge
+    };
+    uint32_t flags = irq_save();
+    for (int i = 0; i < 4; i++) {
+        if (block_submit(dev, &ios[i]) != 0) {
+            printf("TEST_FAIL: submit %%d failed\\n", i);
+            exit_qemu(1);
+        }
+    }
+    irq_restore(flags);
+    for (int i = 0; i < 4; i++) {
+        if (block_wait(&ios[i]) != 0) {
+            printf("TEST_FAIL: write %%d failed\\n", i);
+            exit_qemu(1);
+        }
+    }
+
+    block_stats_t stats;
+    block_get_stats(dev, &stats);
+    if (stats.ios != 4 || stats.merged != 2 || stats.requests != 2 || stats.sectors_written != 8) {
+        printf("TEST_FAIL: ios %%u merged %%u requests %%u written %%u\\n", (uint32_t) stats.ios,
+               (uint32_t) stats.merged, (uint32_t) stats.requests, (uint32_t) stats.sectors_written);
+        exit_qemu(1);
+    }
+
+    // 600..605 holds buffers 3, 1, 2 in LBA order
+    static uint8_t check[6 * 512];
+    if (block_read(dev, 600, 6, check) != 0 || memcmp(check, buffer + 6 * 512, 1024) != 0 ||
+        memcmp(check + 1024, buffer + 2 * 512, 2048) != 0) {
+        printf("TEST_FAIL: merged write didn't read back\\n");
+        exit_qemu(1);
+    }
+    if (block_read(dev, 500, 2, check) != 0 || memcmp(check, buffer, 1024) != 0) {
+        printf("TEST_FAIL: first write didn't read back\\n");
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="ata_write_merge",
+        test_code=ATA_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=disk_args,
+    )
+
+    # Test 3: Queued requests run in C-LOOK order and complete through their callbacks
+    test_helpers = """
+static uint32_t done_order[8];
+static volatile uint32_t done_count = 0;
+
+static void record_done(block_io_t* io) {
+    done_order[done_count++] = io->lba;
+}
+"""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    block_device_t* dev = block_find("hda");
+    if (dev == NULL) {
+        printf("TEST_FAIL: no hda\\n");
+        exit_qemu(1);
+    }
+
+    // The first request is in flight at once; 1000 is next past its end, then the sweep wraps to 50
+    const uint32_t lbas[5] = { 400, 100, 1000, 300, 50 };
+    const uint32_t expected[5] = { 400, 1000, 50, 100, 300 };
+    block_io_t ios[5];
+    uint32_t flags = irq_save();
+    for (int i = 0; i < 5; i++) {
+        ios[i] = (block_io_t) { .lba = lbas[i], .count = 1, .buffer = buffer + i * 512, .done = record_done };
+        block_submit(dev, &ios[i]);
+    }
+    irq_restore(flags);
+    while (done_count < 5) {
+        asm volatile("hlt");
+    }
+
+    for (int i = 0; i < 5; i++) {
+        if (done_order[i] != expected[i] || ios[i].status != 0 || !check_sector(buffer + i * 512, lbas[i])) {
+            printf("TEST_FAIL: completion %%d was LBA %%u\\n", i, done_order[i]);
+            exit_qemu(1);
+        }
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="ata_elevator_order",
+        test_code=ATA_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=disk_args,
+    )
@@ -0,0 +1,98 @@
+from test_framework import OlymposTestFramework
+
+BENCH_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/bench.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_bench_tests(framework: OlymposTestFramework):
+    # Test 1: The body runs once per iteration, the summary is ordered and work costs cycles
+    test_helpers = """
+    static volatile uint32_t bench_sink;
+
+    __attribute__((noinline)) void bench_spin(uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            bench_sink += i;
+        }
+    }
+    """
+    test_body = """
+    uint32_t runs = 0;
+    BENCH("bench_empty", 200) {
+        runs++;
+    }
+    bench_result_t empty = bench_last_result();
+    if (runs != 200 || empty.iterations != 200) {
+        printf("TEST_FAIL: %u runs, %u iterations\\n", runs, empty.iterations);
+        exit_qemu(1);
+    }
+
+    BENCH("bench_spin", 100) {
+        bench_spin(2000);
+    }
+    bench_result_t spin = bench_last_result();
+    if (spin.iterations != 100 || spin.min > spin.median || spin.median > spin.p99 || spin.p99 > spin.max) {
+        printf("TEST_FAIL: Unordered summary %u %u %u %u\\n", spin.min, spin.median, spin.p99, spin.max);
+        exit_qemu(1);
+    }
+    // 2000 dependent adds through memory take well over 2000 cycles
+    if (spin.min < 2000 || spin.median <= empty.median) {
+        printf("TEST_FAIL: spin median %u, empty median %u\\n", spin.median, empty.median);
+        exit_qemu(1);
+    }
+
+    // Out of range iteration counts run nothing
+    runs = 0;
+    BENCH("bench_too_many", BENCH_MAX_ITERATIONS + 1) {
+        runs++;
+    }
+    if (runs != 0) {
+        printf("TEST_FAIL: Oversized benchmark ran %u times\\n", runs);
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+    framework.register_test(
+        name="bench_harness",
+        test_code=BENCH_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="BENCH bench_spin iterations=100 min=",
+    )
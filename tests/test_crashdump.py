@@ -0,0 +1,220 @@
+from test_framework import OlymposTestFramework
+
+CRASHDUMP_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/serial.h>
+#include <kernel/debug.h>
+#include <kernel/trace.h>
+#include <kernel/crashdump.h>
+
+#include "../arch/i386/include/interrupts.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+static uint8_t dump[32768];
+
+// CRC-32 as zlib computes it
+__attribute__((unused)) static uint32_t crc32(const uint8_t* data, size_t len) {{
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < len; i++) {{
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {{
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }}
+    }}
+    return ~crc;
+}}
+
+// Payload of the first section of a type, checking the chain up to END on the way
+__attribute__((unused)) static const uint8_t* section(size_t size, uint16_t type, uint32_t* length) {{
+    size_t pos = sizeof(crashdump_header_t);
+    while (pos + sizeof(crashdump_section_t) <= size) {{
+        const crashdump_section_t* s = (const crashdump_section_t*) (dump + pos);
+        if (s->type == type) {{
+            *length = s->length;
+            return dump + pos + sizeof(*s);
+        }}
+        if (s->type == CRASHDUMP_SECTION_END) {{
+            break;
+        }}
+        pos += sizeof(*s) + (s->length + 3) / 4 * 4;
+    }}
+    printf("TEST_FAIL: no section %u\\n", type);
+    exit_qemu(1);
+    return NULL;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    serial_initialize(SERIAL_COM1_BASE, SERIAL_BAUD_115200);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_crashdump_tests(framework: OlymposTestFramework):
+    # Test 1: A captured dump has every section, the caller's registers and stack, the newest trace records and a CRC
+    test_helpers = ""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    if (trace_start() != 0) {
+        printf("TEST_FAIL: no trace ring\\n");
+        exit_qemu(1);
+    }
+    for (uint32_t i = 0; i < 300; i++) {
+        TRACE(MARK, i, 0);
+    }
+    size_t size = crashdump_capture(dump, sizeof(dump), NULL, "capture test");
+    trace_stop();
+
+    const crashdump_header_t* header = (const crashdump_header_t*) dump;
+    if (size == 0 || memcmp(header->magic, CRASHDUMP_MAGIC, 8) != 0 || header->version != CRASHDUMP_VERSION) {
+        printf("TEST_FAIL: bad header (%u bytes)\\n", (uint32_t) size);
+        exit_qemu(1);
+    }
+    uint32_t length;
+    const uint8_t* end = section(size, CRASHDUMP_SECTION_END, &length);
+    size_t covered = (size_t) (end - dump) - sizeof(crashdump_section_t);
+    if (length != 4 || end + 4 != dump + size || *(const uint32_t*) end != crc32(dump, covered)) {
+        printf("TEST_FAIL: END section or CRC wrong\\n");
+        exit_qemu(1);
+    }
+
+    const uint8_t* reason = section(size, CRASHDUMP_SECTION_REASON, &length);
+    if (length != 12 || memcmp(reason, "capture test", 12) != 0) {
+        printf("TEST_FAIL: reason\\n");
+        exit_qemu(1);
+    }
+
+    // Registers as at the call in kernel_main(), with that frame's stack
+    const crashdump_regs_t* regs = (const crashdump_regs_t*) section(size, CRASHDUMP_SECTION_REGS, &length);
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+    if (length != sizeof(*regs) || regs->flags != 0 || regs->cr3 != cr3 || regs->eip <= (uint32_t) kernel_main ||
+        regs->eip > (uint32_t) kernel_main + 0x2000) {
+        printf("TEST_FAIL: registers (eip %p, cr3 %p)\\n", regs->eip, regs->cr3);
+        exit_qemu(1);
+    }
+    uint32_t lo, hi;
+    debug_stack_bounds(&lo, &hi);
+    const uint32_t* stack = (const uint32_t*) section(size, CRASHDUMP_SECTION_STACK, &length);
+    uint32_t expected = hi - regs->esp < CRASHDUMP_STACK_MAX ? hi - regs->esp : CRASHDUMP_STACK_MAX;
+    if (stack[0] != regs->esp || length != 4 + expected) {
+        printf("TEST_FAIL: stack of %u bytes from %p\\n", length - 4, stack[0]);
+        exit_qemu(1);
+    }
+
+    // The newest CRASHDUMP_TRACE_MAX of the 300 marks, oldest first
+    const uint8_t* trace = section(size, CRASHDUMP_SECTION_TRACE, &length);
+    uint32_t count = *(const uint32_t*) trace;
+    const trace_record_t* records = (const trace_record_t*) (trace + 4);
+    if (count != CRASHDUMP_TRACE_MAX || length != 4 + count * sizeof(trace_record_t) ||
+        records[count - 1].event != TRACE_MARK || records[count - 1].a != 299 ||
+        records[0].a != 300 - CRASHDUMP_TRACE_MAX) {
+        printf("TEST_FAIL: %u trace records\\n", count);
+        exit_qemu(1);
+    }
+
+    kheap_info_t info;
+    kheap_get_info(&info);
+    const uint8_t* heap = section(size, CRASHDUMP_SECTION_HEAP, &length);
+    if (length != sizeof(info) || memcmp(heap, &info, sizeof(info)) != 0) {
+        printf("TEST_FAIL: heap info\\n");
+        exit_qemu(1);
+    }
+
+    // Too small a buffer gives no half dump
+    if (crashdump_capture(dump, 100, NULL, "capture test") != 0) {
+        printf("TEST_FAIL: truncated dump reported\\n");
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="crashdump_capture_sections",
+        test_code=CRASHDUMP_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: A user-mode trap frame keeps its registers and dumps no stack; the serial dump goes out once
+    test_helpers = ""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    regs_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.int_no = 14;
+    frame.err_code = 0x6;
+    frame.eip = 0x08048123;
+    frame.cs = 0x1B;
+    frame.useresp = 0xBFFFF000;
+    frame.eax = 0xCAFE;
+    size_t size = crashdump_capture(dump, sizeof(dump), &frame, "user fault");
+    uint32_t length;
+    const crashdump_regs_t* regs = (const crashdump_regs_t*) section(size, CRASHDUMP_SECTION_REGS, &length);
+    const uint32_t* stack = (const uint32_t*) section(size, CRASHDUMP_SECTION_STACK, &length);
+    if (!(regs->flags & CRASHDUMP_REGS_TRAP) || regs->int_no != 14 || regs->eip != 0x08048123 ||
+        regs->eax != 0xCAFE || regs->esp != 0xBFFFF000 || stack[0] != 0xBFFFF000 || length != 4) {
+        printf("TEST_FAIL: trap frame registers or stack\\n");
+        exit_qemu(1);
+    }
+
+    // Disabled: nothing; enabled: one dump, then no more
+    if (crashdump_write(NULL, "disabled") != -1) {
+        printf("TEST_FAIL: dump while disabled\\n");
+        exit_qemu(1);
+    }
+    crashdump_enable(SERIAL_COM1_BASE);
+    int first = crashdump_write(NULL, "serial test");
+    int second = crashdump_write(NULL, "serial test");
+    serial_write_string(SERIAL_COM1_BASE, "\\n");
+    if (first != 0 || second != -1) {
+        printf("TEST_FAIL: crashdump_write returned %d, then %d\\n", first, second);
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="crashdump_trap_frame_serial",
+        test_code=CRASHDUMP_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
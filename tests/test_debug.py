@@ -0,0 +1,73 @@
+from test_framework import OlymposTestFramework
+
+DEBUG_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/multiboot.h>
+#include <kernel/debug.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    debug_initialize((multiboot_info_t*) addr);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_debug_tests(framework: OlymposTestFramework):
+    # Test 1: Addresses resolve to the function containing them, with its base
+    test_helpers = """
+    __attribute__((noinline)) int debug_lookup_target(int x) {
+        return x * 3 + 1;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    uint32_t target = (uint32_t) &debug_lookup_target;
+    uint32_t base = 0;
+    const char* inside = debug_find_symbol(target + 1, &base);
+    uint32_t main_base = 0;
+    const char* main_name = debug_find_symbol((uint32_t) &kernel_main, &main_base);
+    const char* libc_name = find_symbol_for_address((uint32_t) &memcpy);
+    const char* none = debug_find_symbol(0x10, NULL);
+    printf("inside: %s @ %p, entry: %s, memcpy: %s, 0x10: %s\\n", inside ? inside : "(null)", base,
+           main_name ? main_name : "(null)", libc_name, none ? none : "(null)");
+
+    if (inside && strcmp(inside, "debug_lookup_target") == 0 && base == target &&
+        main_name && strcmp(main_name, "kernel_main") == 0 && main_base == (uint32_t) &kernel_main &&
+        strcmp(libc_name, "memcpy") == 0 && none == NULL && debug_lookup_target(1) == 4) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="debug_symbol_lookup",
+        test_code=DEBUG_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -0,0 +1,302 @@
+from test_framework import OlymposTestFramework
+
+FBCON_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/fbcon.h>
+
+#include "../arch/i386/include/vga.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+// A framebuffer in RAM: the kernel image is identity-mapped, so fbcon uses it in place
+#define FB_WIDTH 800
+#define FB_HEIGHT 600
+static uint32_t test_fb[FB_WIDTH * FB_HEIGHT];
+static uint32_t fb_pitch;
+static uint32_t fb_bpp;
+
+// Describe test_fb as the bootloader would
+__attribute__((unused)) static void fake_framebuffer(multiboot_info_t* mbi, uint32_t width, uint32_t height,
+                                                     uint32_t bpp) {{
+    memset(mbi, 0, sizeof(*mbi));
+    fb_pitch = width * bpp / 8;
+    fb_bpp = bpp;
+    mbi->flags = MULTIBOOT_INFO_FRAMEBUFFER_INFO;
+    mbi->framebuffer_addr = (uint32_t) test_fb;
+    mbi->framebuffer_pitch = fb_pitch;
+    mbi->framebuffer_width = width;
+    mbi->framebuffer_height = height;
+    mbi->framebuffer_bpp = (uint8_t) bpp;
+    mbi->framebuffer_type = MULTIBOOT_FRAMEBUFFER_TYPE_RGB;
+    if (bpp == 16) {{
+        mbi->framebuffer_red_field_position = 11;
+        mbi->framebuffer_red_mask_size = 5;
+        mbi->framebuffer_green_field_position = 5;
+        mbi->framebuffer_green_mask_size = 6;
+        mbi->framebuffer_blue_field_position = 0;
+        mbi->framebuffer_blue_mask_size = 5;
+    }}
+    else {{
+        mbi->framebuffer_red_field_position = 16;
+        mbi->framebuffer_red_mask_size = 8;
+        mbi->framebuffer_green_field_position = 8;
+        mbi->framebuffer_green_mask_size = 8;
+        mbi->framebuffer_blue_field_position = 0;
+        mbi->framebuffer_blue_mask_size = 8;
+    }}
+}}
+
+// Read a pixel of the fake framebuffer
+__attribute__((unused)) static uint32_t fb_pixel(uint32_t x, uint32_t y) {{
+    const uint8_t* p = (const uint8_t*) test_fb + y * fb_pitch + x * (fb_bpp / 8);
+    return fb_bpp == 16 ? *(const uint16_t*) p : *(const uint32_t*) p;
+}}
+
+// Check that a cell shows a character in the given colors (as pixel values), ignoring the cursor rows
+__attribute__((unused)) static bool cell_shows(size_t col, size_t row, unsigned char c, uint32_t fg, uint32_t bg,
+                                               uint32_t rows) {{
+    for (uint32_t y = 0; y < rows; y++) {{
+        for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++) {{
+            uint32_t want = (fbcon_font[c][y] & (0x80 >> x)) ? fg : bg;
+            if (fb_pixel(col * FBCON_GLYPH_WIDTH + x, row * FBCON_GLYPH_HEIGHT + y) != want) {{
+                return false;
+            }}
+        }}
+    }}
+    return true;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_fbcon_tests(framework: OlymposTestFramework):
+    # Test 1: text goes through the glyph caches in the right colors, and scrolling moves it up a row
+    test_helpers = ""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    vga_write_char_at('b', vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK), 70, 5);
+    vga_flush();
+    multiboot_info_t fb_info;
+    fake_framebuffer(&fb_info, 640, 480, 32);
+    if (fbcon_init(&fb_info) != 0 || !fbcon_active() || console_cols != 80 || console_rows != 30) {
+        printf("TEST_FAIL: fbcon_init failed or wrong grid\\n");
+        exit_qemu(1);
+    }
+    // What was on the text screen is redrawn (light grey on black)
+    if (!cell_shows(70, 5, 'b', 0xAAAAAA, 0x000000, FBCON_GLYPH_HEIGHT)) {
+        printf("TEST_FAIL: old text not redrawn\\n");
+        exit_qemu(1);
+    }
+
+    // To the bottom row, then a line in white on blue scrolled up by one
+    for (size_t i = 0; i < console_rows; i++) {
+        terminal_putchar('\\n');
+    }
+    terminal_setcolor(vga_entry_color(VGA_COLOR_WHITE, VGA_COLOR_BLUE));
+    terminal_writestring("Wm\\n");
+    size_t row = console_rows - 2;
+    if (!cell_shows(0, row, 'W', 0xFFFFFF, 0x0000AA, FBCON_GLYPH_HEIGHT) ||
+        !cell_shows(1, row, 'm', 0xFFFFFF, 0x0000AA, FBCON_GLYPH_HEIGHT) ||
+        !cell_shows(1, row + 1, ' ', 0xFFFFFF, 0x0000AA, FBCON_GLYPH_HEIGHT)) {
+        printf("TEST_FAIL: scrolled line not drawn\\n");
+        exit_qemu(1);
+    }
+
+    // The same characters again are copies of cached pixels
+    fbcon_stats_t before, after;
+    fbcon_get_stats(&before);
+    terminal_writestring("mWmW");
+    fbcon_get_stats(&after);
+    if (after.glyphs_rendered != before.glyphs_rendered || after.cells_drawn < before.cells_drawn + 4) {
+        printf("TEST_FAIL: %u glyphs rendered for cached characters\\n",
+               (uint32_t) (after.glyphs_rendered - before.glyphs_rendered));
+        exit_qemu(1);
+    }
+
+    terminal_setcolor(vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK));
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="fbcon_glyphs_scroll",
+        test_code=FBCON_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: a write redraws only the cells it changed (and the cursor's), nothing else
+    test_helpers = """
+#define POISON 0x00123456
+
+static void poison_cell(size_t col, size_t row) {
+    for (uint32_t y = 0; y < FBCON_GLYPH_HEIGHT; y++) {
+        for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++) {
+            test_fb[(row * FBCON_GLYPH_HEIGHT + y) * (fb_pitch / 4) + col * FBCON_GLYPH_WIDTH + x] = POISON;
+        }
+    }
+}
+
+static bool cell_poisoned(size_t col, size_t row) {
+    for (uint32_t y = 0; y < FBCON_GLYPH_HEIGHT; y++) {
+        for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++) {
+            if (fb_pixel(col * FBCON_GLYPH_WIDTH + x, row * FBCON_GLYPH_HEIGHT + y) != POISON) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+"""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    multiboot_info_t fb_info;
+    fake_framebuffer(&fb_info, FB_WIDTH, FB_HEIGHT, 32);
+    if (fbcon_init(&fb_info) != 0 || console_cols != 100 || console_rows != 37) {
+        printf("TEST_FAIL: fbcon_init failed or wrong grid\\n");
+        exit_qemu(1);
+    }
+
+    // To the bottom row; the rest of that row and the other rows must stay as they are
+    for (size_t i = 0; i < console_rows; i++) {
+        terminal_putchar('\\n');
+    }
+    size_t row = console_rows - 1;
+    poison_cell(10, row);
+    poison_cell(50, 20);
+    poison_cell(0, row - 1);
+    test_fb[599 * (fb_pitch / 4) + 799] = POISON;       // Margin below the grid
+    fbcon_stats_t before, after;
+    fbcon_get_stats(&before);
+    terminal_writestring("abc");
+    fbcon_get_stats(&after);
+
+    if (!cell_poisoned(10, row) || !cell_poisoned(50, 20) || !cell_poisoned(0, row - 1) ||
+        fb_pixel(799, 599) != POISON) {
+        printf("TEST_FAIL: cells outside the write were redrawn\\n");
+        exit_qemu(1);
+    }
+    if (after.cells_drawn - before.cells_drawn > 8) {
+        printf("TEST_FAIL: %u cells drawn for a 3-character write\\n",
+               (uint32_t) (after.cells_drawn - before.cells_drawn));
+        exit_qemu(1);
+    }
+    // Text in place, the cursor underline moved from column 0 to column 3
+    uint32_t grey = 0xAAAAAA;
+    if (!cell_shows(0, row, 'a', grey, 0, FBCON_GLYPH_HEIGHT) ||
+        !cell_shows(2, row, 'c', grey, 0, FBCON_GLYPH_HEIGHT) ||
+        !cell_shows(3, row, ' ', grey, 0, FBCON_GLYPH_HEIGHT - 2)) {
+        printf("TEST_FAIL: text or cursor cell wrong\\n");
+        exit_qemu(1);
+    }
+    for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++) {
+        if (fb_pixel(3 * FBCON_GLYPH_WIDTH + x, (row + 1) * FBCON_GLYPH_HEIGHT - 1) != grey) {
+            printf("TEST_FAIL: no cursor underline\\n");
+            exit_qemu(1);
+        }
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="fbcon_dirty_spans",
+        test_code=FBCON_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: 16 bpp pixels, and a span with more colors than cache slots draws every cell right
+    test_helpers = """
+// 0xRRGGBB as RGB565
+static uint32_t rgb565(uint32_t rgb) {
+    return ((rgb >> 19) & 0x1F) << 11 | ((rgb >> 10) & 0x3F) << 5 | ((rgb >> 3) & 0x1F);
+}
+
+static const uint32_t palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+"""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    multiboot_info_t fb_info;
+    fake_framebuffer(&fb_info, 800, 600, 16);
+    if (fbcon_init(&fb_info) != 0) {
+        printf("TEST_FAIL: fbcon_init failed\\n");
+        exit_qemu(1);
+    }
+
+    // One flush, one row: 15 foreground colors on black, then 15 backgrounds under white
+    const size_t count = 30;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t attr = i < 15 ? (uint8_t) (i + 1) : (uint8_t) (VGA_COLOR_WHITE | (i - 14) << 4);
+        vga_write_char_at((unsigned char) ('A' + i), attr, i, 10);
+    }
+    fbcon_stats_t before, after;
+    fbcon_get_stats(&before);
+    vga_flush();
+    fbcon_get_stats(&after);
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t fg = i < 15 ? palette[i + 1] : palette[VGA_COLOR_WHITE];
+        uint32_t bg = i < 15 ? palette[0] : palette[i - 14];
+        if (!cell_shows(i, 10, (unsigned char) ('A' + i), rgb565(fg), rgb565(bg), FBCON_GLYPH_HEIGHT)) {
+            printf("TEST_FAIL: cell %u drawn wrong\\n", (uint32_t) i);
+            exit_qemu(1);
+        }
+    }
+    if (after.cache_evictions - before.cache_evictions < count - FBCON_GLYPH_CACHES ||
+        after.cells_drawn - before.cells_drawn != count) {
+        printf("TEST_FAIL: %u evictions, %u cells\\n", (uint32_t) (after.cache_evictions - before.cache_evictions),
+               (uint32_t) (after.cells_drawn - before.cells_drawn));
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="fbcon_rgb565_evict",
+        test_code=FBCON_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -0,0 +1,221 @@
+from test_framework import OlymposTestFramework
+
+FPU_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/thread.h>
+#include <kernel/fpu.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    fpu_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_fpu_tests(framework: OlymposTestFramework):
+    # Test 1: Two threads keep their own SSE and x87 registers across switches
+    test_helpers = """
+    static volatile int finished;
+    static volatile int intact[2];
+
+    static void fpu_worker(void* arg) {
+        uint32_t id = (uint32_t) arg;
+        uint32_t base = (id + 1) * 100;
+        uint32_t in[4] = { base + 1, base + 2, base + 3, base + 4 };
+        int32_t x87_in = -(int32_t) base;
+        asm volatile("movups (%0), %%xmm3" : : "r"(in));
+        asm volatile("fildl (%0)" : : "r"(&x87_in));
+        int ok = 1;
+        for (int i = 0; i < 10; i++) {
+            thread_yield();
+            uint32_t out[4];
+            asm volatile("movups %%xmm3, (%0)" : : "r"(out) : "memory");
+            for (int j = 0; j < 4; j++) {
+                ok &= out[j] == in[j];
+            }
+        }
+        int32_t x87_out;
+        asm volatile("fistpl (%0)" : : "r"(&x87_out) : "memory");
+        ok &= x87_out == x87_in;
+        intact[id] = ok;
+        finished++;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    uint32_t traps_before = fpu_trap_count();
+    thread_create("fpu0", fpu_worker, (void*) 0);
+    thread_create("fpu1", fpu_worker, (void*) 1);
+    while (finished < 2) {
+        thread_yield();
+    }
+    thread_yield();
+    uint32_t traps = fpu_trap_count() - traps_before;
+    printf("Registers intact: %d %d, %u #NM traps\\n", intact[0], intact[1], traps);
+
+    if (intact[0] && intact[1] && traps >= 10) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="fpu_lazy_switch",
+        test_code=FPU_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: Switches between threads that don't use the FPU never trap
+    test_helpers = """
+    static volatile int finished;
+    static volatile uint32_t sum;
+
+    static void int_worker(void* arg) {
+        (void) arg;
+        for (int i = 0; i < 20; i++) {
+            sum += i;
+            thread_yield();
+        }
+        finished++;
+    }
+
+    static void sse_worker(void* arg) {
+        (void) arg;
+        for (int i = 0; i < 20; i++) {
+            asm volatile("xorps %%xmm0, %%xmm0" : : : "memory");
+            thread_yield();
+        }
+        finished++;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    uint32_t start = fpu_trap_count();
+    thread_create("int0", int_worker, NULL);
+    thread_create("int1", int_worker, NULL);
+    while (finished < 2) {
+        thread_yield();
+    }
+    uint32_t int_traps = fpu_trap_count() - start;
+
+    // One FPU user among integer threads keeps the registers: only its first use traps
+    start = fpu_trap_count();
+    thread_create("sse", sse_worker, NULL);
+    thread_create("int2", int_worker, NULL);
+    while (finished < 4) {
+        thread_yield();
+    }
+    uint32_t mixed_traps = fpu_trap_count() - start;
+    printf("Traps: %u without FPU users, %u with one\\n", int_traps, mixed_traps);
+
+    if (int_traps == 0 && mixed_traps == 1) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="fpu_untouched_no_trap",
+        test_code=FPU_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: Kernel SSE sections (memcpy/memset) don't clobber a thread's registers
+    test_helpers = """
+    static uint8_t src[4096 + 64], dst[4096 + 64];
+    static volatile int finished;
+    static volatile int intact;
+    static volatile int copied;
+
+    static void sse_thread(void* arg) {
+        (void) arg;
+        uint32_t in[4] = { 0x11111111, 0x22222222, 0x33333333, 0x44444444 };
+        asm volatile("movups (%0), %%xmm3" : : "r"(in));
+        // Both take the SSE path, which uses xmm0-3 itself
+        memset(dst, 0xAB, sizeof(dst));
+        memcpy(dst + 3, src + 1, 4096);
+        thread_yield();
+        uint32_t out[4];
+        asm volatile("movups %%xmm3, (%0)" : : "r"(out) : "memory");
+        intact = out[0] == in[0] && out[1] == in[1] && out[2] == in[2] && out[3] == in[3];
+        int ok = dst[0] == 0xAB && dst[1] == 0xAB && dst[2] == 0xAB && dst[4096 + 3] == 0xAB;
+        for (int i = 0; i < 4096; i++) {
+            ok &= dst[i + 3] == src[i + 1];
+        }
+        copied = ok;
+        finished = 1;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    for (int i = 0; i < (int) sizeof(src); i++) {
+        src[i] = (uint8_t) (i * 7);
+    }
+    thread_create("sse", sse_thread, NULL);
+    while (!finished) {
+        thread_yield();
+    }
+
+    int began = kernel_fpu_begin();
+    int nested = began && kernel_fpu_begin();
+    if (began) {
+        kernel_fpu_end();
+    }
+    printf("Registers intact: %d, copy correct: %d, section: %d, nested: %d\\n", intact, copied, began, nested);
+
+    if (intact && copied && began && !nested) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="fpu_kernel_section",
+        test_code=FPU_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -1,13 +1,23 @@
+import glob
 import os
+import re
 import shutil
 import subprocess
 from collections import Counter
-from typing import Any, Dict
+from concurrent.futures import ThreadPoolExecutor
+from typing import Any, Dict, List, Optional
+
+# In-kernel tests: KTEST(suite, name) in kernel/ktest/*.c, results on COM1 (see kernel/include/kernel/ktest.h)
+KTEST_DEFINITION = re.compile(r"^KTEST\((\w+),\s*(\w+)\)", re.M)
+KTEST_RESULT = re.compile(r"^KTEST_(PASS|FAIL) (\S+)", re.M)
+KTEST_CMDLINE_MAX = 480  # The kernel keeps 512 bytes of the selection
+KTEST_BOOT_TIMEOUT = 120
 
 
 class OlymposTestFramework:
     def __init__(self):
         self.tests = []
+        self.ktests = []
         self.results = []
         self.verbose = False
         # Determine if we're in the test directory or root
@@ -22,8 +32,8 @@ class OlymposTestFramework:
             return os.path.join(self.root_dir, path)
         return path
 
-    def register_test(self, name: str, test_code: str, expected_output: str):
-        self.tests.append({"name": name, "code": test_code, "expected": expected_output})
+    def register_test(self, name: str, test_code: str, expected_output: str, qemu_args: Optional[List[str]] = None):
+        self.tests.append({"name": name, "code": test_code, "expected": expected_output, "qemu_args": qemu_args or []})
 
     def backup_kernel(self):
         kernel_path = self.get_path("kernel/init/kernel.c")
@@ -38,36 +48,37 @@ class OlymposTestFramework:
         if os.path.exists(backup_path):
             shutil.move(backup_path, kernel_path)
 
+    def build_kernel(self, extra_env: Optional[Dict[str, str]] = None) -> bool:
+        build_script = self.get_path("build-test.sh")
+        with open(build_script, "w") as f:
+            f.write("#!/bin/sh\n")
+            f.write("# Temporary build script for tests\n")
+            f.write(". ./config.sh\n")
+            f.write(". ./headers.sh\n\n")
+            f.write("# Add TEST define to CFLAGS\n")
+            f.write('export CFLAGS="$CFLAGS -DTEST"\n')
+            f.write('export CPPFLAGS="$CPPFLAGS -DTEST"\n\n')
+            for key, value in (extra_env or {}).items():
+                f.write(f"export {key}={value}\n")
+            f.write("# Build the projects\n")
+            f.write("for PROJECT in $PROJECTS; do\n")
+            f.write('  (cd $PROJECT && DESTDIR="$SYSROOT" $MAKE install)\n')
+            f.write("done\n")
+        os.chmod(build_script, 0o755)
+
+        if self.verbose:
+            print("Building kernel...")
+            build_cmd = f"cd {self.root_dir} && ./build-test.sh"
+        else:
+            build_cmd = f"cd {self.root_dir} && ./build-test.sh > /dev/null 2>&1"
+        return os.system(build_cmd) == 0
+
     def create_test_kernel(self, test_code: str) -> bool:
         try:
             kernel_path = self.get_path("kernel/init/kernel.c")
             with open(kernel_path, "w") as f:
                 f.write(test_code)
-
-            build_script = self.get_path("build-test.sh")
-            with open(build_script, "w") as f:
-                f.write("#!/bin/sh\n")
-                f.write("# Temporary build script for tests\n")
-                f.write(". ./config.sh\n")
-                f.write(". ./headers.sh\n\n")
-                f.write("# Add TEST define to CFLAGS\n")
-                f.write('export CFLAGS="$CFLAGS -DTEST"\n')
-                f.write('export CPPFLAGS="$CPPFLAGS -DTEST"\n\n')
-                f.write("# Build the projects\n")
-                f.write("for PROJECT in $PROJECTS; do\n")
-                f.write('  (cd $PROJECT && DESTDIR="$SYSROOT" $MAKE install)\n')
-                f.write("done\n")
-            os.chmod(build_script, 0o755)
-
-            if self.verbose:
-                print("Building kernel...")
-                build_cmd = f"cd {self.root_dir} && ./build-test.sh"
-            else:
-                build_cmd = f"cd {self.root_dir} && ./build-test.sh > /dev/null 2>&1"
-            if os.system(build_cmd) != 0:
-                return False
-
-            return True
+            return self.build_kernel()
         except Exception as e:
             print(f"Error creating test kernel: {e}")
             return False
@@ -108,7 +119,7 @@ class OlymposTestFramework:
             print(f"Error creating test ISO: {e}")
             return False
 
-    def run_qemu(self) -> tuple[int, str]:
+    def run_qemu(self, extra_args: Optional[List[str]] = None) -> tuple[int, str]:
         iso_path = self.get_path("olympos-test.iso")
         qemu_cmd = [
             "qemu-system-i386",
@@ -121,7 +132,7 @@ class OlymposTestFramework:
             "-device",
             "isa-debug-exit,iobase=0xf4,iosize=0x04",
             "-no-reboot",
-        ]
+        ] + (extra_args or [])
         result = subprocess.run(qemu_cmd, capture_output=True)
         output = result.stdout.decode("utf-8", errors="ignore")
         return result.returncode, output
@@ -139,7 +150,7 @@ class OlymposTestFramework:
             if not self.create_test_iso():
                 self.results.append({"name": test_name, "passed": False, "output": "Failed to create test ISO"})
                 return False
-            return_code, output = self.run_qemu()
+            return_code, output = self.run_qemu(test.get("qemu_args"))
             success = return_code == 1 and test["expected"] in output
 
             if self.verbose:
@@ -154,14 +165,92 @@ class OlymposTestFramework:
         self.results.append({"name": test_name, "passed": success, "output": output})
         return success
 
-    def run_all_tests(self):
-        total_test_count = len(self.tests)
-        print(f"=== Running {total_test_count} Tests ===")
+    def discover_ktests(self):
+        """Collect the suite_name of every KTEST() in kernel/ktest"""
+        self.ktests = []
+        for path in sorted(glob.glob(os.path.join(self.get_path("kernel/ktest"), "*.c"))):
+            with open(path) as f:
+                self.ktests.extend(f"{suite}_{name}" for suite, name in KTEST_DEFINITION.findall(f.read()))
+
+    def run_ktest_boot(self, names: List[str]) -> tuple[Dict[str, bool], str]:
+        """Boot the kernel once with ktest=<names>; return the results it printed"""
+        kernel_path = self.get_path(os.path.join("sysroot", "boot", "olympos.kernel"))
+        qemu_cmd = [
+            "qemu-system-i386",
+            "-kernel",
+            kernel_path,
+            "-append",
+            "ktest=" + ",".join(names),
+            "-serial",
+            "stdio",
+            "-display",
+            "none",
+            "-device",
+            "isa-debug-exit,iobase=0xf4,iosize=0x04",
+            "-no-reboot",
+        ]
+        try:
+            result = subprocess.run(qemu_cmd, capture_output=True, timeout=KTEST_BOOT_TIMEOUT)
+            output = result.stdout.decode("utf-8", errors="ignore")
+        except subprocess.TimeoutExpired as e:
+            output = (e.stdout or b"").decode("utf-8", errors="ignore") + "\n(timed out)\n"
+        return {name: status == "PASS" for status, name in KTEST_RESULT.findall(output)}, output
+
+    def run_ktest_batch(self, names: List[str]) -> List[Dict[str, Any]]:
+        """Run tests in as few boots as possible; a test that kills its boot fails, the rest go on in a new one"""
+        results = []
+        remaining = list(names)
+        while remaining:
+            boot = []
+            for name in remaining:
+                if boot and len(",".join(boot + [name])) > KTEST_CMDLINE_MAX:
+                    break
+                boot.append(name)
+            passed, output = self.run_ktest_boot(boot)
+            for index, name in enumerate(boot):
+                if name not in passed:
+                    # No result: it crashed or hung the kernel; the tests after it never ran
+                    results.append({"name": f"ktest_{name}", "passed": False, "output": output})
+                    remaining = boot[index + 1 :] + remaining[len(boot) :]
+                    break
+                results.append({"name": f"ktest_{name}", "passed": passed[name], "output": output})
+            else:
+                remaining = remaining[len(boot) :]
+        return results
+
+    def run_ktests(self, jobs: int = 1) -> bool:
+        """Build the kernel once with the in-kernel tests and run them in up to jobs QEMU instances"""
+        jobs = max(1, min(jobs, len(self.ktests)))
+        print(f"=== Running {len(self.ktests)} In-Kernel Tests ({jobs} QEMU instances) ===")
+        # The restored kernel.c keeps its old mtime: make it newer than a kernel.o left by a test kernel
+        os.utime(self.get_path("kernel/init/kernel.c"))
+        if not self.build_kernel({"KTEST": "1"}):
+            self.results.extend({"name": f"ktest_{n}", "passed": False, "output": "Build failed"} for n in self.ktests)
+            print("Failed to build the in-kernel test kernel")
+            return False
+
+        batches = [self.ktests[i::jobs] for i in range(jobs)]
+        with ThreadPoolExecutor(max_workers=jobs) as pool:
+            results = [r for batch in pool.map(self.run_ktest_batch, batches) for r in batch]
+        for i, result in enumerate(results, 1):
+            print(f"[{i}/{len(results)}] {result['name']}: {'PASSED' if result['passed'] else 'FAILED'}")
+            if self.verbose and not result["passed"]:
+                print(f"Test Output:\n{result['output']}")
+        self.results.extend(results)
+        return all(r["passed"] for r in results)
+
+    def run_all_tests(self, jobs: int = 1):
+        total_test_count = len(self.tests) + len(self.ktests)
+        if self.tests:
+            print(f"=== Running {len(self.tests)} Tests ===")
 
         for i, test in enumerate(self.tests, 1):
             result = self.run_test(test)
             result_message = "PASSED" if result else "FAILED"
-            print(f"[{i}/{total_test_count}] {test['name']}: {result_message}")
+            print(f"[{i}/{len(self.tests)}] {test['name']}: {result_message}")
+
+        if self.ktests:
+            self.run_ktests(jobs)
 
         print("\n=== Test Summary ===")
         status_counter = Counter(r["passed"] for r in self.results)
@@ -52,7 +52,8 @@ def register_gdt_tests(framework: OlymposTestFramework):
     printf("  FS: 0x%04x\\n", fs);
     printf("  GS: 0x%04x\\n", gs);
     
-    if (cs == 0x08 && ds == 0x10 && ss == 0x10 && es == 0x10 && fs == 0x10 && gs == 0x10) {
+    // FS is the per-CPU data segment (GDT index 6)
+    if (cs == 0x08 && ds == 0x10 && ss == 0x10 && es == 0x10 && fs == 0x30 && gs == 0x10) {
         printf("All segments correctly set\\n");
         printf("TEST_PASS\\n");
     }
@@ -0,0 +1,199 @@
+from test_framework import OlymposTestFramework
+
+INITCALL_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/initcall.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_initcall_tests(framework: OlymposTestFramework):
+    # Test 1: Stages run in table order and are timed; a deferred one waits for initcall_start_deferred()
+    test_helpers = """
+    static volatile uint32_t order[4];
+    static volatile uint32_t order_len;
+
+    static int stage_spin(void) {
+        order[order_len++] = 1;
+        uint64_t start = ktime_ns();
+        while (ktime_ns() - start < 2000000) {
+            asm volatile("pause");
+        }
+        return 0;
+    }
+
+    static int stage_fail(void) {
+        order[order_len++] = 2;
+        return -1;
+    }
+
+    static int stage_later(void) {
+        order[order_len++] = 3;
+        return 0;
+    }
+
+    static const initcall_t stages[] = {
+        { "stage_spin", stage_spin, 0 },
+        { "stage_later", stage_later, INITCALL_DEFERRED },
+        { "stage_fail", stage_fail, 0 },
+    };
+    """
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    initcall_run(stages, 3);
+    initcall_record_t spin, later, fail;
+    initcall_get_record(0, &spin);
+    initcall_get_record(1, &later);
+    initcall_get_record(2, &fail);
+    uint32_t spin_us = (uint32_t) initcall_cycles_to_us(spin.cycles);
+    printf("spin took %u us, fail started at %u us\\n", spin_us, (uint32_t) initcall_cycles_to_us(fail.start));
+    if (initcall_count() != 3 || order_len != 2 || order[0] != 1 || order[1] != 2 || !spin.done || later.done ||
+        !fail.done || fail.result != -1 || spin_us < 1900 || fail.start < spin.start + spin.cycles) {
+        printf("TEST_FAIL: Synchronous stages\\n");
+        exit_qemu(1);
+    }
+    if (initcall_get_record(3, &fail) != -1) {
+        printf("TEST_FAIL: Record past the end\\n");
+        exit_qemu(1);
+    }
+
+    int threads = initcall_start_deferred();
+    initcall_wait_deferred();
+    initcall_get_record(1, &later);
+    if (threads != 1 || !later.done || order_len != 3 || order[2] != 3) {
+        printf("TEST_FAIL: Deferred stage (%d threads)\\n", threads);
+        exit_qemu(1);
+    }
+    initcall_report();
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="initcall_order_timing",
+        test_code=INITCALL_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: Parallel stages overlap their sleeps; deferred ones keep their order in one thread
+    test_helpers = """
+    static volatile uint32_t order[4];
+    static volatile uint32_t order_len;
+    static volatile thread_t* stage_threads[4];
+
+    static int stage_sleep_a(void) {
+        stage_threads[0] = thread_current();
+        ksleep(50);
+        return 0;
+    }
+
+    static int stage_sleep_b(void) {
+        stage_threads[1] = thread_current();
+        ksleep(50);
+        return 0;
+    }
+
+    static int stage_first(void) {
+        stage_threads[2] = thread_current();
+        order[order_len++] = 1;
+        ksleep(10);
+        return 0;
+    }
+
+    static int stage_second(void) {
+        stage_threads[3] = thread_current();
+        order[order_len++] = 2;
+        return 0;
+    }
+
+    static const initcall_t stages[] = {
+        { "stage_sleep_a", stage_sleep_a, INITCALL_PARALLEL },
+        { "stage_first", stage_first, INITCALL_DEFERRED },
+        { "stage_sleep_b", stage_sleep_b, INITCALL_PARALLEL },
+        { "stage_second", stage_second, INITCALL_DEFERRED },
+    };
+    """
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    initcall_run(stages, 4);
+    if (order_len != 0) {
+        printf("TEST_FAIL: Deferred stages ran early\\n");
+        exit_qemu(1);
+    }
+    uint64_t start = ktime_ns();
+    int threads = initcall_start_deferred();
+    initcall_wait_deferred();
+    uint32_t elapsed_ms = (uint32_t) ((ktime_ns() - start) / 1000000);
+    printf("%d threads, %u ms\\n", threads, elapsed_ms);
+
+    thread_t* self = thread_current();
+    if (threads != 3 || elapsed_ms >= 90 || order_len != 2 || order[0] != 1 || order[1] != 2) {
+        printf("TEST_FAIL: Deferred stages didn't overlap or lost their order\\n");
+        exit_qemu(1);
+    }
+    if (stage_threads[0] == self || stage_threads[0] == stage_threads[1] || stage_threads[2] != stage_threads[3] ||
+        stage_threads[2] == stage_threads[0] || stage_threads[2] == stage_threads[1]) {
+        printf("TEST_FAIL: Stages ran in the wrong threads\\n");
+        exit_qemu(1);
+    }
+    for (size_t i = 0; i < initcall_count(); i++) {
+        initcall_record_t record;
+        initcall_get_record(i, &record);
+        if (!record.done || record.result != 0) {
+            printf("TEST_FAIL: %s not done\\n", record.name);
+            exit_qemu(1);
+        }
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="initcall_parallel",
+        test_code=INITCALL_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
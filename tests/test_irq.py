@@ -32,6 +32,55 @@ void kernel_main(unsigned long magic, unsigned long addr) {{
 }}
 """
 
+IRQ_STATS_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/irqstat.h>
+
+#include "../arch/i386/include/irq.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
 
 def register_irq_tests(framework: OlymposTestFramework):
     # Test 1: IRQ registration basic functionality
@@ -303,3 +352,49 @@ def register_irq_tests(framework: OlymposTestFramework):
     )
 
 
+
+    # Test 9: Timer interrupts are counted and timed, a software IRQ 7 is spurious
+    test_helpers = """
+    static volatile uint32_t irq7_calls;
+
+    void irq7_handler(regs_t* r) {
+        (void) r;
+        irq7_calls++;
+    }
+    """
+    test_body = """
+    irq_reset_stats();
+    uint64_t end = ktime_ns() + 50 * 1000000ull;
+    while (ktime_ns() < end) {
+        asm volatile("hlt");
+    }
+    irq_stats_t timer;
+    irq_get_stats(0, &timer);
+    if (timer.count < 2 || timer.total_cycles == 0 || timer.max_cycles == 0) {
+        printf("TEST_FAIL: IRQ 0 count %u, max %u cycles\\n", (uint32_t) timer.count, timer.max_cycles);
+        exit_qemu(1);
+    }
+
+    // Vector 39 without the PIC: IRQ 7 is not in service, so it's spurious
+    reqister_irq(7, irq7_handler);
+    asm volatile("int $39");
+    irq_stats_t lpt;
+    irq_get_stats(7, &lpt);
+    if (lpt.spurious != 1 || lpt.count != 0 || irq7_calls != 0) {
+        printf("TEST_FAIL: IRQ 7 spurious %u, count %u, handler %u\\n", (uint32_t) lpt.spurious,
+               (uint32_t) lpt.count, irq7_calls);
+        exit_qemu(1);
+    }
+    if (irq_get_stats(16, &lpt) != -1) {
+        printf("TEST_FAIL: IRQ 16 accepted\\n");
+        exit_qemu(1);
+    }
+    irq_print_stats();
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="irq_stats_timer_spurious",
+        test_code=IRQ_STATS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
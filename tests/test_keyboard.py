@@ -0,0 +1,207 @@
+from test_framework import OlymposTestFramework
+
+KEYBOARD_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/keyboard.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+// Feed a scancode sequence to the decoder as the IRQ handler would
+__attribute__((unused)) static void feed(const uint8_t* bytes, size_t count) {{
+    for (size_t i = 0; i < count; i++) {{
+        keyboard_process_scancode(bytes[i]);
+    }}
+}}
+
+// Take the next event and check it
+__attribute__((unused)) static void expect(uint8_t keycode, uint8_t ascii, uint8_t modifiers, uint8_t flags) {{
+    if (keyboard_pending() == 0) {{
+        printf("TEST_FAIL: no event for key %x\\n", keycode);
+        exit_qemu(1);
+    }}
+    key_event_t event;
+    keyboard_read_event(&event);
+    if (event.keycode != keycode || event.ascii != ascii || event.modifiers != modifiers || event.flags != flags) {{
+        printf("TEST_FAIL: got key %x ascii %x mods %x flags %x, wanted %x %x %x %x\\n", event.keycode, event.ascii,
+               event.modifiers, event.flags, keycode, ascii, modifiers, flags);
+        exit_qemu(1);
+    }}
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_keyboard_tests(framework: OlymposTestFramework):
+    # Test 1: Shift, Caps Lock and Ctrl pick the layer; presses and releases both arrive with their modifiers
+    test_helpers = ""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    // a, then Shift+a and Shift+1
+    const uint8_t shifted[] = { 0x1E, 0x9E, 0x2A, 0x1E, 0x9E, 0x02, 0x82, 0xAA };
+    feed(shifted, sizeof(shifted));
+    expect(0x1E, 'a', 0, 0);
+    expect(0x1E, 'a', 0, KEY_EVENT_RELEASED);
+    expect(KEY_LSHIFT, 0, KEY_MOD_SHIFT, 0);
+    expect(0x1E, 'A', KEY_MOD_SHIFT, 0);
+    expect(0x1E, 'A', KEY_MOD_SHIFT, KEY_EVENT_RELEASED);
+    expect(0x02, '!', KEY_MOD_SHIFT, 0);
+    expect(0x02, '!', KEY_MOD_SHIFT, KEY_EVENT_RELEASED);
+    expect(KEY_LSHIFT, 0, 0, KEY_EVENT_RELEASED);
+
+    // Caps Lock on: letters upper case, digits not; with Shift (the right one) letters go back to lower case
+    const uint8_t caps[] = { 0x3A, 0xBA, 0x10, 0x90, 0x03, 0x83, 0x36, 0x10, 0x90, 0xB6, 0x3A, 0xBA };
+    feed(caps, sizeof(caps));
+    expect(KEY_CAPSLOCK, 0, KEY_MOD_CAPS, 0);
+    expect(KEY_CAPSLOCK, 0, KEY_MOD_CAPS, KEY_EVENT_RELEASED);
+    expect(0x10, 'Q', KEY_MOD_CAPS, 0);
+    expect(0x10, 'Q', KEY_MOD_CAPS, KEY_EVENT_RELEASED);
+    expect(0x03, '2', KEY_MOD_CAPS, 0);
+    expect(0x03, '2', KEY_MOD_CAPS, KEY_EVENT_RELEASED);
+    expect(KEY_RSHIFT, 0, KEY_MOD_CAPS | KEY_MOD_SHIFT, 0);
+    expect(0x10, 'q', KEY_MOD_CAPS | KEY_MOD_SHIFT, 0);
+    expect(0x10, 'q', KEY_MOD_CAPS | KEY_MOD_SHIFT, KEY_EVENT_RELEASED);
+    expect(KEY_RSHIFT, 0, KEY_MOD_CAPS, KEY_EVENT_RELEASED);
+    expect(KEY_CAPSLOCK, 0, 0, 0);
+    expect(KEY_CAPSLOCK, 0, 0, KEY_EVENT_RELEASED);
+
+    // Ctrl+C types ETX; right Ctrl (E0 1D) and left Ctrl both count, Alt adds a modifier but no layer
+    const uint8_t ctrl[] = { 0x1D, 0x2E, 0xAE, 0xE0, 0x1D, 0x9D, 0x2E, 0xAE, 0xE0, 0x9D, 0x38, 0x2E, 0xAE, 0xB8 };
+    feed(ctrl, sizeof(ctrl));
+    expect(KEY_LCTRL, 0, KEY_MOD_CTRL, 0);
+    expect(0x2E, 0x03, KEY_MOD_CTRL, 0);
+    expect(0x2E, 0x03, KEY_MOD_CTRL, KEY_EVENT_RELEASED);
+    expect(KEY_RCTRL, 0, KEY_MOD_CTRL, 0);
+    expect(KEY_LCTRL, 0, KEY_MOD_CTRL, KEY_EVENT_RELEASED);      // Right Ctrl still held
+    expect(0x2E, 0x03, KEY_MOD_CTRL, 0);
+    expect(0x2E, 0x03, KEY_MOD_CTRL, KEY_EVENT_RELEASED);
+    expect(KEY_RCTRL, 0, 0, KEY_EVENT_RELEASED);
+    expect(KEY_LALT, 0, KEY_MOD_ALT, 0);
+    expect(0x2E, 'c', KEY_MOD_ALT, 0);
+    expect(0x2E, 'c', KEY_MOD_ALT, KEY_EVENT_RELEASED);
+    expect(KEY_LALT, 0, 0, KEY_EVENT_RELEASED);
+
+    if (keyboard_pending() != 0 || keyboard_overflows() != 0) {
+        printf("TEST_FAIL: %u events left, %u dropped\\n", keyboard_pending(), keyboard_overflows());
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="keyboard_modifier_layers",
+        test_code=KEYBOARD_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: extended keys, the pause sequence, fake shifts, Num Lock, typematic repeat, and character readers
+    test_helpers = ""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    // Up, Delete; Print Screen comes wrapped in fake shifts (E0 2A E0 37 ... E0 B7 E0 AA); then Pause
+    const uint8_t extended[] = { 0xE0, 0x48, 0xE0, 0xC8, 0xE0, 0x53, 0xE0, 0xD3,
+                                 0xE0, 0x2A, 0xE0, 0x37, 0xE0, 0xB7, 0xE0, 0xAA,
+                                 0xE1, 0x1D, 0x45, 0xE1, 0x9D, 0xC5 };
+    feed(extended, sizeof(extended));
+    expect(KEY_UP, 0, 0, 0);
+    expect(KEY_UP, 0, 0, KEY_EVENT_RELEASED);
+    expect(KEY_DELETE, 0, 0, 0);
+    expect(KEY_DELETE, 0, 0, KEY_EVENT_RELEASED);
+    expect(KEY_EXTENDED | 0x37, 0, 0, 0);
+    expect(KEY_EXTENDED | 0x37, 0, 0, KEY_EVENT_RELEASED);
+    expect(KEY_PAUSE, 0, 0, 0);
+    expect(KEY_PAUSE, 0, 0, KEY_EVENT_RELEASED);
+
+    // Keypad 8: Up while Num Lock is off, '8' once it is on; keypad Enter (E0 1C) types a newline
+    const uint8_t keypad[] = { 0x48, 0xC8, 0x45, 0xC5, 0x48, 0xC8, 0xE0, 0x1C, 0xE0, 0x9C, 0x45, 0xC5 };
+    feed(keypad, sizeof(keypad));
+    expect(KEY_UP, 0, 0, 0);
+    expect(KEY_UP, 0, 0, KEY_EVENT_RELEASED);
+    expect(KEY_NUMLOCK, 0, KEY_MOD_NUM, 0);
+    expect(KEY_NUMLOCK, 0, KEY_MOD_NUM, KEY_EVENT_RELEASED);
+    expect(0x48, '8', KEY_MOD_NUM, 0);
+    expect(0x48, '8', KEY_MOD_NUM, KEY_EVENT_RELEASED);
+    expect(KEY_KP_ENTER, '\\n', KEY_MOD_NUM, 0);
+    expect(KEY_KP_ENTER, '\\n', KEY_MOD_NUM, KEY_EVENT_RELEASED);
+    expect(KEY_NUMLOCK, 0, 0, 0);
+    expect(KEY_NUMLOCK, 0, 0, KEY_EVENT_RELEASED);
+
+    // A held Caps Lock repeats without toggling again
+    const uint8_t repeat[] = { 0x3A, 0x3A, 0x3A, 0xBA, 0x3A, 0xBA };
+    feed(repeat, sizeof(repeat));
+    expect(KEY_CAPSLOCK, 0, KEY_MOD_CAPS, 0);
+    expect(KEY_CAPSLOCK, 0, KEY_MOD_CAPS, KEY_EVENT_REPEAT);
+    expect(KEY_CAPSLOCK, 0, KEY_MOD_CAPS, KEY_EVENT_REPEAT);
+    expect(KEY_CAPSLOCK, 0, KEY_MOD_CAPS, KEY_EVENT_RELEASED);
+    expect(KEY_CAPSLOCK, 0, 0, 0);
+    expect(KEY_CAPSLOCK, 0, 0, KEY_EVENT_RELEASED);
+
+    // getchar() and read() see only the characters typed: "Hi" with Shift, around an arrow and an ACK byte
+    const uint8_t typed[] = { 0x2A, 0x23, 0xA3, 0xAA, 0xE0, 0x4B, 0xE0, 0xCB, 0xFA, 0x17, 0x97, 0x1C, 0x9C };
+    feed(typed, sizeof(typed));
+    int first = keyboard_callback_getchar();
+    char rest[8];
+    size_t n = keyboard_read(rest, sizeof(rest));
+    if (first != 'H' || n != 2 || rest[0] != 'i' || rest[1] != '\\n' || keyboard_pending() != 0) {
+        printf("TEST_FAIL: read %x then %u bytes\\n", first, (uint32_t) n);
+        exit_qemu(1);
+    }
+
+    // Canonical mode queues characters only, and backspace edits them away
+    keyboard_set_mode(KEYBOARD_MODE_CANONICAL);
+    const uint8_t line[] = { 0x2D, 0xAD, 0x0E, 0x8E, 0x15, 0x95, 0xE0, 0x48, 0xE0, 0xC8, 0x1C, 0x9C };
+    feed(line, sizeof(line));
+    n = keyboard_read(rest, sizeof(rest));
+    keyboard_set_mode(KEYBOARD_MODE_RAW);
+    if (n != 2 || rest[0] != 'y' || rest[1] != '\\n' || keyboard_pending() != 0) {
+        printf("TEST_FAIL: canonical read of %u bytes\\n", (uint32_t) n);
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="keyboard_extended_keys",
+        test_code=KEYBOARD_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -22,7 +22,7 @@ void kernel_main(unsigned long magic, unsigned long addr) {{
     // Initialize debug and paging (required before heap)
     multiboot_info_t* mbi = (multiboot_info_t*) addr;
     debug_initialize(mbi);
-    paging_init();
+    paging_init(mbi);
 
     serial_write_string(SERIAL_COM1_BASE, "Initializing heap allocator...\\n");
     kheap_init();
@@ -249,3 +249,276 @@ def register_kheap_tests(framework: OlymposTestFramework):
         test_code=KHEAP_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS"
     )
+
+    # Test 6: Slab size classes
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Testing slab size classes...\\n");
+
+    // 4096 small objects would need 4096 blocks (16 MB) without slabs
+    #define NUM_SMALL 4096
+    static uint32_t* small[NUM_SMALL];
+    for (int i = 0; i < NUM_SMALL; i++) {
+        small[i] = (uint32_t*) kmalloc(32);
+        if (!small[i]) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Small allocation failed!\\n");
+            exit_qemu(1);
+        }
+        if (((uint32_t) small[i]) % 32 != 0) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Slab object not aligned to its class!\\n");
+            exit_qemu(1);
+        }
+        small[i][0] = i;
+        small[i][7] = ~i;
+    }
+    serial_write_string(SERIAL_COM1_BASE, "4096 x 32-byte allocations successful\\n");
+
+    // Objects must not overlap
+    for (int i = 0; i < NUM_SMALL; i++) {
+        if (small[i][0] != (uint32_t) i || small[i][7] != ~(uint32_t) i) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Slab objects overlap!\\n");
+            exit_qemu(1);
+        }
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Slab data integrity verified\\n");
+
+    // Mix in a large allocation, which still goes through the block path
+    void* large = kmalloc(3 * 4096);
+    if (!large) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Large allocation failed!\\n");
+        exit_qemu(1);
+    }
+
+    // Freed objects are reused by the same class
+    void* freed = small[100];
+    kfree(small[100]);
+    small[100] = (uint32_t*) kmalloc(20);
+    if (small[100] != freed) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Freed slab object not reused!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Slab object reuse works\\n");
+
+    for (int i = 0; i < NUM_SMALL; i++) {
+        kfree(small[i]);
+    }
+    kfree(large);
+    kheap_stats();
+    serial_write_string(SERIAL_COM1_BASE, "All slab objects freed\\n");
+    """
+
+    framework.register_test(
+        name="kheap_slab_classes",
+        test_code=KHEAP_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 7: Heap growth beyond the 8 MiB identity-mapped window
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Testing heap growth...\\n");
+
+    // 24 x 1 MiB = 24 MiB, three times the old fixed heap
+    #define NUM_LARGE 24
+    uint8_t* large[NUM_LARGE];
+    for (int i = 0; i < NUM_LARGE; i++) {
+        large[i] = (uint8_t*) kmalloc(1024 * 1024);
+        if (!large[i]) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Heap did not grow!\\n");
+            exit_qemu(1);
+        }
+        large[i][0] = (uint8_t) i;
+        large[i][1024 * 1024 - 1] = (uint8_t) ~i;
+    }
+    for (int i = 0; i < NUM_LARGE; i++) {
+        if (large[i][0] != (uint8_t) i || large[i][1024 * 1024 - 1] != (uint8_t) ~i) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Grown heap lost data!\\n");
+            exit_qemu(1);
+        }
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Heap grew to 24 MiB of live data\\n");
+
+    // Freeing everything trims the heap; growing again must still work
+    for (int i = 0; i < NUM_LARGE; i++) {
+        kfree(large[i]);
+    }
+    for (int round = 0; round < 4; round++) {
+        void* again = kmalloc(16 * 1024 * 1024);
+        if (!again) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Heap could not regrow after trimming!\\n");
+            exit_qemu(1);
+        }
+        kfree(again);
+    }
+    kheap_stats();
+    serial_write_string(SERIAL_COM1_BASE, "Heap shrinks and regrows\\n");
+    """
+
+    framework.register_test(
+        name="kheap_grow_shrink",
+        test_code=KHEAP_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 8: Aligned, zeroed and resized allocations
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Testing kmalloc_aligned...\\n");
+
+    size_t aligns[] = {8, 64, 512, 4096, 16384, 65536};
+    for (int i = 0; i < 6; i++) {
+        void* p = kmalloc_aligned(100 + i * 3000, aligns[i]);
+        if (!p || ((uint32_t) p & (aligns[i] - 1)) != 0) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: kmalloc_aligned returned a misaligned pointer!\\n");
+            exit_qemu(1);
+        }
+        memset(p, 0xAB, 100 + i * 3000);
+        kfree(p);
+    }
+    if (kmalloc_aligned(64, 48) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Non power-of-two alignment accepted!\\n");
+        exit_qemu(1);
+    }
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing kcalloc...\\n");
+    // Dirty a small and a large allocation first, so kcalloc must clear reused memory
+    void* dirty_small = kmalloc(256);
+    void* dirty_large = kmalloc(3 * 4096);
+    memset(dirty_small, 0xFF, 256);
+    memset(dirty_large, 0xFF, 3 * 4096);
+    kfree(dirty_small);
+    kfree(dirty_large);
+    uint8_t* zs = (uint8_t*) kcalloc(64, 4);
+    uint8_t* zl = (uint8_t*) kcalloc(3, 4096);
+    if (!zs || !zl) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: kcalloc returned NULL!\\n");
+        exit_qemu(1);
+    }
+    for (int i = 0; i < 256; i++) {
+        if (zs[i] != 0) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: kcalloc (small) not zeroed!\\n");
+            exit_qemu(1);
+        }
+    }
+    for (int i = 0; i < 3 * 4096; i++) {
+        if (zl[i] != 0) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: kcalloc (large) not zeroed!\\n");
+            exit_qemu(1);
+        }
+    }
+    if (kcalloc(0x10000, 0x10000) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: kcalloc overflow not detected!\\n");
+        exit_qemu(1);
+    }
+    kfree(zs);
+    kfree(zl);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing krealloc...\\n");
+    // Growing a block run with free blocks after it must not move it
+    char* buf = (char*) kmalloc(5000);
+    for (int i = 0; i < 5000; i++) {
+        buf[i] = (char) (i * 7);
+    }
+    char* grown = (char*) krealloc(buf, 20000);
+    if (grown != buf) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: krealloc did not grow in place!\\n");
+        exit_qemu(1);
+    }
+    // A neighbour after the run forces a move; contents must be kept
+    void* blocker = kmalloc(5000);
+    char* moved = (char*) krealloc(grown, 80000);
+    if (!moved) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: krealloc move failed!\\n");
+        exit_qemu(1);
+    }
+    for (int i = 0; i < 5000; i++) {
+        if (moved[i] != (char) (i * 7)) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: krealloc lost data!\\n");
+            exit_qemu(1);
+        }
+    }
+    // Small objects: grow within the class, then into a larger one
+    char* s = (char*) kmalloc(20);
+    memcpy(s, "olympos", 8);
+    if (krealloc(s, 32) != s) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: krealloc moved within the size class!\\n");
+        exit_qemu(1);
+    }
+    s = (char*) krealloc(s, 3000);
+    if (!s || strcmp(s, "olympos") != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: krealloc across classes lost data!\\n");
+        exit_qemu(1);
+    }
+    kfree(s);
+    kfree(moved);
+    kfree(blocker);
+    kheap_stats();
+    serial_write_string(SERIAL_COM1_BASE, "kmalloc_aligned, kcalloc and krealloc work\\n");
+    """
+
+    framework.register_test(
+        name="kheap_aligned_calloc_realloc",
+        test_code=KHEAP_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 9: Per-CPU magazines recycle freed objects without handing one out twice
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Testing magazine caches...\\n");
+
+    // More objects than two magazines and a full depot hold, so every path runs
+    #define NUM_MAG 200
+    static uint32_t* objs[NUM_MAG];
+    static uint32_t* again[NUM_MAG];
+    for (int i = 0; i < NUM_MAG; i++) {
+        objs[i] = (uint32_t*) kmalloc(48);
+        if (!objs[i]) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Allocation failed!\\n");
+            exit_qemu(1);
+        }
+    }
+    for (int i = 0; i < NUM_MAG; i++) {
+        kfree(objs[i]);
+    }
+    for (int i = 0; i < NUM_MAG; i++) {
+        again[i] = (uint32_t*) kmalloc(40);
+        if (!again[i]) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Reallocation failed!\\n");
+            exit_qemu(1);
+        }
+        again[i][0] = i;
+        again[i][15] = ~i;
+    }
+    // No object is handed out twice
+    for (int i = 0; i < NUM_MAG; i++) {
+        if (again[i][0] != (uint32_t) i || again[i][15] != ~(uint32_t) i) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Object handed out twice!\\n");
+            exit_qemu(1);
+        }
+    }
+    // The most recently freed object comes back first
+    kfree(again[7]);
+    if (kmalloc(64) != again[7]) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Magazine is not LIFO!\\n");
+        exit_qemu(1);
+    }
+    for (int i = 0; i < NUM_MAG; i++) {
+        kfree(again[i]);
+    }
+    // A steady alloc/free pair stays in the loaded magazine
+    void* first = kmalloc(100);
+    kfree(first);
+    for (int i = 0; i < 10000; i++) {
+        void* p = kmalloc(100);
+        if (p != first) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Alloc/free pair left the magazine!\\n");
+            exit_qemu(1);
+        }
+        kfree(p);
+    }
+    kheap_stats();
+    serial_write_string(SERIAL_COM1_BASE, "Magazines recycle objects\\n");
+    """
+
+    framework.register_test(
+        name="kheap_magazines",
+        test_code=KHEAP_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
@@ -0,0 +1,174 @@
+from test_framework import OlymposTestFramework
+
+KLOG_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/timer.h>
+#include <kernel/klog.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warnings
+    (void) addr;
+
+    terminal_initialize();
+    gdt_init();
+    idt_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_klog_tests(framework: OlymposTestFramework):
+    # Test 1: Messages come back from the ring in order, with their level and text
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    klog_stats_t before;
+    klog_get_stats(&before);
+    int len = klog(KLOG_WARN, "klog test %u\\n", 1u);
+    klog(KLOG_DEBUG, "klog test %s\\n", "two");
+    if (len != 12 || klog(7, "bad level\\n") != -1) {
+        printf("TEST_FAIL: klog() returned %d\\n", len);
+        exit_qemu(1);
+    }
+
+    klog_entry_t entry;
+    char text[KLOG_LINE_MAX];
+    uint32_t seq = before.next_seq;
+    if (!klog_read(&seq, &entry, text, sizeof(text)) || entry.level != KLOG_WARN ||
+        strcmp(text, "klog test 1\\n") != 0) {
+        printf("TEST_FAIL: First message not read back\\n");
+        exit_qemu(1);
+    }
+    if (!klog_read(&seq, &entry, text, 6) || entry.level != KLOG_DEBUG || strcmp(text, "klog ") != 0 ||
+        entry.len != 14 || entry.seq != before.next_seq + 1) {
+        printf("TEST_FAIL: Second message not read back (cut to the buffer)\\n");
+        exit_qemu(1);
+    }
+    if (klog_read(&seq, &entry, text, sizeof(text))) {
+        printf("TEST_FAIL: Read past the newest message\\n");
+        exit_qemu(1);
+    }
+    // Before klog_init() every message is shown at once
+    klog_stats_t after;
+    klog_get_stats(&after);
+    if (after.deferred || after.pending != 0 || after.records != before.records + 2) {
+        printf("TEST_FAIL: %u pending, %u records\\n", after.pending, after.records);
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="klog_ring_read", test_code=KLOG_TEST_TEMPLATE.format(test_body=test_body), expected_output="TEST_PASS"
+    )
+
+    # Test 2: With the console deferred, messages wait for klog_flush(); errors are shown at once
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    klog_init();
+    klog(KLOG_INFO, "deferred info\\n");
+    klog_stats_t stats;
+    klog_get_stats(&stats);
+    if (!stats.deferred || stats.pending != 2) {
+        printf("TEST_FAIL: %u pending after klog_init() and one message\\n", stats.pending);
+        exit_qemu(1);
+    }
+    klog_flush();
+    klog_get_stats(&stats);
+    uint32_t after_flush = stats.pending;
+    klog(KLOG_INFO, "queued\\n");
+    klog(KLOG_ERR, "[FAILED] shown at once, with what was queued before\\n");
+    klog_get_stats(&stats);
+    if (after_flush != 0 || stats.pending != 0) {
+        printf("TEST_FAIL: %u pending after flush, %u after an error\\n", after_flush, stats.pending);
+        exit_qemu(1);
+    }
+    // The idle drain shows one message per call
+    klog(KLOG_INFO, "one\\n");
+    klog(KLOG_INFO, "two\\n");
+    bool drained = klog_drain_idle();
+    klog_get_stats(&stats);
+    uint32_t left = stats.pending;
+    klog_drain_idle();
+    if (!drained || left != 1 || klog_drain_idle()) {
+        printf("TEST_FAIL: Idle drain left %u\\n", left);
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="klog_deferred_console",
+        test_code=KLOG_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: A full ring overwrites the oldest messages; unshown info is dropped, a warning is shown first
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    klog_init();
+    klog_set_console_level(KLOG_WARN);   // Keep the flood off the screen
+    klog(KLOG_WARN, "warning before the flood\\n");
+    char line[100];
+    memset(line, 'x', sizeof(line) - 2);
+    line[sizeof(line) - 2] = '\\n';
+    line[sizeof(line) - 1] = '\\0';
+    for (int i = 0; i < 400; i++) {
+        klog(KLOG_INFO, "%s", line);
+    }
+    klog(KLOG_INFO, "newest\\n");
+
+    klog_stats_t stats;
+    klog_get_stats(&stats);
+    klog_entry_t entry;
+    char text[KLOG_LINE_MAX];
+    uint32_t seq = 0;
+    uint32_t first = 0, count = 0;
+    int warned = 0;
+    while (klog_read(&seq, &entry, text, sizeof(text))) {
+        if (count++ == 0) {
+            first = entry.seq;
+        }
+        warned |= entry.level == KLOG_WARN;
+    }
+    printf("%u records from #%u, %u pending, %u dropped\\n", stats.records, first, stats.pending, stats.dropped);
+    // 400 * 116 bytes don't fit in 16 KiB: the oldest went, the warning was rendered before it did
+    if (first == 0 || warned || count != stats.records || strcmp(text, "newest\\n") != 0 || stats.dropped == 0 ||
+        (stats.records - 1) * 116 > KLOG_BUFFER_SIZE || stats.pending > stats.records) {
+        printf("TEST_FAILED\\n");
+        exit_qemu(1);
+    }
+    klog_flush();
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="klog_ring_overflow",
+        test_code=KLOG_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -3,8 +3,12 @@ from test_framework import OlymposTestFramework
 PAGING_TEST_TEMPLATE = """
 #include <kernel/serial.h>
 #include <kernel/paging.h>
+#include <kernel/vmm.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
 #include <kernel/multiboot.h>
 #include <kernel/debug.h>
+#include <kernel/module.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -42,7 +46,7 @@ def register_paging_tests(framework: OlymposTestFramework):
     # Test 1: Basic paging initialization
     test_body = """
     serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
-    paging_init();
+    paging_init(mbi);
     serial_write_string(SERIAL_COM1_BASE, "Paging initialized successfully!\\n");
     
     // Test reading from identity-mapped kernel memory
@@ -60,7 +64,7 @@ def register_paging_tests(framework: OlymposTestFramework):
     # Test 2: Frame allocation
     test_body = """
     serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
-    paging_init();
+    paging_init(mbi);
     
     serial_write_string(SERIAL_COM1_BASE, "Testing frame allocation...\\n");
     uint32_t frame1 = frame_alloc();
@@ -98,7 +102,7 @@ def register_paging_tests(framework: OlymposTestFramework):
     # Test 3: Page fault detection
     test_body = """
     serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
-    paging_init();
+    paging_init(mbi);
     
     serial_write_string(SERIAL_COM1_BASE, "Testing page fault detection...\\n");
     serial_write_string(SERIAL_COM1_BASE, "Reading from identity-mapped memory (should succeed)...\\n");
@@ -122,3 +126,394 @@ def register_paging_tests(framework: OlymposTestFramework):
         test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS"
     )
+
+    # Test 4: Buddy allocator (contiguous multi-frame blocks)
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(mbi);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing buddy allocation...\\n");
+    uint32_t block = frame_alloc_order(4);  // 16 frames = 64 KiB
+    if (block == 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: frame_alloc_order(4) failed!\\n");
+        exit_qemu(1);
+    }
+    if (block % (16 * FRAME_SIZE) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Block not aligned to its size!\\n");
+        exit_qemu(1);
+    }
+
+    // Single frames must not land inside the block
+    uint32_t frame = frame_alloc();
+    if (frame == 0 || (frame >= block && frame < block + 16 * FRAME_SIZE)) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Frame overlaps allocated block!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Contiguous block allocated\\n");
+
+    // Freeing coalesces the buddies back, so the same block comes back
+    frame_free(frame);
+    frame_free_order(block, 4);
+    uint32_t again = frame_alloc_order(4);
+    if (again != block) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Buddies not coalesced!\\n");
+        exit_qemu(1);
+    }
+    frame_free_order(again, 4);
+
+    // Invalid order must fail cleanly
+    if (frame_alloc_order(FRAME_MAX_ORDER + 1) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Invalid order accepted!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Buddy allocator tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_buddy_alloc",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 5: 4 MiB PSE pages for the kernel identity map
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(mbi);
+
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+    if (edx & (1 << 3)) {
+        uint32_t cr3, cr4;
+        asm volatile("mov %%cr3, %0" : "=r"(cr3));
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        page_directory_t* pd = (page_directory_t*) cr3;
+        if (!(cr4 & CR4_PSE) || !(pd->entries[0] & PDE_PAGE_SIZE) || !(pd->entries[1] & PDE_PAGE_SIZE)) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Kernel region not mapped with 4 MiB pages!\\n");
+            exit_qemu(1);
+        }
+        serial_write_string(SERIAL_COM1_BASE, "Kernel region uses 4 MiB pages\\n");
+    }
+    else {
+        serial_write_string(SERIAL_COM1_BASE, "CPU has no PSE, using 4 KiB pages\\n");
+    }
+
+    // Both ends of the identity-mapped region must be accessible
+    volatile uint32_t* low = (volatile uint32_t*)0x100000;
+    volatile uint32_t* high = (volatile uint32_t*)(KMEM_MAX - 4);
+    uint32_t value = *low;
+    *high = 0xCAFEBABE;
+    if (*high != 0xCAFEBABE) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Write to top of identity map lost!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Identity map accessible!\\n");
+    """
+
+    framework.register_test(
+        name="paging_pse_identity_map",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 6: paging_map / paging_unmap with targeted TLB invalidation
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(mbi);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing paging_map/paging_unmap...\\n");
+    uint32_t frame_a = frame_alloc();
+    uint32_t frame_b = frame_alloc();
+    volatile uint32_t* v1 = (volatile uint32_t*)0x40000000;  // 1 GiB, outside the identity map
+    volatile uint32_t* v2 = (volatile uint32_t*)0x40001000;
+
+    if (paging_map((uint32_t) v1, frame_a, PTE_WRITABLE) != 0 ||
+        paging_map((uint32_t) v2, frame_a, PTE_WRITABLE) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: paging_map failed!\\n");
+        exit_qemu(1);
+    }
+
+    // Both pages alias frame A
+    *v1 = 0x11111111;
+    if (*v2 != 0x11111111) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Aliased mapping not visible!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Aliased mappings work\\n");
+
+    // Remap v2 to frame B; the stale TLB entry must be gone
+    paging_map((uint32_t) v2, frame_b, PTE_WRITABLE);
+    *v2 = 0x22222222;
+    if (*v1 != 0x11111111) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Stale TLB entry after remap!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Remap invalidated TLB entry\\n");
+
+    if (paging_unmap((uint32_t) v2) != frame_b || paging_unmap((uint32_t) v2) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: paging_unmap returned wrong frame!\\n");
+        exit_qemu(1);
+    }
+    paging_flush_range((uint32_t) v1, 64 * PAGE_SIZE);  // Full flush path
+    if (*v1 != 0x11111111) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Mapping lost after full flush!\\n");
+        exit_qemu(1);
+    }
+    paging_unmap((uint32_t) v1);
+    frame_free(frame_a);
+    frame_free(frame_b);
+    serial_write_string(SERIAL_COM1_BASE, "Mapping API tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_map_unmap",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 7: Demand paging with lazy zero-fill
+    test_body = """
+    // Faults need the IDT in place
+    gdt_init();
+    idt_init();
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(mbi);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing demand paging...\\n");
+    uint32_t base = 0x50000000;
+    if (vmm_reserve(base, 64 * 1024 * 1024, PTE_WRITABLE) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: vmm_reserve failed!\\n");
+        exit_qemu(1);
+    }
+    if (vmm_reserve(base + PAGE_SIZE, PAGE_SIZE, PTE_WRITABLE) == 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Overlapping reservation accepted!\\n");
+        exit_qemu(1);
+    }
+
+    // First touch of far-apart pages faults them in, zero-filled
+    volatile uint32_t* first = (volatile uint32_t*) base;
+    volatile uint32_t* last = (volatile uint32_t*) (base + 64 * 1024 * 1024 - 4);
+    if (*first != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Demand page not zero-filled!\\n");
+        exit_qemu(1);
+    }
+    *first = 0x12345678;
+    *last = 0x87654321;
+    if (*first != 0x12345678 || *last != 0x87654321) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Demand page lost data!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Pages faulted in on first touch\\n");
+
+    if (vmm_release(base) != 0 || vmm_reserve(base, PAGE_SIZE, PTE_WRITABLE) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Release/re-reserve failed!\\n");
+        exit_qemu(1);
+    }
+    if (*first != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Released page kept old data!\\n");
+        exit_qemu(1);
+    }
+    vmm_release(base);
+    serial_write_string(SERIAL_COM1_BASE, "Demand paging tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_demand_zero_fill",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 8: Frame reference counts for copy-on-write sharing
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(mbi);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing frame reference counts...\\n");
+    uint32_t frame = frame_alloc();
+    if (frame_refcount(frame) != 1 || frame_ref(frame) != 0 || frame_refcount(frame) != 2) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: frame_ref did not add a reference!\\n");
+        exit_qemu(1);
+    }
+    frame_release(frame);
+    if (frame_refcount(frame) != 1) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Shared frame freed too early!\\n");
+        exit_qemu(1);
+    }
+    frame_release(frame);
+    if (frame_refcount(frame) != 0 || frame_ref(frame) != -1) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Last reference did not free the frame!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Frame reference count tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_frame_refcount",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 9: Pre-zeroed frame pool
+    test_body = """
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(mbi);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing the zeroed frame pool...\\n");
+    // Dirty a frame first, so a frame reading zero isn't zero by chance
+    uint32_t base = 0x50000000;
+    uint32_t dirty = frame_alloc();
+    paging_map(base, dirty, PTE_WRITABLE);
+    memset((void*) base, 0xCC, PAGE_SIZE);
+    paging_unmap(base);
+    frame_free(dirty);
+
+    while (frame_zero_idle()) {
+    }
+    if (frame_zeroed_count() != FRAME_ZERO_POOL) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Pool not filled!\\n");
+        exit_qemu(1);
+    }
+
+    // Drain the pool, then take more that are zeroed on the spot; every frame must read zero
+    static uint32_t frames[2 * FRAME_ZERO_POOL];
+    for (int round = 0; round < 2; round++) {
+        for (uint32_t i = 0; i < FRAME_ZERO_POOL; i++) {
+            uint32_t frame = frame_alloc_zeroed();
+            if (frame == 0 || paging_map(base, frame, PTE_WRITABLE) != 0) {
+                serial_write_string(SERIAL_COM1_BASE, "ERROR: frame_alloc_zeroed failed!\\n");
+                exit_qemu(1);
+            }
+            for (uint32_t j = 0; j < PAGE_SIZE / 4; j++) {
+                if (((volatile uint32_t*) base)[j] != 0) {
+                    serial_write_string(SERIAL_COM1_BASE, "ERROR: Frame not zeroed!\\n");
+                    exit_qemu(1);
+                }
+            }
+            memset((void*) base, 0xCC, PAGE_SIZE);
+            paging_unmap(base);
+            frames[round * FRAME_ZERO_POOL + i] = frame;
+        }
+        if (frame_zeroed_count() != 0) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Pool not drained!\\n");
+            exit_qemu(1);
+        }
+        if (round == 0) {
+            // Hand the dirtied frames back so the pool misses have to zero them
+            for (uint32_t i = 0; i < FRAME_ZERO_POOL; i++) {
+                frame_free(frames[i]);
+            }
+        }
+    }
+    for (uint32_t i = FRAME_ZERO_POOL; i < 2 * FRAME_ZERO_POOL; i++) {
+        frame_free(frames[i]);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Zeroed frame pool tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_zeroed_pool",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 10: Boot data above KMEM_MAX (a module and its command line) stays out of the free pool
+    test_body = """
+    // A copy of the boot information with one module at 16 MiB; paging is still off, so it is written directly
+    static multiboot_info_t boot;
+    static multiboot_module_t high;
+    memcpy(&boot, mbi, sizeof(boot));
+    memset((void*) 0x01000000, 0xA5, 0x2800);
+    memcpy((void*) 0x01003000, "/boot/high.bin", sizeof("/boot/high.bin"));
+    high.mod_start = 0x01000000;
+    high.mod_end = 0x01002800;
+    high.cmdline = 0x01003000;
+    high.pad = 0;
+    boot.flags |= MULTIBOOT_INFO_MODS;
+    boot.mods_count = 1;
+    boot.mods_addr = (uint32_t) &high;
+
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(&boot);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing boot reservations above KMEM_MAX...\\n");
+    for (uint32_t frame = 0x01000000; frame <= 0x01003000; frame += FRAME_SIZE) {
+        if (frame_refcount(frame) != 1) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Module or command line frame is free!\\n");
+            exit_qemu(1);
+        }
+    }
+    if (frame_refcount(0x01004000) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Frame after the command line reserved!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "Boot reservation tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_boot_ranges_high",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 11: A module above KMEM_MAX keeps its frames while memory is exhausted, and they can be shared
+    test_body = """
+    // As in test 10: one module at 16 MiB, written while paging is still off
+    static multiboot_info_t boot;
+    static multiboot_module_t high;
+    memcpy(&boot, mbi, sizeof(boot));
+    for (uint32_t i = 0; i < 0x2800; i++) {
+        ((uint8_t*) 0x01000000)[i] = (uint8_t) (i * 7);
+    }
+    memcpy((void*) 0x01003000, "/boot/high.bin", sizeof("/boot/high.bin"));
+    high.mod_start = 0x01000000;
+    high.mod_end = 0x01002800;
+    high.cmdline = 0x01003000;
+    high.pad = 0;
+    boot.flags |= MULTIBOOT_INFO_MODS;
+    boot.mods_count = 1;
+    boot.mods_addr = (uint32_t) &high;
+
+    serial_write_string(SERIAL_COM1_BASE, "Initializing paging...\\n");
+    paging_init(&boot);
+    module_init(&boot);
+
+    serial_write_string(SERIAL_COM1_BASE, "Testing a module above KMEM_MAX...\\n");
+    const module_t* mod = module_find("high.bin");
+    if (mod == NULL || mod->phys != 0x01000000 || mod->size != 0x2800) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Module not registered!\\n");
+        exit_qemu(1);
+    }
+
+    // Take every free frame: none of them may be the module's
+    static uint32_t taken[65536];
+    uint32_t count = 0;
+    while (count < sizeof(taken) / sizeof(taken[0]) && (taken[count] = frame_alloc()) != 0) {
+        if (taken[count] >= 0x01000000 && taken[count] < 0x01003000) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Module frame handed out!\\n");
+            exit_qemu(1);
+        }
+        count++;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        frame_free(taken[i]);
+    }
+
+    // Processes map module text by taking a reference on its frames
+    if (frame_ref(0x01001000) != 0 || frame_refcount(0x01001000) != 2) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Module frame can't be shared!\\n");
+        exit_qemu(1);
+    }
+    frame_release(0x01001000);
+    for (uint32_t i = 0; i < mod->size; i++) {
+        if (((const uint8_t*) mod->data)[i] != (uint8_t) (i * 7)) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: Module contents changed!\\n");
+            exit_qemu(1);
+        }
+    }
+    serial_write_string(SERIAL_COM1_BASE, "High module tests passed!\\n");
+    """
+
+    framework.register_test(
+        name="paging_module_above_kmem_max",
+        test_code=PAGING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
@@ -0,0 +1,277 @@
+import os
+import tempfile
+
+from test_framework import OlymposTestFramework
+
+PCACHE_DISK_SECTORS = 2048
+PCACHE_DISK_IMAGE = os.path.join(tempfile.gettempdir(), "olympos-pcache-test.img")
+
+PCACHE_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/block.h>
+#include <kernel/ata.h>
+#include <kernel/pcache.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+static uint8_t buffer[16 * 4096] __attribute__((aligned(4096)));
+
+// The image holds the LBA in the first 4 bytes of each sector, then (lba + offset) & 0xff
+__attribute__((unused)) static int check_sector(const uint8_t* sector, uint32_t lba) {{
+    uint32_t stored;
+    memcpy(&stored, sector, 4);
+    if (stored != lba) {{
+        return 0;
+    }}
+    for (uint32_t i = 4; i < 512; i++) {{
+        if (sector[i] != (uint8_t) (lba + i)) {{
+            return 0;
+        }}
+    }}
+    return 1;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+    pcache_init();
+    ata_init();
+
+    block_device_t* dev = block_find("hda");
+    if (dev == NULL) {{
+        printf("TEST_FAIL: no hda\\n");
+        exit_qemu(1);
+    }}
+    static pcache_mapping_t disk;
+    pcache_mapping_init(&disk, dev, 0, dev->sectors * BLOCK_SECTOR_SIZE);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def write_disk_image(path: str):
+    with open(path, "wb") as image:
+        for lba in range(PCACHE_DISK_SECTORS):
+            sector = bytearray((lba + i) & 0xFF for i in range(512))
+            sector[0:4] = lba.to_bytes(4, "little")
+            image.write(sector)
+
+
+def register_pcache_tests(framework: OlymposTestFramework):
+    write_disk_image(PCACHE_DISK_IMAGE)
+    disk_args = ["-drive", f"file={PCACHE_DISK_IMAGE},format=raw,if=ide,index=0"]
+
+    # Test 1: A sequential reader misses once and finds every later page read ahead; random access doesn't read ahead
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    for (uint32_t page = 0; page < 16; page++) {
+        if (pcache_read(&disk, page * 4096, buffer, 4096) != 4096) {
+            printf("TEST_FAIL: read of page %u failed\\n", page);
+            exit_qemu(1);
+        }
+        for (uint32_t s = 0; s < 8; s++) {
+            if (!check_sector(buffer + s * 512, page * 8 + s)) {
+                printf("TEST_FAIL: page %u has the wrong data\\n", page);
+                exit_qemu(1);
+            }
+        }
+    }
+    pcache_stats_t stats;
+    pcache_get_stats(&stats);
+    if (stats.misses != 1 || stats.hits != 15 || stats.readahead < 15) {
+        printf("TEST_FAIL: misses %u hits %u readahead %u\\n",
+               (uint32_t) stats.misses, (uint32_t) stats.hits, (uint32_t) stats.readahead);
+        exit_qemu(1);
+    }
+
+    // Cached: no I/O, even for an unaligned range crossing pages
+    block_stats_t before, after;
+    block_get_stats(dev, &before);
+    if (pcache_read(&disk, 4096 - 512, buffer, 1024) != 1024 || !check_sector(buffer, 7) ||
+        !check_sector(buffer + 512, 8)) {
+        printf("TEST_FAIL: cached read returned the wrong data\\n");
+        exit_qemu(1);
+    }
+    block_get_stats(dev, &after);
+    if (after.ios != before.ios) {
+        printf("TEST_FAIL: cached read went to the disk\\n");
+        exit_qemu(1);
+    }
+
+    uint64_t readahead = stats.readahead;
+    if (pcache_read(&disk, 200 * 4096, buffer, 512) != 512 || !check_sector(buffer, 1600)) {
+        printf("TEST_FAIL: random read failed\\n");
+        exit_qemu(1);
+    }
+    pcache_get_stats(&stats);
+    if (stats.readahead != readahead || stats.misses != 2) {
+        printf("TEST_FAIL: random read read ahead (%u pages) or didn't miss\\n",
+               (uint32_t) (stats.readahead - readahead));
+        exit_qemu(1);
+    }
+
+    // Reads stop at the end of the mapping
+    if (pcache_read(&disk, disk.size - 100, buffer, 4096) != 100 || pcache_read(&disk, disk.size, buffer, 1) != 0) {
+        printf("TEST_FAIL: read past the end wasn't cut short\\n");
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="pcache_readahead",
+        test_code=PCACHE_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=disk_args,
+    )
+
+    # Test 2: Partial and whole-page writes stay dirty until pcache_sync() writes them to the disk
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    // Partial: the rest of page 100 must come from the disk
+    const char message[] = "written through the page cache";
+    if (pcache_write(&disk, 100 * 4096 + 600, message, sizeof(message)) != (int32_t) sizeof(message)) {
+        printf("TEST_FAIL: partial write failed\\n");
+        exit_qemu(1);
+    }
+    // Whole page 101, never read
+    for (uint32_t i = 0; i < 4096; i++) {
+        buffer[i] = (uint8_t) (0x5A ^ i);
+    }
+    if (pcache_write(&disk, 101 * 4096, buffer, 4096) != 4096) {
+        printf("TEST_FAIL: whole-page write failed\\n");
+        exit_qemu(1);
+    }
+    pcache_stats_t stats;
+    pcache_get_stats(&stats);
+    if (stats.dirty != 2 || stats.misses != 2) {
+        printf("TEST_FAIL: dirty %u misses %u\\n", stats.dirty, (uint32_t) stats.misses);
+        exit_qemu(1);
+    }
+
+    if (pcache_sync(&disk) != 0) {
+        printf("TEST_FAIL: sync failed\\n");
+        exit_qemu(1);
+    }
+    pcache_get_stats(&stats);
+    if (stats.dirty != 0 || stats.written_back != 2) {
+        printf("TEST_FAIL: after sync dirty %u written back %u\\n", stats.dirty, (uint32_t) stats.written_back);
+        exit_qemu(1);
+    }
+
+    static uint8_t disk_data[2 * 4096];
+    if (block_read(dev, 800, 16, disk_data) != 0) {
+        printf("TEST_FAIL: block read failed\\n");
+        exit_qemu(1);
+    }
+    if (!check_sector(disk_data, 800) || memcmp(disk_data + 600, message, sizeof(message)) != 0 ||
+        !check_sector(disk_data + 1024, 802) || memcmp(disk_data + 4096, buffer, 4096) != 0) {
+        printf("TEST_FAIL: the disk doesn't hold the writes\\n");
+        exit_qemu(1);
+    }
+
+    // And the cache still serves them
+    static uint8_t cached[sizeof(message)];
+    if (pcache_read(&disk, 100 * 4096 + 600, cached, sizeof(message)) != (int32_t) sizeof(message) ||
+        memcmp(cached, message, sizeof(message)) != 0) {
+        printf("TEST_FAIL: cached copy lost the write\\n");
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="pcache_write_sync",
+        test_code=PCACHE_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=disk_args,
+    )
+
+    # Test 3: Running the frame allocator dry evicts clean pages instead of failing
+    test_helpers = """
+static uint32_t frames[32 * 256];
+"""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    // The whole 1 MiB disk: 256 pages
+    for (uint32_t offset = 0; offset < disk.size; offset += sizeof(buffer)) {
+        if (pcache_read(&disk, offset, buffer, sizeof(buffer)) != (int32_t) sizeof(buffer)) {
+            printf("TEST_FAIL: read at %u failed\\n", offset);
+            exit_qemu(1);
+        }
+    }
+    pcache_stats_t stats;
+    pcache_get_stats(&stats);
+    if (stats.pages != 256) {
+        printf("TEST_FAIL: expected 256 cached pages, got %u\\n", stats.pages);
+        exit_qemu(1);
+    }
+
+    uint32_t count = 0;
+    while (count < sizeof(frames) / sizeof(frames[0]) && (frames[count] = frame_alloc()) != 0) {
+        count++;
+    }
+    pcache_get_stats(&stats);
+    if (stats.pages != 0 || stats.evicted != 256) {
+        printf("TEST_FAIL: %u pages left, %u evicted\\n", stats.pages, (uint32_t) stats.evicted);
+        exit_qemu(1);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        frame_free(frames[i]);
+    }
+
+    // The evicted pages come back from the disk
+    if (pcache_read(&disk, 50 * 4096, buffer, 4096) != 4096 || !check_sector(buffer, 400)) {
+        printf("TEST_FAIL: re-read after eviction failed\\n");
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="pcache_reclaim",
+        test_code=PCACHE_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=disk_args + ["-m", "32"],
+    )
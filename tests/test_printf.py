@@ -28,6 +28,42 @@ void kernel_main(unsigned long magic, unsigned long addr) {{
 }}
 """
 
+PRINTF_SINK_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/serial.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    (void) addr;
+    terminal_initialize();
+    serial_setup(SERIAL_COM1_BASE, SERIAL_BAUD_115200);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
 
 def register_printf_tests(framework: OlymposTestFramework):
     # Test 1: Basic printf
@@ -77,7 +113,7 @@ def register_printf_tests(framework: OlymposTestFramework):
 
     # Test 5: Unsigned integer format specifier
     test_body = """
-    unsigned int u = 1234567890; // stays within INT_MAX to avoid itoa sign issues
+    unsigned int u = 1234567890;
     printf("Unsigned (%%u): %u\\n", u);
     printf("TEST_PASS\\n");
     """
@@ -198,3 +234,106 @@ def register_printf_tests(framework: OlymposTestFramework):
         test_code=PRINTF_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS",
     )
+
+    # Test 14: Stream API (stdout is an unbuffered terminal sink in the kernel)
+    test_body = """
+    fwrite("fwrite ", 1, 7, stdout);
+    fputc('o', stdout);
+    fputc('k', stdout);
+    fputc('\\n', stdout);
+    if (fflush(stdout) != 0 || fflush(NULL) != 0 || setvbuf(stdout, NULL, 42, 0) != -1) {
+        printf("TEST_FAIL\\n");
+    }
+    fwrite("TEST_", 1, 5, stdout);
+    fwrite("PASS\\n", 5, 1, stdout);
+    """
+
+    framework.register_test(
+        name="printf_stream_write",
+        test_code=PRINTF_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 15: Unsigned values above INT_MAX and 64-bit conversions
+    test_body = """
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer), "%u %d %x %p %lu", 4000000000u, -2147483647 - 1, 0xdeadbeef,
+             (void*) 0xfffff000, 4294967295ul);
+    if (strcmp(buffer, "4000000000 -2147483648 deadbeef 0xfffff000 4294967295") != 0) {
+        printf("TEST_FAIL: 32-bit conversions gave '%s'\\n", buffer);
+        exit_qemu(1);
+    }
+    snprintf(buffer, sizeof(buffer), "%llu %lld %llx %llu", 18446744073709551615ull, -9223372036854775807ll - 1,
+             0x123456789abcdefull, 1000000000000ull);
+    if (strcmp(buffer, "18446744073709551615 -9223372036854775808 123456789abcdef 1000000000000") != 0) {
+        printf("TEST_FAIL: 64-bit conversions gave '%s'\\n", buffer);
+        exit_qemu(1);
+    }
+    char digits[24];
+    if (utoa10(0, digits) != 1 || strcmp(digits, "0") != 0 || utoa16_64(0x100000000ull, digits) != 9 ||
+        strcmp(digits, "100000000") != 0 || strcmp(itoa(-255, digits, 16), "ffffff01") != 0) {
+        printf("TEST_FAIL: utoa edge cases\\n");
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="printf_format_64bit",
+        test_code=PRINTF_SINK_TEST_TEMPLATE.format(test_helpers="#include <stdlib.h>", test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 16: The shared vformat() engine hands a line to its sink in one piece
+    test_helpers = """
+static int sink_calls = 0;
+static size_t sink_bytes = 0;
+
+static int counting_sink(void* ctx, const char* data, size_t len) {
+    (void) ctx;
+    (void) data;
+    sink_calls++;
+    sink_bytes += len;
+    return 0;
+}
+
+static int count_format(const char* format, ...) {
+    sink_calls = 0;
+    sink_bytes = 0;
+    va_list args;
+    va_start(args, format);
+    int written = vformat(counting_sink, NULL, format, args);
+    va_end(args);
+    return written;
+}
+"""
+
+    test_body = """
+    int n = count_format("x = %d, %s at %p (%zu%%)\\n", -42, "ok", (void*) 0x1000, (size_t) 7);
+    if (n != 27 || sink_calls != 1 || sink_bytes != 27) {
+        printf("TEST_FAIL: %d chars in %d chunks\\n", n, sink_calls);
+        exit_qemu(1);
+    }
+    // A string longer than the chunk goes to the sink directly
+    static char big[300];
+    memset(big, 'a', sizeof(big) - 1);
+    n = count_format("[%s]", big);
+    if (n != 301 || sink_calls != 3 || sink_bytes != 301) {
+        printf("TEST_FAIL: Long string took %d chunks\\n", sink_calls);
+        exit_qemu(1);
+    }
+    // snprintf() still truncates and reports the full length
+    char buffer[8];
+    if (snprintf(buffer, sizeof(buffer), "%s-%d", "olympos", 12) != 10 || strcmp(buffer, "olympos") != 0) {
+        printf("TEST_FAIL: snprintf gave '%s'\\n", buffer);
+        exit_qemu(1);
+    }
+    kprintf("kprintf reaches the console and COM1\\n");
+    serial_printf(SERIAL_COM1_BASE, "TEST_%s\\n", "PASS");
+    """
+
+    framework.register_test(
+        name="printf_vformat_chunks",
+        test_code=PRINTF_SINK_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -0,0 +1,516 @@
+from test_framework import OlymposTestFramework
+
+PROCESS_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/debug.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/process.h>
+#include <kernel/module.h>
+#include <kernel/syscall.h>
+#include <kernel/vclock.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    debug_initialize(mbi);
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    syscall_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_process_tests(framework: OlymposTestFramework):
+    # Test 1: Two processes use the same user address for different data while being preempted
+    test_helpers = """
+    // Loaded at 0x40000000: copy the marker at +0x40 to the slot at +0x44, spin long enough to be
+    // preempted, then exit with whatever the slot holds
+    static uint8_t program[0x48] = {
+        0xA1, 0x40, 0x00, 0x00, 0x40,           // mov eax, [0x40000040]
+        0xA3, 0x44, 0x00, 0x00, 0x40,           // mov [0x40000044], eax
+        0xB9, 0x00, 0x00, 0x00, 0x01,           // mov ecx, 0x01000000
+        0x49,                                   // dec ecx
+        0x75, 0xFD,                             // jnz dec
+        0x8B, 0x1D, 0x44, 0x00, 0x00, 0x40,     // mov ebx, [0x40000044]
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    program[0x40] = 11;
+    process_t* first = process_create("first", program, sizeof(program));
+    program[0x40] = 22;
+    process_t* second = process_create("second", program, sizeof(program));
+    if (first == NULL || second == NULL) {
+        printf("TEST_FAILED\\n");
+        exit_qemu(1);
+    }
+    int separate = first->page_directory != second->page_directory &&
+                   first->page_directory != paging_kernel_directory();
+    int first_code = process_wait(first);
+    int second_code = process_wait(second);
+    printf("Exit codes: %d %d\\n", first_code, second_code);
+
+    if (separate && first_code == 11 && second_code == 22 && paging_current_directory() == paging_kernel_directory()) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_isolation",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: Ring 3 can't touch kernel memory, directly or through a syscall, and the kernel survives
+    test_helpers = """
+    // Reads the kernel image at 1 MiB: page fault from ring 3
+    static const uint8_t reader[] = {
+        0xA1, 0x00, 0x00, 0x10, 0x00,           // mov eax, [0x00100000]
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0x31, 0xDB,                             // xor ebx, ebx
+        0xCD, 0x80,                             // int 0x80
+    };
+
+    // write(1, buf, 18) and exit with its result; buf is patched per run
+    static uint8_t writer[0x60] = {
+        0xB8, 0x04, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_WRITE
+        0xBB, 0x01, 0x00, 0x00, 0x00,           // mov ebx, 1
+        0xB9, 0x00, 0x00, 0x00, 0x00,           // mov ecx, buf
+        0xBA, 0x12, 0x00, 0x00, 0x00,           // mov edx, 18
+        0xCD, 0x80,                             // int 0x80
+        0x89, 0xC3,                             // mov ebx, eax
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+
+    static void set_buffer(uint32_t buf) {
+        memcpy(&writer[11], &buf, sizeof(buf));
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    int fault_code = process_wait(process_create("reader", reader, sizeof(reader)));
+
+    memcpy(&writer[0x40], "Hello from ring 3\\n", 18);
+    set_buffer(0x00100000);
+    int kernel_buf_code = process_wait(process_create("leaker", writer, sizeof(writer)));
+    set_buffer(USER_CODE_START + 0x40);
+    int user_buf_code = process_wait(process_create("writer", writer, sizeof(writer)));
+    printf("Exit codes: fault %d, kernel buffer %d, user buffer %d\\n", fault_code, kernel_buf_code, user_buf_code);
+
+    if (fault_code == -1 && kernel_buf_code == -1 && user_buf_code == 18) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_fault_isolated",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: fork() shares pages copy-on-write; each side's write lands in its own copy
+    test_helpers = """
+    // Both sides store fork()'s result in the code page, spin so the other side runs and writes
+    // too, then exit with 100 + what they read back: 100 + child PID in the parent, 100 in the child
+    static const uint8_t forker[] = {
+        0xB8, 0x02, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_FORK
+        0xCD, 0x80,                             // int 0x80
+        0xA3, 0x80, 0x00, 0x00, 0x40,           // mov [0x40000080], eax
+        0xB9, 0x00, 0x00, 0x00, 0x01,           // mov ecx, 0x01000000
+        0x49,                                   // dec ecx
+        0x75, 0xFD,                             // jnz dec
+        0x8B, 0x1D, 0x80, 0x00, 0x00, 0x40,     // mov ebx, [0x40000080]
+        0x83, 0xC3, 0x64,                       // add ebx, 100
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    process_t* parent = process_create("forker", forker, sizeof(forker));
+    uint32_t parent_pid = parent->pid;
+    int parent_code = process_wait(parent);
+    process_t* child = process_find(parent_code - 100);
+    int child_code = child ? process_wait(child) : -1;
+    printf("Parent %u exited with %d, child with %d\\n", parent_pid, parent_code, child_code);
+
+    if (parent_code == 100 + (int) parent_pid + 1 && child_code == 100) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_fork_cow",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 4: ELF program from a module: text shared between instances, data and bss private
+    test_helpers = """
+    // Two pages: headers + text at offset 0 (R+X), then a writable data word followed by a bss page
+    static uint8_t image[0x2000] __attribute__((aligned(4096)));
+
+    static const uint8_t code[] = {
+        0xA1, 0x00, 0x10, 0x00, 0x40,           // mov eax, [0x40001000]  (data: 42)
+        0x03, 0x05, 0x00, 0x20, 0x00, 0x40,     // add eax, [0x40002000]  (bss: 0)
+        0x40,                                   // inc eax
+        0xA3, 0x00, 0x10, 0x00, 0x40,           // mov [0x40001000], eax
+        0xB9, 0x00, 0x00, 0x00, 0x04,           // mov ecx, 0x04000000
+        0x49,                                   // dec ecx
+        0x75, 0xFD,                             // jnz dec
+        0x8B, 0x1D, 0x00, 0x10, 0x00, 0x40,     // mov ebx, [0x40001000]
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+
+    static void put16(uint32_t offset, uint16_t value) {
+        memcpy(&image[offset], &value, sizeof(value));
+    }
+
+    static void put32(uint32_t offset, uint32_t value) {
+        memcpy(&image[offset], &value, sizeof(value));
+    }
+
+    static void put_phdr(uint32_t offset, uint32_t file_off, uint32_t vaddr, uint32_t filesz, uint32_t memsz,
+                         uint32_t flags) {
+        put32(offset, 1);               // PT_LOAD
+        put32(offset + 4, file_off);
+        put32(offset + 8, vaddr);
+        put32(offset + 16, filesz);
+        put32(offset + 20, memsz);
+        put32(offset + 24, flags);
+        put32(offset + 28, 0x1000);
+    }
+
+    static void build_image(void) {
+        memcpy(image, "\\177ELF\\1\\1\\1", 7);   // ELF32, little-endian, version 1
+        put16(16, 2);                   // ET_EXEC
+        put16(18, 3);                   // EM_386
+        put32(20, 1);
+        put32(24, 0x40000080);          // e_entry
+        put32(28, 52);                  // e_phoff
+        put16(40, 52);
+        put16(42, 32);                  // e_phentsize
+        put16(44, 2);                   // e_phnum
+        put_phdr(52, 0, 0x40000000, 0x1000, 0x1000, 0x5);          // R+X
+        put_phdr(84, 0x1000, 0x40001000, 4, 0x2000, 0x6);          // R+W, bss after the word
+        memcpy(&image[0x80], code, sizeof(code));
+        put32(0x1000, 42);
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    build_image();
+    const module_t* mod = module_register("hello", (uint32_t) image, sizeof(image));
+    uint32_t text_frame = (uint32_t) image;  // Identity mapped: physical == virtual
+    uint32_t garbage = 0;
+    module_register("garbage", (uint32_t) &garbage, sizeof(garbage));
+    if (mod == NULL || module_find("hello") != mod || process_exec("garbage") != NULL ||
+        process_exec("missing") != NULL) {
+        printf("TEST_FAILED\\n");
+        exit_qemu(1);
+    }
+
+    process_t* first = process_exec("hello");
+    process_t* second = process_exec("hello");
+    if (first == NULL || second == NULL) {
+        printf("TEST_FAILED\\n");
+        exit_qemu(1);
+    }
+    // Both instances map the module's text frame once they start running
+    uint32_t shared = 0;
+    for (int i = 0; i < 100 && shared < 3; i++) {
+        ksleep(1);
+        shared = frame_refcount(text_frame);
+    }
+    int first_code = process_wait(first);
+    int second_code = process_wait(second);
+    printf("Text frame references while running: %u, after exit: %u\\n", shared, frame_refcount(text_frame));
+    printf("Exit codes: %d %d, module data %u\\n", first_code, second_code, *(uint32_t*) &image[0x1000]);
+
+    if (shared == 3 && frame_refcount(text_frame) == 1 && first_code == 43 && second_code == 43 &&
+        *(uint32_t*) &image[0x1000] == 42) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_exec_elf",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 5: SYSENTER fast system calls reach the same handlers as int 0x80
+    test_helpers = """
+    // write(1, "SE\\n", 3) and exit(100 + bytes written), both through SYSENTER; the return address is the
+    // top of the stack passed in EBP
+    static const uint8_t program[] = {
+        0xB8, 0x04, 0x00, 0x00, 0x00,           // 0x00: mov eax, SYSCALL_WRITE
+        0xBB, 0x01, 0x00, 0x00, 0x00,           // 0x05: mov ebx, 1
+        0xB9, 0x40, 0x00, 0x00, 0x40,           // 0x0A: mov ecx, 0x40000040
+        0xBA, 0x03, 0x00, 0x00, 0x00,           // 0x0F: mov edx, 3
+        0x55,                                   // 0x14: push ebp
+        0x68, 0x20, 0x00, 0x00, 0x40,           // 0x15: push 0x40000020
+        0x89, 0xE5,                             // 0x1A: mov ebp, esp
+        0x0F, 0x34,                             // 0x1C: sysenter
+        0x90, 0x90,                             // 0x1E: (never executed)
+        0x5D,                                   // 0x20: pop ebp
+        0x89, 0xC3,                             // 0x21: mov ebx, eax
+        0x83, 0xC3, 0x64,                       // 0x23: add ebx, 100
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // 0x26: mov eax, SYSCALL_EXIT
+        0x55,                                   // 0x2B: push ebp
+        0x68, 0x00, 0x00, 0x00, 0x00,           // 0x2C: push 0 (exit doesn't return)
+        0x89, 0xE5,                             // 0x31: mov ebp, esp
+        0x0F, 0x34,                             // 0x33: sysenter
+        0xEB, 0xFE,                             // 0x35: jmp $
+        0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+        'S', 'E', '\\n',                        // 0x40: message
+    };
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    // Without SEP there is nothing to test: the int 0x80 path is covered elsewhere
+    int code = 103;
+    if (syscall_sysenter_enabled()) {
+        process_t* proc = process_create("sysenter", program, sizeof(program));
+        code = proc ? process_wait(proc) : -1;
+    }
+    printf("Exit code: %d\\n", code);
+
+    if (code == 103) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_sysenter",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 6: A system call ring runs a batch of submissions with one kernel entry
+    test_helpers = """
+    // ring = ioring_setup(8, 0); queue WRITE(1, "IO\\n", 3) tagged 7 and NOP tagged 8; ioring_enter(2, 0, 0);
+    // exit(submitted * 100 + cq_tail * 10 + first result)
+    static uint8_t program[0xA4] = {
+        0xB8, 0xA9, 0x01, 0x00, 0x00,           // 0x00: mov eax, SYSCALL_IORING_SETUP
+        0xBB, 0x08, 0x00, 0x00, 0x00,           // 0x05: mov ebx, 8
+        0x31, 0xC9,                             // 0x0A: xor ecx, ecx
+        0xCD, 0x80,                             // 0x0C: int 0x80
+        0x89, 0xC6,                             // 0x0E: mov esi, eax
+        0xC6, 0x46, 0x40, 0x02,                 // 0x10: mov byte [esi+0x40], IORING_OP_WRITE
+        0xC7, 0x46, 0x44, 0x01, 0x00, 0x00, 0x00, // 0x14: mov dword [esi+0x44], 1
+        0xC7, 0x46, 0x48, 0xA0, 0x00, 0x00, 0x40, // 0x1B: mov dword [esi+0x48], 0x400000A0
+        0xC7, 0x46, 0x4C, 0x03, 0x00, 0x00, 0x00, // 0x22: mov dword [esi+0x4C], 3
+        0xC7, 0x46, 0x50, 0x07, 0x00, 0x00, 0x00, // 0x29: mov dword [esi+0x50], 7
+        0xC6, 0x46, 0x60, 0x00,                 // 0x30: mov byte [esi+0x60], IORING_OP_NOP
+        0xC7, 0x46, 0x70, 0x08, 0x00, 0x00, 0x00, // 0x34: mov dword [esi+0x70], 8
+        0xC7, 0x46, 0x04, 0x02, 0x00, 0x00, 0x00, // 0x3B: mov dword [esi+4], 2 (sq_tail)
+        0xB8, 0xAA, 0x01, 0x00, 0x00,           // 0x42: mov eax, SYSCALL_IORING_ENTER
+        0xBB, 0x02, 0x00, 0x00, 0x00,           // 0x47: mov ebx, 2
+        0x31, 0xC9,                             // 0x4C: xor ecx, ecx
+        0x31, 0xD2,                             // 0x4E: xor edx, edx
+        0xCD, 0x80,                             // 0x50: int 0x80
+        0x6B, 0xD8, 0x64,                       // 0x52: imul ebx, eax, 100
+        0x8B, 0x46, 0x0C,                       // 0x55: mov eax, [esi+0xC] (cq_tail)
+        0x6B, 0xC0, 0x0A,                       // 0x58: imul eax, eax, 10
+        0x01, 0xC3,                             // 0x5B: add ebx, eax
+        0x03, 0x9E, 0x44, 0x01, 0x00, 0x00,     // 0x5D: add ebx, [esi+0x144] (cqes[0].res)
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // 0x63: mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // 0x68: int 0x80
+        0xEB, 0xFE,                             // 0x6A: jmp $
+    };
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+    memcpy(&program[0xA0], "IO\\n", 3);
+
+    process_t* proc = process_create("ioring", program, sizeof(program));
+    int code = proc ? process_wait(proc) : -1;
+    printf("Exit code: %d\\n", code);
+
+    if (code == 223) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_ioring_batch",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 7: The clock page is readable without system calls, updates live and can't be written
+    test_helpers = """
+    // Spin until the tick count in the clock page changes, then exit with 100 + its version
+    static const uint8_t reader[] = {
+        0xA1, 0x08, 0x80, 0xFF, 0xBF,           // 0x00: mov eax, [USER_VCLOCK_BASE + 8] (ticks)
+        0x3B, 0x05, 0x08, 0x80, 0xFF, 0xBF,     // 0x05: cmp eax, [USER_VCLOCK_BASE + 8]
+        0x74, 0xF8,                             // 0x0B: je 0x05
+        0x8B, 0x1D, 0x04, 0x80, 0xFF, 0xBF,     // 0x0D: mov ebx, [USER_VCLOCK_BASE + 4] (version)
+        0x83, 0xC3, 0x64,                       // 0x13: add ebx, 100
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // 0x16: mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // 0x1B: int 0x80
+        0xEB, 0xFE,                             // 0x1D: jmp $
+    };
+
+    // Store to the clock page; exits with 0 only if the store didn't fault
+    static const uint8_t writer[] = {
+        0xC7, 0x05, 0x00, 0x80, 0xFF, 0xBF, 0x00, 0x00, 0x00, 0x00, // mov dword [USER_VCLOCK_BASE], 0
+        0x31, 0xDB,                             // xor ebx, ebx
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    int first = process_wait(process_create("reader", reader, sizeof(reader)));
+    int store = process_wait(process_create("writer", writer, sizeof(writer)));
+    // The page must survive both address spaces being torn down
+    int second = process_wait(process_create("reader", reader, sizeof(reader)));
+    printf("Exit codes: reader %d, writer %d, reader again %d\\n", first, store, second);
+
+    if (first == 100 + VCLOCK_VERSION && store == -1 && second == 100 + VCLOCK_VERSION) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_vclock_page",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 8: brk() grows and shrinks a zero-filled heap above the program; madvise() frees heap pages only
+    test_helpers = """
+    // Flat program: the exit code adds up each step's result, 0x4004 if all went as expected
+    static uint8_t program[0x200];
+
+    static const uint8_t code[] = {
+        0xB8, 0x2D, 0x00, 0x00, 0x00,                   // mov eax, SYSCALL_BRK
+        0x31, 0xDB,                                     // xor ebx, ebx (query)
+        0xCD, 0x80,                                     // int 0x80
+        0x89, 0xC6,                                     // mov esi, eax (heap start)
+        0x8D, 0x9E, 0x00, 0x30, 0x00, 0x00,             // lea ebx, [esi + 0x3000]
+        0xB8, 0x2D, 0x00, 0x00, 0x00,                   // mov eax, SYSCALL_BRK
+        0xCD, 0x80,                                     // int 0x80
+        0x29, 0xF0,                                     // sub eax, esi
+        0x89, 0xC7,                                     // mov edi, eax (0x3000)
+        0xC7, 0x86, 0x00, 0x20, 0x00, 0x00, 5, 0, 0, 0, // mov dword [esi + 0x2000], 5
+        0x03, 0xBE, 0x00, 0x20, 0x00, 0x00,             // add edi, [esi + 0x2000] (5)
+        0xB8, 0xDB, 0x00, 0x00, 0x00,                   // mov eax, SYSCALL_MADVISE
+        0x8D, 0x9E, 0x00, 0x20, 0x00, 0x00,             // lea ebx, [esi + 0x2000]
+        0xB9, 0x00, 0x10, 0x00, 0x00,                   // mov ecx, 0x1000
+        0xBA, 0x04, 0x00, 0x00, 0x00,                   // mov edx, MADV_DONTNEED
+        0xCD, 0x80,                                     // int 0x80
+        0x01, 0xC7,                                     // add edi, eax (0)
+        0x03, 0xBE, 0x00, 0x20, 0x00, 0x00,             // add edi, [esi + 0x2000] (0: faulted in anew)
+        0xB8, 0x2D, 0x00, 0x00, 0x00,                   // mov eax, SYSCALL_BRK
+        0x8D, 0x9E, 0x00, 0x10, 0x00, 0x00,             // lea ebx, [esi + 0x1000]
+        0xCD, 0x80,                                     // int 0x80
+        0x29, 0xF0,                                     // sub eax, esi
+        0x01, 0xC7,                                     // add edi, eax (0x1000)
+        0xB8, 0xDB, 0x00, 0x00, 0x00,                   // mov eax, SYSCALL_MADVISE
+        0xBB, 0x00, 0xF0, 0xFF, 0xBF,                   // mov ebx, 0xBFFFF000 (stack)
+        0xB9, 0x00, 0x10, 0x00, 0x00,                   // mov ecx, 0x1000
+        0xBA, 0x04, 0x00, 0x00, 0x00,                   // mov edx, MADV_DONTNEED
+        0xCD, 0x80,                                     // int 0x80
+        0x01, 0xC7,                                     // add edi, eax (-1)
+        0x89, 0xF0,                                     // mov eax, esi
+        0x2D, 0x00, 0x10, 0x00, 0x40,                   // sub eax, 0x40001000 (0: page above the image)
+        0x01, 0xC7,                                     // add edi, eax
+        0x89, 0xFB,                                     // mov ebx, edi
+        0xB8, 0x01, 0x00, 0x00, 0x00,                   // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                                     // int 0x80
+        0xEB, 0xFE,                                     // jmp $
+    };
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    memcpy(program, code, sizeof(code));
+    process_t* proc = process_create("heap", program, sizeof(program));
+    int exit_code = proc != NULL ? process_wait(proc) : -1;
+    printf("Exit code %d (expected %d)\\n", exit_code, 0x4004);
+    // A kernel thread has no heap
+    if (exit_code == 0x4004 && process_brk(0x50000000) == 0) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="process_brk_madvise",
+        test_code=PROCESS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
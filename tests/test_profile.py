@@ -0,0 +1,117 @@
+from test_framework import OlymposTestFramework
+
+PROFILE_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/debug.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/serial.h>
+#include <kernel/profile.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    debug_initialize(mbi);
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_profile_tests(framework: OlymposTestFramework):
+    # Test 1: Samples of a busy loop land in it, directly or through the call chain
+    test_helpers = """
+    static volatile uint32_t profile_sink;
+
+    // Busy for ms milliseconds; checks the clock (a call) now and then
+    __attribute__((noinline)) void profile_busy_loop(uint32_t ms) {
+        uint64_t end = ktime_ns() + (uint64_t) ms * 1000000;
+        while (ktime_ns() < end) {
+            for (uint32_t i = 0; i < 4096; i++) {
+                profile_sink = profile_sink * 3 + i;
+            }
+        }
+    }
+
+    static profile_sample_t samples[PROFILE_RING_SIZE];
+
+    // Sample interrupted profile_busy_loop itself, or something it called
+    static int profile_in_busy_loop(const profile_sample_t* sample) {
+        const char* name = debug_find_symbol(sample->eip, NULL);
+        if (name && strcmp(name, "profile_busy_loop") == 0) {
+            return 1;
+        }
+        for (uint32_t i = 0; i < sample->depth; i++) {
+            name = debug_find_symbol(sample->frames[i] - 1, NULL);
+            if (name && strcmp(name, "profile_busy_loop") == 0) {
+                return 2;
+            }
+        }
+        return 0;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    profile_start(1, true);
+    profile_busy_loop(300);
+    profile_stop();
+
+    size_t count = profile_read(samples, PROFILE_RING_SIZE);
+    uint32_t direct = 0, chained = 0;
+    for (size_t i = 0; i < count; i++) {
+        int where = profile_in_busy_loop(&samples[i]);
+        direct += where == 1;
+        chained += where == 2;
+    }
+    printf("%u samples: %u in the loop, %u in its callees\\n", count, direct, chained);
+    profile_print_flat(3);
+    profile_print_folded(SERIAL_COM1_BASE);
+
+    if (count >= 100 && direct > 0 && (direct + chained) * 4 >= count * 3) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="profile_busy_loop",
+        test_code=PROFILE_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -2,6 +2,8 @@ from test_framework import OlymposTestFramework
 
 SERIAL_TEST_TEMPLATE = """
 #include <kernel/serial.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
 #include <stdint.h>
 
 // Exit QEMU function
@@ -64,3 +66,36 @@ def register_serial_tests(framework: OlymposTestFramework):
         test_code=SERIAL_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS",
     )
+
+    # Test 4: Interrupt-driven output drained by the THRE interrupt
+    test_body = """
+    gdt_init();
+    idt_init();
+    serial_enable_interrupts(SERIAL_COM1_BASE);
+    serial_write_string(SERIAL_COM1_BASE, "TEST_RUNNING\\n");
+
+    // More than the tx ring holds, so writers also hit the ring-full path
+    for (int i = 0; i < 200; i++) {
+        serial_write_string(SERIAL_COM1_BASE, "0123456789abcdef0123456789abcdef\\n");
+    }
+    int queued = serial_tx_pending(SERIAL_COM1_BASE) > 0;
+
+    // Only IRQ 4 can empty the ring while the CPU sleeps
+    while (serial_tx_pending(SERIAL_COM1_BASE) > 0) {
+        asm volatile("hlt");
+    }
+    if (queued) {
+        serial_write_string(SERIAL_COM1_BASE, "TX ring drained by IRQ 4\\n");
+        serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
+    }
+    else {
+        serial_write_string(SERIAL_COM1_BASE, "TEST_FAILED\\n");
+    }
+    serial_flush(SERIAL_COM1_BASE);
+    """
+
+    framework.register_test(
+        name="serial_interrupt_driven",
+        test_code=SERIAL_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
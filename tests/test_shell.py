@@ -3,6 +3,8 @@ from test_framework import OlymposTestFramework
 SHELL_TEST_TEMPLATE = """
 #include <kernel/serial.h>
 #include <kernel/kheap.h>
+#include <kernel/paging.h>
+#include <kernel/multiboot.h>
 #include <kernel/shell.h>
 
 // Exit QEMU function
@@ -11,7 +13,7 @@ void exit_qemu(uint32_t exit_code) {{
 }}
 
 void kernel_main(unsigned long magic, unsigned long addr) {{
-    paging_init();
+    paging_init((multiboot_info_t*) addr);
     kheap_init();
     terminal_initialize();
     serial_setup(SERIAL_COM1_BASE, SERIAL_BAUD_115200);
@@ -33,14 +35,14 @@ void kernel_main(unsigned long magic, unsigned long addr) {{
 
 
 def register_shell_tests(framework: OlymposTestFramework):
-    # Test 1: Built-in command count
+    # Test 1: Registered command count (clear, help, uptime, prof, trace, irqstat, dmesg, bench, vmstat)
     test_body = """
     int count = shell_num_builtins();
     char buffer[64];
     snprintf(buffer, sizeof(buffer), "Built-in count: %d\\n", count);
     serial_write_string(SERIAL_COM1_BASE, buffer);
     
-    if (count == 2) {
+    if (count == 9) {
         serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
     }
     else {
@@ -216,3 +218,35 @@ def register_shell_tests(framework: OlymposTestFramework):
         test_code=SHELL_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS"
     )
+
+    # Test 9: Every registered command is found by name through the hash table, other words are not
+    test_body = """
+    extern const shell_command_t __shell_commands_start[];
+    extern const shell_command_t __shell_commands_end[];
+    int shell_irqstat(char** args);
+    int found = 0;
+    for (const shell_command_t* cmd = __shell_commands_start; cmd < __shell_commands_end; cmd++) {
+        if (shell_find_command(cmd->name) == cmd) {
+            found++;
+        }
+    }
+    const shell_command_t* irqstat = shell_find_command("irqstat");
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "Found %d of %d\\n", found, shell_num_builtins());
+    serial_write_string(SERIAL_COM1_BASE, buffer);
+
+    if (found == shell_num_builtins() && irqstat != NULL && irqstat->func == shell_irqstat &&
+        shell_find_command("irqsta") == NULL && shell_find_command("irqstats") == NULL &&
+        shell_find_command("") == NULL && shell_find_command("nosuchcommand") == NULL) {
+        serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
+    }
+    else {
+        serial_write_string(SERIAL_COM1_BASE, "TEST_FAIL\\n");
+    }
+    """
+
+    framework.register_test(
+        name="shell_command_lookup",
+        test_code=SHELL_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
@@ -0,0 +1,149 @@
+from test_framework import OlymposTestFramework
+
+SMP_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/apic.h>
+#include <kernel/smp.h>
+
+#include "../arch/i386/include/percpu.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    apic_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_smp_tests(framework: OlymposTestFramework):
+    # Test 1: Both CPUs of a -smp 2 guest come up, each with its own per-CPU data, GDT and TSS
+    test_body = """
+    uint32_t online = smp_init();
+    if (online != 2 || smp_cpu_count() != 2) {
+        printf("TEST_FAIL: %u CPUs online, expected 2\\n", online);
+        exit_qemu(1);
+    }
+    if (cpu_self() != &cpus[0] || smp_processor_id() != 0 || thread_current()->cpu != 0) {
+        printf("TEST_FAIL: Boot CPU doesn't see its own per-CPU data\\n");
+        exit_qemu(1);
+    }
+    cpu_t* ap = &cpus[1];
+    if (!ap->online || ap->self != ap || ap->id != 1 || ap->apic_id == cpus[0].apic_id) {
+        printf("TEST_FAIL: AP per-CPU data not set up (online %u, id %u)\\n", ap->online, ap->id);
+        exit_qemu(1);
+    }
+    if (ap->gdtr.base != (uint32_t) ap->gdt || ap->tss.esp0 != ap->stack_top || ap->tss.ss0 != 0x10) {
+        printf("TEST_FAIL: AP GDT/TSS not its own\\n");
+        exit_qemu(1);
+    }
+    // Timer interrupts of kernel code must leave the per-CPU segment alone
+    ksleep(20);
+    uint16_t fs;
+    asm volatile("mov %%fs, %0" : "=r"(fs));
+    if (fs != 0x30 || smp_processor_id() != 0) {
+        printf("TEST_FAIL: FS is 0x%x after interrupts\\n", fs);
+        exit_qemu(1);
+    }
+    printf("%u CPUs online\\n", online);
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="smp_two_cpus_online",
+        test_code=SMP_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=["-smp", "2"],
+    )
+
+    # Test 2: Threads run on the AP, both pinned there and sent there by the scheduler while the boot CPU is busy
+    test_helpers = """
+    static volatile uint32_t seen_cpu[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+    static volatile uint32_t seen_thread_cpu[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+    static volatile int done[2];
+
+    static void worker(void* arg) {
+        int slot = (int) arg;
+        seen_cpu[slot] = smp_processor_id();
+        seen_thread_cpu[slot] = thread_current()->cpu;
+        __atomic_store_n(&done[slot], 1, __ATOMIC_RELEASE);
+    }
+    """
+    test_body = """
+    if (smp_init() != 2) {
+        printf("TEST_FAIL: AP not online\\n");
+        exit_qemu(1);
+    }
+    if (thread_create_on(1, "ap-pinned", worker, (void*) 0) == NULL) {
+        printf("TEST_FAIL: thread_create_on(1) failed\\n");
+        exit_qemu(1);
+    }
+    for (int i = 0; i < 100 && !__atomic_load_n(&done[0], __ATOMIC_ACQUIRE); i++) {
+        ksleep(10);
+    }
+    if (!done[0] || seen_cpu[0] != 1 || seen_thread_cpu[0] != 1) {
+        printf("TEST_FAIL: Pinned worker done %d on CPU %u (thread cpu %u)\\n", done[0], seen_cpu[0],
+               seen_thread_cpu[0]);
+        exit_qemu(1);
+    }
+    // The boot thread keeps CPU 0 busy without blocking: only the AP can run the new thread
+    thread_create("ap-spread", worker, (void*) 1);
+    uint64_t start = timer_ticks();
+    while (!__atomic_load_n(&done[1], __ATOMIC_ACQUIRE) && timer_ticks() - start < 1000) {
+        asm volatile("pause");
+    }
+    if (!done[1] || seen_cpu[1] == 0 || seen_thread_cpu[1] != seen_cpu[1]) {
+        printf("TEST_FAIL: Unpinned worker done %d on CPU %u (thread cpu %u)\\n", done[1], seen_cpu[1],
+               seen_thread_cpu[1]);
+        exit_qemu(1);
+    }
+    if (smp_processor_id() != 0 || thread_current()->cpu != 0) {
+        printf("TEST_FAIL: Boot thread left CPU 0\\n");
+        exit_qemu(1);
+    }
+    printf("Workers ran on CPU %u and CPU %u\\n", seen_cpu[0], seen_cpu[1]);
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="smp_thread_runs_on_ap",
+        test_code=SMP_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=["-smp", "2"],
+    )
@@ -0,0 +1,119 @@
+from test_framework import OlymposTestFramework
+
+SOFTIRQ_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/softirq.h>
+
+#include "../arch/i386/include/irq.h"
+#include "../arch/i386/include/irqflags.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    softirq_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_softirq_tests(framework: OlymposTestFramework):
+    # Test 1: The top half queues, the bottom half runs after it with interrupts on
+    test_helpers = """
+    static volatile uint32_t bottom_runs;
+    static volatile bool bottom_irqs_on;
+    static volatile bool top_saw_bottom;
+    static volatile bool requeue_refused;
+
+    static void bottom_half(void* data) {
+        (void) data;
+        bottom_irqs_on = irqs_enabled();
+        bottom_runs++;
+    }
+
+    static tasklet_t work = TASKLET_INIT(bottom_half, NULL);
+
+    void top_half(regs_t* r) {
+        (void) r;
+        tasklet_schedule(&work);
+        requeue_refused = !tasklet_schedule(&work);
+        top_saw_bottom = bottom_runs != 0;
+    }
+
+    // Requeues itself: more rounds than one IRQ exit drains
+    static volatile uint32_t chain_runs;
+    static tasklet_t chain;
+
+    static void chain_step(void* data) {
+        (void) data;
+        if (++chain_runs < 4 * SOFTIRQ_MAX_ROUNDS) {
+            tasklet_schedule(&chain);
+        }
+    }
+    """
+    test_body = """
+    reqister_irq(3, top_half);
+    asm volatile("int $35");
+    if (bottom_runs != 1 || top_saw_bottom || !bottom_irqs_on || !requeue_refused) {
+        printf("TEST_FAIL: runs %u, in top half %d, irqs on %d, requeue refused %d\\n", bottom_runs,
+               top_saw_bottom, bottom_irqs_on, requeue_refused);
+        exit_qemu(1);
+    }
+
+    tasklet_init(&chain, chain_step, NULL);
+    tasklet_schedule(&chain);
+    asm volatile("int $35");
+    uint64_t end = ktime_ns() + 500 * 1000000ull;
+    while (chain_runs < 4 * SOFTIRQ_MAX_ROUNDS && ktime_ns() < end) {
+        thread_yield();
+    }
+    softirq_stats_t stats;
+    softirq_get_stats(&stats);
+    if (chain_runs != 4 * SOFTIRQ_MAX_ROUNDS || stats.thread_runs == 0 || softirq_pending()) {
+        printf("TEST_FAIL: chain %u, ksoftirqd runs %u\\n", chain_runs, (uint32_t) stats.thread_runs);
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="softirq_tasklets",
+        test_code=SOFTIRQ_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
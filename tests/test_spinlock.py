@@ -0,0 +1,236 @@
+from test_framework import OlymposTestFramework
+
+SPINLOCK_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/apic.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
+#include <kernel/rcu.h>
+
+#include "../arch/i386/include/irq.h"
+#include "../arch/i386/include/percpu.h"
+#include "../arch/i386/include/irqflags.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_spinlock_tests(framework: OlymposTestFramework):
+    # Test 1: Tickets are handed out and served in order, trylock only takes a free lock
+    test_body = """
+    spinlock_t lock = SPINLOCK_INIT;
+    spin_lock(&lock);
+    if (lock.owner != 0 || lock.next != 1 || !spin_is_locked(&lock)) {
+        printf("TEST_FAIL: Held lock has owner %u, next %u\\n", lock.owner, lock.next);
+        exit_qemu(1);
+    }
+    if (spin_trylock(&lock)) {
+        printf("TEST_FAIL: trylock took a held lock\\n");
+        exit_qemu(1);
+    }
+    spin_unlock(&lock);
+    if (spin_is_locked(&lock) || !spin_trylock(&lock)) {
+        printf("TEST_FAIL: Released lock not free\\n");
+        exit_qemu(1);
+    }
+    spin_unlock(&lock);
+    // The 16-bit tickets wrap around
+    for (uint32_t i = 0; i < 70000; i++) {
+        spin_lock(&lock);
+        spin_unlock(&lock);
+    }
+    if (spin_is_locked(&lock) || lock.owner != (uint16_t) 70002) {
+        printf("TEST_FAIL: Tickets out of step after wrapping (owner %u)\\n", lock.owner);
+        exit_qemu(1);
+    }
+    asm volatile("sti");
+    uint32_t flags = spin_lock_irqsave(&lock);
+    bool off = !irqs_enabled();
+    spin_unlock_irqrestore(&lock, flags);
+    if (!off || !irqs_enabled()) {
+        printf("TEST_FAIL: irqsave didn't disable and restore interrupts\\n");
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="spinlock_ticket_order",
+        test_code=SPINLOCK_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: Readers share the lock, a writer holds it alone and keeps new readers out
+    test_body = """
+    rwlock_t lock = RWLOCK_INIT;
+    read_lock(&lock);
+    if (lock.readers != 1 || lock.writing) {
+        printf("TEST_FAIL: Read hold not counted\\n");
+        exit_qemu(1);
+    }
+    read_unlock(&lock);
+    write_lock(&lock);
+    if (lock.readers != 0 || !lock.writing || !spin_is_locked(&lock.writer)) {
+        printf("TEST_FAIL: Write hold not exclusive\\n");
+        exit_qemu(1);
+    }
+    write_unlock(&lock);
+    asm volatile("sti");
+    uint32_t flags = read_lock_irqsave(&lock);
+    bool read_off = !irqs_enabled();
+    read_unlock_irqrestore(&lock, flags);
+    flags = write_lock_irqsave(&lock);
+    bool write_off = !irqs_enabled();
+    write_unlock_irqrestore(&lock, flags);
+    if (!read_off || !write_off || !irqs_enabled()) {
+        printf("TEST_FAIL: irqsave variants didn't disable and restore interrupts\\n");
+        exit_qemu(1);
+    }
+    if (lock.readers != 0 || lock.writing || spin_is_locked(&lock.writer)) {
+        printf("TEST_FAIL: Lock not free after all holds ended\\n");
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="spinlock_rwlock_holds",
+        test_code=SPINLOCK_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: Read-side sections nest, end a grace period on the way out, and don't hold up other CPUs' writers
+    test_body = """
+    apic_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+    if (smp_init() != 2) {
+        printf("TEST_FAIL: Second CPU not online\\n");
+        exit_qemu(1);
+    }
+    cpu_t* cpu = cpu_self();
+    uint32_t seq = cpu->rcu_seq;
+    rcu_read_lock();
+    rcu_read_lock();
+    if (cpu->rcu_nesting != 2) {
+        printf("TEST_FAIL: Nesting is %u, expected 2\\n", cpu->rcu_nesting);
+        exit_qemu(1);
+    }
+    rcu_read_unlock();
+    if (cpu->rcu_seq != seq) {
+        printf("TEST_FAIL: Inner unlock ended the section\\n");
+        exit_qemu(1);
+    }
+    rcu_read_unlock();
+    if (cpu->rcu_nesting != 0 || cpu->rcu_seq != seq + 1) {
+        printf("TEST_FAIL: Outer unlock didn't end the section\\n");
+        exit_qemu(1);
+    }
+    // The idle AP is outside any section
+    synchronize_rcu();
+    int value = 42;
+    int* shared = NULL;
+    rcu_assign_pointer(shared, &value);
+    rcu_read_lock();
+    int* seen = rcu_dereference(shared);
+    rcu_read_unlock();
+    if (seen == NULL || *seen != 42) {
+        printf("TEST_FAIL: Published pointer not seen\\n");
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="spinlock_rcu_grace_period",
+        test_code=SPINLOCK_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=["-smp", "2"],
+    )
+
+    # Test 4: An IRQ handler can be replaced once unregister_irq() has waited for its readers
+    test_helpers = """
+static volatile int first_calls = 0;
+static volatile int second_calls = 0;
+
+static void first_handler(regs_t* r) {
+    (void) r;
+    first_calls++;
+}
+
+static void second_handler(regs_t* r) {
+    (void) r;
+    second_calls++;
+}
+"""
+
+    test_body = """
+    // A software interrupt on vector 37 (IRQ 5) goes through irq_handler() like the real line
+    if (reqister_irq(5, first_handler) != 0) {
+        printf("TEST_FAIL: Register failed\\n");
+        exit_qemu(1);
+    }
+    asm volatile("int $37");
+    if (unregister_irq(5) != 0) {
+        printf("TEST_FAIL: Unregister failed\\n");
+        exit_qemu(1);
+    }
+    asm volatile("int $37");
+    reqister_irq(5, second_handler);
+    asm volatile("int $37");
+    unregister_irq(5);
+    if (first_calls != 1 || second_calls != 1) {
+        printf("TEST_FAIL: Handlers ran %d and %d times, expected once each\\n", first_calls, second_calls);
+        exit_qemu(1);
+    }
+    if (cpu_self()->rcu_nesting != 0) {
+        printf("TEST_FAIL: irq_handler() left a read-side section open\\n");
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="spinlock_irq_reregister",
+        test_code=SPINLOCK_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
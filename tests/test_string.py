@@ -0,0 +1,221 @@
+from test_framework import OlymposTestFramework
+
+STRING_TEST_TEMPLATE = """
+#include <kernel/serial.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+// Byte-at-a-time reference versions to check the optimized ones against
+static void ref_move(unsigned char* dst, const unsigned char* src, size_t size) {{
+    if (dst < src) {{
+        for (size_t i = 0; i < size; i++) {{
+            dst[i] = src[i];
+        }}
+    }}
+    else {{
+        for (size_t i = size; i != 0; i--) {{
+            dst[i - 1] = src[i - 1];
+        }}
+    }}
+}}
+
+static int ref_memcmp(const unsigned char* a, const unsigned char* b, size_t size) {{
+    for (size_t i = 0; i < size; i++) {{
+        if (a[i] != b[i]) {{
+            return a[i] < b[i] ? -1 : 1;
+        }}
+    }}
+    return 0;
+}}
+
+// Previous byte-at-a-time strlen/strchr/strcmp
+static size_t ref_strlen(const char* str) {{
+    size_t len = 0;
+    while (str[len]) {{
+        len++;
+    }}
+    return len;
+}}
+
+static char* ref_strchr(const char* str, int c) {{
+    while (*str != '\\0') {{
+        if (*str == (char) c) {{
+            return (char*) str;
+        }}
+        str++;
+    }}
+    return c == '\\0' ? (char*) str : NULL;
+}}
+
+static int ref_strcmp(const char* s1, const char* s2) {{
+    while (*s1 && (*s1 == *s2)) {{
+        s1++;
+        s2++;
+    }}
+    return *(unsigned char*) s1 - *(unsigned char*) s2;
+}}
+
+// Sign of a comparison result
+static int sign(int v) {{
+    return (v > 0) - (v < 0);
+}}
+
+// Deterministic pseudo-random bytes
+static uint32_t seed = 12345;
+static uint32_t next_rand(void) {{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    serial_setup(SERIAL_COM1_BASE, SERIAL_BAUD_115200);
+    serial_write_string(SERIAL_COM1_BASE, "TEST_RUNNING\\n");
+
+    // Test code
+    {test_body}
+
+    serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_string_tests(framework: OlymposTestFramework):
+    # Test 1: memcpy and memmove at every alignment, size and overlap
+    test_body = """
+    static unsigned char buf[512], ref[512];
+    for (size_t size = 0; size < 80; size++) {
+        for (size_t src = 0; src < 8; src++) {
+            for (size_t dst = 0; dst < 24; dst++) {
+                for (size_t i = 0; i < sizeof(buf); i++) {
+                    buf[i] = ref[i] = (unsigned char) next_rand();
+                }
+                // Disjoint copy with memcpy, overlapping (either direction) with memmove
+                memcpy(buf + 256 + dst, buf + src, size);
+                ref_move(ref + 256 + dst, ref + src, size);
+                memmove(buf + 8 + dst, buf + 8 + src, size);
+                ref_move(ref + 8 + dst, ref + 8 + src, size);
+                if (ref_memcmp(buf, ref, sizeof(buf)) != 0) {
+                    serial_write_string(SERIAL_COM1_BASE, "ERROR: memcpy/memmove mismatch!\\n");
+                    exit_qemu(1);
+                }
+            }
+        }
+    }
+    // Large overlapping moves take the rep movsd path in both directions
+    static unsigned char big[8192], big_ref[8192];
+    for (size_t i = 0; i < sizeof(big); i++) {
+        big[i] = big_ref[i] = (unsigned char) next_rand();
+    }
+    memmove(big + 3, big, 6000);
+    ref_move(big_ref + 3, big_ref, 6000);
+    memmove(big + 1, big + 2001, 6000);
+    ref_move(big_ref + 1, big_ref + 2001, 6000);
+    if (ref_memcmp(big, big_ref, sizeof(big)) != 0) {
+        serial_write_string(SERIAL_COM1_BASE, "ERROR: Large memmove mismatch!\\n");
+        exit_qemu(1);
+    }
+    serial_write_string(SERIAL_COM1_BASE, "memcpy and memmove match the reference\\n");
+    """
+
+    framework.register_test(
+        name="string_memcpy_memmove",
+        test_code=STRING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 2: memset and memcmp
+    test_body = """
+    static unsigned char buf[256];
+    for (size_t size = 0; size < 100; size++) {
+        for (size_t off = 0; off < 8; off++) {
+            for (size_t i = 0; i < sizeof(buf); i++) {
+                buf[i] = 0x5A;
+            }
+            memset(buf + off, 0xC3, size);
+            for (size_t i = 0; i < sizeof(buf); i++) {
+                unsigned char expect = (i >= off && i < off + size) ? 0xC3 : 0x5A;
+                if (buf[i] != expect) {
+                    serial_write_string(SERIAL_COM1_BASE, "ERROR: memset wrote the wrong bytes!\\n");
+                    exit_qemu(1);
+                }
+            }
+        }
+    }
+    static unsigned char a[128], b[128];
+    for (int round = 0; round < 2000; round++) {
+        size_t size = next_rand() % 100;
+        size_t off_a = next_rand() % 16, off_b = next_rand() % 16;
+        for (size_t i = 0; i < size; i++) {
+            a[off_a + i] = b[off_b + i] = (unsigned char) next_rand();
+        }
+        if (size > 0 && (round & 1)) {
+            b[off_b + next_rand() % size] ^= (unsigned char) (1 + next_rand() % 255);
+        }
+        if (memcmp(a + off_a, b + off_b, size) != ref_memcmp(a + off_a, b + off_b, size)) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: memcmp mismatch!\\n");
+            exit_qemu(1);
+        }
+    }
+    serial_write_string(SERIAL_COM1_BASE, "memset and memcmp match the reference\\n");
+    """
+
+    framework.register_test(
+        name="string_memset_memcmp",
+        test_code=STRING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Test 3: strlen, strchr and strcmp against the byte-at-a-time versions
+    test_body = """
+    static char a[128], b[128];
+    const char* alphabet = "abcXYZ \\t\\x80\\xff";
+    for (int round = 0; round < 5000; round++) {
+        size_t off_a = next_rand() % 8, off_b = next_rand() % 8;
+        size_t len = next_rand() % 100;
+        for (size_t i = 0; i < len; i++) {
+            a[off_a + i] = b[off_b + i] = alphabet[next_rand() % 10];
+        }
+        a[off_a + len] = b[off_b + len] = '\\0';
+        // Half of the rounds differ at one position (or in length)
+        if (round & 1) {
+            size_t pos = next_rand() % (len + 1);
+            b[off_b + pos] = alphabet[next_rand() % 10];
+        }
+        char* sa = a + off_a;
+        char* sb = b + off_b;
+        if (strlen(sa) != ref_strlen(sa) || strlen(sb) != ref_strlen(sb)) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: strlen mismatch!\\n");
+            exit_qemu(1);
+        }
+        int c = (round % 7 == 0) ? 0 : (unsigned char) alphabet[next_rand() % 10];
+        if (strchr(sa, c) != ref_strchr(sa, c)) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: strchr mismatch!\\n");
+            exit_qemu(1);
+        }
+        if (sign(strcmp(sa, sb)) != sign(ref_strcmp(sa, sb)) || strcmp(sa, sa) != 0) {
+            serial_write_string(SERIAL_COM1_BASE, "ERROR: strcmp mismatch!\\n");
+            exit_qemu(1);
+        }
+    }
+    serial_write_string(SERIAL_COM1_BASE, "strlen, strchr and strcmp match the reference\\n");
+    """
+
+    framework.register_test(
+        name="string_strlen_strchr_strcmp",
+        test_code=STRING_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
@@ -0,0 +1,225 @@
+from test_framework import OlymposTestFramework
+
+SYNC_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/debug.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/wait.h>
+#include <kernel/sync.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    debug_initialize(mbi);
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_sync_tests(framework: OlymposTestFramework):
+    # Test 1: wait_event() sleeps until the producer's wake_up(), not on unrelated interrupts
+    test_helpers = """
+    static wait_queue_t data_wait = WAIT_QUEUE_INIT;
+    static volatile int data_ready;
+    static volatile int checks;
+    static volatile int done;
+
+    static int check_ready(void) {
+        checks++;
+        return data_ready;
+    }
+
+    static void reader(void* arg) {
+        (void) arg;
+        wait_event(&data_wait, check_ready());
+        done = 1;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    timer_initialize(TIMER_DEFAULT_HZ);
+    thread_create("reader", reader, NULL);
+    while (!wait_queue_active(&data_wait)) {
+        thread_yield();
+    }
+    // Timer ticks keep arriving, but nobody wakes the queue
+    ksleep(50);
+    int checks_asleep = checks;
+    int early = done;
+
+    data_ready = 1;
+    wake_up(&data_wait);
+    while (!done) {
+        thread_yield();
+    }
+    printf("Condition checked %d times before the wakeup\\n", checks_asleep);
+
+    if (!early && done && checks_asleep == 2 && !wait_queue_active(&data_wait)) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="sync_wait_event",
+        test_code=SYNC_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: A mutex keeps a read-modify-write intact across preemption
+    test_helpers = """
+    #define ADDERS      3
+    #define ROUNDS      2000
+
+    static mutex_t counter_lock = MUTEX_INIT;
+    static volatile uint32_t counter;
+    static volatile int finished;
+
+    static void adder(void* arg) {
+        (void) arg;
+        for (int i = 0; i < ROUNDS; i++) {
+            mutex_lock(&counter_lock);
+            uint32_t value = counter;
+            // Widen the window for the timer to preempt us while holding the lock
+            for (volatile int spin = 0; spin < 200; spin++) {
+            }
+            counter = value + 1;
+            mutex_unlock(&counter_lock);
+        }
+        finished++;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    timer_initialize(TIMER_DEFAULT_HZ);
+    for (int i = 0; i < ADDERS; i++) {
+        thread_create("adder", adder, NULL);
+    }
+    while (finished < ADDERS) {
+        thread_yield();
+    }
+    int trylock_ok = mutex_trylock(&counter_lock);
+    int trylock_busy = mutex_trylock(&counter_lock);
+    mutex_unlock(&counter_lock);
+    printf("Counter: %u (expected %u)\\n", counter, ADDERS * ROUNDS);
+
+    if (counter == ADDERS * ROUNDS && trylock_ok && !trylock_busy && !counter_lock.locked) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="sync_mutex",
+        test_code=SYNC_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: Semaphore-bounded producer/consumer, and a condition variable handshake
+    test_helpers = """
+    #define SLOTS       4
+    #define ITEMS       32
+
+    static semaphore_t free_slots = SEMAPHORE_INIT(SLOTS);
+    static semaphore_t used_slots = SEMAPHORE_INIT(0);
+    static int buffer[SLOTS];
+    static volatile int max_in_flight;
+    static volatile int in_flight;
+
+    static mutex_t state_lock = MUTEX_INIT;
+    static condvar_t state_changed = CONDVAR_INIT;
+    static int consumed_sum;
+    static int consumer_done;
+
+    static void producer(void* arg) {
+        (void) arg;
+        for (int i = 1; i <= ITEMS; i++) {
+            sem_wait(&free_slots);
+            buffer[i % SLOTS] = i;
+            if (++in_flight > max_in_flight) {
+                max_in_flight = in_flight;
+            }
+            sem_post(&used_slots);
+        }
+    }
+
+    static void consumer(void* arg) {
+        (void) arg;
+        int sum = 0;
+        for (int i = 1; i <= ITEMS; i++) {
+            sem_wait(&used_slots);
+            sum += buffer[i % SLOTS];
+            in_flight--;
+            sem_post(&free_slots);
+        }
+        mutex_lock(&state_lock);
+        consumed_sum = sum;
+        consumer_done = 1;
+        cond_signal(&state_changed);
+        mutex_unlock(&state_lock);
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    thread_create("consumer", consumer, NULL);
+    thread_create("producer", producer, NULL);
+    mutex_lock(&state_lock);
+    while (!consumer_done) {
+        cond_wait(&state_changed, &state_lock);
+    }
+    int sum = consumed_sum;
+    mutex_unlock(&state_lock);
+    printf("Sum: %d, most items in flight: %d\\n", sum, max_in_flight);
+
+    if (sum == ITEMS * (ITEMS + 1) / 2 && max_in_flight <= SLOTS && !sem_trywait(&used_slots)) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="sync_semaphore_condvar",
+        test_code=SYNC_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
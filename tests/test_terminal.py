@@ -3,6 +3,7 @@ from test_framework import OlymposTestFramework
 TERMINAL_TEST_TEMPLATE = """
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <kernel/tty.h>
 #include <kernel/serial.h>
@@ -85,4 +86,96 @@ def register_terminal_tests(framework: OlymposTestFramework):
         name="terminal_vga_buffer_verification",
         test_code=TERMINAL_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS"
-    )
\ No newline at end of file
+    )
+    # Batched terminal_write must render exactly like per-character terminal_putchar
+    test_body = """
+        serial_write_string(SERIAL_COM1_BASE, "TEST_RUNNING\\n");
+
+        uint16_t* const VGA_BUFFER = (uint16_t*) 0xB8000;
+        static uint16_t batched[80 * 25];
+        static char text[4000];
+
+        // Long lines (wrapping), newlines, backspaces and enough output to scroll
+        const char* words = "olympos \\b\\bkernel\\n";
+        size_t len = 0;
+        for (int i = 0; len + 20 < sizeof(text); i++) {
+            const char* w = (i % 7 == 6) ? "\\n" : words + (i % 5);
+            while (*w) {
+                text[len++] = (i % 11 == 0 && *w == '\\n') ? 'x' : *w;
+                w++;
+            }
+        }
+
+        terminal_initialize();
+        terminal_write(text, len);
+        memcpy(batched, VGA_BUFFER, sizeof(batched));
+
+        terminal_initialize();
+        for (size_t i = 0; i < len; i++) {
+            terminal_putchar(text[i]);
+        }
+
+        if (memcmp(batched, VGA_BUFFER, sizeof(batched)) == 0) {
+            serial_write_string(SERIAL_COM1_BASE, "terminal_write matches terminal_putchar\\n");
+            serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
+        }
+        else {
+            serial_write_string(SERIAL_COM1_BASE, "TEST_FAILED\\n");
+        }
+        """
+
+    framework.register_test(
+        name="terminal_batched_write",
+        test_code=TERMINAL_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
+
+    # Scrollback: lines scrolled off the screen can be viewed again
+    test_body = """
+        serial_write_string(SERIAL_COM1_BASE, "TEST_RUNNING\\n");
+
+        uint16_t* const VGA_BUFFER = (uint16_t*) 0xB8000;
+        char line[16];
+
+        // 60 lines: rows 0-23 show lines 36-59, row 24 is the empty prompt row
+        terminal_initialize();
+        for (int i = 0; i < 60; i++) {
+            snprintf(line, sizeof(line), "line %d\\n", i);
+            terminal_writestring(line);
+        }
+
+        int pass = 1;
+        // Reads VGA row 0 into a string
+        char row0[8];
+        #define READ_ROW0() for (int x = 0; x < 7; x++) { row0[x] = (char) (VGA_BUFFER[x] & 0xFF); } row0[7] = '\\0'
+        READ_ROW0();
+        pass = pass && strcmp(row0, "line 36") == 0;
+
+        terminal_scroll_view(10);
+        READ_ROW0();
+        pass = pass && strcmp(row0, "line 26") == 0;
+
+        // Scrolling past the start of history stops at line 0
+        terminal_scroll_view(1000);
+        READ_ROW0();
+        pass = pass && strcmp(row0, "line 0 ") == 0;
+
+        // New output jumps back to the live screen
+        terminal_writestring("x");
+        READ_ROW0();
+        pass = pass && strcmp(row0, "line 36") == 0;
+
+        if (pass) {
+            serial_write_string(SERIAL_COM1_BASE, "Scrollback shows earlier lines\\n");
+            serial_write_string(SERIAL_COM1_BASE, "TEST_PASS\\n");
+        }
+        else {
+            serial_write_string(SERIAL_COM1_BASE, "TEST_FAILED\\n");
+        }
+        """
+
+    framework.register_test(
+        name="terminal_scrollback",
+        test_code=TERMINAL_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS"
+    )
@@ -0,0 +1,277 @@
+from test_framework import OlymposTestFramework
+
+THREAD_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/debug.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+
+#include "../arch/i386/include/idle.h"
+#include "../arch/i386/include/irqflags.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    debug_initialize(mbi);
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_thread_tests(framework: OlymposTestFramework):
+    # Test 1: Cooperative switching with thread_yield(), exit and stack reaping
+    test_helpers = """
+    static volatile int turns[2];
+    static volatile int finished;
+
+    static void worker(void* arg) {
+        int id = (int) arg;
+        for (int i = 0; i < 5; i++) {
+            turns[id]++;
+            thread_yield();
+        }
+        finished++;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    thread_create("worker0", worker, (void*) 0);
+    thread_create("worker1", worker, (void*) 1);
+    while (finished < 2) {
+        thread_yield();
+    }
+    // Both threads have exited; one more switch reaps the last one
+    thread_yield();
+    printf("Turns: %d %d\\n", turns[0], turns[1]);
+
+    if (turns[0] == 5 && turns[1] == 5) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="thread_yield",
+        test_code=THREAD_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: The timer preempts a thread that never yields
+    test_helpers = """
+    static volatile uint32_t spins;
+    static volatile int stop;
+
+    static void spinner(void* arg) {
+        (void) arg;
+        while (!stop) {
+            spins++;
+        }
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    timer_initialize(TIMER_DEFAULT_HZ);
+    thread_create("spinner", spinner, NULL);
+
+    // Busy-wait without yielding: only preemption lets the spinner run
+    uint64_t end = timer_ticks() + 5 * SCHED_QUANTUM_TICKS;
+    while (timer_ticks() < end) {
+    }
+    uint32_t seen = spins;
+    stop = 1;
+    printf("Spinner ran %u iterations while the boot thread spun\\n", seen);
+
+    if (seen > 0) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="thread_preempt",
+        test_code=THREAD_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: A blocked thread leaves the CPU until it is unblocked
+    test_helpers = """
+    static thread_t* volatile sleeper_thread;
+    static volatile int woke;
+
+    static void sleeper(void* arg) {
+        (void) arg;
+        asm volatile("cli");
+        sleeper_thread = thread_current();
+        thread_block();
+        asm volatile("sti");
+        woke = 1;
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    thread_create("sleeper", sleeper, NULL);
+    while (sleeper_thread == NULL) {
+        thread_yield();
+    }
+    // Yielding can't run it again while it is blocked
+    for (int i = 0; i < 10; i++) {
+        thread_yield();
+    }
+    int early = woke;
+    thread_unblock(sleeper_thread);
+    while (!woke) {
+        thread_yield();
+    }
+
+    if (!early && woke) {
+        printf("Blocked thread resumed after thread_unblock()\\n");
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="thread_block",
+        test_code=THREAD_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 4: The highest priority runs first, and a boosted wakeup outranks the waker
+    test_helpers = """
+    static char order[8];
+    static volatile int count;
+    static thread_t* volatile waiter_thread;
+
+    static void record(void* arg) {
+        order[count++] = (char) (int) arg;
+    }
+
+    static void waiter(void* arg) {
+        (void) arg;
+        asm volatile("cli");
+        waiter_thread = thread_current();
+        thread_block();
+        asm volatile("sti");
+        order[count++] = 'W';
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    thread_t* self = thread_current();
+    thread_set_priority(self, 10);
+    thread_set_priority(thread_create("low", record, (void*) 'L'), 20);
+    thread_set_priority(thread_create("high", record, (void*) 'H'), 5);
+    // Only the higher level runs before we do; the lower one waits until we step down
+    thread_yield();
+    order[count++] = 'M';
+    thread_set_priority(self, SCHED_PRIO_LOWEST);
+    thread_yield();
+    order[count] = '\\0';
+    printf("Run order: %s\\n", order);
+    int order_ok = order[0] == 'H' && order[1] == 'M' && order[2] == 'L';
+
+    count = 0;
+    thread_set_priority(thread_create("waiter", waiter, NULL), 20);
+    while (waiter_thread == NULL) {
+        thread_yield();
+    }
+    thread_set_priority(self, SCHED_PRIO_DEFAULT);
+    // Boosted from 20 to 12 it outranks us, so our yield hands it the CPU first
+    thread_unblock_boost(waiter_thread, SCHED_BOOST_INPUT);
+    uint32_t boosted = waiter_thread->priority;
+    thread_yield();
+    order[count++] = 'M';
+    printf("Boosted priority %u, wake order: %c%c\\n", boosted, order[0], order[1]);
+
+    if (order_ok && boosted == 20 - SCHED_BOOST_INPUT && order[0] == 'W' && order[1] == 'M') {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="thread_priority",
+        test_code=THREAD_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 5: The idle routine returns on a set flag at once and on an interrupt otherwise, and sleeps still wake
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    printf("Idle with %s\\n", cpu_idle_mwait() ? "MONITOR/MWAIT" : "HLT");
+    static volatile bool wake = true;
+    asm volatile("cli");
+    cpu_idle(&wake);
+    int on_after_set = irqs_enabled();
+
+    // Nothing stores to the flag: the timer interrupt has to end the wait
+    wake = false;
+    timer_initialize(TIMER_DEFAULT_HZ);
+    asm volatile("cli");
+    cpu_idle(&wake);
+    int on_after_irq = irqs_enabled();
+
+    // The idle thread waits in cpu_idle() while we sleep
+    uint64_t start = ktime_ns();
+    ksleep(20);
+    uint64_t elapsed_ms = (ktime_ns() - start) / 1000000;
+    printf("Slept %u ms\\n", (uint32_t) elapsed_ms);
+
+    if (on_after_set && on_after_irq && elapsed_ms >= 20 && elapsed_ms < 1000) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="thread_idle_mwait",
+        test_code=THREAD_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=["-cpu", "max"],
+    )
@@ -0,0 +1,233 @@
+from test_framework import OlymposTestFramework
+
+TIMER_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/timer.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    terminal_initialize();
+    gdt_init();
+    idt_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+TIMER_SCHED_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/apic.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    apic_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_timer_tests(framework: OlymposTestFramework):
+    # Test 1: Ticks advance and ksleep() waits at least the requested time
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    uint64_t ticks_before = timer_ticks();
+    uint64_t start = ktime_ns();
+    ksleep(50);
+    uint64_t elapsed_ms = (ktime_ns() - start) / 1000000;
+    uint64_t ticks = timer_ticks() - ticks_before;
+    printf("Slept %u ms over %u ticks\\n", (uint32_t) elapsed_ms, (uint32_t) ticks);
+
+    // Upper bound is loose: TCG can deliver ticks late
+    if (elapsed_ms >= 50 && elapsed_ms < 1000 && ticks >= 45) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="timer_sleep", test_code=TIMER_TEST_TEMPLATE.format(test_body=test_body), expected_output="TEST_PASS"
+    )
+
+    # Test 2: ktime_ns() never goes backwards, also across tick boundaries
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    int monotonic = 1;
+    uint64_t prev = ktime_ns();
+    uint64_t end_tick = timer_ticks() + 20;
+    while (timer_ticks() < end_tick) {
+        uint64_t now = ktime_ns();
+        if (now < prev) {
+            monotonic = 0;
+        }
+        prev = now;
+    }
+
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    printf("Timer: %u Hz, TSC %u MHz\\n", stats.hz, (uint32_t) (stats.tsc_hz / 1000000));
+
+    if (monotonic && stats.hz == TIMER_DEFAULT_HZ && stats.ticks >= 20) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="timer_monotonic",
+        test_code=TIMER_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: Timers fire in deadline order, not before their deadline; deleted ones never, moved ones once
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    static const uint32_t delays_ms[] = { 30, 3, 100, 10, 70 };
+    static ktimer_t timers[5];
+    static volatile uint64_t fired_at[5];
+    static volatile int order[5];
+    static volatile int fired = 0;
+    void on_timer(void* data) {
+        int i = (int) (uint32_t) data;
+        fired_at[i] = ktime_ns();
+        order[fired++] = i;
+    }
+
+    uint64_t start = ktime_ns();
+    for (int i = 0; i < 5; i++) {
+        timer_setup(&timers[i], on_timer, (void*) (uint32_t) i);
+        timer_add(&timers[i], start + delays_ms[i] * 1000000ull);
+    }
+    // 70 ms is deleted, 100 ms moved to 50 ms (from the second level of the wheel into the first)
+    int deleted = timer_del(&timers[4]);
+    int deleted_again = timer_del(&timers[4]);
+    timer_add(&timers[2], start + 50 * 1000000ull);
+
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    printf("%u timers pending\\n", stats.timers_pending);
+
+    while (fired < 4) {
+        asm volatile("hlt");
+    }
+    ksleep(40);     // 90 ms: the deleted timer would have fired by now
+
+    static const int expected[] = { 1, 3, 0, 2 };
+    static const uint32_t expected_ms[] = { 30, 3, 50, 10 };
+    int ok = deleted && !deleted_again && fired == 4 && stats.timers_pending == 4;
+    for (int i = 0; i < 4; i++) {
+        int t = order[i];
+        printf("Timer %d fired after %u ms\\n", t, (uint32_t) ((fired_at[t] - start) / 1000000));
+        if (t != expected[i] || fired_at[t] - start < expected_ms[t] * 1000000ull || timer_pending(&timers[t])) {
+            ok = 0;
+        }
+    }
+    if (ok) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="timer_wheel", test_code=TIMER_TEST_TEMPLATE.format(test_body=test_body), expected_output="TEST_PASS"
+    )
+
+    # Test 4: An idle scheduler stops the tick: a 200 ms sleep takes far fewer timer interrupts than ticks
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    timer_stats_t before, after;
+    timer_get_stats(&before);
+    if (!before.tickless) {
+        printf("TEST_FAILED: no tickless idle (LAPIC timer and TSC needed)\\n");
+        exit_qemu(1);
+    }
+    uint64_t start = ktime_ns();
+    ksleep(200);
+    uint64_t elapsed_ms = (ktime_ns() - start) / 1000000;
+    timer_get_stats(&after);
+
+    uint64_t ticks = after.ticks - before.ticks;
+    uint64_t irqs = after.tick_irqs - before.tick_irqs;
+    printf("Slept %u ms: %u ticks, %u timer IRQs, %u idle stops (%s)\\n", (uint32_t) elapsed_ms,
+           (uint32_t) ticks, (uint32_t) irqs, (uint32_t) (after.idle_stops - before.idle_stops),
+           after.tsc_deadline ? "TSC deadline" : "one-shot");
+
+    // The clock keeps real time across the stopped ticks
+    if (elapsed_ms >= 200 && elapsed_ms < 1000 && ticks >= 190 && irqs < ticks / 2 &&
+        after.idle_stops > before.idle_stops) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="timer_tickless",
+        test_code=TIMER_SCHED_TEST_TEMPLATE.format(test_body=test_body),
+        expected_output="TEST_PASS",
+    )
@@ -0,0 +1,111 @@
+from test_framework import OlymposTestFramework
+
+TRACE_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/serial.h>
+#include <kernel/trace.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;  // Suppress unused parameter warning
+
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_trace_tests(framework: OlymposTestFramework):
+    # Test 1: Tracepoints record allocations, IRQs and marks in order, cheaply
+    test_helpers = """
+    static trace_record_t records[TRACE_RING_SIZE];
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    trace_start();
+    void* ptr = kmalloc(200);
+    kfree(ptr);
+    TRACE(MARK, 1, 2);
+    ksleep(5);
+    uint64_t start = ktime_ns();
+    for (uint32_t i = 0; i < 1000; i++) {
+        TRACE(MARK, 3, i);
+    }
+    uint64_t elapsed = ktime_ns() - start;
+    trace_stop();
+    TRACE(MARK, 4, 0);  // Not recorded
+
+    size_t count = trace_read(records, TRACE_RING_SIZE);
+    int alloc_at = -1, free_at = -1, mark_at = -1, irqs = 0, late = 0;
+    uint32_t loop_marks = 0;  // MARK 3 records, which must appear in loop order
+    for (size_t i = 0; i < count; i++) {
+        const trace_record_t* rec = &records[i];
+        if (rec->event == TRACE_KMALLOC && rec->a == 200 && rec->b == (uint32_t) ptr && alloc_at < 0) {
+            alloc_at = (int) i;
+        }
+        if (rec->event == TRACE_KFREE && rec->a == (uint32_t) ptr && free_at < 0) {
+            free_at = (int) i;
+        }
+        if (rec->event == TRACE_MARK && rec->a == 1 && rec->b == 2) {
+            mark_at = (int) i;
+        }
+        if (rec->event == TRACE_MARK && rec->a == 4) {
+            late++;
+        }
+        if (rec->event == TRACE_MARK && rec->a == 3 && rec->b == loop_marks) {
+            loop_marks++;
+        }
+        irqs += rec->event == TRACE_IRQ;
+    }
+    printf("%u records, kmalloc at %d, kfree at %d, mark at %d, %d IRQs, %u ns per record\\n", count, alloc_at,
+           free_at, mark_at, irqs, (uint32_t) (elapsed / 1000));
+    trace_dump(SERIAL_COM1_BASE);
+
+    if (alloc_at >= 0 && alloc_at < free_at && free_at < mark_at && irqs > 0 && late == 0 && loop_marks == 1000) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="trace_records",
+        test_code=TRACE_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
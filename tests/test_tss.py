@@ -165,21 +165,21 @@ def register_tss_tests(framework: OlymposTestFramework):
         name="tss_contents_valid", test_code=TSS_TEST_TEMPLATE.format(test_body=test_body), expected_output="TEST_PASS"
     )
 
-    # Test 4: Verify all 6 GDT entries exist
+    # Test 4: Verify all 7 GDT entries exist
     test_body = """
     printf("TEST_RUNNING\\n");
     
     gdt_register_t gdtr;
     asm volatile("sgdt %0" : "=m"(gdtr));
     
-    // GDT limit should accommodate 6 entries (0 - 5)
-    uint16_t expected_limit = (sizeof(gdt_entry_t) * 6) - 1;
+    // GDT limit should accommodate 7 entries (0 - 6)
+    uint16_t expected_limit = (sizeof(gdt_entry_t) * 7) - 1;
     
     printf("GDT Limit: 0x%04x\\n", gdtr.boundary);
     printf("Expected Limit: 0x%04x\\n", expected_limit);
     
     if (gdtr.boundary == expected_limit) {
-        printf("GDT contains 6 entries (Null, KCode, KData, UCode, UData, TSS)\\n");
+        printf("GDT contains 7 entries (Null, KCode, KData, UCode, UData, TSS, PerCPU)\\n");
         printf("TEST_PASS\\n");
     }
     else {
@@ -188,7 +188,7 @@ def register_tss_tests(framework: OlymposTestFramework):
     """
 
     framework.register_test(
-        name="gdt_has_six_entries",
+        name="gdt_has_seven_entries",
         test_code=TSS_TEST_TEMPLATE.format(test_body=test_body),
         expected_output="TEST_PASS",
     )
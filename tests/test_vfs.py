@@ -0,0 +1,436 @@
+from test_framework import OlymposTestFramework
+
+VFS_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/process.h>
+#include <kernel/syscall.h>
+#include <kernel/vfs.h>
+#include <kernel/initrd.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+// Archive built by the test; identity mapped, so its physical address is its address
+static uint8_t archive[0x8000] __attribute__((aligned(4096)));
+static uint32_t archive_len = 0;
+
+static void octal(uint8_t* field, size_t len, uint32_t value) {{
+    for (size_t i = len - 1; i-- > 0; value >>= 3) {{
+        field[i] = (uint8_t) ('0' + (value & 7));
+    }}
+}}
+
+static void hex8(uint8_t* field, uint32_t value) {{
+    for (int i = 7; i >= 0; i--, value >>= 4) {{
+        field[i] = (uint8_t) "0123456789abcdef"[value & 0xf];
+    }}
+}}
+
+// One ustar entry: header, then the data padded to 512 bytes
+__attribute__((unused)) static void tar_add(const char* name, char type, const void* data, uint32_t size) {{
+    uint8_t* header = &archive[archive_len];
+    memcpy(header, name, strlen(name));
+    octal(header + 100, 8, 0644);
+    octal(header + 124, 12, size);
+    header[156] = (uint8_t) type;
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    if (size > 0) {{
+        memcpy(header + 512, data, size);
+    }}
+    archive_len += 512 + ((size + 511) & ~511u);
+}}
+
+// One newc cpio entry: header, name and data each padded to 4 bytes
+__attribute__((unused)) static void cpio_add(const char* name, uint32_t mode, const void* data, uint32_t size) {{
+    static uint32_t ino = 1;
+    uint8_t* header = &archive[archive_len];
+    uint32_t name_size = strlen(name) + 1;
+    const uint32_t fields[13] = {{ ino++, mode, 0, 0, 1, 0, size, 0, 0, 0, 0, name_size, 0 }};
+    memcpy(header, "070701", 6);
+    for (int i = 0; i < 13; i++) {{
+        hex8(header + 6 + i * 8, fields[i]);
+    }}
+    memcpy(header + 110, name, name_size);
+    archive_len = (archive_len + 110 + name_size + 3) & ~3u;
+    if (size > 0) {{
+        memcpy(&archive[archive_len], data, size);
+    }}
+    archive_len = (archive_len + size + 3) & ~3u;
+}}
+
+static int mount_archive(void) {{
+    inode_t* root = initrd_load(archive, archive_len, (uint32_t) archive);
+    return root != NULL ? vfs_mount_root(root) : -1;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    syscall_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_vfs_tests(framework: OlymposTestFramework):
+    # Test 1: Paths of a tar archive resolve; seen components hit the dentry cache, missing ones are negative
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    const char hello[] = "Hello from the initrd\\n";
+    const char motd[] = "motd";
+    tar_add("./bin/", '5', NULL, 0);
+    tar_add("./bin/hello.txt", '0', hello, sizeof(hello) - 1);
+    tar_add("etc/motd", '0', motd, sizeof(motd) - 1);      // etc/ is implied
+    tar_add("link", '2', NULL, 0);                          // Symlinks are skipped
+    archive_len += 1024;                                    // End-of-archive blocks
+    if (vfs_lookup("/") != NULL || mount_archive() != 0) {
+        printf("TEST_FAIL: Mount\\n");
+        exit_qemu(1);
+    }
+
+    vfs_stats_t s0, s1, s2, s3;
+    vfs_get_stats(&s0);
+    dentry_t* first = vfs_lookup("/bin/hello.txt");
+    vfs_get_stats(&s1);
+    dentry_t* again = vfs_lookup("bin//hello.txt");
+    vfs_get_stats(&s2);
+    printf("First walk: %u lookups, %u misses; second: %u hits\\n", s1.lookups - s0.lookups,
+           s1.misses - s0.misses, s2.hits - s1.hits);
+    if (first == NULL || again != first || first->inode->type != VFS_TYPE_FILE ||
+        first->inode->size != sizeof(hello) - 1 || s1.misses - s0.misses != 2 || s2.hits - s1.hits != 2 ||
+        s2.misses != s1.misses) {
+        printf("TEST_FAIL: Cached lookup\\n");
+        exit_qemu(1);
+    }
+
+    dentry_t* m = vfs_lookup("/bin/../etc/./motd");
+    if (m == NULL || m->inode->size != 4 || vfs_lookup("/etc")->inode->type != VFS_TYPE_DIR ||
+        vfs_lookup("/link") != NULL || vfs_lookup("/bin/hello.txt/x") != NULL ||
+        vfs_lookup("/..") != vfs_lookup("/")) {
+        printf("TEST_FAIL: Path walk\\n");
+        exit_qemu(1);
+    }
+
+    vfs_get_stats(&s2);
+    dentry_t* missing = vfs_lookup("/nope");
+    vfs_get_stats(&s3);
+    dentry_t* missing_again = vfs_lookup("/nope");
+    vfs_stats_t s4;
+    vfs_get_stats(&s4);
+    if (missing != NULL || missing_again != NULL || s3.negative != s2.negative + 1 || s4.negative != s3.negative ||
+        s4.hits != s3.hits + 1 || s4.misses != s3.misses) {
+        printf("TEST_FAIL: Negative dentry\\n");
+        exit_qemu(1);
+    }
+
+    file_t* dir = vfs_open("/", VFS_O_RDONLY);
+    char name[VFS_NAME_MAX];
+    if (dir == NULL || vfs_readdir(dir, 0, name, sizeof(name)) != 0 || strcmp(name, "bin") != 0 ||
+        vfs_readdir(dir, 1, name, sizeof(name)) != 0 || strcmp(name, "etc") != 0 ||
+        vfs_readdir(dir, 2, name, sizeof(name)) != -1) {
+        printf("TEST_FAIL: readdir\\n");
+        exit_qemu(1);
+    }
+    vfs_close(dir);
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="vfs_tar_lookup",
+        test_code=VFS_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: A cpio archive reads back through open files: chunked reads, seeks, no writing
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    char data[1000];
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (char) ('a' + i % 26);
+    }
+    cpio_add(".", 0040755, NULL, 0);
+    cpio_add("data", 0040755, NULL, 0);
+    cpio_add("data/letters", 0100644, data, sizeof(data));
+    cpio_add("TRAILER!!!", 0, NULL, 0);
+    if (mount_archive() != 0) {
+        printf("TEST_FAIL: Mount\\n");
+        exit_qemu(1);
+    }
+
+    file_t* file = vfs_open("/data/letters", VFS_O_RDONLY);
+    if (file == NULL || vfs_open("/data/letters", VFS_O_RDWR) != NULL || vfs_open("/data/none", 0) != NULL) {
+        printf("TEST_FAIL: open\\n");
+        exit_qemu(1);
+    }
+    char buf[600];
+    int32_t a = vfs_read(file, buf, sizeof(buf));
+    int match = memcmp(buf, data, 600) == 0;
+    int32_t b = vfs_read(file, buf, sizeof(buf));
+    match &= memcmp(buf, data + 600, 400) == 0;
+    int32_t eof = vfs_read(file, buf, sizeof(buf));
+    printf("Reads: %d %d %d\\n", a, b, eof);
+    if (a != 600 || b != 400 || eof != 0 || !match) {
+        printf("TEST_FAIL: Sequential reads\\n");
+        exit_qemu(1);
+    }
+
+    int32_t end = vfs_lseek(file, -3, VFS_SEEK_END);
+    int32_t tail = vfs_read(file, buf, sizeof(buf));
+    int32_t back = vfs_lseek(file, -10, VFS_SEEK_CUR);
+    int32_t bad = vfs_lseek(file, -1, VFS_SEEK_SET);
+    int32_t past = vfs_lseek(file, 5000, VFS_SEEK_SET);
+    int32_t none = vfs_read(file, buf, sizeof(buf));
+    if (end != 997 || tail != 3 || memcmp(buf, data + 997, 3) != 0 || back != 990 || bad != -1 || past != 5000 ||
+        none != 0) {
+        printf("TEST_FAIL: lseek (%d %d %d %d %d)\\n", end, tail, back, bad, past);
+        exit_qemu(1);
+    }
+    file_t* dir = vfs_open("/data", VFS_O_RDONLY);
+    if (dir == NULL || vfs_read(dir, buf, 1) != -1) {
+        printf("TEST_FAIL: Reading a directory\\n");
+        exit_qemu(1);
+    }
+    vfs_close(dir);
+    vfs_close(file);
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="vfs_cpio_read_seek",
+        test_code=VFS_TEST_TEMPLATE.format(test_helpers="", test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 3: The file system calls work on descriptors, and an ELF program runs from the initrd
+    test_helpers = """
+    // Headers + text page (R+X), then a writable data word followed by a bss page
+    static uint8_t image[0x2000];
+
+    static const uint8_t code[] = {
+        0xA1, 0x00, 0x10, 0x00, 0x40,           // mov eax, [0x40001000]  (data: 42)
+        0x03, 0x05, 0x00, 0x20, 0x00, 0x40,     // add eax, [0x40002000]  (bss: 0)
+        0x40,                                   // inc eax
+        0x89, 0xC3,                             // mov ebx, eax
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+
+    static void put16(uint32_t offset, uint16_t value) {
+        memcpy(&image[offset], &value, sizeof(value));
+    }
+
+    static void put32(uint32_t offset, uint32_t value) {
+        memcpy(&image[offset], &value, sizeof(value));
+    }
+
+    static void put_phdr(uint32_t offset, uint32_t file_off, uint32_t vaddr, uint32_t filesz, uint32_t memsz,
+                         uint32_t flags) {
+        put32(offset, 1);               // PT_LOAD
+        put32(offset + 4, file_off);
+        put32(offset + 8, vaddr);
+        put32(offset + 16, filesz);
+        put32(offset + 20, memsz);
+        put32(offset + 24, flags);
+        put32(offset + 28, 0x1000);
+    }
+
+    static void build_image(void) {
+        memcpy(image, "\\177ELF\\1\\1\\1", 7);   // ELF32, little-endian, version 1
+        put16(16, 2);                   // ET_EXEC
+        put16(18, 3);                   // EM_386
+        put32(20, 1);
+        put32(24, 0x40000080);          // e_entry
+        put32(28, 52);                  // e_phoff
+        put16(40, 52);
+        put16(42, 32);                  // e_phentsize
+        put16(44, 2);                   // e_phnum
+        put_phdr(52, 0, 0x40000000, 0x1000, 0x1000, 0x5);          // R+X
+        put_phdr(84, 0x1000, 0x40001000, 4, 0x2000, 0x6);          // R+W, bss after the word
+        memcpy(&image[0x80], code, sizeof(code));
+        put32(0x1000, 42);
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    build_image();
+    const char text[] = "0123456789";
+    tar_add("bin/prog", '0', image, sizeof(image));
+    tar_add("text", '0', text, sizeof(text) - 1);
+    archive_len += 1024;
+    if (mount_archive() != 0) {
+        printf("TEST_FAIL: Mount\\n");
+        exit_qemu(1);
+    }
+
+    int fd = open("/text", O_RDONLY);
+    int other = open("/text", O_RDONLY);
+    char buf[16];
+    memset(buf, 0, sizeof(buf));
+    ssize_t n = read(fd, buf, 4);
+    off_t pos = lseek(fd, 2, SEEK_CUR);
+    ssize_t m = read(fd, buf + 4, sizeof(buf));
+    ssize_t fresh = read(other, buf + 8, 1);
+    printf("fds %d %d, read %d then %d at %d: %s\\n", fd, other, (int) n, (int) m, (int) pos, buf);
+    if (fd != VFS_FD_FIRST || other != VFS_FD_FIRST + 1 || n != 4 || pos != 6 || m != 4 || fresh != 1 ||
+        memcmp(buf, "012367890", 9) != 0) {
+        printf("TEST_FAIL: open/read/lseek\\n");
+        exit_qemu(1);
+    }
+    if (write(fd, "x", 1) != -1 || open("/text", O_WRONLY) != -1 || open("/missing", O_RDONLY) != -1 ||
+        close(fd) != 0 || close(fd) != -1 || read(fd, buf, 1) != -1 || close(1) != -1) {
+        printf("TEST_FAIL: Descriptor errors\\n");
+        exit_qemu(1);
+    }
+    close(other);
+
+    process_t* proc = process_exec("/bin/prog");
+    int code = proc != NULL ? process_wait(proc) : -1;
+    printf("Program from the initrd exited with %d\\n", code);
+    if (code != 43 || process_exec("/bin/none") != NULL || process_exec("/bin") != NULL) {
+        printf("TEST_FAIL: exec\\n");
+        exit_qemu(1);
+    }
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="vfs_syscalls_exec",
+        test_code=VFS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 4: mmap() of a page-aligned initrd file maps the archive's frames in every process; anonymous memory too
+    test_helpers = """
+    // Flat program: open and map /table (3 pages), map one anonymous page, then exit with
+    // table[0] + table[1024] + the anonymous word + munmap()'s result
+    static uint8_t program[0x200];
+
+    static const uint8_t code[] = {
+        0xB8, 0x05, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_OPEN
+        0xBB, 0x40, 0x01, 0x00, 0x40,           // mov ebx, path
+        0x31, 0xC9,                             // xor ecx, ecx (O_RDONLY)
+        0xCD, 0x80,                             // int 0x80
+        0xA3, 0x10, 0x01, 0x00, 0x40,           // mov [file_args.fd], eax
+        0xB8, 0x5A, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_MMAP
+        0xBB, 0x00, 0x01, 0x00, 0x40,           // mov ebx, file_args
+        0xCD, 0x80,                             // int 0x80
+        0x89, 0xC6,                             // mov esi, eax
+        0x8B, 0x3E,                             // mov edi, [esi]
+        0x03, 0xBE, 0x00, 0x10, 0x00, 0x00,     // add edi, [esi + 0x1000]
+        0xB8, 0x5A, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_MMAP
+        0xBB, 0x20, 0x01, 0x00, 0x40,           // mov ebx, anon_args
+        0xCD, 0x80,                             // int 0x80
+        0xC7, 0x00, 0x07, 0x00, 0x00, 0x00,     // mov dword [eax], 7
+        0x03, 0x38,                             // add edi, [eax]
+        0xB9, 0x00, 0x00, 0x00, 0x04,           // mov ecx, 0x04000000
+        0x49,                                   // dec ecx
+        0x75, 0xFD,                             // jnz dec
+        0xB8, 0x5B, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_MUNMAP
+        0x89, 0xF3,                             // mov ebx, esi
+        0xB9, 0x00, 0x30, 0x00, 0x00,           // mov ecx, 0x3000
+        0xCD, 0x80,                             // int 0x80
+        0x01, 0xC7,                             // add edi, eax
+        0x89, 0xFB,                             // mov ebx, edi
+        0xB8, 0x01, 0x00, 0x00, 0x00,           // mov eax, SYSCALL_EXIT
+        0xCD, 0x80,                             // int 0x80
+        0xEB, 0xFE,                             // jmp $
+    };
+
+    static void build_program(void) {
+        const uint32_t file_args[6] = { 0, 0x3000, MMAP_PROT_READ, MMAP_SHARED, 0, 0 };
+        const uint32_t anon_args[6] = { 0, 0x1000, MMAP_PROT_READ | MMAP_PROT_WRITE,
+                                        MMAP_PRIVATE | MMAP_ANONYMOUS, (uint32_t) -1, 0 };
+        memcpy(program, code, sizeof(code));
+        memcpy(&program[0x100], file_args, sizeof(file_args));
+        memcpy(&program[0x120], anon_args, sizeof(anon_args));
+        memcpy(&program[0x140], "/table", 7);
+    }
+    """
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    // 512-byte header + 3072 bytes of padding put the next file's data at archive offset 0x1000
+    static uint8_t pad[3072];
+    static uint32_t table[3 * 1024];
+    table[0] = 1000;
+    table[1024] = 200;
+    tar_add("pad", '0', pad, sizeof(pad));
+    tar_add("table", '0', table, sizeof(table));
+    archive_len += 1024;
+    build_program();
+    if (mount_archive() != 0 || memcmp(&archive[0x1000], table, sizeof(table)) != 0) {
+        printf("TEST_FAIL: Mount\\n");
+        exit_qemu(1);
+    }
+    file_t* file = vfs_open("/table", VFS_O_RDONLY);
+    if (process_mmap(0, 0x1000, MMAP_PROT_READ, MMAP_SHARED, file, 0) != MMAP_FAILED) {
+        printf("TEST_FAIL: mmap() from a kernel thread\\n");
+        exit_qemu(1);
+    }
+    vfs_close(file);
+
+    uint32_t frame = (uint32_t) &archive[0x1000];
+    process_t* first = process_create("mmap1", program, sizeof(program));
+    process_t* second = process_create("mmap2", program, sizeof(program));
+    uint32_t shared = 0;
+    for (int i = 0; i < 100 && shared < 3; i++) {
+        ksleep(1);
+        shared = frame_refcount(frame);
+    }
+    int first_code = first != NULL ? process_wait(first) : -1;
+    int second_code = second != NULL ? process_wait(second) : -1;
+    printf("Archive frame references while mapped: %u, after exit: %u\\n", shared, frame_refcount(frame));
+    printf("Exit codes: %d %d\\n", first_code, second_code);
+    if (shared == 3 && frame_refcount(frame) == 1 && first_code == 1207 && second_code == 1207) {
+        printf("TEST_PASS\\n");
+    }
+    else {
+        printf("TEST_FAILED\\n");
+    }
+    """
+
+    framework.register_test(
+        name="vfs_mmap_shared",
+        test_code=VFS_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
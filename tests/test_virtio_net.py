@@ -0,0 +1,248 @@
+from test_framework import OlymposTestFramework
+
+# QEMU's socket backend sends to 127.0.0.1:port from 127.0.0.1:port, so every frame comes straight back
+VIRTIO_NET_LOOPBACK_PORT = 47654
+
+VIRTIO_NET_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/timer.h>
+#include <kernel/thread.h>
+#include <kernel/softirq.h>
+#include <kernel/net.h>
+#include <kernel/virtio_net.h>
+
+#include "../arch/i386/include/irqflags.h"
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+static const uint8_t broadcast[6] = {{ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }};
+
+// Start an Ethernet frame from dev to dst
+__attribute__((unused)) static netbuf_t* frame_new(net_device_t* dev, const uint8_t* dst, uint16_t type) {{
+    netbuf_t* nb = netbuf_alloc();
+    if (nb == NULL) {{
+        return NULL;
+    }}
+    memcpy(nb->data, dst, 6);
+    memcpy(nb->data + 6, dev->mac, 6);
+    nb->data[12] = (uint8_t) (type >> 8);
+    nb->data[13] = (uint8_t) type;
+    nb->len = 60;      // Minimum frame without FCS; the rest is padding
+    memset(nb->data + 14, 0, 46);
+    return nb;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+    sched_init();
+    softirq_init();
+    timer_initialize(TIMER_DEFAULT_HZ);
+    net_init();
+    virtio_net_init();
+
+    net_device_t* dev = net_find("eth0");
+    if (dev == NULL) {{
+        printf("TEST_FAIL: no eth0\\n");
+        exit_qemu(1);
+    }}
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_virtio_net_tests(framework: OlymposTestFramework):
+    user_net = ["-netdev", "user,id=net0", "-device", "virtio-net-pci,netdev=net0,mac=52:54:00:12:34:56"]
+    loopback_net = [
+        "-netdev",
+        f"socket,id=net0,udp=127.0.0.1:{VIRTIO_NET_LOOPBACK_PORT},localaddr=127.0.0.1:{VIRTIO_NET_LOOPBACK_PORT}",
+        "-device",
+        "virtio-net-pci,netdev=net0",
+    ]
+
+    # Test 1: The NIC is found, an ARP request to the user-mode gateway gets its reply in a pool buffer
+    test_helpers = """
+static volatile bool got_reply = false;
+static volatile bool reply_in_place = false;
+
+static void arp_rx(net_device_t* dev, netbuf_t* nb) {
+    const uint8_t* p = nb->data;
+    // ARP reply (opcode 2) from 10.0.2.2 to our MAC
+    if (nb->len >= 42 && p[12] == 0x08 && p[13] == 0x06 && p[21] == 2 &&
+        memcmp(p + 28, "\\x0a\\x00\\x02\\x02", 4) == 0 && memcmp(p + 32, dev->mac, 6) == 0) {
+        // Delivered where the NIC wrote it: inside the buffer, at a physical address the NIC was given
+        reply_in_place = nb->data > nb->head && nb->data + nb->len <= nb->head + NETBUF_SIZE &&
+                         netbuf_phys(nb) == nb->phys + (uint32_t) (nb->data - nb->head);
+        got_reply = true;
+    }
+    netbuf_free(nb);
+}
+"""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    const uint8_t mac[6] = { 0x52, 0x54, 0x00, 0x12, 0x34, 0x56 };
+    if (memcmp(dev->mac, mac, 6) != 0 || !dev->link_up) {
+        printf("TEST_FAIL: wrong MAC or link down\\n");
+        exit_qemu(1);
+    }
+    virtio_net_stats_t vstats;
+    if (virtio_net_get_stats(dev, &vstats) != 0 || vstats.rx_posted == 0) {
+        printf("TEST_FAIL: no receive buffers posted\\n");
+        exit_qemu(1);
+    }
+    net_set_rx_handler(dev, arp_rx);
+
+    netbuf_t* nb = frame_new(dev, broadcast, 0x0806);
+    uint8_t* arp = nb->data + 14;
+    const uint8_t header[8] = { 0x00, 0x01, 0x08, 0x00, 6, 4, 0x00, 0x01 };   // Ethernet/IPv4 request
+    memcpy(arp, header, 8);
+    memcpy(arp + 8, dev->mac, 6);
+    memcpy(arp + 14, "\\x0a\\x00\\x02\\x0f", 4);     // 10.0.2.15
+    memcpy(arp + 24, "\\x0a\\x00\\x02\\x02", 4);     // who has 10.0.2.2
+    if (net_transmit(dev, nb) != 0) {
+        printf("TEST_FAIL: transmit failed\\n");
+        exit_qemu(1);
+    }
+
+    uint64_t deadline = ktime_ns() + 2000000000ull;
+    while (!got_reply && ktime_ns() < deadline) {
+        ksleep(10);
+    }
+    if (!got_reply || !reply_in_place) {
+        printf("TEST_FAIL: no ARP reply (or it was copied)\\n");
+        exit_qemu(1);
+    }
+    net_stats_t stats;
+    net_get_stats(dev, &stats);
+    if (stats.tx_packets != 1 || stats.rx_packets < 1) {
+        printf("TEST_FAIL: tx %u rx %u\\n", (uint32_t) stats.tx_packets, (uint32_t) stats.rx_packets);
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="virtio_net_arp",
+        test_code=VIRTIO_NET_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=user_net,
+    )
+
+    # Test 2: A burst that arrives while interrupts are off costs one interrupt and is drained by polling
+    test_helpers = """
+#define BURST 100
+
+static volatile uint32_t received = 0;
+static uint8_t seen[BURST];
+
+static void burst_rx(net_device_t* dev, netbuf_t* nb) {
+    (void) dev;
+    if (nb->len >= 16 && nb->data[12] == 0x88 && nb->data[13] == 0xB5 && nb->data[14] < BURST) {
+        seen[nb->data[14]]++;
+        received++;
+    }
+    netbuf_free(nb);
+}
+
+static inline uint64_t read_tsc(void) {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+"""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    net_set_rx_handler(dev, burst_rx);
+    uint32_t pool = netbuf_available();
+
+    // The frames are sent and come back into the posted buffers while the CPU ignores the NIC
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < BURST; i++) {
+        netbuf_t* nb = frame_new(dev, broadcast, 0x88B5);
+        if (nb == NULL) {
+            printf("TEST_FAIL: pool empty at frame %u\\n", i);
+            exit_qemu(1);
+        }
+        nb->data[14] = (uint8_t) i;
+        if (net_transmit(dev, nb) != 0) {
+            printf("TEST_FAIL: transmit %u failed\\n", i);
+            exit_qemu(1);
+        }
+    }
+    uint64_t start = read_tsc();
+    while (read_tsc() - start < 500000000ull) {
+        asm volatile("pause");
+    }
+    irq_restore(flags);
+
+    uint64_t deadline = ktime_ns() + 2000000000ull;
+    while (received < BURST && ktime_ns() < deadline) {
+        ksleep(10);
+    }
+    for (uint32_t i = 0; i < BURST; i++) {
+        if (seen[i] != 1) {
+            printf("TEST_FAIL: frame %u received %u times (%u in all)\\n", i, seen[i], received);
+            exit_qemu(1);
+        }
+    }
+
+    virtio_net_stats_t vstats;
+    virtio_net_get_stats(dev, &vstats);
+    if (vstats.interrupts > 4 || vstats.polls_exhausted < 1) {
+        printf("TEST_FAIL: %u interrupts, %u polls (%u exhausted) for %u frames\\n", (uint32_t) vstats.interrupts,
+               (uint32_t) vstats.polls, (uint32_t) vstats.polls_exhausted, BURST);
+        exit_qemu(1);
+    }
+    // Every receive buffer went back to the pool or to the NIC; sent ones are reclaimed by the next send
+    netbuf_t* nb = frame_new(dev, broadcast, 0x88B6);
+    net_transmit(dev, nb);
+    if (netbuf_available() + 1 < pool) {
+        printf("TEST_FAIL: %u packet buffers leaked\\n", pool - netbuf_available());
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="virtio_net_poll_burst",
+        test_code=VIRTIO_NET_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+        qemu_args=loopback_net,
+    )
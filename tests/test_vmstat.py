@@ -0,0 +1,253 @@
+from test_framework import OlymposTestFramework
+
+VMSTAT_TEST_TEMPLATE = """
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <kernel/tty.h>
+#include <kernel/gdt.h>
+#include <kernel/interrupts.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/kheap.h>
+#include <kernel/vmstat.h>
+
+// Exit QEMU function
+void exit_qemu(uint32_t exit_code) {{
+    asm volatile("outl %0, %1" : : "a"(exit_code), "Nd"((uint16_t)0xf4));
+}}
+
+// The counters add up, and the largest run holds at least the largest free block
+__attribute__((unused)) static void check_frames(const frame_stats_t* s) {{
+    uint32_t free = 0;
+    uint32_t largest_block = 0;
+    for (uint32_t order = 0; order <= FRAME_MAX_ORDER; order++) {{
+        free += s->free_blocks[order] << order;
+        if (s->free_blocks[order] != 0) {{
+            largest_block = 1u << order;
+        }}
+    }}
+    if (s->total != frame_total() || s->reserved + s->free + s->used + s->zeroed != s->total || free != s->free ||
+        s->largest_free_run < largest_block || s->largest_free_run > s->free) {{
+        printf("TEST_FAIL: frames %u = %u reserved + %u free + %u used + %u zeroed, run %u\\n", s->total,
+               s->reserved, s->free, s->used, s->zeroed, s->largest_free_run);
+        exit_qemu(1);
+    }}
+}}
+
+// Call sites the histogram should tell apart (not inlined, no tail calls)
+__attribute__((noinline, unused)) static void* site_malloc(size_t size) {{
+    void* ptr = kmalloc(size);
+    asm volatile("" : : "r"(ptr) : "memory");
+    return ptr;
+}}
+
+__attribute__((noinline, unused)) static void* site_calloc(size_t count, size_t size) {{
+    void* ptr = kcalloc(count, size);
+    asm volatile("" : : "r"(ptr) : "memory");
+    return ptr;
+}}
+
+__attribute__((unused)) static bool site_in(const kheap_site_t* site, void* function, uint32_t length) {{
+    return site->pc > (uint32_t) function && site->pc < (uint32_t) function + length;
+}}
+
+{test_helpers}
+
+void kernel_main(unsigned long magic, unsigned long addr) {{
+    (void) magic;
+    terminal_initialize();
+    multiboot_info_t* mbi = (multiboot_info_t*) addr;
+    gdt_init();
+    idt_init();
+    paging_init(mbi);
+    kheap_init();
+
+    // Test code
+    {test_body}
+
+    // Exit QEMU with success
+    exit_qemu(0);
+
+    // Halt if exit failed
+    while(1) {{
+        asm volatile("hlt");
+    }}
+}}
+"""
+
+
+def register_vmstat_tests(framework: OlymposTestFramework):
+    # Test 1: Frame counters follow allocations, zeroing and frees; the heap reports its largest free run
+    test_helpers = ""
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    frame_stats_t before, after;
+    frame_get_stats(&before);
+    check_frames(&before);
+
+    // An order-4 block moves 16 frames from free to used
+    uint32_t block = frame_alloc_order(4);
+    frame_get_stats(&after);
+    check_frames(&after);
+    if (block == 0 || after.free != before.free - 16 || after.used != before.used + 16) {
+        printf("TEST_FAIL: order 4 block: free %u -> %u, used %u -> %u\\n", before.free, after.free, before.used,
+               after.used);
+        exit_qemu(1);
+    }
+
+    // Freeing every other frame of it adds 8 free frames but no run longer than one frame there
+    for (uint32_t i = 0; i < 16; i += 2) {
+        frame_free(block + i * FRAME_SIZE);
+    }
+    frame_get_stats(&after);
+    check_frames(&after);
+    if (after.free != before.free - 8 || after.free_blocks[0] < 8) {
+        printf("TEST_FAIL: half freed block: free %u, %u order 0 blocks\\n", after.free, after.free_blocks[0]);
+        exit_qemu(1);
+    }
+    for (uint32_t i = 1; i < 16; i += 2) {
+        frame_free(block + i * FRAME_SIZE);
+    }
+    frame_get_stats(&after);
+    if (after.free != before.free || after.used != before.used || after.largest_free_run != before.largest_free_run) {
+        printf("TEST_FAIL: after freeing: free %u, used %u, run %u\\n", after.free, after.used,
+               after.largest_free_run);
+        exit_qemu(1);
+    }
+
+    // A frame zeroed ahead of time counts as zeroed, not used
+    if (!frame_zero_idle()) {
+        printf("TEST_FAIL: frame_zero_idle\\n");
+        exit_qemu(1);
+    }
+    frame_get_stats(&after);
+    check_frames(&after);
+    if (after.zeroed != before.zeroed + 1 || after.used != before.used || after.free != before.free - 1) {
+        printf("TEST_FAIL: zeroed %u, used %u\\n", after.zeroed, after.used);
+        exit_qemu(1);
+    }
+
+    // 64 KiB of heap blocks, once freed, leave a run at least that long
+    void* big = kmalloc(64 * 1024);
+    kfree(big);
+    vmstat_t stats;
+    vmstat_get(&stats);
+    if (big == NULL || stats.heap_largest_free < 16 ||
+        stats.heap_largest_free > stats.heap.blocks - stats.heap.blocks_used) {
+        printf("TEST_FAIL: heap largest free run %u of %u free blocks\\n", stats.heap_largest_free,
+               stats.heap.blocks - stats.heap.blocks_used);
+        exit_qemu(1);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="vmstat_frame_counters",
+        test_code=VMSTAT_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )
+
+    # Test 2: The call-site histogram credits allocations and frees (also krealloc()) to the site that allocated
+    test_helpers = """
+    static void* ptrs[300];
+    static kheap_site_t sites[KHEAP_SITES + 1];
+    """
+
+    test_body = """
+    printf("TEST_RUNNING\\n");
+
+    void* before = kmalloc(32);
+    kheap_sites_enable(true);
+    kfree(before);                          // Allocated before: not in the histogram
+
+    void* first[5];
+    for (int i = 0; i < 5; i++) {
+        first[i] = site_malloc(100);
+    }
+    kfree(first[0]);
+    kfree(first[1]);
+    void* moved = krealloc(first[2], 3000);  // A free for site_malloc, an allocation for this site
+    void* calloced[3];
+    for (int i = 0; i < 3; i++) {
+        calloced[i] = site_calloc(4, 64);
+    }
+
+    size_t n = kheap_get_sites(sites, KHEAP_SITES + 1);
+    if (n != 3 || !site_in(&sites[0], (void*) kernel_main, 0x2000) || sites[0].live_bytes != 3000 ||
+        !site_in(&sites[1], (void*) site_calloc, 0x40) || sites[1].allocs != 3 || sites[1].live_bytes != 768 ||
+        !site_in(&sites[2], (void*) site_malloc, 0x40) || sites[2].allocs != 5 || sites[2].frees != 3 ||
+        sites[2].live_bytes != 200 || sites[2].untracked != 0) {
+        printf("TEST_FAIL: %u sites\\n", (uint32_t) n);
+        for (size_t i = 0; i < n; i++) {
+            printf("  pc %p: %u allocs, %u frees, %u live\\n", sites[i].pc, sites[i].allocs, sites[i].frees,
+                   sites[i].live_bytes);
+        }
+        exit_qemu(1);
+    }
+    if (kheap_get_sites(sites, 1) != 1 || sites[0].live_bytes != 3000) {
+        printf("TEST_FAIL: top site\\n");
+        exit_qemu(1);
+    }
+
+    // Many live pointers at once, freed out of order: every free still finds its entry
+    for (int i = 0; i < 300; i++) {
+        ptrs[i] = site_malloc(16 + i % 200);
+    }
+    for (int i = 0; i < 300; i += 3) {
+        kfree(ptrs[i]);
+    }
+    for (int i = 299; i >= 0; i--) {
+        if (i % 3 != 0) {
+            kfree(ptrs[i]);
+        }
+    }
+    kfree(first[3]);
+    kfree(first[4]);
+    n = kheap_get_sites(sites, KHEAP_SITES + 1);
+    const kheap_site_t* malloc_site = NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (site_in(&sites[i], (void*) site_malloc, 0x40)) {
+            malloc_site = &sites[i];
+        }
+    }
+    if (malloc_site == NULL || malloc_site->allocs != 305 || malloc_site->frees != 305 ||
+        malloc_site->live_bytes != 0) {
+        printf("TEST_FAIL: site_malloc after 300 more\\n");
+        exit_qemu(1);
+    }
+
+    // Off: nothing more is counted; on again: empty
+    kheap_sites_enable(false);
+    kfree(moved);
+    void* unrecorded = site_malloc(100);
+    n = kheap_get_sites(sites, KHEAP_SITES + 1);
+    if (n != 3 || sites[0].live_bytes != 3000) {
+        printf("TEST_FAIL: recorded while off\\n");
+        exit_qemu(1);
+    }
+    kheap_sites_enable(true);
+    if (kheap_get_sites(sites, KHEAP_SITES + 1) != 0) {
+        printf("TEST_FAIL: not reset\\n");
+        exit_qemu(1);
+    }
+    kheap_sites_enable(false);
+    kfree(unrecorded);
+    for (int i = 0; i < 3; i++) {
+        kfree(calloced[i]);
+    }
+
+    printf("TEST_PASS\\n");
+    """
+
+    framework.register_test(
+        name="vmstat_call_sites",
+        test_code=VMSTAT_TEST_TEMPLATE.format(test_helpers=test_helpers, test_body=test_body),
+        expected_output="TEST_PASS",
+    )